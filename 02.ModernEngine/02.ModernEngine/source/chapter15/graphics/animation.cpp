@@ -0,0 +1,745 @@
+#include "graphics/animation.hpp"
+#include "graphics/scene_graph.hpp"
+
+#include "foundation/memory.hpp"
+#include "foundation/assert.hpp"
+#include "foundation/log.hpp"
+#include "foundation/time.hpp"
+
+#include "external/cglm/struct/affine.h"
+#include "external/cglm/struct/mat4.h"
+#include "external/cglm/struct/quat.h"
+#include "external/cglm/struct/vec3.h"
+
+#include "external/tracy/tracy/Tracy.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+    #define RAPTOR_ANIMATION_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace raptor {
+
+// Vector math on whole key frames ///////////////////////////////////////
+
+#if defined RAPTOR_ANIMATION_SSE2
+
+typedef __m128 AnimationVector;
+
+static inline AnimationVector animation_load( const vec4s& v ) { return _mm_loadu_ps( v.raw ); }
+static inline void animation_store( vec4s& v, AnimationVector a ) { _mm_storeu_ps( v.raw, a ); }
+static inline AnimationVector animation_scale( AnimationVector a, f32 s ) { return _mm_mul_ps( a, _mm_set1_ps( s ) ); }
+static inline AnimationVector animation_madd( AnimationVector a, AnimationVector b, f32 s ) { return _mm_add_ps( a, _mm_mul_ps( b, _mm_set1_ps( s ) ) ); }
+
+static inline f32 animation_dot( AnimationVector a, AnimationVector b ) {
+    __m128 m = _mm_mul_ps( a, b );
+    m = _mm_add_ps( m, _mm_shuffle_ps( m, m, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+    m = _mm_add_ps( m, _mm_shuffle_ps( m, m, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+    return _mm_cvtss_f32( m );
+}
+
+// Components of 4 lanes to a vector per lane.
+static inline void animation_transpose( AnimationVector v[ 4 ] ) {
+    _MM_TRANSPOSE4_PS( v[ 0 ], v[ 1 ], v[ 2 ], v[ 3 ] );
+}
+
+#else
+
+typedef vec4s AnimationVector;
+
+static inline AnimationVector animation_load( const vec4s& v ) { return v; }
+static inline void animation_store( vec4s& v, AnimationVector a ) { v = a; }
+static inline AnimationVector animation_scale( AnimationVector a, f32 s ) { return vec4s{ a.x * s, a.y * s, a.z * s, a.w * s }; }
+static inline AnimationVector animation_madd( AnimationVector a, AnimationVector b, f32 s ) { return vec4s{ a.x + b.x * s, a.y + b.y * s, a.z + b.z * s, a.w + b.w * s }; }
+static inline f32 animation_dot( AnimationVector a, AnimationVector b ) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+
+static inline void animation_transpose( AnimationVector v[ 4 ] ) {
+    for ( u32 r = 0; r < 4; ++r ) {
+        for ( u32 c = r + 1; c < 4; ++c ) {
+            const f32 temp = v[ r ].raw[ c ];
+            v[ r ].raw[ c ] = v[ c ].raw[ r ];
+            v[ c ].raw[ r ] = temp;
+        }
+    }
+}
+
+#endif // RAPTOR_ANIMATION_SSE2
+
+static inline AnimationVector animation_lerp( AnimationVector a, AnimationVector b, f32 t ) {
+    return animation_madd( animation_scale( a, 1.f - t ), b, t );
+}
+
+// Key frame search //////////////////////////////////////////////////////
+
+// Returns the key frame k with key_frames[ k ] <= time < key_frames[ k + 1 ].
+// Time must be inside the key frames range.
+static u32 animation_find_key( const f32* key_frames, u32 key_count, f32 time, u32 cursor ) {
+    // Playback moves forward by less than a key most of the times: check the cached key and the next one.
+    if ( cursor + 1 < key_count && key_frames[ cursor ] <= time ) {
+        if ( time < key_frames[ cursor + 1 ] ) {
+            return cursor;
+        }
+        if ( cursor + 2 < key_count && time < key_frames[ cursor + 2 ] ) {
+            return cursor + 1;
+        }
+    }
+
+    // Looping or seeking, binary search.
+    u32 low = 0;
+    u32 high = key_count - 1;
+    while ( high - low > 1 ) {
+        const u32 middle = ( low + high ) / 2;
+        if ( key_frames[ middle ] <= time ) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Samples the 4 lanes at once, each result vector is a component of all the lanes.
+static void animation_sample( const AnimationSampler& sampler, f32 time, u32& cursor, AnimationVector components[ 4 ] ) {
+    const f32* key_frames = sampler.key_frames.data;
+    const u32 key_count = sampler.key_frames.size;
+    const vec4s* data = sampler.data;
+
+    // Clamp outside of the key frames.
+    if ( key_count == 1 || time <= key_frames[ 0 ] || time >= key_frames[ key_count - 1 ] ) {
+        cursor = ( key_count == 1 || time <= key_frames[ 0 ] ) ? 0 : key_count - 1;
+        for ( u32 c = 0; c < 4; ++c ) {
+            components[ c ] = animation_load( data[ cursor * 4 + c ] );
+        }
+        return;
+    }
+
+    const u32 key = animation_find_key( key_frames, key_count, time, cursor );
+    cursor = key;
+
+    const f32 key_delta = key_frames[ key + 1 ] - key_frames[ key ];
+    const f32 t = ( time - key_frames[ key ] ) / key_delta;
+
+    const vec4s* values = data + key * 4;
+    const vec4s* next_values = values + 4;
+
+    switch ( sampler.interpolation_type ) {
+        case AnimationSampler::Step:
+        {
+            for ( u32 c = 0; c < 4; ++c ) {
+                components[ c ] = animation_load( values[ c ] );
+            }
+            break;
+        }
+
+        case AnimationSampler::CubicSpline:
+        {
+            // Hermite spline, tangents are scaled by the key frame duration (glTF 2.0 appendix C).
+            const f32 t2 = t * t;
+            const f32 t3 = t2 * t;
+            const f32 value_factor = 2.f * t3 - 3.f * t2 + 1.f;
+            const f32 out_tangent_factor = ( t3 - 2.f * t2 + t ) * key_delta;
+            const f32 next_value_factor = -2.f * t3 + 3.f * t2;
+            const f32 in_tangent_factor = ( t3 - t2 ) * key_delta;
+
+            const vec4s* out_tangents = sampler.out_tangents + key * 4;
+            const vec4s* in_tangents = sampler.in_tangents + ( key + 1 ) * 4;
+
+            for ( u32 c = 0; c < 4; ++c ) {
+                AnimationVector result = animation_scale( animation_load( values[ c ] ), value_factor );
+                result = animation_madd( result, animation_load( out_tangents[ c ] ), out_tangent_factor );
+                result = animation_madd( result, animation_load( next_values[ c ] ), next_value_factor );
+                components[ c ] = animation_madd( result, animation_load( in_tangents[ c ] ), in_tangent_factor );
+            }
+            break;
+        }
+
+        default:
+        {
+            for ( u32 c = 0; c < 4; ++c ) {
+                components[ c ] = animation_lerp( animation_load( values[ c ] ), animation_load( next_values[ c ] ), t );
+            }
+            break;
+        }
+    }
+}
+
+// AnimationSampler //////////////////////////////////////////////////////
+
+vec4s AnimationSampler::get_value( u32 key, u32 lane ) const {
+    const vec4s* values = data + key * 4;
+    return vec4s{ values[ 0 ].raw[ lane ], values[ 1 ].raw[ lane ], values[ 2 ].raw[ lane ], values[ 3 ].raw[ lane ] };
+}
+
+// AnimationPose /////////////////////////////////////////////////////////
+
+void AnimationPose::init( Allocator* allocator_, u32 node_offset_, u32 node_count_, const mat4s* rest_local_matrices, u32 rest_count ) {
+    allocator = allocator_;
+    node_offset = node_offset_;
+    node_count = node_count_;
+
+    // Transforms, rest transforms and weights share a single allocation.
+    const sizet transforms_size = sizeof( vec4s ) * node_count * 6;
+    u8* memory = ( u8* )rallocaa( transforms_size + sizeof( f32 ) * node_count * AnimationChannel::Weights + 16, allocator, 16 );
+
+    translations = ( vec4s* )memory;
+    rotations = translations + node_count;
+    scales = rotations + node_count;
+    rest_translations = scales + node_count;
+    rest_rotations = rest_translations + node_count;
+    rest_scales = rest_rotations + node_count;
+    weights = ( f32* )( memory + transforms_size );
+
+    for ( u32 n = 0; n < node_count; ++n ) {
+        if ( rest_local_matrices && n < rest_count ) {
+            vec4s translation;
+            mat4s rotation;
+            vec3s scale;
+            glms_decompose( rest_local_matrices[ n ], &translation, &rotation, &scale );
+            const versors rotation_quat = glms_mat4_quat( rotation );
+
+            rest_translations[ n ] = vec4s{ translation.x, translation.y, translation.z, 0.f };
+            rest_rotations[ n ] = vec4s{ rotation_quat.x, rotation_quat.y, rotation_quat.z, rotation_quat.w };
+            rest_scales[ n ] = vec4s{ scale.x, scale.y, scale.z, 0.f };
+        } else {
+            rest_translations[ n ] = vec4s{ 0.f, 0.f, 0.f, 0.f };
+            rest_rotations[ n ] = vec4s{ 0.f, 0.f, 0.f, 1.f };
+            rest_scales[ n ] = vec4s{ 1.f, 1.f, 1.f, 0.f };
+        }
+
+        translations[ n ] = rest_translations[ n ];
+        rotations[ n ] = rest_rotations[ n ];
+        scales[ n ] = rest_scales[ n ];
+    }
+
+    memset( weights, 0, sizeof( f32 ) * node_count * AnimationChannel::Weights );
+
+    instances.init( allocator, 4 );
+}
+
+void AnimationPose::shutdown() {
+    for ( u32 i = 0; i < instances.size; ++i ) {
+        rfree( instances[ i ].key_cursors, allocator );
+    }
+    instances.shutdown();
+
+    rfree( translations, allocator );
+    translations = rotations = scales = nullptr;
+    rest_translations = rest_rotations = rest_scales = nullptr;
+    weights = nullptr;
+}
+
+u32 AnimationPose::add_instance( const Animation& animation, u32 animation_index, f32 weight, f32 speed ) {
+    AnimationInstance& instance = instances.push_use();
+    instance.animation = animation_index;
+    instance.current_time = animation.time_start;
+    instance.weight = weight;
+    instance.speed = speed;
+
+    const u32 cursors_count = animation.samplers.size ? animation.samplers.size : 1;
+    instance.key_cursors = ( u32* )ralloca( sizeof( u32 ) * cursors_count, allocator );
+    memset( instance.key_cursors, 0, sizeof( u32 ) * cursors_count );
+
+    return instances.size - 1;
+}
+
+void AnimationPose::evaluate( const Animation* animations, f32 delta_time ) {
+    ZoneScoped;
+
+    memset( translations, 0, sizeof( vec4s ) * node_count * 3 );
+    memset( weights, 0, sizeof( f32 ) * node_count * AnimationChannel::Weights );
+
+    vec4s* targets[ AnimationChannel::Weights ] = { translations, rotations, scales };
+
+    for ( u32 i = 0; i < instances.size; ++i ) {
+        AnimationInstance& instance = instances[ i ];
+        const Animation& animation = animations[ instance.animation ];
+
+        // Advance and loop
+        instance.current_time += delta_time * instance.speed;
+        const f32 duration = animation.time_end - animation.time_start;
+        if ( duration > 0.f && ( instance.current_time > animation.time_end || instance.current_time < animation.time_start ) ) {
+            instance.current_time = animation.time_start + fmodf( instance.current_time - animation.time_start, duration );
+            if ( instance.current_time < animation.time_start ) {
+                instance.current_time += duration;
+            }
+        }
+
+        if ( instance.weight <= 0.f ) {
+            continue;
+        }
+
+        for ( u32 s = 0; s < animation.samplers.size; ++s ) {
+            const AnimationSampler& sampler = animation.samplers[ s ];
+
+            // Sampled as components of the lanes, then transposed to a value per lane.
+            AnimationVector values[ 4 ];
+            animation_sample( sampler, instance.current_time, instance.key_cursors[ s ], values );
+            animation_transpose( values );
+
+            for ( u32 l = 0; l < sampler.lane_count; ++l ) {
+                const AnimationChannel& channel = animation.channels[ sampler.channels[ l ] ];
+                RASSERT( ( u32 )channel.target_node < node_count );
+
+                vec4s& target = targets[ channel.target_type ][ channel.target_node ];
+                const AnimationVector accumulated = animation_load( target );
+
+                // Rotations are blended in the same hemisphere.
+                f32 weight = instance.weight;
+                if ( channel.target_type == AnimationChannel::Rotation && animation_dot( accumulated, values[ l ] ) < 0.f ) {
+                    weight = -weight;
+                }
+
+                animation_store( target, animation_madd( accumulated, values[ l ], weight ) );
+                weights[ channel.target_node * AnimationChannel::Weights + channel.target_type ] += instance.weight;
+            }
+        }
+    }
+
+    // Normalize blended values, or blend the missing weight with the rest transform.
+    // Rotations are normalized linear blends, close to slerp for near key frames.
+    for ( u32 n = 0; n < node_count; ++n ) {
+        const f32* node_weights = weights + n * AnimationChannel::Weights;
+
+        const f32 translation_weight = node_weights[ AnimationChannel::Translation ];
+        if ( translation_weight >= 1.f ) {
+            animation_store( translations[ n ], animation_scale( animation_load( translations[ n ] ), 1.f / translation_weight ) );
+        } else if ( translation_weight > 0.f ) {
+            animation_store( translations[ n ], animation_madd( animation_load( translations[ n ] ), animation_load( rest_translations[ n ] ), 1.f - translation_weight ) );
+        } else {
+            translations[ n ] = rest_translations[ n ];
+        }
+
+        const f32 rotation_weight = node_weights[ AnimationChannel::Rotation ];
+        AnimationVector rotation = animation_load( rotations[ n ] );
+        if ( rotation_weight > 0.f && rotation_weight < 1.f ) {
+            const AnimationVector rest_rotation = animation_load( rest_rotations[ n ] );
+            const f32 rest_weight = animation_dot( rotation, rest_rotation ) < 0.f ? rotation_weight - 1.f : 1.f - rotation_weight;
+            rotation = animation_madd( rotation, rest_rotation, rest_weight );
+        }
+
+        const f32 rotation_length_squared = animation_dot( rotation, rotation );
+        if ( rotation_weight > 0.f && rotation_length_squared > 0.f ) {
+            animation_store( rotations[ n ], animation_scale( rotation, 1.f / sqrtf( rotation_length_squared ) ) );
+        } else {
+            rotations[ n ] = rest_rotations[ n ];
+        }
+
+        const f32 scale_weight = node_weights[ AnimationChannel::Scale ];
+        if ( scale_weight >= 1.f ) {
+            animation_store( scales[ n ], animation_scale( animation_load( scales[ n ] ), 1.f / scale_weight ) );
+        } else if ( scale_weight > 0.f ) {
+            animation_store( scales[ n ], animation_madd( animation_load( scales[ n ] ), animation_load( rest_scales[ n ] ), 1.f - scale_weight ) );
+        } else {
+            scales[ n ] = rest_scales[ n ];
+        }
+    }
+}
+
+mat4s AnimationPose::get_local_matrix( u32 node_index ) const {
+    RASSERT( node_index < node_count );
+
+    const vec4s& t = translations[ node_index ];
+    const vec4s& r = rotations[ node_index ];
+    const vec4s& s = scales[ node_index ];
+
+    const mat4s translation_matrix = glms_translate_make( vec3s{ t.x, t.y, t.z } );
+    const mat4s scale_matrix = glms_scale_make( vec3s{ s.x, s.y, s.z } );
+    const versors rotation = glms_quat_init( r.x, r.y, r.z, r.w );
+    return glms_mat4_mul( glms_mat4_mul( translation_matrix, glms_quat_mat4( rotation ) ), scale_matrix );
+}
+
+void AnimationPose::write_local_matrices( SceneGraph* scene_graph ) const {
+    const u32 scene_graph_count = scene_graph->node_count();
+
+    for ( u32 n = 0; n < node_count && node_offset + n < scene_graph_count; ++n ) {
+        const f32* node_weights = weights + n * AnimationChannel::Weights;
+        if ( node_weights[ AnimationChannel::Translation ] + node_weights[ AnimationChannel::Rotation ] + node_weights[ AnimationChannel::Scale ] > 0.f ) {
+            scene_graph->set_local_matrix( node_offset + n, get_local_matrix( n ) );
+        }
+    }
+}
+
+// AnimationUpdateTask ///////////////////////////////////////////////////
+
+void AnimationUpdateTask::ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) {
+    ZoneScoped;
+
+    for ( u32 p = range_.start; p < range_.end; ++p ) {
+        poses[ p ].evaluate( animations, delta_time );
+    }
+}
+
+// AnimationSystem ///////////////////////////////////////////////////////
+
+void AnimationSystem::init( Allocator* allocator_ ) {
+    allocator = allocator_;
+    poses.init( allocator, 4 );
+}
+
+void AnimationSystem::shutdown() {
+    for ( u32 p = 0; p < poses.size; ++p ) {
+        poses[ p ].shutdown();
+    }
+    poses.shutdown();
+}
+
+u32 AnimationSystem::add_pose( u32 node_offset, u32 node_count, const mat4s* rest_local_matrices, u32 rest_count ) {
+    AnimationPose& pose = poses.push_use();
+    pose = { };
+    pose.init( allocator, node_offset, node_count, rest_local_matrices, rest_count );
+
+    return poses.size - 1;
+}
+
+void AnimationSystem::update( const Animation* animations, f32 delta_time, enki::TaskScheduler* task_scheduler ) {
+    ZoneScoped;
+
+    if ( poses.size == 0 ) {
+        return;
+    }
+
+    update_task.poses = poses.data;
+    update_task.animations = animations;
+    update_task.delta_time = delta_time;
+
+    if ( task_scheduler && poses.size > 1 ) {
+        update_task.m_SetSize = poses.size;
+        update_task.m_MinRange = 16;
+
+        task_scheduler->AddTaskSetToPipe( &update_task );
+        task_scheduler->WaitforTask( &update_task );
+    } else {
+        update_task.ExecuteRange( { 0, poses.size }, 0 );
+    }
+}
+
+// Skinning //////////////////////////////////////////////////////////////
+
+void skinning_compute_palette( const mat4s* world_matrices, const i32* joints, u32 joint_count, u32 node_offset,
+                               const mat4s* inverse_bind_matrices, const mat4s& inverse_mesh_world, mat4s* palette ) {
+    for ( u32 j = 0; j < joint_count; ++j ) {
+        const mat4s& joint_world = world_matrices[ joints[ j ] + node_offset ];
+        palette[ j ] = glms_mat4_mul( glms_mat4_mul( inverse_mesh_world, joint_world ), inverse_bind_matrices[ j ] );
+    }
+}
+
+// Benchmark /////////////////////////////////////////////////////////////
+
+void animation_benchmark_create( Animation& animation, Allocator* allocator, u32 num_joints, u32 num_keys, f32 duration,
+                                 AnimationSampler::Interpolation interpolation, f32 phase ) {
+    // Each sampler drives the same target type of 4 consecutive joints.
+    const u32 samplers_per_type = ( num_joints + k_animation_sampler_lanes - 1 ) / k_animation_sampler_lanes;
+
+    animation.time_start = 0.f;
+    animation.time_end = duration;
+    animation.channels.init( allocator, num_joints * 3, num_joints * 3 );
+    animation.samplers.init( allocator, samplers_per_type * 3, samplers_per_type * 3 );
+
+    for ( u32 type = 0; type < AnimationChannel::Weights; ++type ) {
+        for ( u32 s = 0; s < samplers_per_type; ++s ) {
+            const u32 sampler_index = type * samplers_per_type + s;
+
+            AnimationSampler& sampler = animation.samplers[ sampler_index ];
+            // Scales snap between keys, as step sampled properties do.
+            sampler.interpolation_type = type == AnimationChannel::Scale ? AnimationSampler::Step : interpolation;
+            sampler.key_frames.init( allocator, num_keys, num_keys );
+            sampler.data = ( vec4s* )rallocaa( sizeof( vec4s ) * num_keys * 4 * 3, allocator, 16 );
+            sampler.in_tangents = sampler.data + num_keys * 4;
+            sampler.out_tangents = sampler.data + num_keys * 8;
+            memset( sampler.data, 0, sizeof( vec4s ) * num_keys * 4 * 3 );
+            sampler.lane_count = 0;
+
+            for ( u32 k = 0; k < num_keys; ++k ) {
+                sampler.key_frames[ k ] = duration * k / ( num_keys - 1 );
+            }
+
+            for ( u32 j = s * k_animation_sampler_lanes; j < num_joints && sampler.lane_count < k_animation_sampler_lanes; ++j ) {
+                const u32 lane = sampler.lane_count++;
+                const u32 channel_index = j * 3 + type;
+
+                AnimationChannel& channel = animation.channels[ channel_index ];
+                channel.sampler = sampler_index;
+                channel.target_node = j;
+                channel.target_type = ( AnimationChannel::TargetType )type;
+                sampler.channels[ lane ] = channel_index;
+
+                for ( u32 k = 0; k < num_keys; ++k ) {
+                    const f32 time = sampler.key_frames[ k ];
+                    const f32 angle = sinf( time * 3.f + j * 0.37f + phase );
+
+                    vec4s value;
+                    switch ( type ) {
+                        case AnimationChannel::Translation:
+                            value = vec4s{ angle, cosf( time + j ), 0.1f * j, 0.f };
+                            break;
+                        case AnimationChannel::Rotation:
+                        {
+                            const versors rotation = glms_quatv( angle, glms_vec3_normalize( vec3s{ 1.f, ( f32 )( j % 3 ), 0.5f } ) );
+                            value = vec4s{ rotation.x, rotation.y, rotation.z, rotation.w };
+                            break;
+                        }
+                        default:
+                            value = vec4s{ 1.f + 0.1f * angle, 1.f, 1.f, 0.f };
+                            break;
+                    }
+
+                    for ( u32 c = 0; c < 4; ++c ) {
+                        sampler.data[ k * 4 + c ].raw[ lane ] = value.raw[ c ];
+                    }
+                    sampler.in_tangents[ k * 4 ].raw[ lane ] = 0.1f * angle;
+                    sampler.out_tangents[ k * 4 + 1 ].raw[ lane ] = 0.1f * angle;
+                }
+            }
+        }
+    }
+}
+
+void animation_benchmark_destroy( Animation& animation, Allocator* allocator ) {
+    for ( u32 s = 0; s < animation.samplers.size; ++s ) {
+        animation.samplers[ s ].key_frames.shutdown();
+        rfree( animation.samplers[ s ].data, allocator );
+    }
+    animation.samplers.shutdown();
+    animation.channels.shutdown();
+}
+
+// The evaluation this system replaced: linear scan of the key frames for each channel, linear interpolation only.
+static void benchmark_linear_scan( const Animation& animation, f32 current_time, vec4s* translations, vec4s* rotations, vec4s* scales ) {
+    for ( u32 ac = 0; ac < animation.channels.size; ++ac ) {
+        const AnimationChannel& channel = animation.channels[ ac ];
+        const AnimationSampler& sampler = animation.samplers[ channel.sampler ];
+
+        if ( sampler.interpolation_type != AnimationSampler::Linear ) {
+            continue;
+        }
+
+        u32 lane = 0;
+        while ( sampler.channels[ lane ] != ac ) {
+            ++lane;
+        }
+
+        for ( u32 ki = 0; ki < sampler.key_frames.size - 1; ++ki ) {
+            const f32 keyframe = sampler.key_frames[ ki ];
+            const f32 next_keyframe = sampler.key_frames[ ki + 1 ];
+            if ( current_time >= keyframe && current_time <= next_keyframe ) {
+                const f32 interpolation = ( current_time - keyframe ) / ( next_keyframe - keyframe );
+                const vec4s current_data = sampler.get_value( ki, lane );
+                const vec4s next_data = sampler.get_value( ki + 1, lane );
+
+                if ( channel.target_type == AnimationChannel::Rotation ) {
+                    const versors rotation = glms_quat_normalize( glms_quat_slerp( glms_quat_init( current_data.x, current_data.y, current_data.z, current_data.w ),
+                                                                                   glms_quat_init( next_data.x, next_data.y, next_data.z, next_data.w ), interpolation ) );
+                    rotations[ channel.target_node ] = vec4s{ rotation.x, rotation.y, rotation.z, rotation.w };
+                } else {
+                    vec4s* targets = channel.target_type == AnimationChannel::Translation ? translations : scales;
+                    targets[ channel.target_node ] = glms_vec4_lerp( current_data, next_data, interpolation );
+                }
+                break;
+            }
+        }
+    }
+}
+
+static f32 benchmark_max_translation_difference( const AnimationSystem& system, const vec4s* scan_transforms ) {
+    f32 max_difference = 0.f;
+    for ( u32 p = 0; p < system.poses.size; ++p ) {
+        const AnimationPose& pose = system.poses[ p ];
+        const vec4s* scan_translations = scan_transforms + p * pose.node_count * 3;
+        for ( u32 n = 0; n < pose.node_count; ++n ) {
+            for ( u32 c = 0; c < 3; ++c ) {
+                max_difference = glm_max( max_difference, fabsf( pose.translations[ n ].raw[ c ] - scan_translations[ n ].raw[ c ] ) );
+            }
+        }
+    }
+    return max_difference;
+}
+
+void animation_benchmark( Allocator* allocator, enki::TaskScheduler* task_scheduler, u32 num_characters ) {
+    const u32 num_joints = 64;
+    const u32 num_frames = 120;
+    const f32 delta_time = 1.f / 60.f;
+
+    // A walk sampled at 30 fps and a cubic spline run, blended on half of the characters.
+    Animation animations[ 2 ];
+    animation_benchmark_create( animations[ 0 ], allocator, num_joints, 61, 2.f, AnimationSampler::Linear, 0.f );
+    animation_benchmark_create( animations[ 1 ], allocator, num_joints, 31, 1.5f, AnimationSampler::CubicSpline, 1.f );
+
+    const u32 num_threads = task_scheduler ? task_scheduler->GetNumTaskThreads() : 1;
+    rprint( "Animation benchmark: %u characters, %u joints, %u frames, %u threads.\n", num_characters, num_joints, num_frames, num_threads );
+
+    // Previous evaluation, single linear animation.
+    vec4s* scan_transforms = ( vec4s* )rallocaa( sizeof( vec4s ) * num_joints * 3 * num_characters, allocator, 16 );
+    f32* scan_times = ( f32* )ralloca( sizeof( f32 ) * num_characters, allocator );
+    for ( u32 c = 0; c < num_characters; ++c ) {
+        scan_times[ c ] = fmodf( c * 0.013f, animations[ 0 ].time_end );
+    }
+
+    i64 start = time_now();
+    for ( u32 f = 0; f < num_frames; ++f ) {
+        for ( u32 c = 0; c < num_characters; ++c ) {
+            scan_times[ c ] += delta_time;
+            if ( scan_times[ c ] > animations[ 0 ].time_end ) {
+                scan_times[ c ] -= animations[ 0 ].time_end;
+            }
+
+            vec4s* transforms = scan_transforms + c * num_joints * 3;
+            benchmark_linear_scan( animations[ 0 ], scan_times[ c ], transforms, transforms + num_joints, transforms + num_joints * 2 );
+        }
+    }
+    const f64 scan_ms = time_from_milliseconds( start );
+
+    // Same single animation, then blended, serially and in parallel.
+    f64 timings_ms[ 2 ][ 2 ];
+    bool results_match[ 2 ];
+    f32 scan_difference = 0.f;
+
+    for ( u32 blended = 0; blended < 2; ++blended ) {
+        AnimationSystem systems[ 2 ];
+
+        for ( u32 s = 0; s < 2; ++s ) {
+            systems[ s ].init( allocator );
+
+            for ( u32 c = 0; c < num_characters; ++c ) {
+                AnimationPose& pose = systems[ s ].poses[ systems[ s ].add_pose( 0, num_joints, nullptr, 0 ) ];
+                AnimationInstance& walk = pose.instances[ pose.add_instance( animations[ 0 ], 0, 1.f, 1.f ) ];
+                walk.current_time = fmodf( c * 0.013f, animations[ 0 ].time_end );
+
+                if ( blended && ( c & 1 ) ) {
+                    pose.add_instance( animations[ 1 ], 1, 0.5f, 1.2f );
+                }
+            }
+
+            start = time_now();
+            for ( u32 f = 0; f < num_frames; ++f ) {
+                systems[ s ].update( animations, delta_time, s ? task_scheduler : nullptr );
+            }
+            timings_ms[ blended ][ s ] = time_from_milliseconds( start );
+        }
+
+        results_match[ blended ] = true;
+        for ( u32 p = 0; p < num_characters; ++p ) {
+            const AnimationPose& serial_pose = systems[ 0 ].poses[ p ];
+            const AnimationPose& parallel_pose = systems[ 1 ].poses[ p ];
+            if ( memcmp( serial_pose.translations, parallel_pose.translations, sizeof( vec4s ) * num_joints * 3 ) != 0 ) {
+                results_match[ blended ] = false;
+            }
+        }
+
+        if ( !blended ) {
+            scan_difference = benchmark_max_translation_difference( systems[ 0 ], scan_transforms );
+        }
+
+        systems[ 0 ].shutdown();
+        systems[ 1 ].shutdown();
+    }
+
+    rprint( "Linear scan %8.2f ms | one linear animation\n", scan_ms );
+    rprint( "Serial      %8.2f ms | one animation, %.2fx, max translation difference %f\n", timings_ms[ 0 ][ 0 ], scan_ms / timings_ms[ 0 ][ 0 ], scan_difference );
+    rprint( "Parallel    %8.2f ms | one animation, %.2fx, %s\n", timings_ms[ 0 ][ 1 ], scan_ms / timings_ms[ 0 ][ 1 ], results_match[ 0 ] ? "match" : "MISMATCH" );
+    rprint( "Serial      %8.2f ms | linear and cubic spline blend\n", timings_ms[ 1 ][ 0 ] );
+    rprint( "Parallel    %8.2f ms | linear and cubic spline blend, %.2fx, %s\n", timings_ms[ 1 ][ 1 ], timings_ms[ 1 ][ 0 ] / timings_ms[ 1 ][ 1 ], results_match[ 1 ] ? "match" : "MISMATCH" );
+
+    rfree( scan_times, allocator );
+    rfree( scan_transforms, allocator );
+
+    animation_benchmark_destroy( animations[ 0 ], allocator );
+    animation_benchmark_destroy( animations[ 1 ], allocator );
+}
+
+void skinning_benchmark( Allocator* allocator ) {
+    static const u32 k_joint_counts[] = { 16, 64, 256, 1024, 4096 };
+    const u32 num_frames = 50;
+    // Chains of up to 64 joints hang from the root, scene graph levels are limited to 127.
+    const u32 chain_length = 64;
+
+    rprint( "Skinning benchmark: chains of %u joints, %u frames.\n", chain_length, num_frames );
+
+    for ( u32 c = 0; c < ArraySize( k_joint_counts ); ++c ) {
+        const u32 joint_count = k_joint_counts[ c ];
+
+        SceneGraph scene_graph;
+        scene_graph.init( allocator, joint_count );
+        scene_graph.resize( joint_count );
+        scene_graph.init_new_nodes( 0, joint_count );
+
+        AnimationPose pose;
+        pose.init( allocator, 0, joint_count, nullptr, 0 );
+
+        i32* joints = ( i32* )ralloca( sizeof( i32 ) * joint_count, allocator );
+        mat4s* matrices = ( mat4s* )rallocaa( sizeof( mat4s ) * joint_count * 3, allocator, 16 );
+        mat4s* inverse_bind_matrices = matrices;
+        mat4s* walk_palette = matrices + joint_count;
+        mat4s* palette = matrices + joint_count * 2;
+
+        for ( u32 j = 0; j < joint_count; ++j ) {
+            if ( j > 0 ) {
+                // The first chain starts at the root, the others hang from it.
+                const u32 chain_index = j % chain_length;
+                const u32 level = j < chain_length ? chain_index : chain_index + 1;
+                scene_graph.set_hierarchy( j, chain_index ? j - 1 : 0, level );
+            }
+            joints[ j ] = j;
+
+            const versors rotation = glms_quatv( 0.01f * ( j % 7 ), vec3s{ 0.f, 0.f, 1.f } );
+            pose.translations[ j ] = vec4s{ 0.f, 0.01f, 0.f, 0.f };
+            pose.rotations[ j ] = vec4s{ rotation.x, rotation.y, rotation.z, rotation.w };
+            inverse_bind_matrices[ j ] = glms_translate_make( vec3s{ 0.f, -0.01f * j, 0.f } );
+        }
+
+        // Previous joints update: local matrices recomposed along the parent chain of every joint.
+        i64 start = time_now();
+        for ( u32 f = 0; f < num_frames; ++f ) {
+            for ( u32 j = 0; j < joint_count; ++j ) {
+                mat4s node_transform = pose.get_local_matrix( j );
+
+                i32 parent = scene_graph.nodes_hierarchy[ j ].parent;
+                while ( parent >= 0 ) {
+                    node_transform = glms_mat4_mul( pose.get_local_matrix( parent ), node_transform );
+                    parent = scene_graph.nodes_hierarchy[ parent ].parent;
+                }
+
+                walk_palette[ j ] = glms_mat4_mul( node_transform, inverse_bind_matrices[ j ] );
+            }
+        }
+        const f64 walk_ms = time_from_milliseconds( start ) / num_frames;
+
+        // Scene graph update, then a single pass on its world matrices.
+        f64 scene_graph_ms = 0.0;
+        f64 palette_ms = 0.0;
+        const mat4s identity = glms_mat4_identity();
+        for ( u32 f = 0; f < num_frames; ++f ) {
+            start = time_now();
+            for ( u32 j = 0; j < joint_count; ++j ) {
+                scene_graph.set_local_matrix( j, pose.get_local_matrix( j ) );
+            }
+            scene_graph.update_matrices();
+            scene_graph_ms += time_from_milliseconds( start );
+
+            start = time_now();
+            skinning_compute_palette( scene_graph.world_matrices.data, joints, joint_count, 0, inverse_bind_matrices, identity, palette );
+            palette_ms += time_from_milliseconds( start );
+        }
+        scene_graph_ms /= num_frames;
+        palette_ms /= num_frames;
+
+        f32 max_difference = 0.f;
+        for ( u32 j = 0; j < joint_count; ++j ) {
+            for ( u32 e = 0; e < 16; ++e ) {
+                max_difference = glm_max( max_difference, fabsf( walk_palette[ j ].raw[ e / 4 ][ e % 4 ] - palette[ j ].raw[ e / 4 ][ e % 4 ] ) );
+            }
+        }
+
+        rprint( "%5u joints | parent walk %9.4f ms | scene graph %9.4f ms, palette %8.4f ms (%6.2f ns per joint) | max difference %f\n",
+                joint_count, walk_ms, scene_graph_ms, palette_ms, palette_ms * 1000000.0 / joint_count, max_difference );
+
+        rfree( matrices, allocator );
+        rfree( joints, allocator );
+        pose.shutdown();
+        scene_graph.shutdown();
+    }
+}
+
+} // namespace raptor
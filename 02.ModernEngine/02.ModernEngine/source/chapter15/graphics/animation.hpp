@@ -0,0 +1,165 @@
+#pragma once
+
+#include "foundation/array.hpp"
+
+#include "external/cglm/types-struct.h"
+
+#include "external/enkiTS/TaskScheduler.h"
+
+namespace raptor {
+
+    struct Allocator;
+    struct SceneGraph;
+
+    // Animation structs //////////////////////////////////////////////////
+    //
+    //
+    struct AnimationChannel {
+
+        enum TargetType {
+            Translation, Rotation, Scale, Weights, Count
+        };
+
+        i32                     sampler;
+        i32                     target_node;
+        TargetType              target_type;
+
+    }; // struct AnimationChannel
+
+    static const u32            k_animation_sampler_lanes = 4;
+
+    //
+    // Samples up to 4 channels sharing key frames and interpolation, one channel per SIMD lane.
+    // Values are SoA: component c of key k is the vec4 at k * 4 + c, holding that component for each lane.
+    // Tangents are only allocated for CubicSpline samplers.
+    struct AnimationSampler {
+
+        enum Interpolation {
+            Linear, Step, CubicSpline, Count
+        };
+
+        // Value of a lane, gathered back to a vec4.
+        vec4s                   get_value( u32 key, u32 lane ) const;
+
+        Array<f32>              key_frames;
+        vec4s*                  data;           // Aligned-allocated data, key_frames.size * 4 vec4s.
+        vec4s*                  in_tangents;
+        vec4s*                  out_tangents;
+        Interpolation           interpolation_type;
+
+        u32                     channels[ k_animation_sampler_lanes ];  // Channel index of each lane.
+        u32                     lane_count;
+
+    }; // struct AnimationSampler
+
+    //
+    // Samplers group the channels that can be sampled together, channels index the sampler holding their lane.
+    struct Animation {
+
+        f32                     time_start;
+        f32                     time_end;
+
+        Array<AnimationChannel> channels;
+        Array<AnimationSampler> samplers;
+
+    }; // struct Animation
+
+    //
+    // Playing animation. Key cursors cache the last key frame of each sampler, so that
+    // forward playback does not search.
+    struct AnimationInstance {
+        u32                     animation;      // Index in the animations given to the update.
+        f32                     current_time;
+        f32                     weight;
+        f32                     speed;
+        u32*                    key_cursors;
+    }; // struct AnimationInstance
+
+    //
+    // Local transforms of a node range, driven by a list of blended instances.
+    // Targets without channels keep the rest transform, decomposed from the node local matrix.
+    struct AnimationPose {
+
+        // Rest matrices past rest_count, or when null, are identities.
+        void                    init( Allocator* allocator, u32 node_offset, u32 node_count, const mat4s* rest_local_matrices, u32 rest_count );
+        void                    shutdown();
+
+        u32                     add_instance( const Animation& animation, u32 animation_index, f32 weight, f32 speed );
+
+        // Advances the instances and blends them. Per node and target, total weights above 1 are normalized
+        // and the rest transform makes up for totals below 1.
+        void                    evaluate( const Animation* animations, f32 delta_time );
+
+        // Node index is relative to the node offset.
+        mat4s                   get_local_matrix( u32 node_index ) const;
+        // Only animated nodes are written, so that they are the only ones updated.
+        void                    write_local_matrices( SceneGraph* scene_graph ) const;
+
+        // SoA transforms, rotations are quaternions and w is unused for translations and scales.
+        vec4s*                  translations    = nullptr;
+        vec4s*                  rotations       = nullptr;
+        vec4s*                  scales          = nullptr;
+        vec4s*                  rest_translations = nullptr;
+        vec4s*                  rest_rotations  = nullptr;
+        vec4s*                  rest_scales     = nullptr;
+        f32*                    weights         = nullptr;  // Accumulated weight per node and target type.
+
+        Array<AnimationInstance> instances;
+
+        Allocator*              allocator       = nullptr;
+        u32                     node_offset     = 0;        // First scene graph node of the pose.
+        u32                     node_count      = 0;
+
+    }; // struct AnimationPose
+
+    //
+    //
+    struct AnimationUpdateTask : public enki::ITaskSet {
+
+        void                    ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) override;
+
+        AnimationPose*          poses           = nullptr;
+        const Animation*        animations      = nullptr;
+        f32                     delta_time      = 0.f;
+
+    }; // struct AnimationUpdateTask
+
+    //
+    // Poses are independent and evaluated in parallel, instances of a pose are evaluated in order.
+    struct AnimationSystem {
+
+        void                    init( Allocator* allocator );
+        void                    shutdown();
+
+        u32                     add_pose( u32 node_offset, u32 node_count, const mat4s* rest_local_matrices, u32 rest_count );
+
+        // Serial when the task scheduler is null.
+        void                    update( const Animation* animations, f32 delta_time, enki::TaskScheduler* task_scheduler );
+
+        Array<AnimationPose>    poses;
+        AnimationUpdateTask     update_task;
+
+        Allocator*              allocator       = nullptr;
+
+    }; // struct AnimationSystem
+
+    // Skinning ///////////////////////////////////////////////////////////
+
+    // Joint matrices from world matrices already updated level by level, one multiply chain per joint.
+    // The mesh world is removed, as draws apply it: inverse mesh world * joint world * inverse bind matrix.
+    void                        skinning_compute_palette( const mat4s* world_matrices, const i32* joints, u32 joint_count, u32 node_offset,
+                                                          const mat4s* inverse_bind_matrices, const mat4s& inverse_mesh_world, mat4s* palette );
+
+    // Generated joint animation for benchmarks: sine driven translations and rotations, step scales.
+    void                        animation_benchmark_create( Animation& animation, Allocator* allocator, u32 num_joints, u32 num_keys, f32 duration,
+                                                            AnimationSampler::Interpolation interpolation, f32 phase );
+    void                        animation_benchmark_destroy( Animation& animation, Allocator* allocator );
+
+    // Evaluates thousands of characters blending generated animations, against the previous linear
+    // key frame scan, serially and on the task scheduler.
+    void                        animation_benchmark( Allocator* allocator, enki::TaskScheduler* task_scheduler, u32 num_characters );
+
+    // Per frame cost of joint palettes for growing joint chains, against walking the parents of each joint.
+    void                        skinning_benchmark( Allocator* allocator );
+
+} // namespace raptor
@@ -1,14 +1,127 @@
 #include "graphics/asynchronous_loader.hpp"
 #include "graphics/renderer.hpp"
+#include "graphics/texture_cooker.hpp"
 
 #include "foundation/time.hpp"
 
 #include "external/stb_image.h"
+#include "external/imgui/imgui.h"
 
 #include "external/tracy/tracy/Tracy.hpp"
 
 namespace raptor
 {
+static const u32        k_texture_channels      = 4;
+static const sizet      k_texture_alignment     = 4;
+static const sizet      k_block_compressed_alignment = 16;
+static const sizet      k_buffer_alignment      = 64;
+// Must stay below the size of Renderer::textures_to_update.
+static const u32        k_max_textures_per_submission = 32;
+
+// StagingRing ////////////////////////////////////////////////////////////
+
+void StagingRing::init( sizet size ) {
+    capacity = size;
+    head = 0;
+    tail = 0;
+    used = 0;
+}
+
+bool StagingRing::allocate( sizet size, sizet alignment, sizet& out_offset ) {
+    if ( used == 0 ) {
+        head = tail = 0;
+    }
+    else if ( head == tail ) {
+        // Full
+        return false;
+    }
+
+    const sizet offset = memory_align( head, alignment );
+    if ( head > tail || used == 0 ) {
+        // Free space is [head, capacity) followed by [0, tail).
+        if ( offset + size <= capacity ) {
+            used += offset + size - head;
+            head = offset + size;
+            out_offset = offset;
+            return true;
+        }
+        // Wrap around, the end of the buffer is wasted until this allocation is released.
+        if ( size <= tail ) {
+            used += ( capacity - head ) + size;
+            head = size;
+            out_offset = 0;
+            return true;
+        }
+        return false;
+    }
+
+    // Free space is [head, tail).
+    if ( offset + size <= tail ) {
+        used += offset + size - head;
+        head = offset + size;
+        out_offset = offset;
+        return true;
+    }
+    return false;
+}
+
+void StagingRing::release( sizet end_offset, sizet size ) {
+    RASSERT( size <= used );
+    used -= size;
+    tail = end_offset;
+
+    if ( used == 0 ) {
+        head = tail = 0;
+    }
+}
+
+// TextureDecodeTask //////////////////////////////////////////////////////
+
+void TextureDecodeTask::ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) {
+    ZoneScoped;
+
+    for ( u32 i = range_.start; i < range_.end; ++i ) {
+        const FileLoadRequest& load_request = requests[ i ];
+        UploadRequest& result = results[ i ];
+
+        i64 start_reading_file = time_now();
+
+        // Cooked textures only have their header read here, levels are streamed to the staging buffer.
+        const sizet path_length = strlen( load_request.path );
+        result.cooked = false;
+        if ( load_request.data ) {
+            int x, y, comp;
+            result.data = stbi_load_from_memory( ( const stbi_uc* )load_request.data, load_request.data_size, &x, &y, &comp, k_texture_channels );
+        }
+        else if ( path_length > 5 && strcmp( load_request.path + path_length - 5, ".ktx2" ) == 0 ) {
+            CookedTextureStream* stream = ( CookedTextureStream* )malloc( sizeof( CookedTextureStream ) );
+            snprintf( stream->path, ArraySize( stream->path ), "%s", load_request.path );
+            if ( ktx2_read_info( stream->path, stream->info ) ) {
+                result.data = stream;
+                result.cooked = true;
+            }
+            else {
+                free( stream );
+                result.data = nullptr;
+            }
+        }
+        else {
+            int x, y, comp;
+            result.data = stbi_load( load_request.path, &x, &y, &comp, k_texture_channels );
+        }
+        result.texture = load_request.texture;
+        result.cpu_buffer = k_invalid_buffer;
+        result.gpu_buffer = k_invalid_buffer;
+
+        if ( result.data ) {
+            rprint( "File %s read in %f ms\n", load_request.path, time_from_milliseconds( start_reading_file ) );
+        }
+        else {
+            rprint( "Error reading file %s\n", load_request.path );
+        }
+    }
+}
+
 // AsynchonousLoader //////////////////////////////////////////////////////
 
 void AsynchronousLoader::init( Renderer* renderer_, enki::TaskScheduler* task_scheduler_, Allocator* resident_allocator ) {
@@ -18,10 +131,13 @@ void AsynchronousLoader::init( Renderer* renderer_, enki::TaskScheduler* task_sc
 
     file_load_requests.init( allocator, 16 );
     upload_requests.init( allocator, 16 );
+    pending_file_loads.init( allocator, 16 );
+    pending_uploads.init( allocator, 16 );
 
-    texture_ready.index = k_invalid_texture.index;
-    cpu_buffer_ready.index = k_invalid_buffer.index;
-    gpu_buffer_ready.index = k_invalid_buffer.index;
+    outstanding_requests = 0;
+    decode_count = 0;
+    decode_task.requests = decode_requests;
+    decode_task.results = decode_results;
 
     using namespace raptor;
 
@@ -31,204 +147,449 @@ void AsynchronousLoader::init( Renderer* renderer_, enki::TaskScheduler* task_sc
     BufferHandle staging_buffer_handle = renderer->gpu->create_buffer( bc );
 
     staging_buffer = renderer->gpu->access_buffer( staging_buffer_handle );
+    staging_ring.init( staging_buffer->size );
 
-    staging_buffer_offset = 0;
+    for ( u32 i = 0; i < k_max_transfer_submissions; ++i ) {
+        TransferSubmission& submission = submissions[ i ];
 
-    for ( u32 i = 0; i < k_max_frames; ++i) {
         VkCommandPoolCreateInfo cmd_pool_info = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO, nullptr };
         cmd_pool_info.queueFamilyIndex = renderer->gpu->vulkan_transfer_queue_family;
         cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-        vkCreateCommandPool( renderer->gpu->vulkan_device, &cmd_pool_info, renderer->gpu->vulkan_allocation_callbacks, &command_pools[i]);
+        vkCreateCommandPool( renderer->gpu->vulkan_device, &cmd_pool_info, renderer->gpu->vulkan_allocation_callbacks, &submission.command_pool );
 
         VkCommandBufferAllocateInfo cmd = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, nullptr };
-        cmd.commandPool = command_pools[i];
+        cmd.commandPool = submission.command_pool;
         cmd.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
         cmd.commandBufferCount = 1;
 
-        vkAllocateCommandBuffers( renderer->gpu->vulkan_device, &cmd, &command_buffers[i].vk_command_buffer );
+        vkAllocateCommandBuffers( renderer->gpu->vulkan_device, &cmd, &submission.command_buffer.vk_command_buffer );
 
-        command_buffers[ i ].is_recording = false;
-        command_buffers[ i ].gpu_device = ( renderer->gpu );
-    }
+        submission.command_buffer.is_recording = false;
+        submission.command_buffer.gpu_device = ( renderer->gpu );
 
-    VkSemaphoreCreateInfo semaphore_info{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
-    vkCreateSemaphore( renderer->gpu->vulkan_device, &semaphore_info, renderer->gpu->vulkan_allocation_callbacks, &transfer_complete_semaphore );
+        VkFenceCreateInfo fence_info{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+        vkCreateFence( renderer->gpu->vulkan_device, &fence_info, renderer->gpu->vulkan_allocation_callbacks, &submission.fence );
 
-    VkFenceCreateInfo fence_info{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
-    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    vkCreateFence( renderer->gpu->vulkan_device, &fence_info, renderer->gpu->vulkan_allocation_callbacks, &transfer_fence );
+        submission.textures.init( allocator, 16 );
+        submission.cpu_buffers.init( allocator, 16 );
+        submission.gpu_buffers.init( allocator, 16 );
+        submission.in_flight = false;
+    }
+    oldest_submission = 0;
+    submissions_in_flight = 0;
+
+    stats = AsynchronousLoaderStats{};
+    published_stats = stats;
+    stats_window_start = time_now();
+    stats_window_bytes = 0;
+    stats_window_textures = 0;
+    total_latency_ms = 0.0;
 }
 
 void AsynchronousLoader::shutdown() {
 
+    // The task scheduler has been shut down, so any decode batch has completed.
+    for ( u32 i = 0; i < decode_count; ++i ) {
+        free( decode_results[ i ].data );
+    }
+    decode_count = 0;
+
+    for ( u32 i = 0; i < pending_uploads.size; ++i ) {
+        free( pending_uploads[ i ].data );
+    }
+    for ( u32 i = 0; i < upload_requests.size; ++i ) {
+        free( upload_requests[ i ].data );
+    }
+
+    for ( u32 i = 0; i < k_max_transfer_submissions; ++i ) {
+        TransferSubmission& submission = submissions[ i ];
+        if ( submission.in_flight ) {
+            vkWaitForFences( renderer->gpu->vulkan_device, 1, &submission.fence, VK_TRUE, UINT64_MAX );
+        }
+
+        vkDestroyCommandPool( renderer->gpu->vulkan_device, submission.command_pool, renderer->gpu->vulkan_allocation_callbacks );
+        // Command buffers are destroyed with the pool associated.
+        vkDestroyFence( renderer->gpu->vulkan_device, submission.fence, renderer->gpu->vulkan_allocation_callbacks );
+
+        submission.textures.shutdown();
+        submission.cpu_buffers.shutdown();
+        submission.gpu_buffers.shutdown();
+    }
+
     renderer->gpu->destroy_buffer( staging_buffer->handle );
 
     file_load_requests.shutdown();
     upload_requests.shutdown();
+    pending_file_loads.shutdown();
+    pending_uploads.shutdown();
+}
 
-    for ( u32 i = 0; i < k_max_frames; ++i ) {
-        vkDestroyCommandPool( renderer->gpu->vulkan_device, command_pools[ i ], renderer->gpu->vulkan_allocation_callbacks );
-        // Command buffers are destroyed with the pool associated.
+void AsynchronousLoader::update( Allocator* scratch_allocator ) {
+    // Requests move through these states:
+    // file request -> decoding on worker threads -> pending upload -> packed in a transfer submission -> ready.
+    retire_submissions();
+    gather_decoded_files();
+
+    // Drain the requests added from other threads.
+    {
+        std::lock_guard<std::mutex> guard( request_mutex );
+        for ( u32 i = 0; i < file_load_requests.size; ++i ) {
+            pending_file_loads.push( file_load_requests[ i ] );
+        }
+        file_load_requests.clear();
+
+        for ( u32 i = 0; i < upload_requests.size; ++i ) {
+            pending_uploads.push( upload_requests[ i ] );
+        }
+        upload_requests.clear();
     }
 
-    vkDestroySemaphore( renderer->gpu->vulkan_device, transfer_complete_semaphore, renderer->gpu->vulkan_allocation_callbacks );
-    vkDestroyFence( renderer->gpu->vulkan_device, transfer_fence, renderer->gpu->vulkan_allocation_callbacks );
+    start_file_decodes();
+    submit_uploads();
+    update_stats();
 }
 
-void AsynchronousLoader::update( Allocator* scratch_allocator ) {
-    using namespace raptor;
+void AsynchronousLoader::retire_submissions() {
+    // Submissions on the same queue complete in order, retire from the oldest.
+    while ( submissions_in_flight ) {
+        TransferSubmission& submission = submissions[ oldest_submission ];
+        if ( vkGetFenceStatus( renderer->gpu->vulkan_device, submission.fence ) != VK_SUCCESS ) {
+            break;
+        }
+
+        // Textures are retired together with their submission, wait for the renderer to consume previous ones.
+        if ( submission.textures.size > renderer->get_free_texture_update_slots() ) {
+            break;
+        }
+
+        ZoneScoped;
 
-    // If a texture was processed in the previous commands, signal the renderer
-    if ( texture_ready.index != k_invalid_texture.index ) {
-        // Add update request.
+        // Textures still need the queue ownership acquire on the main queue.
         // This method is multithreaded_safe
-        renderer->add_texture_to_update( texture_ready );
+        for ( u32 i = 0; i < submission.textures.size; ++i ) {
+            renderer->add_texture_to_update( submission.textures[ i ] );
+        }
+
+        for ( u32 i = 0; i < submission.cpu_buffers.size; ++i ) {
+            renderer->gpu->destroy_buffer( submission.cpu_buffers[ i ] );
+        }
+
+        for ( u32 i = 0; i < submission.gpu_buffers.size; ++i ) {
+            Buffer* buffer = renderer->gpu->access_buffer( submission.gpu_buffers[ i ] );
+            buffer->ready = true;
+        }
+
+        staging_ring.release( submission.staging_end, submission.staging_size );
+
+        const u32 completed = submission.textures.size + submission.gpu_buffers.size;
+        outstanding_requests -= completed;
+
+        stats.textures_uploaded += submission.textures.size;
+        stats.buffers_uploaded += submission.gpu_buffers.size;
+        stats.bytes_uploaded += submission.bytes;
+        stats_window_bytes += submission.bytes;
+        stats_window_textures += submission.textures.size;
+        total_latency_ms += time_from_milliseconds( submission.submit_time );
+
+        submission.textures.clear();
+        submission.cpu_buffers.clear();
+        submission.gpu_buffers.clear();
+        submission.in_flight = false;
+
+        oldest_submission = ( oldest_submission + 1 ) % k_max_transfer_submissions;
+        --submissions_in_flight;
     }
+}
 
-    if ( cpu_buffer_ready.index != k_invalid_buffer.index && gpu_buffer_ready.index != k_invalid_buffer.index ) {
-        // TODO(marco): free cpu buffer
-        renderer->gpu->destroy_buffer( cpu_buffer_ready );
+void AsynchronousLoader::gather_decoded_files() {
+    if ( decode_count == 0 || !decode_task.GetIsComplete() ) {
+        return;
+    }
 
-        Buffer* buffer = renderer->gpu->access_buffer( gpu_buffer_ready );
-        buffer->ready = true;
+    for ( u32 i = 0; i < decode_count; ++i ) {
+        if ( decode_results[ i ].data ) {
+            pending_uploads.push( decode_results[ i ] );
+        }
+        else {
+            --outstanding_requests;
+        }
+    }
+    decode_count = 0;
+}
 
-        gpu_buffer_ready.index = k_invalid_buffer.index;
-        cpu_buffer_ready.index = k_invalid_buffer.index;
+void AsynchronousLoader::start_file_decodes() {
+    if ( decode_count || pending_file_loads.size == 0 ) {
+        return;
     }
 
-    texture_ready.index = k_invalid_texture.index;
+    // Take the oldest requests first.
+    decode_count = pending_file_loads.size < k_max_decodes_per_batch ? pending_file_loads.size : k_max_decodes_per_batch;
+    memcpy( decode_requests, pending_file_loads.data, sizeof( FileLoadRequest ) * decode_count );
 
-    // Process upload requests
-    if ( upload_requests.size ) {
-        ZoneScoped;
+    const u32 remaining = pending_file_loads.size - decode_count;
+    memmove( pending_file_loads.data, pending_file_loads.data + decode_count, sizeof( FileLoadRequest ) * remaining );
+    pending_file_loads.set_size( remaining );
 
-        // Wait for transfer fence to be finished
-        if ( vkGetFenceStatus( renderer->gpu->vulkan_device, transfer_fence ) != VK_SUCCESS ) {
-            return;
-        }
-        // Reset if file requests are present.
-        vkResetFences( renderer->gpu->vulkan_device, 1, &transfer_fence );
+    decode_task.m_SetSize = decode_count;
+    task_scheduler->AddTaskSetToPipe( &decode_task );
+}
 
-        // Get last request
-        UploadRequest request = upload_requests.back();
-        upload_requests.pop();
+void AsynchronousLoader::submit_uploads() {
+    if ( pending_uploads.size == 0 || submissions_in_flight == k_max_transfer_submissions ) {
+        return;
+    }
 
-        CommandBuffer* cb = &command_buffers[ renderer->gpu->current_frame ];
-        cb->begin();
+    ZoneScoped;
 
-        if ( request.texture.index != k_invalid_texture.index ) {
-            Texture* texture = renderer->gpu->access_texture( request.texture );
-            const u32 k_texture_channels = 4;
-            const u32 k_texture_alignment = 4;
-            const sizet aligned_image_size = memory_align( texture->width * texture->height * k_texture_channels, k_texture_alignment );
-            // Request place in buffer
-            const sizet current_offset = std::atomic_fetch_add( &staging_buffer_offset, aligned_image_size );
+    TransferSubmission& submission = submissions[ ( oldest_submission + submissions_in_flight ) % k_max_transfer_submissions ];
+    CommandBuffer* cb = &submission.command_buffer;
+    cb->begin();
 
-            cb->upload_texture_data( texture->handle, request.data, staging_buffer->handle, current_offset );
+    const sizet staging_used = staging_ring.used;
+    submission.bytes = 0;
 
-            free( request.data );
+    // Pack as many requests as the staging ring can hold, oldest first.
+    u32 recorded = 0;
+    for ( ; recorded < pending_uploads.size; ++recorded ) {
+        if ( !record_upload( submission, pending_uploads[ recorded ] ) ) {
+            break;
         }
-        else if ( request.cpu_buffer.index != k_invalid_buffer.index && request.gpu_buffer.index != k_invalid_buffer.index ) {
-            Buffer* src = renderer->gpu->access_buffer( request.cpu_buffer );
-            Buffer* dst = renderer->gpu->access_buffer( request.gpu_buffer );
+    }
+
+    const u32 remaining = pending_uploads.size - recorded;
+    memmove( pending_uploads.data, pending_uploads.data + recorded, sizeof( UploadRequest ) * remaining );
+    pending_uploads.set_size( remaining );
+
+    cb->end();
 
-            cb->upload_buffer_data( src->handle, dst->handle );
+    // Staging space of failed reads is still released by an empty submission.
+    if ( submission.textures.size == 0 && submission.gpu_buffers.size == 0 && staging_ring.used == staging_used ) {
+        // Staging ring is full, wait for older submissions to retire.
+        return;
+    }
+
+    submission.staging_end = staging_ring.head;
+    submission.staging_size = staging_ring.used - staging_used;
+    submission.submit_time = time_now();
+    submission.in_flight = true;
+
+    VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cb->vk_command_buffer;
+
+    vkResetFences( renderer->gpu->vulkan_device, 1, &submission.fence );
+
+    VkQueue used_queue = renderer->gpu->vulkan_transfer_queue;
+    vkQueueSubmit( used_queue, 1, &submitInfo, submission.fence );
+
+    ++submissions_in_flight;
+    ++stats.submissions;
+}
+
+bool AsynchronousLoader::record_upload( TransferSubmission& submission, const UploadRequest& request ) {
+    CommandBuffer* cb = &submission.command_buffer;
+
+    if ( request.texture.index != k_invalid_texture.index ) {
+        Texture* texture = renderer->gpu->access_texture( request.texture );
+        const bool block_compressed = TextureFormat::is_block_compressed( texture->vk_format );
+        const sizet image_size = block_compressed ? TextureFormat::block_compressed_size( texture->vk_format, texture->width, texture->height, texture->mip_level_count )
+                                                  : texture->width * texture->height * k_texture_channels;
+
+        if ( submission.textures.size == k_max_textures_per_submission ) {
+            return false;
         }
-        else if ( request.cpu_buffer.index != k_invalid_buffer.index ) {
-            Buffer* buffer = renderer->gpu->access_buffer( request.cpu_buffer );
-            // TODO: proper alignment
-            const sizet aligned_image_size = memory_align( buffer->size, 64 );
-            const sizet current_offset = std::atomic_fetch_add( &staging_buffer_offset, aligned_image_size );
-            cb->upload_buffer_data( buffer->handle, request.data, staging_buffer->handle, current_offset );
 
+        if ( image_size > staging_ring.capacity ) {
+            rprint( "Texture %s does not fit in the staging buffer, skipping upload.\n", texture->name );
             free( request.data );
+            --outstanding_requests;
+            return true;
         }
 
-        cb->end();
+        if ( request.cooked ) {
+            const Ktx2Info& info = ( ( CookedTextureStream* )request.data )->info;
+            sizet cooked_size = 0;
+            for ( u32 level = 0; level < info.level_count; ++level ) {
+                cooked_size += info.level_sizes[ level ];
+            }
+
+            if ( cooked_size != image_size ) {
+                rprint( "Cooked texture %s does not match its texture, skipping upload.\n", texture->name );
+                free( request.data );
+                --outstanding_requests;
+                return true;
+            }
+        }
 
-        VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &cb->vk_command_buffer;
-        VkPipelineStageFlags wait_flag[] { VK_PIPELINE_STAGE_TRANSFER_BIT };
-        VkSemaphore wait_semaphore[] { transfer_complete_semaphore };
-        submitInfo.pWaitSemaphores = wait_semaphore;
-        submitInfo.pWaitDstStageMask = wait_flag;
+        sizet offset;
+        if ( !staging_ring.allocate( image_size, block_compressed ? k_block_compressed_alignment : k_texture_alignment, offset ) ) {
+            return false;
+        }
 
-        VkQueue used_queue = renderer->gpu->vulkan_transfer_queue;
-        vkQueueSubmit( used_queue, 1, &submitInfo, transfer_fence );
+        if ( request.cooked ) {
+            // Levels go from the file to the staging buffer without an intermediate copy.
+            CookedTextureStream* stream = ( CookedTextureStream* )request.data;
+            const bool levels_read = texture_read_cooked_levels( stream->path, stream->info, staging_buffer->mapped_data + offset );
+            free( request.data );
 
-        // TODO(marco): better management for state machine. We need to account for file -> buffer,
-        // buffer -> texture and buffer -> buffer. One the CPU buffer has been used it should be freed.
-        if ( request.texture.index != k_invalid_index ) {
-            RASSERT( texture_ready.index == k_invalid_texture.index );
-            texture_ready = request.texture;
-        }
-        else if ( request.cpu_buffer.index != k_invalid_buffer.index && request.gpu_buffer.index != k_invalid_buffer.index ) {
-            RASSERT( cpu_buffer_ready.index == k_invalid_index );
-            RASSERT( gpu_buffer_ready.index == k_invalid_index );
+            if ( !levels_read ) {
+                // The staging space is given back with this submission.
+                rprint( "Error reading cooked texture %s\n", texture->name );
+                --outstanding_requests;
+                return true;
+            }
 
-            cpu_buffer_ready = request.cpu_buffer;
-            gpu_buffer_ready = request.gpu_buffer;
+            cb->upload_texture_data( texture->handle, staging_buffer->handle, offset );
         }
-        else if ( request.cpu_buffer.index != k_invalid_index ) {
-            RASSERT( cpu_buffer_ready.index == k_invalid_index );
-            cpu_buffer_ready = request.cpu_buffer;
+        else {
+            cb->upload_texture_data( texture->handle, request.data, staging_buffer->handle, offset );
+            free( request.data );
         }
-    }
 
-    // Process a file request
-    if ( file_load_requests.size ) {
-        FileLoadRequest load_request = file_load_requests.back();
-        file_load_requests.pop();
+        submission.textures.push( request.texture );
+        submission.bytes += image_size;
+    }
+    else if ( request.cpu_buffer.index != k_invalid_buffer.index && request.gpu_buffer.index != k_invalid_buffer.index ) {
+        Buffer* src = renderer->gpu->access_buffer( request.cpu_buffer );
+        Buffer* dst = renderer->gpu->access_buffer( request.gpu_buffer );
 
-        i64 start_reading_file = time_now();
-        // Process request
-        int x, y, comp;
-        u8* texture_data = stbi_load( load_request.path, &x, &y, &comp, 4 );
+        cb->upload_buffer_data( src->handle, dst->handle );
 
-        if ( texture_data ) {
-            rprint( "File %s read in %f ms\n", load_request.path, time_from_milliseconds( start_reading_file ) );
+        submission.cpu_buffers.push( request.cpu_buffer );
+        submission.gpu_buffers.push( request.gpu_buffer );
+        submission.bytes += src->size;
+    }
+    else if ( request.cpu_buffer.index != k_invalid_buffer.index ) {
+        Buffer* buffer = renderer->gpu->access_buffer( request.cpu_buffer );
 
-            UploadRequest& upload_request = upload_requests.push_use();
-            upload_request.data = texture_data;
-            upload_request.texture = load_request.texture;
-            upload_request.cpu_buffer = k_invalid_buffer;
+        if ( buffer->size > staging_ring.capacity ) {
+            rprint( "Buffer %s does not fit in the staging buffer, skipping upload.\n", buffer->name );
+            free( request.data );
+            --outstanding_requests;
+            return true;
         }
-        else {
-            rprint( "Error reading file %s\n", load_request.path );
+
+        sizet offset;
+        if ( !staging_ring.allocate( buffer->size, k_buffer_alignment, offset ) ) {
+            return false;
         }
+
+        cb->upload_buffer_data( buffer->handle, request.data, staging_buffer->handle, offset );
+        free( request.data );
+
+        submission.gpu_buffers.push( request.cpu_buffer );
+        submission.bytes += buffer->size;
+    }
+
+    return true;
+}
+
+void AsynchronousLoader::update_stats() {
+    stats.file_requests_pending = pending_file_loads.size;
+    stats.files_decoding = decode_count;
+    stats.uploads_pending = pending_uploads.size;
+    stats.submissions_in_flight = submissions_in_flight;
+    stats.max_uploads_pending = stats.uploads_pending > stats.max_uploads_pending ? stats.uploads_pending : stats.max_uploads_pending;
+    stats.staging_bytes_used = staging_ring.used;
+    stats.staging_bytes_max = staging_ring.used > stats.staging_bytes_max ? staging_ring.used : stats.staging_bytes_max;
+    stats.average_latency_ms = stats.submissions ? total_latency_ms / stats.submissions : 0.0;
+
+    // Refresh throughput twice per second.
+    const f64 window_seconds = time_from_seconds( stats_window_start );
+    if ( window_seconds >= 0.5 ) {
+        stats.throughput_mb_s = ( stats_window_bytes / ( 1024.0 * 1024.0 ) ) / window_seconds;
+        stats.textures_per_second = stats_window_textures / window_seconds;
+
+        stats_window_start = time_now();
+        stats_window_bytes = 0;
+        stats_window_textures = 0;
     }
 
-    staging_buffer_offset = 0;
+    std::lock_guard<std::mutex> guard( stats_mutex );
+    published_stats = stats;
 }
 
 void AsynchronousLoader::request_texture_data( cstring filename, TextureHandle texture ) {
 
+    std::lock_guard<std::mutex> guard( request_mutex );
     FileLoadRequest& request = file_load_requests.push_use();
     strcpy( request.path, filename );
+    request.data = nullptr;
+    request.data_size = 0;
+    request.texture = texture;
+    request.buffer = k_invalid_buffer;
+
+    ++outstanding_requests;
+}
+
+void AsynchronousLoader::request_texture_memory( const void* data, u32 size, cstring name, TextureHandle texture ) {
+
+    std::lock_guard<std::mutex> guard( request_mutex );
+    FileLoadRequest& request = file_load_requests.push_use();
+    snprintf( request.path, 512, "%s", name );
+    request.data = data;
+    request.data_size = size;
     request.texture = texture;
     request.buffer = k_invalid_buffer;
+
+    ++outstanding_requests;
 }
 
 void AsynchronousLoader::request_buffer_upload( void* data, BufferHandle buffer ) {
 
+    std::lock_guard<std::mutex> guard( request_mutex );
     UploadRequest& upload_request = upload_requests.push_use();
     upload_request.data = data;
+    upload_request.cooked = false;
     upload_request.cpu_buffer = buffer;
+    upload_request.gpu_buffer = k_invalid_buffer;
     upload_request.texture = k_invalid_texture;
+
+    ++outstanding_requests;
 }
 
 void AsynchronousLoader::request_buffer_copy( BufferHandle src, BufferHandle dst ) {
 
+    Buffer* buffer = renderer->gpu->access_buffer( dst );
+    buffer->ready = false;
+
+    std::lock_guard<std::mutex> guard( request_mutex );
     UploadRequest& upload_request = upload_requests.push_use();
     upload_request.data = nullptr;
+    upload_request.cooked = false;
     upload_request.cpu_buffer = src;
     upload_request.gpu_buffer = dst;
     upload_request.texture = k_invalid_texture;
 
-    Buffer* buffer = renderer->gpu->access_buffer( dst );
-    buffer->ready = false;
+    ++outstanding_requests;
+}
+
+bool AsynchronousLoader::is_idle() {
+    return outstanding_requests == 0;
+}
+
+AsynchronousLoaderStats AsynchronousLoader::get_stats() {
+    std::lock_guard<std::mutex> guard( stats_mutex );
+    return published_stats;
+}
+
+void AsynchronousLoader::debug_ui() {
+    const AsynchronousLoaderStats current = get_stats();
+
+    ImGui::Text( "Outstanding requests %u", outstanding_requests.load() );
+    ImGui::Text( "Files pending %u, decoding %u", current.file_requests_pending, current.files_decoding );
+    ImGui::Text( "Uploads pending %u, max %u", current.uploads_pending, current.max_uploads_pending );
+    ImGui::Text( "Submissions in flight %u/%u, total %llu", current.submissions_in_flight, k_max_transfer_submissions, current.submissions );
+    ImGui::Separator();
+    ImGui::Text( "Textures uploaded %llu, buffers uploaded %llu", current.textures_uploaded, current.buffers_uploaded );
+    ImGui::Text( "Uploaded %.2f MB", current.bytes_uploaded / ( 1024.0 * 1024.0 ) );
+    ImGui::Text( "Throughput %.2f MB/s, %.1f textures/s", current.throughput_mb_s, current.textures_per_second );
+    ImGui::Text( "Average submission latency %.3f ms", current.average_latency_ms );
+    ImGui::Separator();
+    const f32 staging_capacity_mb = staging_ring.capacity / ( 1024.f * 1024.f );
+    ImGui::Text( "Staging ring %.2f / %.2f MB, peak %.2f MB", current.staging_bytes_used / ( 1024.f * 1024.f ), staging_capacity_mb, current.staging_bytes_max / ( 1024.f * 1024.f ) );
+    ImGui::ProgressBar( staging_ring.capacity ? ( f32 )current.staging_bytes_used / staging_ring.capacity : 0.f );
 }
 
 } // namespace raptor
@@ -6,41 +6,125 @@
 #include "graphics/command_buffer.hpp"
 #include "graphics/gpu_device.hpp"
 #include "graphics/gpu_resources.hpp"
+#include "graphics/texture_cooker.hpp"
 
 #include "external/cglm/types-struct.h"
+#include "external/enkiTS/TaskScheduler.h"
 
 #include <atomic>
-
-namespace enki { class TaskScheduler; }
+#include <mutex>
 
 namespace raptor
 {
     struct Allocator;
+    struct AsynchronousLoader;
     struct FrameGraph;
     struct GpuVisualProfiler;
     struct ImGuiService;
     struct Renderer;
     struct StackAllocator;
 
+    static const u32                            k_max_transfer_submissions  = 4;
+    static const u32                            k_max_decodes_per_batch     = 16;
+
     //
-    //
+    // Images already in memory are decoded from data, path is only used to report errors.
     struct FileLoadRequest {
 
         char                                    path[ 512 ];
+        const void*                             data        = nullptr;
+        u32                                     data_size   = 0;
         TextureHandle                           texture     = k_invalid_texture;
         BufferHandle                            buffer      = k_invalid_buffer;
     }; // struct FileLoadRequest
 
     //
+    // Header of a cooked texture. Its levels are read straight into the staging buffer when the upload is recorded.
+    struct CookedTextureStream {
+
+        char                                    path[ 512 ];
+        Ktx2Info                                info;
+    }; // struct CookedTextureStream
+
     //
+    // Cooked textures have a CookedTextureStream as data, every data is released with free.
     struct UploadRequest {
 
         void*                                   data        = nullptr;
+        bool                                    cooked      = false;
         TextureHandle                           texture     = k_invalid_texture;
         BufferHandle                            cpu_buffer  = k_invalid_buffer;
         BufferHandle                            gpu_buffer  = k_invalid_buffer;
     }; // struct UploadRequest
 
+    //
+    // Ring allocator over the persistently mapped staging buffer.
+    // Space is given back in submission order, once the transfer fence that used it is signaled.
+    struct StagingRing {
+
+        void                                    init( sizet size );
+
+        // Returns false if the allocation does not fit until older submissions are retired.
+        bool                                    allocate( sizet size, sizet alignment, sizet& out_offset );
+        void                                    release( sizet end_offset, sizet size );
+
+        sizet                                   capacity    = 0;
+        sizet                                   head        = 0;    // Next write offset.
+        sizet                                   tail        = 0;    // Start of the oldest in-flight allocation.
+        sizet                                   used        = 0;    // Bytes in flight, including padding and wrap-around waste.
+    }; // struct StagingRing
+
+    //
+    // A transfer command buffer with all the uploads that were packed into it.
+    struct TransferSubmission {
+
+        VkCommandPool                           command_pool;
+        CommandBuffer                           command_buffer;
+        VkFence                                 fence;
+
+        Array<TextureHandle>                    textures;
+        Array<BufferHandle>                     cpu_buffers;    // Sources of buffer copies, destroyed when completed.
+        Array<BufferHandle>                     gpu_buffers;    // Destinations, marked ready when completed.
+
+        sizet                                   staging_end     = 0;
+        sizet                                   staging_size    = 0;
+        u64                                     bytes           = 0;
+        i64                                     submit_time     = 0;
+        bool                                    in_flight       = false;
+    }; // struct TransferSubmission
+
+    //
+    // Decodes a batch of image files on the worker threads.
+    struct TextureDecodeTask : public enki::ITaskSet {
+
+        void                                    ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) override;
+
+        FileLoadRequest*                        requests    = nullptr;
+        UploadRequest*                          results     = nullptr;
+    }; // struct TextureDecodeTask
+
+    //
+    //
+    struct AsynchronousLoaderStats {
+
+        u32                                     file_requests_pending   = 0;
+        u32                                     files_decoding          = 0;
+        u32                                     uploads_pending         = 0;
+        u32                                     submissions_in_flight   = 0;
+        u32                                     max_uploads_pending     = 0;
+
+        u64                                     textures_uploaded       = 0;
+        u64                                     buffers_uploaded        = 0;
+        u64                                     submissions             = 0;
+        u64                                     bytes_uploaded          = 0;
+        u64                                     staging_bytes_used      = 0;
+        u64                                     staging_bytes_max       = 0;
+
+        f64                                     throughput_mb_s         = 0.0;  // Over the last measurement window.
+        f64                                     textures_per_second     = 0.0;
+        f64                                     average_latency_ms      = 0.0;  // Submit to fence signaled.
+    }; // struct AsynchronousLoaderStats
+
     //
     //
     struct AsynchronousLoader {
@@ -49,28 +133,59 @@ namespace raptor
         void                                    update( Allocator* scratch_allocator );
         void                                    shutdown();
 
+        // Request methods can be called from any thread.
         void                                    request_texture_data( cstring filename, TextureHandle texture );
+        // Encoded image bytes, that must stay valid until the texture is uploaded.
+        void                                    request_texture_memory( const void* data, u32 size, cstring name, TextureHandle texture );
         void                                    request_buffer_upload( void* data, BufferHandle buffer );
         void                                    request_buffer_copy( BufferHandle src, BufferHandle dst );
 
+        bool                                    is_idle();
+        AsynchronousLoaderStats                 get_stats();
+        void                                    debug_ui();
+
+        // Internal update steps, executed on the loader thread.
+        void                                    retire_submissions();
+        void                                    gather_decoded_files();
+        void                                    start_file_decodes();
+        void                                    submit_uploads();
+        bool                                    record_upload( TransferSubmission& submission, const UploadRequest& request );
+        void                                    update_stats();
+
         Allocator*                              allocator       = nullptr;
         Renderer*                               renderer        = nullptr;
         enki::TaskScheduler*                    task_scheduler  = nullptr;
 
+        // Written by any thread under request_mutex, drained by the loader thread.
         Array<FileLoadRequest>                  file_load_requests;
         Array<UploadRequest>                    upload_requests;
+        std::mutex                              request_mutex;
+        std::atomic_uint32_t                    outstanding_requests;   // Requested and not yet completed or dropped.
 
-        Buffer*                                 staging_buffer  = nullptr;
+        // Owned by the loader thread.
+        Array<FileLoadRequest>                  pending_file_loads;
+        Array<UploadRequest>                    pending_uploads;
 
-        std::atomic_size_t                      staging_buffer_offset;
-        TextureHandle                           texture_ready;
-        BufferHandle                            cpu_buffer_ready;
-        BufferHandle                            gpu_buffer_ready;
+        TextureDecodeTask                       decode_task;
+        FileLoadRequest                         decode_requests[ k_max_decodes_per_batch ];
+        UploadRequest                           decode_results[ k_max_decodes_per_batch ];
+        u32                                     decode_count    = 0;
 
-        VkCommandPool                           command_pools[ k_max_frames ];
-        CommandBuffer                           command_buffers[ k_max_frames ];
-        VkSemaphore                             transfer_complete_semaphore;
-        VkFence                                 transfer_fence;
+        Buffer*                                 staging_buffer  = nullptr;
+        StagingRing                             staging_ring;
+
+        TransferSubmission                      submissions[ k_max_transfer_submissions ];
+        u32                                     oldest_submission   = 0;
+        u32                                     submissions_in_flight = 0;
+
+        // Statistics, published to other threads through stats_mutex.
+        AsynchronousLoaderStats                 stats;
+        AsynchronousLoaderStats                 published_stats;
+        std::mutex                              stats_mutex;
+        i64                                     stats_window_start  = 0;
+        u64                                     stats_window_bytes  = 0;
+        u64                                     stats_window_textures = 0;
+        f64                                     total_latency_ms    = 0.0;
 
     }; // struct AsynchonousLoader
 
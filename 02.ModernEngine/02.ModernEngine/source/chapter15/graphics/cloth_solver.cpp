@@ -0,0 +1,537 @@
+#include "graphics/cloth_solver.hpp"
+#include "graphics/render_scene.hpp"
+
+#include "foundation/memory.hpp"
+#include "foundation/assert.hpp"
+#include "foundation/log.hpp"
+#include "foundation/numerics.hpp"
+#include "foundation/time.hpp"
+
+#include "external/cglm/struct/vec3.h"
+#include "external/tracy/tracy/Tracy.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+    #define RAPTOR_CLOTH_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace raptor {
+
+static_assert( ClothSolver::k_max_joints == k_max_joint_count, "Cloth solver joints must match the physics vertex joints." );
+
+// Constants of cloth.glsl.
+static const f32 k_step_time = 1.0f / 600.0f;
+static const f32 k_gravity_y = -9.8f;
+static const vec3s k_fixed_vertex_1{ 0.0f,  1.0f, -1.0f };
+static const vec3s k_fixed_vertex_2{ 0.0f, -1.0f, -1.0f };
+
+// Groups below this count per task partition are not worth a worker.
+static const u32 k_min_task_groups = 64;
+
+void ClothSolverTask::ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) {
+    ZoneScoped;
+
+    solver->simulate_groups( parameters, range_.start, range_.end );
+}
+
+void ClothSolver::init( Allocator* allocator_, const PhysicsVertex* vertices, u32 vertex_count_, const u32* indices_, u32 index_count_ ) {
+    allocator = allocator_;
+    vertex_count = vertex_count_;
+    index_count = index_count_;
+    group_count = ( vertex_count + k_lanes - 1 ) / k_lanes;
+
+    // Every array is a multiple of 4 entries, so that each one starts aligned.
+    const u32 padded_count = group_count * k_lanes;
+    const sizet vector_size = sizeof( f32 ) * padded_count;
+    const sizet joints_size = sizeof( u32 ) * padded_count * k_max_joints;
+    const sizet memory_size = vector_size * ( 3 * 6 + 3 ) + joints_size * 2 + sizeof( u32 ) * index_count;
+
+    memory = ( u8* )rallocaa( memory_size, allocator, 64 );
+    memset( memory, 0, memory_size );
+
+    u8* memory_cursor = memory;
+    f32** vectors[] = { positions, previous_positions, start_positions, normals, velocities, forces };
+    for ( u32 v = 0; v < ArraySize( vectors ); ++v ) {
+        for ( u32 c = 0; c < 3; ++c ) {
+            vectors[ v ][ c ] = ( f32* )memory_cursor;
+            memory_cursor += vector_size;
+        }
+    }
+    masses = ( f32* )memory_cursor;
+    memory_cursor += vector_size;
+    fixed_masks = ( u32* )memory_cursor;
+    memory_cursor += vector_size;
+    joint_counts = ( u32* )memory_cursor;
+    memory_cursor += vector_size;
+    joints = ( u32* )memory_cursor;
+    memory_cursor += joints_size;
+    rest_lengths = ( f32* )memory_cursor;
+    memory_cursor += joints_size;
+    indices = ( u32* )memory_cursor;
+
+    memcpy( indices, indices_, sizeof( u32 ) * index_count );
+
+    for ( u32 v = 0; v < vertex_count; ++v ) {
+        const PhysicsVertex& vertex = vertices[ v ];
+
+        for ( u32 c = 0; c < 3; ++c ) {
+            positions[ c ][ v ] = vertex.position.raw[ c ];
+            previous_positions[ c ][ v ] = vertex.previous_position.raw[ c ];
+            start_positions[ c ][ v ] = vertex.start_position.raw[ c ];
+            normals[ c ][ v ] = vertex.normal.raw[ c ];
+            velocities[ c ][ v ] = vertex.velocity.raw[ c ];
+            forces[ c ][ v ] = vertex.force.raw[ c ];
+        }
+        masses[ v ] = vertex.mass;
+
+        const bool fixed = glms_vec3_eqv( vertex.start_position, k_fixed_vertex_1 ) || glms_vec3_eqv( vertex.start_position, k_fixed_vertex_2 );
+        fixed_masks[ v ] = fixed ? 0xffffffff : 0;
+
+        joint_counts[ v ] = vertex.joint_count;
+        const u32 group_offset = ( v / k_lanes ) * k_max_joints * k_lanes + v % k_lanes;
+        for ( u32 j = 0; j < vertex.joint_count; ++j ) {
+            const u32 other = vertex.joints[ j ].vertex_index;
+            const f32 dx = vertex.start_position.x - vertices[ other ].start_position.x;
+            const f32 dy = vertex.start_position.y - vertices[ other ].start_position.y;
+            const f32 dz = vertex.start_position.z - vertices[ other ].start_position.z;
+
+            joints[ group_offset + j * k_lanes ] = other;
+            rest_lengths[ group_offset + j * k_lanes ] = sqrtf( dx * dx + dy * dy + dz * dz );
+        }
+    }
+
+    // Padding vertices are pinned, without mass nor joints, so they stay at the origin.
+    for ( u32 v = vertex_count; v < padded_count; ++v ) {
+        fixed_masks[ v ] = 0xffffffff;
+    }
+}
+
+void ClothSolver::shutdown() {
+    rfree( memory, allocator );
+}
+
+void ClothSolver::reset() {
+    const u32 padded_count = group_count * k_lanes;
+
+    for ( u32 c = 0; c < 3; ++c ) {
+        memcpy( positions[ c ], start_positions[ c ], sizeof( f32 ) * padded_count );
+        memcpy( previous_positions[ c ], start_positions[ c ], sizeof( f32 ) * padded_count );
+        memset( velocities[ c ], 0, sizeof( f32 ) * padded_count );
+        memset( forces[ c ], 0, sizeof( f32 ) * padded_count );
+    }
+}
+
+void ClothSolver::simulate_groups( const ClothParameters& parameters, u32 group_begin, u32 group_end ) {
+    const f32 step_time_squared = k_step_time * k_step_time;
+
+#if defined RAPTOR_CLOTH_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 gravity_y = _mm_set1_ps( k_gravity_y );
+    const __m128 stiffness = _mm_set1_ps( parameters.spring_stiffness );
+    const __m128 damping = _mm_set1_ps( -parameters.spring_damping );
+    const __m128 air_density = _mm_set1_ps( parameters.air_density );
+    const __m128 one = _mm_set1_ps( 1.0f );
+    const __m128 two = _mm_set1_ps( 2.0f );
+    const __m128 dt2 = _mm_set1_ps( step_time_squared );
+    const __m128 wind[ 3 ] = { _mm_set1_ps( parameters.wind_direction.x ), _mm_set1_ps( parameters.wind_direction.y ), _mm_set1_ps( parameters.wind_direction.z ) };
+
+    for ( u32 group = group_begin; group < group_end; ++group ) {
+        const u32 base = group * k_lanes;
+
+        __m128 position[ 3 ], velocity[ 3 ], normal[ 3 ], spring[ 3 ];
+        for ( u32 c = 0; c < 3; ++c ) {
+            position[ c ] = _mm_load_ps( positions[ c ] + base );
+            velocity[ c ] = _mm_load_ps( velocities[ c ] + base );
+            normal[ c ] = _mm_load_ps( normals[ c ] + base );
+            spring[ c ] = zero;
+        }
+
+        const __m128i counts = _mm_load_si128( ( const __m128i* )( joint_counts + base ) );
+        const u32 max_count = raptor::max( raptor::max( joint_counts[ base ], joint_counts[ base + 1 ] ),
+                                           raptor::max( joint_counts[ base + 2 ], joint_counts[ base + 3 ] ) );
+
+        const u32* group_joints = joints + group * k_max_joints * k_lanes;
+        const f32* group_rest_lengths = rest_lengths + group * k_max_joints * k_lanes;
+
+        for ( u32 j = 0; j < max_count; ++j ) {
+            const __m128 mask = _mm_castsi128_ps( _mm_cmpgt_epi32( counts, _mm_set1_epi32( j ) ) );
+            const u32* lane_joints = group_joints + j * k_lanes;
+
+            __m128 pull[ 3 ];
+            for ( u32 c = 0; c < 3; ++c ) {
+                const f32* other = positions[ c ];
+                pull[ c ] = _mm_sub_ps( position[ c ], _mm_setr_ps( other[ lane_joints[ 0 ] ], other[ lane_joints[ 1 ] ], other[ lane_joints[ 2 ] ], other[ lane_joints[ 3 ] ] ) );
+            }
+
+            const __m128 length_squared = _mm_add_ps( _mm_add_ps( _mm_mul_ps( pull[ 0 ], pull[ 0 ] ), _mm_mul_ps( pull[ 1 ], pull[ 1 ] ) ), _mm_mul_ps( pull[ 2 ], pull[ 2 ] ) );
+            const __m128 inverse_length = _mm_div_ps( one, _mm_sqrt_ps( length_squared ) );
+            const __m128 rest_length = _mm_load_ps( group_rest_lengths + j * k_lanes );
+
+            for ( u32 c = 0; c < 3; ++c ) {
+                const __m128 relative = _mm_sub_ps( pull[ c ], _mm_mul_ps( _mm_mul_ps( pull[ c ], inverse_length ), rest_length ) );
+                spring[ c ] = _mm_add_ps( spring[ c ], _mm_and_ps( mask, _mm_mul_ps( relative, stiffness ) ) );
+            }
+        }
+
+        // Wind only acts along the normal.
+        __m128 viscous_velocity[ 3 ];
+        for ( u32 c = 0; c < 3; ++c ) {
+            viscous_velocity[ c ] = _mm_sub_ps( wind[ c ], velocity[ c ] );
+        }
+        const __m128 normal_dot = _mm_add_ps( _mm_add_ps( _mm_mul_ps( normal[ 0 ], viscous_velocity[ 0 ] ), _mm_mul_ps( normal[ 1 ], viscous_velocity[ 1 ] ) ), _mm_mul_ps( normal[ 2 ], viscous_velocity[ 2 ] ) );
+
+        const __m128 mass = _mm_load_ps( masses + base );
+        const __m128 fixed = _mm_load_ps( ( const f32* )( fixed_masks + base ) );
+
+        for ( u32 c = 0; c < 3; ++c ) {
+            __m128 force = _mm_mul_ps( c == 1 ? gravity_y : zero, mass );
+            force = _mm_sub_ps( force, spring[ c ] );
+            force = _mm_add_ps( force, _mm_mul_ps( velocity[ c ], damping ) );
+            force = _mm_add_ps( force, _mm_mul_ps( _mm_mul_ps( normal[ c ], normal_dot ), air_density ) );
+
+            // Pinned vertices keep their force, as the shader skips them.
+            force = _mm_or_ps( _mm_and_ps( fixed, _mm_load_ps( forces[ c ] + base ) ), _mm_andnot_ps( fixed, force ) );
+            _mm_store_ps( forces[ c ] + base, force );
+
+            // Verlet integration, the new position replaces the previous one.
+            const __m128 new_position = _mm_add_ps( _mm_sub_ps( _mm_mul_ps( position[ c ], two ), _mm_load_ps( previous_positions[ c ] + base ) ), _mm_mul_ps( force, dt2 ) );
+            _mm_store_ps( previous_positions[ c ] + base, new_position );
+            _mm_store_ps( velocities[ c ] + base, _mm_sub_ps( new_position, position[ c ] ) );
+        }
+    }
+#else
+    // Without SIMD the reference operations are used for each vertex of the groups.
+    for ( u32 v = group_begin * k_lanes; v < group_end * k_lanes; ++v ) {
+        const u32 group_offset = ( v / k_lanes ) * k_max_joints * k_lanes + v % k_lanes;
+
+        f32 spring[ 3 ] = { 0.f, 0.f, 0.f };
+        for ( u32 j = 0; j < joint_counts[ v ]; ++j ) {
+            const u32 other = joints[ group_offset + j * k_lanes ];
+
+            f32 pull[ 3 ];
+            for ( u32 c = 0; c < 3; ++c ) {
+                pull[ c ] = positions[ c ][ v ] - positions[ c ][ other ];
+            }
+            const f32 inverse_length = 1.0f / sqrtf( pull[ 0 ] * pull[ 0 ] + pull[ 1 ] * pull[ 1 ] + pull[ 2 ] * pull[ 2 ] );
+
+            for ( u32 c = 0; c < 3; ++c ) {
+                spring[ c ] += ( pull[ c ] - pull[ c ] * inverse_length * rest_lengths[ group_offset + j * k_lanes ] ) * parameters.spring_stiffness;
+            }
+        }
+
+        f32 viscous_velocity[ 3 ];
+        for ( u32 c = 0; c < 3; ++c ) {
+            viscous_velocity[ c ] = parameters.wind_direction.raw[ c ] - velocities[ c ][ v ];
+        }
+        const f32 normal_dot = normals[ 0 ][ v ] * viscous_velocity[ 0 ] + normals[ 1 ][ v ] * viscous_velocity[ 1 ] + normals[ 2 ][ v ] * viscous_velocity[ 2 ];
+
+        for ( u32 c = 0; c < 3; ++c ) {
+            if ( !fixed_masks[ v ] ) {
+                f32 force = ( c == 1 ? k_gravity_y : 0.f ) * masses[ v ];
+                force -= spring[ c ];
+                force += velocities[ c ][ v ] * -parameters.spring_damping;
+                force += normals[ c ][ v ] * normal_dot * parameters.air_density;
+                forces[ c ][ v ] = force;
+            }
+
+            const f32 new_position = positions[ c ][ v ] * 2.0f - previous_positions[ c ][ v ] + forces[ c ][ v ] * step_time_squared;
+            previous_positions[ c ][ v ] = new_position;
+            velocities[ c ][ v ] = new_position - positions[ c ][ v ];
+        }
+    }
+#endif // RAPTOR_CLOTH_SSE2
+}
+
+// Normals accumulate the face normals in index order, each step normalized, as in the shader.
+static void cloth_update_normals( ClothSolver& solver ) {
+    for ( u32 i = 0; i < solver.index_count; i += 3 ) {
+        const u32 i0 = solver.indices[ i + 0 ];
+        const u32 i1 = solver.indices[ i + 1 ];
+        const u32 i2 = solver.indices[ i + 2 ];
+
+        f32 edge1[ 3 ], edge2[ 3 ];
+        for ( u32 c = 0; c < 3; ++c ) {
+            edge1[ c ] = solver.positions[ c ][ i1 ] - solver.positions[ c ][ i0 ];
+            edge2[ c ] = solver.positions[ c ][ i2 ] - solver.positions[ c ][ i0 ];
+        }
+
+        const f32 n[ 3 ] = { edge1[ 1 ] * edge2[ 2 ] - edge1[ 2 ] * edge2[ 1 ],
+                             edge1[ 2 ] * edge2[ 0 ] - edge1[ 0 ] * edge2[ 2 ],
+                             edge1[ 0 ] * edge2[ 1 ] - edge1[ 1 ] * edge2[ 0 ] };
+
+        const u32 face_indices[ 3 ] = { i0, i1, i2 };
+        for ( u32 k = 0; k < 3; ++k ) {
+            const u32 v = face_indices[ k ];
+
+            f32 normal[ 3 ];
+            for ( u32 c = 0; c < 3; ++c ) {
+                normal[ c ] = solver.normals[ c ][ v ] + n[ c ];
+            }
+            const f32 inverse_length = 1.0f / sqrtf( normal[ 0 ] * normal[ 0 ] + normal[ 1 ] * normal[ 1 ] + normal[ 2 ] * normal[ 2 ] );
+            for ( u32 c = 0; c < 3; ++c ) {
+                solver.normals[ c ][ v ] = normal[ c ] * inverse_length;
+            }
+        }
+    }
+}
+
+static void cloth_swap_positions( ClothSolver& solver ) {
+    for ( u32 c = 0; c < 3; ++c ) {
+        f32* new_positions = solver.previous_positions[ c ];
+        solver.previous_positions[ c ] = solver.positions[ c ];
+        solver.positions[ c ] = new_positions;
+    }
+}
+
+void ClothSolver::update( const ClothParameters& parameters, enki::TaskScheduler* task_scheduler ) {
+    ZoneScoped;
+
+    ClothSolverTask task;
+
+    for ( u32 s = 0; s < k_sim_steps; ++s ) {
+        if ( task_scheduler && group_count >= k_min_task_groups * 2 ) {
+            task.solver = this;
+            task.parameters = parameters;
+            task.m_SetSize = group_count;
+            task.m_MinRange = k_min_task_groups;
+
+            task_scheduler->AddTaskSetToPipe( &task );
+            task_scheduler->WaitforTask( &task );
+        } else {
+            simulate_groups( parameters, 0, group_count );
+        }
+
+        cloth_swap_positions( *this );
+    }
+
+    cloth_update_normals( *this );
+}
+
+void ClothSolver::update_reference( const ClothParameters& parameters ) {
+    const f32 step_time_squared = k_step_time * k_step_time;
+    const u32 padded_count = group_count * k_lanes;
+
+    for ( u32 s = 0; s < k_sim_steps; ++s ) {
+        // First calculate the force to apply to each vertex
+        for ( u32 v = 0; v < padded_count; ++v ) {
+            if ( fixed_masks[ v ] ) {
+                continue;
+            }
+
+            const u32 group_offset = ( v / k_lanes ) * k_max_joints * k_lanes + v % k_lanes;
+
+            vec3s spring_force{ 0.f, 0.f, 0.f };
+            for ( u32 j = 0; j < joint_counts[ v ]; ++j ) {
+                const u32 other = joints[ group_offset + j * k_lanes ];
+
+                const vec3s pull_direction{ positions[ 0 ][ v ] - positions[ 0 ][ other ], positions[ 1 ][ v ] - positions[ 1 ][ other ], positions[ 2 ][ v ] - positions[ 2 ][ other ] };
+                const f32 inverse_length = 1.0f / sqrtf( pull_direction.x * pull_direction.x + pull_direction.y * pull_direction.y + pull_direction.z * pull_direction.z );
+                const f32 spring_rest_length = rest_lengths[ group_offset + j * k_lanes ];
+
+                for ( u32 c = 0; c < 3; ++c ) {
+                    const f32 relative_pull = pull_direction.raw[ c ] - pull_direction.raw[ c ] * inverse_length * spring_rest_length;
+                    spring_force.raw[ c ] = spring_force.raw[ c ] + relative_pull * parameters.spring_stiffness;
+                }
+            }
+
+            const vec3s velocity{ velocities[ 0 ][ v ], velocities[ 1 ][ v ], velocities[ 2 ][ v ] };
+            const vec3s normal{ normals[ 0 ][ v ], normals[ 1 ][ v ], normals[ 2 ][ v ] };
+
+            const vec3s viscous_velocity{ parameters.wind_direction.x - velocity.x, parameters.wind_direction.y - velocity.y, parameters.wind_direction.z - velocity.z };
+            const f32 normal_dot = normal.x * viscous_velocity.x + normal.y * viscous_velocity.y + normal.z * viscous_velocity.z;
+
+            for ( u32 c = 0; c < 3; ++c ) {
+                f32 force = ( c == 1 ? k_gravity_y : 0.f ) * masses[ v ];
+                force = force - spring_force.raw[ c ];
+                force = force + velocity.raw[ c ] * -parameters.spring_damping;
+                force = force + normal.raw[ c ] * normal_dot * parameters.air_density;
+                forces[ c ][ v ] = force;
+            }
+        }
+
+        // Then update their position
+        for ( u32 v = 0; v < padded_count; ++v ) {
+            for ( u32 c = 0; c < 3; ++c ) {
+                const f32 current_position = positions[ c ][ v ];
+                const f32 new_position = current_position * 2.0f - previous_positions[ c ][ v ] + forces[ c ][ v ] * step_time_squared;
+
+                previous_positions[ c ][ v ] = new_position;
+                velocities[ c ][ v ] = new_position - current_position;
+            }
+        }
+
+        cloth_swap_positions( *this );
+    }
+
+    cloth_update_normals( *this );
+}
+
+void ClothSolver::write_gpu_data( PhysicsVertexGpuData* gpu_data ) const {
+    for ( u32 v = 0; v < vertex_count; ++v ) {
+        PhysicsVertexGpuData& data = gpu_data[ v ];
+        data = PhysicsVertexGpuData{ };
+
+        for ( u32 c = 0; c < 3; ++c ) {
+            data.position.raw[ c ] = positions[ c ][ v ];
+            data.start_position.raw[ c ] = start_positions[ c ][ v ];
+            data.previous_position.raw[ c ] = previous_positions[ c ][ v ];
+            data.normal.raw[ c ] = normals[ c ][ v ];
+            data.velocity.raw[ c ] = velocities[ c ][ v ];
+            data.force.raw[ c ] = forces[ c ][ v ];
+        }
+        data.mass = masses[ v ];
+        data.joint_count = joint_counts[ v ];
+
+        const u32 group_offset = ( v / k_lanes ) * k_max_joints * k_lanes + v % k_lanes;
+        for ( u32 j = 0; j < joint_counts[ v ]; ++j ) {
+            data.joints[ j ] = joints[ group_offset + j * k_lanes ];
+        }
+    }
+}
+
+void ClothSolver::write_attributes( vec3s* positions_, vec3s* normals_ ) const {
+    for ( u32 v = 0; v < vertex_count; ++v ) {
+        positions_[ v ] = vec3s{ positions[ 0 ][ v ], positions[ 1 ][ v ], positions[ 2 ][ v ] };
+        normals_[ v ] = vec3s{ normals[ 0 ][ v ], normals[ 1 ][ v ], normals[ 2 ][ v ] };
+    }
+}
+
+f32 cloth_gpu_data_max_difference( const PhysicsVertexGpuData* a, const PhysicsVertexGpuData* b, u32 vertex_count ) {
+    f32 max_difference = 0.f;
+
+    for ( u32 v = 0; v < vertex_count; ++v ) {
+        const PhysicsVertexGpuData& va = a[ v ];
+        const PhysicsVertexGpuData& vb = b[ v ];
+
+        if ( va.joint_count != vb.joint_count || memcmp( va.joints, vb.joints, sizeof( u32 ) * va.joint_count ) != 0 ) {
+            return INFINITY;
+        }
+
+        const vec3s* vectors_a[] = { &va.position, &va.start_position, &va.previous_position, &va.normal, &va.velocity, &va.force };
+        const vec3s* vectors_b[] = { &vb.position, &vb.start_position, &vb.previous_position, &vb.normal, &vb.velocity, &vb.force };
+        for ( u32 i = 0; i < ArraySize( vectors_a ); ++i ) {
+            for ( u32 c = 0; c < 3; ++c ) {
+                const f32 difference = fabsf( vectors_a[ i ]->raw[ c ] - vectors_b[ i ]->raw[ c ] );
+                // NaN differences are reported as infinite.
+                max_difference = difference == difference ? glm_max( max_difference, difference ) : INFINITY;
+            }
+        }
+    }
+
+    return max_difference;
+}
+
+// Benchmark //////////////////////////////////////////////////////////////
+
+// Square cloth in the x = 0 plane, spanning the pinned corners of the shader, with structural,
+// shear and bend springs.
+static void cloth_benchmark_create_vertices( PhysicsVertex* vertices, u32* indices, u32 side ) {
+    const f32 spacing = 2.0f / ( side - 1 );
+
+    for ( u32 row = 0; row < side; ++row ) {
+        for ( u32 column = 0; column < side; ++column ) {
+            PhysicsVertex& vertex = vertices[ row * side + column ];
+            vertex = PhysicsVertex{ };
+
+            // End points are exact, so that the pinned corners match.
+            const f32 y = row == side - 1 ? -1.0f : 1.0f - row * spacing;
+            const f32 z = column == side - 1 ? 1.0f : -1.0f + column * spacing;
+            vertex.start_position = vec3s{ 0.f, y, z };
+            vertex.position = vertex.start_position;
+            vertex.previous_position = vertex.start_position;
+            vertex.normal = vec3s{ 1.f, 0.f, 0.f };
+            vertex.mass = 1.0f;
+
+            static const i32 k_offsets[][ 2 ] = { { 0, 1 }, { 1, 0 }, { 0, -1 }, { -1, 0 },
+                                                  { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 },
+                                                  { 0, 2 }, { 2, 0 }, { 0, -2 }, { -2, 0 } };
+            for ( u32 o = 0; o < ArraySize( k_offsets ); ++o ) {
+                const i32 other_row = ( i32 )row + k_offsets[ o ][ 0 ];
+                const i32 other_column = ( i32 )column + k_offsets[ o ][ 1 ];
+                if ( other_row >= 0 && other_row < ( i32 )side && other_column >= 0 && other_column < ( i32 )side ) {
+                    vertex.add_joint( other_row * side + other_column );
+                }
+            }
+        }
+    }
+
+    for ( u32 row = 0; row + 1 < side; ++row ) {
+        for ( u32 column = 0; column + 1 < side; ++column ) {
+            const u32 i0 = row * side + column;
+            const u32 i1 = i0 + 1;
+            const u32 i2 = i0 + side;
+            const u32 i3 = i2 + 1;
+
+            *indices++ = i0; *indices++ = i2; *indices++ = i1;
+            *indices++ = i1; *indices++ = i2; *indices++ = i3;
+        }
+    }
+}
+
+void cloth_solver_benchmark( Allocator* allocator, enki::TaskScheduler* task_scheduler ) {
+    static const u32 k_sides[] = { 32, 64, 128, 256, 512 };
+    const u32 num_frames = 10;
+    const ClothParameters parameters{ vec3s{ -2.0f, 0.0f, 0.0f }, 2.0f, 10000.0f, 5000.0f };
+
+    rprint( "Cloth solver benchmark: %u updates of %u substeps, %u threads.\n", num_frames, ClothSolver::k_sim_steps,
+            task_scheduler ? task_scheduler->GetNumTaskThreads() : 1 );
+
+    for ( u32 s = 0; s < ArraySize( k_sides ); ++s ) {
+        const u32 side = k_sides[ s ];
+        const u32 vertex_count = side * side;
+        const u32 index_count = ( side - 1 ) * ( side - 1 ) * 6;
+
+        PhysicsVertex* vertices = ( PhysicsVertex* )ralloca( sizeof( PhysicsVertex ) * vertex_count, allocator );
+        u32* indices = ( u32* )ralloca( sizeof( u32 ) * index_count, allocator );
+        PhysicsVertexGpuData* gpu_data = ( PhysicsVertexGpuData* )ralloca( sizeof( PhysicsVertexGpuData ) * vertex_count * 2, allocator );
+        PhysicsVertexGpuData* reference_gpu_data = gpu_data + vertex_count;
+
+        cloth_benchmark_create_vertices( vertices, indices, side );
+
+        ClothSolver reference;
+        reference.init( allocator, vertices, vertex_count, indices, index_count );
+        ClothSolver solver;
+        solver.init( allocator, vertices, vertex_count, indices, index_count );
+
+        i64 start = time_now();
+        for ( u32 f = 0; f < num_frames; ++f ) {
+            reference.update_reference( parameters );
+        }
+        const f64 reference_ms = time_from_milliseconds( start ) / num_frames;
+        reference.write_gpu_data( reference_gpu_data );
+
+        start = time_now();
+        for ( u32 f = 0; f < num_frames; ++f ) {
+            solver.update( parameters, nullptr );
+        }
+        const f64 serial_ms = time_from_milliseconds( start ) / num_frames;
+        solver.write_gpu_data( gpu_data );
+        const f32 serial_difference = cloth_gpu_data_max_difference( reference_gpu_data, gpu_data, vertex_count );
+
+        // Normals are not part of a reset, the parallel run starts again from the loaded vertices.
+        solver.shutdown();
+        solver.init( allocator, vertices, vertex_count, indices, index_count );
+
+        start = time_now();
+        for ( u32 f = 0; f < num_frames; ++f ) {
+            solver.update( parameters, task_scheduler );
+        }
+        const f64 parallel_ms = time_from_milliseconds( start ) / num_frames;
+        solver.write_gpu_data( gpu_data );
+        const f32 parallel_difference = cloth_gpu_data_max_difference( reference_gpu_data, gpu_data, vertex_count );
+
+        rprint( "%7u vertices | scalar %9.3f ms | SIMD %9.3f ms, difference %g | SIMD parallel %9.3f ms, difference %g\n",
+                vertex_count, reference_ms, serial_ms, serial_difference, parallel_ms, parallel_difference );
+
+        solver.shutdown();
+        reference.shutdown();
+        rfree( gpu_data, allocator );
+        rfree( indices, allocator );
+        rfree( vertices, allocator );
+    }
+}
+
+} // namespace raptor
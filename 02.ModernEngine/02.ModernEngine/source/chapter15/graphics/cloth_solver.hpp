@@ -0,0 +1,97 @@
+#pragma once
+
+#include "foundation/platform.hpp"
+
+#include "external/cglm/types-struct.h"
+
+#include "external/enkiTS/TaskScheduler.h"
+
+namespace raptor {
+
+    struct Allocator;
+    struct PhysicsVertex;
+    struct PhysicsVertexGpuData;
+
+    //
+    // Same values as PhysicsSceneData, without the reset flag.
+    struct ClothParameters {
+
+        vec3s                           wind_direction;
+        f32                             air_density;
+        f32                             spring_stiffness;
+        f32                             spring_damping;
+    }; // struct ClothParameters
+
+    struct ClothSolver;
+
+    //
+    // One substep over a range of 4 vertices groups.
+    struct ClothSolverTask : public enki::ITaskSet {
+
+        void                            ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) override;
+
+        ClothSolver*                    solver          = nullptr;
+        ClothParameters                 parameters;
+
+    }; // struct ClothSolverTask
+
+    //
+    // CPU version of cloth.glsl: 10 Verlet substeps of 1/600 seconds per update, forces computed from the
+    // positions of the previous substep. Vertices are stored as SoA in groups of 4, padded with fixed vertices,
+    // and each substep is a single SIMD pass writing the new positions over the previous ones.
+    // Joints and rest lengths are interleaved by group, so that the joint j of a group is one 4 wide load.
+    // Plain data, so that it can live in PhysicsMesh memory, which is not constructed.
+    struct ClothSolver {
+
+        static const u32                k_lanes         = 4;
+        static const u32                k_max_joints    = 12;
+        static const u32                k_sim_steps     = 10;
+
+        void                            init( Allocator* allocator, const PhysicsVertex* vertices, u32 vertex_count, const u32* indices, u32 index_count );
+        void                            shutdown();
+
+        void                            reset();
+
+        // Substeps on the task scheduler when not null, then normals in face order as the shader computes them.
+        void                            update( const ClothParameters& parameters, enki::TaskScheduler* task_scheduler );
+        // Scalar and serial, with the same operations in the same order, to validate the SIMD path.
+        void                            update_reference( const ClothParameters& parameters );
+
+        void                            simulate_groups( const ClothParameters& parameters, u32 group_begin, u32 group_end );
+
+        // Output in the layout of the GPU buffers, so that results can be compared with a read back.
+        void                            write_gpu_data( PhysicsVertexGpuData* gpu_data ) const;
+        void                            write_attributes( vec3s* positions, vec3s* normals ) const;
+
+        // x, y and z arrays of each quantity. Positions and previous positions are swapped after each substep.
+        f32*                            positions[ 3 ];
+        f32*                            previous_positions[ 3 ];
+        f32*                            start_positions[ 3 ];
+        f32*                            normals[ 3 ];
+        f32*                            velocities[ 3 ];
+        f32*                            forces[ 3 ];
+        f32*                            masses;
+        u32*                            fixed_masks;    // All bits set for vertices pinned by the shader.
+
+        u32*                            joint_counts;
+        u32*                            joints;         // Group, joint, lane.
+        f32*                            rest_lengths;   // Group, joint, lane.
+
+        u32*                            indices;
+        u32                             index_count;
+
+        u32                             vertex_count;
+        u32                             group_count;
+
+        Allocator*                      allocator;
+        u8*                             memory;
+
+    }; // struct ClothSolver
+
+    // Largest difference between two vertex buffers of the cloth shader layout, joints must match exactly.
+    f32                                 cloth_gpu_data_max_difference( const PhysicsVertexGpuData* a, const PhysicsVertexGpuData* b, u32 vertex_count );
+
+    // Square cloths of growing vertex counts: SIMD serial and parallel against the scalar path.
+    void                                cloth_solver_benchmark( Allocator* allocator, enki::TaskScheduler* task_scheduler );
+
+} // namespace raptor
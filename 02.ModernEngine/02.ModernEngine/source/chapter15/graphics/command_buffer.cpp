@@ -21,10 +21,12 @@ void CommandBuffer::reset() {
     current_framebuffer = nullptr;
     current_pipeline = nullptr;
     current_command = 0;
+    statistics_query_active = false;
+    queue_wait_count = 0;
 
     vkResetDescriptorPool( gpu_device->vulkan_device, vk_descriptor_pool, 0 );
 
-    u32 resource_count = descriptor_sets.free_indices_head;
+    u32 resource_count = descriptor_sets.used_indices;
     for ( u32 i = 0; i < resource_count; ++i) {
         DescriptorSet* v_descriptor_set = ( DescriptorSet* )descriptor_sets.access_resource( i );
 
@@ -32,8 +34,8 @@ void CommandBuffer::reset() {
             // Contains the allocation for all the resources, binding and samplers arrays.
             rfree( v_descriptor_set->resources, gpu_device->allocator );
         }
-        descriptor_sets.release_resource( i );
     }
+    descriptor_sets.free_all_resources();
 }
 
 static const u32 k_descriptor_sets_pool_size = 4096;
@@ -106,9 +108,28 @@ void CommandBuffer::begin() {
 void CommandBuffer::begin_secondary( RenderPass* current_render_pass_, Framebuffer* current_framebuffer_ ) {
     if ( !is_recording ) {
         VkCommandBufferInheritanceInfo inheritance{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
-        inheritance.renderPass = current_render_pass_->vk_render_pass;
         inheritance.subpass = 0;
-        inheritance.framebuffer = current_framebuffer_->vk_framebuffer;
+
+        // With dynamic rendering there is no render pass object, the attachment formats are inherited instead.
+        VkCommandBufferInheritanceRenderingInfoKHR rendering_inheritance{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR };
+        if ( gpu_device->dynamic_rendering_extension_present ) {
+            rendering_inheritance.viewMask = current_render_pass_->multiview_mask;
+            rendering_inheritance.colorAttachmentCount = current_render_pass_->output.num_color_formats;
+            rendering_inheritance.pColorAttachmentFormats = current_render_pass_->output.color_formats;
+            rendering_inheritance.depthAttachmentFormat = current_render_pass_->output.depth_stencil_format;
+            rendering_inheritance.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+            rendering_inheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+            inheritance.pNext = &rendering_inheritance;
+        } else {
+            inheritance.renderPass = current_render_pass_->vk_render_pass;
+            inheritance.framebuffer = current_framebuffer_->vk_framebuffer;
+        }
+
+        // The primary command buffer has the pipeline statistics query active.
+        if ( gpu_device->inherited_queries_present ) {
+            inheritance.pipelineStatistics = k_pipeline_statistics_flags;
+        }
 
         VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
         beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
@@ -119,6 +140,7 @@ void CommandBuffer::begin_secondary( RenderPass* current_render_pass_, Framebuff
         is_recording = true;
 
         current_render_pass = current_render_pass_;
+        current_framebuffer = current_framebuffer_;
     }
 }
 
@@ -143,6 +165,18 @@ void CommandBuffer::end_current_render_pass() {
     }
 }
 
+void CommandBuffer::execute_secondary( CommandBuffer** secondary_command_buffers, u32 count ) {
+    VkCommandBuffer vk_command_buffers[ k_secondary_command_buffers_count ];
+    RASSERT( count <= k_secondary_command_buffers_count );
+
+    for ( u32 i = 0; i < count; ++i ) {
+        RASSERT( secondary_command_buffers[ i ]->is_secondary && !secondary_command_buffers[ i ]->is_recording );
+        vk_command_buffers[ i ] = secondary_command_buffers[ i ]->vk_command_buffer;
+    }
+
+    vkCmdExecuteCommands( vk_command_buffer, count, vk_command_buffers );
+}
+
 void CommandBuffer::bind_pass( RenderPassHandle handle_, FramebufferHandle framebuffer_, bool use_secondary ) {
 
     //if ( !is_recording )
@@ -606,7 +640,8 @@ void CommandBuffer::issue_buffer_barrier( BufferHandle buffer_handle, ResourceSt
 
 void CommandBuffer::issue_texture_barrier( TextureHandle texture_handle, ResourceState new_state, u32 mip_level, u32 mip_count ) {
     Texture* texture = gpu_device->access_texture( texture_handle );
-    util_add_image_barrier( gpu_device, vk_command_buffer, texture, new_state, mip_level, mip_count, TextureFormat::has_depth( texture->vk_format ) );
+    util_add_image_barrier_ext( gpu_device, vk_command_buffer, texture, new_state, mip_level, mip_count, 0, 1, TextureFormat::has_depth( texture->vk_format ),
+                                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, queue_type, queue_type );
 }
 //
 //void CommandBuffer::barrier( const ExecutionBarrier& barrier ) {
@@ -700,8 +735,12 @@ void CommandBuffer::fill_buffer( BufferHandle buffer, u32 offset, u32 size, u32
 
 void CommandBuffer::push_marker( const char* name ) {
 
-    GPUTimeQuery* time_query = thread_frame_pool->time_queries->push( name );
-    vkCmdWriteTimestamp( vk_command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, thread_frame_pool->vulkan_timestamp_query_pool, time_query->start_query_index );
+    // NOTE: timestamp queries are reset by the primary command buffer of the pool, so
+    // secondary and async compute command buffers only get debug labels. Timings come from the primary markers.
+    if ( !is_secondary && queue_type == QueueType::Graphics ) {
+        GPUTimeQuery* time_query = thread_frame_pool->time_queries->push( name );
+        vkCmdWriteTimestamp( vk_command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, thread_frame_pool->vulkan_timestamp_query_pool, time_query->start_query_index );
+    }
 
     if ( !gpu_device->debug_utils_extension_present )
         return;
@@ -712,8 +751,10 @@ void CommandBuffer::push_marker( const char* name ) {
 void CommandBuffer::pop_marker() {
 
     //device->pop_gpu_timestamp( this );
-    GPUTimeQuery* time_query = thread_frame_pool->time_queries->pop();
-    vkCmdWriteTimestamp( vk_command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, thread_frame_pool->vulkan_timestamp_query_pool, time_query->end_query_index );
+    if ( !is_secondary && queue_type == QueueType::Graphics ) {
+        GPUTimeQuery* time_query = thread_frame_pool->time_queries->pop();
+        vkCmdWriteTimestamp( vk_command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, thread_frame_pool->vulkan_timestamp_query_pool, time_query->end_query_index );
+    }
 
     if ( !gpu_device->debug_utils_extension_present )
         return;
@@ -730,32 +771,61 @@ void CommandBuffer::upload_texture_data( TextureHandle texture_handle, void* tex
 
     Texture* texture = gpu_device->access_texture( texture_handle );
     Buffer* staging_buffer = gpu_device->access_buffer( staging_buffer_handle );
-    u32 image_size = texture->width * texture->height * 4;
+
+    const bool block_compressed = TextureFormat::is_block_compressed( texture->vk_format );
+    const u32 mip_count = block_compressed ? texture->mip_level_count : 1;
+    const sizet image_size = block_compressed ? TextureFormat::block_compressed_size( texture->vk_format, texture->width, texture->height, mip_count ) : texture->width * texture->height * 4;
 
     // Copy buffer_data to staging buffer
-    memcpy( staging_buffer->mapped_data + staging_buffer_offset, texture_data, static_cast< size_t >( image_size ) );
+    memcpy( staging_buffer->mapped_data + staging_buffer_offset, texture_data, image_size );
 
-    VkBufferImageCopy region = {};
-    region.bufferOffset = staging_buffer_offset;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
+    upload_texture_data( texture_handle, staging_buffer_handle, staging_buffer_offset );
+}
 
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
+void CommandBuffer::upload_texture_data( TextureHandle texture_handle, BufferHandle staging_buffer_handle, sizet staging_buffer_offset ) {
 
-    region.imageOffset = { 0, 0, 0 };
-    region.imageExtent = { texture->width, texture->height, texture->depth };
+    Texture* texture = gpu_device->access_texture( texture_handle );
+    Buffer* staging_buffer = gpu_device->access_buffer( staging_buffer_handle );
+
+    // Block compressed textures come with their whole mip chain, packed from the base level.
+    const bool block_compressed = TextureFormat::is_block_compressed( texture->vk_format );
+    const u32 mip_count = block_compressed ? texture->mip_level_count : 1;
+
+    VkBufferImageCopy regions[ 16 ];
+    RASSERT( mip_count <= ArraySize( regions ) );
+
+    sizet mip_offset = staging_buffer_offset;
+    for ( u32 mip = 0; mip < mip_count; ++mip ) {
+        const u32 mip_width = max( texture->width >> mip, 1 );
+        const u32 mip_height = max( texture->height >> mip, 1 );
+
+        VkBufferImageCopy& region = regions[ mip ];
+        region = {};
+        region.bufferOffset = mip_offset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = mip;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+
+        region.imageOffset = { 0, 0, 0 };
+        region.imageExtent = { mip_width, mip_height, texture->depth };
+
+        if ( block_compressed ) {
+            mip_offset += TextureFormat::block_compressed_size( texture->vk_format, mip_width, mip_height );
+        }
+    }
 
     // Pre copy memory barrier to perform layout transition
-    util_add_image_barrier( gpu_device, vk_command_buffer, texture, RESOURCE_STATE_COPY_DEST, 0, 1, false );
+    util_add_image_barrier( gpu_device, vk_command_buffer, texture, RESOURCE_STATE_COPY_DEST, 0, mip_count, false );
     // Copy from the staging buffer to the image
-    vkCmdCopyBufferToImage( vk_command_buffer, staging_buffer->vk_buffer, texture->vk_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region );
+    vkCmdCopyBufferToImage( vk_command_buffer, staging_buffer->vk_buffer, texture->vk_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_count, regions );
 
-    // Post copy memory barrier
-    util_add_image_barrier_ext( gpu_device,vk_command_buffer, texture, RESOURCE_STATE_COPY_SOURCE,
-                                0, 1, 0, 1, false, gpu_device->vulkan_transfer_queue_family, gpu_device->vulkan_main_queue_family,
+    // Post copy memory barrier: mips are generated on the main queue, unless they are already uploaded.
+    util_add_image_barrier_ext( gpu_device,vk_command_buffer, texture, block_compressed ? RESOURCE_STATE_SHADER_RESOURCE : RESOURCE_STATE_COPY_SOURCE,
+                                0, mip_count, 0, 1, false, gpu_device->vulkan_transfer_queue_family, gpu_device->vulkan_main_queue_family,
                                 QueueType::CopyTransfer, QueueType::Graphics );
 }
 
@@ -915,6 +985,17 @@ void CommandBuffer::copy_buffer( BufferHandle src, sizet src_offset, BufferHandl
     vkCmdCopyBuffer( vk_command_buffer, src_buffer->vk_buffer, dst_buffer->vk_buffer, 1, &copy_region );
 }
 
+void CommandBuffer::copy_buffer( BufferHandle src, BufferHandle dst, const VkBufferCopy* regions, u32 num_regions ) {
+    if ( num_regions == 0 ) {
+        return;
+    }
+
+    Buffer* src_buffer = gpu_device->access_buffer( src );
+    Buffer* dst_buffer = gpu_device->access_buffer( dst );
+
+    vkCmdCopyBuffer( vk_command_buffer, src_buffer->vk_buffer, dst_buffer->vk_buffer, num_regions, regions );
+}
+
 void CommandBuffer::upload_buffer_data( BufferHandle buffer_handle, void* buffer_data, BufferHandle staging_buffer_handle, sizet staging_buffer_offset ) {
 
     Buffer* buffer = gpu_device->access_buffer( buffer_handle );
@@ -963,10 +1044,12 @@ void CommandBufferManager::init( GpuDevice* gpu_, u32 num_threads ) {
     // Init per thread-frame used buffers
     used_buffers.init( gpu->allocator, total_pools, total_pools );
     used_secondary_command_buffers.init( gpu->allocator, total_pools, total_pools );
+    used_compute_command_buffers.init( gpu->allocator, total_pools, total_pools );
 
     for ( u32 i = 0; i < total_pools; i++ ) {
         used_buffers[ i ] = 0;
         used_secondary_command_buffers[ i ] = 0;
+        used_compute_command_buffers[ i ] = 0;
     }
 
     // Create command buffers: pools * buffers per pool
@@ -989,6 +1072,8 @@ void CommandBufferManager::init( GpuDevice* gpu_, u32 num_threads ) {
 
         CommandBuffer& current_command_buffer = command_buffers[ i ];
         vkAllocateCommandBuffers( gpu->vulkan_device, &cmd, &current_command_buffer.vk_command_buffer );
+        current_command_buffer.is_secondary = false;
+        current_command_buffer.queue_type = QueueType::Graphics;
 
         // TODO(marco): move to have a ring per queue per thread
         current_command_buffer.handle = i;
@@ -1013,6 +1098,8 @@ void CommandBufferManager::init( GpuDevice* gpu_, u32 num_threads ) {
 
             cb.handle = handle++;
             cb.thread_frame_pool = &gpu->thread_frame_pools[ pool_index ];
+            cb.is_secondary = true;
+            cb.queue_type = QueueType::Graphics;
             cb.init( gpu );
 
             // NOTE(marco): access to the descriptor pool has to be synchronized
@@ -1021,6 +1108,34 @@ void CommandBufferManager::init( GpuDevice* gpu_, u32 num_threads ) {
         }
     }
 
+    // Primary command buffers for frame graph nodes running on the async compute queue.
+    const u32 total_compute_buffers = total_pools * GpuDevice::k_max_async_compute_command_buffers;
+    compute_command_buffers.init( gpu->allocator, total_compute_buffers );
+
+    for ( u32 pool_index = 0; pool_index < total_pools; ++pool_index ) {
+        VkCommandBufferAllocateInfo cmd = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, nullptr };
+
+        cmd.commandPool = gpu->thread_frame_pools[ pool_index ].vulkan_compute_command_pool;
+        cmd.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cmd.commandBufferCount = GpuDevice::k_max_async_compute_command_buffers;
+
+        VkCommandBuffer compute_buffers[ GpuDevice::k_max_async_compute_command_buffers ];
+        vkAllocateCommandBuffers( gpu->vulkan_device, &cmd, compute_buffers );
+
+        for ( u32 ccb_index = 0; ccb_index < GpuDevice::k_max_async_compute_command_buffers; ++ccb_index ) {
+            CommandBuffer cb{ };
+            cb.vk_command_buffer = compute_buffers[ ccb_index ];
+
+            cb.handle = handle++;
+            cb.thread_frame_pool = &gpu->thread_frame_pools[ pool_index ];
+            cb.is_secondary = false;
+            cb.queue_type = QueueType::Compute;
+            cb.init( gpu );
+
+            compute_command_buffers.push( cb );
+        }
+    }
+
     //rprint( "Done\n" );
 }
 
@@ -1034,10 +1149,16 @@ void CommandBufferManager::shutdown() {
         secondary_command_buffers[ i ].shutdown();
     }
 
+    for ( u32 i = 0; i < compute_command_buffers.size; ++i ) {
+        compute_command_buffers[ i ].shutdown();
+    }
+
     command_buffers.shutdown();
     secondary_command_buffers.shutdown();
+    compute_command_buffers.shutdown();
     used_buffers.shutdown();
     used_secondary_command_buffers.shutdown();
+    used_compute_command_buffers.shutdown();
 }
 
 void CommandBufferManager::reset_pools( u32 frame_index ) {
@@ -1045,9 +1166,11 @@ void CommandBufferManager::reset_pools( u32 frame_index ) {
     for ( u32 i = 0; i < num_pools_per_frame; i++ ) {
         const u32 pool_index = pool_from_indices( frame_index, i );
         vkResetCommandPool( gpu->vulkan_device, gpu->thread_frame_pools[ pool_index ].vulkan_command_pool, 0 );
+        vkResetCommandPool( gpu->vulkan_device, gpu->thread_frame_pools[ pool_index ].vulkan_compute_command_pool, 0 );
 
         used_buffers[ pool_index ] = 0;
         used_secondary_command_buffers[ pool_index ] = 0;
+        used_compute_command_buffers[ pool_index ] = 0;
     }
 }
 
@@ -1074,6 +1197,7 @@ CommandBuffer* CommandBufferManager::get_command_buffer( u32 frame, u32 thread_i
         vkCmdResetQueryPool( cb->vk_command_buffer, thread_pools->vulkan_pipeline_stats_query_pool, 0, GpuPipelineStatistics::Count );
 
         vkCmdBeginQuery( cb->vk_command_buffer, thread_pools->vulkan_pipeline_stats_query_pool, 0, 0 );
+        cb->statistics_query_active = true;
     }
     return cb;
 }
@@ -1089,6 +1213,33 @@ CommandBuffer* CommandBufferManager::get_secondary_command_buffer( u32 frame, u3
     return cb;
 }
 
+CommandBuffer* CommandBufferManager::get_segment_command_buffer( CommandBuffer* command_buffer ) {
+    // Same thread and frame pool: the queries of the pool were already reset by the first command buffer.
+    const u32 pool_index = ( u32 )( command_buffer->thread_frame_pool - gpu->thread_frame_pools.data );
+    u32 current_used_buffer = used_buffers[ pool_index ];
+    RASSERT( current_used_buffer < num_command_buffers_per_thread );
+    used_buffers[ pool_index ] = current_used_buffer + 1;
+
+    CommandBuffer* cb = &command_buffers[ ( pool_index * num_command_buffers_per_thread ) + current_used_buffer ];
+    cb->reset();
+    cb->begin();
+
+    return cb;
+}
+
+CommandBuffer* CommandBufferManager::get_compute_command_buffer( CommandBuffer* command_buffer ) {
+    const u32 pool_index = ( u32 )( command_buffer->thread_frame_pool - gpu->thread_frame_pools.data );
+    u32 current_used_buffer = used_compute_command_buffers[ pool_index ];
+    RASSERT( current_used_buffer < GpuDevice::k_max_async_compute_command_buffers );
+    used_compute_command_buffers[ pool_index ] = current_used_buffer + 1;
+
+    CommandBuffer* cb = &compute_command_buffers[ ( pool_index * GpuDevice::k_max_async_compute_command_buffers ) + current_used_buffer ];
+    cb->reset();
+    cb->begin();
+
+    return cb;
+}
+
 u32 CommandBufferManager::pool_from_indices( u32 frame_index, u32 thread_index ) {
     return (frame_index * num_pools_per_frame) + thread_index;
 }
@@ -4,7 +4,7 @@
 
 namespace raptor {
 
-static const u32 k_secondary_command_buffers_count = 2;
+static const u32 k_secondary_command_buffers_count = 8;
 
 //
 //
@@ -23,6 +23,7 @@ struct CommandBuffer {
     void                            begin_secondary( RenderPass* current_render_pass, Framebuffer* current_framebuffer );
     void                            end();
     void                            end_current_render_pass();
+    void                            execute_secondary( CommandBuffer** secondary_command_buffers, u32 count );
 
     void                            bind_pass( RenderPassHandle handle, FramebufferHandle framebuffer, bool use_secondary );
     void                            bind_pipeline( PipelineHandle handle );
@@ -73,10 +74,13 @@ struct CommandBuffer {
 
     // Non-drawing methods
     void                            upload_texture_data( TextureHandle texture, void* texture_data, BufferHandle staging_buffer, sizet staging_buffer_offset );
+    // Texture data already written in the staging buffer at the offset.
+    void                            upload_texture_data( TextureHandle texture, BufferHandle staging_buffer, sizet staging_buffer_offset );
     void                            copy_texture( TextureHandle src, TextureHandle dst, ResourceState dst_state );
     void                            copy_texture( TextureHandle src, TextureSubResource src_sub, TextureHandle dst, TextureSubResource dst_sub, ResourceState dst_state );
 
     void                            copy_buffer( BufferHandle src, sizet src_offset, BufferHandle dst, sizet dst_offset, sizet size );
+    void                            copy_buffer( BufferHandle src, BufferHandle dst, const VkBufferCopy* regions, u32 num_regions );
 
     void                            upload_buffer_data( BufferHandle buffer, void* buffer_data, BufferHandle staging_buffer, sizet staging_buffer_offset );
     void                            upload_buffer_data( BufferHandle src, BufferHandle dst );
@@ -100,6 +104,11 @@ struct CommandBuffer {
     Pipeline*                       current_pipeline;
     VkClearValue                    clear_values[ k_max_image_outputs + 1 ];    // Clear value for each attachment with depth/stencil at the end.
     bool                            is_recording;
+    bool                            is_secondary;
+    bool                            statistics_query_active;    // Pipeline statistics query begun in this command buffer.
+
+    QueueType::Enum                 queue_type;
+    u32                             queue_wait_count;           // Command buffers queued on the other queue this frame to wait for before executing.
 
     u32                             handle;
 
@@ -118,18 +127,22 @@ struct CommandBufferManager {
 
     CommandBuffer*          get_command_buffer( u32 frame, u32 thread_index, bool begin );
     CommandBuffer*          get_secondary_command_buffer( u32 frame, u32 thread_index );
+    CommandBuffer*          get_segment_command_buffer( CommandBuffer* command_buffer );
+    CommandBuffer*          get_compute_command_buffer( CommandBuffer* command_buffer );
 
     u16                     pool_from_index( u32 index ) { return (u16)index / num_pools_per_frame; }
     u32                     pool_from_indices( u32 frame_index, u32 thread_index );
 
     Array<CommandBuffer>    command_buffers;
     Array<CommandBuffer>    secondary_command_buffers;
+    Array<CommandBuffer>    compute_command_buffers;
     Array<u8>               used_buffers;       // Track how many buffers were used per thread per frame.
     Array<u8>               used_secondary_command_buffers;
+    Array<u8>               used_compute_command_buffers;
 
     GpuDevice*              gpu                     = nullptr;
     u32                     num_pools_per_frame     = 0;
-    u32                     num_command_buffers_per_thread = 3;
+    u32                     num_command_buffers_per_thread = 12;
 
 }; // struct CommandBufferManager
 
@@ -3,6 +3,7 @@
 #include "foundation/file.hpp"
 #include "foundation/memory.hpp"
 #include "foundation/string.hpp"
+#include "foundation/time.hpp"
 
 #include "graphics/command_buffer.hpp"
 #include "graphics/gpu_device.hpp"
@@ -58,6 +59,16 @@ RenderPassOperation::Enum string_to_render_pass_operation( cstring op ) {
     return RenderPassOperation::DontCare;
 }
 
+static FrameGraphQueue::Enum string_to_queue( cstring queue ) {
+    if ( strcmp( queue, "graphics" ) == 0 ) {
+        return FrameGraphQueue::Graphics;
+    } else if ( strcmp( queue, "async_compute" ) == 0 ) {
+        return FrameGraphQueue::AsyncCompute;
+    }
+
+    return FrameGraphQueue::Auto;
+}
+
 // FrameGraph /////////////////////////////////////////////////////////////
 
 void FrameGraph::init( FrameGraphBuilder* builder_ ) {
@@ -69,6 +80,11 @@ void FrameGraph::init( FrameGraphBuilder* builder_ ) {
 
     nodes.init( allocator, FrameGraphBuilder::k_max_nodes_count );
     all_nodes.init( allocator, FrameGraphBuilder::k_max_nodes_count );
+
+    memory_plan.init( allocator );
+    barrier_plan.init( allocator );
+    recording_plan.init( allocator );
+    queue_schedule.init( allocator );
 }
 
 void FrameGraph::shutdown() {
@@ -76,8 +92,10 @@ void FrameGraph::shutdown() {
         FrameGraphNodeHandle handle = all_nodes[ i ];
         FrameGraphNode* node = builder->access_node( handle );
 
-        builder->device->destroy_render_pass( node->render_pass );
-        builder->device->destroy_framebuffer( node->framebuffer );
+        if ( builder->device ) {
+            builder->device->destroy_render_pass( node->render_pass );
+            builder->device->destroy_framebuffer( node->framebuffer );
+        }
 
         node->inputs.shutdown();
         node->outputs.shutdown();
@@ -87,6 +105,16 @@ void FrameGraph::shutdown() {
     all_nodes.shutdown();
     nodes.shutdown();
 
+    memory_plan.shutdown();
+
+    if ( builder->device ) {
+        barrier_plan.destroy_events( builder->device );
+    }
+    barrier_plan.shutdown();
+
+    recording_plan.shutdown();
+    queue_schedule.shutdown();
+
     local_allocator.shutdown();
 }
 
@@ -110,6 +138,11 @@ void FrameGraph::parse( cstring file_path, StackAllocator* temp_allocator ) {
     std::string name_value = graph_data.value( "name", "" );
     name = string_buffer.append_use_f( "%s", name_value.c_str() );
 
+    transient_aliasing = graph_data.value( "transient_aliasing", true );
+    split_barriers = graph_data.value( "split_barriers", false );
+    parallel_recording = graph_data.value( "parallel_recording", false );
+    async_compute = graph_data.value( "async_compute", false );
+
     json passes = graph_data[ "passes" ];
     for ( sizet i = 0; i < passes.size(); ++i ) {
         json pass = passes[ i ];
@@ -125,6 +158,9 @@ void FrameGraph::parse( cstring file_path, StackAllocator* temp_allocator ) {
         node_creation.compute = node_type.compare( "compute" ) == 0;
         node_creation.ray_tracing = node_type.compare( "ray_tracing" ) == 0;
 
+        std::string node_queue = pass.value( "queue", "" );
+        node_creation.queue = string_to_queue( node_queue.c_str() );
+
         for ( sizet ii = 0; ii < pass_inputs.size(); ++ii ) {
             json pass_input = pass_inputs[ ii ];
 
@@ -207,6 +243,9 @@ void FrameGraph::parse( cstring file_path, StackAllocator* temp_allocator ) {
                     
                     output_creation.resource_info.texture.compute = node_creation.compute;
 
+                    // NOTE: loaded attachments keep their content between frames, so their memory can't be reused.
+                    output_creation.resource_info.texture.aliasable = pass_output.value( "alias", true ) && output_creation.resource_info.texture.load_op != RenderPassOperation::Load;
+
                     // Parse depth/stencil values
                     if ( TextureFormat::has_depth( output_creation.resource_info.texture.format ) ) {
                         output_creation.resource_info.texture.clear_values[ 0 ] = pass_output.value( "clear_depth", 1.0f );
@@ -457,6 +496,184 @@ void FrameGraph::disable_render_pass( cstring render_pass_name ) {
     node->enabled = false;
 }
 
+// Transient memory //////////////////////////////////////////////////////
+
+// Attachments created and owned by the graph, external resources and the textures
+// managed by the render passes are not part of the transient memory.
+static bool is_transient_texture( FrameGraphResource* resource ) {
+    return resource != nullptr && resource->type == FrameGraphResourceType_Attachment && !resource->resource_info.external;
+}
+
+static void fill_transient_texture_creation( FrameGraphResource* resource, TextureCreation& texture_creation ) {
+    FrameGraphResourceInfo& info = resource->resource_info;
+
+    TextureFlags::Mask texture_creation_flags = info.texture.compute ? ( TextureFlags::Mask )(TextureFlags::RenderTarget_mask | TextureFlags::Compute_mask) : TextureFlags::RenderTarget_mask;
+    texture_creation.set_data( nullptr ).set_name( resource->name ).set_format_type( info.texture.format, TextureType::Enum::Texture2D ).set_size( info.texture.width, info.texture.height, info.texture.depth ).set_flags( texture_creation_flags );
+}
+
+// Without a device sizes come from the texel size of the format, aligned as most drivers align render targets.
+static void estimate_texture_memory_requirements( const TextureCreation& creation, FrameGraphTransientResource& transient ) {
+    u32 texel_size = 4;
+    switch ( creation.format ) {
+        case VK_FORMAT_R8_UNORM:
+        case VK_FORMAT_R8_UINT:
+            texel_size = 1;
+            break;
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_R16_SFLOAT:
+            texel_size = 2;
+            break;
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+        case VK_FORMAT_R32G32_SFLOAT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            texel_size = 8;
+            break;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            texel_size = 16;
+            break;
+        default:
+            break;
+    }
+
+    const sizet k_alignment = rkilo( 64 );
+    transient.size = memory_align( ( sizet )creation.width * creation.height * creation.depth * texel_size, k_alignment );
+    transient.alignment = k_alignment;
+    transient.memory_type_bits = 0xffffffff;
+}
+
+void FrameGraph::plan_transient_memory( u32 width, u32 height ) {
+    memory_plan.resources.clear();
+
+    // Lifetimes over the nodes in execution order.
+    for ( u32 i = 0; i < nodes.size; ++i ) {
+        FrameGraphNode* node = builder->access_node( nodes[ i ] );
+
+        for ( u32 o = 0; o < node->outputs.size; ++o ) {
+            FrameGraphResource* resource = builder->access_resource( node->outputs[ o ] );
+            if ( !is_transient_texture( resource ) ) {
+                continue;
+            }
+
+            FrameGraphResourceInfo& info = resource->resource_info;
+
+            // Resolve texture size if needed
+            const bool relative_size = info.texture.scale_width > 0.f && info.texture.scale_height > 0.f;
+            if ( relative_size ) {
+                info.texture.width = ( u32 )( width * info.texture.scale_width );
+                info.texture.height = ( u32 )( height * info.texture.scale_height );
+            }
+
+            FrameGraphTransientResource& transient = memory_plan.resources.push_use();
+            transient.handle = node->outputs[ o ];
+            transient.first_node = i;
+            transient.last_node = k_invalid_index;
+            transient.heap = k_invalid_index;
+            transient.relative_size = relative_size;
+            transient.aliasable = info.texture.aliasable;
+
+            TextureCreation texture_creation{ };
+            fill_transient_texture_creation( resource, texture_creation );
+
+            if ( builder->device ) {
+                VkMemoryRequirements requirements;
+                builder->device->query_texture_memory_requirements( texture_creation, requirements );
+
+                transient.size = requirements.size;
+                transient.alignment = requirements.alignment;
+                transient.memory_type_bits = requirements.memoryTypeBits;
+            } else {
+                estimate_texture_memory_requirements( texture_creation, transient );
+            }
+        }
+
+        for ( u32 j = 0; j < node->inputs.size; ++j ) {
+            FrameGraphResource* input_resource = builder->access_resource( node->inputs[ j ] );
+
+            for ( u32 t = 0; t < memory_plan.resources.size; ++t ) {
+                FrameGraphTransientResource& transient = memory_plan.resources[ t ];
+                if ( transient.handle.index == input_resource->output_handle.index ) {
+                    transient.last_node = i;
+                    break;
+                }
+            }
+        }
+    }
+
+    // NOTE: resources without readers in the graph are accessed by name from the render passes,
+    // keep them alive until the end of the frame.
+    for ( u32 t = 0; t < memory_plan.resources.size; ++t ) {
+        FrameGraphTransientResource& transient = memory_plan.resources[ t ];
+        if ( transient.last_node == k_invalid_index ) {
+            transient.last_node = nodes.size - 1;
+        }
+    }
+
+    memory_plan.node_count = nodes.size;
+    memory_plan.alias_resources( transient_aliasing );
+}
+
+void FrameGraph::create_transient_resources() {
+    GpuDevice* gpu = builder->device;
+
+    // Heap owners first, the memory they allocate is aliased by the other resources.
+    for ( u32 h = 0; h < memory_plan.heaps.size; ++h ) {
+        FrameGraphResource* resource = builder->access_resource( memory_plan.heaps[ h ].owner );
+
+        TextureCreation texture_creation{ };
+        fill_transient_texture_creation( resource, texture_creation );
+        resource->resource_info.texture.handle = gpu->create_texture( texture_creation );
+    }
+
+    for ( u32 t = 0; t < memory_plan.resources.size; ++t ) {
+        FrameGraphTransientResource& transient = memory_plan.resources[ t ];
+        FrameGraphMemoryHeap& heap = memory_plan.heaps[ transient.heap ];
+        if ( heap.owner.index == transient.handle.index ) {
+            continue;
+        }
+
+        FrameGraphResource* owner = builder->access_resource( heap.owner );
+        FrameGraphResource* resource = builder->access_resource( transient.handle );
+
+        TextureCreation texture_creation{ };
+        fill_transient_texture_creation( resource, texture_creation );
+        texture_creation.set_alias( owner->resource_info.texture.handle );
+        resource->resource_info.texture.handle = gpu->create_texture( texture_creation );
+
+#if FRAME_GRAPH_DEBUG
+        rprint( "Output %s aliases %s\n", resource->name, owner->name );
+#endif
+    }
+}
+
+void FrameGraph::resize_transient_resources( u32 width, u32 height ) {
+    GpuDevice* gpu = builder->device;
+
+    plan_transient_memory( width, height );
+
+    // Resources with a fixed size are planned separately from the relative ones, their heaps did not change.
+    for ( u32 h = 0; h < memory_plan.heaps.size; ++h ) {
+        FrameGraphMemoryHeap& heap = memory_plan.heaps[ h ];
+        if ( !heap.relative_size ) {
+            continue;
+        }
+
+        FrameGraphResource* resource = builder->access_resource( heap.owner );
+        gpu->resize_aliased_texture( resource->resource_info.texture.handle, resource->resource_info.texture.width, resource->resource_info.texture.height, k_invalid_texture );
+    }
+
+    for ( u32 t = 0; t < memory_plan.resources.size; ++t ) {
+        FrameGraphTransientResource& transient = memory_plan.resources[ t ];
+        FrameGraphMemoryHeap& heap = memory_plan.heaps[ transient.heap ];
+        if ( !heap.relative_size || heap.owner.index == transient.handle.index ) {
+            continue;
+        }
+
+        FrameGraphResource* owner = builder->access_resource( heap.owner );
+        FrameGraphResource* resource = builder->access_resource( transient.handle );
+        gpu->resize_aliased_texture( resource->resource_info.texture.handle, resource->resource_info.texture.width, resource->resource_info.texture.height, owner->resource_info.texture.handle );
+    }
+}
+
 namespace FrameGraphNodeVisitStatus {
     enum Enum {
         New = 0, Visited, Added, Count
@@ -557,144 +774,36 @@ void FrameGraph::compile() {
     stack.shutdown();
     sorted_nodes.shutdown();
 
-    // NOTE(marco): allocations and deallocations are used for verification purposes only
-    u32 resource_count = builder->resource_cache.resources.used_indices;
-    Array<FrameGraphNodeHandle> allocations;
-    allocations.init( &local_allocator, resource_count, resource_count );
-    for ( u32 i = 0; i < resource_count; ++i) {
-        allocations[ i ].index = k_invalid_index;
+    if ( builder->device ) {
+        plan_transient_memory( builder->device->swapchain_width, builder->device->swapchain_height );
+    } else {
+        plan_transient_memory( builder->headless_width, builder->headless_height );
     }
 
-    Array<FrameGraphNodeHandle> deallocations;
-    deallocations.init( &local_allocator, resource_count, resource_count );
-    for ( u32 i = 0; i < resource_count; ++i) {
-        deallocations[ i ].index = k_invalid_index;
-    }
-
-    Array<TextureHandle> free_list;
-    free_list.init( &local_allocator, resource_count );
-
-    size_t peak_memory = 0;
-    size_t instant_memory = 0;
-
-    for ( u32 i = 0; i < nodes.size; ++i ) {
-        FrameGraphNode* node = builder->access_node( nodes[ i ] );
-        if ( !node->enabled ) {
-            continue;
-        }
-
-        for ( u32 j = 0; j < node->inputs.size; ++j ) {
-            FrameGraphResource* input_resource = builder->access_resource( node->inputs[ j ] );
-            FrameGraphResource* resource = builder->access_resource( input_resource->output_handle );
+    queue_schedule.build( this, async_compute );
 
-            if ( resource == nullptr ) {
-                continue;
-            }
+    // Headless graphs stop here, there is no device to create resources.
+    if ( builder->device == nullptr ) {
+        barrier_plan.build( this, split_barriers );
 
-            resource->ref_count++;
-        }
+        memory_plan.print_report( this );
+        barrier_plan.print( this );
+        queue_schedule.print( this );
+        return;
     }
 
-    for ( u32 i = 0; i < nodes.size; ++i ) {
-        FrameGraphNode* node = builder->access_node( nodes[ i ] );
-        if ( !node->enabled ) {
-            continue;
-        }
-
-        for ( u32 j = 0; j < node->outputs.size; ++j ) {
-            u32 resource_index = node->outputs[ j ].index;
-            FrameGraphResource* resource = builder->access_resource( node->outputs[ j ] );
-
-            if ( !resource->resource_info.external && allocations[ resource_index ].index == k_invalid_index ) {
-                RASSERT( deallocations[ resource_index ].index == k_invalid_index )
-                allocations[ resource_index ] = nodes[ i ];
-
-                if ( resource->type == FrameGraphResourceType_Attachment ) {
-                    FrameGraphResourceInfo& info = resource->resource_info;
-
-                    // Resolve texture size if needed
-                    if ( info.texture.width == 0 || info.texture.height == 0 ) {
-                        info.texture.width = builder->device->swapchain_width * info.texture.scale_width;
-                        info.texture.height = builder->device->swapchain_height * info.texture.scale_height;
-                    }
-
-                    TextureFlags::Mask texture_creation_flags = info.texture.compute ? ( TextureFlags::Mask )(TextureFlags::RenderTarget_mask | TextureFlags::Compute_mask) : TextureFlags::RenderTarget_mask;
-
-                    bool found_suitable_free_resource = false;
-                    if ( free_list.size > 0 ) {
-                        for ( u32 r = 0; r < free_list.size; ++r ) {
-                            TextureHandle alias_texture_handle = free_list[ r ];
-                            Texture* alias_texture = builder->device->access_texture( alias_texture_handle );
-
-                            if ( alias_texture->width != info.texture.width ||
-                                 alias_texture->height != info.texture.height ||
-                                 alias_texture->vk_format != info.texture.format ) {
-                                continue;
-                            }
-
-                            // NOTE(marco): this texture has already been aliased, get original image
-                            if ( alias_texture->alias_texture.index != k_invalid_index ) {
-                                alias_texture_handle = alias_texture->alias_texture;
-                                alias_texture = builder->device->access_texture( alias_texture_handle );
-                            }
-
-                            TextureCreation texture_creation{ };
-                            texture_creation.set_data( nullptr ).set_alias( alias_texture_handle ).set_name( resource->name ).set_format_type( info.texture.format, TextureType::Enum::Texture2D ).set_size( info.texture.width, info.texture.height, info.texture.depth ).set_flags( texture_creation_flags );
-                            TextureHandle handle = builder->device->create_texture( texture_creation );
-
-                            info.texture.handle = handle;
-
-                            free_list.delete_swap( r );
-                            found_suitable_free_resource = true;
-                            break;
-                        }
-                    }
-
-                    if ( !found_suitable_free_resource ) {
-                        TextureCreation texture_creation{ };
-                        texture_creation.set_data( nullptr ).set_name( resource->name ).set_format_type( info.texture.format, TextureType::Enum::Texture2D ).set_size( info.texture.width, info.texture.height, info.texture.depth ).set_flags( texture_creation_flags );
-                        TextureHandle handle = builder->device->create_texture( texture_creation );
-
-                        info.texture.handle = handle;
-                    }
-                }
-
-#if FRAME_GRAPH_DEBUG
-                rprint( "Output %s allocated on node %d\n", resource->name, nodes[ i ].index );
-#endif
-            }
-        }
-
-        for ( u32 j = 0; j < node->inputs.size; ++j ) {
-            FrameGraphResource* input_resource = builder->access_resource( node->inputs[ j ] );
-
-            u32 resource_index = input_resource->output_handle.index;
-            FrameGraphResource* resource = builder->access_resource( input_resource->output_handle );
-
-            if ( resource == nullptr ) {
-                continue;
-            }
-
-            resource->ref_count--;
-
-            if ( !resource->resource_info.external && resource->ref_count == 0 ) {
-                RASSERT( deallocations[ resource_index ].index == k_invalid_index );
-                deallocations[ resource_index ] = nodes[ i ];
-
-                if ( resource->type == FrameGraphResourceType_Attachment || resource->type == FrameGraphResourceType_Texture ) {
-                    free_list.push( resource->resource_info.texture.handle );
-                }
+    // NOTE: split barriers use events with the synchronization2 dependency informations.
+    barrier_plan.destroy_events( builder->device );
+    barrier_plan.build( this, split_barriers && builder->device->synchronization2_extension_present );
+    barrier_plan.create_events( builder->device );
 
 #if FRAME_GRAPH_DEBUG
-                rprint( "Output %s deallocated on node %d\n", resource->name, nodes[ i ].index );
+    memory_plan.print_report( this );
+    barrier_plan.print( this );
+    queue_schedule.print( this );
 #endif
-            }
-        }
-    }
 
-    allocations.shutdown();
-    deallocations.shutdown();
-    free_list.shutdown();
+    create_transient_resources();
 
     for ( u32 i = 0; i < nodes.size; ++i ) {
         FrameGraphNode* node = builder->access_node( nodes[ i ] );
@@ -714,6 +823,21 @@ void FrameGraph::compile() {
     }
 }
 
+void FrameGraph::build_queue_schedule() {
+    GpuDevice* gpu = builder->device;
+
+    queue_schedule.build( this, async_compute );
+
+    // Queue transfers and split barriers depend on the queue of each node.
+    barrier_plan.destroy_events( gpu );
+    barrier_plan.build( this, split_barriers && gpu->synchronization2_extension_present );
+    barrier_plan.create_events( gpu );
+
+#if FRAME_GRAPH_DEBUG
+    queue_schedule.print( this );
+#endif
+}
+
 void FrameGraph::add_ui() {
     for ( u32 n = 0; n < nodes.size; ++n ) {
         FrameGraphNode* node = builder->access_node( nodes[ n ] );
@@ -723,67 +847,69 @@ void FrameGraph::add_ui() {
     }
 }
 
-void FrameGraph::render( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene )
+CommandBuffer* FrameGraph::render( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene )
 {
+    const i64 frame_start = time_now();
+
+    recording_plan.begin_frame( nodes.size );
+    if ( parallel_recording ) {
+        recording_plan.kick( current_frame_index, this, render_scene );
+    }
+
+    GpuDevice* gpu = gpu_commands->gpu_device;
+    CommandBuffer* compute_commands = nullptr;
+
     for ( u32 n = 0; n < nodes.size; ++n ) {
         ZoneScopedN("RenderPass");
 
+        const i64 node_start = time_now();
+
         FrameGraphNode* node = builder->access_node( nodes[ n ] );
         RASSERT( node->enabled );
 
-        if ( node->compute ) {
-            gpu_commands->push_marker( node->name );
-
-            for ( u32 i = 0; i < node->inputs.size; ++i ) {
-                FrameGraphResource* input_resource = builder->access_resource( node->inputs[ i ] );
-                FrameGraphResource* resource = builder->access_resource( input_resource->output_handle );
+        // The graphics work recorded so far is submitted on its own, for the async compute batches waiting for it.
+        if ( queue_schedule.node_splits[ n ] ) {
+            gpu->queue_command_buffer( gpu_commands );
 
-                if ( resource == nullptr || resource->resource_info.external ) {
-                    continue;
-                }
+            gpu_commands = gpu->get_segment_command_buffer( gpu_commands );
+            gpu_commands->queue_wait_count = queue_schedule.node_waits[ n ];
+        }
 
-                if ( input_resource->type == FrameGraphResourceType_Texture ) {
-                    Texture* texture = gpu_commands->gpu_device->access_texture( resource->resource_info.texture.handle );
+        CommandBuffer* node_commands = gpu_commands;
 
-                    util_add_image_barrier( gpu_commands->gpu_device, gpu_commands->vk_command_buffer, texture, RESOURCE_STATE_SHADER_RESOURCE, 0, 1, TextureFormat::has_depth(texture->vk_format) );
-                } else if ( input_resource->type == FrameGraphResourceType_Attachment ) {
-                    // TODO: what to do with attachments ?
-                    Texture* texture = gpu_commands->gpu_device->access_texture( resource->resource_info.texture.handle );
-                    texture = texture;
-                }
+        const u32 batch_index = queue_schedule.node_batches[ n ];
+        if ( batch_index != k_invalid_index ) {
+            if ( queue_schedule.batches[ batch_index ].first_node == n ) {
+                compute_commands = gpu->get_compute_command_buffer( gpu_commands );
+                compute_commands->queue_wait_count = queue_schedule.batches[ batch_index ].wait_segment;
             }
 
-            for ( u32 o = 0; o < node->outputs.size; ++o ) {
-                FrameGraphResource* resource = builder->access_resource( node->outputs[ o ] );
+            node_commands = compute_commands;
+        }
 
-                if ( resource->type == FrameGraphResourceType_Attachment ) {
-                    Texture* texture = gpu_commands->gpu_device->access_texture( resource->resource_info.texture.handle );
+        if ( node->compute ) {
+            node_commands->push_marker( node->name );
 
-                    if ( TextureFormat::has_depth( texture->vk_format ) ) {
-                        // Is this supported even ?
-                        RASSERT( false );
-                    } else {
-                        util_add_image_barrier( gpu_commands->gpu_device, gpu_commands->vk_command_buffer, texture, RESOURCE_STATE_UNORDERED_ACCESS, 0, 1, false );
-                    }
-                }
-            }
+            barrier_plan.add_node_barriers( n, current_frame_index, this, node_commands );
 
-            node->graph_render_pass->pre_render( current_frame_index, gpu_commands, this, render_scene );
-            node->graph_render_pass->render( current_frame_index, gpu_commands, render_scene );
-            node->graph_render_pass->post_render( current_frame_index, gpu_commands, this, render_scene );
+            node->graph_render_pass->pre_render( current_frame_index, node_commands, this, render_scene );
+            node->graph_render_pass->render( current_frame_index, node_commands, render_scene );
+            node->graph_render_pass->post_render( current_frame_index, node_commands, this, render_scene );
 
-            gpu_commands->pop_marker();
+            node_commands->pop_marker();
         } else if ( node->ray_tracing ) {
-            gpu_commands->push_marker( node->name );
+            node_commands->push_marker( node->name );
 
-            node->graph_render_pass->pre_render( current_frame_index, gpu_commands, this, render_scene );
-            node->graph_render_pass->render( current_frame_index, gpu_commands, render_scene );
-            node->graph_render_pass->post_render( current_frame_index, gpu_commands, this, render_scene );
+            node->graph_render_pass->pre_render( current_frame_index, node_commands, this, render_scene );
+            node->graph_render_pass->render( current_frame_index, node_commands, render_scene );
+            node->graph_render_pass->post_render( current_frame_index, node_commands, this, render_scene );
 
-            gpu_commands->pop_marker();
+            node_commands->pop_marker();
         }
         else {
-            gpu_commands->push_marker( node->name );
+            node_commands->push_marker( node->name );
+
+            barrier_plan.add_node_barriers( n, current_frame_index, this, node_commands );
 
             u32 width = 0;
             u32 height = 0;
@@ -796,23 +922,11 @@ void FrameGraph::render( u32 current_frame_index, CommandBuffer* gpu_commands, R
                     continue;
                 }
 
-                if ( input_resource->type == FrameGraphResourceType_Texture ) {
-                    Texture* texture = gpu_commands->gpu_device->access_texture( resource->resource_info.texture.handle );
-
-                    util_add_image_barrier( gpu_commands->gpu_device, gpu_commands->vk_command_buffer, texture, RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0, 1, TextureFormat::has_depth( texture->vk_format ) );
-                } else if ( input_resource->type == FrameGraphResourceType_Attachment ) {
-                    Texture* texture = gpu_commands->gpu_device->access_texture( resource->resource_info.texture.handle );
+                if ( input_resource->type == FrameGraphResourceType_Attachment ) {
+                    Texture* texture = node_commands->gpu_device->access_texture( resource->resource_info.texture.handle );
 
                     width = texture->width;
                     height = texture->height;
-
-                    // For textures that are read-write check if a transition is needed.
-                    if ( !TextureFormat::has_depth_or_stencil( texture->vk_format ) ) {
-                        util_add_image_barrier( gpu_commands->gpu_device, gpu_commands->vk_command_buffer, texture, RESOURCE_STATE_RENDER_TARGET, 0, 1, false );
-                    }
-                    else {
-                        util_add_image_barrier( gpu_commands->gpu_device, gpu_commands->vk_command_buffer, texture, RESOURCE_STATE_DEPTH_WRITE, 0, 1, true );
-                    }
                 }
             }
 
@@ -820,52 +934,69 @@ void FrameGraph::render( u32 current_frame_index, CommandBuffer* gpu_commands, R
                 FrameGraphResource* resource = builder->access_resource( node->outputs[ o ] );
 
                 if ( resource->type == FrameGraphResourceType_Attachment ) {
-                    Texture* texture = gpu_commands->gpu_device->access_texture( resource->resource_info.texture.handle );
+                    Texture* texture = node_commands->gpu_device->access_texture( resource->resource_info.texture.handle );
 
                     width = texture->width;
                     height = texture->height;
 
+                    f32* clear_color = resource->resource_info.texture.clear_values;
                     if ( TextureFormat::has_depth( texture->vk_format ) ) {
-                        util_add_image_barrier( gpu_commands->gpu_device, gpu_commands->vk_command_buffer, texture, RESOURCE_STATE_DEPTH_WRITE, 0, 1, true );
-
-                        f32* clear_color = resource->resource_info.texture.clear_values;
-                        gpu_commands->clear_depth_stencil( clear_color[ 0 ], ( u8 )clear_color[ 1 ] );
-
+                        node_commands->clear_depth_stencil( clear_color[ 0 ], ( u8 )clear_color[ 1 ] );
                     } else {
-                        util_add_image_barrier( gpu_commands->gpu_device, gpu_commands->vk_command_buffer, texture, RESOURCE_STATE_RENDER_TARGET, 0, 1, false );
-
-                        f32* clear_color = resource->resource_info.texture.clear_values;
-                        gpu_commands->clear( clear_color[ 0 ], clear_color[ 1 ], clear_color[ 2 ], clear_color[ 3 ], o );
+                        node_commands->clear( clear_color[ 0 ], clear_color[ 1 ], clear_color[ 2 ], clear_color[ 3 ], o );
                     }
                 }
             }
 
             Rect2DInt scissor{ 0, 0,( u16 )width, ( u16 )height };
-            gpu_commands->set_scissor( &scissor );
+            node_commands->set_scissor( &scissor );
 
             Viewport viewport{ };
             viewport.rect = { 0, 0, ( u16 )width, ( u16 )height };
             viewport.min_depth = 0.0f;
             viewport.max_depth = 1.0f;
 
-            gpu_commands->set_viewport( &viewport );
+            node_commands->set_viewport( &viewport );
 
-            node->graph_render_pass->pre_render( current_frame_index, gpu_commands, this, render_scene );
+            node->graph_render_pass->pre_render( current_frame_index, node_commands, this, render_scene );
 
-            gpu_commands->bind_pass( node->render_pass, node->framebuffer, false );
+            // The draws of parallel nodes are already being recorded, the render pass only executes them.
+            const bool parallel = recording_plan.is_parallel( n );
+            node_commands->bind_pass( node->render_pass, node->framebuffer, parallel );
 
-            node->graph_render_pass->render( current_frame_index, gpu_commands, render_scene );
+            if ( parallel ) {
+                recording_plan.execute_node( n, node_commands );
+            } else {
+                node->graph_render_pass->render( current_frame_index, node_commands, render_scene );
+            }
+
+            node_commands->end_current_render_pass();
+
+            node->graph_render_pass->post_render( current_frame_index, node_commands, this, render_scene );
 
-            gpu_commands->end_current_render_pass();
+            node_commands->pop_marker();
+        }
 
-            node->graph_render_pass->post_render( current_frame_index, gpu_commands, this, render_scene );
+        barrier_plan.signal_split_barriers( n, current_frame_index, this, node_commands );
+        barrier_plan.release_queue_transfers( n, this, node_commands );
 
-            gpu_commands->pop_marker();
+        if ( batch_index != k_invalid_index && queue_schedule.batches[ batch_index ].last_node == n ) {
+            gpu->queue_async_compute_command_buffer( compute_commands );
         }
+
+        FrameGraphNodeTiming& timing = recording_plan.node_timings[ n ];
+        timing.recording_ms += ( f32 )time_from_milliseconds( node_start ) - timing.wait_ms;
     }
+
+    recording_plan.end_frame( ( f32 )time_from_milliseconds( frame_start ) );
+
+    return gpu_commands;
 }
 
 void FrameGraph::on_resize( GpuDevice& gpu, u32 new_width, u32 new_height ) {
+    // Transient attachments are recreated together, as they share memory.
+    resize_transient_resources( new_width, new_height );
+
     for ( u32 n = 0; n < nodes.size; ++n ) {
         FrameGraphNode* node = builder->access_node( nodes[ n ] );
         RASSERT( node->enabled );
@@ -909,6 +1040,84 @@ void FrameGraph::debug_ui() {
             }
         }
     }
+
+    if ( ImGui::CollapsingHeader( "Transient memory" ) ) {
+        memory_plan.debug_ui( this );
+    }
+
+    if ( ImGui::CollapsingHeader( "Barriers" ) ) {
+        barrier_plan.debug_ui( this );
+    }
+
+    if ( ImGui::CollapsingHeader( "Recording" ) ) {
+        recording_plan.debug_ui( this );
+    }
+
+    if ( ImGui::CollapsingHeader( "Async compute" ) ) {
+        queue_schedule.debug_ui( this );
+    }
+
+    lookup_benchmark_ui();
+}
+
+// Measures the cost of looking up every node and resource of the graph by name,
+// as the render passes do each frame, with the hash computed from the string or precomputed.
+void FrameGraph::lookup_benchmark_ui() {
+    static f64 string_lookup_us = 0.0;
+    static f64 hashed_lookup_us = 0.0;
+    static u32 lookups_count = 0;
+
+    if ( !ImGui::CollapsingHeader( "Lookup hashing" ) ) {
+        return;
+    }
+
+    if ( ImGui::Button( "Run lookup benchmark" ) ) {
+        static const u32 k_iterations = 1000;
+
+        Array<cstring> names;
+        names.init( allocator, all_nodes.size * 4 );
+        for ( u32 n = 0; n < all_nodes.size; ++n ) {
+            FrameGraphNode* node = builder->access_node( all_nodes[ n ] );
+            names.push( node->name );
+            for ( u32 o = 0; o < node->outputs.size; ++o ) {
+                names.push( builder->access_resource( node->outputs[ o ] )->name );
+            }
+        }
+
+        Array<u64> hashes;
+        hashes.init( allocator, names.size, names.size );
+        for ( u32 i = 0; i < names.size; ++i ) {
+            hashes[ i ] = hash_calculate( names[ i ] );
+        }
+
+        // Accumulate results so that lookups are not optimized away.
+        uintptr_t found = 0;
+        i64 start = time_now();
+        for ( u32 it = 0; it < k_iterations; ++it ) {
+            for ( u32 i = 0; i < names.size; ++i ) {
+                found += ( uintptr_t )builder->get_resource( names[ i ] ) + ( uintptr_t )builder->get_node( names[ i ] );
+            }
+        }
+        string_lookup_us = time_from_microseconds( start ) / k_iterations;
+
+        start = time_now();
+        for ( u32 it = 0; it < k_iterations; ++it ) {
+            for ( u32 i = 0; i < names.size; ++i ) {
+                found -= ( uintptr_t )builder->get_resource( hashes[ i ] ) + ( uintptr_t )builder->get_node( hashes[ i ] );
+            }
+        }
+        hashed_lookup_us = time_from_microseconds( start ) / k_iterations;
+
+        RASSERT( found == 0 );
+        lookups_count = names.size * 2;
+
+        hashes.shutdown();
+        names.shutdown();
+    }
+
+    ImGui::Text( "%u lookups per frame", lookups_count );
+    ImGui::Text( "Hashing names: %.2f us per frame", string_lookup_us );
+    ImGui::Text( "Precomputed hashes: %.2f us per frame", hashed_lookup_us );
 }
 
 void FrameGraph::add_node( FrameGraphNodeCreation& creation ) {
@@ -920,6 +1129,10 @@ FrameGraphNode* FrameGraph::get_node( cstring name ) {
     return builder->get_node( name );
 }
 
+FrameGraphNode* FrameGraph::get_node( u64 name_hash ) {
+    return builder->get_node( name_hash );
+}
+
 FrameGraphNode* FrameGraph::access_node( FrameGraphNodeHandle handle ) {
     return builder->access_node( handle );
 }
@@ -932,46 +1145,1266 @@ FrameGraphResource* FrameGraph::get_resource( cstring name ) {
     return builder->get_resource( name );
 }
 
+FrameGraphResource* FrameGraph::get_resource( u64 name_hash ) {
+    return builder->get_resource( name_hash );
+}
+
 FrameGraphResource* FrameGraph::access_resource( FrameGraphResourceHandle handle ) {
     return builder->access_resource( handle );
 }
 
-// FrameGraphRenderPassCache /////////////////////////////////////////////////////////////
+void frame_graph_print_report( cstring file_path, u32 width, u32 height, StackAllocator* temp_allocator ) {
+    FrameGraphBuilder frame_graph_builder;
+    frame_graph_builder.init_headless( &MemoryService::instance()->system_allocator, width, height );
 
-void FrameGraphRenderPassCache::init( Allocator* allocator )
-{
-    render_pass_map.init( allocator, FrameGraphBuilder::k_max_render_pass_count );
-}
+    FrameGraph frame_graph;
+    frame_graph.init( &frame_graph_builder );
+    frame_graph.parse( file_path, temp_allocator );
+    frame_graph.compile();
 
-void FrameGraphRenderPassCache::shutdown( )
-{
-    render_pass_map.shutdown( );
+    frame_graph.shutdown();
+    frame_graph_builder.shutdown();
 }
 
-// FrameGraphResourceCache /////////////////////////////////////////////////////////////
-
-void FrameGraphResourceCache::init( Allocator* allocator, GpuDevice* device_ )
-{
-    device = device_;
+// FrameGraphMemoryPlan /////////////////////////////////////////////////////////////
 
+void FrameGraphMemoryPlan::init( Allocator* allocator ) {
     resources.init( allocator, FrameGraphBuilder::k_max_resources_count );
-    resource_map.init( allocator, FrameGraphBuilder::k_max_resources_count );
+    heaps.init( allocator, FrameGraphBuilder::k_max_resources_count );
 }
 
-void FrameGraphResourceCache::shutdown( )
-{
-    FlatHashMapIterator it = resource_map.iterator_begin();
-    while ( it.is_valid() ) {
+void FrameGraphMemoryPlan::shutdown() {
+    resources.shutdown();
+    heaps.shutdown();
+}
 
-        u32 resource_index = resource_map.get( it );
-        FrameGraphResource* resource = resources.get( resource_index );
+static bool lifetimes_overlap( const FrameGraphTransientResource& a, const FrameGraphTransientResource& b ) {
+    return a.first_node <= b.last_node && b.first_node <= a.last_node;
+}
 
-        if ( ( resource->type == FrameGraphResourceType_Texture || resource->type == FrameGraphResourceType_Attachment )
-             && ( resource->resource_info.texture.handle.index > 0 && resource->resource_info.texture.handle.index != k_invalid_index ) ) {
-            Texture* texture = device->access_texture( resource->resource_info.texture.handle );
-            device->destroy_texture( texture->handle );
-        } else if ( ( resource->type == FrameGraphResourceType_Buffer )
-                    && ( resource->resource_info.buffer.handle.index > 0 && resource->resource_info.buffer.handle.index != k_invalid_index ) ) {
+void FrameGraphMemoryPlan::alias_resources( bool enable_aliasing ) {
+    heaps.clear();
+
+    // Largest first, so that the first resource placed in a heap is the one allocating its memory.
+    for ( u32 i = 1; i < resources.size; ++i ) {
+        FrameGraphTransientResource resource = resources[ i ];
+        u32 j = i;
+        for ( ; j > 0 && resources[ j - 1 ].size < resource.size; --j ) {
+            resources[ j ] = resources[ j - 1 ];
+        }
+        resources[ j ] = resource;
+    }
+
+    for ( u32 i = 0; i < resources.size; ++i ) {
+        FrameGraphTransientResource& resource = resources[ i ];
+
+        // Best fit: the smallest heap that can hold the resource.
+        u32 best_heap = k_invalid_index;
+        if ( enable_aliasing && resource.aliasable ) {
+            for ( u32 h = 0; h < heaps.size; ++h ) {
+                const FrameGraphMemoryHeap& heap = heaps[ h ];
+
+                // NOTE: relative sized resources are recreated on resize, so they can only share memory between themselves.
+                if ( heap.relative_size != resource.relative_size || heap.size < resource.size || heap.alignment < resource.alignment ||
+                     ( resource.memory_type_bits & heap.memory_type_bits ) != heap.memory_type_bits ) {
+                    continue;
+                }
+
+                bool available = true;
+                for ( u32 r = 0; r < i && available; ++r ) {
+                    const FrameGraphTransientResource& other = resources[ r ];
+                    available = other.heap != h || ( other.aliasable && !lifetimes_overlap( resource, other ) );
+                }
+
+                if ( available && ( best_heap == k_invalid_index || heap.size < heaps[ best_heap ].size ) ) {
+                    best_heap = h;
+                }
+            }
+        }
+
+        if ( best_heap == k_invalid_index ) {
+            best_heap = heaps.size;
+
+            FrameGraphMemoryHeap& heap = heaps.push_use();
+            heap.owner = resource.handle;
+            heap.size = resource.size;
+            heap.alignment = resource.alignment;
+            heap.memory_type_bits = resource.memory_type_bits;
+            heap.resource_count = 0;
+            heap.relative_size = resource.relative_size;
+        }
+
+        resource.heap = best_heap;
+        heaps[ best_heap ].resource_count++;
+    }
+
+    unaliased_size = 0;
+    for ( u32 i = 0; i < resources.size; ++i ) {
+        unaliased_size += resources[ i ].size;
+    }
+
+    aliased_size = 0;
+    for ( u32 h = 0; h < heaps.size; ++h ) {
+        aliased_size += heaps[ h ].size;
+    }
+
+    peak_live_size = 0;
+    for ( u32 n = 0; n < node_count; ++n ) {
+        sizet live_size = 0;
+        for ( u32 i = 0; i < resources.size; ++i ) {
+            if ( resources[ i ].first_node <= n && n <= resources[ i ].last_node ) {
+                live_size += resources[ i ].size;
+            }
+        }
+
+        peak_live_size = live_size > peak_live_size ? live_size : peak_live_size;
+    }
+}
+
+void FrameGraphMemoryPlan::print_report( FrameGraph* frame_graph ) {
+    const f64 to_mb = 1.0 / ( 1024.0 * 1024.0 );
+
+    rprint( "Frame graph %s: %u transient resources in %u heaps. Unaliased %.2f MB, aliased %.2f MB, peak live %.2f MB\n", frame_graph->name,
+            resources.size, heaps.size, unaliased_size * to_mb, aliased_size * to_mb, peak_live_size * to_mb );
+
+    for ( u32 h = 0; h < heaps.size; ++h ) {
+        const FrameGraphMemoryHeap& heap = heaps[ h ];
+        rprint( "  Heap %u: %.2f MB, %s size\n", h, heap.size * to_mb, heap.relative_size ? "relative" : "fixed" );
+
+        for ( u32 i = 0; i < resources.size; ++i ) {
+            const FrameGraphTransientResource& resource = resources[ i ];
+            if ( resource.heap != h ) {
+                continue;
+            }
+
+            FrameGraphNode* first_node = frame_graph->access_node( frame_graph->nodes[ resource.first_node ] );
+            FrameGraphNode* last_node = frame_graph->access_node( frame_graph->nodes[ resource.last_node ] );
+            rprint( "    %-40s %8.2f MB  [%2u, %2u] %s -> %s\n", frame_graph->access_resource( resource.handle )->name, resource.size * to_mb,
+                    resource.first_node, resource.last_node, first_node->name, last_node->name );
+        }
+    }
+}
+
+void FrameGraphMemoryPlan::debug_ui( FrameGraph* frame_graph ) {
+    const f64 to_mb = 1.0 / ( 1024.0 * 1024.0 );
+
+    ImGui::Text( "Aliasing %s", frame_graph->transient_aliasing ? "enabled" : "disabled" );
+    ImGui::Text( "Unaliased %.2f MB, aliased %.2f MB, peak live %.2f MB", unaliased_size * to_mb, aliased_size * to_mb, peak_live_size * to_mb );
+
+    for ( u32 h = 0; h < heaps.size; ++h ) {
+        const FrameGraphMemoryHeap& heap = heaps[ h ];
+
+        ImGui::Separator();
+        ImGui::Text( "Heap %u: %.2f MB, %u resources", h, heap.size * to_mb, heap.resource_count );
+
+        for ( u32 i = 0; i < resources.size; ++i ) {
+            const FrameGraphTransientResource& resource = resources[ i ];
+            if ( resource.heap != h ) {
+                continue;
+            }
+
+            ImGui::Text( "\t%s %.2f MB, nodes %u - %u", frame_graph->access_resource( resource.handle )->name, resource.size * to_mb, resource.first_node, resource.last_node );
+        }
+    }
+}
+
+// FrameGraphBarrierPlan /////////////////////////////////////////////////////////////
+
+static const u32                    k_max_node_barriers = 32;
+
+static const VkAccessFlags2KHR      k_write_access_mask = VK_ACCESS_2_SHADER_WRITE_BIT_KHR | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR;
+
+//
+// Last access of a texture while walking the nodes.
+struct FrameGraphTextureAccess {
+    ResourceState                   state;
+    VkPipelineStageFlags2KHR        stage;
+    VkAccessFlags2KHR               access;
+    u32                             node;
+    u32                             previous_frame_node;    // Last access in the previous walk.
+    bool                            async;                  // Accessed on the async compute queue.
+}; // struct FrameGraphTextureAccess
+
+// Stages and accesses of the node using the texture, narrower than the generic ones
+// as the kind of node is known.
+static void get_node_access_masks( FrameGraphNode* node, ResourceState state, VkPipelineStageFlags2KHR& stage, VkAccessFlags2KHR& access ) {
+    switch ( state ) {
+        case RESOURCE_STATE_RENDER_TARGET:
+            stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR;
+            access = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR;
+            break;
+        case RESOURCE_STATE_DEPTH_WRITE:
+            stage = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR;
+            access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR;
+            break;
+        case RESOURCE_STATE_UNORDERED_ACCESS:
+            stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR;
+            access = VK_ACCESS_2_SHADER_READ_BIT_KHR | VK_ACCESS_2_SHADER_WRITE_BIT_KHR;
+            break;
+        default:
+            stage = node->compute ? VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR : ( VK_PIPELINE_STAGE_2_PRE_RASTERIZATION_SHADERS_BIT_KHR | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR );
+            access = VK_ACCESS_2_SHADER_READ_BIT_KHR;
+            break;
+    }
+}
+
+void FrameGraphBarrierPlan::init( Allocator* allocator ) {
+    barriers.init( allocator, 64 );
+    node_barrier_offsets.init( allocator, FrameGraphBuilder::k_max_nodes_count + 1 );
+    aliasing_nodes.init( allocator, FrameGraphBuilder::k_max_nodes_count );
+
+    split_barriers.init( allocator, 16 );
+    split_image_barriers.init( allocator, 16 );
+    split_events.init( allocator, 16 * k_max_frames );
+    split_signaled.init( allocator, 16 * k_max_frames );
+
+    transfer_released.init( allocator, 64 );
+}
+
+void FrameGraphBarrierPlan::shutdown() {
+    barriers.shutdown();
+    node_barrier_offsets.shutdown();
+    aliasing_nodes.shutdown();
+
+    split_barriers.shutdown();
+    split_image_barriers.shutdown();
+    split_events.shutdown();
+    split_signaled.shutdown();
+
+    transfer_released.shutdown();
+}
+
+void FrameGraphBarrierPlan::build( FrameGraph* frame_graph, bool enable_split_barriers ) {
+    FrameGraphBuilder* builder = frame_graph->builder;
+    const FrameGraphMemoryPlan& memory_plan = frame_graph->memory_plan;
+    const FrameGraphQueueSchedule& queue_schedule = frame_graph->queue_schedule;
+
+    Array<FrameGraphTextureAccess> accesses;
+    accesses.init( frame_graph->allocator, FrameGraphBuilder::k_max_resources_count, FrameGraphBuilder::k_max_resources_count );
+    memset( accesses.data, 0, sizeof( FrameGraphTextureAccess ) * accesses.size );
+
+    // Each frame starts with the states left by the previous one: a first walk finds them, the second builds the barriers.
+    for ( u32 walk = 0; walk < 2; ++walk ) {
+        barriers.clear();
+        node_barrier_offsets.clear();
+        aliasing_nodes.clear();
+        split_barriers.clear();
+        required_count = 0;
+        transfer_count = 0;
+
+        for ( u32 r = 0; r < accesses.size; ++r ) {
+            accesses[ r ].previous_frame_node = walk ? accesses[ r ].node : k_invalid_index;
+            accesses[ r ].node = k_invalid_index;
+        }
+
+        for ( u32 n = 0; n < frame_graph->nodes.size; ++n ) {
+            FrameGraphNode* node = builder->access_node( frame_graph->nodes[ n ] );
+            const bool async = queue_schedule.is_async( n );
+
+            node_barrier_offsets.push( barriers.size );
+            aliasing_nodes.push( 0 );
+
+            // Ray tracing passes handle their own resources.
+            if ( node->ray_tracing ) {
+                continue;
+            }
+
+            // Inputs first, then the outputs.
+            const u32 max_transitions = node->inputs.size + node->outputs.size;
+            for ( u32 t = 0; t < max_transitions; ++t ) {
+                FrameGraphResourceHandle handle;
+                ResourceState new_state;
+                bool is_depth = false;
+
+                if ( t < node->inputs.size ) {
+                    FrameGraphResource* input_resource = builder->access_resource( node->inputs[ t ] );
+                    FrameGraphResource* resource = builder->access_resource( input_resource->output_handle );
+
+                    if ( resource == nullptr || resource->resource_info.external ) {
+                        continue;
+                    }
+
+                    handle = input_resource->output_handle;
+
+                    if ( input_resource->type == FrameGraphResourceType_Texture ) {
+                        is_depth = TextureFormat::has_depth( resource->resource_info.texture.format );
+                        new_state = node->compute ? RESOURCE_STATE_SHADER_RESOURCE : RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+                    } else if ( input_resource->type == FrameGraphResourceType_Attachment && !node->compute ) {
+                        // Read-write attachments
+                        is_depth = TextureFormat::has_depth_or_stencil( resource->resource_info.texture.format );
+                        new_state = is_depth ? RESOURCE_STATE_DEPTH_WRITE : RESOURCE_STATE_RENDER_TARGET;
+                    } else {
+                        continue;
+                    }
+                } else {
+                    handle = node->outputs[ t - node->inputs.size ];
+                    FrameGraphResource* resource = builder->access_resource( handle );
+
+                    if ( resource->type != FrameGraphResourceType_Attachment ) {
+                        continue;
+                    }
+
+                    is_depth = TextureFormat::has_depth( resource->resource_info.texture.format );
+                    if ( node->compute ) {
+                        // Is this supported even ?
+                        RASSERT( !is_depth );
+                        new_state = RESOURCE_STATE_UNORDERED_ACCESS;
+                    } else {
+                        new_state = is_depth ? RESOURCE_STATE_DEPTH_WRITE : RESOURCE_STATE_RENDER_TARGET;
+                    }
+                }
+
+                FrameGraphTextureAccess& previous = accesses[ handle.index ];
+
+                // Barriers of a batch are not ordered: a texture used twice by the node gets a single transition.
+                if ( previous.node == n ) {
+                    for ( u32 b = node_barrier_offsets[ n ]; b < barriers.size; ++b ) {
+                        FrameGraphBarrier& barrier = barriers[ b ];
+                        if ( barrier.resource.index == handle.index ) {
+                            barrier.destination_state = new_state;
+                            get_node_access_masks( node, new_state, barrier.destination_stage, barrier.destination_access );
+
+                            if ( !barrier.required && barrier.source_state != new_state ) {
+                                barrier.required = true;
+                                ++required_count;
+                            }
+
+                            previous.state = new_state;
+                            previous.stage = barrier.destination_stage;
+                            previous.access = barrier.destination_access;
+                            break;
+                        }
+                    }
+                    continue;
+                }
+
+                FrameGraphBarrier& barrier = barriers.push_use();
+                barrier.resource = handle;
+                barrier.node = n;
+                barrier.signal_node = k_invalid_index;
+                barrier.split_index = k_invalid_index;
+                barrier.release_node = k_invalid_index;
+                barrier.is_depth = is_depth;
+                barrier.discard = false;
+                barrier.queue_transfer = false;
+
+                // Memory shared with other transient resources, the content starts undefined.
+                for ( u32 m = 0; m < memory_plan.resources.size; ++m ) {
+                    const FrameGraphTransientResource& transient = memory_plan.resources[ m ];
+                    if ( transient.handle.index == handle.index && transient.first_node == n && memory_plan.heaps[ transient.heap ].resource_count > 1 && previous.node == k_invalid_index ) {
+                        barrier.discard = true;
+                        previous.state = RESOURCE_STATE_UNDEFINED;
+                        previous.stage = 0;
+                        previous.access = 0;
+                        aliasing_nodes[ n ] = 1;
+                        break;
+                    }
+                }
+
+                barrier.source_state = previous.state;
+                barrier.source_stage = previous.stage;
+                barrier.source_access = previous.access & k_write_access_mask;
+                barrier.destination_state = new_state;
+                get_node_access_masks( node, new_state, barrier.destination_stage, barrier.destination_access );
+
+                // Exclusive images change owner when the other queue is in another family, even between reads.
+                // The previous access can be in the previous frame, the release is then recorded after it in this frame.
+                if ( previous.async != async && !barrier.discard && queue_schedule.separate_queue_families ) {
+                    barrier.release_node = previous.node != k_invalid_index ? previous.node : previous.previous_frame_node;
+                    barrier.queue_transfer = barrier.release_node != k_invalid_index;
+                    transfer_count += barrier.queue_transfer ? 1 : 0;
+                }
+
+                // Read after read in the same layout needs nothing.
+                barrier.required = previous.state != new_state || barrier.source_access != 0 || barrier.queue_transfer;
+                required_count += barrier.required ? 1 : 0;
+
+                // Long gaps between a write and the next use: signal after the write, wait before the use.
+                // Events can't be waited on from another queue.
+                if ( enable_split_barriers && barrier.required && !barrier.queue_transfer && previous.async == async && previous.node != k_invalid_index && n - previous.node > k_split_barrier_min_distance ) {
+                    barrier.signal_node = previous.node;
+                    barrier.split_index = split_barriers.size;
+                    split_barriers.push( barriers.size - 1 );
+                }
+
+                previous.state = new_state;
+                previous.stage = barrier.destination_stage;
+                previous.access = barrier.destination_access;
+                previous.node = n;
+                previous.async = async;
+            }
+        }
+
+        node_barrier_offsets.push( barriers.size );
+    }
+
+    accesses.shutdown();
+
+    transfer_released.set_size( barriers.size );
+    memset( transfer_released.data, 0, transfer_released.size );
+
+    split_image_barriers.set_size( split_barriers.size );
+    split_signaled.set_size( split_barriers.size * k_max_frames );
+    memset( split_signaled.data, 0, split_signaled.size );
+}
+
+void FrameGraphBarrierPlan::create_events( GpuDevice* gpu ) {
+    split_events.set_size( split_barriers.size * k_max_frames );
+
+    for ( u32 i = 0; i < split_events.size; ++i ) {
+        VkEventCreateInfo event_info{ VK_STRUCTURE_TYPE_EVENT_CREATE_INFO };
+        event_info.flags = VK_EVENT_CREATE_DEVICE_ONLY_BIT_KHR;
+
+        check( vkCreateEvent( gpu->vulkan_device, &event_info, gpu->vulkan_allocation_callbacks, &split_events[ i ] ) );
+    }
+}
+
+void FrameGraphBarrierPlan::destroy_events( GpuDevice* gpu ) {
+    for ( u32 i = 0; i < split_events.size; ++i ) {
+        vkDestroyEvent( gpu->vulkan_device, split_events[ i ], gpu->vulkan_allocation_callbacks );
+    }
+
+    split_events.clear();
+}
+
+static void fill_image_barrier( GpuDevice* gpu, VkImageMemoryBarrier2KHR& image_barrier, const FrameGraphBarrier& barrier, Texture* texture, bool planned, QueueType::Enum queue_type ) {
+    image_barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR };
+
+    if ( barrier.queue_transfer ) {
+        // The semaphore between the queues already waits for the previous access.
+        image_barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE_KHR;
+        image_barrier.srcAccessMask = 0;
+    } else if ( planned ) {
+        image_barrier.srcStageMask = barrier.source_stage;
+        image_barrier.srcAccessMask = barrier.source_access;
+    } else {
+        // Changed outside of the graph, use the generic masks of the current state.
+        image_barrier.srcAccessMask = util_to_vk_access_flags2( texture->state );
+        image_barrier.srcStageMask = util_determine_pipeline_stage_flags2( gpu, image_barrier.srcAccessMask, queue_type );
+    }
+
+    image_barrier.dstStageMask = barrier.destination_stage;
+    image_barrier.dstAccessMask = barrier.destination_access;
+    image_barrier.oldLayout = util_to_vk_image_layout2( texture->state );
+    image_barrier.newLayout = util_to_vk_image_layout2( barrier.destination_state );
+    image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.image = texture->vk_image;
+    image_barrier.subresourceRange.aspectMask = barrier.is_depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    image_barrier.subresourceRange.baseArrayLayer = 0;
+    image_barrier.subresourceRange.layerCount = 1;
+    image_barrier.subresourceRange.baseMipLevel = 0;
+    image_barrier.subresourceRange.levelCount = 1;
+}
+
+static u32 get_node_queue_family( FrameGraph* frame_graph, GpuDevice* gpu, u32 node_index ) {
+    return frame_graph->queue_schedule.is_async( node_index ) ? gpu->vulkan_compute_queue_family : gpu->vulkan_main_queue_family;
+}
+
+void FrameGraphBarrierPlan::add_node_barriers( u32 node_index, u32 current_frame_index, FrameGraph* frame_graph, CommandBuffer* gpu_commands ) {
+    GpuDevice* gpu = gpu_commands->gpu_device;
+
+    const u32 first_barrier = node_barrier_offsets[ node_index ];
+    const u32 last_barrier = node_barrier_offsets[ node_index + 1 ];
+    RASSERT( last_barrier - first_barrier <= k_max_node_barriers );
+
+    if ( !gpu->synchronization2_extension_present ) {
+        VkImageMemoryBarrier image_barriers[ k_max_node_barriers ];
+        u32 image_barrier_count = 0;
+        VkPipelineStageFlags source_stage_mask = 0;
+        VkPipelineStageFlags destination_stage_mask = 0;
+
+        for ( u32 b = first_barrier; b < last_barrier; ++b ) {
+            const FrameGraphBarrier& barrier = barriers[ b ];
+            Texture* texture = gpu->access_texture( frame_graph->access_resource( barrier.resource )->resource_info.texture.handle );
+
+            if ( barrier.discard ) {
+                texture->state = RESOURCE_STATE_UNDEFINED;
+            }
+
+            if ( texture->state == barrier.source_state && !barrier.required ) {
+                continue;
+            }
+
+            VkImageMemoryBarrier& image_barrier = image_barriers[ image_barrier_count++ ];
+            image_barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+            image_barrier.image = texture->vk_image;
+            image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image_barrier.subresourceRange.aspectMask = barrier.is_depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+            image_barrier.subresourceRange.baseArrayLayer = 0;
+            image_barrier.subresourceRange.layerCount = 1;
+            image_barrier.subresourceRange.baseMipLevel = 0;
+            image_barrier.subresourceRange.levelCount = 1;
+            image_barrier.oldLayout = util_to_vk_image_layout( texture->state );
+            image_barrier.newLayout = util_to_vk_image_layout( barrier.destination_state );
+            image_barrier.srcAccessMask = util_to_vk_access_flags( texture->state );
+            image_barrier.dstAccessMask = util_to_vk_access_flags( barrier.destination_state );
+
+            source_stage_mask |= util_determine_pipeline_stage_flags( gpu, image_barrier.srcAccessMask, QueueType::Graphics );
+            destination_stage_mask |= util_determine_pipeline_stage_flags( gpu, image_barrier.dstAccessMask, QueueType::Graphics );
+
+            texture->state = barrier.destination_state;
+        }
+
+        VkMemoryBarrier memory_barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        memory_barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        const u32 memory_barrier_count = aliasing_nodes[ node_index ];
+
+        if ( memory_barrier_count ) {
+            source_stage_mask = destination_stage_mask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        }
+
+        if ( image_barrier_count + memory_barrier_count ) {
+            vkCmdPipelineBarrier( gpu_commands->vk_command_buffer, source_stage_mask, destination_stage_mask, 0,
+                                  memory_barrier_count, &memory_barrier, 0, nullptr, image_barrier_count, image_barriers );
+        }
+        return;
+    }
+
+    VkImageMemoryBarrier2KHR image_barriers[ k_max_node_barriers ];
+    u32 image_barrier_count = 0;
+
+    VkEvent wait_events[ k_max_node_barriers ];
+    VkDependencyInfoKHR wait_dependencies[ k_max_node_barriers ];
+    VkPipelineStageFlags2KHR wait_stages[ k_max_node_barriers ];
+    u32 wait_count = 0;
+
+    for ( u32 b = first_barrier; b < last_barrier; ++b ) {
+        const FrameGraphBarrier& barrier = barriers[ b ];
+        Texture* texture = gpu->access_texture( frame_graph->access_resource( barrier.resource )->resource_info.texture.handle );
+
+        if ( barrier.discard ) {
+            texture->state = RESOURCE_STATE_UNDEFINED;
+        }
+
+        if ( barrier.split_index != k_invalid_index ) {
+            const u32 event_index = current_frame_index * split_barriers.size + barrier.split_index;
+            if ( split_signaled[ event_index ] ) {
+                split_signaled[ event_index ] = 0;
+
+                // Same dependency used to signal the event.
+                VkDependencyInfoKHR& dependency_info = wait_dependencies[ wait_count ];
+                dependency_info = { VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+                dependency_info.imageMemoryBarrierCount = 1;
+                dependency_info.pImageMemoryBarriers = &split_image_barriers[ barrier.split_index ];
+
+                wait_stages[ wait_count ] = barrier.destination_stage;
+                wait_events[ wait_count++ ] = split_events[ event_index ];
+
+                if ( texture->state == barrier.destination_state ) {
+                    continue;
+                }
+            }
+        }
+
+        const bool planned = texture->state == barrier.source_state;
+        if ( planned && !barrier.required ) {
+            continue;
+        }
+
+        VkImageMemoryBarrier2KHR& image_barrier = image_barriers[ image_barrier_count++ ];
+        fill_image_barrier( gpu, image_barrier, barrier, texture, planned, gpu_commands->queue_type );
+
+        // Acquire, matching the release recorded on the other queue. Without one, as in the first frame, only the layout changes.
+        if ( barrier.queue_transfer && transfer_released[ b ] ) {
+            transfer_released[ b ] = 0;
+
+            image_barrier.srcQueueFamilyIndex = get_node_queue_family( frame_graph, gpu, barrier.release_node );
+            image_barrier.dstQueueFamilyIndex = get_node_queue_family( frame_graph, gpu, node_index );
+        }
+
+        texture->state = barrier.destination_state;
+    }
+
+    if ( wait_count ) {
+        gpu->vkCmdWaitEvents2KHR( gpu_commands->vk_command_buffer, wait_count, wait_events, wait_dependencies );
+
+        for ( u32 w = 0; w < wait_count; ++w ) {
+            gpu->vkCmdResetEvent2KHR( gpu_commands->vk_command_buffer, wait_events[ w ], wait_stages[ w ] );
+        }
+    }
+
+    // Writes from previous users of aliased memory, in the same batch.
+    VkMemoryBarrier2KHR memory_barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2_KHR };
+    memory_barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR;
+    memory_barrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT_KHR;
+    memory_barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR;
+    memory_barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT_KHR | VK_ACCESS_2_MEMORY_WRITE_BIT_KHR;
+
+    VkDependencyInfoKHR dependency_info{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+    dependency_info.memoryBarrierCount = aliasing_nodes[ node_index ];
+    dependency_info.pMemoryBarriers = &memory_barrier;
+    dependency_info.imageMemoryBarrierCount = image_barrier_count;
+    dependency_info.pImageMemoryBarriers = image_barriers;
+
+    if ( dependency_info.memoryBarrierCount + image_barrier_count ) {
+        gpu->vkCmdPipelineBarrier2KHR( gpu_commands->vk_command_buffer, &dependency_info );
+    }
+}
+
+void FrameGraphBarrierPlan::signal_split_barriers( u32 node_index, u32 current_frame_index, FrameGraph* frame_graph, CommandBuffer* gpu_commands ) {
+    GpuDevice* gpu = gpu_commands->gpu_device;
+
+    for ( u32 i = 0; i < split_barriers.size; ++i ) {
+        const FrameGraphBarrier& barrier = barriers[ split_barriers[ i ] ];
+        if ( barrier.signal_node != node_index ) {
+            continue;
+        }
+
+        // The pass changed the state itself: the waiting node will fall back to a normal barrier.
+        Texture* texture = gpu->access_texture( frame_graph->access_resource( barrier.resource )->resource_info.texture.handle );
+        if ( texture->state != barrier.source_state ) {
+            continue;
+        }
+
+        VkImageMemoryBarrier2KHR& image_barrier = split_image_barriers[ barrier.split_index ];
+        fill_image_barrier( gpu, image_barrier, barrier, texture, true, gpu_commands->queue_type );
+
+        VkDependencyInfoKHR dependency_info{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+        dependency_info.imageMemoryBarrierCount = 1;
+        dependency_info.pImageMemoryBarriers = &image_barrier;
+
+        const u32 event_index = current_frame_index * split_barriers.size + barrier.split_index;
+        gpu->vkCmdSetEvent2KHR( gpu_commands->vk_command_buffer, split_events[ event_index ], &dependency_info );
+
+        split_signaled[ event_index ] = 1;
+        texture->state = barrier.destination_state;
+    }
+}
+
+void FrameGraphBarrierPlan::release_queue_transfers( u32 node_index, FrameGraph* frame_graph, CommandBuffer* gpu_commands ) {
+    if ( transfer_count == 0 ) {
+        return;
+    }
+
+    GpuDevice* gpu = gpu_commands->gpu_device;
+
+    VkImageMemoryBarrier2KHR image_barriers[ k_max_node_barriers ];
+    u32 image_barrier_count = 0;
+
+    for ( u32 b = 0; b < barriers.size; ++b ) {
+        const FrameGraphBarrier& barrier = barriers[ b ];
+        if ( !barrier.queue_transfer || barrier.release_node != node_index ) {
+            continue;
+        }
+
+        // The pass changed the state itself: the acquire will only change the layout.
+        Texture* texture = gpu->access_texture( frame_graph->access_resource( barrier.resource )->resource_info.texture.handle );
+        if ( texture->state != barrier.source_state ) {
+            continue;
+        }
+
+        // Same layouts as the acquire, the state of the texture changes when it is recorded.
+        RASSERT( image_barrier_count < k_max_node_barriers );
+        VkImageMemoryBarrier2KHR& image_barrier = image_barriers[ image_barrier_count++ ];
+        fill_image_barrier( gpu, image_barrier, barrier, texture, true, gpu_commands->queue_type );
+        image_barrier.srcStageMask = barrier.source_stage;
+        image_barrier.srcAccessMask = barrier.source_access;
+        image_barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE_KHR;
+        image_barrier.dstAccessMask = 0;
+        image_barrier.srcQueueFamilyIndex = get_node_queue_family( frame_graph, gpu, node_index );
+        image_barrier.dstQueueFamilyIndex = get_node_queue_family( frame_graph, gpu, barrier.node );
+
+        transfer_released[ b ] = 1;
+    }
+
+    if ( image_barrier_count ) {
+        VkDependencyInfoKHR dependency_info{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+        dependency_info.imageMemoryBarrierCount = image_barrier_count;
+        dependency_info.pImageMemoryBarriers = image_barriers;
+
+        gpu->vkCmdPipelineBarrier2KHR( gpu_commands->vk_command_buffer, &dependency_info );
+    }
+}
+
+void FrameGraphBarrierPlan::print( FrameGraph* frame_graph ) {
+    rprint( "Frame graph %s: %u texture transitions, %u barriers, %u split, %u queue transfers\n", frame_graph->name, barriers.size, required_count, split_barriers.size, transfer_count );
+
+    for ( u32 n = 0; n + 1 < node_barrier_offsets.size; ++n ) {
+        FrameGraphNode* node = frame_graph->access_node( frame_graph->nodes[ n ] );
+        rprint( "  [%2u] %s%s\n", n, node->name, aliasing_nodes[ n ] ? ", aliasing memory barrier" : "" );
+
+        for ( u32 b = node_barrier_offsets[ n ]; b < node_barrier_offsets[ n + 1 ]; ++b ) {
+            const FrameGraphBarrier& barrier = barriers[ b ];
+
+            rprint( "       %-36s %-20s -> %-20s", frame_graph->access_resource( barrier.resource )->name, ResourceStateName( barrier.source_state ), ResourceStateName( barrier.destination_state ) );
+            if ( !barrier.required ) {
+                rprint( " none\n" );
+                continue;
+            }
+
+            rprint( " stages %08llx -> %08llx access %08llx -> %08llx%s", ( u64 )barrier.source_stage, ( u64 )barrier.destination_stage,
+                    ( u64 )barrier.source_access, ( u64 )barrier.destination_access, barrier.discard ? " discard" : "" );
+            if ( barrier.signal_node != k_invalid_index ) {
+                rprint( " split from [%2u]", barrier.signal_node );
+            }
+            if ( barrier.queue_transfer ) {
+                rprint( " queue transfer from [%2u]", barrier.release_node );
+            }
+            rprint( "\n" );
+        }
+    }
+}
+
+void FrameGraphBarrierPlan::debug_ui( FrameGraph* frame_graph ) {
+    ImGui::Text( "%u texture transitions, %u barriers, %u split, %u queue transfers", barriers.size, required_count, split_barriers.size, transfer_count );
+
+    for ( u32 n = 0; n + 1 < node_barrier_offsets.size; ++n ) {
+        const u32 barrier_count = node_barrier_offsets[ n + 1 ] - node_barrier_offsets[ n ];
+        if ( barrier_count == 0 ) {
+            continue;
+        }
+
+        FrameGraphNode* node = frame_graph->access_node( frame_graph->nodes[ n ] );
+        ImGui::Separator();
+        ImGui::Text( "%s", node->name );
+
+        for ( u32 b = node_barrier_offsets[ n ]; b < node_barrier_offsets[ n + 1 ]; ++b ) {
+            const FrameGraphBarrier& barrier = barriers[ b ];
+            ImGui::Text( "\t%s %s -> %s%s%s%s", frame_graph->access_resource( barrier.resource )->name, ResourceStateName( barrier.source_state ),
+                         ResourceStateName( barrier.destination_state ), barrier.required ? "" : " (none)", barrier.signal_node != k_invalid_index ? " (split)" : "",
+                         barrier.queue_transfer ? " (queue transfer)" : "" );
+        }
+    }
+}
+
+// FrameGraphRecordingPlan ////////////////////////////////////////////////
+
+void FrameGraphRecordingTask::ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) {
+    ZoneScoped;
+
+    FrameGraphBuilder* builder = frame_graph->builder;
+    GpuDevice* gpu = builder->device;
+
+    for ( u32 c = range_.start; c < range_.end; ++c ) {
+        const i64 chunk_start = time_now();
+
+        FrameGraphRecordingChunk& chunk = frame_graph->recording_plan.chunks[ first_chunk + c ];
+        FrameGraphNode* node = builder->access_node( frame_graph->nodes[ chunk.node ] );
+
+        // Each thread records with the command pool of its own thread.
+        CommandBuffer* gpu_commands = gpu->get_secondary_command_buffer( threadnum_, current_frame_index );
+        Framebuffer* framebuffer = gpu->access_framebuffer( node->framebuffer );
+
+        gpu_commands->reset();
+        gpu_commands->begin_secondary( gpu->access_render_pass( node->render_pass ), framebuffer );
+
+        // Dynamic state is not inherited from the primary command buffer.
+        Rect2DInt scissor{ 0, 0, framebuffer->width, framebuffer->height };
+        gpu_commands->set_scissor( &scissor );
+
+        Viewport viewport{ };
+        viewport.rect = { 0, 0, framebuffer->width, framebuffer->height };
+        viewport.min_depth = 0.0f;
+        viewport.max_depth = 1.0f;
+        gpu_commands->set_viewport( &viewport );
+
+        node->graph_render_pass->render_range( current_frame_index, gpu_commands, render_scene, chunk.first_draw, chunk.draw_count );
+
+        gpu_commands->end();
+
+        chunk.commands = gpu_commands;
+        chunk.thread_index = threadnum_;
+        chunk.cpu_time_ms = ( f32 )time_from_milliseconds( chunk_start );
+    }
+}
+
+void FrameGraphRecordingPlan::init( Allocator* allocator ) {
+    // Chunks are read by the tasks while recording, they can't be reallocated.
+    chunks.init( allocator, k_secondary_command_buffers_count );
+    node_tasks.init( allocator, FrameGraphBuilder::k_max_nodes_count );
+    node_timings.init( allocator, FrameGraphBuilder::k_max_nodes_count );
+}
+
+void FrameGraphRecordingPlan::shutdown() {
+    chunks.shutdown();
+    node_tasks.shutdown();
+    node_timings.shutdown();
+}
+
+void FrameGraphRecordingPlan::begin_frame( u32 node_count ) {
+    task_count = 0;
+    chunks.clear();
+
+    node_tasks.set_size( node_count );
+    node_timings.set_size( node_count );
+    for ( u32 n = 0; n < node_count; ++n ) {
+        node_tasks[ n ] = k_invalid_index;
+        node_timings[ n ] = { };
+    }
+}
+
+void FrameGraphRecordingPlan::end_frame( f32 frame_time_ms_ ) {
+    frame_time_ms = frame_time_ms_;
+
+    serial_time_ms = 0.f;
+    for ( u32 n = 0; n < node_timings.size; ++n ) {
+        serial_time_ms += node_timings[ n ].recording_ms;
+    }
+}
+
+void FrameGraphRecordingPlan::kick( u32 current_frame_index, FrameGraph* frame_graph, RenderScene* render_scene ) {
+    ZoneScoped;
+
+    GpuDevice* gpu = frame_graph->builder->device;
+    // Secondary command buffers are executed while the primary has the pipeline statistics query active.
+    if ( task_scheduler == nullptr || !gpu->inherited_queries_present ) {
+        return;
+    }
+
+    u32 node_indices[ k_max_parallel_nodes ];
+    u32 node_draws[ k_max_parallel_nodes ];
+    u32 total_draws = 0;
+
+    for ( u32 n = 0; n < frame_graph->nodes.size && task_count < k_max_parallel_nodes; ++n ) {
+        FrameGraphNode* node = frame_graph->access_node( frame_graph->nodes[ n ] );
+        if ( node->compute || node->ray_tracing ) {
+            continue;
+        }
+
+        const u32 draw_count = node->graph_render_pass->parallel_draw_count( render_scene );
+        if ( draw_count == 0 ) {
+            continue;
+        }
+
+        node_tasks[ n ] = task_count;
+        node_indices[ task_count ] = n;
+        node_draws[ task_count ] = draw_count;
+        total_draws += draw_count;
+        ++task_count;
+    }
+
+    // Every node gets a secondary command buffer, the spare ones go to the nodes with more draws.
+    const u32 spare_chunks = k_secondary_command_buffers_count - task_count;
+    const u32 thread_count = task_scheduler->GetNumTaskThreads();
+
+    for ( u32 t = 0; t < task_count; ++t ) {
+        FrameGraphRecordingTask& task = tasks[ t ];
+        const u32 node_index = node_indices[ t ];
+        const u32 draw_count = node_draws[ t ];
+
+        u32 chunk_count = 1 + ( spare_chunks * draw_count ) / total_draws;
+        chunk_count = raptor::min( chunk_count, raptor::max( 1u, draw_count / k_min_draws_per_chunk ) );
+        chunk_count = raptor::min( chunk_count, thread_count );
+
+        const u32 draws_per_chunk = ( draw_count + chunk_count - 1 ) / chunk_count;
+        chunk_count = ( draw_count + draws_per_chunk - 1 ) / draws_per_chunk;
+
+        task.frame_graph = frame_graph;
+        task.render_scene = render_scene;
+        task.current_frame_index = current_frame_index;
+        task.first_chunk = chunks.size;
+        task.m_SetSize = chunk_count;
+
+        for ( u32 c = 0; c < chunk_count; ++c ) {
+            const u32 first_draw = c * draws_per_chunk;
+            chunks.push( { nullptr, node_index, first_draw, raptor::min( draws_per_chunk, draw_count - first_draw ), 0, 0.f } );
+        }
+
+        node_timings[ node_index ].chunks = chunk_count;
+    }
+
+    RASSERT( chunks.size <= k_secondary_command_buffers_count );
+
+    for ( u32 t = 0; t < task_count; ++t ) {
+        task_scheduler->AddTaskSetToPipe( &tasks[ t ] );
+    }
+}
+
+bool FrameGraphRecordingPlan::is_parallel( u32 node_index ) const {
+    return node_tasks[ node_index ] != k_invalid_index;
+}
+
+void FrameGraphRecordingPlan::execute_node( u32 node_index, CommandBuffer* gpu_commands ) {
+    FrameGraphRecordingTask& task = tasks[ node_tasks[ node_index ] ];
+
+    // Waiting executes pending tasks on this thread as well.
+    const i64 wait_start = time_now();
+    task_scheduler->WaitforTask( &task );
+
+    FrameGraphNodeTiming& timing = node_timings[ node_index ];
+    timing.wait_ms = ( f32 )time_from_milliseconds( wait_start );
+
+    CommandBuffer* secondary_command_buffers[ k_secondary_command_buffers_count ];
+    for ( u32 c = 0; c < task.m_SetSize; ++c ) {
+        const FrameGraphRecordingChunk& chunk = chunks[ task.first_chunk + c ];
+
+        secondary_command_buffers[ c ] = chunk.commands;
+        timing.recording_ms += chunk.cpu_time_ms;
+    }
+
+    gpu_commands->execute_secondary( secondary_command_buffers, task.m_SetSize );
+}
+
+void FrameGraphRecordingPlan::debug_ui( FrameGraph* frame_graph ) {
+    if ( frame_graph->parallel_recording && !frame_graph->builder->device->inherited_queries_present ) {
+        ImGui::Text( "Inherited queries are not supported, recording inline" );
+    }
+
+    // Serial time is the cost of recording every node on a single thread.
+    ImGui::Text( "Frame graph recording %.3f ms, serial %.3f ms, speed-up %.2fx", frame_time_ms, serial_time_ms, frame_time_ms > 0.f ? serial_time_ms / frame_time_ms : 0.f );
+
+    for ( u32 n = 0; n < node_timings.size && n < frame_graph->nodes.size; ++n ) {
+        FrameGraphNode* node = frame_graph->access_node( frame_graph->nodes[ n ] );
+        const FrameGraphNodeTiming& timing = node_timings[ n ];
+
+        if ( timing.chunks ) {
+            ImGui::Text( "\t%-32s %.3f ms, %u secondary, waited %.3f ms", node->name, timing.recording_ms, timing.chunks, timing.wait_ms );
+        } else {
+            ImGui::Text( "\t%-32s %.3f ms", node->name, timing.recording_ms );
+        }
+    }
+}
+
+// FrameGraphQueueSchedule ////////////////////////////////////////////////
+
+//
+// Resource used by a node, identified by name as references and inputs point to the outputs by name.
+struct FrameGraphQueueAccess {
+    u64                             name_hash;
+    bool                            write;
+    bool                            texture;        // Texture with barriers from the graph, owned by one queue family.
+}; // struct FrameGraphQueueAccess
+
+static void add_queue_access( Array<FrameGraphQueueAccess>& accesses, FrameGraph* frame_graph, FrameGraphResource* resource, bool write ) {
+    FrameGraphResource* output_resource = frame_graph->get_resource( resource->name );
+
+    FrameGraphQueueAccess& access = accesses.push_use();
+    access.name_hash = hash_calculate( resource->name );
+    access.write = write;
+    access.texture = output_resource && output_resource->type == FrameGraphResourceType_Attachment && !output_resource->resource_info.external;
+}
+
+void FrameGraphQueueSchedule::init( Allocator* allocator ) {
+    batches.init( allocator, k_max_batches );
+    node_batches.init( allocator, FrameGraphBuilder::k_max_nodes_count );
+    node_splits.init( allocator, FrameGraphBuilder::k_max_nodes_count );
+    node_waits.init( allocator, FrameGraphBuilder::k_max_nodes_count );
+    node_overlaps.init( allocator, FrameGraphBuilder::k_max_nodes_count );
+    node_reasons.init( allocator, FrameGraphBuilder::k_max_nodes_count );
+}
+
+void FrameGraphQueueSchedule::shutdown() {
+    batches.shutdown();
+    node_batches.shutdown();
+    node_splits.shutdown();
+    node_waits.shutdown();
+    node_overlaps.shutdown();
+    node_reasons.shutdown();
+}
+
+void FrameGraphQueueSchedule::build( FrameGraph* frame_graph, bool enable_async_compute ) {
+    FrameGraphBuilder* builder = frame_graph->builder;
+    GpuDevice* gpu = builder->device;
+    const FrameGraphMemoryPlan& memory_plan = frame_graph->memory_plan;
+    const u32 node_count = frame_graph->nodes.size;
+
+    // Without a device, assume a dedicated compute family as on most discrete GPUs.
+    separate_queue_families = gpu == nullptr || gpu->vulkan_compute_queue_family != gpu->vulkan_main_queue_family;
+    const bool queue_available = gpu == nullptr || ( gpu->timeline_semaphore_extension_present && gpu->synchronization2_extension_present );
+
+    batches.clear();
+    node_batches.set_size( node_count );
+    node_splits.set_size( node_count );
+    node_waits.set_size( node_count );
+    node_overlaps.set_size( node_count );
+    node_reasons.set_size( node_count );
+    segment_count = 1;
+
+    for ( u32 n = 0; n < node_count; ++n ) {
+        node_batches[ n ] = k_invalid_index;
+        node_splits[ n ] = 0;
+        node_waits[ n ] = 0;
+        node_overlaps[ n ] = 0;
+        node_reasons[ n ] = nullptr;
+    }
+
+    // Resources written and read by each node.
+    Array<FrameGraphQueueAccess> accesses;
+    accesses.init( frame_graph->allocator, 256 );
+
+    Array<u32> access_offsets;
+    access_offsets.init( frame_graph->allocator, node_count + 1 );
+
+    for ( u32 n = 0; n < node_count; ++n ) {
+        FrameGraphNode* node = builder->access_node( frame_graph->nodes[ n ] );
+        access_offsets.push( accesses.size );
+
+        for ( u32 i = 0; i < node->inputs.size; ++i ) {
+            FrameGraphResource* input_resource = builder->access_resource( node->inputs[ i ] );
+            add_queue_access( accesses, frame_graph, input_resource, input_resource->type == FrameGraphResourceType_Attachment && !node->compute );
+        }
+
+        for ( u32 o = 0; o < node->outputs.size; ++o ) {
+            add_queue_access( accesses, frame_graph, builder->access_resource( node->outputs[ o ] ), true );
+        }
+    }
+    access_offsets.push( accesses.size );
+
+    // Nodes sharing a resource are ordered when one writes it. Textures shared with another family also need
+    // an ownership transfer between reads, so they are ordered too.
+    auto conflict = [&]( u32 a, u32 b ) -> bool {
+        for ( u32 i = access_offsets[ a ]; i < access_offsets[ a + 1 ]; ++i ) {
+            for ( u32 j = access_offsets[ b ]; j < access_offsets[ b + 1 ]; ++j ) {
+                if ( accesses[ i ].name_hash == accesses[ j ].name_hash &&
+                     ( accesses[ i ].write || accesses[ j ].write || ( accesses[ i ].texture && separate_queue_families ) ) ) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    auto uses_aliased_memory = [&]( u32 n ) -> bool {
+        for ( u32 r = 0; r < memory_plan.resources.size; ++r ) {
+            const FrameGraphTransientResource& transient = memory_plan.resources[ r ];
+            if ( memory_plan.heaps[ transient.heap ].resource_count < 2 ) {
+                continue;
+            }
+
+            const u64 name_hash = hash_calculate( frame_graph->access_resource( transient.handle )->name );
+            for ( u32 i = access_offsets[ n ]; i < access_offsets[ n + 1 ]; ++i ) {
+                if ( accesses[ i ].name_hash == name_hash ) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    // Compute nodes go to the async queue when graphics work can run between the nodes they depend on
+    // and the first node depending on them. Later nodes are considered on the graphics queue.
+    Array<u8> async_nodes;
+    async_nodes.init( frame_graph->allocator, node_count, node_count );
+    memset( async_nodes.data, 0, node_count );
+
+    for ( u32 n = 0; n < node_count; ++n ) {
+        FrameGraphNode* node = builder->access_node( frame_graph->nodes[ n ] );
+        if ( !node->compute ) {
+            continue;
+        }
+
+        if ( !queue_available ) {
+            node_reasons[ n ] = "needs timeline semaphores and synchronization2";
+            continue;
+        }
+
+        if ( node->queue == FrameGraphQueue::Graphics ) {
+            node_reasons[ n ] = "graphics queue requested";
+            continue;
+        }
+
+        // Render passes are unknown when compiling, FrameGraph::build_queue_schedule checks them.
+        if ( gpu && ( node->graph_render_pass == nullptr || !node->graph_render_pass->supports_async_compute() ) ) {
+            node_reasons[ n ] = "render pass does not support async compute";
+            continue;
+        }
+
+        if ( uses_aliased_memory( n ) ) {
+            node_reasons[ n ] = "uses aliased transient memory";
+            continue;
+        }
+
+        if ( node->queue == FrameGraphQueue::AsyncCompute ) {
+            async_nodes[ n ] = 1;
+            node_reasons[ n ] = "async compute queue requested";
+            continue;
+        }
+
+        if ( !enable_async_compute ) {
+            node_reasons[ n ] = "async compute disabled";
+            continue;
+        }
+
+        u32 producer = k_invalid_index;
+        for ( u32 m = 0; m < n; ++m ) {
+            if ( !async_nodes[ m ] && conflict( m, n ) ) {
+                producer = m;
+            }
+        }
+
+        u32 consumer = k_invalid_index;
+        for ( u32 m = n + 1; m < node_count && consumer == k_invalid_index; ++m ) {
+            consumer = conflict( m, n ) ? m : k_invalid_index;
+        }
+
+        if ( consumer == k_invalid_index ) {
+            node_reasons[ n ] = "no consumer in the frame";
+            continue;
+        }
+
+        for ( u32 m = ( producer == k_invalid_index ) ? 0 : producer + 1; m < consumer; ++m ) {
+            node_overlaps[ n ] += ( m != n && !async_nodes[ m ] ) ? 1 : 0;
+        }
+
+        if ( node_overlaps[ n ] < k_min_overlap_nodes ) {
+            node_reasons[ n ] = "no graphics work to overlap";
+            continue;
+        }
+
+        async_nodes[ n ] = 1;
+        node_reasons[ n ] = "overlaps graphics work";
+    }
+
+    // Consecutive async nodes share a command buffer and a submission.
+    for ( u32 n = 0; n < node_count; ++n ) {
+        if ( !async_nodes[ n ] ) {
+            continue;
+        }
+
+        if ( batches.size && batches.back().last_node + 1 == n ) {
+            batches.back().last_node = n;
+            node_batches[ n ] = batches.size - 1;
+            continue;
+        }
+
+        if ( batches.size == k_max_batches ) {
+            async_nodes[ n ] = 0;
+            node_reasons[ n ] = "too many async compute batches";
+            continue;
+        }
+
+        FrameGraphAsyncBatch& batch = batches.push_use();
+        batch.first_node = n;
+        batch.last_node = n;
+        node_batches[ n ] = batches.size - 1;
+    }
+
+    // The graphics work is split after the last producer of a batch, so that the nodes between the producer
+    // and the batch overlap it, and before the first consumer, that waits for the batch.
+    for ( u32 b = 0; b < batches.size; ++b ) {
+        FrameGraphAsyncBatch& batch = batches[ b ];
+        batch.producer_node = k_invalid_index;
+        batch.consumer_node = k_invalid_index;
+
+        for ( u32 n = batch.first_node; n <= batch.last_node; ++n ) {
+            for ( u32 m = 0; m < batch.first_node; ++m ) {
+                if ( !async_nodes[ m ] && conflict( m, n ) && ( batch.producer_node == k_invalid_index || m > batch.producer_node ) ) {
+                    batch.producer_node = m;
+                }
+            }
+
+            for ( u32 m = batch.last_node + 1; m < node_count; ++m ) {
+                if ( !async_nodes[ m ] && conflict( m, n ) ) {
+                    batch.consumer_node = m < batch.consumer_node ? m : batch.consumer_node;
+                    break;
+                }
+            }
+        }
+
+        if ( batch.producer_node != k_invalid_index ) {
+            node_splits[ batch.producer_node + 1 ] = 1;
+        }
+
+        // Nodes after the consumer are ordered with it on the graphics queue.
+        if ( batch.consumer_node != k_invalid_index ) {
+            node_splits[ batch.consumer_node ] = 1;
+            node_waits[ batch.consumer_node ] = b + 1;
+        }
+    }
+
+    // Each batch waits for the segments up to the one of its producer.
+    Array<u32> node_segments;
+    node_segments.init( frame_graph->allocator, node_count, node_count );
+
+    u32 segment = 0;
+    for ( u32 n = 0; n < node_count; ++n ) {
+        segment += node_splits[ n ];
+        node_segments[ n ] = segment;
+    }
+    segment_count = segment + 1;
+
+    for ( u32 b = 0; b < batches.size; ++b ) {
+        FrameGraphAsyncBatch& batch = batches[ b ];
+        batch.wait_segment = batch.producer_node == k_invalid_index ? 0 : node_segments[ batch.producer_node ] + 1;
+    }
+
+    node_segments.shutdown();
+
+    async_nodes.shutdown();
+    access_offsets.shutdown();
+    accesses.shutdown();
+}
+
+bool FrameGraphQueueSchedule::is_async( u32 node_index ) const {
+    return node_index < node_batches.size && node_batches[ node_index ] != k_invalid_index;
+}
+
+void FrameGraphQueueSchedule::print( FrameGraph* frame_graph ) {
+    rprint( "Frame graph %s: %u async compute batches, %u graphics submissions%s\n", frame_graph->name, batches.size, segment_count,
+            separate_queue_families ? ", separate queue families" : "" );
+
+    for ( u32 n = 0; n < node_batches.size; ++n ) {
+        if ( node_reasons[ n ] == nullptr ) {
+            continue;
+        }
+
+        FrameGraphNode* node = frame_graph->access_node( frame_graph->nodes[ n ] );
+        rprint( "  [%2u] %-36s %-14s %s", n, node->name, is_async( n ) ? "async compute" : "graphics", node_reasons[ n ] );
+        if ( node_overlaps[ n ] ) {
+            rprint( ", %u graphics nodes", node_overlaps[ n ] );
+        }
+        rprint( "\n" );
+    }
+
+    for ( u32 b = 0; b < batches.size; ++b ) {
+        const FrameGraphAsyncBatch& batch = batches[ b ];
+        rprint( "  Batch %u: nodes [%2u, %2u], waits for submission %u, producer [%2d], consumer [%2d]\n", b, batch.first_node, batch.last_node,
+                batch.wait_segment, ( i32 )batch.producer_node, ( i32 )batch.consumer_node );
+    }
+}
+
+void FrameGraphQueueSchedule::debug_ui( FrameGraph* frame_graph ) {
+    ImGui::Text( "Async compute %s, %u batches, %u graphics submissions", frame_graph->async_compute ? "enabled" : "disabled", batches.size, segment_count );
+
+    for ( u32 n = 0; n < node_batches.size; ++n ) {
+        if ( node_reasons[ n ] == nullptr ) {
+            continue;
+        }
+
+        FrameGraphNode* node = frame_graph->access_node( frame_graph->nodes[ n ] );
+        ImGui::Text( "%s: %s, %s", node->name, is_async( n ) ? "async compute" : "graphics", node_reasons[ n ] );
+    }
+}
+
+// FrameGraphRenderPassCache /////////////////////////////////////////////////////////////
+
+void FrameGraphRenderPassCache::init( Allocator* allocator )
+{
+    render_pass_map.init( allocator, FrameGraphBuilder::k_max_render_pass_count );
+}
+
+void FrameGraphRenderPassCache::shutdown( )
+{
+    render_pass_map.shutdown( );
+}
+
+// FrameGraphResourceCache /////////////////////////////////////////////////////////////
+
+void FrameGraphResourceCache::init( Allocator* allocator, GpuDevice* device_ )
+{
+    device = device_;
+
+    resources.init( allocator, FrameGraphBuilder::k_max_resources_count );
+    resource_map.init( allocator, FrameGraphBuilder::k_max_resources_count );
+}
+
+void FrameGraphResourceCache::shutdown( )
+{
+    FlatHashMapIterator it = resource_map.iterator_begin();
+    while ( it.is_valid() && device != nullptr ) {
+
+        u32 resource_index = resource_map.get( it );
+        FrameGraphResource* resource = resources.get( resource_index );
+
+        if ( ( resource->type == FrameGraphResourceType_Texture || resource->type == FrameGraphResourceType_Attachment )
+             && ( resource->resource_info.texture.handle.index > 0 && resource->resource_info.texture.handle.index != k_invalid_index ) ) {
+            Texture* texture = device->access_texture( resource->resource_info.texture.handle );
+            device->destroy_texture( texture->handle );
+        } else if ( ( resource->type == FrameGraphResourceType_Buffer )
+                    && ( resource->resource_info.buffer.handle.index > 0 && resource->resource_info.buffer.handle.index != k_invalid_index ) ) {
             Buffer* buffer = device->access_buffer( resource->resource_info.buffer.handle );
             device->destroy_buffer( buffer->handle );
         }
@@ -1013,6 +2446,18 @@ void FrameGraphBuilder::init( GpuDevice* device_ ) {
     render_pass_cache.init( allocator );
 }
 
+void FrameGraphBuilder::init_headless( Allocator* allocator_, u32 width, u32 height ) {
+    device = nullptr;
+    allocator = allocator_;
+
+    headless_width = width;
+    headless_height = height;
+
+    resource_cache.init( allocator, nullptr );
+    node_cache.init( allocator, nullptr );
+    render_pass_cache.init( allocator );
+}
+
 void FrameGraphBuilder::shutdown() {
     resource_cache.shutdown( );
     node_cache.shutdown( );
@@ -1093,6 +2538,8 @@ FrameGraphNodeHandle FrameGraphBuilder::create_node( const FrameGraphNodeCreatio
     node->enabled = creation.enabled;
     node->compute = creation.compute;
     node->ray_tracing = creation.ray_tracing;
+    node->queue = creation.queue;
+    node->graph_render_pass = nullptr;
     node->inputs.init( allocator, creation.inputs.size );
     node->outputs.init( allocator, creation.outputs.size );
     node->edges.init( allocator, creation.outputs.size );
@@ -1124,7 +2571,11 @@ FrameGraphNodeHandle FrameGraphBuilder::create_node( const FrameGraphNodeCreatio
 }
 
 FrameGraphNode* FrameGraphBuilder::get_node( cstring name ) {
-    FlatHashMapIterator it = node_cache.node_map.find( hash_calculate( name ) );
+    return get_node( hash_calculate( name ) );
+}
+
+FrameGraphNode* FrameGraphBuilder::get_node( u64 name_hash ) {
+    FlatHashMapIterator it = node_cache.node_map.find( name_hash );
     if ( it.is_invalid() ) {
         return nullptr;
     }
@@ -1162,7 +2613,11 @@ void FrameGraphBuilder::add_resource( cstring name, FrameGraphResourceType type,
 }
 
 FrameGraphResource* FrameGraphBuilder::get_resource( cstring name ) {
-    FlatHashMapIterator it = resource_cache.resource_map.find( hash_calculate( name ) );
+    return get_resource( hash_calculate( name ) );
+}
+
+FrameGraphResource* FrameGraphBuilder::get_resource( u64 name_hash ) {
+    FlatHashMapIterator it = resource_cache.resource_map.find( name_hash );
     if ( it.is_invalid() ) {
         return nullptr;
     }
@@ -7,6 +7,8 @@
 
 #include "graphics/gpu_resources.hpp"
 
+#include "external/enkiTS/TaskScheduler.h"
+
 namespace raptor {
 
 struct Allocator;
@@ -35,6 +37,14 @@ enum FrameGraphResourceType {
     FrameGraphResourceType_ShadingRate     = 4
 };
 
+//
+// Queue requested for a node in the graph description.
+namespace FrameGraphQueue {
+    enum Enum {
+        Auto = 0, Graphics, AsyncCompute, Count
+    };
+} // namespace FrameGraphQueue
+
 struct FrameGraphResourceInfo {
     bool                                    external = false;
 
@@ -62,6 +72,7 @@ struct FrameGraphResourceInfo {
             f32                             clear_values[ 4 ];  // Reused between color or depth/stencil.
 
             bool                            compute;
+            bool                            aliasable;          // Memory can be reused by resources with disjoint lifetimes.
         } texture;
     };
 
@@ -114,6 +125,8 @@ struct FrameGraphNodeCreation {
     const char*                             name;
     bool                                    compute;
     bool                                    ray_tracing;
+
+    FrameGraphQueue::Enum                   queue;
 };
 
 struct FrameGraphRenderPass
@@ -123,6 +136,11 @@ struct FrameGraphRenderPass
     virtual void                            render( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene ) { }
     virtual void                            post_render( u32 current_frame_index, CommandBuffer* gpu_commands, FrameGraph* frame_graph, RenderScene* render_scene ) { }
 
+    // Passes whose render() only records draws inside the render pass can be recorded on the task threads:
+    // return how many draws render_range can split, 0 to always record inline.
+    virtual u32                             parallel_draw_count( RenderScene* render_scene ) { return 0; }
+    virtual void                            render_range( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene, u32 first_draw, u32 draw_count ) { render( current_frame_index, gpu_commands, render_scene ); }
+
     virtual void                            prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {}
     virtual void                            free_gpu_resources( GpuDevice& gpu ) {}
 
@@ -132,6 +150,9 @@ struct FrameGraphRenderPass
 
     virtual void                            reload_shaders( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {}
 
+    // Compute passes that only dispatch, without touching resources outside of the graph, can run on the async compute queue.
+    virtual bool                            supports_async_compute() { return false; }
+
     bool                                    enabled = true;
 };
 
@@ -154,9 +175,223 @@ struct FrameGraphNode {
     bool                                    ray_tracing = false;
     bool                                    enabled = true;
 
+    FrameGraphQueue::Enum                   queue   = FrameGraphQueue::Auto;
+
     const char*                             name    = nullptr;
 };
 
+//
+// Lifetime of a transient attachment over the sorted nodes, and the heap it is placed in.
+struct FrameGraphTransientResource {
+    FrameGraphResourceHandle                handle;
+
+    u32                                     first_node;     // Index in FrameGraph::nodes of the producer.
+    u32                                     last_node;      // Index in FrameGraph::nodes of the last reader.
+
+    sizet                                   size;
+    sizet                                   alignment;
+    u32                                     memory_type_bits;
+
+    u32                                     heap;
+    bool                                    relative_size;  // Follows the swapchain size.
+    bool                                    aliasable;
+};
+
+//
+// Memory allocated by its owner, the largest resource placed in it.
+// The other resources of the heap alias it and never overlap in time.
+struct FrameGraphMemoryHeap {
+    FrameGraphResourceHandle                owner;
+
+    sizet                                   size;
+    sizet                                   alignment;
+    u32                                     memory_type_bits;
+
+    u32                                     resource_count;
+    bool                                    relative_size;
+};
+
+//
+//
+struct FrameGraphMemoryPlan {
+    void                                    init( Allocator* allocator );
+    void                                    shutdown();
+
+    // Assigns every resource to a heap, reusing heaps between resources with disjoint lifetimes.
+    void                                    alias_resources( bool enable_aliasing );
+
+    void                                    print_report( FrameGraph* frame_graph );
+    void                                    debug_ui( FrameGraph* frame_graph );
+
+    Array<FrameGraphTransientResource>      resources;
+    Array<FrameGraphMemoryHeap>             heaps;
+
+    sizet                                   unaliased_size  = 0;    // Every resource with its own memory.
+    sizet                                   aliased_size    = 0;    // Sum of the heaps.
+    sizet                                   peak_live_size  = 0;    // Largest sum of resources alive at the same node, the lower bound.
+    u32                                     node_count      = 0;
+};
+
+//
+// Transition of a texture before a node, with the masks of the previous and next access.
+struct FrameGraphBarrier {
+    FrameGraphResourceHandle                resource;
+
+    ResourceState                           source_state;       // Expected state, left by the previous access in the graph.
+    ResourceState                           destination_state;
+
+    VkPipelineStageFlags2KHR                source_stage;
+    VkAccessFlags2KHR                       source_access;      // Only the writes of the previous access.
+    VkPipelineStageFlags2KHR                destination_stage;
+    VkAccessFlags2KHR                       destination_access;
+
+    u32                                     node;               // Index in FrameGraph::nodes waiting for the barrier.
+    u32                                     signal_node;        // Split barriers are signaled after this node, k_invalid_index otherwise.
+    u32                                     split_index;
+    u32                                     release_node;       // Queue ownership is released after this node, k_invalid_index otherwise.
+
+    bool                                    is_depth;
+    bool                                    required;           // False when the previous access already left the texture ready.
+    bool                                    discard;            // First use of an aliased texture, the content is undefined.
+    bool                                    queue_transfer;     // Previous access on a queue of another family.
+};
+
+//
+// Barriers of the sorted nodes, computed when the graph is compiled and recorded in a single batch per node.
+struct FrameGraphBarrierPlan {
+    void                                    init( Allocator* allocator );
+    void                                    shutdown();
+
+    void                                    build( FrameGraph* frame_graph, bool enable_split_barriers );
+    void                                    create_events( GpuDevice* gpu );
+    void                                    destroy_events( GpuDevice* gpu );
+
+    void                                    add_node_barriers( u32 node_index, u32 current_frame_index, FrameGraph* frame_graph, CommandBuffer* gpu_commands );
+    void                                    signal_split_barriers( u32 node_index, u32 current_frame_index, FrameGraph* frame_graph, CommandBuffer* gpu_commands );
+    void                                    release_queue_transfers( u32 node_index, FrameGraph* frame_graph, CommandBuffer* gpu_commands );
+
+    void                                    print( FrameGraph* frame_graph );
+    void                                    debug_ui( FrameGraph* frame_graph );
+
+    static constexpr u32                    k_split_barrier_min_distance = 2;   // Node distance from the previous access to split a barrier.
+
+    Array<FrameGraphBarrier>                barriers;               // Sorted by node.
+    Array<u32>                              node_barrier_offsets;   // Node i owns [ offsets[ i ], offsets[ i + 1 ] ) of barriers.
+    Array<u8>                               aliasing_nodes;         // Nodes starting the lifetime of aliased memory.
+
+    Array<u32>                              split_barriers;         // Barrier indices, sorted by signal node.
+    Array<VkImageMemoryBarrier2KHR>         split_image_barriers;   // Recorded when signaling, reused when waiting.
+    Array<VkEvent>                          split_events;           // One per split barrier and frame in flight.
+    Array<u8>                               split_signaled;
+
+    Array<u8>                               transfer_released;      // Per barrier, the release was recorded and the next wait can acquire.
+
+    u32                                     required_count  = 0;
+    u32                                     transfer_count  = 0;
+};
+
+//
+// Consecutive nodes on the async compute queue, recorded in one command buffer.
+struct FrameGraphAsyncBatch {
+    u32                                     first_node;
+    u32                                     last_node;
+
+    u32                                     producer_node;      // Last graphics node the batch depends on, k_invalid_index when it only depends on the previous frame.
+    u32                                     consumer_node;      // First graphics node depending on the batch, k_invalid_index when only the next frame does.
+    u32                                     wait_segment;       // Graphics segments submitted before the batch can start, 0 to wait for the previous frame.
+};
+
+//
+// Assignment of the sorted nodes to the graphics and async compute queues. The graphics work of the frame
+// is split in segments, submitted separately, so that each batch waits only for the graphics work it depends on.
+struct FrameGraphQueueSchedule {
+    void                                    init( Allocator* allocator );
+    void                                    shutdown();
+
+    void                                    build( FrameGraph* frame_graph, bool enable_async_compute );
+    bool                                    is_async( u32 node_index ) const;
+
+    void                                    print( FrameGraph* frame_graph );
+    void                                    debug_ui( FrameGraph* frame_graph );
+
+    static constexpr u32                    k_max_batches           = 4;    // GpuDevice::k_max_async_compute_command_buffers.
+    static constexpr u32                    k_min_overlap_nodes     = 1;    // Graphics nodes that can run while the batch executes.
+
+    Array<FrameGraphAsyncBatch>             batches;
+    Array<u32>                              node_batches;   // Batch per node, k_invalid_index on the graphics queue.
+    Array<u8>                               node_splits;    // A new graphics segment starts before the node.
+    Array<u32>                              node_waits;     // Batches the segment starting at the node waits for.
+    Array<u32>                              node_overlaps;  // Graphics nodes between the producer and the consumer of a compute node.
+    Array<cstring>                          node_reasons;   // Decision for compute nodes.
+
+    u32                                     segment_count   = 1;
+    bool                                    separate_queue_families = true;
+};
+
+//
+// Range of draws of a node recorded into a secondary command buffer.
+struct FrameGraphRecordingChunk {
+    CommandBuffer*                          commands;
+
+    u32                                     node;           // Index in FrameGraph::nodes.
+    u32                                     first_draw;
+    u32                                     draw_count;
+
+    u32                                     thread_index;
+    f32                                     cpu_time_ms;
+};
+
+//
+//
+struct FrameGraphNodeTiming {
+    f32                                     recording_ms;   // CPU time spent recording the node, on all threads.
+    f32                                     wait_ms;        // Time the recording thread waited for the node secondary command buffers.
+    u32                                     chunks;         // 0 when recorded inline.
+};
+
+//
+//
+struct FrameGraphRecordingTask : public enki::ITaskSet {
+
+    void                                    ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) override;
+
+    FrameGraph*                             frame_graph     = nullptr;
+    RenderScene*                            render_scene    = nullptr;
+    u32                                     current_frame_index = 0;
+    u32                                     first_chunk     = 0;
+};
+
+//
+// Records the draws of graphics nodes into secondary command buffers on the task threads. The calling thread
+// records barriers and all the other nodes, and executes the secondary command buffers in topological order.
+struct FrameGraphRecordingPlan {
+    void                                    init( Allocator* allocator );
+    void                                    shutdown();
+
+    void                                    begin_frame( u32 node_count );
+    void                                    end_frame( f32 frame_time_ms );
+
+    void                                    kick( u32 current_frame_index, FrameGraph* frame_graph, RenderScene* render_scene );
+    bool                                    is_parallel( u32 node_index ) const;
+    void                                    execute_node( u32 node_index, CommandBuffer* gpu_commands );
+
+    void                                    debug_ui( FrameGraph* frame_graph );
+
+    static constexpr u32                    k_max_parallel_nodes    = 8;
+    static constexpr u32                    k_min_draws_per_chunk   = 64;
+
+    FrameGraphRecordingTask                 tasks[ k_max_parallel_nodes ];
+    Array<FrameGraphRecordingChunk>         chunks;         // Sorted by node.
+    Array<u32>                              node_tasks;     // Task per node, k_invalid_index when recorded inline.
+    Array<FrameGraphNodeTiming>             node_timings;
+
+    enki::TaskScheduler*                    task_scheduler  = nullptr;
+    u32                                     task_count      = 0;
+
+    f32                                     frame_time_ms   = 0.f;  // Time spent in FrameGraph::render.
+    f32                                     serial_time_ms  = 0.f;  // Sum of the node recording times.
+};
+
 struct FrameGraphRenderPassCache {
     void                                    init( Allocator* allocator );
     void                                    shutdown( );
@@ -188,6 +423,9 @@ struct FrameGraphNodeCache {
 //
 struct FrameGraphBuilder : public Service {
     void                            init( GpuDevice* device );
+    // Without a device graphs can be parsed and compiled to inspect them, no gpu resources are created
+    // and texture memory is estimated from the formats.
+    void                            init_headless( Allocator* allocator, u32 width, u32 height );
     void                            shutdown();
 
     void                            register_render_pass( cstring name, FrameGraphRenderPass* render_pass );
@@ -197,10 +435,12 @@ struct FrameGraphBuilder : public Service {
     FrameGraphNodeHandle            create_node( const FrameGraphNodeCreation& creation );
 
     FrameGraphNode*                 get_node( cstring name );
+    FrameGraphNode*                 get_node( u64 name_hash );      // Use rhash( "name" ) for literals.
     FrameGraphNode*                 access_node( FrameGraphNodeHandle handle );
 
     void                            add_resource( cstring name, FrameGraphResourceType type, FrameGraphResourceInfo resource_info );
     FrameGraphResource*             get_resource( cstring name );
+    FrameGraphResource*             get_resource( u64 name_hash );
     FrameGraphResource*             access_resource( FrameGraphResourceHandle handle );
 
     FrameGraphResourceCache         resource_cache;
@@ -211,6 +451,10 @@ struct FrameGraphBuilder : public Service {
 
     GpuDevice*                      device;
 
+    // Size used to resolve relative resolutions when there is no device.
+    u32                             headless_width                      = 0;
+    u32                             headless_height                     = 0;
+
     static constexpr u32            k_max_render_pass_count             = 256;
     static constexpr u32            k_max_resources_count               = 1024;
     static constexpr u32            k_max_nodes_count                   = 1024;
@@ -233,18 +477,29 @@ struct FrameGraph {
     void                            disable_render_pass( cstring render_pass_name );
     void                            compile();
     void                            add_ui();
-    void                            render( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene );
+    // Returns the command buffer to continue the frame with, different from gpu_commands when graphics work was split for the async compute queue.
+    CommandBuffer*                  render( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene );
     void                            on_resize( GpuDevice& gpu, u32 new_width, u32 new_height );
     void                            reload_shaders( RenderScene& scene, Allocator* resident_allocator, StackAllocator* scratch_allocator );
 
     void                            debug_ui();
+    void                            lookup_benchmark_ui();
+
+    void                            plan_transient_memory( u32 width, u32 height );
+    void                            create_transient_resources();
+    void                            resize_transient_resources( u32 width, u32 height );
+
+    // Render passes are registered after compile, call once they are to move the nodes supporting it to the async compute queue.
+    void                            build_queue_schedule();
 
     void                            add_node( FrameGraphNodeCreation& creation );
     FrameGraphNode*                 get_node( cstring name );
+    FrameGraphNode*                 get_node( u64 name_hash );      // Use rhash( "name" ) for literals.
     FrameGraphNode*                 access_node( FrameGraphNodeHandle handle );
 
     void                            add_resource( cstring name, FrameGraphResourceType type, FrameGraphResourceInfo resource_info );
     FrameGraphResource*             get_resource( cstring name );
+    FrameGraphResource*             get_resource( u64 name_hash );
     FrameGraphResource*             access_resource( FrameGraphResourceHandle handle );
 
     // NOTE(marco): nodes sorted in topological order
@@ -256,7 +511,22 @@ struct FrameGraph {
 
     LinearAllocator                 local_allocator;
 
+    FrameGraphMemoryPlan            memory_plan;
+    bool                            transient_aliasing = true;
+
+    FrameGraphBarrierPlan           barrier_plan;
+    bool                            split_barriers = false;
+
+    FrameGraphRecordingPlan         recording_plan;
+    bool                            parallel_recording = false;
+
+    FrameGraphQueueSchedule         queue_schedule;
+    bool                            async_compute = false;
+
     const char*                     name = nullptr;
 };
 
+// Parses and compiles a graph without a GpuDevice, and prints its transient memory and barriers.
+void                                frame_graph_print_report( cstring file_path, u32 width, u32 height, StackAllocator* temp_allocator );
+
 } // namespace raptor
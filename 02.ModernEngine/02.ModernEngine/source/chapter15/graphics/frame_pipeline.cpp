@@ -0,0 +1,357 @@
+#include "graphics/frame_pipeline.hpp"
+#include "graphics/animation.hpp"
+#include "graphics/scene_graph.hpp"
+
+#include "foundation/memory.hpp"
+#include "foundation/assert.hpp"
+#include "foundation/log.hpp"
+#include "foundation/time.hpp"
+
+#include "external/cglm/struct/mat4.h"
+
+#include "external/imgui/imgui.h"
+
+#include "external/tracy/tracy/Tracy.hpp"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+namespace raptor {
+
+// FrameTimeHistogram ////////////////////////////////////////////////////
+
+void FrameTimeHistogram::reset() {
+    memset( buckets, 0, sizeof( buckets ) );
+    count = 0;
+    total_ms = 0.0;
+    max_ms = 0.0;
+}
+
+void FrameTimeHistogram::add( f64 milliseconds ) {
+    const u32 bucket = ( u32 )( milliseconds / k_bucket_ms );
+    buckets[ bucket < k_bucket_count ? bucket : k_bucket_count - 1 ] += 1.f;
+
+    ++count;
+    total_ms += milliseconds;
+    max_ms = milliseconds > max_ms ? milliseconds : max_ms;
+}
+
+f64 FrameTimeHistogram::mean() const {
+    return count ? total_ms / count : 0.0;
+}
+
+f64 FrameTimeHistogram::percentile( f32 fraction ) const {
+    const f32 target = count * fraction;
+    f32 accumulated = 0.f;
+    for ( u32 b = 0; b < k_bucket_count - 1; ++b ) {
+        accumulated += buckets[ b ];
+        if ( accumulated >= target ) {
+            const f64 upper_ms = ( b + 1 ) * k_bucket_ms;
+            return upper_ms < max_ms ? upper_ms : max_ms;
+        }
+    }
+    return max_ms;
+}
+
+// FramePipelineSimulationTask ///////////////////////////////////////////
+
+void FramePipelineSimulationTask::ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) {
+    ZoneScoped;
+
+    pipeline->simulate_frames();
+}
+
+// FramePipeline /////////////////////////////////////////////////////////
+
+void FramePipeline::init( Allocator* allocator_, u32 depth_ ) {
+    allocator = allocator_;
+
+    for ( u32 s = 0; s < k_max_depth; ++s ) {
+        slots[ s ].nodes.init( allocator, 0 );
+        slots[ s ].local_matrices.init( allocator, 0 );
+    }
+
+    simulation_task.pipeline = this;
+    simulation_task.m_SetSize = 1;
+
+    read_slot = 0;
+    ready_count = 0;
+    simulation_in_flight = false;
+
+    set_depth( depth_ );
+    reset_histograms();
+}
+
+void FramePipeline::shutdown() {
+    RASSERTM( !simulation_in_flight, "Frame pipeline shut down with a simulation in flight, call begin_frame first." );
+
+    for ( u32 s = 0; s < k_max_depth; ++s ) {
+        slots[ s ].nodes.shutdown();
+        slots[ s ].local_matrices.shutdown();
+    }
+}
+
+void FramePipeline::set_depth( u32 depth_ ) {
+    depth = depth_ < 1 ? 1 : ( depth_ > k_max_depth ? k_max_depth : depth_ );
+}
+
+void FramePipeline::begin_frame() {
+    ZoneScoped;
+
+    f64 wait_ms = 0.0;
+    if ( simulation_in_flight ) {
+        const i64 wait_start = time_now();
+        task_scheduler->WaitforTask( &simulation_task );
+        wait_ms = time_from_milliseconds( wait_start );
+
+        simulation_in_flight = false;
+    }
+
+    add_time( FramePipelineStage::SimulationWait, wait_ms );
+}
+
+void FramePipeline::apply_simulation( AnimationSystem* animation_system_, const Animation* animations_, SceneGraph* scene_graph,
+                                      f32 delta_time_, enki::TaskScheduler* task_scheduler_ ) {
+    ZoneScoped;
+
+    RASSERTM( !simulation_in_flight, "Frame pipeline simulation applied before begin_frame." );
+
+    // Pipeline empty, either depth 1 or the first frame after raising it.
+    if ( ready_count == 0 ) {
+        const i64 simulation_start = time_now();
+        animation_system_->update( animations_, delta_time_, task_scheduler_ );
+        add_time( FramePipelineStage::Simulation, time_from_milliseconds( simulation_start ) );
+
+        for ( u32 p = 0; p < animation_system_->poses.size; ++p ) {
+            animation_system_->poses[ p ].write_local_matrices( scene_graph );
+        }
+        return;
+    }
+
+    const FramePipelineSlot& slot = slots[ read_slot ];
+    const u32 scene_graph_count = scene_graph->node_count();
+    for ( u32 n = 0; n < slot.nodes.size; ++n ) {
+        if ( slot.nodes[ n ] < scene_graph_count ) {
+            scene_graph->set_local_matrix( slot.nodes[ n ], slot.local_matrices[ n ] );
+        }
+    }
+
+    read_slot = ( read_slot + 1 ) % k_max_depth;
+    --ready_count;
+}
+
+void FramePipeline::kick_simulation( AnimationSystem* animation_system_, const Animation* animations_, f32 delta_time_,
+                                     enki::TaskScheduler* task_scheduler_ ) {
+    ZoneScoped;
+
+    if ( depth <= 1 || ready_count >= depth - 1 || animation_system_->poses.size == 0 ) {
+        return;
+    }
+
+    animation_system = animation_system_;
+    animations = animations_;
+    task_scheduler = task_scheduler_;
+    delta_time = delta_time_;
+    frames_to_simulate = depth - 1 - ready_count;
+
+    // Slots are sized here, so that the task never allocates while the main thread does.
+    u32 max_nodes = 0;
+    for ( u32 p = 0; p < animation_system->poses.size; ++p ) {
+        max_nodes += animation_system->poses[ p ].node_count;
+    }
+    for ( u32 f = 0; f < frames_to_simulate; ++f ) {
+        FramePipelineSlot& slot = slots[ ( read_slot + ready_count + f ) % k_max_depth ];
+        slot.nodes.set_capacity( max_nodes );
+        slot.local_matrices.set_capacity( max_nodes );
+    }
+
+    if ( task_scheduler ) {
+        simulation_in_flight = true;
+        task_scheduler->AddTaskSetToPipe( &simulation_task );
+    } else {
+        simulate_frames();
+    }
+}
+
+void FramePipeline::simulate_frames() {
+    for ( u32 f = 0; f < frames_to_simulate; ++f ) {
+        const i64 simulation_start = time_now();
+        animation_system->update( animations, delta_time, task_scheduler );
+
+        FramePipelineSlot& slot = slots[ ( read_slot + ready_count ) % k_max_depth ];
+        slot.nodes.clear();
+        slot.local_matrices.clear();
+
+        // Same animated nodes as AnimationPose::write_local_matrices.
+        for ( u32 p = 0; p < animation_system->poses.size; ++p ) {
+            const AnimationPose& pose = animation_system->poses[ p ];
+            for ( u32 n = 0; n < pose.node_count; ++n ) {
+                const f32* node_weights = pose.weights + n * AnimationChannel::Weights;
+                if ( node_weights[ AnimationChannel::Translation ] + node_weights[ AnimationChannel::Rotation ] + node_weights[ AnimationChannel::Scale ] > 0.f ) {
+                    slot.nodes.push( pose.node_offset + n );
+                    slot.local_matrices.push( pose.get_local_matrix( n ) );
+                }
+            }
+        }
+
+        ++ready_count;
+        add_time( FramePipelineStage::Simulation, time_from_milliseconds( simulation_start ) );
+    }
+    frames_to_simulate = 0;
+}
+
+void FramePipeline::add_time( FramePipelineStage::Enum stage, f64 milliseconds ) {
+    histograms[ stage ].add( milliseconds );
+}
+
+void FramePipeline::reset_histograms() {
+    for ( u32 s = 0; s < FramePipelineStage::Count; ++s ) {
+        histograms[ s ].reset();
+    }
+}
+
+void FramePipeline::debug_ui() {
+    i32 ui_depth = ( i32 )depth;
+    if ( ImGui::SliderInt( "Depth", &ui_depth, 1, k_max_depth ) ) {
+        set_depth( ( u32 )ui_depth );
+    }
+    ImGui::Text( "Simulated frames ready %u", ready_count );
+
+    // Simulation that did not block the main thread ran during the recording of the previous frame.
+    const f64 hidden_ms = histograms[ FramePipelineStage::Simulation ].mean() - histograms[ FramePipelineStage::SimulationWait ].mean();
+    ImGui::Text( "Simulation overlapped with recording %.3f ms per frame", hidden_ms > 0.0 ? hidden_ms : 0.0 );
+
+    if ( ImGui::Button( "Reset Histograms" ) ) {
+        reset_histograms();
+    }
+    ImGui::Separator();
+
+    char overlay[ 128 ];
+    for ( u32 s = 0; s < FramePipelineStage::Count; ++s ) {
+        const FrameTimeHistogram& histogram = histograms[ s ];
+        snprintf( overlay, sizeof( overlay ), "mean %.2f p95 %.2f max %.2f ms", histogram.mean(), histogram.percentile( 0.95f ), histogram.max_ms );
+
+        ImGui::PlotHistogram( FramePipelineStage::s_value_names[ s ], histogram.buckets, FrameTimeHistogram::k_bucket_count, 0, overlay, 0.f, FLT_MAX, ImVec2( 0, 60 ) );
+    }
+    ImGui::Text( "Buckets of %.1f ms, the last one holds longer times.", FrameTimeHistogram::k_bucket_ms );
+}
+
+// Benchmark /////////////////////////////////////////////////////////////
+
+//
+// Stands for the draw task: a fixed recording time on one worker.
+struct FramePipelineRecordingTask : public enki::ITaskSet {
+
+    void ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) override {
+        const i64 start = time_now();
+        while ( time_from_milliseconds( start ) < recording_ms ) {
+        }
+    }
+
+    f64                                 recording_ms    = 0.0;
+
+}; // struct FramePipelineRecordingTask
+
+void frame_pipeline_benchmark( Allocator* allocator, enki::TaskScheduler* task_scheduler, u32 num_characters ) {
+    const u32 num_joints = 64;
+    const u32 num_frames = 240;
+    const f32 delta_time = 1.f / 60.f;
+    const f64 recording_ms = 4.0;
+    const u32 num_nodes = num_characters * num_joints;
+
+    Animation animations[ 2 ];
+    animation_benchmark_create( animations[ 0 ], allocator, num_joints, 61, 2.f, AnimationSampler::Linear, 0.f );
+    animation_benchmark_create( animations[ 1 ], allocator, num_joints, 31, 1.5f, AnimationSampler::CubicSpline, 1.f );
+
+    rprint( "Frame pipeline benchmark: %u characters, %u joints, %u frames, %.1f ms recording, %u threads.\n",
+            num_characters, num_joints, num_frames, recording_ms, task_scheduler->GetNumTaskThreads() );
+
+    mat4s* reference_matrices = ( mat4s* )rallocaa( sizeof( mat4s ) * num_nodes, allocator, 16 );
+
+    for ( u32 depth = 1; depth <= FramePipeline::k_max_depth; ++depth ) {
+        // Each character is a joint chain.
+        SceneGraph scene_graph;
+        scene_graph.init( allocator, num_nodes );
+        scene_graph.resize( num_nodes );
+        for ( u32 i = 0; i < num_nodes; ++i ) {
+            const u32 joint = i % num_joints;
+            if ( joint ) {
+                scene_graph.set_hierarchy( i, i - 1, joint );
+            }
+        }
+
+        AnimationSystem animation_system;
+        animation_system.init( allocator );
+        for ( u32 c = 0; c < num_characters; ++c ) {
+            AnimationPose& pose = animation_system.poses[ animation_system.add_pose( c * num_joints, num_joints, nullptr, 0 ) ];
+            AnimationInstance& walk = pose.instances[ pose.add_instance( animations[ 0 ], 0, 1.f, 1.f ) ];
+            walk.current_time = fmodf( c * 0.013f, animations[ 0 ].time_end );
+
+            if ( c & 1 ) {
+                pose.add_instance( animations[ 1 ], 1, 0.5f, 1.2f );
+            }
+        }
+
+        FramePipeline pipeline;
+        pipeline.init( allocator, depth );
+
+        FramePipelineRecordingTask recording_task;
+        recording_task.recording_ms = recording_ms;
+
+        const i64 start = time_now();
+        for ( u32 f = 0; f < num_frames; ++f ) {
+            const i64 frame_start = time_now();
+
+            pipeline.begin_frame();
+            pipeline.apply_simulation( &animation_system, animations, &scene_graph, delta_time, task_scheduler );
+            scene_graph.update_matrices( task_scheduler );
+
+            task_scheduler->AddTaskSetToPipe( &recording_task );
+            pipeline.kick_simulation( &animation_system, animations, delta_time, task_scheduler );
+
+            const i64 wait_start = time_now();
+            task_scheduler->WaitforTask( &recording_task );
+            pipeline.add_time( FramePipelineStage::RecordingWait, time_from_milliseconds( wait_start ) );
+            pipeline.add_time( FramePipelineStage::Frame, time_from_milliseconds( frame_start ) );
+        }
+        pipeline.begin_frame();
+        const f64 total_ms = time_from_milliseconds( start );
+
+        // Frames are applied in the same order at any depth, only the last simulated ones are not applied yet.
+        f32 max_difference = 0.f;
+        if ( depth == 1 ) {
+            memcpy( reference_matrices, scene_graph.local_matrices.data, sizeof( mat4s ) * num_nodes );
+        } else {
+            for ( u32 i = 0; i < num_nodes; ++i ) {
+                for ( u32 e = 0; e < 16; ++e ) {
+                    max_difference = glm_max( max_difference, fabsf( reference_matrices[ i ].raw[ e / 4 ][ e % 4 ] - scene_graph.local_matrices[ i ].raw[ e / 4 ][ e % 4 ] ) );
+                }
+            }
+        }
+
+        rprint( "Depth %u: %8.2f ms, %.3f ms per frame, max difference with depth 1 %f\n", depth, total_ms, total_ms / num_frames, max_difference );
+        for ( u32 s = 0; s < FramePipelineStage::Count; ++s ) {
+            const FrameTimeHistogram& histogram = pipeline.histograms[ s ];
+            rprint( "    %-16s mean %6.3f p95 %6.3f max %6.3f ms |", FramePipelineStage::s_value_names[ s ], histogram.mean(), histogram.percentile( 0.95f ), histogram.max_ms );
+
+            // Buckets up to the max, as a count per half millisecond.
+            const u32 last_bucket = ( u32 )( histogram.max_ms / FrameTimeHistogram::k_bucket_ms );
+            for ( u32 b = 0; b <= last_bucket && b < FrameTimeHistogram::k_bucket_count; ++b ) {
+                rprint( " %u", ( u32 )histogram.buckets[ b ] );
+            }
+            rprint( "\n" );
+        }
+
+        pipeline.shutdown();
+        animation_system.shutdown();
+        scene_graph.shutdown();
+    }
+
+    rfree( reference_matrices, allocator );
+
+    animation_benchmark_destroy( animations[ 0 ], allocator );
+    animation_benchmark_destroy( animations[ 1 ], allocator );
+}
+
+} // namespace raptor
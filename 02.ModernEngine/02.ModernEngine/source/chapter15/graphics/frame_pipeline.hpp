@@ -0,0 +1,129 @@
+#pragma once
+
+#include "foundation/array.hpp"
+
+#include "external/cglm/types-struct.h"
+
+#include "external/enkiTS/TaskScheduler.h"
+
+namespace raptor {
+
+    struct Allocator;
+    struct Animation;
+    struct AnimationSystem;
+    struct SceneGraph;
+
+    namespace FramePipelineStage {
+
+        enum Enum {
+            Frame, Simulation, SimulationWait, RecordingWait, Count
+        }; // enum Enum
+
+        static const char* s_value_names[] = {
+            "Frame", "Simulation", "Simulation Wait", "Recording Wait", "Count"
+        };
+
+    } // namespace FramePipelineStage
+
+    //
+    // Linear buckets of half a millisecond, the last one also counts longer times.
+    struct FrameTimeHistogram {
+
+        static const u32                k_bucket_count  = 64;
+        static constexpr f32            k_bucket_ms     = 0.5f;
+
+        void                            reset();
+        void                            add( f64 milliseconds );
+
+        f64                             mean() const;
+        // Upper bound of the bucket holding the percentile, in milliseconds.
+        f64                             percentile( f32 fraction ) const;
+
+        f32                             buckets[ k_bucket_count ];  // Floats, so that ImGui can plot them.
+        u32                             count           = 0;
+        f64                             total_ms        = 0.0;
+        f64                             max_ms          = 0.0;
+
+    }; // struct FrameTimeHistogram
+
+    //
+    // Local matrices of the animated nodes, as a simulated frame leaves them.
+    struct FramePipelineSlot {
+
+        Array<u32>                      nodes;
+        Array<mat4s>                    local_matrices;
+
+    }; // struct FramePipelineSlot
+
+    struct FramePipeline;
+
+    //
+    // Simulates the frames missing to fill the pipeline, one after the other.
+    struct FramePipelineSimulationTask : public enki::ITaskSet {
+
+        void                            ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) override;
+
+        FramePipeline*                  pipeline        = nullptr;
+
+    }; // struct FramePipelineSimulationTask
+
+    //
+    // Runs the CPU simulation of the next frames while the current one is recorded.
+    // Depth 1 simulates each frame at its start, as the loop always did. With depth N, up to N - 1 frames
+    // are simulated ahead, each into its own slot, on a task kicked once the recording has started.
+    // Frames ahead use the delta time of the frame that kicked them, and are shown N - 1 frames later.
+    //
+    // Hand-off points, in frame order:
+    // begin_frame: waits for the simulation in flight, after it the UI can edit the animation instances.
+    // apply_simulation: writes the oldest simulated frame to the scene graph, or simulates it now when none is ready.
+    // kick_simulation: starts filling the pipeline, after the draw task has been added.
+    struct FramePipeline {
+
+        static const u32                k_max_depth     = 3;
+
+        void                            init( Allocator* allocator, u32 depth );
+        void                            shutdown();
+
+        // Frames already simulated are still applied in order, so changing depth does not skip time.
+        void                            set_depth( u32 depth );
+
+        void                            begin_frame();
+        void                            apply_simulation( AnimationSystem* animation_system, const Animation* animations, SceneGraph* scene_graph,
+                                                          f32 delta_time, enki::TaskScheduler* task_scheduler );
+        // Runs inline when the task scheduler is null.
+        void                            kick_simulation( AnimationSystem* animation_system, const Animation* animations, f32 delta_time,
+                                                         enki::TaskScheduler* task_scheduler );
+
+        void                            simulate_frames();
+
+        void                            add_time( FramePipelineStage::Enum stage, f64 milliseconds );
+        void                            reset_histograms();
+
+        void                            debug_ui();
+
+        FramePipelineSlot               slots[ k_max_depth ];
+        FrameTimeHistogram              histograms[ FramePipelineStage::Count ];
+
+        FramePipelineSimulationTask     simulation_task;
+
+        // Simulation parameters, written before the task is kicked.
+        AnimationSystem*                animation_system = nullptr;
+        const Animation*                animations      = nullptr;
+        enki::TaskScheduler*            task_scheduler  = nullptr;
+        f32                             delta_time      = 0.f;
+        u32                             frames_to_simulate = 0;
+
+        Allocator*                      allocator       = nullptr;
+
+        u32                             depth           = 1;
+        u32                             read_slot       = 0;
+        u32                             ready_count     = 0;    // Simulated frames not applied yet.
+        bool                            simulation_in_flight = false;
+
+    }; // struct FramePipeline
+
+    // Animated characters and a fixed recording cost on a worker, for each depth: frame time histograms,
+    // and the final local matrices against depth 1.
+    void                                frame_pipeline_benchmark( Allocator* allocator, enki::TaskScheduler* task_scheduler, u32 num_characters );
+
+} // namespace raptor
@@ -3,13 +3,13 @@
 #include "graphics/raptor_imgui.hpp"
 #include "graphics/asynchronous_loader.hpp"
 #include "graphics/scene_graph.hpp"
+#include "graphics/texture_cooker.hpp"
 
 #include "foundation/file.hpp"
 #include "foundation/time.hpp"
 #include "foundation/numerics.hpp"
 
 #include "external/imgui/imgui.h"
-#include "external/stb_image.h"
 
 #include "external/cglm/struct/affine.h"
 #include "external/cglm/struct/mat4.h"
@@ -17,107 +17,51 @@
 #include "external/cglm/struct/quat.h"
 
 #include "external/tracy/tracy/Tracy.hpp"
-#include "external/meshoptimizer/meshoptimizer.h"
 
 namespace raptor {
 
 //
 // glTFScene //////////////////////////////////////////////////////////////
 
-void glTFScene::get_mesh_vertex_buffer( glTF::glTF& gltf_scene, u32 buffers_offset, i32 accessor_index, u32 flag, BufferHandle& out_buffer_handle, u32& out_buffer_offset, u32& out_flags ) {
-    if ( accessor_index != -1 ) {
-        glTF::Accessor& buffer_accessor = gltf_scene.accessors[ accessor_index ];
-        glTF::BufferView& buffer_view = gltf_scene.buffer_views[ buffer_accessor.buffer_view ];
-        BufferResource& buffer_gpu = buffers[ buffer_view.buffer + buffers_offset ];
+void glTFScene::get_mesh_vertex_buffer( const SceneBlobAccessor& accessor, u32 buffers_offset, u32 flag, BufferHandle& out_buffer_handle, u32& out_buffer_offset, u32& out_flags ) {
+    if ( accessor.buffer != -1 ) {
+        BufferResource& buffer_gpu = buffers[ accessor.buffer + buffers_offset ];
 
         out_buffer_handle = buffer_gpu.handle;
-        out_buffer_offset = glTF::get_data_offset( buffer_accessor.byte_offset, buffer_view.byte_offset );
+        out_buffer_offset = accessor.byte_offset;
 
         out_flags |= flag;
     }
 }
 
-void glTFScene::fill_pbr_material( glTF::glTF& gltf_scene, Renderer& renderer, glTF::Material& material, PBRMaterial& pbr_material ) {
+void glTFScene::fill_pbr_material( glTFSceneBlob& scene_blob, Renderer& renderer, SceneBlobMaterial& material, PBRMaterial& pbr_material ) {
     GpuDevice& gpu = *renderer.gpu;
 
-    // Handle flags
-    if ( material.alpha_mode.data != nullptr && strcmp( material.alpha_mode.data, "MASK" ) == 0 ) {
-        pbr_material.flags |= DrawFlags_AlphaMask;
-    } else if ( material.alpha_mode.data != nullptr && strcmp( material.alpha_mode.data, "BLEND" ) == 0 ) {
-        // TODO: how to choose when using dithering and traditional blending ?
-        pbr_material.flags |= DrawFlags_Transparent;
-        //pbr_material.flags |= DrawFlags_AlphaDither;
-    }
-
-    pbr_material.flags |= material.double_sided ? DrawFlags_DoubleSided : 0;
-    // Alpha cutoff
-    pbr_material.alpha_cutoff = material.alpha_cutoff != glTF::INVALID_FLOAT_VALUE ? material.alpha_cutoff : 1.f;
-
-    if ( material.pbr_metallic_roughness != nullptr ) {
-        if ( material.pbr_metallic_roughness->base_color_factor_count != 0 ) {
-            RASSERT( material.pbr_metallic_roughness->base_color_factor_count == 4 );
-
-            memcpy( pbr_material.base_color_factor.raw, material.pbr_metallic_roughness->base_color_factor, sizeof( vec4s ) );
-        } else {
-            pbr_material.base_color_factor = { 1.0f, 1.0f, 1.0f, 1.0f };
-        }
+    // Alpha and double sided flags are resolved when cooking.
+    pbr_material.flags |= material.flags;
+    pbr_material.alpha_cutoff = material.alpha_cutoff;
 
-        pbr_material.roughness = material.pbr_metallic_roughness->roughness_factor != glTF::INVALID_FLOAT_VALUE ? material.pbr_metallic_roughness->roughness_factor : 1.f;
-        pbr_material.metallic = material.pbr_metallic_roughness->metallic_factor != glTF::INVALID_FLOAT_VALUE ? material.pbr_metallic_roughness->metallic_factor : 0.f;
+    memcpy( pbr_material.base_color_factor.raw, material.base_color_factor, sizeof( vec4s ) );
+    memcpy( pbr_material.emissive_factor.raw, material.emissive_factor, sizeof( vec3s ) );
 
-        pbr_material.diffuse_texture_index = get_material_texture( gpu, gltf_scene, material.pbr_metallic_roughness->base_color_texture );
-        pbr_material.roughness_texture_index = get_material_texture( gpu, gltf_scene, material.pbr_metallic_roughness->metallic_roughness_texture );
-    }
-
-    if ( material.emissive_texture != nullptr ) {
-        pbr_material.emissive_texture_index = get_material_texture( gpu, gltf_scene, material.emissive_texture );
-    }
-
-    if ( material.emissive_factor_count != 0 ) {
-        RASSERT( material.emissive_factor_count == 3 );
-
-        memcpy( pbr_material.emissive_factor.raw, material.emissive_factor, sizeof( vec3s ) );
-    } else {
-        pbr_material.emissive_factor = { 0.0f, 0.0f, 0.0f };
-    }
-
-    pbr_material.occlusion_texture_index = get_material_texture( gpu, gltf_scene, ( material.occlusion_texture != nullptr ) ? material.occlusion_texture->index : -1 );
-    pbr_material.normal_texture_index = get_material_texture( gpu, gltf_scene, ( material.normal_texture != nullptr ) ? material.normal_texture->index : -1 );
-
-    if ( material.occlusion_texture != nullptr ) {
-        if ( material.occlusion_texture->strength != glTF::INVALID_FLOAT_VALUE ) {
-            pbr_material.occlusion = material.occlusion_texture->strength;
-        } else {
-            pbr_material.occlusion = 1.0f;
-        }
-    }
-}
-
-u16 glTFScene::get_material_texture( GpuDevice& gpu, glTF::glTF& gltf_scene, glTF::TextureInfo* texture_info ) {
-    if ( texture_info != nullptr ) {
-        glTF::Texture& gltf_texture = gltf_scene.textures[ texture_info->index ];
-        TextureResource& texture_gpu = images[ gltf_texture.source ];
-
-        if ( gltf_texture.sampler != i32_max ) {
-            SamplerResource& sampler_gpu = samplers[ gltf_texture.sampler ];
-
-            gpu.link_texture_sampler( texture_gpu.handle, sampler_gpu.handle );
-        }
+    pbr_material.roughness = material.roughness;
+    pbr_material.metallic = material.metallic;
+    pbr_material.occlusion = material.occlusion;
 
-        return texture_gpu.handle.index;
-    }
-    else {
-        return k_invalid_scene_texture_index;
-    }
+    pbr_material.diffuse_texture_index = get_material_texture( gpu, scene_blob, material.diffuse_texture );
+    pbr_material.roughness_texture_index = get_material_texture( gpu, scene_blob, material.roughness_texture );
+    pbr_material.emissive_texture_index = get_material_texture( gpu, scene_blob, material.emissive_texture );
+    pbr_material.occlusion_texture_index = get_material_texture( gpu, scene_blob, material.occlusion_texture );
+    pbr_material.normal_texture_index = get_material_texture( gpu, scene_blob, material.normal_texture );
 }
 
-u16 glTFScene::get_material_texture( GpuDevice& gpu, glTF::glTF& gltf_scene, i32 gltf_texture_index ) {
-    if ( gltf_texture_index >= 0 ) {
-        glTF::Texture& gltf_texture = gltf_scene.textures[ gltf_texture_index ];
-        TextureResource& texture_gpu = images[ gltf_texture.source ];
+u16 glTFScene::get_material_texture( GpuDevice& gpu, glTFSceneBlob& scene_blob, i32 texture_index ) {
+    if ( texture_index >= 0 ) {
+        SceneBlobTexture& texture = scene_blob.textures[ texture_index ];
+        TextureResource& texture_gpu = images[ texture.source ];
 
-        if ( gltf_texture.sampler != i32_max ) {
-            SamplerResource& sampler_gpu = samplers[ gltf_texture.sampler ];
+        if ( texture.sampler != i32_max ) {
+            SamplerResource& sampler_gpu = samplers[ texture.sampler ];
 
             gpu.link_texture_sampler( texture_gpu.handle, sampler_gpu.handle );
         }
@@ -152,74 +96,85 @@ void glTFScene::init( SceneGraph* scene_graph_, Allocator* resident_allocator_,
 
     animations.init( resident_allocator, 8 );
     skins.init( resident_allocator, 8 );
+    animation_system.init( resident_allocator );
 
     geometries.init( resident_allocator, 16 );
     build_range_infos.init( resident_allocator, 16 );
     geometry_transform_buffers.init( resident_allocator, 4 );
 
-    gltf_scenes.init( resident_allocator, 4 );
+    scene_caches.init( resident_allocator, 4 );
 }
 
 void glTFScene::add_mesh( cstring filename, cstring path, StackAllocator* temp_allocator, AsynchronousLoader* async_loader ) {
 
-    enki::TaskScheduler* task_scheduler = async_loader->task_scheduler;
     sizet temp_allocator_initial_marker = temp_allocator->get_marker();
 
     // Time statistics
     i64 start_scene_loading = time_now();
 
-    glTF::glTF gltf_scene = gltf_load_file( filename );
-    gltf_scenes.push( gltf_scene );
-
-    i64 end_loading_file = time_now();
-
-    Array<TextureCreation> tcs;
-    tcs.init( temp_allocator, gltf_scene.images_count, gltf_scene.images_count );
+    // The cooked scene lives next to the glTF file and is cooked again when missing or stale.
+    char cache_path[ 512 ];
+    snprintf( cache_path, 512, "%s.blob", filename );
 
-    StringBuffer temp_name_buffer;
-    temp_name_buffer.init( 4096, temp_allocator );
+    glTFSceneCache& scene_cache = scene_caches.push_use();
+    scene_cache = { };
 
-    for ( u32 image_index = 0; image_index < gltf_scene.images_count; ++image_index ) {
-        glTF::Image& image = gltf_scene.images[ image_index ];
+    const bool blob_mapped = scene_cache.load( cache_path );
+    if ( !blob_mapped ) {
+        scene_cache.cook( filename, cache_path, resident_allocator, async_loader->task_scheduler );
+    }
 
-        int comp, width, height;
+    glTFSceneBlob& scene_blob = *scene_cache.blob;
 
-        stbi_info( image.uri.data, &width, &height, &comp );
+    i64 end_loading_file = time_now();
 
-        u32 mip_levels = 1;
-        if ( true ) {
-            u32 w = width;
-            u32 h = height;
+    StringBuffer temp_name_buffer;
+    temp_name_buffer.init( 4096, temp_allocator );
 
-            while ( w > 1 && h > 1 ) {
-                w /= 2;
-                h /= 2;
+    for ( u32 image_index = 0; image_index < scene_blob.images.size; ++image_index ) {
+        SceneBlobImage& image = scene_blob.images[ image_index ];
 
-                ++mip_levels;
-            }
+        // Reconstruct file path
+        char* full_filename = temp_name_buffer.append_use_f( "%s%s", path, image.uri.c_str() );
+
+        // Stream the cooked texture when there is one, with its compressed format and mips.
+        VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+        u32 mip_levels = image.mip_levels;
+        char cooked_path[ 512 ];
+        Ktx2Info cooked_info;
+        // Images embedded in buffer views have no uri, and no cooked file next to them.
+        if ( renderer->gpu->texture_compression_bc_present && image.uri.size > 0 && texture_find_cooked( full_filename, cooked_path, ArraySize( cooked_path ), cooked_info ) &&
+             cooked_info.width == image.width && cooked_info.height == image.height ) {
+            format = cooked_info.format;
+            mip_levels = cooked_info.level_count;
+            full_filename = cooked_path;
         }
 
         TextureCreation tc;
-        tc.set_data( nullptr ).set_format_type( VK_FORMAT_R8G8B8A8_UNORM, TextureType::Texture2D ).set_flags( 0 ).set_size( ( u16 )width, ( u16 )height, 1 ).set_name( image.uri.data ).set_mips( mip_levels );
+        tc.set_data( nullptr ).set_format_type( format, TextureType::Texture2D ).set_flags( 0 ).set_size( ( u16 )image.width, ( u16 )image.height, 1 ).set_name( image.uri.c_str() ).set_mips( mip_levels );
         TextureResource* tr = renderer->create_texture( tc );
         RASSERT( tr != nullptr );
 
         images.push( *tr );
 
-        // Reconstruct file path
-        char* full_filename = temp_name_buffer.append_use_f( "%s%s", path, image.uri.data );
-        async_loader->request_texture_data( full_filename, tr->handle );
+        if ( image.buffer >= 0 ) {
+            // Decoded from the buffer bytes of the blob, which stays mapped as long as the scene.
+            const u8* image_data = scene_blob.buffers[ image.buffer ].data.get() + image.byte_offset;
+            cstring image_name = temp_name_buffer.append_use_f( "%s image %u", filename, image_index );
+            async_loader->request_texture_memory( image_data, image.byte_length, image_name, tr->handle );
+        }
+        else {
+            async_loader->request_texture_data( full_filename, tr->handle );
+        }
         // Reset name buffer
         temp_name_buffer.clear();
     }
 
-    i64 end_loading_textures_files = time_now();
-
     i64 end_creating_textures = time_now();
 
     // Load all samplers
-    for ( u32 sampler_index = 0; sampler_index < gltf_scene.samplers_count; ++sampler_index ) {
-        glTF::Sampler& sampler = gltf_scene.samplers[ sampler_index ];
+    for ( u32 sampler_index = 0; sampler_index < scene_blob.samplers.size; ++sampler_index ) {
+        SceneBlobSampler& sampler = scene_blob.samplers[ sampler_index ];
 
         char* sampler_name = names_buffer.append_use_f( "sampler_%u", sampler_index );
 
@@ -285,319 +240,106 @@ void glTFScene::add_mesh( cstring filename, cstring path, StackAllocator* temp_a
 
     i64 end_creating_samplers = time_now();
 
-    // Temporary array of buffer data
-    Array<void*> buffers_data;
-    buffers_data.init( resident_allocator, gltf_scene.buffers_count );
-
-    for ( u32 buffer_index = 0; buffer_index < gltf_scene.buffers_count; ++buffer_index ) {
-        glTF::Buffer& buffer = gltf_scene.buffers[ buffer_index ];
-
-        FileReadResult buffer_data = file_read_binary( buffer.uri.data, resident_allocator );
-        buffers_data.push( buffer_data.data );
-    }
-
-
-    // Load all buffers and initialize them with buffer data
+    // Load all buffers and initialize them with buffer data, read straight from the blob.
     u32 buffers_offset = buffers.size;
-    for ( u32 buffer_index = 0; buffer_index < gltf_scene.buffers_count; ++buffer_index ) {
+    for ( u32 buffer_index = 0; buffer_index < scene_blob.buffers.size; ++buffer_index ) {
 
-        glTF::Buffer& buffer = gltf_scene.buffers[ buffer_index ];
+        SceneBlobBuffer& buffer = scene_blob.buffers[ buffer_index ];
 
         VkBufferUsageFlags flags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
 
         char* buffer_name = names_buffer.append_use_f( "buffer_%u", buffer_index );
 
-        u8* buffer_data = ( u8* )buffers_data[ buffer_index ];
-        BufferResource* br = renderer->create_buffer( flags, ResourceUsageType::Immutable, buffer.byte_length, buffer_data, buffer_name );
+        BufferResource* br = renderer->create_buffer( flags, ResourceUsageType::Immutable, buffer.data.size, buffer.data.get(), buffer_name );
         buffers.push( *br );
     }
 
+    i64 end_creating_buffers = time_now();
 
-    i64 end_reading_buffers_data = time_now();
-
-    // Build meshlets
-    const sizet max_vertices = 64;
-    const sizet max_triangles = 124;
-    const f32 cone_weight = 0.0f;
-
-    u32 mesh_index = 0;
-
-    mesh_aabb[0] = vec3s{ FLT_MAX, FLT_MAX, FLT_MAX };
-    mesh_aabb[1] = vec3s{ FLT_MIN, FLT_MIN, FLT_MIN };
-
-    sizet temp_marker = temp_allocator->get_marker();
-
+    // Meshes and meshlets were built when cooking.
     u32 mesh_offset = meshes.size;
     u32 mesh_instances_offset = mesh_instances.size;
+    u32 gltf_mesh_offset_base = gltf_mesh_to_mesh_offset.size;
 
-    for ( u32 mi = 0; mi < gltf_scene.meshes_count; ++mi ) {
-        glTF::Mesh& mesh = gltf_scene.meshes[ mi ];
-
-        gltf_mesh_to_mesh_offset.push( meshes.size );
-
-        for ( u32 p = 0; p < mesh.primitives_count; ++p ) {
-            glTF::MeshPrimitive& mesh_primitive = mesh.primitives[ p ];
-
-            /*if ( mesh_primitive.material != glTF::INVALID_INT_VALUE ) {
-                glTF::Material& material = gltf_scene.materials[ mesh_primitive.material ];
-
-                if ( ( material.alpha_mode.data != nullptr && strcmp( material.alpha_mode.data, "MASK" ) == 0 ) ||
-                     ( material.alpha_mode.data != nullptr && strcmp( material.alpha_mode.data, "BLEND" ) == 0 ) ) {
-                    continue;
-                }
-            }*/
-
-            // Add meshes
-            Mesh mesh{};
-            // Load material defaults: flags is modified after this point.
-            mesh.pbr_material = {};
-
-            // Vertex positions
-            const i32 position_accessor_index = gltf_get_attribute_accessor_index( mesh_primitive.attributes, mesh_primitive.attribute_count, "POSITION" );
-            glTF::Accessor& position_buffer_accessor = gltf_scene.accessors[ position_accessor_index ];
-            glTF::BufferView& position_buffer_view = gltf_scene.buffer_views[ position_buffer_accessor.buffer_view ];
-            i32 position_data_offset = glTF::get_data_offset( position_buffer_accessor.byte_offset, position_buffer_view.byte_offset );
-            f32* vertices = ( f32* )((u8*)buffers_data[ position_buffer_view.buffer ] + position_data_offset);
-
-            // Calculate bounding sphere center
-            vec3s position_min{ position_buffer_accessor.min[ 0 ], position_buffer_accessor.min[ 1 ], position_buffer_accessor.min[ 2 ] };
-            vec3s position_max{ position_buffer_accessor.max[ 0 ], position_buffer_accessor.max[ 1 ], position_buffer_accessor.max[ 2 ] };
-            vec3s bounding_center = glms_vec3_add( position_min, position_max );
-            bounding_center = glms_vec3_divs( bounding_center, 2.0f );
-
-            // Calculate bounding sphere radius
-            f32 radius = raptor::max( glms_vec3_distance( position_max, bounding_center ), glms_vec3_distance( position_min, bounding_center ) );
-            mesh.bounding_sphere = { bounding_center.x, bounding_center.y, bounding_center.z, radius };
-
-            // Vertex normals
-            const i32 normal_accessor_index = gltf_get_attribute_accessor_index( mesh_primitive.attributes, mesh_primitive.attribute_count, "NORMAL" );
-            f32* normals = nullptr;
-            if ( normal_accessor_index != -1 ) {
-                glTF::Accessor& normal_buffer_accessor = gltf_scene.accessors[ normal_accessor_index ];
-                glTF::BufferView& normal_buffer_view = gltf_scene.buffer_views[ normal_buffer_accessor.buffer_view ];
-                i32 normal_data_offset = glTF::get_data_offset( normal_buffer_accessor.byte_offset, normal_buffer_view.byte_offset );
-                normals = ( f32* )((u8*)buffers_data[ normal_buffer_view.buffer ] + normal_data_offset);
-            }
-
-            // Vertex texture coords
-            const i32 tex_coord_accessor_index = gltf_get_attribute_accessor_index( mesh_primitive.attributes, mesh_primitive.attribute_count, "TEXCOORD_0" );
-            f32* tex_coords = nullptr;
-            if ( tex_coord_accessor_index != -1 ) {
-                glTF::Accessor& tex_coord_buffer_accessor = gltf_scene.accessors[ tex_coord_accessor_index ];
-                glTF::BufferView& tex_coord_buffer_view = gltf_scene.buffer_views[ tex_coord_buffer_accessor.buffer_view ];
-                i32 tex_coord_data_offset = glTF::get_data_offset( tex_coord_buffer_accessor.byte_offset, tex_coord_buffer_view.byte_offset );
-                tex_coords = ( f32* )((u8*)buffers_data[ tex_coord_buffer_view.buffer ] + tex_coord_data_offset);
-            }
-
-            // Vertex tangents
-            const i32 tangent_accessor_index = gltf_get_attribute_accessor_index( mesh_primitive.attributes, mesh_primitive.attribute_count, "TANGENT" );
-            f32* tangents = nullptr;
-            if ( tangent_accessor_index != -1 ) {
-                glTF::Accessor& tangent_buffer_accessor = gltf_scene.accessors[ tangent_accessor_index ];
-                glTF::BufferView& tangent_buffer_view = gltf_scene.buffer_views[ tangent_buffer_accessor.buffer_view ];
-                i32 tangent_data_offset = glTF::get_data_offset( tangent_buffer_accessor.byte_offset, tangent_buffer_view.byte_offset );
-                tangents = ( f32* )((u8*)buffers_data[ tangent_buffer_view.buffer ] + tangent_data_offset);
-            }
-
-            // Cache vertex buffers
-            get_mesh_vertex_buffer( gltf_scene, buffers_offset, position_accessor_index, 0, mesh.position_buffer, mesh.position_offset, mesh.pbr_material.flags );
-            get_mesh_vertex_buffer( gltf_scene, buffers_offset, tangent_accessor_index, DrawFlags_HasTangents, mesh.tangent_buffer, mesh.tangent_offset, mesh.pbr_material.flags );
-            get_mesh_vertex_buffer( gltf_scene, buffers_offset, normal_accessor_index, DrawFlags_HasNormals, mesh.normal_buffer, mesh.normal_offset, mesh.pbr_material.flags );
-            get_mesh_vertex_buffer( gltf_scene, buffers_offset, tex_coord_accessor_index, DrawFlags_HasTexCoords, mesh.texcoord_buffer, mesh.texcoord_offset, mesh.pbr_material.flags );
-
-            const i32 joints_accessor_index = gltf_get_attribute_accessor_index( mesh_primitive.attributes, mesh_primitive.attribute_count, "JOINTS_0" );
-            const i32 weights_accessor_index = gltf_get_attribute_accessor_index( mesh_primitive.attributes, mesh_primitive.attribute_count, "WEIGHTS_0" );
-
-            get_mesh_vertex_buffer( gltf_scene, buffers_offset, joints_accessor_index, DrawFlags_HasJoints, mesh.joints_buffer, mesh.joints_offset, mesh.pbr_material.flags );
-            get_mesh_vertex_buffer( gltf_scene, buffers_offset, weights_accessor_index, DrawFlags_HasWeights, mesh.weights_buffer, mesh.weights_offset, mesh.pbr_material.flags );
-
+    const u32 meshlet_offset = meshlets.size;
+    const u32 meshlet_data_offset = meshlets_data.size;
+    const u32 meshlet_vertex_offset = meshlets_vertex_positions.size;
 
-            // Index buffer
-            glTF::Accessor& indices_accessor = gltf_scene.accessors[ mesh_primitive.indices ];
-            glTF::BufferView& indices_buffer_view = gltf_scene.buffer_views[ indices_accessor.buffer_view ];
-            u8* buffer_data = ( u8* )buffers_data[ indices_buffer_view.buffer ];
-            i32 index_data_offset = glTF::get_data_offset( indices_accessor.byte_offset, indices_buffer_view.byte_offset );
-            u16* indices = ( u16* )(buffer_data + index_data_offset);
-
-            // Read pbr material data if present
-            if ( mesh_primitive.material != glTF::INVALID_INT_VALUE ) {
-                glTF::Material& material = gltf_scene.materials[ mesh_primitive.material ];
-                fill_pbr_material( gltf_scene, *renderer, material, mesh.pbr_material );
-            }
-
-            BufferResource& indices_buffer_gpu = buffers[ indices_buffer_view.buffer + buffers_offset ];
-            mesh.index_buffer = indices_buffer_gpu.handle;
-            mesh.index_offset = glTF::get_data_offset( indices_accessor.byte_offset, indices_buffer_view.byte_offset );
-            mesh.primitive_count = indices_accessor.count;
-
-            mesh.gpu_mesh_index = meshes.size;
-
-            const sizet max_meshlets = meshopt_buildMeshletsBound( indices_accessor.count, max_vertices, max_triangles );
-
-            Array<meshopt_Meshlet> local_meshlets;
-            local_meshlets.init( temp_allocator, max_meshlets, max_meshlets );
-
-            Array<u32> meshlet_vertex_indices;
-            meshlet_vertex_indices.init( temp_allocator, max_meshlets * max_vertices, max_meshlets* max_vertices );
-
-            Array<u8> meshlet_triangles;
-            meshlet_triangles.init( temp_allocator, max_meshlets * max_triangles * 3, max_meshlets * max_triangles * 3 );
-
-            sizet meshlet_count = meshopt_buildMeshlets( local_meshlets.data, meshlet_vertex_indices.data, meshlet_triangles.data, indices,
-                                                         indices_accessor.count, vertices, position_buffer_accessor.count, sizeof( vec3s ),
-                                                         max_vertices, max_triangles, cone_weight );
-
-            u32 meshlet_vertex_offset = meshlets_vertex_positions.size;
-            for ( u32 v = 0; v < position_buffer_accessor.count; ++v ) {
-                GpuMeshletVertexPosition meshlet_vertex_pos{ };
+    for ( u32 mi = 0; mi < scene_blob.gltf_mesh_offsets.size; ++mi ) {
+        gltf_mesh_to_mesh_offset.push( mesh_offset + scene_blob.gltf_mesh_offsets[ mi ] );
+    }
 
-                f32 x = vertices[ v * 3 + 0 ];
-                f32 y = vertices[ v * 3 + 1 ];
-                f32 z = vertices[ v * 3 + 2 ];
+    for ( u32 mi = 0; mi < scene_blob.meshes.size; ++mi ) {
+        SceneBlobMesh& blob_mesh = scene_blob.meshes[ mi ];
 
-                if ( x < mesh_aabb[ 0 ].x )
-                {
-                    mesh_aabb[ 0 ].x = x;
-                }
-                if ( y < mesh_aabb[ 0 ].y )
-                {
-                    mesh_aabb[ 0 ].y = y;
-                }
-                if ( z < mesh_aabb[ 0 ].z )
-                {
-                    mesh_aabb[ 0 ].z = z;
-                }
+        // Add meshes
+        Mesh mesh{};
+        // Load material defaults: flags is modified after this point.
+        mesh.pbr_material = {};
 
-                if ( x > mesh_aabb[ 1 ].x )
-                {
-                    mesh_aabb[ 1 ].x = x;
-                }
-                if ( y > mesh_aabb[ 1 ].y )
-                {
-                    mesh_aabb[ 1 ].y = y;
-                }
-                if ( z > mesh_aabb[ 1 ].z )
-                {
-                    mesh_aabb[ 1 ].z = z;
-                }
+        memcpy( mesh.bounding_sphere.raw, blob_mesh.bounding_sphere, sizeof( vec4s ) );
 
-                meshlet_vertex_pos.position[ 0 ] = x;
-                meshlet_vertex_pos.position[ 1 ] = y;
-                meshlet_vertex_pos.position[ 2 ] = z;
+        // Cache vertex buffers
+        get_mesh_vertex_buffer( blob_mesh.position, buffers_offset, 0, mesh.position_buffer, mesh.position_offset, mesh.pbr_material.flags );
+        get_mesh_vertex_buffer( blob_mesh.tangent, buffers_offset, DrawFlags_HasTangents, mesh.tangent_buffer, mesh.tangent_offset, mesh.pbr_material.flags );
+        get_mesh_vertex_buffer( blob_mesh.normal, buffers_offset, DrawFlags_HasNormals, mesh.normal_buffer, mesh.normal_offset, mesh.pbr_material.flags );
+        get_mesh_vertex_buffer( blob_mesh.texcoord, buffers_offset, DrawFlags_HasTexCoords, mesh.texcoord_buffer, mesh.texcoord_offset, mesh.pbr_material.flags );
+        get_mesh_vertex_buffer( blob_mesh.joints, buffers_offset, DrawFlags_HasJoints, mesh.joints_buffer, mesh.joints_offset, mesh.pbr_material.flags );
+        get_mesh_vertex_buffer( blob_mesh.weights, buffers_offset, DrawFlags_HasWeights, mesh.weights_buffer, mesh.weights_offset, mesh.pbr_material.flags );
 
-                meshlets_vertex_positions.push( meshlet_vertex_pos );
+        // Read pbr material data if present
+        if ( blob_mesh.material != -1 ) {
+            fill_pbr_material( scene_blob, *renderer, scene_blob.materials[ blob_mesh.material ], mesh.pbr_material );
+        }
 
-                GpuMeshletVertexData meshlet_vertex_data{ };
+        BufferResource& indices_buffer_gpu = buffers[ blob_mesh.indices.buffer + buffers_offset ];
+        mesh.index_buffer = indices_buffer_gpu.handle;
+        mesh.index_offset = blob_mesh.indices.byte_offset;
+        mesh.primitive_count = blob_mesh.indices.count;
 
-                if ( normals != nullptr ) {
-                    meshlet_vertex_data.normal[ 0 ] = ( normals[ v * 3 + 0 ] + 1.0f ) * 127.0f;
-                    meshlet_vertex_data.normal[ 1 ] = ( normals[ v * 3 + 1 ] + 1.0f ) * 127.0f;
-                    meshlet_vertex_data.normal[ 2 ] = ( normals[ v * 3 + 2 ] + 1.0f ) * 127.0f;
-                }
+        mesh.gpu_mesh_index = meshes.size;
 
-                if ( tangents != nullptr ) {
-                    meshlet_vertex_data.tangent[ 0 ] = ( tangents[ v * 3 + 0 ] + 1.0f ) * 127.0f;
-                    meshlet_vertex_data.tangent[ 1 ] = ( tangents[ v * 3 + 1 ] + 1.0f ) * 127.0f;
-                    meshlet_vertex_data.tangent[ 2 ] = ( tangents[ v * 3 + 2 ] + 1.0f ) * 127.0f;
-                    meshlet_vertex_data.tangent[ 3 ] = ( tangents[ v * 3 + 3 ] + 1.0f ) * 127.0f;
-                }
+        mesh.meshlet_offset = meshlet_offset + blob_mesh.meshlet_offset;
+        mesh.meshlet_count = blob_mesh.meshlet_count;
+        mesh.meshlet_index_count = blob_mesh.meshlet_index_count;
 
-                meshlet_vertex_data.uv_coords[ 0 ] = meshopt_quantizeHalf( tex_coords[ v * 2 + 0 ] );
-                meshlet_vertex_data.uv_coords[ 1 ] = meshopt_quantizeHalf( tex_coords[ v * 2 + 1 ] );
+        meshes.push( mesh );
+    }
 
-                meshlets_vertex_data.push( meshlet_vertex_data );
+    // Meshlet arrays are copied as they are, indices only need patching after another scene.
+    meshlets.set_size( meshlet_offset + scene_blob.meshlets.size );
+    memory_copy( meshlets.data + meshlet_offset, scene_blob.meshlets.get(), sizeof( GpuMeshlet ) * scene_blob.meshlets.size );
+    meshlets_data.set_size( meshlet_data_offset + scene_blob.meshlets_data.size );
+    memory_copy( meshlets_data.data + meshlet_data_offset, scene_blob.meshlets_data.get(), sizeof( u32 ) * scene_blob.meshlets_data.size );
+    meshlets_vertex_positions.set_size( meshlet_vertex_offset + scene_blob.meshlets_vertex_positions.size );
+    memory_copy( meshlets_vertex_positions.data + meshlet_vertex_offset, scene_blob.meshlets_vertex_positions.get(), sizeof( GpuMeshletVertexPosition ) * scene_blob.meshlets_vertex_positions.size );
+    meshlets_vertex_data.set_size( meshlet_vertex_offset + scene_blob.meshlets_vertex_data.size );
+    memory_copy( meshlets_vertex_data.data + meshlet_vertex_offset, scene_blob.meshlets_vertex_data.get(), sizeof( GpuMeshletVertexData ) * scene_blob.meshlets_vertex_data.size );
+
+    if ( mesh_offset || meshlet_data_offset || meshlet_vertex_offset ) {
+        for ( u32 m = meshlet_offset; m < meshlets.size; ++m ) {
+            GpuMeshlet& meshlet = meshlets[ m ];
+            // Skip alignment padding
+            if ( meshlet.vertex_count == 0 && meshlet.triangle_count == 0 ) {
+                continue;
             }
 
-            // Cache meshlet offset
-            mesh.meshlet_offset = meshlets.size;
-            mesh.meshlet_count = meshlet_count;
-            mesh.meshlet_index_count = 0;
-
-            // Append meshlet data
-            for ( u32 m = 0; m < meshlet_count; ++m ) {
-                meshopt_Meshlet& local_meshlet = local_meshlets[ m ];
+            meshlet.data_offset += meshlet_data_offset;
+            meshlet.mesh_index += mesh_offset;
 
-                meshopt_Bounds meshlet_bounds = meshopt_computeMeshletBounds(meshlet_vertex_indices.data + local_meshlet.vertex_offset,
-                                                                             meshlet_triangles.data + local_meshlet.triangle_offset, local_meshlet.triangle_count,
-                                                                             vertices, position_buffer_accessor.count, sizeof( vec3s ));
-
-                GpuMeshlet meshlet{};
-                meshlet.data_offset = meshlets_data.size;
-                meshlet.vertex_count = local_meshlet.vertex_count;
-                meshlet.triangle_count = local_meshlet.triangle_count;
-
-                meshlet.center = vec3s{ meshlet_bounds.center[ 0 ], meshlet_bounds.center[ 1 ], meshlet_bounds.center[ 2 ] };
-                meshlet.radius = meshlet_bounds.radius;
-
-                meshlet.cone_axis[ 0 ] = meshlet_bounds.cone_axis_s8[ 0 ];
-                meshlet.cone_axis[ 1 ] = meshlet_bounds.cone_axis_s8[ 1 ];
-                meshlet.cone_axis[ 2 ] = meshlet_bounds.cone_axis_s8[ 2 ];
-
-                meshlet.cone_cutoff = meshlet_bounds.cone_cutoff_s8;
-                meshlet.mesh_index = meshes.size;
-
-                // Resize data array
-                const u32 index_group_count = ( local_meshlet.triangle_count * 3 + 3 ) / 4;
-                meshlets_data.set_capacity( meshlets_data.size + local_meshlet.vertex_count + index_group_count );
-
-                for ( u32 i = 0; i < meshlet.vertex_count; ++i ) {
-                    const u32 vertex_index = meshlet_vertex_offset + meshlet_vertex_indices[ local_meshlet.vertex_offset + i ];
-                    meshlets_data.push( vertex_index );
-                }
-
-                // Store indices as uint32
-                // NOTE(marco): we write 4 indices at at time, it will come in handy in the mesh shader
-                const u32* index_groups = reinterpret_cast< const u32* >( meshlet_triangles.data + local_meshlet.triangle_offset );
-                for ( u32 i = 0; i < index_group_count; ++i ) {
-                    const u32 index_group = index_groups[ i ];
-                    meshlets_data.push( index_group );
-                }
-
-                // Writing in group of fours can be problematic, if there are non multiple of 3
-                // indices a triangle can be shared between meshlets.
-                // We need to add some padding for that.
-                // This is visible only when emulating meshlets, so probably there are controls
-                // at driver level that avoid this problems when using mesh shaders.
-                // Check for the last 3 indices: if last one are two are zero, then add one or two
-                // groups of empty triangles.
-                u32 last_index_group = index_groups[ index_group_count - 1 ];
-                u32 last_index = ( last_index_group >> 8 ) & 0xff;
-                u32 second_last_index = ( last_index_group >> 16 ) & 0xff;
-                u32 third_last_index = ( last_index_group >> 24 ) & 0xff;
-                if ( last_index != 0 && third_last_index == 0 ) {
-
-                    if ( second_last_index != 0 ) {
-                        // Add a single index group of zeroes
-                        meshlets_data.push( 0 );
-                        meshlet.triangle_count++;
-                    }
-
-                    meshlet.triangle_count++;
-                    // Add another index group of zeroes
-                    meshlets_data.push( 0 );
-                }
-
-                mesh.meshlet_index_count += meshlet.triangle_count * 3;
-
-                meshlets.push( meshlet );
-
-                meshlets_index_count += index_group_count;
+            for ( u32 i = 0; i < meshlet.vertex_count; ++i ) {
+                meshlets_data[ meshlet.data_offset + i ] += meshlet_vertex_offset;
             }
-
-            // Add mesh with all data
-            meshes.push( mesh );
-
-            while ( meshlets.size % 32 )
-                meshlets.push( GpuMeshlet() );
-
-            temp_allocator->free_marker( temp_marker );
-
-            mesh_index++;
         }
     }
 
+    meshlets_index_count += scene_blob.meshlets_index_count;
+
+    mesh_aabb[ 0 ] = vec3s{ scene_blob.aabb_min[ 0 ], scene_blob.aabb_min[ 1 ], scene_blob.aabb_min[ 2 ] };
+    mesh_aabb[ 1 ] = vec3s{ scene_blob.aabb_max[ 0 ], scene_blob.aabb_max[ 1 ], scene_blob.aabb_max[ 2 ] };
+
     // Create material
-    const u64 hashed_name = hash_calculate( "main" );
+    const u64 hashed_name = rhash( "main" );
     GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hashed_name );
 
     MaterialCreation material_creation;
@@ -605,128 +347,46 @@ void glTFScene::add_mesh( cstring filename, cstring path, StackAllocator* temp_a
 
     Material* pbr_material = renderer->create_material( material_creation );
 
-    glTF::Scene& root_gltf_scene = gltf_scene.scenes[ gltf_scene.scene ];
-
-    //
-    Array<i32> nodes_to_visit;
-    nodes_to_visit.init( temp_allocator, 4 );
-
-    // Calculate total node count: add first the root nodes.
-    u32 total_node_count = root_gltf_scene.nodes_count;
-
-    // Add initial nodes
-    for ( u32 node_index = 0; node_index < root_gltf_scene.nodes_count; ++node_index ) {
-        const i32 node = root_gltf_scene.nodes[ node_index ];
-        nodes_to_visit.push( node );
-    }
-    // Visit nodes
-    while ( nodes_to_visit.size ) {
-        i32 node_index = nodes_to_visit.front();
-        nodes_to_visit.delete_swap( 0 );
-
-        glTF::Node& node = gltf_scene.nodes[ node_index ];
-        for ( u32 ch = 0; ch < node.children_count; ++ch ) {
-            const i32 children_index = node.children[ ch ];
-            nodes_to_visit.push( children_index );
-        }
-
-        // Add only children nodes to the count, as the current node is
-        // already calculated when inserting it.
-        total_node_count += node.children_count;
-    }
-
+    // Populate scene graph, hierarchy and visit order are already resolved.
     u32 node_offset = scene_graph->node_count();
-    u32 new_node_count = node_offset + total_node_count;
+    u32 new_node_count = node_offset + scene_blob.scene_node_count;
     scene_graph->resize( new_node_count );
-    scene_graph->init_new_nodes( node_offset, total_node_count );
-
-    // Populate scene graph: visit again
-    nodes_to_visit.clear();
-    // Add initial nodes
-    for ( u32 node_index = 0; node_index < root_gltf_scene.nodes_count; ++node_index ) {
-        const i32 node = root_gltf_scene.nodes[ node_index ];
-        nodes_to_visit.push( node );
-    }
+    scene_graph->init_new_nodes( node_offset, scene_blob.scene_node_count );
 
     u32 total_meshlets = 0;
 
-    while ( nodes_to_visit.size ) {
-        i32 gltf_node = nodes_to_visit.front();
-        i32 node_index = gltf_node + node_offset;
-        nodes_to_visit.delete_swap( 0 );
+    for ( u32 v = 0; v < scene_blob.visit_order.size; ++v ) {
+        const i32 gltf_node = scene_blob.visit_order[ v ];
+        const u32 node_index = gltf_node + node_offset;
 
-        glTF::Node& node = gltf_scene.nodes[ gltf_node ];
+        SceneBlobNode& node = scene_blob.nodes[ gltf_node ];
 
-        // Compute local transform: read either raw matrix or individual Scale/Rotation/Translation components
-        if ( node.matrix_count ) {
-            // CGLM and glTF have the same matrix layout, just memcopy it
-            memcpy( &scene_graph->local_matrices[ node_index ], node.matrix, sizeof( mat4s ) );
-            scene_graph->updated_nodes.set_bit( node_index );
-        }
-        else {
-            // Handle individual transform components: SRT (scale, rotation, translation)
-            vec3s node_scale{ 1.0f, 1.0f, 1.0f };
-            if ( node.scale_count ) {
-                RASSERT( node.scale_count == 3 );
-                node_scale = vec3s{ node.scale[ 0 ], node.scale[ 1 ], node.scale[ 2 ] };
-            }
+        mat4s local_matrix;
+        memcpy( local_matrix.raw, node.local_matrix, sizeof( mat4s ) );
+        scene_graph->set_local_matrix( node_index, local_matrix );
 
-            vec3s node_translation{ 0.f, 0.f, 0.f };
-            if ( node.translation_count ) {
-                RASSERT( node.translation_count == 3 );
-                node_translation = vec3s{ node.translation[ 0 ], node.translation[ 1 ], node.translation[ 2 ] };
-            }
-
-            // Rotation is written as a plain quaternion
-            versors node_rotation = glms_quat_identity();
-            if ( node.rotation_count ) {
-                RASSERT( node.rotation_count == 4 );
-                node_rotation = glms_quat_init( node.rotation[ 0 ], node.rotation[ 1 ], node.rotation[ 2 ], node.rotation[ 3 ] );
-            }
-
-            Transform transform;
-            transform.translation = node_translation;
-            transform.scale = node_scale;
-            transform.rotation = node_rotation;
-
-            // Final SRT composition
-            const mat4s local_matrix = transform.calculate_matrix();
-            scene_graph->set_local_matrix( node_index, local_matrix );
-        }
-
-        // Handle parent-relationship
-        if ( node.children_count ) {
-            const Hierarchy& node_hierarchy = scene_graph->nodes_hierarchy[ node_index ];
-
-            for ( u32 ch = 0; ch < node.children_count; ++ch) {
-                const i32 children_index = node.children[ ch ];
-                i32 global_child_index = children_index + node_offset;
-                Hierarchy& children_hierarchy = scene_graph->nodes_hierarchy[ global_child_index ];
-                scene_graph->set_hierarchy( global_child_index, node_index, node_hierarchy.level + 1 );
-
-                nodes_to_visit.push( children_index );
-            }
+        if ( node.parent != -1 ) {
+            scene_graph->set_hierarchy( node_index, node.parent + node_offset, node.level );
         }
 
         // Cache node name
-        scene_graph->set_debug_data( node_index, node.name.data );
+        scene_graph->set_debug_data( node_index, node.name.c_str() );
 
-        if ( node.mesh == glTF::INVALID_INT_VALUE ) {
+        if ( node.mesh == -1 ) {
             continue;
         }
 
         // Start mesh part
-        glTF::Mesh& gltf_mesh = gltf_scene.meshes[ node.mesh ];
-        u32 gltf_mesh_offset = gltf_mesh_to_mesh_offset[ node.mesh ];
+        const u32 gltf_mesh_offset = gltf_mesh_to_mesh_offset[ gltf_mesh_offset_base + node.mesh ];
+        const u32 next_mesh_offset = ( u32 )node.mesh + 1 < scene_blob.gltf_mesh_offsets.size ? scene_blob.gltf_mesh_offsets[ node.mesh + 1 ] : scene_blob.meshes.size;
+        const u32 primitives_count = next_mesh_offset - scene_blob.gltf_mesh_offsets[ node.mesh ];
 
         // Gltf primitives are conceptually submeshes.
-        for ( u32 primitive_index = 0; primitive_index < gltf_mesh.primitives_count; ++primitive_index ) {
+        for ( u32 primitive_index = 0; primitive_index < primitives_count; ++primitive_index ) {
             MeshInstance mesh_instance{ };
             // Assign scene graph node index
             mesh_instance.scene_graph_node_index = node_index;
 
-            glTF::MeshPrimitive& mesh_primitive = gltf_mesh.primitives[ primitive_index ];
-
             // Cache parent mesh and assign material
             u32 mesh_primitive_index = gltf_mesh_offset + primitive_index;
             mesh_instance.mesh = &meshes[ mesh_primitive_index ];
@@ -736,10 +396,10 @@ void glTFScene::add_mesh( cstring filename, cstring path, StackAllocator* temp_a
 
             // Found a skin index, cache it
             mesh_instance.mesh->skin_index = i32_max;
-            if ( node.skin != glTF::INVALID_INT_VALUE ) {
-                RASSERT( node.skin < skins.size );
+            if ( node.skin != -1 ) {
+                RASSERT( node.skin < ( i32 )scene_blob.skins.size );
 
-                mesh_instance.mesh->skin_index = node.skin;
+                mesh_instance.mesh->skin_index = skins.size + node.skin;
             }
 
             total_meshlets += mesh_instance.mesh->meshlet_count;
@@ -802,150 +462,180 @@ void glTFScene::add_mesh( cstring filename, cstring path, StackAllocator* temp_a
     Buffer* gpu_geometry_transform_buffer = renderer->gpu->access_buffer( geometry_transform_buffer );
     memcpy( gpu_geometry_transform_buffer->mapped_data, geometry_transform.data, geometry_transform_buffer_size );
 
-    i64 end_building_meshlets = time_now();
 
-    // Before unloading buffer data, load animations
-    for ( u32 animation_index = 0; animation_index < gltf_scene.animations_count; ++animation_index ) {
-        glTF::Animation& gltf_animation = gltf_scene.animations[ animation_index ];
+    i64 end_creating_meshes = time_now();
+
+    // Load animations, keyframes are read from the cooked buffers.
+    const u32 animations_offset = animations.size;
+    for ( u32 animation_index = 0; animation_index < scene_blob.animations.size; ++animation_index ) {
+        SceneBlobAnimation& blob_animation = scene_blob.animations[ animation_index ];
 
         Animation& animation = animations.push_use();
         animation.time_start = FLT_MAX;
         animation.time_end = -FLT_MAX;
-        animation.channels.init( resident_allocator, gltf_animation.channels_count, gltf_animation.channels_count );
-        for ( u32 channel_index = 0; channel_index < gltf_animation.channels_count; ++channel_index ) {
+        animation.channels.init( resident_allocator, blob_animation.channels.size, blob_animation.channels.size );
+        memory_copy( animation.channels.data, blob_animation.channels.get(), sizeof( AnimationChannel ) * blob_animation.channels.size );
 
-            glTF::AnimationChannel& gltf_channel = gltf_animation.channels[ channel_index ];
-            AnimationChannel& channel = animation.channels[ channel_index ];
+        for ( u32 sampler_index = 0; sampler_index < blob_animation.samplers.size; ++sampler_index ) {
+            const SceneBlobAccessor& input = blob_animation.samplers[ sampler_index ].input;
+            const f32* key_frames = ( const f32* )( scene_blob.buffers[ input.buffer ].data.get() + input.byte_offset );
 
-            channel.sampler = gltf_channel.sampler;
-            channel.target_node = gltf_channel.target_node;
-            channel.target_type = (raptor::AnimationChannel::TargetType)gltf_channel.target_type;
+            for ( u32 i = 0; i < input.count; ++i ) {
+                animation.time_start = glm_min( animation.time_start, key_frames[ i ] );
+                animation.time_end = glm_max( animation.time_end, key_frames[ i ] );
+            }
         }
 
-        animation.samplers.init( resident_allocator, gltf_animation.samplers_count, gltf_animation.samplers_count );
-        for ( u32 sampler_index = 0; sampler_index < gltf_animation.samplers_count; ++sampler_index ) {
-
-            glTF::AnimationSampler& gltf_sampler = gltf_animation.samplers[ sampler_index ];
-            AnimationSampler& sampler = animation.samplers[ sampler_index ];
-
-            sampler.interpolation_type = ( raptor::AnimationSampler::Interpolation )gltf_sampler.interpolation;
-
-            i32 key_frames_count = 0;
-
-            // Copy keyframe data
-            {
-                glTF::Accessor& buffer_accessor = gltf_scene.accessors[ gltf_sampler.input_keyframe_buffer_index ];
-                glTF::BufferView& buffer_view = gltf_scene.buffer_views[ buffer_accessor.buffer_view ];
-
-                i32 byte_offset = glTF::get_data_offset( buffer_accessor.byte_offset, buffer_view.byte_offset );
-
-                u8* buffer_data = ( u8* )buffers_data[ buffer_view.buffer ] + byte_offset;
-                sampler.key_frames.init( resident_allocator, buffer_accessor.count, buffer_accessor.count );
+        // Channels with the same key frames and interpolation share a sampler, up to 4 of them.
+        animation.samplers.init( resident_allocator, blob_animation.channels.size );
+        for ( u32 channel_index = 0; channel_index < animation.channels.size; ++channel_index ) {
+            AnimationChannel& channel = animation.channels[ channel_index ];
+            // Morph target weights are not supported.
+            if ( channel.target_type >= AnimationChannel::Weights ) {
+                continue;
+            }
 
-                const f32* key_frames = ( const f32* )buffer_data;
-                for ( u32 i = 0; i < buffer_accessor.count; ++i ) {
-                    sampler.key_frames[ i ] = key_frames[ i ];
+            const SceneBlobAnimationSampler& blob_sampler = blob_animation.samplers[ channel.sampler ];
 
-                    animation.time_start = glm_min( animation.time_start, key_frames[ i ] );
-                    animation.time_end = glm_max( animation.time_end, key_frames[ i ] );
+            u32 sampler_index = 0;
+            for ( ; sampler_index < animation.samplers.size; ++sampler_index ) {
+                const AnimationSampler& sampler = animation.samplers[ sampler_index ];
+                const SceneBlobAnimationSampler& lane_sampler = blob_animation.samplers[ animation.channels[ sampler.channels[ 0 ] ].sampler ];
+                if ( sampler.lane_count < k_animation_sampler_lanes && sampler.interpolation_type == ( AnimationSampler::Interpolation )blob_sampler.interpolation &&
+                     lane_sampler.input.buffer == blob_sampler.input.buffer && lane_sampler.input.byte_offset == blob_sampler.input.byte_offset &&
+                     lane_sampler.input.count == blob_sampler.input.count ) {
+                    break;
                 }
-
-                key_frames_count = buffer_accessor.count;
             }
-            // Copy animation data
-            {
-                glTF::Accessor& buffer_accessor = gltf_scene.accessors[ gltf_sampler.output_keyframe_buffer_index ];
-                glTF::BufferView& buffer_view = gltf_scene.buffer_views[ buffer_accessor.buffer_view ];
-
-                i32 byte_offset = glTF::get_data_offset( buffer_accessor.byte_offset, buffer_view.byte_offset );
 
-                RASSERT( buffer_accessor.count == key_frames_count );
+            if ( sampler_index == animation.samplers.size ) {
+                AnimationSampler& sampler = animation.samplers.push_use();
+                sampler.interpolation_type = ( AnimationSampler::Interpolation )blob_sampler.interpolation;
+                sampler.lane_count = 0;
+            }
 
-                u8* buffer_data = ( u8* )buffers_data[ buffer_view.buffer ] + byte_offset;
+            AnimationSampler& sampler = animation.samplers[ sampler_index ];
+            sampler.channels[ sampler.lane_count++ ] = channel_index;
+        }
 
-                sampler.data = (vec4s*)rallocaa( sizeof(vec4s) * buffer_accessor.count, resident_allocator, 16 );
+        for ( u32 sampler_index = 0; sampler_index < animation.samplers.size; ++sampler_index ) {
+            AnimationSampler& sampler = animation.samplers[ sampler_index ];
+            const bool cubic_spline = sampler.interpolation_type == AnimationSampler::CubicSpline;
 
-                switch ( buffer_accessor.type ) {
-                    case glTF::Accessor::Vec3:
-                    {
-                        const vec3s* animation_data = ( const vec3s* )buffer_data;
-                        for ( u32 i = 0; i < buffer_accessor.count; ++i ) {
-                            sampler.data[ i ] = glms_vec4( animation_data[ i ], 0.f );
-                        }
-                        break;
-                    }
-                    case glTF::Accessor::Vec4:
-                    {
-                        const f32* animation_data = ( const f32* )buffer_data;
-                        for ( u32 i = 0; i < buffer_accessor.count; ++i ) {
-                            sampler.data[ i ] = vec4s{ animation_data[ i * 4 ], animation_data[ i * 4 + 1 ], animation_data[ i * 4 + 2 ], animation_data[ i * 4 + 3 ] };
-                        }
-                        break;
-                    }
-                    default:
-                    {
-                        RASSERT( false );
-                        break;
+            // Copy keyframe data
+            const SceneBlobAccessor& input = blob_animation.samplers[ animation.channels[ sampler.channels[ 0 ] ].sampler ].input;
+            const f32* key_frames = ( const f32* )( scene_blob.buffers[ input.buffer ].data.get() + input.byte_offset );
+            const u32 key_count = input.count;
+
+            sampler.key_frames.init( resident_allocator, key_count, key_count );
+            memory_copy( sampler.key_frames.data, key_frames, sizeof( f32 ) * key_count );
+
+            // Tangents follow the values in the same allocation, unused lanes and components are zero.
+            const sizet data_size = sizeof( vec4s ) * key_count * 4 * ( cubic_spline ? 3 : 1 );
+            sampler.data = ( vec4s* )rallocaa( data_size, resident_allocator, 16 );
+            sampler.in_tangents = cubic_spline ? sampler.data + key_count * 4 : nullptr;
+            sampler.out_tangents = cubic_spline ? sampler.data + key_count * 8 : nullptr;
+            memset( sampler.data, 0, data_size );
+
+            // Copy animation data of each lane
+            for ( u32 lane = 0; lane < sampler.lane_count; ++lane ) {
+                AnimationChannel& channel = animation.channels[ sampler.channels[ lane ] ];
+                const SceneBlobAccessor& output = blob_animation.samplers[ channel.sampler ].output;
+                // Cubic spline outputs are in tangent, value and out tangent for each key frame.
+                RASSERT( output.count == ( cubic_spline ? key_count * 3 : key_count ) );
+                RASSERT( output.type == glTF::Accessor::Vec3 || output.type == glTF::Accessor::Vec4 );
+
+                const f32* animation_data = ( const f32* )( scene_blob.buffers[ output.buffer ].data.get() + output.byte_offset );
+                const u32 component_count = output.type == glTF::Accessor::Vec4 ? 4 : 3;
+
+                // Split to separate arrays: values are element 1 of each cubic spline triplet.
+                const u32 stride = cubic_spline ? 3 : 1;
+                vec4s* destinations[ 3 ] = { sampler.in_tangents, sampler.data, sampler.out_tangents };
+
+                for ( u32 i = 0; i < output.count; ++i ) {
+                    vec4s* destination = cubic_spline ? destinations[ i % 3 ] : sampler.data;
+                    for ( u32 c = 0; c < component_count; ++c ) {
+                        destination[ ( i / stride ) * 4 + c ].raw[ lane ] = animation_data[ i * component_count + c ];
                     }
                 }
+            }
 
+            // Channels now index the sampler with their lane.
+            for ( u32 lane = 0; lane < sampler.lane_count; ++lane ) {
+                animation.channels[ sampler.channels[ lane ] ].sampler = sampler_index;
             }
         }
+    }
 
-        //rprint( "Done loading animation %f %f\n", animation.time_start, animation.time_end );
+    // Animations of this file drive a pose of its nodes: the first one plays, the others are
+    // added with no weight and can be blended from the debug UI.
+    const u32 animation_pose = animation_system.add_pose( node_offset, scene_blob.nodes.size, scene_graph->local_matrices.data + node_offset, scene_blob.scene_node_count );
+    for ( u32 animation_index = animations_offset; animation_index < animations.size; ++animation_index ) {
+        animation_system.poses[ animation_pose ].add_instance( animations[ animation_index ], animation_index,
+                                                               animation_index == animations_offset ? 1.f : 0.f, 1.f );
     }
 
     // Load skins
-    for ( u32 si = 0; si < gltf_scene.skins_count; ++si ) {
-        glTF::Skin& gltf_skin = gltf_scene.skins[ si ];
+    const u32 skins_offset = skins.size;
+    for ( u32 si = 0; si < scene_blob.skins.size; ++si ) {
+        SceneBlobSkin& blob_skin = scene_blob.skins[ si ];
 
         Skin& skin = skins.push_use();
-        skin.skeleton_root_index = gltf_skin.skeleton_root_node_index;
+        skin.skeleton_root_index = blob_skin.skeleton_root_index;
+        skin.animation_pose = animation_pose;
+        skin.mesh_node = -1;
 
         // Copy joints
-        skin.joints.init( resident_allocator, gltf_skin.joints_count, gltf_skin.joints_count );
-        memory_copy( skin.joints.data, gltf_skin.joints, sizeof( i32 ) * gltf_skin.joints_count );
+        skin.joints.init( resident_allocator, blob_skin.joints.size, blob_skin.joints.size );
+        memory_copy( skin.joints.data, blob_skin.joints.get(), sizeof( i32 ) * blob_skin.joints.size );
 
         // Copy inverse bind matrices
-        glTF::Accessor& buffer_accessor = gltf_scene.accessors[ gltf_skin.inverse_bind_matrices_buffer_index ];
-        glTF::BufferView& buffer_view = gltf_scene.buffer_views[ buffer_accessor.buffer_view ];
+        const SceneBlobAccessor& inverse_bind_matrices = blob_skin.inverse_bind_matrices;
+        SceneBlobBuffer& buffer = scene_blob.buffers[ inverse_bind_matrices.buffer ];
 
-        i32 byte_offset = glTF::get_data_offset( buffer_accessor.byte_offset, buffer_view.byte_offset );
+        RASSERT( inverse_bind_matrices.count == skin.joints.size );
+        skin.inverse_bind_matrices = ( mat4s* )rallocaa( sizeof( mat4s ) * inverse_bind_matrices.count, resident_allocator, 16 );
 
-        RASSERT( buffer_accessor.count == skin.joints.size );
-        skin.inverse_bind_matrices = ( mat4s* )rallocaa( sizeof( mat4s ) * buffer_accessor.count, resident_allocator, 16 );
-
-        u8* buffer_data = ( u8* )buffers_data[ buffer_view.buffer ] + byte_offset;
-        memory_copy( skin.inverse_bind_matrices, buffer_data, sizeof( mat4s ) * buffer_accessor.count );
+        u8* buffer_data = buffer.data.get() + inverse_bind_matrices.byte_offset;
+        memory_copy( skin.inverse_bind_matrices, buffer_data, sizeof( mat4s ) * inverse_bind_matrices.count );
 
         // Create matrix ssbo.
         // TODO: transforms use absolute indices, thus we need all nodes.
+        // Initial data is not read past the end of the cooked buffer.
+        const sizet joint_transforms_size = sizeof( mat4s ) * scene_blob.nodes.size;
+        const bool initial_data_fits = inverse_bind_matrices.byte_offset + joint_transforms_size <= buffer.data.size;
+
         BufferCreation bc;
-        bc.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( mat4s ) * gltf_scene.nodes_count )
-                  .set_data( buffer_data ).set_name( "Skin ssbo" );
+        bc.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, ( u32 )joint_transforms_size )
+                  .set_data( initial_data_fits ? buffer_data : nullptr ).set_persistent( true ).set_name( "Skin ssbo" );
 
-        skin.joint_transforms = renderer->gpu->create_buffer( bc );
+        // A frame in flight can still read its palette while the next one is written.
+        for ( u32 i = 0; i < k_max_frames; ++i ) {
+            skin.joint_transforms[ i ] = renderer->gpu->create_buffer( bc );
+        }
     }
 
-    // Deallocate file-read buffer data
-    for ( u32 buffer_index = 0; buffer_index < gltf_scene.buffers_count; ++buffer_index ) {
-        void* buffer = buffers_data[ buffer_index ];
-        resident_allocator->deallocate( buffer );
-    }
-    buffers_data.shutdown();
+    // Skinned draws apply the world matrix of their node, removed from the palettes.
+    for ( u32 v = 0; v < scene_blob.visit_order.size; ++v ) {
+        const i32 gltf_node = scene_blob.visit_order[ v ];
+        SceneBlobNode& node = scene_blob.nodes[ gltf_node ];
 
-    i64 end_creating_buffers = time_now();
+        if ( node.mesh != -1 && node.skin != -1 ) {
+            skins[ skins_offset + node.skin ].mesh_node = gltf_node + node_offset;
+        }
+    }
 
     // This is not needed anymore, free all temp memory after.
-    //resource_name_buffer.shutdown();
     temp_allocator->free_marker( temp_allocator_initial_marker );
 
     i64 end_loading = time_now();
 
-    rprint( "Loaded scene %s in %f seconds.\nStats:\n\tReading GLTF file %f seconds\n\tTextures Creating %f seconds\n\tCreating Samplers %f seconds\n\tReading Buffers Data %f seconds\n\tCreating Buffers %f seconds\n", filename,
-            time_delta_seconds( start_scene_loading, end_loading ), time_delta_seconds( start_scene_loading, end_loading_file ), time_delta_seconds( end_loading_file, end_creating_textures ),
-            time_delta_seconds( end_creating_textures, end_creating_samplers ),
-            time_delta_seconds( end_creating_samplers, end_reading_buffers_data ), time_delta_seconds( end_reading_buffers_data, end_creating_buffers ) );
+    rprint( "Loaded scene %s in %f seconds, %s.\nStats:\n\t%s %f seconds\n\tCreating Textures %f seconds\n\tCreating Samplers %f seconds\n\tCreating Buffers %f seconds\n\tCreating Meshes %f seconds\n\tLoading Animations %f seconds\n", filename,
+            time_delta_seconds( start_scene_loading, end_loading ), blob_mapped ? "mapped blob" : "cooked blob",
+            blob_mapped ? "Mapping Blob" : "Cooking Blob", time_delta_seconds( start_scene_loading, end_loading_file ),
+            time_delta_seconds( end_loading_file, end_creating_textures ), time_delta_seconds( end_creating_textures, end_creating_samplers ),
+            time_delta_seconds( end_creating_samplers, end_creating_buffers ), time_delta_seconds( end_creating_buffers, end_creating_meshes ),
+            time_delta_seconds( end_creating_meshes, end_loading ) );
 }
 
 void glTFScene::shutdown( Renderer* renderer ) {
@@ -964,6 +654,7 @@ void glTFScene::shutdown( Renderer* renderer ) {
         animation.samplers.shutdown();
     }
     animations.shutdown();
+    animation_system.shutdown();
 
     // Unload skins
     for ( u32 si = 0; si < skins.size; ++si ) {
@@ -971,7 +662,9 @@ void glTFScene::shutdown( Renderer* renderer ) {
         skin.joints.shutdown();
         rfree( skin.inverse_bind_matrices, resident_allocator );
 
-        renderer->gpu->destroy_buffer( skin.joint_transforms );
+        for ( u32 i = 0; i < k_max_frames; ++i ) {
+            renderer->gpu->destroy_buffer( skin.joint_transforms[ i ] );
+        }
     }
     skins.shutdown();
 
@@ -987,7 +680,13 @@ void glTFScene::shutdown( Renderer* renderer ) {
         Mesh& mesh = meshes[ mesh_index ];
 
         gpu.destroy_buffer( mesh.pbr_material.material_buffer );
-        gpu.destroy_descriptor_set( mesh.pbr_material.descriptor_set_transparent );
+        if ( mesh.has_skinning() ) {
+            for ( u32 i = 0; i < k_max_frames; ++i ) {
+                gpu.destroy_descriptor_set( mesh.pbr_material.descriptor_set_transparent_skinning[ i ] );
+            }
+        } else {
+            gpu.destroy_descriptor_set( mesh.pbr_material.descriptor_set_transparent );
+        }
         gpu.destroy_descriptor_set( mesh.pbr_material.descriptor_set_main );
     }
 
@@ -995,6 +694,7 @@ void glTFScene::shutdown( Renderer* renderer ) {
     gpu.destroy_buffer( meshes_sb );
     gpu.destroy_buffer( mesh_bounds_sb );
     gpu.destroy_buffer( mesh_instances_sb );
+    gpu.destroy_buffer( scene_staging_buffer );
     gpu.destroy_buffer( meshlets_sb );
     gpu.destroy_buffer( meshlets_vertex_pos_sb );
     gpu.destroy_buffer( meshlets_vertex_data_sb );
@@ -1049,10 +749,12 @@ void glTFScene::shutdown( Renderer* renderer ) {
     gpu.destroy_texture( fragment_shading_rate_image );
 
     lights.shutdown();
-    lights_lut.shutdown();
+    light_clustering.shutdown();
 
     meshes.shutdown();
     mesh_instances.shutdown();
+    dirty_meshes.shutdown();
+    dirty_mesh_instances.shutdown();
 
     names_buffer.shutdown();
 
@@ -1063,10 +765,10 @@ void glTFScene::shutdown( Renderer* renderer ) {
 
     // NOTE(marco): we can't destroy this sooner as textures and buffers
     // hold a pointer to the names stored here
-    for ( u32 i = 0; i < gltf_scenes.size; ++i ) {
-        gltf_free( gltf_scenes[ i ] );
+    for ( u32 i = 0; i < scene_caches.size; ++i ) {
+        scene_caches[ i ].shutdown();
     }
-    gltf_scenes.shutdown();
+    scene_caches.shutdown();
 
     debug_renderer.shutdown();
 }
@@ -1093,19 +795,27 @@ void glTFScene::prepare_draws( Renderer* renderer, StackAllocator* scratch_alloc
     buffer_creation.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Immutable, sizeof( GpuMeshlet ) * meshlets.size ).set_name( "meshlet_sb" ).set_data( meshlets.data );
     meshlets_sb = renderer->gpu->create_buffer( buffer_creation );
 
-    // Create mesh ssbo
-    // TODO[gabriel] : move this to be static?
-    buffer_creation.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( GpuMaterialData ) * meshes.size ).set_name( "meshes_sb" );
+    // Create mesh ssbo, device only and filled by the delta uploads of upload_gpu_data.
+    buffer_creation.reset().set( VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Immutable, sizeof( GpuMaterialData ) * meshes.size ).set_device_only( true ).set_name( "meshes_sb" );
     meshes_sb = renderer->gpu->create_buffer( buffer_creation );
 
     // Create mesh bound ssbo
-    buffer_creation.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( vec4s ) * meshes.size ).set_name( "mesh_bound_sb" );
+    buffer_creation.reset().set( VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Immutable, sizeof( vec4s ) * meshes.size ).set_device_only( true ).set_name( "mesh_bound_sb" );
     mesh_bounds_sb = renderer->gpu->create_buffer( buffer_creation );
 
     // Create mesh instances ssbo
-    buffer_creation.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( GpuMeshInstanceData ) * mesh_instances.size ).set_name( "mesh_instances_sb" );
+    buffer_creation.reset().set( VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Immutable, sizeof( GpuMeshInstanceData ) * mesh_instances.size ).set_device_only( true ).set_name( "mesh_instances_sb" );
     mesh_instances_sb = renderer->gpu->create_buffer( buffer_creation );
 
+    // Staging sections fit a full upload, needed by the first frame and by global scale changes.
+    scene_staging_section_size = ( sizeof( GpuMaterialData ) + sizeof( vec4s ) ) * meshes.size + sizeof( GpuMeshInstanceData ) * mesh_instances.size;
+    buffer_creation.reset().set( VK_BUFFER_USAGE_TRANSFER_SRC_BIT, ResourceUsageType::Stream, scene_staging_section_size * k_max_frames ).set_persistent( true ).set_name( "scene_staging_buffer" );
+    scene_staging_buffer = renderer->gpu->create_buffer( buffer_creation );
+
+    dirty_meshes.init( resident_allocator, meshes.size );
+    dirty_mesh_instances.init( resident_allocator, mesh_instances.size );
+    mark_all_dirty();
+
     // Create indirect buffers, dynamic so need multiple buffering.
     for ( u32 i = 0; i < k_max_frames; ++i ) {
         // This buffer contains both opaque and transparent commands, thus is multiplied by two.
@@ -1143,7 +853,7 @@ void glTFScene::prepare_draws( Renderer* renderer, StackAllocator* scratch_alloc
     }
 
     // Create per mesh descriptor sets, using the mesh draw ssbo
-    const u64 hashed_name = hash_calculate( "main" );
+    const u64 hashed_name = rhash( "main" );
     GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hashed_name );
 
     for ( u32 m = 0; m < meshes.size; ++m ) {
@@ -1158,11 +868,11 @@ void glTFScene::prepare_draws( Renderer* renderer, StackAllocator* scratch_alloc
         u32 pass_index = 0;
         u32 depth_pass_index = 0;
         if ( mesh.has_skinning() ) {
-            pass_index = main_technique->name_hash_to_index.get( hash_calculate( "transparent_skinning_no_cull" ) );
-            depth_pass_index = main_technique->name_hash_to_index.get( hash_calculate( "depth_pre_skinning" ) );
+            pass_index = main_technique->name_hash_to_index.get( rhash( "transparent_skinning_no_cull" ) );
+            depth_pass_index = main_technique->name_hash_to_index.get( rhash( "depth_pre_skinning" ) );
         } else {
-            pass_index = main_technique->name_hash_to_index.get( hash_calculate( "transparent_no_cull" ) );
-            depth_pass_index = main_technique->name_hash_to_index.get( hash_calculate( "depth_pre" ) );
+            pass_index = main_technique->name_hash_to_index.get( rhash( "transparent_no_cull" ) );
+            depth_pass_index = main_technique->name_hash_to_index.get( rhash( "depth_pre" ) );
         }
 
         DescriptorSetLayoutHandle layout = renderer->gpu->get_descriptor_set_layout( main_technique->passes[ pass_index ].pipeline, k_material_descriptor_set_index );
@@ -1170,11 +880,19 @@ void glTFScene::prepare_draws( Renderer* renderer, StackAllocator* scratch_alloc
         ds_creation.buffer( scene_cb, 0 ).buffer( meshes_sb, 2 ).buffer( mesh_instances_sb, 10 ).buffer( mesh_bounds_sb, 12 )
             .buffer( debug_line_sb, 20 ).buffer( debug_line_count_sb, 21 ).buffer( debug_line_commands_sb, 22).buffer( mesh_bounds_sb, 25 ).set_layout(layout);
 
+        // Create main descriptor set
         if ( mesh.has_skinning() ) {
-            ds_creation.buffer( skins[ mesh.skin_index ].joint_transforms, 3 );
+            const Skin& skin = skins[ mesh.skin_index ];
+            // Bindings are appended: only the last one, the joint palette, changes per frame.
+            const u32 num_resources = ds_creation.num_resources;
+            for ( u32 i = 0; i < k_max_frames; ++i ) {
+                ds_creation.num_resources = num_resources;
+                ds_creation.buffer( skin.joint_transforms[ i ], 3 );
+                mesh.pbr_material.descriptor_set_transparent_skinning[ i ] = renderer->gpu->create_descriptor_set( ds_creation );
+            }
+        } else {
+            mesh.pbr_material.descriptor_set_transparent = renderer->gpu->create_descriptor_set( ds_creation );
         }
-        // Create main descriptor set
-        mesh.pbr_material.descriptor_set_transparent = renderer->gpu->create_descriptor_set( ds_creation );
 
         // Create depth descriptor set
         layout = renderer->gpu->get_descriptor_set_layout( main_technique->passes[ depth_pass_index ].pipeline, k_material_descriptor_set_index );
@@ -1209,7 +927,7 @@ void glTFScene::prepare_draws( Renderer* renderer, StackAllocator* scratch_alloc
 
     // Meshlet and meshlet emulation descriptors
     {
-        const u64 meshlet_hashed_name = hash_calculate( "meshlet" );
+        const u64 meshlet_hashed_name = rhash( "meshlet" );
         GpuTechnique* meshlet_technique = renderer->resource_cache.techniques.get( meshlet_hashed_name );
 
         if ( renderer->gpu->mesh_shaders_extension_present ) {
@@ -1265,7 +983,7 @@ void glTFScene::prepare_draws( Renderer* renderer, StackAllocator* scratch_alloc
 
     scratch_allocator->free_marker( cached_scratch_size );
 
-    lights.init( resident_allocator, k_num_lights );
+    lights.init( resident_allocator, max_lights );
 
     // Add a first light in a fixed position and then random lights.
     const u32 lights_per_side = raptor::ceilu32( sqrtf( active_lights * 1.f ) );
@@ -1295,7 +1013,7 @@ void glTFScene::prepare_draws( Renderer* renderer, StackAllocator* scratch_alloc
             lights.push( new_light );
         }
 
-        for ( u32 i = 1; i < k_num_lights; ++i ) {
+        for ( u32 i = 1; i < max_lights; ++i ) {
 
             const f32 x = ( i % lights_per_side ) - lights_per_side * .7f;
             const f32 y = 0.1f;
@@ -1327,34 +1045,31 @@ void glTFScene::prepare_draws( Renderer* renderer, StackAllocator* scratch_alloc
     }
 
     {
-        buffer_creation.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( GpuLight ) * k_num_lights ).set_name( "light_array" );
+        buffer_creation.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( GpuLight ) * max_lights ).set_name( "light_array" );
         lights_list_sb = renderer->gpu->create_buffer( buffer_creation );
     }
 
-    lights_lut.init( resident_allocator, k_light_z_bins, k_light_z_bins );
+    light_clustering.init( resident_allocator, max_lights, k_light_z_bins, k_tile_size );
+    light_clustering.resize( renderer->width, renderer->height );
 
     for ( u32 i = 0; i < k_max_frames; ++i ) {
         buffer_creation.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( u32 ) * k_light_z_bins ).set_name( "light_z_bins" );
         lights_lut_sb[ i ] = renderer->gpu->create_buffer( buffer_creation );
 
-        buffer_creation.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( u32 )* k_num_lights ).set_name( "light_indices_sb" );
+        buffer_creation.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( u32 ) * max_lights ).set_name( "light_indices_sb" );
         lights_indices_sb[ i ] = renderer->gpu->create_buffer( buffer_creation );
 
         buffer_creation.reset().set( VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( GpuLightingData ) ).set_name( "lighting_constants_cb" );
         lighting_constants_cb[ i ] = renderer->gpu->create_buffer( buffer_creation );
 
-        const u32 tile_x_count = ceilu32( renderer->width * 1.0f / k_tile_size );
-        const u32 tile_y_count = ceilu32( renderer->height * 1.0f / k_tile_size );
-        const u32 tiles_entry_count = tile_x_count * tile_y_count * k_num_words;
-        const u32 buffer_size = tiles_entry_count * sizeof( u32 );
-        buffer_creation.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, buffer_size ).set_name( "light_tiles" );
+        buffer_creation.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, ( u32 )light_clustering.get_tiles_size() ).set_name( "light_tiles" );
         lights_tiles_sb[ i ] = renderer->gpu->create_buffer( buffer_creation );
     }
 
     debug_renderer.init( *this, resident_allocator, scratch_allocator );
 
     if ( use_meshlets ) {
-        GpuTechnique* transparent_technique = renderer->resource_cache.techniques.get( hash_calculate( "meshlet" ) );
+        GpuTechnique* transparent_technique = renderer->resource_cache.techniques.get( rhash( "meshlet" ) );
         u32 meshlet_technique_index = transparent_technique->get_pass_index( "transparent_no_cull" );
         GpuTechniquePass& transparent_pass = transparent_technique->passes[ meshlet_technique_index ];
 
@@ -0,0 +1,950 @@
+#include "graphics/gltf_scene_blob.hpp"
+
+#include "foundation/gltf.hpp"
+#include "foundation/blob_serialization.hpp"
+#include "foundation/memory.hpp"
+#include "foundation/array.hpp"
+#include "foundation/time.hpp"
+#include "foundation/numerics.hpp"
+
+#include "external/stb_image.h"
+
+#include "external/cglm/struct/mat4.h"
+#include "external/cglm/struct/vec3.h"
+#include "external/cglm/struct/quat.h"
+
+#include "external/tracy/tracy/Tracy.hpp"
+#include "external/meshoptimizer/meshoptimizer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace raptor {
+
+// Arrays are 16 bytes aligned inside the blob, mapped memory is page aligned.
+static const u32        k_blob_alignment        = 16;
+
+static sizet blob_array_size( sizet size ) {
+    return size + k_blob_alignment;
+}
+
+static void blob_align( BlobSerializer& serializer ) {
+    const u32 padding = ( k_blob_alignment - ( serializer.allocated_offset % k_blob_alignment ) ) % k_blob_alignment;
+    if ( padding ) {
+        serializer.allocate_static( padding );
+    }
+}
+
+template <typename T>
+static void blob_allocate_array( BlobSerializer& serializer, RelativeArray<T>& array, u32 count, void* source_data = nullptr ) {
+    blob_align( serializer );
+    serializer.allocate_and_set( array, count, source_data );
+}
+
+static SceneBlobAccessor resolve_accessor( glTF::glTF& gltf_scene, i32 accessor_index ) {
+    SceneBlobAccessor result{ -1, 0, 0, 0 };
+    if ( accessor_index == -1 || accessor_index == glTF::INVALID_INT_VALUE ) {
+        return result;
+    }
+
+    glTF::Accessor& accessor = gltf_scene.accessors[ accessor_index ];
+    glTF::BufferView& buffer_view = gltf_scene.buffer_views[ accessor.buffer_view ];
+
+    result.buffer = buffer_view.buffer;
+    result.byte_offset = glTF::get_data_offset( accessor.byte_offset, buffer_view.byte_offset );
+    result.count = accessor.count;
+    result.type = accessor.type;
+    return result;
+}
+
+static i32 texture_info_index( glTF::TextureInfo* texture_info ) {
+    return texture_info != nullptr ? texture_info->index : -1;
+}
+
+static void cook_material( glTF::Material& material, SceneBlobMaterial& blob_material ) {
+    blob_material = { };
+    blob_material.base_color_factor[ 0 ] = blob_material.base_color_factor[ 1 ] = blob_material.base_color_factor[ 2 ] = blob_material.base_color_factor[ 3 ] = 1.0f;
+    blob_material.roughness = 1.0f;
+
+    // Handle flags
+    if ( material.alpha_mode.data != nullptr && strcmp( material.alpha_mode.data, "MASK" ) == 0 ) {
+        blob_material.flags |= DrawFlags_AlphaMask;
+    } else if ( material.alpha_mode.data != nullptr && strcmp( material.alpha_mode.data, "BLEND" ) == 0 ) {
+        blob_material.flags |= DrawFlags_Transparent;
+    }
+
+    blob_material.flags |= material.double_sided ? DrawFlags_DoubleSided : 0;
+    blob_material.alpha_cutoff = material.alpha_cutoff != glTF::INVALID_FLOAT_VALUE ? material.alpha_cutoff : 1.f;
+
+    blob_material.diffuse_texture = -1;
+    blob_material.roughness_texture = -1;
+
+    if ( material.pbr_metallic_roughness != nullptr ) {
+        if ( material.pbr_metallic_roughness->base_color_factor_count != 0 ) {
+            RASSERT( material.pbr_metallic_roughness->base_color_factor_count == 4 );
+
+            memcpy( blob_material.base_color_factor, material.pbr_metallic_roughness->base_color_factor, sizeof( f32 ) * 4 );
+        }
+
+        blob_material.roughness = material.pbr_metallic_roughness->roughness_factor != glTF::INVALID_FLOAT_VALUE ? material.pbr_metallic_roughness->roughness_factor : 1.f;
+        blob_material.metallic = material.pbr_metallic_roughness->metallic_factor != glTF::INVALID_FLOAT_VALUE ? material.pbr_metallic_roughness->metallic_factor : 0.f;
+
+        blob_material.diffuse_texture = texture_info_index( material.pbr_metallic_roughness->base_color_texture );
+        blob_material.roughness_texture = texture_info_index( material.pbr_metallic_roughness->metallic_roughness_texture );
+    }
+
+    blob_material.emissive_texture = texture_info_index( material.emissive_texture );
+
+    if ( material.emissive_factor_count != 0 ) {
+        RASSERT( material.emissive_factor_count == 3 );
+
+        memcpy( blob_material.emissive_factor, material.emissive_factor, sizeof( f32 ) * 3 );
+    }
+
+    blob_material.occlusion_texture = ( material.occlusion_texture != nullptr ) ? material.occlusion_texture->index : -1;
+    blob_material.normal_texture = ( material.normal_texture != nullptr ) ? material.normal_texture->index : -1;
+
+    if ( material.occlusion_texture != nullptr ) {
+        blob_material.occlusion = material.occlusion_texture->strength != glTF::INVALID_FLOAT_VALUE ? material.occlusion_texture->strength : 1.0f;
+    }
+}
+
+static void cook_node_matrix( glTF::Node& node, f32* local_matrix ) {
+    // CGLM and glTF have the same matrix layout, just memcopy it
+    if ( node.matrix_count ) {
+        memcpy( local_matrix, node.matrix, sizeof( mat4s ) );
+        return;
+    }
+
+    // Handle individual transform components: SRT (scale, rotation, translation)
+    Transform transform;
+    transform.scale = vec3s{ 1.0f, 1.0f, 1.0f };
+    if ( node.scale_count ) {
+        RASSERT( node.scale_count == 3 );
+        transform.scale = vec3s{ node.scale[ 0 ], node.scale[ 1 ], node.scale[ 2 ] };
+    }
+
+    transform.translation = vec3s{ 0.f, 0.f, 0.f };
+    if ( node.translation_count ) {
+        RASSERT( node.translation_count == 3 );
+        transform.translation = vec3s{ node.translation[ 0 ], node.translation[ 1 ], node.translation[ 2 ] };
+    }
+
+    // Rotation is written as a plain quaternion
+    transform.rotation = glms_quat_identity();
+    if ( node.rotation_count ) {
+        RASSERT( node.rotation_count == 4 );
+        transform.rotation = glms_quat_init( node.rotation[ 0 ], node.rotation[ 1 ], node.rotation[ 2 ], node.rotation[ 3 ] );
+    }
+
+    const mat4s matrix = transform.calculate_matrix();
+    memcpy( local_matrix, matrix.raw, sizeof( mat4s ) );
+}
+
+static u32 add_source( Array<SceneBlobSource>& sources, Array<cstring>& source_paths, cstring path ) {
+    u64 size = 0, write_time = 0;
+    if ( path == nullptr || !file_stat( path, &size, &write_time ) ) {
+        return 0;
+    }
+
+    SceneBlobSource& source = sources.push_use();
+    source.size = size;
+    source.write_time = write_time;
+    source_paths.push( path );
+
+    return ( u32 )strlen( path ) + 1;
+}
+
+// Meshlet building //////////////////////////////////////////////////////
+
+static const sizet      k_meshlet_max_vertices  = 64;
+static const sizet      k_meshlet_max_triangles = 124;
+static const f32        k_meshlet_cone_weight   = 0.0f;
+// Vertex indices, packed triangles and up to two padding groups.
+static const sizet      k_meshlet_max_data      = k_meshlet_max_vertices + ( k_meshlet_max_triangles * 3 + 3 ) / 4 + 2;
+
+static void meshlet_build_memory_sizes( u32 index_count, sizet& scratch_size, sizet& output_size ) {
+    const sizet max_meshlets = meshopt_buildMeshletsBound( index_count, k_meshlet_max_vertices, k_meshlet_max_triangles );
+
+    output_size = sizeof( GpuMeshlet ) * ( max_meshlets + 32 ) + sizeof( u32 ) * max_meshlets * k_meshlet_max_data + 64;
+    scratch_size = output_size + sizeof( meshopt_Meshlet ) * max_meshlets + sizeof( u32 ) * max_meshlets * k_meshlet_max_vertices +
+                   max_meshlets * k_meshlet_max_triangles * 3 + 64;
+}
+
+static void build_primitive_meshlets( MeshletBuildJob& job, GpuMeshletVertexPosition* vertex_positions, GpuMeshletVertexData* vertex_data,
+                                      VirtualArenaAllocator* scratch_allocator, VirtualArenaAllocator* output_allocator ) {
+    ZoneScoped;
+
+    const sizet scratch_marker = scratch_allocator->get_marker();
+
+    const sizet max_meshlets = meshopt_buildMeshletsBound( job.index_count, k_meshlet_max_vertices, k_meshlet_max_triangles );
+
+    Array<meshopt_Meshlet> local_meshlets;
+    local_meshlets.init( scratch_allocator, max_meshlets, max_meshlets );
+
+    Array<u32> meshlet_vertex_indices;
+    meshlet_vertex_indices.init( scratch_allocator, max_meshlets * k_meshlet_max_vertices, max_meshlets * k_meshlet_max_vertices );
+
+    Array<u8> meshlet_triangles;
+    meshlet_triangles.init( scratch_allocator, max_meshlets * k_meshlet_max_triangles * 3, max_meshlets * k_meshlet_max_triangles * 3 );
+
+    sizet meshlet_count = meshopt_buildMeshlets( local_meshlets.data, meshlet_vertex_indices.data, meshlet_triangles.data, job.indices,
+                                                 job.index_count, job.vertices, job.vertex_count, sizeof( vec3s ),
+                                                 k_meshlet_max_vertices, k_meshlet_max_triangles, k_meshlet_cone_weight );
+
+    vec3s aabb[ 2 ];
+    aabb[ 0 ] = vec3s{ FLT_MAX, FLT_MAX, FLT_MAX };
+    aabb[ 1 ] = vec3s{ FLT_MIN, FLT_MIN, FLT_MIN };
+
+    for ( u32 v = 0; v < job.vertex_count; ++v ) {
+        GpuMeshletVertexPosition meshlet_vertex_pos{ };
+
+        f32 x = job.vertices[ v * 3 + 0 ];
+        f32 y = job.vertices[ v * 3 + 1 ];
+        f32 z = job.vertices[ v * 3 + 2 ];
+
+        aabb[ 0 ] = glms_vec3_minv( aabb[ 0 ], vec3s{ x, y, z } );
+        aabb[ 1 ] = glms_vec3_maxv( aabb[ 1 ], vec3s{ x, y, z } );
+
+        meshlet_vertex_pos.position[ 0 ] = x;
+        meshlet_vertex_pos.position[ 1 ] = y;
+        meshlet_vertex_pos.position[ 2 ] = z;
+
+        vertex_positions[ job.vertex_offset + v ] = meshlet_vertex_pos;
+
+        GpuMeshletVertexData meshlet_vertex_data{ };
+
+        if ( job.normals != nullptr ) {
+            meshlet_vertex_data.normal[ 0 ] = ( job.normals[ v * 3 + 0 ] + 1.0f ) * 127.0f;
+            meshlet_vertex_data.normal[ 1 ] = ( job.normals[ v * 3 + 1 ] + 1.0f ) * 127.0f;
+            meshlet_vertex_data.normal[ 2 ] = ( job.normals[ v * 3 + 2 ] + 1.0f ) * 127.0f;
+        }
+
+        if ( job.tangents != nullptr ) {
+            meshlet_vertex_data.tangent[ 0 ] = ( job.tangents[ v * 3 + 0 ] + 1.0f ) * 127.0f;
+            meshlet_vertex_data.tangent[ 1 ] = ( job.tangents[ v * 3 + 1 ] + 1.0f ) * 127.0f;
+            meshlet_vertex_data.tangent[ 2 ] = ( job.tangents[ v * 3 + 2 ] + 1.0f ) * 127.0f;
+            meshlet_vertex_data.tangent[ 3 ] = ( job.tangents[ v * 3 + 3 ] + 1.0f ) * 127.0f;
+        }
+
+        if ( job.tex_coords != nullptr ) {
+            meshlet_vertex_data.uv_coords[ 0 ] = meshopt_quantizeHalf( job.tex_coords[ v * 2 + 0 ] );
+            meshlet_vertex_data.uv_coords[ 1 ] = meshopt_quantizeHalf( job.tex_coords[ v * 2 + 1 ] );
+        }
+
+        vertex_data[ job.vertex_offset + v ] = meshlet_vertex_data;
+    }
+
+    memcpy( job.aabb_min, aabb[ 0 ].raw, sizeof( f32 ) * 3 );
+    memcpy( job.aabb_max, aabb[ 1 ].raw, sizeof( f32 ) * 3 );
+
+    Array<GpuMeshlet> meshlets;
+    meshlets.init( scratch_allocator, ( u32 )meshlet_count + 32 );
+    Array<u32> meshlets_data;
+    meshlets_data.init( scratch_allocator, ( u32 )( meshlet_count * k_meshlet_max_data ) + 1 );
+
+    job.meshlet_index_count = 0;
+    job.index_group_count = 0;
+
+    // Append meshlet data
+    for ( u32 m = 0; m < meshlet_count; ++m ) {
+        meshopt_Meshlet& local_meshlet = local_meshlets[ m ];
+
+        meshopt_Bounds meshlet_bounds = meshopt_computeMeshletBounds( meshlet_vertex_indices.data + local_meshlet.vertex_offset,
+                                                                      meshlet_triangles.data + local_meshlet.triangle_offset, local_meshlet.triangle_count,
+                                                                      job.vertices, job.vertex_count, sizeof( vec3s ) );
+
+        GpuMeshlet meshlet{};
+        meshlet.data_offset = meshlets_data.size;
+        meshlet.vertex_count = local_meshlet.vertex_count;
+        meshlet.triangle_count = local_meshlet.triangle_count;
+
+        meshlet.center = vec3s{ meshlet_bounds.center[ 0 ], meshlet_bounds.center[ 1 ], meshlet_bounds.center[ 2 ] };
+        meshlet.radius = meshlet_bounds.radius;
+
+        meshlet.cone_axis[ 0 ] = meshlet_bounds.cone_axis_s8[ 0 ];
+        meshlet.cone_axis[ 1 ] = meshlet_bounds.cone_axis_s8[ 1 ];
+        meshlet.cone_axis[ 2 ] = meshlet_bounds.cone_axis_s8[ 2 ];
+
+        meshlet.cone_cutoff = meshlet_bounds.cone_cutoff_s8;
+        meshlet.mesh_index = job.mesh_index;
+
+        const u32 index_group_count = ( local_meshlet.triangle_count * 3 + 3 ) / 4;
+
+        for ( u32 i = 0; i < meshlet.vertex_count; ++i ) {
+            const u32 vertex_index = job.vertex_offset + meshlet_vertex_indices[ local_meshlet.vertex_offset + i ];
+            meshlets_data.push( vertex_index );
+        }
+
+        // Store indices as uint32, 4 indices at a time for the mesh shader.
+        const u32* index_groups = reinterpret_cast< const u32* >( meshlet_triangles.data + local_meshlet.triangle_offset );
+        for ( u32 i = 0; i < index_group_count; ++i ) {
+            const u32 index_group = index_groups[ i ];
+            meshlets_data.push( index_group );
+        }
+
+        // Writing in group of fours can share a triangle between meshlets when the
+        // index count is not a multiple of 3: pad with one or two groups of empty triangles.
+        u32 last_index_group = index_groups[ index_group_count - 1 ];
+        u32 last_index = ( last_index_group >> 8 ) & 0xff;
+        u32 second_last_index = ( last_index_group >> 16 ) & 0xff;
+        u32 third_last_index = ( last_index_group >> 24 ) & 0xff;
+        if ( last_index != 0 && third_last_index == 0 ) {
+
+            if ( second_last_index != 0 ) {
+                // Add a single index group of zeroes
+                meshlets_data.push( 0 );
+                meshlet.triangle_count++;
+            }
+
+            meshlet.triangle_count++;
+            // Add another index group of zeroes
+            meshlets_data.push( 0 );
+        }
+
+        job.meshlet_index_count += meshlet.triangle_count * 3;
+
+        meshlets.push( meshlet );
+
+        job.index_group_count += index_group_count;
+    }
+
+    job.meshlet_count = ( u32 )meshlet_count;
+
+    // Each primitive starts at a multiple of 32 meshlets.
+    while ( meshlets.size % 32 )
+        meshlets.push( GpuMeshlet() );
+
+    // Keep the result in the output arena, scratch memory is reused by the next primitive.
+    job.padded_meshlet_count = meshlets.size;
+    job.meshlets_data_count = meshlets_data.size;
+    job.meshlets = nullptr;
+    job.meshlets_data = nullptr;
+
+    if ( meshlets.size ) {
+        job.meshlets = ( GpuMeshlet* )rallocaa( sizeof( GpuMeshlet ) * meshlets.size, output_allocator, 16 );
+        memory_copy( job.meshlets, meshlets.data, sizeof( GpuMeshlet ) * meshlets.size );
+    }
+
+    if ( meshlets_data.size ) {
+        job.meshlets_data = ( u32* )rallocaa( sizeof( u32 ) * meshlets_data.size, output_allocator, 16 );
+        memory_copy( job.meshlets_data, meshlets_data.data, sizeof( u32 ) * meshlets_data.size );
+    }
+
+    scratch_allocator->free_marker( scratch_marker );
+}
+
+// MeshletBuildTask ///////////////////////////////////////////////////////
+
+void MeshletBuildTask::init( u32 num_threads_, sizet scratch_size, sizet output_size ) {
+    RASSERT( num_threads_ > 0 && num_threads_ <= k_max_threads );
+    num_threads = num_threads_;
+
+    // Only address space is reserved, pages are committed while building.
+    for ( u32 t = 0; t < num_threads; ++t ) {
+        scratch_arenas[ t ].init( scratch_size + rmega( 1 ) );
+        output_arenas[ t ].init( output_size + rmega( 1 ) );
+    }
+}
+
+void MeshletBuildTask::shutdown() {
+    for ( u32 t = 0; t < num_threads; ++t ) {
+        scratch_arenas[ t ].shutdown();
+        output_arenas[ t ].shutdown();
+    }
+    num_threads = 0;
+}
+
+void MeshletBuildTask::ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) {
+    ZoneScoped;
+
+    RASSERT( threadnum_ < num_threads );
+
+    for ( u32 i = range_.start; i < range_.end; ++i ) {
+        build_primitive_meshlets( jobs[ i ], vertex_positions, vertex_data, &scratch_arenas[ threadnum_ ], &output_arenas[ threadnum_ ] );
+    }
+}
+
+// glTFSceneCache /////////////////////////////////////////////////////////
+
+bool glTFSceneCache::load( cstring cache_path ) {
+    ZoneScoped;
+
+    if ( !file_map_read( cache_path, &mapping ) ) {
+        return false;
+    }
+
+    const BlobHeader* header = ( const BlobHeader* )mapping.data;
+    if ( mapping.size < sizeof( glTFSceneBlob ) || header->version != k_gltf_scene_blob_version || header->mappable == 0 ) {
+        rprint( "Scene blob %s has a different version, cooking again.\n", cache_path );
+        file_unmap( &mapping );
+        return false;
+    }
+
+    // Same version: the serializer returns the mapped memory without any copy.
+    BlobSerializer serializer;
+    glTFSceneBlob* mapped_blob = serializer.read<glTFSceneBlob>( nullptr, k_gltf_scene_blob_version, mapping.size, ( char* )mapping.data );
+
+    for ( u32 s = 0; s < mapped_blob->sources.size; ++s ) {
+        const SceneBlobSource& source = mapped_blob->sources[ s ];
+
+        u64 size = 0, write_time = 0;
+        if ( !file_stat( source.path.c_str(), &size, &write_time ) || size != source.size || write_time != source.write_time ) {
+            rprint( "Scene blob %s is stale, %s changed.\n", cache_path, source.path.c_str() );
+            file_unmap( &mapping );
+            return false;
+        }
+    }
+
+    blob = mapped_blob;
+    blob_size = mapping.size;
+
+    return true;
+}
+
+bool glTFSceneCache::cook( cstring gltf_path, cstring cache_path, Allocator* allocator_, enki::TaskScheduler* task_scheduler ) {
+    ZoneScoped;
+
+    allocator = allocator_;
+
+    i64 start_cooking = time_now();
+
+    glTF::glTF gltf_scene = gltf_load_file( gltf_path );
+
+    i64 end_parsing = time_now();
+
+    Array<SceneBlobSource> sources;
+    sources.init( allocator, gltf_scene.buffers_count + gltf_scene.images_count + 1 );
+    Array<cstring> source_paths;
+    source_paths.init( allocator, gltf_scene.buffers_count + gltf_scene.images_count + 1 );
+
+    sizet strings_size = add_source( sources, source_paths, gltf_path );
+
+    // Read all buffers
+    Array<FileReadResult> buffers_data;
+    buffers_data.init( allocator, gltf_scene.buffers_count );
+
+    sizet buffers_size = 0;
+    for ( u32 buffer_index = 0; buffer_index < gltf_scene.buffers_count; ++buffer_index ) {
+        glTF::Buffer& buffer = gltf_scene.buffers[ buffer_index ];
+
+        FileReadResult buffer_data{ nullptr, 0 };
+        if ( buffer.uri.data == nullptr && gltf_scene.binary_chunk ) {
+            // .glb binary chunk, copied so that all buffers are released the same way.
+            buffer_data.size = gltf_scene.binary_chunk_size;
+            buffer_data.data = ( char* )ralloca( buffer_data.size, allocator );
+            memory_copy( buffer_data.data, gltf_scene.binary_chunk, buffer_data.size );
+        } else {
+            buffer_data = file_read_binary( buffer.uri.data, allocator );
+        }
+        buffers_data.push( buffer_data );
+        buffers_size += blob_array_size( buffer_data.size );
+
+        strings_size += add_source( sources, source_paths, buffer.uri.data );
+    }
+
+    // Image sizes are cooked too, so that texture creation does not open image files.
+    for ( u32 image_index = 0; image_index < gltf_scene.images_count; ++image_index ) {
+        glTF::Image& image = gltf_scene.images[ image_index ];
+
+        strings_size += add_source( sources, source_paths, image.uri.data );
+        strings_size += image.uri.data ? strlen( image.uri.data ) + 1 : 1;
+    }
+
+    i64 end_reading_buffers = time_now();
+
+    // Resolve primitives: vertex offsets only depend on vertex counts, so they are known before building meshlets.
+    vec3s aabb[ 2 ];
+    aabb[ 0 ] = vec3s{ FLT_MAX, FLT_MAX, FLT_MAX };
+    aabb[ 1 ] = vec3s{ FLT_MIN, FLT_MIN, FLT_MIN };
+
+    Array<SceneBlobMesh> meshes;
+    meshes.init( allocator, 16 );
+    Array<u32> gltf_mesh_offsets;
+    gltf_mesh_offsets.init( allocator, gltf_scene.meshes_count );
+    Array<MeshletBuildJob> meshlet_jobs;
+    meshlet_jobs.init( allocator, 16 );
+
+    u32 total_vertex_count = 0;
+    sizet max_scratch_size = 0;
+    sizet total_output_size = 0;
+
+    for ( u32 mi = 0; mi < gltf_scene.meshes_count; ++mi ) {
+        glTF::Mesh& gltf_mesh = gltf_scene.meshes[ mi ];
+
+        gltf_mesh_offsets.push( meshes.size );
+
+        for ( u32 p = 0; p < gltf_mesh.primitives_count; ++p ) {
+            glTF::MeshPrimitive& mesh_primitive = gltf_mesh.primitives[ p ];
+
+            SceneBlobMesh mesh{ };
+
+            mesh.position = resolve_accessor( gltf_scene, gltf_get_attribute_accessor_index( mesh_primitive.attributes, mesh_primitive.attribute_count, "POSITION" ) );
+            mesh.tangent = resolve_accessor( gltf_scene, gltf_get_attribute_accessor_index( mesh_primitive.attributes, mesh_primitive.attribute_count, "TANGENT" ) );
+            mesh.normal = resolve_accessor( gltf_scene, gltf_get_attribute_accessor_index( mesh_primitive.attributes, mesh_primitive.attribute_count, "NORMAL" ) );
+            mesh.texcoord = resolve_accessor( gltf_scene, gltf_get_attribute_accessor_index( mesh_primitive.attributes, mesh_primitive.attribute_count, "TEXCOORD_0" ) );
+            mesh.joints = resolve_accessor( gltf_scene, gltf_get_attribute_accessor_index( mesh_primitive.attributes, mesh_primitive.attribute_count, "JOINTS_0" ) );
+            mesh.weights = resolve_accessor( gltf_scene, gltf_get_attribute_accessor_index( mesh_primitive.attributes, mesh_primitive.attribute_count, "WEIGHTS_0" ) );
+            mesh.indices = resolve_accessor( gltf_scene, mesh_primitive.indices );
+            mesh.material = mesh_primitive.material != glTF::INVALID_INT_VALUE ? mesh_primitive.material : -1;
+
+            // Calculate bounding sphere
+            const i32 position_accessor_index = gltf_get_attribute_accessor_index( mesh_primitive.attributes, mesh_primitive.attribute_count, "POSITION" );
+            glTF::Accessor& position_buffer_accessor = gltf_scene.accessors[ position_accessor_index ];
+            vec3s position_min{ position_buffer_accessor.min[ 0 ], position_buffer_accessor.min[ 1 ], position_buffer_accessor.min[ 2 ] };
+            vec3s position_max{ position_buffer_accessor.max[ 0 ], position_buffer_accessor.max[ 1 ], position_buffer_accessor.max[ 2 ] };
+            vec3s bounding_center = glms_vec3_divs( glms_vec3_add( position_min, position_max ), 2.0f );
+            f32 radius = raptor::max( glms_vec3_distance( position_max, bounding_center ), glms_vec3_distance( position_min, bounding_center ) );
+
+            mesh.bounding_sphere[ 0 ] = bounding_center.x;
+            mesh.bounding_sphere[ 1 ] = bounding_center.y;
+            mesh.bounding_sphere[ 2 ] = bounding_center.z;
+            mesh.bounding_sphere[ 3 ] = radius;
+
+            MeshletBuildJob& job = meshlet_jobs.push_use();
+            job = { };
+            job.vertices = ( const f32* )( buffers_data[ mesh.position.buffer ].data + mesh.position.byte_offset );
+            job.normals = mesh.normal.buffer != -1 ? ( const f32* )( buffers_data[ mesh.normal.buffer ].data + mesh.normal.byte_offset ) : nullptr;
+            job.tangents = mesh.tangent.buffer != -1 ? ( const f32* )( buffers_data[ mesh.tangent.buffer ].data + mesh.tangent.byte_offset ) : nullptr;
+            job.tex_coords = mesh.texcoord.buffer != -1 ? ( const f32* )( buffers_data[ mesh.texcoord.buffer ].data + mesh.texcoord.byte_offset ) : nullptr;
+            job.indices = ( const u16* )( buffers_data[ mesh.indices.buffer ].data + mesh.indices.byte_offset );
+            job.vertex_count = mesh.position.count;
+            job.index_count = mesh.indices.count;
+            job.vertex_offset = total_vertex_count;
+            job.mesh_index = meshes.size;
+
+            total_vertex_count += mesh.position.count;
+
+            sizet scratch_size, output_size;
+            meshlet_build_memory_sizes( job.index_count, scratch_size, output_size );
+            max_scratch_size = raptor::max( max_scratch_size, scratch_size );
+            total_output_size += output_size;
+
+            meshes.push( mesh );
+        }
+    }
+
+    // Build meshlets
+    Array<GpuMeshletVertexPosition> meshlets_vertex_positions;
+    meshlets_vertex_positions.init( allocator, total_vertex_count, total_vertex_count );
+    Array<GpuMeshletVertexData> meshlets_vertex_data;
+    meshlets_vertex_data.init( allocator, total_vertex_count, total_vertex_count );
+
+    const bool parallel_build = task_scheduler != nullptr && task_scheduler->GetNumTaskThreads() <= MeshletBuildTask::k_max_threads;
+
+    MeshletBuildTask meshlet_task;
+    meshlet_task.jobs = meshlet_jobs.data;
+    meshlet_task.vertex_positions = meshlets_vertex_positions.data;
+    meshlet_task.vertex_data = meshlets_vertex_data.data;
+    // Any worker can end up building all primitives.
+    meshlet_task.init( parallel_build ? task_scheduler->GetNumTaskThreads() : 1, max_scratch_size, total_output_size );
+
+    if ( parallel_build && meshlet_jobs.size ) {
+        meshlet_task.m_SetSize = meshlet_jobs.size;
+        meshlet_task.m_MinRange = 1;
+
+        task_scheduler->AddTaskSetToPipe( &meshlet_task );
+        task_scheduler->WaitforTask( &meshlet_task );
+    } else if ( meshlet_jobs.size ) {
+        meshlet_task.ExecuteRange( { 0, meshlet_jobs.size }, 0 );
+    }
+
+    // Merge in primitive order, so the blob does not depend on how primitives were scheduled.
+    u32 total_meshlet_count = 0;
+    u32 total_meshlets_data_count = 0;
+    for ( u32 j = 0; j < meshlet_jobs.size; ++j ) {
+        total_meshlet_count += meshlet_jobs[ j ].padded_meshlet_count;
+        total_meshlets_data_count += meshlet_jobs[ j ].meshlets_data_count;
+    }
+
+    Array<GpuMeshlet> meshlets;
+    meshlets.init( allocator, total_meshlet_count, total_meshlet_count );
+    Array<u32> meshlets_data;
+    meshlets_data.init( allocator, total_meshlets_data_count, total_meshlets_data_count );
+
+    u32 meshlets_index_count = 0;
+    u32 meshlet_offset = 0;
+    u32 meshlets_data_offset = 0;
+
+    for ( u32 j = 0; j < meshlet_jobs.size; ++j ) {
+        const MeshletBuildJob& job = meshlet_jobs[ j ];
+        SceneBlobMesh& mesh = meshes[ j ];
+
+        mesh.meshlet_offset = meshlet_offset;
+        mesh.meshlet_count = job.meshlet_count;
+        mesh.meshlet_index_count = job.meshlet_index_count;
+
+        for ( u32 m = 0; m < job.padded_meshlet_count; ++m ) {
+            GpuMeshlet& meshlet = meshlets[ meshlet_offset + m ];
+            meshlet = job.meshlets[ m ];
+            // Padding meshlets are left empty.
+            if ( m < job.meshlet_count ) {
+                meshlet.data_offset += meshlets_data_offset;
+            }
+        }
+
+        if ( job.meshlets_data_count ) {
+            memory_copy( meshlets_data.data + meshlets_data_offset, job.meshlets_data, sizeof( u32 ) * job.meshlets_data_count );
+        }
+
+        aabb[ 0 ] = glms_vec3_minv( aabb[ 0 ], vec3s{ job.aabb_min[ 0 ], job.aabb_min[ 1 ], job.aabb_min[ 2 ] } );
+        aabb[ 1 ] = glms_vec3_maxv( aabb[ 1 ], vec3s{ job.aabb_max[ 0 ], job.aabb_max[ 1 ], job.aabb_max[ 2 ] } );
+
+        meshlet_offset += job.padded_meshlet_count;
+        meshlets_data_offset += job.meshlets_data_count;
+        meshlets_index_count += job.index_group_count;
+    }
+
+    meshlet_task.shutdown();
+    meshlet_jobs.shutdown();
+
+    i64 end_building_meshlets = time_now();
+
+    // Resolve the scene graph, visiting nodes in the same order as the runtime did.
+    glTF::Scene& root_gltf_scene = gltf_scene.scenes[ gltf_scene.scene ];
+
+    Array<i32> nodes_to_visit;
+    nodes_to_visit.init( allocator, 4 );
+    Array<i32> visit_order;
+    visit_order.init( allocator, gltf_scene.nodes_count );
+    Array<i32> node_parents;
+    node_parents.init( allocator, gltf_scene.nodes_count, gltf_scene.nodes_count );
+    Array<u32> node_levels;
+    node_levels.init( allocator, gltf_scene.nodes_count, gltf_scene.nodes_count );
+
+    for ( u32 n = 0; n < gltf_scene.nodes_count; ++n ) {
+        node_parents[ n ] = -1;
+        node_levels[ n ] = 0;
+
+        glTF::Node& node = gltf_scene.nodes[ n ];
+        strings_size += node.name.data ? strlen( node.name.data ) + 1 : 1;
+    }
+
+    for ( u32 node_index = 0; node_index < root_gltf_scene.nodes_count; ++node_index ) {
+        nodes_to_visit.push( root_gltf_scene.nodes[ node_index ] );
+    }
+
+    while ( nodes_to_visit.size ) {
+        i32 node_index = nodes_to_visit.front();
+        nodes_to_visit.delete_swap( 0 );
+
+        visit_order.push( node_index );
+
+        glTF::Node& node = gltf_scene.nodes[ node_index ];
+        for ( u32 ch = 0; ch < node.children_count; ++ch ) {
+            const i32 children_index = node.children[ ch ];
+            node_parents[ children_index ] = node_index;
+            node_levels[ children_index ] = node_levels[ node_index ] + 1;
+
+            nodes_to_visit.push( children_index );
+        }
+    }
+
+    // Calculate blob size
+    sizet animations_size = blob_array_size( sizeof( SceneBlobAnimation ) * gltf_scene.animations_count );
+    for ( u32 a = 0; a < gltf_scene.animations_count; ++a ) {
+        animations_size += blob_array_size( sizeof( AnimationChannel ) * gltf_scene.animations[ a ].channels_count );
+        animations_size += blob_array_size( sizeof( SceneBlobAnimationSampler ) * gltf_scene.animations[ a ].samplers_count );
+    }
+
+    sizet skins_size = blob_array_size( sizeof( SceneBlobSkin ) * gltf_scene.skins_count );
+    for ( u32 s = 0; s < gltf_scene.skins_count; ++s ) {
+        skins_size += blob_array_size( sizeof( i32 ) * gltf_scene.skins[ s ].joints_count );
+    }
+
+    const sizet blob_size_estimate = sizeof( glTFSceneBlob ) + strings_size + buffers_size + animations_size + skins_size +
+                                     blob_array_size( sizeof( SceneBlobSource ) * sources.size ) +
+                                     blob_array_size( sizeof( SceneBlobImage ) * gltf_scene.images_count ) +
+                                     blob_array_size( sizeof( SceneBlobSampler ) * gltf_scene.samplers_count ) +
+                                     blob_array_size( sizeof( SceneBlobTexture ) * gltf_scene.textures_count ) +
+                                     blob_array_size( sizeof( SceneBlobBuffer ) * gltf_scene.buffers_count ) +
+                                     blob_array_size( sizeof( SceneBlobMaterial ) * gltf_scene.materials_count ) +
+                                     blob_array_size( sizeof( SceneBlobMesh ) * meshes.size ) +
+                                     blob_array_size( sizeof( u32 ) * gltf_mesh_offsets.size ) +
+                                     blob_array_size( sizeof( SceneBlobNode ) * gltf_scene.nodes_count ) +
+                                     blob_array_size( sizeof( i32 ) * visit_order.size ) +
+                                     blob_array_size( sizeof( GpuMeshlet ) * meshlets.size ) +
+                                     blob_array_size( sizeof( u32 ) * meshlets_data.size ) +
+                                     blob_array_size( sizeof( GpuMeshletVertexPosition ) * meshlets_vertex_positions.size ) +
+                                     blob_array_size( sizeof( GpuMeshletVertexData ) * meshlets_vertex_data.size );
+
+    // Write blob
+    BlobSerializer serializer;
+    glTFSceneBlob* root = serializer.write_and_prepare<glTFSceneBlob>( allocator, k_gltf_scene_blob_version, blob_size_estimate );
+    // Only relative data is stored, the blob can be used in place.
+    root->header.mappable = 1;
+    // Alignment gaps are zeroed too, the same scene always cooks to the same bytes.
+    memset( ( char* )root + sizeof( BlobHeader ), 0, serializer.total_size - sizeof( BlobHeader ) );
+
+    blob_allocate_array( serializer, root->sources, sources.size, sources.data );
+    for ( u32 s = 0; s < sources.size; ++s ) {
+        serializer.allocate_and_set( root->sources[ s ].path, "%s", source_paths[ s ] );
+    }
+
+    blob_allocate_array( serializer, root->images, gltf_scene.images_count );
+    for ( u32 image_index = 0; image_index < gltf_scene.images_count; ++image_index ) {
+        glTF::Image& image = gltf_scene.images[ image_index ];
+        SceneBlobImage& blob_image = root->images[ image_index ];
+
+        blob_image.buffer = -1;
+        blob_image.byte_offset = 0;
+        blob_image.byte_length = 0;
+
+        int comp = 0, width = 0, height = 0;
+        if ( image.uri.data ) {
+            stbi_info( image.uri.data, &width, &height, &comp );
+        } else if ( image.buffer_view != glTF::INVALID_INT_VALUE ) {
+            // Image embedded in a buffer view, as found in .glb files.
+            glTF::BufferView& buffer_view = gltf_scene.buffer_views[ image.buffer_view ];
+            blob_image.buffer = buffer_view.buffer;
+            blob_image.byte_offset = buffer_view.byte_offset != glTF::INVALID_INT_VALUE ? buffer_view.byte_offset : 0;
+            blob_image.byte_length = buffer_view.byte_length;
+
+            const u8* image_data = ( const u8* )buffers_data[ buffer_view.buffer ].data + blob_image.byte_offset;
+            stbi_info_from_memory( image_data, buffer_view.byte_length, &width, &height, &comp );
+        }
+
+        u32 mip_levels = 1;
+        u32 w = width;
+        u32 h = height;
+        while ( w > 1 && h > 1 ) {
+            w /= 2;
+            h /= 2;
+
+            ++mip_levels;
+        }
+
+        blob_image.width = width;
+        blob_image.height = height;
+        blob_image.mip_levels = mip_levels;
+        serializer.allocate_and_set( blob_image.uri, "%s", image.uri.data ? image.uri.data : "" );
+    }
+
+    blob_allocate_array( serializer, root->samplers, gltf_scene.samplers_count );
+    for ( u32 sampler_index = 0; sampler_index < gltf_scene.samplers_count; ++sampler_index ) {
+        glTF::Sampler& sampler = gltf_scene.samplers[ sampler_index ];
+        root->samplers[ sampler_index ] = { sampler.min_filter, sampler.mag_filter, sampler.wrap_s, sampler.wrap_t };
+    }
+
+    blob_allocate_array( serializer, root->textures, gltf_scene.textures_count );
+    for ( u32 texture_index = 0; texture_index < gltf_scene.textures_count; ++texture_index ) {
+        glTF::Texture& texture = gltf_scene.textures[ texture_index ];
+        root->textures[ texture_index ] = { texture.source, texture.sampler };
+    }
+
+    blob_allocate_array( serializer, root->buffers, gltf_scene.buffers_count );
+    for ( u32 buffer_index = 0; buffer_index < gltf_scene.buffers_count; ++buffer_index ) {
+        blob_allocate_array( serializer, root->buffers[ buffer_index ].data, ( u32 )buffers_data[ buffer_index ].size, buffers_data[ buffer_index ].data );
+    }
+
+    blob_allocate_array( serializer, root->materials, gltf_scene.materials_count );
+    for ( u32 material_index = 0; material_index < gltf_scene.materials_count; ++material_index ) {
+        cook_material( gltf_scene.materials[ material_index ], root->materials[ material_index ] );
+    }
+
+    blob_allocate_array( serializer, root->meshes, meshes.size, meshes.data );
+    blob_allocate_array( serializer, root->gltf_mesh_offsets, gltf_mesh_offsets.size, gltf_mesh_offsets.data );
+
+    blob_allocate_array( serializer, root->nodes, gltf_scene.nodes_count );
+    for ( u32 n = 0; n < gltf_scene.nodes_count; ++n ) {
+        glTF::Node& node = gltf_scene.nodes[ n ];
+        SceneBlobNode& blob_node = root->nodes[ n ];
+
+        cook_node_matrix( node, blob_node.local_matrix );
+        blob_node.parent = node_parents[ n ];
+        blob_node.level = node_levels[ n ];
+        blob_node.mesh = node.mesh != glTF::INVALID_INT_VALUE ? node.mesh : -1;
+        blob_node.skin = node.skin != glTF::INVALID_INT_VALUE ? node.skin : -1;
+        serializer.allocate_and_set( blob_node.name, "%s", node.name.data ? node.name.data : "" );
+    }
+
+    blob_allocate_array( serializer, root->visit_order, visit_order.size, visit_order.data );
+    root->scene_node_count = visit_order.size;
+
+    blob_allocate_array( serializer, root->meshlets, meshlets.size, meshlets.data );
+    blob_allocate_array( serializer, root->meshlets_data, meshlets_data.size, meshlets_data.data );
+    blob_allocate_array( serializer, root->meshlets_vertex_positions, meshlets_vertex_positions.size, meshlets_vertex_positions.data );
+    blob_allocate_array( serializer, root->meshlets_vertex_data, meshlets_vertex_data.size, meshlets_vertex_data.data );
+    root->meshlets_index_count = meshlets_index_count;
+
+    memcpy( root->aabb_min, aabb[ 0 ].raw, sizeof( f32 ) * 3 );
+    memcpy( root->aabb_max, aabb[ 1 ].raw, sizeof( f32 ) * 3 );
+
+    blob_allocate_array( serializer, root->animations, gltf_scene.animations_count );
+    for ( u32 animation_index = 0; animation_index < gltf_scene.animations_count; ++animation_index ) {
+        glTF::Animation& gltf_animation = gltf_scene.animations[ animation_index ];
+        SceneBlobAnimation& animation = root->animations[ animation_index ];
+
+        blob_allocate_array( serializer, animation.channels, gltf_animation.channels_count );
+        for ( u32 channel_index = 0; channel_index < gltf_animation.channels_count; ++channel_index ) {
+            glTF::AnimationChannel& gltf_channel = gltf_animation.channels[ channel_index ];
+            AnimationChannel& channel = animation.channels[ channel_index ];
+
+            channel.sampler = gltf_channel.sampler;
+            channel.target_node = gltf_channel.target_node;
+            channel.target_type = ( AnimationChannel::TargetType )gltf_channel.target_type;
+        }
+
+        blob_allocate_array( serializer, animation.samplers, gltf_animation.samplers_count );
+        for ( u32 sampler_index = 0; sampler_index < gltf_animation.samplers_count; ++sampler_index ) {
+            glTF::AnimationSampler& gltf_sampler = gltf_animation.samplers[ sampler_index ];
+            SceneBlobAnimationSampler& sampler = animation.samplers[ sampler_index ];
+
+            sampler.input = resolve_accessor( gltf_scene, gltf_sampler.input_keyframe_buffer_index );
+            sampler.output = resolve_accessor( gltf_scene, gltf_sampler.output_keyframe_buffer_index );
+            sampler.interpolation = gltf_sampler.interpolation;
+        }
+    }
+
+    blob_allocate_array( serializer, root->skins, gltf_scene.skins_count );
+    for ( u32 skin_index = 0; skin_index < gltf_scene.skins_count; ++skin_index ) {
+        glTF::Skin& gltf_skin = gltf_scene.skins[ skin_index ];
+        SceneBlobSkin& skin = root->skins[ skin_index ];
+
+        skin.inverse_bind_matrices = resolve_accessor( gltf_scene, gltf_skin.inverse_bind_matrices_buffer_index );
+        skin.skeleton_root_index = gltf_skin.skeleton_root_node_index;
+        blob_allocate_array( serializer, skin.joints, gltf_skin.joints_count, gltf_skin.joints );
+    }
+
+    const sizet written_size = serializer.allocated_offset;
+
+    // Free source data
+    meshlets_vertex_data.shutdown();
+    meshlets_vertex_positions.shutdown();
+    meshlets_data.shutdown();
+    meshlets.shutdown();
+    gltf_mesh_offsets.shutdown();
+    meshes.shutdown();
+
+    node_levels.shutdown();
+    node_parents.shutdown();
+    visit_order.shutdown();
+    nodes_to_visit.shutdown();
+
+    for ( u32 buffer_index = 0; buffer_index < buffers_data.size; ++buffer_index ) {
+        if ( buffers_data[ buffer_index ].data ) {
+            rfree( buffers_data[ buffer_index ].data, allocator );
+        }
+    }
+    buffers_data.shutdown();
+    source_paths.shutdown();
+    sources.shutdown();
+
+    gltf_free( gltf_scene );
+
+    i64 end_writing_blob = time_now();
+
+    // Write to a temporary file and rename it, a partial blob is never mapped.
+    bool written = false;
+    if ( cache_path ) {
+        char temp_path[ k_max_path ];
+        snprintf( temp_path, k_max_path, "%s.tmp", cache_path );
+
+        FILE* file = fopen( temp_path, "wb" );
+        if ( file ) {
+            written = fwrite( serializer.blob_memory, written_size, 1, file ) == 1;
+            fclose( file );
+
+            file_delete( cache_path );
+            written = written && rename( temp_path, cache_path ) == 0;
+            if ( !written ) {
+                file_delete( temp_path );
+            }
+        }
+
+        if ( !written ) {
+            rprint( "Cannot write scene blob %s\n", cache_path );
+        }
+    }
+
+    rprint( "Cooked scene %s in %f seconds, %llu KB.\n\tParsing GLTF %f seconds\n\tReading Buffers %f seconds\n\tBuilding Meshlets %f seconds\n\tWriting Blob %f seconds\n",
+            gltf_path, time_delta_seconds( start_cooking, time_now() ), ( u64 )( written_size / 1024 ),
+            time_delta_seconds( start_cooking, end_parsing ), time_delta_seconds( end_parsing, end_reading_buffers ),
+            time_delta_seconds( end_reading_buffers, end_building_meshlets ), time_delta_seconds( end_building_meshlets, end_writing_blob ) );
+
+    if ( written && load( cache_path ) ) {
+        serializer.shutdown();
+        return true;
+    }
+
+    // Keep an aligned copy in memory, relative offsets make it position independent.
+    memory = ( char* )rallocaa( written_size, allocator, 64 );
+    memory_copy( memory, serializer.blob_memory, written_size );
+    serializer.shutdown();
+
+    blob = ( glTFSceneBlob* )memory;
+    blob_size = written_size;
+
+    return true;
+}
+
+void glTFSceneCache::shutdown() {
+    file_unmap( &mapping );
+
+    if ( memory ) {
+        rfree( memory, allocator );
+        memory = nullptr;
+    }
+
+    blob = nullptr;
+    blob_size = 0;
+}
+
+void gltf_scene_load_benchmark( cstring gltf_path, Allocator* allocator, enki::TaskScheduler* task_scheduler ) {
+    char cache_path[ k_max_path ];
+    snprintf( cache_path, k_max_path, "%s.blob", gltf_path );
+
+    // Json path, cooked in memory only, with serial and parallel meshlet building.
+    glTFSceneCache serial_cache;
+    i64 start = time_now();
+    serial_cache.cook( gltf_path, nullptr, allocator, nullptr );
+    const f64 json_ms = time_from_milliseconds( start );
+
+    glTFSceneCache parallel_cache;
+    start = time_now();
+    parallel_cache.cook( gltf_path, nullptr, allocator, task_scheduler );
+    const f64 parallel_json_ms = time_from_milliseconds( start );
+
+    const bool blobs_match = serial_cache.blob_size == parallel_cache.blob_size &&
+                             memcmp( serial_cache.blob, parallel_cache.blob, serial_cache.blob_size ) == 0;
+    serial_cache.shutdown();
+    parallel_cache.shutdown();
+
+    glTFSceneCache mapped_cache;
+    if ( mapped_cache.load( cache_path ) ) {
+        mapped_cache.shutdown();
+    }
+    else {
+        mapped_cache.cook( gltf_path, cache_path, allocator, task_scheduler );
+        mapped_cache.shutdown();
+    }
+
+    start = time_now();
+    const bool mapped = mapped_cache.load( cache_path );
+    const f64 map_ms = time_from_milliseconds( start );
+
+    if ( !mapped ) {
+        rprint( "glTF load benchmark: cannot map %s\n", cache_path );
+        return;
+    }
+
+    // Pages are loaded lazily, touch all of them to include the read.
+    start = time_now();
+    u64 checksum = 0;
+    const u8* blob_memory = ( const u8* )mapped_cache.blob;
+    for ( sizet offset = 0; offset < mapped_cache.blob_size; offset += 4096 ) {
+        checksum += blob_memory[ offset ];
+    }
+    const f64 touch_ms = time_from_milliseconds( start );
+
+    rprint( "glTF load benchmark %s, blob %llu KB, %u meshes, %u meshlets.\n", gltf_path, ( u64 )( mapped_cache.blob_size / 1024 ),
+            mapped_cache.blob->meshes.size, mapped_cache.blob->meshlets.size );
+    rprint( "Json path %8.2f ms | parse, buffer reads and meshlet building\n", json_ms );
+    rprint( "Parallel  %8.2f ms | meshlets on %u threads, %.2fx, blobs %s\n", parallel_json_ms,
+            task_scheduler ? task_scheduler->GetNumTaskThreads() : 1, json_ms / parallel_json_ms, blobs_match ? "match" : "MISMATCH" );
+    rprint( "Blob map  %8.2f ms | first touch of all pages %.2f ms (%llu), %.2fx\n", map_ms, touch_ms, checksum, json_ms / ( map_ms + touch_ms ) );
+
+    mapped_cache.shutdown();
+}
+
+} // namespace raptor
@@ -0,0 +1,260 @@
+#pragma once
+
+#include "graphics/render_scene.hpp"
+
+#include "foundation/blob.hpp"
+#include "foundation/relative_data_structures.hpp"
+#include "foundation/file.hpp"
+#include "foundation/memory.hpp"
+
+#include "external/enkiTS/TaskScheduler.h"
+
+namespace raptor {
+
+    // Bump when any of the structures below or the cooking code changes.
+    static const u32                    k_gltf_scene_blob_version = 2;
+
+    //
+    // Accessor resolved to a cooked buffer and a byte offset. Buffer is -1 for missing attributes.
+    struct SceneBlobAccessor {
+
+        i32                             buffer;
+        u32                             byte_offset;
+        u32                             count;
+        u32                             type;           // glTF::Accessor::Type
+    }; // struct SceneBlobAccessor
+
+    //
+    // File the blob was cooked from, compared with the disk to detect stale blobs.
+    struct SceneBlobSource {
+
+        RelativeString                  path;
+        u64                             size;
+        u64                             write_time;
+    }; // struct SceneBlobSource
+
+    //
+    // Images without uri are encoded in a range of a cooked buffer, as in .glb files.
+    struct SceneBlobImage {
+
+        RelativeString                  uri;
+        u32                             width;
+        u32                             height;
+        u32                             mip_levels;
+
+        i32                             buffer;         // -1 for image files.
+        u32                             byte_offset;
+        u32                             byte_length;
+    }; // struct SceneBlobImage
+
+    //
+    // Filter and wrap values are the glTF ones.
+    struct SceneBlobSampler {
+
+        i32                             min_filter;
+        i32                             mag_filter;
+        i32                             wrap_s;
+        i32                             wrap_t;
+    }; // struct SceneBlobSampler
+
+    //
+    //
+    struct SceneBlobTexture {
+
+        i32                             source;
+        i32                             sampler;
+    }; // struct SceneBlobTexture
+
+    //
+    // Raw vertex and index streams, uploaded as they are.
+    struct SceneBlobBuffer {
+
+        RelativeArray<u8>               data;
+    }; // struct SceneBlobBuffer
+
+    //
+    // Texture indices are glTF texture indices, -1 when not present.
+    struct SceneBlobMaterial {
+
+        f32                             base_color_factor[ 4 ];
+        f32                             emissive_factor[ 3 ];
+        f32                             metallic;
+        f32                             roughness;
+        f32                             occlusion;
+        f32                             alpha_cutoff;
+        u32                             flags;
+
+        i32                             diffuse_texture;
+        i32                             roughness_texture;
+        i32                             normal_texture;
+        i32                             occlusion_texture;
+        i32                             emissive_texture;
+    }; // struct SceneBlobMaterial
+
+    //
+    // One glTF primitive. Meshlet offsets are relative to the blob meshlets.
+    struct SceneBlobMesh {
+
+        SceneBlobAccessor               position;
+        SceneBlobAccessor               tangent;
+        SceneBlobAccessor               normal;
+        SceneBlobAccessor               texcoord;
+        SceneBlobAccessor               joints;
+        SceneBlobAccessor               weights;
+        SceneBlobAccessor               indices;
+
+        f32                             bounding_sphere[ 4 ];
+        i32                             material;
+
+        u32                             meshlet_offset;
+        u32                             meshlet_count;
+        u32                             meshlet_index_count;
+    }; // struct SceneBlobMesh
+
+    //
+    // Nodes are stored in glTF order, parent and level are already resolved.
+    struct SceneBlobNode {
+
+        f32                             local_matrix[ 16 ];
+        RelativeString                  name;
+
+        i32                             parent;
+        u32                             level;
+        i32                             mesh;
+        i32                             skin;
+    }; // struct SceneBlobNode
+
+    //
+    //
+    struct SceneBlobAnimationSampler {
+
+        SceneBlobAccessor               input;
+        SceneBlobAccessor               output;
+        u32                             interpolation;
+    }; // struct SceneBlobAnimationSampler
+
+    //
+    //
+    struct SceneBlobAnimation {
+
+        RelativeArray<AnimationChannel> channels;
+        RelativeArray<SceneBlobAnimationSampler> samplers;
+    }; // struct SceneBlobAnimation
+
+    //
+    //
+    struct SceneBlobSkin {
+
+        SceneBlobAccessor               inverse_bind_matrices;
+        u32                             skeleton_root_index;
+        RelativeArray<i32>              joints;
+    }; // struct SceneBlobSkin
+
+    //
+    // Cooked glTF scene: parsed json, buffers, materials, scene graph and meshlets in a single
+    // relocatable blob, so that loading is a file mapping without json parsing or meshlet building.
+    struct glTFSceneBlob : public Blob {
+
+        RelativeArray<SceneBlobSource>  sources;
+
+        RelativeArray<SceneBlobImage>   images;
+        RelativeArray<SceneBlobSampler> samplers;
+        RelativeArray<SceneBlobTexture> textures;
+        RelativeArray<SceneBlobBuffer>  buffers;
+        RelativeArray<SceneBlobMaterial> materials;
+
+        RelativeArray<SceneBlobMesh>    meshes;
+        RelativeArray<u32>              gltf_mesh_offsets;  // First primitive of each glTF mesh.
+
+        RelativeArray<SceneBlobNode>    nodes;
+        RelativeArray<i32>              visit_order;        // Nodes of the default scene, breadth first.
+        u32                             scene_node_count;   // Scene graph nodes to allocate.
+
+        RelativeArray<GpuMeshlet>       meshlets;
+        RelativeArray<u32>              meshlets_data;
+        RelativeArray<GpuMeshletVertexPosition> meshlets_vertex_positions;
+        RelativeArray<GpuMeshletVertexData> meshlets_vertex_data;
+        u32                             meshlets_index_count;
+
+        f32                             aabb_min[ 3 ];
+        f32                             aabb_max[ 3 ];
+
+        RelativeArray<SceneBlobAnimation> animations;
+        RelativeArray<SceneBlobSkin>    skins;
+    }; // struct glTFSceneBlob
+
+    //
+    // Meshlets and quantized vertices of one primitive. Vertices are written in place, at an offset
+    // known before building, while meshlets and their data are merged in primitive order afterwards.
+    struct MeshletBuildJob {
+
+        const f32*                      vertices        = nullptr;
+        const f32*                      normals         = nullptr;
+        const f32*                      tangents        = nullptr;
+        const f32*                      tex_coords      = nullptr;
+        const u16*                      indices         = nullptr;
+        u32                             vertex_count    = 0;
+        u32                             index_count     = 0;
+        u32                             vertex_offset   = 0;
+        u32                             mesh_index      = 0;
+
+        // Output, data offsets are relative to the primitive.
+        GpuMeshlet*                     meshlets        = nullptr;
+        u32*                            meshlets_data   = nullptr;
+        u32                             meshlet_count   = 0;    // Without the padding to 32 meshlets.
+        u32                             padded_meshlet_count = 0;
+        u32                             meshlets_data_count = 0;
+        u32                             meshlet_index_count = 0;
+        u32                             index_group_count = 0;
+
+        f32                             aabb_min[ 3 ];
+        f32                             aabb_max[ 3 ];
+    }; // struct MeshletBuildJob
+
+    //
+    // Builds a range of primitives. Each worker has a scratch arena, reset after each primitive,
+    // and an output arena kept until the merge.
+    struct MeshletBuildTask : public enki::ITaskSet {
+
+        static constexpr u32            k_max_threads   = 64;
+
+        void                            init( u32 num_threads, sizet scratch_size, sizet output_size );
+        void                            shutdown();
+
+        void                            ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) override;
+
+        MeshletBuildJob*                jobs            = nullptr;
+        GpuMeshletVertexPosition*       vertex_positions = nullptr;
+        GpuMeshletVertexData*           vertex_data     = nullptr;
+
+        VirtualArenaAllocator           scratch_arenas[ k_max_threads ];
+        VirtualArenaAllocator           output_arenas[ k_max_threads ];
+        u32                             num_threads     = 0;
+    }; // struct MeshletBuildTask
+
+    //
+    // Owner of a cooked scene, either mapped from disk or cooked in memory.
+    struct glTFSceneCache {
+
+        // Maps the blob if it exists, matches the blob version and all source files are unchanged.
+        bool                            load( cstring cache_path );
+        // Parses the glTF file, reads buffers and builds meshlets, on the task scheduler when not null.
+        // The output does not depend on the number of threads. The blob is written to cache_path,
+        // when not null, and mapped back.
+        bool                            cook( cstring gltf_path, cstring cache_path, Allocator* allocator, enki::TaskScheduler* task_scheduler );
+        void                            shutdown();
+
+        glTFSceneBlob*                  blob            = nullptr;
+        sizet                           blob_size       = 0;
+
+        FileMapping                     mapping;
+        char*                           memory          = nullptr;  // Used when the blob could not be written.
+        Allocator*                      allocator       = nullptr;
+
+    }; // struct glTFSceneCache
+
+    // Times the json path (parsing, buffer reads and meshlet building), serial and on the task scheduler,
+    // against mapping the cooked blob. Serial and parallel blobs are compared byte by byte.
+    void                                gltf_scene_load_benchmark( cstring gltf_path, Allocator* allocator, enki::TaskScheduler* task_scheduler );
+
+} // namespace raptor
@@ -7,6 +7,8 @@
 #include "foundation/hash_map.hpp"
 #include "foundation/process.hpp"
 #include "foundation/file.hpp"
+#include "foundation/numerics.hpp"
+#include "foundation/time.hpp"
 
 #if defined(_MSC_VER)
 #define WIN32_LEAN_AND_MEAN
@@ -63,6 +65,14 @@ namespace raptor {
 static void                 check_result( VkResult result );
 #define                     check( result ) RASSERTM( result == VK_SUCCESS, "Vulkan assert code %u, '%s'", result, string_VkResult( result ) )
 
+#if defined(RAPTOR_HANDLE_VALIDATION)
+#define                     set_handle_generation( handle, pool ) handle.generation = pool.get_generation( handle.index )
+#define                     check_handle( handle, pool ) RASSERTM( pool.is_valid( handle.index, handle.generation ), "Stale handle %u, generation %u current %u", handle.index, handle.generation, pool.get_generation( handle.index ) )
+#else
+#define                     set_handle_generation( handle, pool )
+#define                     check_handle( handle, pool )
+#endif // RAPTOR_HANDLE_VALIDATION
+
 // Device implementation //////////////////////////////////////////////////
 
 // Methods //////////////////////////////////////////////////////////////////////
@@ -249,11 +259,16 @@ bool GpuDevice::get_family_queue( VkPhysicalDevice physical_device ) {
     vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, queue_families );
 
     u32 family_index = 0;
-    VkBool32 surface_supported;
+    VkBool32 surface_supported = VK_FALSE;
     for ( ; family_index < queue_family_count; ++family_index ) {
         VkQueueFamilyProperties queue_family = queue_families[ family_index ];
         if ( queue_family.queueCount > 0 && queue_family.queueFlags & ( VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT ) ) {
-            vkGetPhysicalDeviceSurfaceSupportKHR( physical_device, family_index, vulkan_window_surface, &surface_supported);
+            // Without a surface any graphics queue will do.
+            if ( headless ) {
+                surface_supported = ( queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT ) ? VK_TRUE : VK_FALSE;
+            } else {
+                vkGetPhysicalDeviceSurfaceSupportKHR( physical_device, family_index, vulkan_window_surface, &surface_supported );
+            }
 
             if ( surface_supported ) {
                 vulkan_main_queue_family = family_index;
@@ -269,10 +284,11 @@ bool GpuDevice::get_family_queue( VkPhysicalDevice physical_device ) {
 
 void GpuDevice::init( const GpuDeviceCreation& creation ) {
 
-    rprint( "Gpu Device init\n" );
+    rprint( "Gpu Device init%s\n", creation.headless ? ", headless" : "" );
     // 1. Perform common code
     allocator = creation.allocator;
     temporary_allocator = creation.temporary_allocator;
+    headless = creation.headless;
 
     string_buffer.init( 1024 * 1024, creation.allocator );
 
@@ -282,13 +298,22 @@ void GpuDevice::init( const GpuDeviceCreation& creation ) {
 
     VkApplicationInfo application_info = { VK_STRUCTURE_TYPE_APPLICATION_INFO, nullptr, "Raptor Graphics Device", 1, "Raptor", 1, VK_MAKE_VERSION( 1, 2, 0 ) };
 
+    // Headless instances skip the surface extensions, so that they work without a display.
+    const char* instance_extensions[ ArraySize( s_requested_extensions ) ];
+    u32 instance_extension_count = 0;
+    for ( u32 e = 0; e < ArraySize( s_requested_extensions ); ++e ) {
+        if ( !headless || strstr( s_requested_extensions[ e ], "surface" ) == nullptr ) {
+            instance_extensions[ instance_extension_count++ ] = s_requested_extensions[ e ];
+        }
+    }
+
     VkInstanceCreateInfo create_info = { VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO, nullptr, 0, &application_info,
 #if defined(VULKAN_DEBUG_REPORT)
                                          ArraySize( s_requested_layers ), s_requested_layers,
 #else
                                          0, nullptr,
 #endif
-                                         ArraySize( s_requested_extensions ), s_requested_extensions };
+                                         instance_extension_count, instance_extensions };
 #if defined(VULKAN_DEBUG_REPORT)
     const VkDebugUtilsMessengerCreateInfoEXT debug_create_info = create_debug_utils_messenger_info();
 
@@ -354,7 +379,8 @@ void GpuDevice::init( const GpuDeviceCreation& creation ) {
     //////// Create drawable surface
     // Create surface
     SDL_Window* window = ( SDL_Window* )creation.window;
-    if ( SDL_Vulkan_CreateSurface( window, vulkan_instance, &vulkan_window_surface ) == SDL_FALSE ) {
+    vulkan_window_surface = VK_NULL_HANDLE;
+    if ( !headless && SDL_Vulkan_CreateSurface( window, vulkan_instance, &vulkan_window_surface ) == SDL_FALSE ) {
         rprint( "Failed to create Vulkan surface.\n" );
     }
 
@@ -362,6 +388,7 @@ void GpuDevice::init( const GpuDeviceCreation& creation ) {
 
     VkPhysicalDevice discrete_gpu = VK_NULL_HANDLE;
     VkPhysicalDevice integrated_gpu = VK_NULL_HANDLE;
+    VkPhysicalDevice other_gpu = VK_NULL_HANDLE;
     for ( u32 i = 0; i < num_physical_device; ++i ) {
         VkPhysicalDevice physical_device = gpus[ i ];
         vkGetPhysicalDeviceProperties( physical_device, &vulkan_physical_properties );
@@ -384,12 +411,19 @@ void GpuDevice::init( const GpuDeviceCreation& creation ) {
 
             continue;
         }
+
+        // Software implementations such as lavapipe report a CPU device, used when nothing else is found.
+        if ( other_gpu == VK_NULL_HANDLE && get_family_queue( physical_device ) ) {
+            other_gpu = physical_device;
+        }
     }
 
     if ( discrete_gpu != VK_NULL_HANDLE ) {
         vulkan_physical_device = discrete_gpu;
     } else if ( integrated_gpu != VK_NULL_HANDLE ) {
         vulkan_physical_device = integrated_gpu;
+    } else if ( other_gpu != VK_NULL_HANDLE ) {
+        vulkan_physical_device = other_gpu;
     } else {
         RASSERTM( false, "Suitable GPU device not found!" );
         return;
@@ -563,7 +597,9 @@ void GpuDevice::init( const GpuDeviceCreation& creation ) {
 
     Array<const char*> device_extensions;
     device_extensions.init( temporary_allocator, 2 );
-    device_extensions.push( VK_KHR_SWAPCHAIN_EXTENSION_NAME );
+    if ( !headless ) {
+        device_extensions.push( VK_KHR_SWAPCHAIN_EXTENSION_NAME );
+    }
     device_extensions.push( VK_KHR_SHADER_DRAW_PARAMETERS_EXTENSION_NAME );
 
     if ( dynamic_rendering_extension_present ) {
@@ -693,6 +729,11 @@ void GpuDevice::init( const GpuDeviceCreation& creation ) {
 
     RASSERT( vulkan_11_features.shaderDrawParameters == VK_TRUE );
 
+    // NOTE: secondary command buffers can be executed while the pipeline statistics query is active.
+    inherited_queries_present = physical_features2.features.inheritedQueries;
+    // Cooked textures are BC compressed, loaders fall back to the source images without it.
+    texture_compression_bc_present = physical_features2.features.textureCompressionBC;
+
     VkDeviceCreateInfo device_create_info { VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
     device_create_info.queueCreateInfoCount = queue_count;
     device_create_info.pQueueCreateInfos = queue_info;
@@ -718,6 +759,9 @@ void GpuDevice::init( const GpuDeviceCreation& creation ) {
     if ( synchronization2_extension_present ) {
         vkQueueSubmit2KHR = ( PFN_vkQueueSubmit2KHR )vkGetDeviceProcAddr( vulkan_device, "vkQueueSubmit2KHR" );
         vkCmdPipelineBarrier2KHR = ( PFN_vkCmdPipelineBarrier2KHR )vkGetDeviceProcAddr( vulkan_device, "vkCmdPipelineBarrier2KHR" );
+        vkCmdSetEvent2KHR = ( PFN_vkCmdSetEvent2KHR )vkGetDeviceProcAddr( vulkan_device, "vkCmdSetEvent2KHR" );
+        vkCmdWaitEvents2KHR = ( PFN_vkCmdWaitEvents2KHR )vkGetDeviceProcAddr( vulkan_device, "vkCmdWaitEvents2KHR" );
+        vkCmdResetEvent2KHR = ( PFN_vkCmdResetEvent2KHR )vkGetDeviceProcAddr( vulkan_device, "vkCmdResetEvent2KHR" );
     }
 
     if ( mesh_shaders_extension_present ) {
@@ -778,19 +822,18 @@ void GpuDevice::init( const GpuDeviceCreation& creation ) {
         vkGetDeviceQueue( vulkan_device, transfer_queue_family_index, 0, &vulkan_transfer_queue );
     }
 
-    // Create Framebuffers
-    int window_width, window_height;
-    SDL_GetWindowSize( window, &window_width, &window_height );
-
     //// Select Surface Format
     //const TextureFormat::Enum swapchain_formats[] = { TextureFormat::B8G8R8A8_UNORM, TextureFormat::R8G8B8A8_UNORM, TextureFormat::B8G8R8X8_UNORM, TextureFormat::B8G8R8X8_UNORM };
     const VkFormat surface_image_formats[] = { VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_B8G8R8_UNORM, VK_FORMAT_R8G8B8_UNORM };
     const VkColorSpaceKHR surface_color_space = VK_COLORSPACE_SRGB_NONLINEAR_KHR;
 
-    u32 supported_count;
-    vkGetPhysicalDeviceSurfaceFormatsKHR( vulkan_physical_device, vulkan_window_surface, &supported_count, NULL );
-    VkSurfaceFormatKHR* supported_formats = ( VkSurfaceFormatKHR* )ralloca( sizeof( VkSurfaceFormatKHR ) * supported_count, temp_allocator );
-    vkGetPhysicalDeviceSurfaceFormatsKHR( vulkan_physical_device, vulkan_window_surface, &supported_count, supported_formats );
+    u32 supported_count = 0;
+    VkSurfaceFormatKHR* supported_formats = nullptr;
+    if ( !headless ) {
+        vkGetPhysicalDeviceSurfaceFormatsKHR( vulkan_physical_device, vulkan_window_surface, &supported_count, NULL );
+        supported_formats = ( VkSurfaceFormatKHR* )ralloca( sizeof( VkSurfaceFormatKHR ) * supported_count, temp_allocator );
+        vkGetPhysicalDeviceSurfaceFormatsKHR( vulkan_physical_device, vulkan_window_surface, &supported_count, supported_formats );
+    }
 
     // Cache render pass output
     swapchain_output.reset();
@@ -799,7 +842,14 @@ void GpuDevice::init( const GpuDeviceCreation& creation ) {
     bool format_found = false;
     const u32 surface_format_count = ArraySize( surface_image_formats );
 
-    for ( int i = 0; i < surface_format_count; i++ ) {
+    // Offscreen targets use the first format, mandatory as color attachment, and stay attachments after the final pass.
+    if ( headless ) {
+        vulkan_surface_format = { surface_image_formats[ 0 ], surface_color_space };
+        swapchain_output.color( surface_image_formats[ 0 ], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, RenderPassOperation::Clear );
+        format_found = true;
+    }
+
+    for ( int i = 0; i < surface_format_count && !format_found; i++ ) {
         for ( u32 j = 0; j < supported_count; j++ ) {
             if ( supported_formats[ j ].format == surface_image_formats[ i ] && supported_formats[ j ].colorSpace == surface_color_space ) {
                 vulkan_surface_format = supported_formats[ j ];
@@ -905,19 +955,16 @@ void GpuDevice::init( const GpuDeviceCreation& creation ) {
 
         vkCreateCommandPool( vulkan_device, &cmd_pool_info, vulkan_allocation_callbacks, &pool.vulkan_command_pool );
 
+        cmd_pool_info.queueFamilyIndex = vulkan_compute_queue_family;
+        vkCreateCommandPool( vulkan_device, &cmd_pool_info, vulkan_allocation_callbacks, &pool.vulkan_compute_command_pool );
+
         // Create timestamp query pool used for GPU timings.
         VkQueryPoolCreateInfo timestamp_pool_info{ VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO, nullptr, 0, VK_QUERY_TYPE_TIMESTAMP, creation.gpu_time_queries_per_frame * 2u, 0 };
         vkCreateQueryPool( vulkan_device, &timestamp_pool_info, vulkan_allocation_callbacks, &pool.vulkan_timestamp_query_pool );
 
         // Create pipeline statistics query pool
         VkQueryPoolCreateInfo statistics_pool_info{ VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO, nullptr, 0, VK_QUERY_TYPE_PIPELINE_STATISTICS, 7, 0 };
-        statistics_pool_info.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
-            VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
-            VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
-            VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
-            VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
-            VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
-            VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+        statistics_pool_info.pipelineStatistics = k_pipeline_statistics_flags;
         vkCreateQueryPool( vulkan_device, &statistics_pool_info, vulkan_allocation_callbacks, &pool.vulkan_pipeline_stats_query_pool);
     }
 
@@ -930,6 +977,8 @@ void GpuDevice::init( const GpuDeviceCreation& creation ) {
     descriptor_set_layouts.init( allocator, resource_pool_creation.descriptor_set_layouts, sizeof( DescriptorSetLayout ) );
     pipelines.init( allocator, resource_pool_creation.pipelines, sizeof( Pipeline ) );
     shaders.init( allocator, resource_pool_creation.shaders, sizeof( ShaderState ) );
+
+    pending_pipelines.init( allocator, 16 );
     descriptor_sets.init( allocator, resource_pool_creation.descriptor_sets, sizeof( DescriptorSet ) );
     samplers.init( allocator, resource_pool_creation.samplers, sizeof( Sampler ) );
     page_pools.init( allocator, resource_pool_creation.page_pools, sizeof( PagePool ) );
@@ -961,6 +1010,8 @@ void GpuDevice::init( const GpuDeviceCreation& creation ) {
         vkCreateSemaphore( vulkan_device, &semaphore_info, vulkan_allocation_callbacks, &vulkan_graphics_semaphore );
 
         vkCreateSemaphore( vulkan_device, &semaphore_info, vulkan_allocation_callbacks, &vulkan_compute_semaphore );
+
+        vkCreateSemaphore( vulkan_device, &semaphore_info, vulkan_allocation_callbacks, &vulkan_graphics_segment_semaphore );
     } else {
         vkCreateSemaphore( vulkan_device, &semaphore_info, vulkan_allocation_callbacks, &vulkan_compute_semaphore );
 
@@ -1021,18 +1072,12 @@ void GpuDevice::init( const GpuDeviceCreation& creation ) {
     BufferCreation dummy_constant_buffer_creation = { VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, ResourceUsageType::Immutable, 16, 0, 0, nullptr, "Dummy_cb" };
     dummy_constant_buffer = create_buffer( dummy_constant_buffer_creation );
 
-    // Get binaries path
-#if defined(_MSC_VER)
-    char* vulkan_env = string_buffer.reserve( 512 );
-    ExpandEnvironmentStringsA( "%VULKAN_SDK%", vulkan_env, 512 );
-    char* compiler_path = string_buffer.append_use_f( "%s\\Bin\\", vulkan_env );
-#else
-    char* vulkan_env = getenv ("VULKAN_SDK");
-    char* compiler_path = string_buffer.append_use_f( "%s/bin/", vulkan_env );
-#endif
+    // Device wide pipeline cache, saved back at shutdown.
+    snprintf( pipeline_cache_path, ArraySize( pipeline_cache_path ), "%s", creation.pipeline_cache_path ? creation.pipeline_cache_path : "" );
+    create_pipeline_cache( pipeline_cache_path );
 
-    strcpy( vulkan_binaries_path, compiler_path );
-    string_buffer.clear();
+    // Finds the Vulkan SDK binaries, used when glslang is not linked in.
+    shader_compiler.init();
 
     // [TAG: BINDLESS]
     // Bindless resources creation
@@ -1068,6 +1113,10 @@ void GpuDevice::shutdown() {
 
     vkDeviceWaitIdle( vulkan_device );
 
+    save_pipeline_cache( pipeline_cache_path );
+    vkDestroyPipelineCache( vulkan_device, vulkan_pipeline_cache, vulkan_allocation_callbacks );
+    pending_pipelines.shutdown();
+
     command_buffer_ring.shutdown();
 
     for ( size_t i = 0; i < k_max_frames; i++ ) {
@@ -1080,6 +1129,7 @@ void GpuDevice::shutdown() {
 
     if ( timeline_semaphore_extension_present ) {
         vkDestroySemaphore( vulkan_device, vulkan_graphics_semaphore, vulkan_allocation_callbacks );
+        vkDestroySemaphore( vulkan_device, vulkan_graphics_segment_semaphore, vulkan_allocation_callbacks );
     } else {
         vkDestroyFence( vulkan_device, vulkan_compute_fence, vulkan_allocation_callbacks );
     }
@@ -1206,7 +1256,9 @@ void GpuDevice::shutdown() {
 
     // Destroy swapchain
     destroy_swapchain();
-    vkDestroySurfaceKHR( vulkan_instance, vulkan_window_surface, vulkan_allocation_callbacks );
+    if ( !headless ) {
+        vkDestroySurfaceKHR( vulkan_instance, vulkan_window_surface, vulkan_allocation_callbacks );
+    }
 
     texture_to_update_bindless.shutdown();
     resource_deletion_queue.shutdown();
@@ -1250,6 +1302,7 @@ void GpuDevice::shutdown() {
         vkDestroyQueryPool( vulkan_device, pool.vulkan_timestamp_query_pool, vulkan_allocation_callbacks );
         vkDestroyQueryPool( vulkan_device, pool.vulkan_pipeline_stats_query_pool, vulkan_allocation_callbacks );
         vkDestroyCommandPool( vulkan_device, pool.vulkan_command_pool, vulkan_allocation_callbacks );
+        vkDestroyCommandPool( vulkan_device, pool.vulkan_compute_command_pool, vulkan_allocation_callbacks );
     }
 
     // Memory: this contains allocations for gpu timestamp memory, queued command buffers and render frames.
@@ -1265,6 +1318,8 @@ void GpuDevice::shutdown() {
 
     string_buffer.shutdown();
 
+    shader_compiler.shutdown();
+
     fragment_shading_rates.shutdown();
 
     rprint( "Gpu Device shutdown\n" );
@@ -1322,14 +1377,30 @@ static VkImageUsageFlags vulkan_get_image_usage( const TextureCreation& creation
     return usage;
 }
 
+static void vulkan_fill_image_info( const TextureCreation& creation, VkImageCreateInfo& image_info ) {
+
+    const bool is_cubemap = creation.type == TextureType::TextureCube || creation.type == TextureType::Texture_Cube_Array;
+    const bool is_sparse_texture = ( creation.flags & TextureFlags::Sparse_mask ) == TextureFlags::Sparse_mask;
+
+    image_info = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+    image_info.format = creation.format;
+    image_info.flags = ( is_cubemap ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0 ) | ( is_sparse_texture ? ( VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT | VK_IMAGE_CREATE_SPARSE_BINDING_BIT ) : 0 );
+    image_info.imageType = to_vk_image_type( creation.type );
+    image_info.extent.width = creation.width;
+    image_info.extent.height = creation.height;
+    image_info.extent.depth = creation.depth;
+    image_info.mipLevels = creation.mip_level_count;
+    image_info.arrayLayers = creation.array_layer_count;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = vulkan_get_image_usage( creation );
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
 static void vulkan_create_texture( GpuDevice& gpu, const TextureCreation& creation, TextureHandle handle, Texture* texture ) {
 
-    bool is_cubemap = false;
     u32 layer_count = creation.array_layer_count;
-    if ( creation.type == TextureType::TextureCube || creation.type == TextureType::Texture_Cube_Array ) {
-        is_cubemap = true;
-    }
-
     const bool is_sparse_texture = ( creation.flags & TextureFlags::Sparse_mask ) == TextureFlags::Sparse_mask;
 
     texture->width = creation.width;
@@ -1351,20 +1422,8 @@ static void vulkan_create_texture( GpuDevice& gpu, const TextureCreation& creati
     texture->alias_texture = k_invalid_texture;
 
     //// Create the image
-    VkImageCreateInfo image_info = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
-    image_info.format = texture->vk_format;
-    image_info.flags = ( is_cubemap ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0 ) | ( is_sparse_texture ? ( VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT | VK_IMAGE_CREATE_SPARSE_BINDING_BIT ) : 0 );
-    image_info.imageType = to_vk_image_type( texture->type );
-    image_info.extent.width = creation.width;
-    image_info.extent.height = creation.height;
-    image_info.extent.depth = creation.depth;
-    image_info.mipLevels = creation.mip_level_count;
-    image_info.arrayLayers = layer_count;
-    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
-    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
-    image_info.usage = texture->vk_usage;
-    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageCreateInfo image_info;
+    vulkan_fill_image_info( creation, image_info );
 
     VmaAllocationCreateInfo memory_info{};
     memory_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
@@ -1414,7 +1473,10 @@ static void upload_texture_data( Texture* texture, void* upload_data, GpuDevice&
     VkBufferCreateInfo buffer_info{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
     buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
 
-    u32 image_size = texture->width * texture->height * 4;
+    // Block compressed data has all the mips packed from the base level, other formats generate them.
+    const bool block_compressed = TextureFormat::is_block_compressed( texture->vk_format );
+    const u32 uploaded_mips = block_compressed ? texture->mip_level_count : 1;
+    const sizet image_size = block_compressed ? TextureFormat::block_compressed_size( texture->vk_format, texture->width, texture->height, uploaded_mips ) : texture->width * texture->height * 4;
     buffer_info.size = image_size;
 
     VmaAllocationCreateInfo memory_info{};
@@ -1441,32 +1503,47 @@ static void upload_texture_data( Texture* texture, void* upload_data, GpuDevice&
     CommandBuffer* command_buffer = gpu.get_command_buffer( 0, gpu.current_frame, false );
     vkBeginCommandBuffer( command_buffer->vk_command_buffer, &beginInfo );
 
-    VkBufferImageCopy region = {};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
+    VkBufferImageCopy regions[ 16 ];
+    RASSERT( uploaded_mips <= ArraySize( regions ) );
 
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
+    sizet mip_offset = 0;
+    for ( u32 mip = 0; mip < uploaded_mips; ++mip ) {
+        const u32 mip_width = max( texture->width >> mip, 1 );
+        const u32 mip_height = max( texture->height >> mip, 1 );
 
-    region.imageOffset = { 0, 0, 0 };
-    region.imageExtent = { texture->width, texture->height, texture->depth };
+        VkBufferImageCopy& region = regions[ mip ];
+        region = {};
+        region.bufferOffset = mip_offset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = mip;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+
+        region.imageOffset = { 0, 0, 0 };
+        region.imageExtent = { mip_width, mip_height, texture->depth };
+
+        if ( block_compressed ) {
+            mip_offset += TextureFormat::block_compressed_size( texture->vk_format, mip_width, mip_height );
+        }
+    }
 
     // Copy from the staging buffer to the image
-    util_add_image_barrier( &gpu, command_buffer->vk_command_buffer, texture->vk_image, RESOURCE_STATE_UNDEFINED, RESOURCE_STATE_COPY_DEST, 0, 1, false );
+    util_add_image_barrier( &gpu, command_buffer->vk_command_buffer, texture->vk_image, RESOURCE_STATE_UNDEFINED, RESOURCE_STATE_COPY_DEST, 0, uploaded_mips, false );
 
-    vkCmdCopyBufferToImage( command_buffer->vk_command_buffer, staging_buffer, texture->vk_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region );
+    vkCmdCopyBufferToImage( command_buffer->vk_command_buffer, staging_buffer, texture->vk_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, uploaded_mips, regions );
     // Prepare first mip to create lower mipmaps
-    if ( texture->mip_level_count > 1 ) {
+    const bool generate_mips = texture->mip_level_count > uploaded_mips;
+    if ( generate_mips ) {
         util_add_image_barrier( &gpu, command_buffer->vk_command_buffer, texture->vk_image, RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_COPY_SOURCE, 0, 1, false );
     }
 
     i32 w = texture->width;
     i32 h = texture->height;
 
-    for ( int mip_index = 1; mip_index < texture->mip_level_count; ++mip_index ) {
+    for ( int mip_index = uploaded_mips; mip_index < texture->mip_level_count; ++mip_index ) {
         util_add_image_barrier( &gpu, command_buffer->vk_command_buffer, texture->vk_image, RESOURCE_STATE_UNDEFINED, RESOURCE_STATE_COPY_DEST, mip_index, 1, false );
 
         VkImageBlit blit_region{ };
@@ -1496,7 +1573,7 @@ static void upload_texture_data( Texture* texture, void* upload_data, GpuDevice&
     }
 
     // Transition
-    util_add_image_barrier( &gpu, command_buffer->vk_command_buffer, texture->vk_image, ( texture->mip_level_count > 1 ) ? RESOURCE_STATE_COPY_SOURCE : RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_SHADER_RESOURCE, 0, texture->mip_level_count, false );
+    util_add_image_barrier( &gpu, command_buffer->vk_command_buffer, texture->vk_image, generate_mips ? RESOURCE_STATE_COPY_SOURCE : RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_SHADER_RESOURCE, 0, texture->mip_level_count, false );
     texture->state = RESOURCE_STATE_SHADER_RESOURCE;
 
     vkEndCommandBuffer( command_buffer->vk_command_buffer );
@@ -1533,6 +1610,7 @@ TextureHandle GpuDevice::create_texture( const TextureCreation& creation ) {
     if ( resource_index == k_invalid_index ) {
         return handle;
     }
+    set_handle_generation( handle, textures );
 
     resource_tracker.track_create_resource( ResourceUpdateType::Texture, resource_index, creation.name );
 
@@ -1554,6 +1632,7 @@ TextureHandle GpuDevice::create_texture_view( const TextureViewCreation& creatio
     if ( resource_index == k_invalid_index ) {
         return handle;
     }
+    set_handle_generation( handle, textures );
 
     resource_tracker.track_create_resource( ResourceUpdateType::Texture, resource_index, creation.name );
 
@@ -1608,74 +1687,35 @@ void dump_shader_code( StringBuffer& temp_string_buffer, cstring code, VkShaderS
     }
 }
 
-VkShaderModuleCreateInfo GpuDevice::compile_shader( cstring code, u32 code_size, VkShaderStageFlagBits stage, cstring name ) {
+VkShaderModuleCreateInfo GpuDevice::compile_shader( cstring code, u32 code_size, VkShaderStageFlagBits stage, cstring name, bool use_cache ) {
 
     VkShaderModuleCreateInfo shader_create_info = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
 
-    // Compile from glsl to SpirV.
+    // Compile from glsl to SpirV, reading the content addressed cache first.
     // TODO: detect if input is HLSL.
-    const char* temp_filename = "temp.shader";
-
-    // Write current shader to file.
-    FILE* temp_shader_file = fopen( temp_filename, "w" );
-    fwrite( code, code_size, 1, temp_shader_file );
-    fclose( temp_shader_file );
-
-    sizet current_marker = temporary_allocator->get_marker();
-    StringBuffer temp_string_buffer;
-    temp_string_buffer.init( rkilo( 1 ), temporary_allocator );
-
-    // Add uppercase define as STAGE_NAME
-    char* stage_define = temp_string_buffer.append_use_f( "%s_%s", to_stage_defines( stage ), name );
-    sizet stage_define_length = strlen( stage_define );
-    for ( u32 i = 0; i < stage_define_length; ++i ) {
-        stage_define[ i ] = toupper( stage_define[ i ] );
-    }
-    // Compile to SPV
-#if defined(_MSC_VER)
-    char* glsl_compiler_path = temp_string_buffer.append_use_f( "%sglslangValidator.exe", vulkan_binaries_path );
-    char* final_spirv_filename = temp_string_buffer.append_use( "shader_final.spv" );
-    // TODO: add optional debug information in shaders (option -g).
-    char* arguments = temp_string_buffer.append_use_f( "glslangValidator.exe %s -V --target-env vulkan1.2 -o %s -S %s --D %s --D %s", temp_filename, final_spirv_filename, to_compiler_extension( stage ), stage_define, to_stage_defines( stage ) );
-#else
-    char* glsl_compiler_path = temp_string_buffer.append_use_f( "%sglslangValidator", vulkan_binaries_path );
-    char* final_spirv_filename = temp_string_buffer.append_use( "shader_final.spv" );
-    char* arguments = temp_string_buffer.append_use_f( "%s -V --target-env vulkan1.2 -o %s -S %s --D %s --D %s", temp_filename, final_spirv_filename, to_compiler_extension( stage ), stage_define, to_stage_defines( stage ) );
-#endif
-    process_execute( ".", glsl_compiler_path, arguments, "" );
-
-    bool optimize_shaders = false;
-
-    if ( optimize_shaders ) {
-        // TODO: add optional optimization stage
-        //"spirv-opt -O input -o output
-        char* spirv_optimizer_path = temp_string_buffer.append_use_f( "%sspirv-opt.exe", vulkan_binaries_path );
-        char* optimized_spirv_filename = temp_string_buffer.append_use_f( "shader_opt.spv" );
-        char* spirv_opt_arguments = temp_string_buffer.append_use_f( "spirv-opt.exe -O --preserve-bindings %s -o %s", final_spirv_filename, optimized_spirv_filename );
+    ShaderCompileResult result;
+    const bool compiled = use_cache ? shader_compiler.compile( code, code_size, stage, name, temporary_allocator, result )
+                                    : shader_compiler.compile_uncached( code, code_size, stage, name, temporary_allocator, result );
 
-        process_execute( ".", spirv_optimizer_path, spirv_opt_arguments, "" );
-
-        // Read back SPV file.
-        shader_create_info.pCode = reinterpret_cast< const u32* >( file_read_binary( optimized_spirv_filename, temporary_allocator, &shader_create_info.codeSize ) );
-
-        file_delete( optimized_spirv_filename );
+    if ( compiled ) {
+        shader_create_info.pCode = result.code;
+        shader_create_info.codeSize = result.code_size;
     } else {
-        // Read back SPV file.
-        shader_create_info.pCode = reinterpret_cast< const u32* >( file_read_binary( final_spirv_filename, temporary_allocator, &shader_create_info.codeSize ) );
-    }
+        // Handling compilation error
+        sizet current_marker = temporary_allocator->get_marker();
+        StringBuffer temp_string_buffer;
+        temp_string_buffer.init( rkilo( 1 ), temporary_allocator );
 
-    // Handling compilation error
-    if ( shader_create_info.pCode == nullptr ) {
         dump_shader_code( temp_string_buffer, code, stage, name );
-    }
 
-    // Temporary files cleanup
-    file_delete( temp_filename );
-    file_delete( final_spirv_filename );
+        temporary_allocator->free_marker( current_marker );
+    }
 
     return shader_create_info;
 }
 
+static_assert( k_max_specialization_constants == spirv::k_max_specialization_constants, "Shader state specialization storage mismatch" );
+
 ShaderStateHandle GpuDevice::create_shader_state( const ShaderStateCreation& creation ) {
 
     ShaderStateHandle handle = { k_invalid_index };
@@ -1689,6 +1729,7 @@ ShaderStateHandle GpuDevice::create_shader_state( const ShaderStateCreation& cre
     if ( handle.index == k_invalid_index ) {
         return handle;
     }
+    set_handle_generation( handle, shaders );
 
     resource_tracker.track_create_resource( ResourceUpdateType::ShaderState, handle.index, creation.name );
 
@@ -1740,10 +1781,11 @@ ShaderStateHandle GpuDevice::create_shader_state( const ShaderStateCreation& cre
             shader_stage_info.pName = "main";
             shader_stage_info.stage = stage.type;
 
-            // NOTE: this needs to be static because pipeline reference it.
-            static VkSpecializationInfo specialization_info;
-            static VkSpecializationMapEntry specialization_entries[ spirv::k_max_specialization_constants ];
-            static u32 specialization_data[ spirv::k_max_specialization_constants ];
+            // NOTE: stored in the shader state because pipelines reference it, possibly
+            // after other shaders are created when pipelines are batched.
+            VkSpecializationInfo& specialization_info = shader_state->specialization_info;
+            VkSpecializationMapEntry* specialization_entries = shader_state->specialization_entries;
+            u32* specialization_data = shader_state->specialization_data;
 
             // Add optional specialization constants.
             if ( shader_state->parse_result->specialization_constants_count ) {
@@ -1868,43 +1910,22 @@ ShaderStateHandle GpuDevice::create_shader_state( const ShaderStateCreation& cre
     return handle;
 }
 
-PipelineHandle GpuDevice::create_pipeline( const PipelineCreation& creation, const char* cache_path ) {
+void PipelineBatchTask::ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) {
+    for ( u32 i = range_.start; i < range_.end; ++i ) {
+        PendingPipeline& pending_pipeline = pipelines[ i ];
+        gpu->create_vulkan_pipeline( pending_pipeline.creation, pending_pipeline.handle, pending_pipeline.vk_render_pass );
+    }
+}
+
+PipelineHandle GpuDevice::create_pipeline( const PipelineCreation& creation ) {
     PipelineHandle handle = { pipelines.obtain_resource() };
     if ( handle.index == k_invalid_index ) {
         return handle;
     }
+    set_handle_generation( handle, pipelines );
 
     resource_tracker.track_create_resource( ResourceUpdateType::Pipeline, handle.index, creation.name );
 
-    VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
-    VkPipelineCacheCreateInfo pipeline_cache_create_info { VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
-
-    bool cache_exists = file_exists( cache_path );
-    if ( cache_path != nullptr && cache_exists ) {
-        FileReadResult read_result = file_read_binary( cache_path, allocator );
-
-        VkPipelineCacheHeaderVersionOne* cache_header = (VkPipelineCacheHeaderVersionOne*)read_result.data;
-
-        if ( cache_header->deviceID == vulkan_physical_properties.deviceID &&
-             cache_header->vendorID == vulkan_physical_properties.vendorID &&
-             memcmp( cache_header->pipelineCacheUUID, vulkan_physical_properties.pipelineCacheUUID, VK_UUID_SIZE ) == 0 )
-        {
-            pipeline_cache_create_info.initialDataSize = read_result.size;
-            pipeline_cache_create_info.pInitialData = read_result.data;
-        }
-        else
-        {
-            cache_exists = false;
-        }
-
-        check( vkCreatePipelineCache( vulkan_device, &pipeline_cache_create_info, vulkan_allocation_callbacks, &pipeline_cache ) );
-
-        allocator->deallocate( read_result.data );
-    }
-    else {
-        check( vkCreatePipelineCache( vulkan_device, &pipeline_cache_create_info, vulkan_allocation_callbacks, &pipeline_cache ) );
-    }
-
     ShaderStateHandle shader_state = create_shader_state( creation.shaders );
     if ( shader_state.index == k_invalid_index ) {
         // Shader did not compile.
@@ -1980,7 +2001,32 @@ PipelineHandle GpuDevice::create_pipeline( const PipelineCreation& creation, con
     pipeline->vk_pipeline_layout = pipeline_layout;
     pipeline->num_active_layouts = num_active_layouts;
 
-    // Create full pipeline
+    VkRenderPass vk_render_pass = VK_NULL_HANDLE;
+    if ( shader_state_data->graphics_pipeline && !dynamic_rendering_extension_present ) {
+        vk_render_pass = get_vulkan_render_pass( creation.render_pass, creation.name );
+    }
+
+    // Inside a batch the Vulkan pipeline is created by end_pipeline_batch.
+    if ( pipeline_batch_active ) {
+        PendingPipeline& pending_pipeline = pending_pipelines.push_use();
+        pending_pipeline.creation = creation;
+        pending_pipeline.handle = handle;
+        pending_pipeline.vk_render_pass = vk_render_pass;
+        snprintf( pending_pipeline.name, ArraySize( pending_pipeline.name ), "%s", creation.name ? creation.name : "" );
+
+        return handle;
+    }
+
+    create_vulkan_pipeline( creation, handle, vk_render_pass );
+    finalize_pipeline( handle, creation.name );
+
+    return handle;
+}
+
+void GpuDevice::create_vulkan_pipeline( const PipelineCreation& creation, PipelineHandle handle, VkRenderPass vk_render_pass ) {
+    Pipeline* pipeline = access_pipeline( handle );
+    ShaderState* shader_state_data = access_shader_state( pipeline->shader_state );
+
     if ( shader_state_data->graphics_pipeline ) {
         VkGraphicsPipelineCreateInfo pipeline_info = { VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
 
@@ -1990,7 +2036,7 @@ PipelineHandle GpuDevice::create_pipeline( const PipelineCreation& creation, con
         pipeline_info.pStages = shader_state_data->shader_stage_info;
         pipeline_info.stageCount = shader_state_data->active_shaders;
         //// PipelineLayout
-        pipeline_info.layout = pipeline_layout;
+        pipeline_info.layout = pipeline->vk_pipeline_layout;
 
         //// Vertex input
         VkPipelineVertexInputStateCreateInfo vertex_input_info = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
@@ -2157,7 +2203,7 @@ PipelineHandle GpuDevice::create_pipeline( const PipelineCreation& creation, con
 
             pipeline_info.pNext = &pipeline_rendering_create_info;
         } else {
-            pipeline_info.renderPass = get_vulkan_render_pass( creation.render_pass, creation.name );
+            pipeline_info.renderPass = vk_render_pass;
         }
 
         //// Dynamic states
@@ -2177,7 +2223,7 @@ PipelineHandle GpuDevice::create_pipeline( const PipelineCreation& creation, con
 
         pipeline_info.pDynamicState = &dynamic_state;
 
-        check( vkCreateGraphicsPipelines( vulkan_device, pipeline_cache, 1, &pipeline_info, vulkan_allocation_callbacks, &pipeline->vk_pipeline ) );
+        check( vkCreateGraphicsPipelines( vulkan_device, vulkan_pipeline_cache, 1, &pipeline_info, vulkan_allocation_callbacks, &pipeline->vk_pipeline ) );
 
         pipeline->vk_bind_point = VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_GRAPHICS;
     } else if ( shader_state_data->ray_tracing_pipeline ) {
@@ -2190,12 +2236,29 @@ PipelineHandle GpuDevice::create_pipeline( const PipelineCreation& creation, con
         pipeline_info.pLibraryInfo = nullptr;
         pipeline_info.pLibraryInterface = nullptr;
         pipeline_info.pDynamicState = nullptr;
-        pipeline_info.layout = pipeline_layout;
+        pipeline_info.layout = pipeline->vk_pipeline_layout;
 
-        check( vkCreateRayTracingPipelinesKHR( vulkan_device, VK_NULL_HANDLE, pipeline_cache, 1, &pipeline_info, vulkan_allocation_callbacks, &pipeline->vk_pipeline ) );
+        check( vkCreateRayTracingPipelinesKHR( vulkan_device, VK_NULL_HANDLE, vulkan_pipeline_cache, 1, &pipeline_info, vulkan_allocation_callbacks, &pipeline->vk_pipeline ) );
 
         pipeline->vk_bind_point = VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR;
+    } else {
+        VkComputePipelineCreateInfo pipeline_info{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+
+        pipeline_info.stage = shader_state_data->shader_stage_info[ 0 ];
+        pipeline_info.layout = pipeline->vk_pipeline_layout;
 
+        check( vkCreateComputePipelines( vulkan_device, vulkan_pipeline_cache, 1, &pipeline_info, vulkan_allocation_callbacks, &pipeline->vk_pipeline ) );
+
+        pipeline->vk_bind_point = VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_COMPUTE;
+    }
+}
+
+void GpuDevice::finalize_pipeline( PipelineHandle handle, cstring name ) {
+    Pipeline* pipeline = access_pipeline( handle );
+    ShaderState* shader_state_data = access_shader_state( pipeline->shader_state );
+
+    // Shader binding table needs the pipeline group handles.
+    if ( shader_state_data->ray_tracing_pipeline ) {
         u32 group_handle_size = ray_tracing_pipeline_properties.shaderGroupHandleSize;
         sizet shader_binding_table_size = group_handle_size * shader_state_data->active_shaders;
 
@@ -2216,34 +2279,125 @@ PipelineHandle GpuDevice::create_pipeline( const PipelineCreation& creation, con
         pipeline->shader_binding_table_miss = create_buffer( shader_binding_table_creation );
 
         temporary_allocator->free_marker( current_marker );
-    } else {
-        VkComputePipelineCreateInfo pipeline_info{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+    }
 
-        pipeline_info.stage = shader_state_data->shader_stage_info[ 0 ];
-        pipeline_info.layout = pipeline_layout;
+    set_resource_name( VK_OBJECT_TYPE_PIPELINE, ( u64 )pipeline->vk_pipeline, name );
+}
 
-        check( vkCreateComputePipelines( vulkan_device, pipeline_cache, 1, &pipeline_info, vulkan_allocation_callbacks, &pipeline->vk_pipeline ) );
+void GpuDevice::create_pipelines( const PipelineCreation* creations, u32 count, PipelineHandle* out_handles, enki::TaskScheduler* task_scheduler ) {
+    begin_pipeline_batch();
 
-        pipeline->vk_bind_point = VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_COMPUTE;
+    for ( u32 i = 0; i < count; ++i ) {
+        out_handles[ i ] = create_pipeline( creations[ i ] );
     }
 
-    if ( cache_path != nullptr && !cache_exists ) {
-        sizet cache_data_size = 0;
-        check( vkGetPipelineCacheData( vulkan_device, pipeline_cache, &cache_data_size, nullptr ) );
+    end_pipeline_batch( task_scheduler );
+}
+
+void GpuDevice::begin_pipeline_batch() {
+    RASSERTM( !pipeline_batch_active, "Pipeline batches cannot be nested" );
 
-        void* cache_data = allocator->allocate( cache_data_size, 64 );
-        check( vkGetPipelineCacheData( vulkan_device, pipeline_cache, &cache_data_size, cache_data ) );
+    pending_pipelines.clear();
+    pipeline_batch_active = true;
+}
 
-        file_write_binary( cache_path, cache_data, cache_data_size );
+void GpuDevice::end_pipeline_batch( enki::TaskScheduler* task_scheduler ) {
+    RASSERT( pipeline_batch_active );
+    pipeline_batch_active = false;
 
-        allocator->deallocate( cache_data );
+    if ( pending_pipelines.size == 0 ) {
+        return;
     }
 
-    vkDestroyPipelineCache( vulkan_device, pipeline_cache, vulkan_allocation_callbacks );
+    i64 begin_time = time_now();
 
-    set_resource_name( VK_OBJECT_TYPE_PIPELINE, ( u64 )pipeline->vk_pipeline, creation.name );
+    // Names were copied, creation names pointed to memory already freed.
+    for ( u32 i = 0; i < pending_pipelines.size; ++i ) {
+        pending_pipelines[ i ].creation.name = pending_pipelines[ i ].name;
+    }
 
-    return handle;
+    // The pipeline cache is internally synchronized, only the driver compilation runs on the workers.
+    PipelineBatchTask batch_task;
+    batch_task.gpu = this;
+    batch_task.pipelines = pending_pipelines.data;
+    batch_task.m_SetSize = pending_pipelines.size;
+
+    if ( task_scheduler ) {
+        task_scheduler->AddTaskSetToPipe( &batch_task );
+        task_scheduler->WaitforTask( &batch_task );
+    }
+    else {
+        batch_task.ExecuteRange( { 0, pending_pipelines.size }, 0 );
+    }
+
+    for ( u32 i = 0; i < pending_pipelines.size; ++i ) {
+        const PendingPipeline& pending_pipeline = pending_pipelines[ i ];
+        finalize_pipeline( pending_pipeline.handle, pending_pipeline.name );
+    }
+
+    rprint( "Created %u pipelines in %f ms on %u threads\n", pending_pipelines.size, time_from_milliseconds( begin_time ),
+            task_scheduler ? task_scheduler->GetNumTaskThreads() : 1 );
+
+    pending_pipelines.clear();
+}
+
+// Pipeline cache /////////////////////////////////////////////////////////
+void GpuDevice::create_pipeline_cache( cstring path ) {
+    VkPipelineCacheCreateInfo pipeline_cache_create_info{ VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+
+    FileReadResult read_result{ nullptr, 0 };
+    if ( path[ 0 ] && file_exists( path ) ) {
+        read_result = file_read_binary( path, allocator );
+    }
+
+    if ( read_result.data ) {
+        // Drivers reject foreign caches, but a mismatching one would still be parsed and then thrown away.
+        const VkPipelineCacheHeaderVersionOne* cache_header = ( const VkPipelineCacheHeaderVersionOne* )read_result.data;
+        const bool valid_header = read_result.size >= sizeof( VkPipelineCacheHeaderVersionOne ) &&
+                                  cache_header->headerSize >= sizeof( VkPipelineCacheHeaderVersionOne ) &&
+                                  cache_header->headerSize <= read_result.size &&
+                                  cache_header->headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                                  cache_header->vendorID == vulkan_physical_properties.vendorID &&
+                                  cache_header->deviceID == vulkan_physical_properties.deviceID &&
+                                  memcmp( cache_header->pipelineCacheUUID, vulkan_physical_properties.pipelineCacheUUID, VK_UUID_SIZE ) == 0;
+
+        if ( valid_header ) {
+            pipeline_cache_create_info.initialDataSize = read_result.size;
+            pipeline_cache_create_info.pInitialData = read_result.data;
+
+            rprint( "Loaded pipeline cache %s, %llu bytes\n", path, ( u64 )read_result.size );
+        } else {
+            rprint( "Discarding pipeline cache %s, written by a different device or driver\n", path );
+        }
+    }
+
+    check( vkCreatePipelineCache( vulkan_device, &pipeline_cache_create_info, vulkan_allocation_callbacks, &vulkan_pipeline_cache ) );
+
+    if ( read_result.data ) {
+        allocator->deallocate( read_result.data );
+    }
+}
+
+void GpuDevice::save_pipeline_cache( cstring path ) {
+    if ( path[ 0 ] == 0 || vulkan_pipeline_cache == VK_NULL_HANDLE ) {
+        return;
+    }
+
+    sizet cache_data_size = 0;
+    check( vkGetPipelineCacheData( vulkan_device, vulkan_pipeline_cache, &cache_data_size, nullptr ) );
+
+    void* cache_data = allocator->allocate( cache_data_size, 64 );
+    check( vkGetPipelineCacheData( vulkan_device, vulkan_pipeline_cache, &cache_data_size, cache_data ) );
+
+    FILE* file = fopen( path, "wb" );
+    if ( file ) {
+        fwrite( cache_data, cache_data_size, 1, file );
+        fclose( file );
+    } else {
+        rprint( "Cannot write pipeline cache %s\n", path );
+    }
+
+    allocator->deallocate( cache_data );
 }
 
 BufferHandle GpuDevice::create_buffer( const BufferCreation& creation ) {
@@ -2251,6 +2405,7 @@ BufferHandle GpuDevice::create_buffer( const BufferCreation& creation ) {
     if ( handle.index == k_invalid_index ) {
         return handle;
     }
+    set_handle_generation( handle, buffers );
 
     resource_tracker.track_create_resource( ResourceUpdateType::Buffer, handle.index, creation.name );
 
@@ -2325,6 +2480,7 @@ SamplerHandle GpuDevice::create_sampler( const SamplerCreation& creation ) {
     if ( handle.index == k_invalid_index ) {
         return handle;
     }
+    set_handle_generation( handle, samplers );
 
     resource_tracker.track_create_resource( ResourceUpdateType::Sampler, handle.index, creation.name );
 
@@ -2380,6 +2536,7 @@ DescriptorSetLayoutHandle GpuDevice::create_descriptor_set_layout( const Descrip
     if ( handle.index == k_invalid_index ) {
         return handle;
     }
+    set_handle_generation( handle, descriptor_set_layouts );
 
     resource_tracker.track_create_resource( ResourceUpdateType::DescriptorSetLayout, handle.index, creation.name );
 
@@ -2663,6 +2820,7 @@ DescriptorSetHandle GpuDevice::create_descriptor_set( const DescriptorSetCreatio
     if ( handle.index == k_invalid_index ) {
         return handle;
     }
+    set_handle_generation( handle, descriptor_sets );
 
     resource_tracker.track_create_resource( ResourceUpdateType::DescriptorSet, handle.index, creation.name );
 
@@ -2934,6 +3092,7 @@ RenderPassHandle GpuDevice::create_render_pass( const RenderPassCreation& creati
     if ( handle.index == k_invalid_index ) {
         return handle;
     }
+    set_handle_generation( handle, render_passes );
 
     resource_tracker.track_create_resource( ResourceUpdateType::RenderPass, handle.index, creation.name );
 
@@ -2969,6 +3128,7 @@ FramebufferHandle GpuDevice::create_framebuffer( const FramebufferCreation& crea
     if ( handle.index == k_invalid_index ) {
         return handle;
     }
+    set_handle_generation( handle, framebuffers );
 
     resource_tracker.track_create_resource( ResourceUpdateType::Framebuffer, handle.index, creation.name );
 
@@ -3004,6 +3164,7 @@ FramebufferHandle GpuDevice::create_framebuffer( const FramebufferCreation& crea
 
 void GpuDevice::destroy_buffer( BufferHandle buffer ) {
     if ( buffer.index < buffers.pool_size ) {
+        check_handle( buffer, buffers );
 
         resource_tracker.track_destroy_resource( ResourceUpdateType::Buffer, buffer.index );
 
@@ -3015,6 +3176,7 @@ void GpuDevice::destroy_buffer( BufferHandle buffer ) {
 
 void GpuDevice::destroy_texture( TextureHandle texture ) {
     if ( texture.index < textures.pool_size ) {
+        check_handle( texture, textures );
 
         resource_tracker.track_destroy_resource( ResourceUpdateType::Texture, texture.index );
 
@@ -3027,6 +3189,7 @@ void GpuDevice::destroy_texture( TextureHandle texture ) {
 
 void GpuDevice::destroy_pipeline( PipelineHandle pipeline ) {
     if ( pipeline.index < pipelines.pool_size ) {
+        check_handle( pipeline, pipelines );
 
         resource_tracker.track_destroy_resource( ResourceUpdateType::Pipeline, pipeline.index );
 
@@ -3055,6 +3218,7 @@ void GpuDevice::destroy_pipeline( PipelineHandle pipeline ) {
 
 void GpuDevice::destroy_sampler( SamplerHandle sampler ) {
     if ( sampler.index < samplers.pool_size ) {
+        check_handle( sampler, samplers );
 
         resource_tracker.track_destroy_resource( ResourceUpdateType::Sampler, sampler.index );
 
@@ -3066,6 +3230,7 @@ void GpuDevice::destroy_sampler( SamplerHandle sampler ) {
 
 void GpuDevice::destroy_descriptor_set_layout( DescriptorSetLayoutHandle descriptor_set_layout ) {
     if ( descriptor_set_layout.index < descriptor_set_layouts.pool_size ) {
+        check_handle( descriptor_set_layout, descriptor_set_layouts );
 
         resource_tracker.track_destroy_resource( ResourceUpdateType::DescriptorSetLayout, descriptor_set_layout.index );
 
@@ -3077,6 +3242,7 @@ void GpuDevice::destroy_descriptor_set_layout( DescriptorSetLayoutHandle descrip
 
 void GpuDevice::destroy_descriptor_set( DescriptorSetHandle descriptor_set ) {
     if ( descriptor_set.index < descriptor_sets.pool_size ) {
+        check_handle( descriptor_set, descriptor_sets );
 
         resource_tracker.track_destroy_resource( ResourceUpdateType::DescriptorSet, descriptor_set.index );
 
@@ -3088,6 +3254,7 @@ void GpuDevice::destroy_descriptor_set( DescriptorSetHandle descriptor_set ) {
 
 void GpuDevice::destroy_render_pass( RenderPassHandle render_pass ) {
     if ( render_pass.index < render_passes.pool_size ) {
+        check_handle( render_pass, render_passes );
 
         resource_tracker.track_destroy_resource( ResourceUpdateType::RenderPass, render_pass.index );
 
@@ -3099,6 +3266,7 @@ void GpuDevice::destroy_render_pass( RenderPassHandle render_pass ) {
 
 void GpuDevice::destroy_framebuffer( FramebufferHandle framebuffer ) {
     if ( framebuffer.index < framebuffers.pool_size ) {
+        check_handle( framebuffer, framebuffers );
 
         resource_tracker.track_destroy_resource( ResourceUpdateType::Framebuffer, framebuffer.index );
 
@@ -3110,6 +3278,7 @@ void GpuDevice::destroy_framebuffer( FramebufferHandle framebuffer ) {
 
 void GpuDevice::destroy_shader_state( ShaderStateHandle shader ) {
     if ( shader.index < shaders.pool_size ) {
+        check_handle( shader, shaders );
 
         resource_tracker.track_destroy_resource( ResourceUpdateType::ShaderState, shader.index );
 
@@ -3283,64 +3452,68 @@ constexpr const T& clamp( const T& v, const T& lo, const T& hi ) {
 
 void GpuDevice::create_swapchain() {
 
-    //// Check if surface is supported
-    // TODO: Windows only!
-    VkBool32 surface_supported;
-    vkGetPhysicalDeviceSurfaceSupportKHR( vulkan_physical_device, vulkan_main_queue_family, vulkan_window_surface, &surface_supported );
-    if ( surface_supported != VK_TRUE ) {
-        rprint( "Error no WSI support on physical device 0\n" );
-    }
+    Array<VkImage> swapchain_images;
 
-    VkSurfaceCapabilitiesKHR surface_capabilities;
-    vkGetPhysicalDeviceSurfaceCapabilitiesKHR( vulkan_physical_device, vulkan_window_surface, &surface_capabilities );
+    // Headless frames cycle through offscreen targets of the requested size instead.
+    if ( !headless ) {
+        //// Check if surface is supported
+        // TODO: Windows only!
+        VkBool32 surface_supported;
+        vkGetPhysicalDeviceSurfaceSupportKHR( vulkan_physical_device, vulkan_main_queue_family, vulkan_window_surface, &surface_supported );
+        if ( surface_supported != VK_TRUE ) {
+            rprint( "Error no WSI support on physical device 0\n" );
+        }
 
-    VkExtent2D swapchain_extent = surface_capabilities.currentExtent;
-    if ( swapchain_extent.width == UINT32_MAX ) {
-        swapchain_extent.width = clamp( swapchain_extent.width, surface_capabilities.minImageExtent.width, surface_capabilities.maxImageExtent.width );
-        swapchain_extent.height = clamp( swapchain_extent.height, surface_capabilities.minImageExtent.height, surface_capabilities.maxImageExtent.height );
-    }
+        VkSurfaceCapabilitiesKHR surface_capabilities;
+        vkGetPhysicalDeviceSurfaceCapabilitiesKHR( vulkan_physical_device, vulkan_window_surface, &surface_capabilities );
 
-    rprint( "Create swapchain %u %u - saved %u %u, min image %u\n", swapchain_extent.width, swapchain_extent.height, swapchain_width, swapchain_height, surface_capabilities.minImageCount );
+        VkExtent2D swapchain_extent = surface_capabilities.currentExtent;
+        if ( swapchain_extent.width == UINT32_MAX ) {
+            swapchain_extent.width = clamp( swapchain_extent.width, surface_capabilities.minImageExtent.width, surface_capabilities.maxImageExtent.width );
+            swapchain_extent.height = clamp( swapchain_extent.height, surface_capabilities.minImageExtent.height, surface_capabilities.maxImageExtent.height );
+        }
 
-    swapchain_width = ( u16 )swapchain_extent.width;
-    swapchain_height = ( u16 )swapchain_extent.height;
+        rprint( "Create swapchain %u %u - saved %u %u, min image %u\n", swapchain_extent.width, swapchain_extent.height, swapchain_width, swapchain_height, surface_capabilities.minImageCount );
 
-    //vulkan_swapchain_image_count = surface_capabilities.minImageCount + 2;
+        swapchain_width = ( u16 )swapchain_extent.width;
+        swapchain_height = ( u16 )swapchain_extent.height;
 
-    VkSwapchainCreateInfoKHR swapchain_create_info = {};
-    swapchain_create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-    swapchain_create_info.surface = vulkan_window_surface;
-    swapchain_create_info.minImageCount = vulkan_swapchain_image_count;
-    swapchain_create_info.imageFormat = vulkan_surface_format.format;
-    swapchain_create_info.imageExtent = swapchain_extent;
-    swapchain_create_info.clipped = VK_TRUE;
-    swapchain_create_info.imageArrayLayers = 1;
-    swapchain_create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-    swapchain_create_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    swapchain_create_info.preTransform = surface_capabilities.currentTransform;
-    swapchain_create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    swapchain_create_info.presentMode = vulkan_present_mode;
+        //vulkan_swapchain_image_count = surface_capabilities.minImageCount + 2;
 
-    VkResult result = vkCreateSwapchainKHR( vulkan_device, &swapchain_create_info, 0, &vulkan_swapchain );
-    check( result );
+        VkSwapchainCreateInfoKHR swapchain_create_info = {};
+        swapchain_create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+        swapchain_create_info.surface = vulkan_window_surface;
+        swapchain_create_info.minImageCount = vulkan_swapchain_image_count;
+        swapchain_create_info.imageFormat = vulkan_surface_format.format;
+        swapchain_create_info.imageExtent = swapchain_extent;
+        swapchain_create_info.clipped = VK_TRUE;
+        swapchain_create_info.imageArrayLayers = 1;
+        swapchain_create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        swapchain_create_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        swapchain_create_info.preTransform = surface_capabilities.currentTransform;
+        swapchain_create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+        swapchain_create_info.presentMode = vulkan_present_mode;
+
+        VkResult result = vkCreateSwapchainKHR( vulkan_device, &swapchain_create_info, 0, &vulkan_swapchain );
+        check( result );
+
+        //// Cache swapchain images
+        vkGetSwapchainImagesKHR( vulkan_device, vulkan_swapchain, &vulkan_swapchain_image_count, NULL );
+
+        swapchain_images.init( allocator, vulkan_swapchain_image_count, vulkan_swapchain_image_count );
+        vkGetSwapchainImagesKHR( vulkan_device, vulkan_swapchain, &vulkan_swapchain_image_count, swapchain_images.data );
+    }
 
     if ( swapchain_render_pass.index == k_invalid_index ) {
         RenderPassCreation swapchain_pass_creation = {};
         swapchain_pass_creation.set_name( "Swapchain" );
-        swapchain_pass_creation.add_attachment( vulkan_surface_format.format, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, RenderPassOperation::Clear );
+        swapchain_pass_creation.add_attachment( vulkan_surface_format.format, headless ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, RenderPassOperation::Clear );
         swapchain_pass_creation.set_depth_stencil_texture( VK_FORMAT_D32_SFLOAT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL );
         swapchain_pass_creation.set_depth_stencil_operations( RenderPassOperation::Clear, RenderPassOperation::Clear );
 
         swapchain_render_pass = create_render_pass( swapchain_pass_creation );
     }
 
-    //// Cache swapchain images
-    vkGetSwapchainImagesKHR( vulkan_device, vulkan_swapchain, &vulkan_swapchain_image_count, NULL );
-
-    Array<VkImage> swapchain_images;
-    swapchain_images.init( allocator, vulkan_swapchain_image_count, vulkan_swapchain_image_count );
-    vkGetSwapchainImagesKHR( vulkan_device, vulkan_swapchain, &vulkan_swapchain_image_count, swapchain_images.data );
-
     // Manually transition the texture
     VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
@@ -3351,6 +3524,7 @@ void GpuDevice::create_swapchain() {
 
     for ( u32 iv = 0; iv < vulkan_swapchain_image_count; iv++ ) {
         vulkan_swapchain_framebuffers[ iv ].index = framebuffers.obtain_resource();
+        set_handle_generation( vulkan_swapchain_framebuffers[ iv ], framebuffers );
         Framebuffer* vk_framebuffer = access_framebuffer( vulkan_swapchain_framebuffers[ iv ] );
 
         vk_framebuffer->render_pass = swapchain_render_pass;
@@ -3361,25 +3535,35 @@ void GpuDevice::create_swapchain() {
         vk_framebuffer->layers = 1;
 
         vk_framebuffer->num_color_attachments = 1;
-        vk_framebuffer->color_attachments[ 0 ].index = textures.obtain_resource();
-
-        resource_tracker.track_create_resource( ResourceUpdateType::Texture, vk_framebuffer->color_attachments[ 0 ].index, "swapchain" );
-
         vk_framebuffer->name = "Swapchain";
 
         vk_framebuffer->width = swapchain_width;
         vk_framebuffer->height = swapchain_height;
 
-        // Manual creation of texture
-        Texture* color = access_texture( vk_framebuffer->color_attachments[ 0 ] );
-        color->vk_image = swapchain_images[ iv ];
-        color->vk_format = vulkan_surface_format.format;
-        color->type = TextureType::Texture2D;
+        if ( headless ) {
+            TextureCreation color_texture_creation;
+            color_texture_creation.set_size( swapchain_width, swapchain_height, 1 ).set_flags( TextureFlags::RenderTarget_mask )
+                                  .set_format_type( vulkan_surface_format.format, TextureType::Texture2D ).set_name( "Offscreen_Texture" );
+            vk_framebuffer->color_attachments[ 0 ] = create_texture( color_texture_creation );
+        } else {
+            vk_framebuffer->color_attachments[ 0 ].index = textures.obtain_resource();
+            set_handle_generation( vk_framebuffer->color_attachments[ 0 ], textures );
+
+            resource_tracker.track_create_resource( ResourceUpdateType::Texture, vk_framebuffer->color_attachments[ 0 ].index, "swapchain" );
 
-        TextureViewCreation tvc;
-        tvc.set_mips( 0, 1 ).set_array( 0, 1 ).set_name( "framebuffer" ).set_view_type( VK_IMAGE_VIEW_TYPE_2D );
+            // Manual creation of texture
+            Texture* swapchain_color = access_texture( vk_framebuffer->color_attachments[ 0 ] );
+            swapchain_color->vk_image = swapchain_images[ iv ];
+            swapchain_color->vk_format = vulkan_surface_format.format;
+            swapchain_color->type = TextureType::Texture2D;
 
-        vulkan_create_texture_view( *this, tvc, color );
+            TextureViewCreation tvc;
+            tvc.set_mips( 0, 1 ).set_array( 0, 1 ).set_name( "framebuffer" ).set_view_type( VK_IMAGE_VIEW_TYPE_2D );
+
+            vulkan_create_texture_view( *this, tvc, swapchain_color );
+        }
+
+        Texture* color = access_texture( vk_framebuffer->color_attachments[ 0 ] );
 
         TextureCreation depth_texture_creation;
         depth_texture_creation.set_size( swapchain_width, swapchain_height, 1 ).set_format_type( VK_FORMAT_D32_SFLOAT, TextureType::Texture2D ).set_name( "DepthImage_Texture" );
@@ -3393,7 +3577,7 @@ void GpuDevice::create_swapchain() {
             vulkan_create_framebuffer( *this, vk_framebuffer );
         }
 
-        util_add_image_barrier( this, command_buffer->vk_command_buffer, color->vk_image, RESOURCE_STATE_UNDEFINED, RESOURCE_STATE_PRESENT, 0, 1, false );
+        util_add_image_barrier( this, command_buffer->vk_command_buffer, color->vk_image, RESOURCE_STATE_UNDEFINED, headless ? RESOURCE_STATE_RENDER_TARGET : RESOURCE_STATE_PRESENT, 0, 1, false );
     }
 
     vkEndCommandBuffer( command_buffer->vk_command_buffer );
@@ -3417,7 +3601,9 @@ void GpuDevice::create_swapchain() {
     }
     vkQueueWaitIdle( vulkan_main_queue );
 
-    swapchain_images.shutdown();
+    if ( !headless ) {
+        swapchain_images.shutdown();
+    }
 }
 
 void GpuDevice::destroy_swapchain() {
@@ -3430,6 +3616,13 @@ void GpuDevice::destroy_swapchain() {
         }
 
         for ( u32 a = 0; a < vk_framebuffer->num_color_attachments; ++a ) {
+            // Offscreen targets own their image and memory.
+            if ( headless ) {
+                resource_tracker.track_destroy_resource( ResourceUpdateType::Texture, vk_framebuffer->color_attachments[ a ].index );
+                destroy_texture_instant( vk_framebuffer->color_attachments[ a ].index );
+                continue;
+            }
+
             Texture* vk_texture = access_texture( vk_framebuffer->color_attachments[ a ] );
 
             vkDestroyImageView( vulkan_device, vk_texture->vk_image_view, vulkan_allocation_callbacks );
@@ -3450,7 +3643,9 @@ void GpuDevice::destroy_swapchain() {
         framebuffers.release_resource( vulkan_swapchain_framebuffers[ iv ].index );
     }
 
-    vkDestroySwapchainKHR( vulkan_device, vulkan_swapchain, vulkan_allocation_callbacks );
+    if ( !headless ) {
+        vkDestroySwapchainKHR( vulkan_device, vulkan_swapchain, vulkan_allocation_callbacks );
+    }
 }
 
 VkRenderPass GpuDevice::get_vulkan_render_pass( const RenderPassOutput& output, cstring name ) {
@@ -3472,9 +3667,13 @@ void GpuDevice::resize_swapchain() {
 
     vkDeviceWaitIdle( vulkan_device );
 
-    VkSurfaceCapabilitiesKHR surface_capabilities;
-    vkGetPhysicalDeviceSurfaceCapabilitiesKHR( vulkan_physical_device, vulkan_window_surface, &surface_capabilities );
-    VkExtent2D swapchain_extent = surface_capabilities.currentExtent;
+    // Offscreen targets take the size given to resize.
+    VkExtent2D swapchain_extent = { swapchain_width, swapchain_height };
+    if ( !headless ) {
+        VkSurfaceCapabilitiesKHR surface_capabilities;
+        vkGetPhysicalDeviceSurfaceCapabilitiesKHR( vulkan_physical_device, vulkan_window_surface, &surface_capabilities );
+        swapchain_extent = surface_capabilities.currentExtent;
+    }
 
     // Skip zero-sized swapchain
     //rprint( "Requested swapchain resize %u %u\n", swapchain_extent.width, swapchain_extent.height );
@@ -3599,22 +3798,13 @@ void GpuDevice::resize_output_textures( FramebufferHandle framebuffer, u32 width
     }
 }
 
-void GpuDevice::resize_texture( TextureHandle texture, u32 width, u32 height ) {
+static void vulkan_recreate_texture( GpuDevice& gpu, TextureHandle texture, u32 width, u32 height, u32 depth, TextureHandle alias ) {
 
-   resize_texture_3d( texture, width, height, 1 );
-}
-
-void GpuDevice::resize_texture_3d( TextureHandle texture, u32 width, u32 height, u32 depth ) {
-
-    Texture* vk_texture = access_texture( texture );
-
-    if ( vk_texture->width == width && vk_texture->height == height && vk_texture->depth == depth ) {
-        return;
-    }
+    Texture* vk_texture = gpu.access_texture( texture );
 
     // Queue deletion of texture by creating a temporary one
-    TextureHandle texture_to_delete = { textures.obtain_resource() };
-    Texture* vk_texture_to_delete = access_texture( texture_to_delete );
+    TextureHandle texture_to_delete = { gpu.textures.obtain_resource() };
+    Texture* vk_texture_to_delete = gpu.access_texture( texture_to_delete );
 
     // Cache all informations (image, image view, flags, ...) into texture to delete.
     // Missing even one information (like it is a texture view, sparse, ...)
@@ -3628,10 +3818,31 @@ void GpuDevice::resize_texture_3d( TextureHandle texture, u32 width, u32 height,
     TextureCreation tc;
     tc.set_flags( vk_texture->flags ).set_format_type( vk_texture->vk_format, vk_texture->type )
       .set_name( vk_texture->name ).set_size( width, height, depth )
-      .set_mips( vk_texture->mip_level_count );
-    vulkan_create_texture( *this, tc, vk_texture->handle, vk_texture );
+      .set_mips( vk_texture->mip_level_count ).set_alias( alias );
+    vulkan_create_texture( gpu, tc, vk_texture->handle, vk_texture );
+
+    gpu.destroy_texture( texture_to_delete );
+}
+
+void GpuDevice::resize_texture( TextureHandle texture, u32 width, u32 height ) {
+
+   resize_texture_3d( texture, width, height, 1 );
+}
+
+void GpuDevice::resize_texture_3d( TextureHandle texture, u32 width, u32 height, u32 depth ) {
+
+    Texture* vk_texture = access_texture( texture );
+
+    if ( vk_texture->width == width && vk_texture->height == height && vk_texture->depth == depth ) {
+        return;
+    }
+
+    vulkan_recreate_texture( *this, texture, width, height, depth, k_invalid_texture );
+}
 
-    destroy_texture( texture_to_delete );
+void GpuDevice::resize_aliased_texture( TextureHandle texture, u32 width, u32 height, TextureHandle alias ) {
+    // Always recreated, the memory of the previous alias could be going away even if the size is the same.
+    vulkan_recreate_texture( *this, texture, width, height, 1, alias );
 }
 
 PagePoolHandle GpuDevice::allocate_texture_pool( TextureHandle texture_handle, u32 pool_size ) {
@@ -3648,6 +3859,7 @@ PagePoolHandle GpuDevice::allocate_texture_pool( TextureHandle texture_handle, u
         return pool_handle;
     }
     pool_handle.index = pool_index;
+    set_handle_generation( pool_handle, page_pools );
 
     PagePool* page_pool = access_page_pool( pool_handle );
 
@@ -3720,6 +3932,7 @@ PagePoolHandle GpuDevice::allocate_texture_pool( TextureHandle texture_handle, u
 
 void GpuDevice::destroy_page_pool( PagePoolHandle pool_handle ) {
     if ( pool_handle.index < page_pools.pool_size ) {
+        check_handle( pool_handle, page_pools );
 
         //resource_tracker.track_destroy_resource( ResourceUpdateType::PagePool, pool_handle.index );
 
@@ -3871,9 +4084,14 @@ void GpuDevice::new_frame() {
         vkResetFences( vulkan_device, fence_count, fences );
     }
 
-    VkResult result = vkAcquireNextImageKHR( vulkan_device, vulkan_swapchain, UINT64_MAX, vulkan_image_acquired_semaphore, VK_NULL_HANDLE, &vulkan_image_index );
-    if ( result == VK_ERROR_OUT_OF_DATE_KHR ) {
-        resize_swapchain();
+    if ( headless ) {
+        // The frame fence or timeline wait above covers the reuse of the target.
+        vulkan_image_index = ( vulkan_image_index + 1 ) % vulkan_swapchain_image_count;
+    } else {
+        VkResult result = vkAcquireNextImageKHR( vulkan_device, vulkan_swapchain, UINT64_MAX, vulkan_image_acquired_semaphore, VK_NULL_HANDLE, &vulkan_image_index );
+        if ( result == VK_ERROR_OUT_OF_DATE_KHR ) {
+            resize_swapchain();
+        }
     }
 
     // Command pool reset
@@ -3908,10 +4126,12 @@ void GpuDevice::new_frame() {
 void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
 
     VkSemaphore* render_complete_semaphore = &vulkan_render_complete_semaphore[ current_frame ];
+    // Headless frames are not presented, so the render complete semaphore, first of the signals, is skipped.
+    const u32 first_signal = headless ? 1 : 0;
 
     // Copy all commands
-    VkCommandBuffer enqueued_command_buffers[ 4 ];
-    RASSERT( num_queued_command_buffers < 4 );
+    VkCommandBuffer enqueued_command_buffers[ k_max_queued_command_buffers ];
+    RASSERT( num_queued_command_buffers <= k_max_queued_command_buffers );
     for ( u32 c = 0; c < num_queued_command_buffers; c++ ) {
 
         CommandBuffer* command_buffer = queued_command_buffers[ c ];
@@ -3922,13 +4142,21 @@ void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
         command_buffer->end_current_render_pass();
 
         // If marker are present, then queries are as well.
-        if ( command_buffer->thread_frame_pool->time_queries->allocated_time_query ) {
+        if ( command_buffer->thread_frame_pool->time_queries->allocated_time_query && command_buffer->statistics_query_active ) {
             vkCmdEndQuery( command_buffer->vk_command_buffer, command_buffer->thread_frame_pool->vulkan_pipeline_stats_query_pool, 0 );
         }
 
         vkEndCommandBuffer( command_buffer->vk_command_buffer );
         command_buffer->is_recording = false;
         command_buffer->current_render_pass = nullptr;
+        command_buffer->statistics_query_active = false;
+    }
+
+    for ( u32 c = 0; c < num_queued_compute_command_buffers; c++ ) {
+        CommandBuffer* command_buffer = queued_compute_command_buffers[ c ];
+
+        vkEndCommandBuffer( command_buffer->vk_command_buffer );
+        command_buffer->is_recording = false;
     }
 
     if ( texture_to_update_bindless.size ) {
@@ -4065,7 +4293,7 @@ void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
         bool wait_for_timeline_semaphore = absolute_frame >= k_max_frames;
 
         if ( synchronization2_extension_present ) {
-            VkCommandBufferSubmitInfoKHR command_buffer_info[ 4 ]{ };
+            VkCommandBufferSubmitInfoKHR command_buffer_info[ k_max_queued_command_buffers ]{ };
             for ( u32 c = 0; c < num_queued_command_buffers; c++ ) {
                 command_buffer_info[ c ].sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO_KHR;
                 command_buffer_info[ c ].commandBuffer = enqueued_command_buffers[ c ];
@@ -4073,7 +4301,9 @@ void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
 
             Array<VkSemaphoreSubmitInfoKHR> wait_semaphores;
             wait_semaphores.init( allocator, 4 );
-            wait_semaphores.push( { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, vulkan_image_acquired_semaphore, 0, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, 0 } );
+            if ( !headless ) {
+                wait_semaphores.push( { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, vulkan_image_acquired_semaphore, 0, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, 0 } );
+            }
 
             if ( wait_for_compute_semaphore ) {
                 wait_semaphores.push( { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, vulkan_compute_semaphore, last_compute_semaphore_value, VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR, 0 } );
@@ -4092,15 +4322,19 @@ void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
                 { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, vulkan_graphics_semaphore, absolute_frame + 1, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR , 0 }
             };
 
-            VkSubmitInfo2KHR submit_info{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2_KHR };
-            submit_info.waitSemaphoreInfoCount = wait_semaphores.size;
-            submit_info.pWaitSemaphoreInfos = wait_semaphores.data;
-            submit_info.commandBufferInfoCount = num_queued_command_buffers;
-            submit_info.pCommandBufferInfos = command_buffer_info;
-            submit_info.signalSemaphoreInfoCount = 2;
-            submit_info.pSignalSemaphoreInfos = signal_semaphores;
-
-            check( vkQueueSubmit2KHR( vulkan_main_queue, 1, &submit_info, VK_NULL_HANDLE ) );
+            if ( num_queued_compute_command_buffers ) {
+                submit_async_compute_frame( command_buffer_info, wait_semaphores.data, wait_semaphores.size, signal_semaphores + first_signal, 2 - first_signal );
+            } else {
+                VkSubmitInfo2KHR submit_info{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2_KHR };
+                submit_info.waitSemaphoreInfoCount = wait_semaphores.size;
+                submit_info.pWaitSemaphoreInfos = wait_semaphores.data;
+                submit_info.commandBufferInfoCount = num_queued_command_buffers;
+                submit_info.pCommandBufferInfos = command_buffer_info;
+                submit_info.signalSemaphoreInfoCount = 2 - first_signal;
+                submit_info.pSignalSemaphoreInfos = signal_semaphores + first_signal;
+
+                check( vkQueueSubmit2KHR( vulkan_main_queue, 1, &submit_info, VK_NULL_HANDLE ) );
+            }
 
             wait_semaphores.shutdown();
         } else {
@@ -4113,9 +4347,11 @@ void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
             Array<VkPipelineStageFlags> wait_stages;
             wait_stages.init( allocator, 4 );
 
-            wait_semaphores.push( vulkan_image_acquired_semaphore );
-            wait_values.push( 0 );
-            wait_stages.push( VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+            if ( !headless ) {
+                wait_semaphores.push( vulkan_image_acquired_semaphore );
+                wait_values.push( 0 );
+                wait_stages.push( VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+            }
 
             if ( wait_for_compute_semaphore ) {
                 wait_semaphores.push( vulkan_compute_semaphore );
@@ -4141,8 +4377,8 @@ void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
             // NOTE(marco): we still have to provide a value even for non-timeline semaphores
             u64 signal_values[] = { 0, absolute_frame + 1 };
             VkTimelineSemaphoreSubmitInfo semaphore_info{ VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
-            semaphore_info.signalSemaphoreValueCount = 2;
-            semaphore_info.pSignalSemaphoreValues = signal_values;
+            semaphore_info.signalSemaphoreValueCount = 2 - first_signal;
+            semaphore_info.pSignalSemaphoreValues = signal_values + first_signal;
 
             semaphore_info.waitSemaphoreValueCount = wait_values.size;
             semaphore_info.pWaitSemaphoreValues = wait_values.data;
@@ -4153,8 +4389,8 @@ void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
             submit_info.pWaitDstStageMask = wait_stages.data;
             submit_info.commandBufferCount = num_queued_command_buffers;
             submit_info.pCommandBuffers = enqueued_command_buffers;
-            submit_info.signalSemaphoreCount = 2;
-            submit_info.pSignalSemaphores = signal_semaphores;
+            submit_info.signalSemaphoreCount = 2 - first_signal;
+            submit_info.pSignalSemaphores = signal_semaphores + first_signal;
 
             submit_info.pNext = &semaphore_info;
 
@@ -4169,7 +4405,7 @@ void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
         VkFence render_complete_fence = vulkan_command_buffer_executed_fence[ current_frame ];
 
         if ( synchronization2_extension_present ) {
-            VkCommandBufferSubmitInfoKHR command_buffer_info[ 4 ]{ };
+            VkCommandBufferSubmitInfoKHR command_buffer_info[ k_max_queued_command_buffers ]{ };
             for ( u32 c = 0; c < num_queued_command_buffers; c++ ) {
                 command_buffer_info[ c ].sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO_KHR;
                 command_buffer_info[ c ].commandBuffer = enqueued_command_buffers[ c ];
@@ -4177,7 +4413,9 @@ void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
 
             Array<VkSemaphoreSubmitInfoKHR> wait_semaphores;
             wait_semaphores.init( allocator, 4 );
-            wait_semaphores.push( { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, vulkan_image_acquired_semaphore, 0, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, 0 } );
+            if ( !headless ) {
+                wait_semaphores.push( { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, vulkan_image_acquired_semaphore, 0, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, 0 } );
+            }
             wait_semaphores.push( { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, vulkan_compute_semaphore, 0, VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR, 0 } );
 
             if ( has_pending_sparse_bindings ) {
@@ -4193,7 +4431,7 @@ void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
             submit_info.pWaitSemaphoreInfos = wait_semaphores.data;
             submit_info.commandBufferInfoCount = num_queued_command_buffers;
             submit_info.pCommandBufferInfos = command_buffer_info;
-            submit_info.signalSemaphoreInfoCount = 1;
+            submit_info.signalSemaphoreInfoCount = 1 - first_signal;
             submit_info.pSignalSemaphoreInfos = signal_semaphores;
 
             check( vkQueueSubmit2KHR( vulkan_main_queue, 1, &submit_info, render_complete_fence ) );
@@ -4202,13 +4440,14 @@ void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
         } else {
             Array<VkSemaphore> wait_semaphores;
             wait_semaphores.init( allocator, 4 );
-            wait_semaphores.push( vulkan_image_acquired_semaphore );
-            wait_semaphores.push( vulkan_compute_semaphore );
-
             Array<VkPipelineStageFlags> wait_stages;
             wait_stages.init( allocator, 4 );
 
-            wait_stages.push( VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+            if ( !headless ) {
+                wait_semaphores.push( vulkan_image_acquired_semaphore );
+                wait_stages.push( VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+            }
+            wait_semaphores.push( vulkan_compute_semaphore );
             wait_stages.push( VK_PIPELINE_STAGE_VERTEX_INPUT_BIT );
 
             if ( has_pending_sparse_bindings ) {
@@ -4222,7 +4461,7 @@ void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
             submit_info.pWaitDstStageMask = wait_stages.data;
             submit_info.commandBufferCount = num_queued_command_buffers;
             submit_info.pCommandBuffers = enqueued_command_buffers;
-            submit_info.signalSemaphoreCount = 1;
+            submit_info.signalSemaphoreCount = 1 - first_signal;
             submit_info.pSignalSemaphores = render_complete_semaphore;
 
             check( vkQueueSubmit( vulkan_main_queue, 1, &submit_info, render_complete_fence ) );
@@ -4232,22 +4471,27 @@ void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
         }
     }
 
-    has_async_work = false;
+    // Frame graph nodes on the async compute queue also pace the frames.
+    has_async_work = num_queued_compute_command_buffers > 0;
+    num_queued_compute_command_buffers = 0;
 
     if ( async_compute_command_buffer != nullptr ) {
         submit_compute_load( async_compute_command_buffer );
     }
 
-    VkPresentInfoKHR present_info{ VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
-    present_info.waitSemaphoreCount = 1;
-    present_info.pWaitSemaphores = render_complete_semaphore;
+    VkResult result = VK_SUCCESS;
+    if ( !headless ) {
+        VkPresentInfoKHR present_info{ VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
+        present_info.waitSemaphoreCount = 1;
+        present_info.pWaitSemaphores = render_complete_semaphore;
 
-    VkSwapchainKHR swap_chains[] = { vulkan_swapchain };
-    present_info.swapchainCount = 1;
-    present_info.pSwapchains = swap_chains;
-    present_info.pImageIndices = &vulkan_image_index;
-    present_info.pResults = nullptr; // Optional
-    VkResult result = vkQueuePresentKHR( vulkan_main_queue, &present_info );
+        VkSwapchainKHR swap_chains[] = { vulkan_swapchain };
+        present_info.swapchainCount = 1;
+        present_info.pSwapchains = swap_chains;
+        present_info.pImageIndices = &vulkan_image_index;
+        present_info.pResults = nullptr; // Optional
+        result = vkQueuePresentKHR( vulkan_main_queue, &present_info );
+    }
 
     RASSERT( result != VK_ERROR_DEVICE_LOST );
 
@@ -4407,6 +4651,103 @@ void GpuDevice::present( CommandBuffer* async_compute_command_buffer ) {
     }
 }
 
+void GpuDevice::submit_async_compute_frame( VkCommandBufferSubmitInfoKHR* command_buffer_infos, VkSemaphoreSubmitInfoKHR* frame_waits, u32 num_frame_waits,
+                                            VkSemaphoreSubmitInfoKHR* frame_signals, u32 num_frame_signals ) {
+    // Each graphics command buffer is a segment of the frame: it signals the segment semaphore so
+    // that compute batches can start as soon as their inputs are written, and waits for the compute
+    // batches it consumes. The first segment carries the frame waits, the last one the frame signals.
+    const u64 base_compute_value = last_compute_semaphore_value;
+    const u64 base_segment_value = last_graphics_segment_value;
+
+    VkSubmitInfo2KHR submit_infos[ k_max_queued_command_buffers ]{ };
+    VkSemaphoreSubmitInfoKHR wait_semaphores[ k_max_queued_command_buffers ][ 8 ]{ };
+    VkSemaphoreSubmitInfoKHR signal_semaphores[ k_max_queued_command_buffers ][ 4 ]{ };
+
+    for ( u32 c = 0; c < num_queued_command_buffers; ++c ) {
+        CommandBuffer* command_buffer = queued_command_buffers[ c ];
+        u32 num_waits = 0;
+        u32 num_signals = 0;
+
+        if ( c == 0 ) {
+            RASSERT( num_frame_waits < 8 );
+            for ( u32 w = 0; w < num_frame_waits; ++w ) {
+                wait_semaphores[ c ][ num_waits ] = frame_waits[ w ];
+
+                // Graphics nodes can use the results of the previous frame compute batches before vertex input.
+                if ( frame_waits[ w ].semaphore == vulkan_compute_semaphore ) {
+                    wait_semaphores[ c ][ num_waits ].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR;
+                }
+                ++num_waits;
+            }
+        }
+
+        if ( command_buffer->queue_wait_count ) {
+            wait_semaphores[ c ][ num_waits++ ] = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, vulkan_compute_semaphore, base_compute_value + command_buffer->queue_wait_count, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, 0 };
+        }
+
+        signal_semaphores[ c ][ num_signals++ ] = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, vulkan_graphics_segment_semaphore, base_segment_value + c + 1, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, 0 };
+
+        if ( c == num_queued_command_buffers - 1 ) {
+            for ( u32 s = 0; s < num_frame_signals; ++s ) {
+                signal_semaphores[ c ][ num_signals++ ] = frame_signals[ s ];
+            }
+        }
+
+        VkSubmitInfo2KHR& submit_info = submit_infos[ c ];
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2_KHR;
+        submit_info.waitSemaphoreInfoCount = num_waits;
+        submit_info.pWaitSemaphoreInfos = wait_semaphores[ c ];
+        submit_info.commandBufferInfoCount = 1;
+        submit_info.pCommandBufferInfos = &command_buffer_infos[ c ];
+        submit_info.signalSemaphoreInfoCount = num_signals;
+        submit_info.pSignalSemaphoreInfos = signal_semaphores[ c ];
+    }
+
+    check( vkQueueSubmit2KHR( vulkan_main_queue, num_queued_command_buffers, submit_infos, VK_NULL_HANDLE ) );
+
+    // Compute batches wait for the graphics segment that produced their inputs, or for the previous
+    // frame when their inputs come from there.
+    VkSubmitInfo2KHR compute_submit_infos[ k_max_async_compute_command_buffers ]{ };
+    VkCommandBufferSubmitInfoKHR compute_command_buffer_infos[ k_max_async_compute_command_buffers ]{ };
+    VkSemaphoreSubmitInfoKHR compute_waits[ k_max_async_compute_command_buffers ][ 2 ]{ };
+    VkSemaphoreSubmitInfoKHR compute_signals[ k_max_async_compute_command_buffers ]{ };
+
+    for ( u32 i = 0; i < num_queued_compute_command_buffers; ++i ) {
+        CommandBuffer* command_buffer = queued_compute_command_buffers[ i ];
+        u32 num_waits = 0;
+
+        if ( command_buffer->queue_wait_count ) {
+            RASSERT( command_buffer->queue_wait_count <= num_queued_command_buffers );
+            compute_waits[ i ][ num_waits++ ] = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, vulkan_graphics_segment_semaphore, base_segment_value + command_buffer->queue_wait_count, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, 0 };
+        } else if ( absolute_frame > 0 ) {
+            compute_waits[ i ][ num_waits++ ] = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, vulkan_graphics_semaphore, absolute_frame, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, 0 };
+        }
+
+        if ( base_compute_value + i > 0 ) {
+            compute_waits[ i ][ num_waits++ ] = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, vulkan_compute_semaphore, base_compute_value + i, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, 0 };
+        }
+
+        compute_signals[ i ] = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, vulkan_compute_semaphore, base_compute_value + i + 1, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, 0 };
+
+        compute_command_buffer_infos[ i ].sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO_KHR;
+        compute_command_buffer_infos[ i ].commandBuffer = command_buffer->vk_command_buffer;
+
+        VkSubmitInfo2KHR& submit_info = compute_submit_infos[ i ];
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2_KHR;
+        submit_info.waitSemaphoreInfoCount = num_waits;
+        submit_info.pWaitSemaphoreInfos = compute_waits[ i ];
+        submit_info.commandBufferInfoCount = 1;
+        submit_info.pCommandBufferInfos = &compute_command_buffer_infos[ i ];
+        submit_info.signalSemaphoreInfoCount = 1;
+        submit_info.pSignalSemaphoreInfos = &compute_signals[ i ];
+    }
+
+    check( vkQueueSubmit2KHR( vulkan_compute_queue, num_queued_compute_command_buffers, compute_submit_infos, VK_NULL_HANDLE ) );
+
+    last_compute_semaphore_value += num_queued_compute_command_buffers;
+    last_graphics_segment_value += num_queued_command_buffers;
+}
+
 void GpuDevice::submit_compute_load( CommandBuffer* command_buffer ) {
     has_async_work = true;
 
@@ -4550,9 +4891,14 @@ void GpuDevice::set_present_mode( PresentMode::Enum mode ) {
     u32 supported_count = 0;
 
     static VkPresentModeKHR supported_mode_allocated[ 8 ];
-    vkGetPhysicalDeviceSurfacePresentModesKHR( vulkan_physical_device, vulkan_window_surface, &supported_count, NULL );
-    RASSERT( supported_count < 8 );
-    vkGetPhysicalDeviceSurfacePresentModesKHR( vulkan_physical_device, vulkan_window_surface, &supported_count, supported_mode_allocated );
+    if ( headless ) {
+        // Nothing is presented, frames never wait for a vertical blank.
+        supported_mode_allocated[ supported_count++ ] = to_vk_present_mode( mode );
+    } else {
+        vkGetPhysicalDeviceSurfacePresentModesKHR( vulkan_physical_device, vulkan_window_surface, &supported_count, NULL );
+        RASSERT( supported_count < 8 );
+        vkGetPhysicalDeviceSurfacePresentModesKHR( vulkan_physical_device, vulkan_window_surface, &supported_count, supported_mode_allocated );
+    }
 
     bool mode_found = false;
     VkPresentModeKHR requested_mode = to_vk_present_mode( mode );
@@ -4600,9 +4946,18 @@ VkDeviceAddress GpuDevice::get_buffer_device_address( BufferHandle handle ) {
 //
 void GpuDevice::queue_command_buffer( CommandBuffer* command_buffer ) {
 
+    RASSERT( num_queued_command_buffers < k_max_queued_command_buffers );
     queued_command_buffers[ num_queued_command_buffers++ ] = command_buffer;
 }
 
+//
+//
+void GpuDevice::queue_async_compute_command_buffer( CommandBuffer* command_buffer ) {
+
+    RASSERT( num_queued_compute_command_buffers < k_max_async_compute_command_buffers );
+    queued_compute_command_buffers[ num_queued_compute_command_buffers++ ] = command_buffer;
+}
+
 //
 //
 CommandBuffer* GpuDevice::get_command_buffer( u32 thread_index, u32 frame_index, bool begin ) {
@@ -4617,6 +4972,20 @@ CommandBuffer* GpuDevice::get_secondary_command_buffer( u32 thread_index, u32 fr
     return cb;
 }
 
+//
+//
+CommandBuffer* GpuDevice::get_segment_command_buffer( CommandBuffer* command_buffer ) {
+    CommandBuffer* cb = command_buffer_ring.get_segment_command_buffer( command_buffer );
+    return cb;
+}
+
+//
+//
+CommandBuffer* GpuDevice::get_compute_command_buffer( CommandBuffer* command_buffer ) {
+    CommandBuffer* cb = command_buffer_ring.get_compute_command_buffer( command_buffer );
+    return cb;
+}
+
 // Resource Description Query /////////////////////////////////////////////
 
 void GpuDevice::query_buffer( BufferHandle buffer, BufferDescription& out_description ) {
@@ -4649,6 +5018,17 @@ void GpuDevice::query_texture( TextureHandle texture, TextureDescription& out_de
     }
 }
 
+void GpuDevice::query_texture_memory_requirements( const TextureCreation& creation, VkMemoryRequirements& out_requirements ) {
+    // Requirements depend on the driver, create a temporary image without memory to ask for them.
+    VkImageCreateInfo image_info;
+    vulkan_fill_image_info( creation, image_info );
+
+    VkImage image;
+    check( vkCreateImage( vulkan_device, &image_info, vulkan_allocation_callbacks, &image ) );
+    vkGetImageMemoryRequirements( vulkan_device, image, &out_requirements );
+    vkDestroyImage( vulkan_device, image, vulkan_allocation_callbacks );
+}
+
 void GpuDevice::query_pipeline( PipelineHandle pipeline, PipelineDescription& out_description ) {
     if ( pipeline.index != k_invalid_index ) {
         const Pipeline* pipeline_data = access_pipeline( pipeline );
@@ -4792,50 +5172,62 @@ void GpuDevice::resize( u16 width, u16 height ) {
 
 // Resource Access ////////////////////////////////////////////////////////
 ShaderState* GpuDevice::access_shader_state( ShaderStateHandle shader ) {
+    check_handle( shader, shaders );
     return (ShaderState*)shaders.access_resource( shader.index );
 }
 
 const ShaderState* GpuDevice::access_shader_state( ShaderStateHandle shader ) const {
+    check_handle( shader, shaders );
     return (const ShaderState*)shaders.access_resource( shader.index );
 }
 
 Texture* GpuDevice::access_texture( TextureHandle texture ) {
+    check_handle( texture, textures );
     return (Texture*)textures.access_resource( texture.index );
 }
 
 const Texture * GpuDevice::access_texture( TextureHandle texture ) const {
+    check_handle( texture, textures );
     return (const Texture*)textures.access_resource( texture.index );
 }
 
 Buffer* GpuDevice::access_buffer( BufferHandle buffer ) {
+    check_handle( buffer, buffers );
     return (Buffer*)buffers.access_resource( buffer.index );
 }
 
 const Buffer* GpuDevice::access_buffer( BufferHandle buffer ) const {
+    check_handle( buffer, buffers );
     return (const Buffer*)buffers.access_resource( buffer.index );
 }
 
 Pipeline* GpuDevice::access_pipeline( PipelineHandle pipeline ) {
+    check_handle( pipeline, pipelines );
     return (Pipeline*)pipelines.access_resource( pipeline.index );
 }
 
 const Pipeline* GpuDevice::access_pipeline( PipelineHandle pipeline ) const {
+    check_handle( pipeline, pipelines );
     return (const Pipeline*)pipelines.access_resource( pipeline.index );
 }
 
 Sampler* GpuDevice::access_sampler( SamplerHandle sampler ) {
+    check_handle( sampler, samplers );
     return (Sampler*)samplers.access_resource( sampler.index );
 }
 
 const Sampler* GpuDevice::access_sampler( SamplerHandle sampler ) const {
+    check_handle( sampler, samplers );
     return (const Sampler*)samplers.access_resource( sampler.index );
 }
 
 DescriptorSetLayout* GpuDevice::access_descriptor_set_layout( DescriptorSetLayoutHandle descriptor_set_layout ) {
+    check_handle( descriptor_set_layout, descriptor_set_layouts );
     return (DescriptorSetLayout*)descriptor_set_layouts.access_resource( descriptor_set_layout.index );
 }
 
 const DescriptorSetLayout* GpuDevice::access_descriptor_set_layout( DescriptorSetLayoutHandle descriptor_set_layout ) const {
+    check_handle( descriptor_set_layout, descriptor_set_layouts );
     return (const DescriptorSetLayout*)descriptor_set_layouts.access_resource( descriptor_set_layout.index );
 }
 
@@ -4854,34 +5246,42 @@ DescriptorSetLayoutHandle GpuDevice::get_descriptor_set_layout( PipelineHandle p
 }
 
 DescriptorSet* GpuDevice::access_descriptor_set( DescriptorSetHandle descriptor_set ) {
+    check_handle( descriptor_set, descriptor_sets );
     return (DescriptorSet*)descriptor_sets.access_resource( descriptor_set.index );
 }
 
 const DescriptorSet* GpuDevice::access_descriptor_set( DescriptorSetHandle descriptor_set ) const {
+    check_handle( descriptor_set, descriptor_sets );
     return (const DescriptorSet*)descriptor_sets.access_resource( descriptor_set.index );
 }
 
 RenderPass* GpuDevice::access_render_pass( RenderPassHandle render_pass ) {
+    check_handle( render_pass, render_passes );
     return (RenderPass*)render_passes.access_resource( render_pass.index );
 }
 
 const RenderPass* GpuDevice::access_render_pass( RenderPassHandle render_pass ) const {
+    check_handle( render_pass, render_passes );
     return (const RenderPass*)render_passes.access_resource( render_pass.index );
 }
 
 Framebuffer* GpuDevice::access_framebuffer( FramebufferHandle framebuffer ) {
+    check_handle( framebuffer, framebuffers );
     return (Framebuffer*)framebuffers.access_resource( framebuffer.index );
 }
 
 const Framebuffer* GpuDevice::access_framebuffer( FramebufferHandle framebuffer ) const {
+    check_handle( framebuffer, framebuffers );
     return (Framebuffer*)framebuffers.access_resource( framebuffer.index );
 }
 
 PagePool* GpuDevice::access_page_pool( PagePoolHandle page_pool ) {
+    check_handle( page_pool, page_pools );
     return (PagePool*)page_pools.access_resource( page_pool.index );
 }
 
 const PagePool* GpuDevice::access_page_pool( PagePoolHandle page_pool ) const {
+    check_handle( page_pool, page_pools );
     return (PagePool*)page_pools.access_resource( page_pool.index );
 }
 
@@ -4908,4 +5308,17 @@ GpuDeviceCreation& GpuDeviceCreation::set_num_threads( u32 value ) {
     return *this;
 }
 
+GpuDeviceCreation& GpuDeviceCreation::set_pipeline_cache_path( cstring path ) {
+    pipeline_cache_path = path;
+    return *this;
+}
+
+GpuDeviceCreation& GpuDeviceCreation::set_headless( u32 width_, u32 height_ ) {
+    width = ( u16 )width_;
+    height = ( u16 )height_;
+    window = nullptr;
+    headless = true;
+    return *this;
+}
+
 } // namespace raptor
@@ -21,6 +21,9 @@
 VK_DEFINE_HANDLE( VmaAllocator )
 
 #include "graphics/gpu_resources.hpp"
+#include "graphics/shader_compiler.hpp"
+
+#include "external/enkiTS/TaskScheduler.h"
 
 #include "foundation/data_structures.hpp"
 #include "foundation/string.hpp"
@@ -41,10 +44,20 @@ struct GPUTimeQuery;
 struct GpuTimeQueryTree;
 struct GpuPipelineStatistics;
 
+// Statistics gathered by each thread pool query, also inherited by secondary command buffers.
+static const VkQueryPipelineStatisticFlags k_pipeline_statistics_flags = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
 //
 struct GpuThreadFramePools {
 
     VkCommandPool                   vulkan_command_pool             = nullptr;
+    VkCommandPool                   vulkan_compute_command_pool     = nullptr;    // Async compute queue family.
     VkQueryPool                     vulkan_timestamp_query_pool     = nullptr;
     VkQueryPool                     vulkan_pipeline_stats_query_pool = nullptr;
 
@@ -106,14 +119,41 @@ struct GpuDeviceCreation {
     bool                            enable_pipeline_statistics  = true;
     bool                            debug                       = false;
     bool                            force_disable_dynamic_rendering = false;
+    bool                            headless                    = false;    // No window: no surface nor swapchain, frames render into offscreen targets.
+
+    cstring                         pipeline_cache_path         = nullptr;  // Loaded at init and saved at shutdown.
 
     GpuDeviceCreation&              set_window( u32 width, u32 height, void* handle );
     GpuDeviceCreation&              set_allocator( Allocator* allocator );
     GpuDeviceCreation&              set_linear_allocator( StackAllocator* allocator );
     GpuDeviceCreation&              set_num_threads( u32 value );
+    GpuDeviceCreation&              set_pipeline_cache_path( cstring path );
+    GpuDeviceCreation&              set_headless( u32 width, u32 height );
 
 }; // struct GpuDeviceCreation
 
+//
+// Pipeline created inside a batch, waiting for its Vulkan object.
+struct PendingPipeline {
+
+    PipelineCreation                creation;       // Shader stages are not valid anymore.
+    PipelineHandle                  handle;
+    VkRenderPass                    vk_render_pass  = VK_NULL_HANDLE;
+    char                            name[ 64 ];
+
+}; // struct PendingPipeline
+
+//
+// Creates the Vulkan objects of a range of pending pipelines.
+struct PipelineBatchTask : public enki::ITaskSet {
+
+    void                            ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) override;
+
+    GpuDevice*                      gpu             = nullptr;
+    PendingPipeline*                pipelines       = nullptr;
+
+}; // struct PipelineBatchTask
+
 //
 //
 struct GpuDevice : public Service {
@@ -131,7 +171,7 @@ struct GpuDevice : public Service {
     BufferHandle                    create_buffer( const BufferCreation& creation );
     TextureHandle                   create_texture( const TextureCreation& creation );
     TextureHandle                   create_texture_view( const TextureViewCreation& creation );
-    PipelineHandle                  create_pipeline( const PipelineCreation& creation, const char* cache_path = nullptr );
+    PipelineHandle                  create_pipeline( const PipelineCreation& creation );
     SamplerHandle                   create_sampler( const SamplerCreation& creation );
     DescriptorSetLayoutHandle       create_descriptor_set_layout( const DescriptorSetLayoutCreation& creation );
     DescriptorSetHandle             create_descriptor_set( const DescriptorSetCreation& creation );
@@ -139,6 +179,12 @@ struct GpuDevice : public Service {
     FramebufferHandle               create_framebuffer( const FramebufferCreation& creation );
     ShaderStateHandle               create_shader_state( const ShaderStateCreation& creation );
 
+    // Pipelines created between begin and end of a batch get their Vulkan object at the end,
+    // with the driver compilation running in parallel on the task scheduler.
+    void                            create_pipelines( const PipelineCreation* creations, u32 count, PipelineHandle* out_handles, enki::TaskScheduler* task_scheduler );
+    void                            begin_pipeline_batch();
+    void                            end_pipeline_batch( enki::TaskScheduler* task_scheduler );
+
     void                            destroy_buffer( BufferHandle buffer );
     void                            destroy_texture( TextureHandle texture );
     void                            destroy_pipeline( PipelineHandle pipeline );
@@ -157,6 +203,7 @@ struct GpuDevice : public Service {
     void                            query_descriptor_set_layout( DescriptorSetLayoutHandle layout, DescriptorSetLayoutDescription& out_description );
     void                            query_descriptor_set( DescriptorSetHandle set, DesciptorSetDescription& out_description );
     void                            query_shader_state( ShaderStateHandle shader, ShaderStateDescription& out_description );
+    void                            query_texture_memory_requirements( const TextureCreation& creation, VkMemoryRequirements& out_requirements );
 
     const RenderPassOutput&         get_render_pass_output( RenderPassHandle render_pass ) const;
 
@@ -164,6 +211,7 @@ struct GpuDevice : public Service {
     void                            resize_output_textures( FramebufferHandle render_pass, u32 width, u32 height );
     void                            resize_texture( TextureHandle texture, u32 width, u32 height );
     void                            resize_texture_3d( TextureHandle texture, u32 width, u32 height, u32 depth );
+    void                            resize_aliased_texture( TextureHandle texture, u32 width, u32 height, TextureHandle alias );
 
     PagePoolHandle                  allocate_texture_pool( TextureHandle texture_handle, u32 pool_size );
     void                            destroy_page_pool( PagePoolHandle pool_handle );
@@ -183,7 +231,14 @@ struct GpuDevice : public Service {
     bool                            get_family_queue( VkPhysicalDevice physical_device );
 
     VkDeviceAddress                 get_buffer_device_address( BufferHandle handle );
-    VkShaderModuleCreateInfo        compile_shader( cstring code, u32 code_size, VkShaderStageFlagBits stage, cstring name );
+    VkShaderModuleCreateInfo        compile_shader( cstring code, u32 code_size, VkShaderStageFlagBits stage, cstring name, bool use_cache = true );
+
+    // Thread safe, only creates the VkPipeline.
+    void                            create_vulkan_pipeline( const PipelineCreation& creation, PipelineHandle handle, VkRenderPass vk_render_pass );
+    void                            finalize_pipeline( PipelineHandle handle, cstring name );
+
+    void                            create_pipeline_cache( cstring path );
+    void                            save_pipeline_cache( cstring path );
 
     // Swapchain //////////////////////////////////////////////////////////
     void                            create_swapchain();
@@ -201,8 +256,11 @@ struct GpuDevice : public Service {
     // Command Buffers ///////////////////////////////////////////////////
     CommandBuffer*                  get_command_buffer( u32 thread_index, u32 frame_index, bool begin );
     CommandBuffer*                  get_secondary_command_buffer( u32 thread_index, u32 frame_index );
+    CommandBuffer*                  get_segment_command_buffer( CommandBuffer* command_buffer );    // Continues the frame of command_buffer in a new primary, queries are not reset.
+    CommandBuffer*                  get_compute_command_buffer( CommandBuffer* command_buffer );    // Async compute command buffer from the thread and frame of command_buffer.
 
     void                            queue_command_buffer( CommandBuffer* command_buffer );          // Queue command buffer that will not be executed until present is called.
+    void                            queue_async_compute_command_buffer( CommandBuffer* command_buffer );
 
     // Rendering /////////////////////////////////////////////////////////
     void                            new_frame();
@@ -225,6 +283,8 @@ struct GpuDevice : public Service {
 
     // Compute ///////////////////////////////////////////////////////////
     void                            submit_compute_load( CommandBuffer* command_buffer );
+    void                            submit_async_compute_frame( VkCommandBufferSubmitInfoKHR* command_buffer_infos, VkSemaphoreSubmitInfoKHR* frame_waits, u32 num_frame_waits,
+                                                                VkSemaphoreSubmitInfoKHR* frame_signals, u32 num_frame_signals );
     void                            submit_immediate( CommandBuffer* command_buffer );
 
     // Names and markers /////////////////////////////////////////////////
@@ -292,6 +352,12 @@ struct GpuDevice : public Service {
     u32                             num_allocated_command_buffers       = 0;
     u32                             num_queued_command_buffers          = 0;
 
+    static constexpr u32            k_max_queued_command_buffers        = 16;
+    static constexpr u32            k_max_async_compute_command_buffers = 4;
+
+    CommandBuffer*                  queued_compute_command_buffers[ k_max_async_compute_command_buffers ];
+    u32                             num_queued_compute_command_buffers  = 0;
+
     PresentMode::Enum               present_mode                        = PresentMode::VSync;
     u32                             current_frame;
     u32                             previous_frame;
@@ -307,6 +373,7 @@ struct GpuDevice : public Service {
     bool                            timestamps_enabled                  = false;
     bool                            resized                             = false;
     bool                            vertical_sync                       = false;
+    bool                            headless                            = false;
 
     static constexpr cstring        k_name                              = "raptor_gpu_service";
 
@@ -348,6 +415,10 @@ struct GpuDevice : public Service {
     u64                             last_compute_semaphore_value = 0;
     bool                            has_async_work = false;
 
+    // Signaled by each graphics command buffer when frame graph nodes run on the async compute queue.
+    VkSemaphore                     vulkan_graphics_segment_semaphore;
+    u64                             last_graphics_segment_value = 0;
+
     VkFence                         vulkan_immediate_fence;
 
     // Windows specific
@@ -369,6 +440,9 @@ struct GpuDevice : public Service {
     PFN_vkCmdEndRenderingKHR        vkCmdEndRenderingKHR;
     PFN_vkQueueSubmit2KHR           vkQueueSubmit2KHR;
     PFN_vkCmdPipelineBarrier2KHR    vkCmdPipelineBarrier2KHR;
+    PFN_vkCmdSetEvent2KHR           vkCmdSetEvent2KHR;
+    PFN_vkCmdWaitEvents2KHR         vkCmdWaitEvents2KHR;
+    PFN_vkCmdResetEvent2KHR         vkCmdResetEvent2KHR;
 
     // Mesh shaders functions
     PFN_vkCmdDrawMeshTasksNV        vkCmdDrawMeshTasksNV;
@@ -421,6 +495,8 @@ struct GpuDevice : public Service {
     bool                            fragment_shading_rate_present   = false;
     bool                            ray_tracing_present             = false;
     bool                            ray_query_present               = false;
+    bool                            inherited_queries_present       = false;
+    bool                            texture_compression_bc_present  = false;
 
     sizet                           ubo_alignment                   = 256;
     sizet                           ssbo_alignemnt                  = 256;
@@ -432,7 +508,13 @@ struct GpuDevice : public Service {
     VkPhysicalDeviceRayTracingPipelinePropertiesKHR ray_tracing_pipeline_properties;
     VkPhysicalDeviceAccelerationStructureFeaturesKHR acceleration_structure_features;
 
-    char                            vulkan_binaries_path[ 512 ];
+    ShaderCompiler                  shader_compiler;
+
+    VkPipelineCache                 vulkan_pipeline_cache = VK_NULL_HANDLE;
+    char                            pipeline_cache_path[ 512 ];
+
+    Array<PendingPipeline>          pending_pipelines;
+    bool                            pipeline_batch_active = false;
 
 
     ShaderState*                    access_shader_state( ShaderStateHandle shader );
@@ -808,7 +808,7 @@ VkImageLayout util_to_vk_image_layout2( ResourceState usage ) {
     return VK_IMAGE_LAYOUT_UNDEFINED;
 }
 
-VkPipelineStageFlags util_determine_pipeline_stage_flags( VkAccessFlags access_flags, QueueType::Enum queue_type ) {
+VkPipelineStageFlags util_determine_pipeline_stage_flags( GpuDevice* gpu, VkAccessFlags access_flags, QueueType::Enum queue_type ) {
     VkPipelineStageFlags flags = 0;
 
     switch ( queue_type ) {
@@ -824,6 +824,10 @@ VkPipelineStageFlags util_determine_pipeline_stage_flags( VkAccessFlags access_f
 
                 // TODO(marco): check RT extension is present/enabled
                 flags |= VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR;
+
+                if ( gpu->mesh_shaders_extension_present ) {
+                    flags |= VK_PIPELINE_STAGE_TASK_SHADER_BIT_NV | VK_PIPELINE_STAGE_MESH_SHADER_BIT_NV;
+                }
             }
 
             if ( ( access_flags & VK_ACCESS_INPUT_ATTACHMENT_READ_BIT ) != 0 )
@@ -877,7 +881,7 @@ VkPipelineStageFlags util_determine_pipeline_stage_flags( VkAccessFlags access_f
 }
 
 
-VkPipelineStageFlags2KHR util_determine_pipeline_stage_flags2( VkAccessFlags2KHR access_flags, QueueType::Enum queue_type ) {
+VkPipelineStageFlags2KHR util_determine_pipeline_stage_flags2( GpuDevice* gpu, VkAccessFlags2KHR access_flags, QueueType::Enum queue_type ) {
     VkPipelineStageFlags2KHR flags = 0;
 
     switch ( queue_type ) {
@@ -893,6 +897,10 @@ VkPipelineStageFlags2KHR util_determine_pipeline_stage_flags2( VkAccessFlags2KHR
 
                 // TODO(marco): check RT extension is present/enabled
                 flags |= VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+
+                if ( gpu->mesh_shaders_extension_present ) {
+                    flags |= VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_NV | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_NV;
+                }
             }
 
             if ( ( access_flags & VK_ACCESS_INPUT_ATTACHMENT_READ_BIT ) != 0 )
@@ -949,9 +957,9 @@ void util_add_image_barrier( GpuDevice* gpu, VkCommandBuffer command_buffer, VkI
     if ( gpu->synchronization2_extension_present ) {
         VkImageMemoryBarrier2KHR barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR };
         barrier.srcAccessMask = util_to_vk_access_flags2( old_state );
-        barrier.srcStageMask = util_determine_pipeline_stage_flags2( barrier.srcAccessMask, QueueType::Graphics );
+        barrier.srcStageMask = util_determine_pipeline_stage_flags2( gpu, barrier.srcAccessMask, QueueType::Graphics );
         barrier.dstAccessMask = util_to_vk_access_flags2( new_state );
-        barrier.dstStageMask = util_determine_pipeline_stage_flags2( barrier.dstAccessMask, QueueType::Graphics );
+        barrier.dstStageMask = util_determine_pipeline_stage_flags2( gpu, barrier.dstAccessMask, QueueType::Graphics );
         barrier.oldLayout = util_to_vk_image_layout2( old_state );
         barrier.newLayout = util_to_vk_image_layout2( new_state );
         barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
@@ -984,8 +992,8 @@ void util_add_image_barrier( GpuDevice* gpu, VkCommandBuffer command_buffer, VkI
         barrier.srcAccessMask = util_to_vk_access_flags( old_state );
         barrier.dstAccessMask = util_to_vk_access_flags( new_state );
 
-        const VkPipelineStageFlags source_stage_mask = util_determine_pipeline_stage_flags( barrier.srcAccessMask, QueueType::Graphics );
-        const VkPipelineStageFlags destination_stage_mask = util_determine_pipeline_stage_flags( barrier.dstAccessMask, QueueType::Graphics );
+        const VkPipelineStageFlags source_stage_mask = util_determine_pipeline_stage_flags( gpu, barrier.srcAccessMask, QueueType::Graphics );
+        const VkPipelineStageFlags destination_stage_mask = util_determine_pipeline_stage_flags( gpu, barrier.dstAccessMask, QueueType::Graphics );
 
         vkCmdPipelineBarrier( command_buffer, source_stage_mask, destination_stage_mask, 0,
                             0, nullptr, 0, nullptr, 1, &barrier );
@@ -1008,9 +1016,9 @@ void util_add_image_barrier_ext( GpuDevice* gpu, VkCommandBuffer command_buffer,
     if ( gpu->synchronization2_extension_present ) {
         VkImageMemoryBarrier2KHR barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR };
         barrier.srcAccessMask = util_to_vk_access_flags2( old_state );
-        barrier.srcStageMask = util_determine_pipeline_stage_flags2( barrier.srcAccessMask, source_queue_type );
+        barrier.srcStageMask = util_determine_pipeline_stage_flags2( gpu, barrier.srcAccessMask, source_queue_type );
         barrier.dstAccessMask = util_to_vk_access_flags2( new_state );
-        barrier.dstStageMask = util_determine_pipeline_stage_flags2( barrier.dstAccessMask, destination_queue_type );
+        barrier.dstStageMask = util_determine_pipeline_stage_flags2( gpu, barrier.dstAccessMask, destination_queue_type );
         barrier.oldLayout = util_to_vk_image_layout2( old_state );
         barrier.newLayout = util_to_vk_image_layout2( new_state );
         barrier.srcQueueFamilyIndex = source_family;
@@ -1043,8 +1051,8 @@ void util_add_image_barrier_ext( GpuDevice* gpu, VkCommandBuffer command_buffer,
         barrier.srcAccessMask = util_to_vk_access_flags( old_state );
         barrier.dstAccessMask = util_to_vk_access_flags( new_state );
 
-        const VkPipelineStageFlags source_stage_mask = util_determine_pipeline_stage_flags( barrier.srcAccessMask, source_queue_type );
-        const VkPipelineStageFlags destination_stage_mask = util_determine_pipeline_stage_flags( barrier.dstAccessMask, destination_queue_type );
+        const VkPipelineStageFlags source_stage_mask = util_determine_pipeline_stage_flags( gpu, barrier.srcAccessMask, source_queue_type );
+        const VkPipelineStageFlags destination_stage_mask = util_determine_pipeline_stage_flags( gpu, barrier.dstAccessMask, destination_queue_type );
 
         vkCmdPipelineBarrier( command_buffer, source_stage_mask, destination_stage_mask, 0,
                             0, nullptr, 0, nullptr, 1, &barrier );
@@ -1073,9 +1081,9 @@ void util_add_buffer_barrier_ext( GpuDevice* gpu, VkCommandBuffer command_buffer
     if ( gpu->synchronization2_extension_present ) {
         VkBufferMemoryBarrier2KHR barrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR };
         barrier.srcAccessMask = util_to_vk_access_flags2( old_state );
-        barrier.srcStageMask = util_determine_pipeline_stage_flags2( barrier.srcAccessMask, source_queue_type );
+        barrier.srcStageMask = util_determine_pipeline_stage_flags2( gpu, barrier.srcAccessMask, source_queue_type );
         barrier.dstAccessMask = util_to_vk_access_flags2( new_state );
-        barrier.dstStageMask = util_determine_pipeline_stage_flags2( barrier.dstAccessMask, destination_queue_type );
+        barrier.dstStageMask = util_determine_pipeline_stage_flags2( gpu, barrier.dstAccessMask, destination_queue_type );
         barrier.buffer = buffer;
         barrier.offset = 0;
         barrier.size = buffer_size;
@@ -1095,8 +1103,8 @@ void util_add_buffer_barrier_ext( GpuDevice* gpu, VkCommandBuffer command_buffer
         barrier.srcAccessMask = util_to_vk_access_flags( old_state );
         barrier.dstAccessMask = util_to_vk_access_flags( new_state );
 
-        const VkPipelineStageFlags source_stage_mask = util_determine_pipeline_stage_flags( barrier.srcAccessMask, source_queue_type );
-        const VkPipelineStageFlags destination_stage_mask = util_determine_pipeline_stage_flags( barrier.dstAccessMask, destination_queue_type );
+        const VkPipelineStageFlags source_stage_mask = util_determine_pipeline_stage_flags( gpu, barrier.srcAccessMask, source_queue_type );
+        const VkPipelineStageFlags destination_stage_mask = util_determine_pipeline_stage_flags( gpu, barrier.dstAccessMask, destination_queue_type );
 
         vkCmdPipelineBarrier( command_buffer, source_stage_mask, destination_stage_mask, 0,
                             0, nullptr, 1, &barrier, 0, nullptr );
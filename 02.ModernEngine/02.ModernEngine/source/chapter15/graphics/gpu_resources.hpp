@@ -1,6 +1,7 @@
 #pragma once
 
 #include "foundation/array.hpp"
+#include "foundation/data_structures.hpp"
 #include "foundation/platform.hpp"
 
 #include "graphics/gpu_enum.hpp"
@@ -23,44 +24,63 @@ static const u32                    k_invalid_index = 0xffffffff;
 
 typedef u32                         ResourceHandle;
 
+// Handles carry the pool slot generation in debug builds only, so that stale handles
+// are caught on access. index stays the raw slot as it is also used as bindless index.
+// A generation of 0 (e.g. handles rebuilt from a bare index) is never checked.
+#if defined(RAPTOR_HANDLE_VALIDATION)
+#define RAPTOR_HANDLE_GENERATION    u32 generation;
+#else
+#define RAPTOR_HANDLE_GENERATION
+#endif // RAPTOR_HANDLE_VALIDATION
+
 struct BufferHandle {
     ResourceHandle                  index;
+    RAPTOR_HANDLE_GENERATION
 }; // struct BufferHandle
 
 struct TextureHandle {
     ResourceHandle                  index;
+    RAPTOR_HANDLE_GENERATION
 }; // struct TextureHandle
 
 struct ShaderStateHandle {
     ResourceHandle                  index;
+    RAPTOR_HANDLE_GENERATION
 }; // struct ShaderStateHandle
 
 struct SamplerHandle {
     ResourceHandle                  index;
+    RAPTOR_HANDLE_GENERATION
 }; // struct SamplerHandle
 
 struct DescriptorSetLayoutHandle {
     ResourceHandle                  index;
+    RAPTOR_HANDLE_GENERATION
 }; // struct DescriptorSetLayoutHandle
 
 struct DescriptorSetHandle {
     ResourceHandle                  index;
+    RAPTOR_HANDLE_GENERATION
 }; // struct DescriptorSetHandle
 
 struct PipelineHandle {
     ResourceHandle                  index;
+    RAPTOR_HANDLE_GENERATION
 }; // struct PipelineHandle
 
 struct RenderPassHandle {
 	ResourceHandle                  index;
+    RAPTOR_HANDLE_GENERATION
 }; // struct RenderPassHandle
 
 struct FramebufferHandle {
     ResourceHandle                  index;
+    RAPTOR_HANDLE_GENERATION
 }; // struct FramebufferHandle
 
 struct PagePoolHandle {
     ResourceHandle                  index;
+    RAPTOR_HANDLE_GENERATION
 }; // struct FramebufferHandle
 
 // Invalid handles
@@ -81,6 +101,7 @@ static PagePoolHandle               k_invalid_page_pool     { k_invalid_index };
 static const u8                     k_max_image_outputs = 8;                // Maximum number of images/render_targets/fbo attachments usable.
 static const u8                     k_max_descriptor_set_layouts = 8;       // Maximum number of layouts in the pipeline.
 static const u8                     k_max_shader_stages = 5;                // Maximum simultaneous shader stages. Applicable to all different type of pipelines.
+static const u8                     k_max_specialization_constants = 4;     // Per shader state, same as spirv::k_max_specialization_constants.
 static const u8                     k_max_descriptors_per_set = 32;         // Maximum list elements for both descriptor set layout and descriptor sets.
 static const u8                     k_max_vertex_streams = 16;
 static const u8                     k_max_vertex_attributes = 16;
@@ -594,6 +615,25 @@ namespace TextureFormat {
         return value >= VK_FORMAT_D16_UNORM && value <= VK_FORMAT_D32_SFLOAT_S8_UINT;
     }
 
+    inline bool                     is_block_compressed( VkFormat value ) {
+        return value >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && value <= VK_FORMAT_BC7_SRGB_BLOCK;
+    }
+    // Bytes of a 4x4 block: BC1 and BC4 are 8, the others 16.
+    inline u32                      block_size( VkFormat value ) {
+        return ( value <= VK_FORMAT_BC1_RGBA_SRGB_BLOCK || value == VK_FORMAT_BC4_UNORM_BLOCK || value == VK_FORMAT_BC4_SNORM_BLOCK ) ? 8 : 16;
+    }
+    inline u64                      block_compressed_size( VkFormat value, u32 width, u32 height ) {
+        return ( u64 )( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * block_size( value );
+    }
+    // Size of the mip chain packed from the base level.
+    inline u64                      block_compressed_size( VkFormat value, u32 width, u32 height, u32 mip_levels ) {
+        u64 size = 0;
+        for ( u32 mip = 0; mip < mip_levels; ++mip ) {
+            size += block_compressed_size( value, width > ( 1u << mip ) ? width >> mip : 1, height > ( 1u << mip ) ? height >> mip : 1 );
+        }
+        return size;
+    }
+
 } // namespace TextureFormat
 
 
@@ -866,6 +906,11 @@ struct ShaderState {
     bool                            ray_tracing_pipeline = false;
 
     spirv::ParseResult*             parse_result;
+
+    // Referenced by shader_stage_info until the pipeline is created.
+    VkSpecializationInfo            specialization_info;
+    VkSpecializationMapEntry        specialization_entries[ k_max_specialization_constants ];
+    u32                             specialization_data[ k_max_specialization_constants ];
 }; // struct ShaderState
 
 //
@@ -1039,8 +1084,9 @@ VkImageLayout               util_to_vk_image_layout( ResourceState usage );
 VkImageLayout               util_to_vk_image_layout2( ResourceState usage );
 
 // Determines pipeline stages involved for given accesses
-VkPipelineStageFlags        util_determine_pipeline_stage_flags( VkAccessFlags access_flags, QueueType::Enum queue_type );
-VkPipelineStageFlags2KHR    util_determine_pipeline_stage_flags2( VkAccessFlags2KHR access_flags, QueueType::Enum queue_type );
+// Task and mesh shader stages are included when the device has mesh shaders.
+VkPipelineStageFlags        util_determine_pipeline_stage_flags( GpuDevice* gpu, VkAccessFlags access_flags, QueueType::Enum queue_type );
+VkPipelineStageFlags2KHR    util_determine_pipeline_stage_flags2( GpuDevice* gpu, VkAccessFlags2KHR access_flags, QueueType::Enum queue_type );
 
 void util_add_image_barrier( GpuDevice* gpu, VkCommandBuffer command_buffer, Texture* texture, ResourceState new_state,
                              u32 base_mip_level, u32 mip_count, bool is_depth );
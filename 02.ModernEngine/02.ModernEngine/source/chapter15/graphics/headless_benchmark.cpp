@@ -0,0 +1,308 @@
+#include "graphics/headless_benchmark.hpp"
+#include "graphics/gpu_device.hpp"
+#include "graphics/gpu_profiler.hpp"
+
+#include "application/game_camera.hpp"
+
+#include "foundation/memory.hpp"
+#include "foundation/file.hpp"
+#include "foundation/log.hpp"
+
+#include "external/cglm/struct/vec3.h"
+#include "external/json.hpp"
+#include "external/vk_mem_alloc.h"
+
+#include "external/imgui/imgui.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace raptor {
+
+// CameraPath /////////////////////////////////////////////////////////////
+void CameraPath::init( Allocator* allocator ) {
+    keys.init( allocator, 16 );
+}
+
+void CameraPath::shutdown() {
+    keys.shutdown();
+}
+
+bool CameraPath::load( cstring path, StackAllocator* temp_allocator ) {
+    using json = nlohmann::json;
+
+    if ( !file_exists( path ) ) {
+        rprint( "Cannot find camera path %s\n", path );
+        return false;
+    }
+
+    sizet current_allocator_marker = temp_allocator->get_marker();
+
+    FileReadResult read_result = file_read_text( path, temp_allocator );
+    json path_data = json::parse( read_result.data );
+
+    temp_allocator->free_marker( current_allocator_marker );
+
+    keys.clear();
+
+    json json_keys = path_data[ "keys" ];
+    for ( sizet i = 0; i < json_keys.size(); ++i ) {
+        json json_key = json_keys[ i ];
+
+        CameraPathKey& key = keys.push_use();
+        key.time = json_key.value( "time", 0.f );
+        key.yaw = json_key.value( "yaw", 0.f );
+        key.pitch = json_key.value( "pitch", 0.f );
+
+        json position = json_key[ "position" ];
+        key.position.x = position[ 0 ];
+        key.position.y = position[ 1 ];
+        key.position.z = position[ 2 ];
+
+        // Keys are expected in time order.
+        if ( keys.size > 1 && key.time < keys[ keys.size - 2 ].time ) {
+            key.time = keys[ keys.size - 2 ].time;
+        }
+    }
+
+    rprint( "Loaded camera path %s, %u keys, %f seconds\n", path, keys.size, duration() );
+    return keys.size > 0;
+}
+
+bool CameraPath::save( cstring path ) const {
+    FILE* file = fopen( path, "w" );
+    if ( !file ) {
+        rprint( "Cannot write camera path %s\n", path );
+        return false;
+    }
+
+    fprintf( file, "{\n    \"keys\": [\n" );
+    for ( u32 i = 0; i < keys.size; ++i ) {
+        const CameraPathKey& key = keys[ i ];
+        fprintf( file, "        { \"time\": %f, \"position\": [ %f, %f, %f ], \"yaw\": %f, \"pitch\": %f }%s\n", key.time,
+                 key.position.x, key.position.y, key.position.z, key.yaw, key.pitch, i + 1 < keys.size ? "," : "" );
+    }
+    fprintf( file, "    ]\n}\n" );
+    fclose( file );
+
+    return true;
+}
+
+void CameraPath::generate_orbit( const vec3s& center, f32 radius, f32 height, f32 duration, u32 num_keys ) {
+    keys.clear();
+
+    for ( u32 i = 0; i < num_keys; ++i ) {
+        const f32 t = i / ( f32 )( num_keys - 1 );
+        const f32 angle = t * 2.f * 3.14159265f;
+
+        CameraPathKey& key = keys.push_use();
+        key.time = t * duration;
+        key.position = { center.x + sinf( angle ) * radius, center.y + height, center.z + cosf( angle ) * radius };
+
+        // Camera::update looks along ( cos pitch sin yaw, -sin pitch, -cos pitch cos yaw ).
+        const vec3s to_center = glms_vec3_sub( center, key.position );
+        key.yaw = atan2f( to_center.x, -to_center.z );
+        key.pitch = atan2f( -to_center.y, sqrtf( to_center.x * to_center.x + to_center.z * to_center.z ) );
+    }
+
+    // Unwrap the yaw, so that interpolation does not turn back around.
+    for ( u32 i = 1; i < keys.size; ++i ) {
+        while ( keys[ i ].yaw - keys[ i - 1 ].yaw > 3.14159265f ) {
+            keys[ i ].yaw -= 2.f * 3.14159265f;
+        }
+        while ( keys[ i ].yaw - keys[ i - 1 ].yaw < -3.14159265f ) {
+            keys[ i ].yaw += 2.f * 3.14159265f;
+        }
+    }
+}
+
+void CameraPath::add_key( const Camera& camera, f32 time ) {
+    CameraPathKey& key = keys.push_use();
+    key.position = camera.position;
+    key.yaw = camera.yaw;
+    key.pitch = camera.pitch;
+    key.time = time;
+}
+
+f32 CameraPath::duration() const {
+    return keys.size ? keys.back().time : 0.f;
+}
+
+void CameraPath::apply( GameCamera& game_camera, f32 time ) const {
+    if ( keys.size == 0 ) {
+        return;
+    }
+
+    // Paths are short, a linear search is enough.
+    u32 next = 0;
+    while ( next < keys.size && keys[ next ].time <= time ) {
+        ++next;
+    }
+
+    CameraPathKey pose;
+    if ( next == 0 ) {
+        pose = keys[ 0 ];
+    } else if ( next == keys.size ) {
+        pose = keys.back();
+    } else {
+        const CameraPathKey& a = keys[ next - 1 ];
+        const CameraPathKey& b = keys[ next ];
+        const f32 span = b.time - a.time;
+        const f32 t = span > 0.f ? ( time - a.time ) / span : 1.f;
+
+        pose.position = glms_vec3_lerp( a.position, b.position, t );
+        pose.yaw = a.yaw + ( b.yaw - a.yaw ) * t;
+        pose.pitch = a.pitch + ( b.pitch - a.pitch ) * t;
+    }
+
+    Camera& camera = game_camera.camera;
+    camera.position = pose.position;
+    camera.yaw = pose.yaw;
+    camera.pitch = pose.pitch;
+    camera.update();
+
+    game_camera.target_movement = pose.position;
+    game_camera.target_yaw = pose.yaw;
+    game_camera.target_pitch = pose.pitch;
+}
+
+void CameraPath::debug_ui( const GameCamera& game_camera, cstring save_path ) {
+    ImGui::Text( "Camera path: %u keys, %f seconds", keys.size, duration() );
+    ImGui::SliderFloat( "Key interval", &key_interval, 0.1f, 10.f );
+
+    if ( ImGui::Button( "Add camera key" ) ) {
+        add_key( game_camera.camera, keys.size ? duration() + key_interval : 0.f );
+    }
+    ImGui::SameLine();
+    if ( ImGui::Button( "Clear keys" ) ) {
+        keys.clear();
+    }
+    ImGui::SameLine();
+    if ( ImGui::Button( "Save path" ) && save( save_path ) ) {
+        rprint( "Saved camera path %s\n", save_path );
+    }
+}
+
+// HeadlessBenchmark //////////////////////////////////////////////////////
+void HeadlessBenchmark::init( Allocator* allocator, u32 num_frames ) {
+    frames.init( allocator, num_frames );
+    gpu_passes.init( allocator, num_frames * 32 );
+}
+
+void HeadlessBenchmark::shutdown() {
+    frames.shutdown();
+    gpu_passes.shutdown();
+}
+
+void HeadlessBenchmark::begin_frame() {
+    BenchmarkFrame& frame = frames.push_use();
+    memset( &frame, 0, sizeof( BenchmarkFrame ) );
+    frame.first_gpu_pass = gpu_passes.size;
+    frame.gpu_frame_index = u32_max;
+}
+
+void HeadlessBenchmark::add_cpu_time( BenchmarkCpuStage::Enum stage, f64 milliseconds ) {
+    frames.back().cpu_ms[ stage ] += ( f32 )milliseconds;
+}
+
+void HeadlessBenchmark::add_gpu_passes( const GpuVisualProfiler& gpu_profiler ) {
+    // The profiler does not advance while paused or in its first frames.
+    if ( gpu_profiler.current_frame == last_profiler_frame ) {
+        return;
+    }
+    last_profiler_frame = gpu_profiler.current_frame;
+
+    const u32 profiler_frame = ( gpu_profiler.current_frame + gpu_profiler.max_frames - 1 ) % gpu_profiler.max_frames;
+    const GPUTimeQuery* timestamps = &gpu_profiler.timestamps[ profiler_frame * gpu_profiler.max_queries_per_frame ];
+    const u32 count = gpu_profiler.per_frame_active[ profiler_frame ];
+
+    BenchmarkFrame& frame = frames.back();
+    frame.gpu_pass_count = count;
+    frame.gpu_frame_index = count ? timestamps[ 0 ].frame_index : u32_max;
+
+    for ( u32 i = 0; i < count; ++i ) {
+        const GPUTimeQuery& timestamp = timestamps[ i ];
+        gpu_passes.push( { timestamp.name, ( f32 )timestamp.elapsed_ms, timestamp.depth } );
+    }
+}
+
+void HeadlessBenchmark::add_memory( GpuDevice& gpu, const FrameArenaRing& frame_arenas ) {
+    BenchmarkFrame& frame = frames.back();
+    frame.frame_arena_used = frame_arenas.arenas[ frame_arenas.current_arena ].high_water_mark;
+    frame.system_allocated = MemoryService::instance()->system_allocator.allocated_size;
+
+    VmaBudget budgets[ VK_MAX_MEMORY_HEAPS ];
+    vmaGetHeapBudgets( gpu.vma_allocator, budgets );
+
+    frame.gpu_memory_used = 0;
+    for ( u32 i = 0; i < gpu.get_memory_heap_count(); ++i ) {
+        frame.gpu_memory_used += budgets[ i ].usage;
+    }
+}
+
+// Writes a quoted json string. Paths have backslashes on Windows, and names can have quotes.
+static void write_json_string( FILE* file, cstring string ) {
+    fputc( '"', file );
+    for ( cstring c = string; *c; ++c ) {
+        if ( *c == '"' || *c == '\\' ) {
+            fputc( '\\', file );
+            fputc( *c, file );
+        } else if ( ( u8 )*c < 0x20 ) {
+            fprintf( file, "\\u%04x", ( u8 )*c );
+        } else {
+            fputc( *c, file );
+        }
+    }
+    fputc( '"', file );
+}
+
+bool HeadlessBenchmark::write_json( cstring path, cstring scene_name, GpuDevice& gpu ) const {
+    FILE* file = fopen( path, "w" );
+    if ( !file ) {
+        rprint( "Cannot write benchmark results %s\n", path );
+        return false;
+    }
+
+    fprintf( file, "{\n    \"scene\": " );
+    write_json_string( file, scene_name );
+    fprintf( file, ",\n    \"gpu\": " );
+    write_json_string( file, gpu.get_gpu_name() );
+    fprintf( file, ",\n" );
+    fprintf( file, "    \"width\": %u,\n    \"height\": %u,\n", gpu.swapchain_width, gpu.swapchain_height );
+    fprintf( file, "    \"frames\": [\n" );
+
+    for ( u32 f = 0; f < frames.size; ++f ) {
+        const BenchmarkFrame& frame = frames[ f ];
+
+        fprintf( file, "        { \"frame\": %u, \"cpu_ms\": { ", f );
+        for ( u32 s = 0; s < BenchmarkCpuStage::Count; ++s ) {
+            fprintf( file, "\"%s\": %f%s", BenchmarkCpuStage::s_value_names[ s ], frame.cpu_ms[ s ], s + 1 < BenchmarkCpuStage::Count ? ", " : " },\n" );
+        }
+
+        fprintf( file, "          \"memory\": { \"frame_arena\": %llu, \"system_allocator\": %llu, \"gpu\": %llu },\n",
+                 ( unsigned long long )frame.frame_arena_used, ( unsigned long long )frame.system_allocated, ( unsigned long long )frame.gpu_memory_used );
+
+        if ( frame.gpu_frame_index == u32_max ) {
+            fprintf( file, "          \"gpu_frame\": null, \"gpu_passes\": [ ] }" );
+        } else {
+            fprintf( file, "          \"gpu_frame\": %u, \"gpu_passes\": [", frame.gpu_frame_index );
+            for ( u32 p = 0; p < frame.gpu_pass_count; ++p ) {
+                const BenchmarkGpuPass& pass = gpu_passes[ frame.first_gpu_pass + p ];
+                fprintf( file, "%s\n            { \"name\": ", p ? "," : "" );
+                write_json_string( file, pass.name ? pass.name : "" );
+                fprintf( file, ", \"depth\": %u, \"ms\": %f }", pass.depth, pass.elapsed_ms );
+            }
+            fprintf( file, " ] }" );
+        }
+        fprintf( file, "%s\n", f + 1 < frames.size ? "," : "" );
+    }
+
+    fprintf( file, "    ]\n}\n" );
+    fclose( file );
+
+    rprint( "Written benchmark results %s, %u frames\n", path, frames.size );
+    return true;
+}
+
+} // namespace raptor
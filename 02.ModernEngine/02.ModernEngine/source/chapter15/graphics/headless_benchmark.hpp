@@ -0,0 +1,122 @@
+#pragma once
+
+#include "foundation/array.hpp"
+
+#include "external/cglm/types-struct.h"
+
+namespace raptor {
+
+    struct Allocator;
+    struct Camera;
+    struct FrameArenaRing;
+    struct GameCamera;
+    struct GpuDevice;
+    struct GpuVisualProfiler;
+    struct StackAllocator;
+
+    // Camera path ////////////////////////////////////////////////////////
+
+    //
+    //
+    struct CameraPathKey {
+
+        vec3s                           position;
+        f32                             yaw;
+        f32                             pitch;
+        f32                             time;           // Seconds from the start of the path.
+
+    }; // struct CameraPathKey
+
+    //
+    // Camera poses linearly interpolated over time, saved as json so that recorded paths can be replayed.
+    struct CameraPath {
+
+        void                            init( Allocator* allocator );
+        void                            shutdown();
+
+        bool                            load( cstring path, StackAllocator* temp_allocator );
+        bool                            save( cstring path ) const;
+
+        // Circle around the center looking at it, for scenes without a recorded path.
+        void                            generate_orbit( const vec3s& center, f32 radius, f32 height, f32 duration, u32 num_keys );
+
+        void                            add_key( const Camera& camera, f32 time );
+        f32                             duration() const;
+
+        // Times outside of the path are clamped. Both the camera and the game camera targets are set,
+        // so that the game camera does not tween back.
+        void                            apply( GameCamera& game_camera, f32 time ) const;
+
+        // Buttons to add the current camera as a key, key interval seconds after the last one, and to save the path.
+        void                            debug_ui( const GameCamera& game_camera, cstring save_path );
+
+        Array<CameraPathKey>            keys;
+
+        f32                             key_interval    = 1.f;
+
+    }; // struct CameraPath
+
+    // Headless benchmark /////////////////////////////////////////////////
+
+    namespace BenchmarkCpuStage {
+
+        enum Enum {
+            Update, Upload, Record, Submit, Count
+        }; // enum Enum
+
+        static const char* s_value_names[] = {
+            "update", "upload", "record", "submit", "Count"
+        };
+
+    } // namespace BenchmarkCpuStage
+
+    //
+    //
+    struct BenchmarkGpuPass {
+
+        cstring                         name;
+        f32                             elapsed_ms;
+        u16                             depth;
+
+    }; // struct BenchmarkGpuPass
+
+    //
+    //
+    struct BenchmarkFrame {
+
+        f32                             cpu_ms[ BenchmarkCpuStage::Count ];
+
+        u32                             first_gpu_pass;
+        u32                             gpu_pass_count;
+        u32                             gpu_frame_index; // Timestamps are read back frames later, this is the frame they measured.
+
+        sizet                           frame_arena_used;
+        sizet                           system_allocated;
+        u64                             gpu_memory_used;
+
+    }; // struct BenchmarkFrame
+
+    //
+    // Per frame CPU stage timings, GPU pass timings from the visual profiler and memory usage,
+    // written as json at the end of a headless run.
+    struct HeadlessBenchmark {
+
+        void                            init( Allocator* allocator, u32 num_frames );
+        void                            shutdown();
+
+        void                            begin_frame();
+        void                            add_cpu_time( BenchmarkCpuStage::Enum stage, f64 milliseconds );
+        // Called after the draw task: copies the timestamps the profiler collected this frame, if any.
+        void                            add_gpu_passes( const GpuVisualProfiler& gpu_profiler );
+        void                            add_memory( GpuDevice& gpu, const FrameArenaRing& frame_arenas );
+
+        bool                            write_json( cstring path, cstring scene_name, GpuDevice& gpu ) const;
+
+        Array<BenchmarkFrame>           frames;
+        Array<BenchmarkGpuPass>         gpu_passes;
+
+        u32                             last_profiler_frame = 0;    // The visual profiler starts at frame 0.
+
+    }; // struct HeadlessBenchmark
+
+} // namespace raptor
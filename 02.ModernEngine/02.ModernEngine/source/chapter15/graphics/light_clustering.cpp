@@ -0,0 +1,481 @@
+#include "graphics/light_clustering.hpp"
+
+#include "foundation/memory.hpp"
+#include "foundation/assert.hpp"
+#include "foundation/bit.hpp"
+#include "foundation/log.hpp"
+#include "foundation/numerics.hpp"
+#include "foundation/time.hpp"
+
+#include "external/tracy/tracy/Tracy.hpp"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+    #define RAPTOR_LIGHT_CLUSTERING_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace raptor {
+
+// Rows below this count per task partition are not worth a worker.
+static const u32 k_min_task_rows = 4;
+
+void LightClusteringTask::ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) {
+    ZoneScoped;
+
+    clustering->build_tile_rows( range_.start, range_.end );
+}
+
+static void set_empty_rects( LightClustering& clustering, u32 first, u32 last ) {
+    for ( u32 i = first; i < last; ++i ) {
+        clustering.rect_min_x[ i ] = 0;
+        clustering.rect_max_x[ i ] = -1;
+        clustering.rect_min_y[ i ] = i32_max;
+        clustering.rect_max_y[ i ] = -1;
+    }
+}
+
+void LightClustering::init( Allocator* allocator_, u32 max_lights_, u32 z_bin_count_, u32 tile_size_ ) {
+    RASSERTM( max_lights_ <= k_light_clustering_max_lights, "Light ids of the z bins are 16 bits, %u lights requested.", max_lights_ );
+    RASSERT( z_bin_count_ > 0 && tile_size_ > 0 );
+
+    allocator = allocator_;
+    max_lights = max_lights_;
+    word_count = ( max_lights + 31 ) / 32;
+    z_bin_count = z_bin_count_;
+    tile_size = tile_size_;
+    light_count = 0;
+    width = height = 0;
+    tile_x_count = tile_y_count = 0;
+
+    const u32 padded_lights = ( max_lights + 3 ) & ~3u;
+    const u32 slice_count = z_bin_count * k_sort_slices_per_bin;
+
+    sorted_lights.init( allocator, max_lights, max_lights );
+    z_bins.init( allocator, z_bin_count, z_bin_count );
+    tile_bits.init( allocator, 0 );
+
+    light_bin_ranges.init( allocator, max_lights, max_lights );
+    light_slices.init( allocator, max_lights, max_lights );
+    slice_offsets.init( allocator, slice_count + 1, slice_count + 1 );
+
+    rect_min_x.init( allocator, padded_lights, padded_lights );
+    rect_min_y.init( allocator, padded_lights, padded_lights );
+    rect_max_x.init( allocator, padded_lights, padded_lights );
+    rect_max_y.init( allocator, padded_lights, padded_lights );
+    set_empty_rects( *this, 0, padded_lights );
+
+    for ( u32 b = 0; b < z_bin_count; ++b ) {
+        z_bins[ b ] = k_light_z_bin_empty;
+    }
+
+    tiles_task.clustering = this;
+}
+
+void LightClustering::shutdown() {
+    sorted_lights.shutdown();
+    z_bins.shutdown();
+    tile_bits.shutdown();
+
+    light_bin_ranges.shutdown();
+    light_slices.shutdown();
+    slice_offsets.shutdown();
+
+    rect_min_x.shutdown();
+    rect_min_y.shutdown();
+    rect_max_x.shutdown();
+    rect_max_y.shutdown();
+}
+
+void LightClustering::resize( u32 width_, u32 height_ ) {
+    if ( width == width_ && height == height_ ) {
+        return;
+    }
+
+    width = width_;
+    height = height_;
+    tile_x_count = ( width + tile_size - 1 ) / tile_size;
+    tile_y_count = ( height + tile_size - 1 ) / tile_size;
+
+    const u64 tiles_entry_count = ( u64 )tile_x_count * tile_y_count * word_count;
+    RASSERTM( tiles_entry_count <= u32_max, "Too many light tiles, %u x %u tiles of %u words.", tile_x_count, tile_y_count, word_count );
+
+    tile_bits.set_size( ( u32 )tiles_entry_count );
+    memset( tile_bits.data, 0, get_tiles_size() );
+}
+
+u32 LightClustering::get_z_bin( f32 depth ) const {
+    const f32 slice = ( logf( raptor::max( depth, z_near ) ) - log_z_near ) * rcp_log_z_ratio * z_bin_count;
+    return ( u32 )raptor::min( slice, ( f32 )( z_bin_count - 1 ) );
+}
+
+void LightClustering::build_z_bins( const f32* light_depths, const f32* light_radii, u32 light_count_, f32 z_near_, f32 z_far_ ) {
+    ZoneScoped;
+
+    RASSERTM( light_count_ <= max_lights, "Clustering %u lights, initialized for %u.", light_count_, max_lights );
+
+    light_count = light_count_;
+    z_near = z_near_;
+    log_z_near = logf( z_near );
+    rcp_log_z_ratio = 1.0f / logf( z_far_ / z_near );
+
+    // Slices and bin ranges, counting the lights of each slice.
+    const u32 slice_count = z_bin_count * k_sort_slices_per_bin;
+    const f32 slice_scale = rcp_log_z_ratio * slice_count;
+
+    memset( slice_offsets.data, 0, slice_offsets.size * sizeof( u32 ) );
+
+    for ( u32 i = 0; i < light_count; ++i ) {
+        const f32 depth = light_depths[ i ];
+        const f32 radius = light_radii[ i ];
+
+        const f32 slice = ( logf( raptor::max( depth, z_near ) ) - log_z_near ) * slice_scale;
+        const u32 light_slice = ( u32 )raptor::min( slice, ( f32 )( slice_count - 1 ) );
+
+        light_slices[ i ] = light_slice;
+        ++slice_offsets[ light_slice ];
+
+        if ( depth + radius < z_near ) {
+            // NOTE: behind the camera, it still gets tiles but no bins.
+            light_bin_ranges[ i ] = u32_max;
+        } else {
+            light_bin_ranges[ i ] = get_z_bin( depth - radius ) | ( get_z_bin( depth + radius ) << 16 );
+        }
+    }
+
+    // Prefix sum of the counts gives the first sorted light of each slice, then a stable scatter.
+    u32 offset = 0;
+    for ( u32 s = 0; s < slice_count; ++s ) {
+        const u32 count = slice_offsets[ s ];
+        slice_offsets[ s ] = offset;
+        offset += count;
+    }
+    slice_offsets[ slice_count ] = offset;
+
+    for ( u32 i = 0; i < light_count; ++i ) {
+        sorted_lights[ slice_offsets[ light_slices[ i ] ]++ ] = i;
+    }
+
+    // Sorted lights come in increasing order, the first one touching a bin is its min and the last one its max.
+    for ( u32 b = 0; b < z_bin_count; ++b ) {
+        z_bins[ b ] = k_light_z_bin_empty;
+    }
+
+    for ( u32 s = 0; s < light_count; ++s ) {
+        const u32 bin_range = light_bin_ranges[ sorted_lights[ s ] ];
+        if ( bin_range == u32_max ) {
+            continue;
+        }
+
+        for ( u32 b = bin_range & 0xffff; b <= ( bin_range >> 16 ); ++b ) {
+            const u32 bin = z_bins[ b ];
+            const u32 min_light = ( bin & 0xffff ) > ( bin >> 16 ) ? s : bin & 0xffff;
+
+            z_bins[ b ] = min_light | ( s << 16 );
+        }
+    }
+
+    set_empty_rects( *this, 0, ( light_count + 3 ) & ~3u );
+}
+
+void LightClustering::set_light_rect( u32 sorted_light, f32 min_x, f32 min_y, f32 max_x, f32 max_y ) {
+    if ( max_x < min_x || max_y < min_y || max_x < 0.0f || max_y < 0.0f || min_x > width || min_y > height ) {
+        return;
+    }
+
+    const f32 tile_size_inv = 1.0f / tile_size;
+
+    rect_min_x[ sorted_light ] = ( i32 )( raptor::max( min_x, 0.0f ) * tile_size_inv );
+    rect_min_y[ sorted_light ] = ( i32 )( raptor::max( min_y, 0.0f ) * tile_size_inv );
+    rect_max_x[ sorted_light ] = ( i32 )raptor::min( tile_x_count - 1, ( u32 )( raptor::min( max_x, ( f32 )width ) * tile_size_inv ) );
+    rect_max_y[ sorted_light ] = ( i32 )raptor::min( tile_y_count - 1, ( u32 )( raptor::min( max_y, ( f32 )height ) * tile_size_inv ) );
+}
+
+void LightClustering::build_tiles( enki::TaskScheduler* task_scheduler ) {
+    ZoneScoped;
+
+    if ( task_scheduler && tile_y_count >= k_min_task_rows * 2 ) {
+        tiles_task.m_SetSize = tile_y_count;
+        tiles_task.m_MinRange = k_min_task_rows;
+
+        task_scheduler->AddTaskSetToPipe( &tiles_task );
+        task_scheduler->WaitforTask( &tiles_task );
+    } else {
+        build_tile_rows( 0, tile_y_count );
+    }
+}
+
+static inline void set_light_row_bits( LightClustering& clustering, u32* row_bits, u32 sorted_light ) {
+    const u32 word_index = sorted_light / 32;
+    const u32 bit = 1u << ( sorted_light % 32 );
+
+    for ( i32 x = clustering.rect_min_x[ sorted_light ]; x <= clustering.rect_max_x[ sorted_light ]; ++x ) {
+        row_bits[ x * clustering.word_count + word_index ] |= bit;
+    }
+}
+
+void LightClustering::build_tile_rows( u32 row_begin, u32 row_end ) {
+    const u32 row_words = tile_x_count * word_count;
+    memset( tile_bits.data + row_begin * row_words, 0, sizeof( u32 ) * row_words * ( row_end - row_begin ) );
+
+    const u32 padded_count = ( light_count + 3 ) & ~3u;
+
+    for ( u32 y = row_begin; y < row_end; ++y ) {
+        u32* row_bits = tile_bits.data + y * row_words;
+
+#if defined(RAPTOR_LIGHT_CLUSTERING_SSE2)
+        const __m128i row = _mm_set1_epi32( ( i32 )y );
+
+        for ( u32 l = 0; l < padded_count; l += 4 ) {
+            const __m128i min_y = _mm_loadu_si128( ( const __m128i* )( rect_min_y.data + l ) );
+            const __m128i max_y = _mm_loadu_si128( ( const __m128i* )( rect_max_y.data + l ) );
+            const __m128i outside = _mm_or_si128( _mm_cmpgt_epi32( min_y, row ), _mm_cmplt_epi32( max_y, row ) );
+
+            u32 inside_lanes = ~( u32 )_mm_movemask_ps( _mm_castsi128_ps( outside ) ) & 0xf;
+            while ( inside_lanes ) {
+                set_light_row_bits( *this, row_bits, l + trailing_zeros_u32( inside_lanes ) );
+                inside_lanes &= inside_lanes - 1;
+            }
+        }
+#else
+        for ( u32 l = 0; l < padded_count; ++l ) {
+            if ( rect_min_y[ l ] <= ( i32 )y && ( i32 )y <= rect_max_y[ l ] ) {
+                set_light_row_bits( *this, row_bits, l );
+            }
+        }
+#endif // RAPTOR_LIGHT_CLUSTERING_SSE2
+    }
+}
+
+// Benchmark //////////////////////////////////////////////////////////////
+
+struct BenchmarkLight {
+    f32             depth;
+    f32             radius;
+    f32             rect[ 4 ];      // Pixels, min x, min y, max x, max y.
+}; // struct BenchmarkLight
+
+struct BenchmarkSortedLight {
+    u32             light_index;
+    f32             depth;
+}; // struct BenchmarkSortedLight
+
+static int benchmark_sorting_light_fn( const void* a, const void* b ) {
+    const BenchmarkSortedLight* la = ( const BenchmarkSortedLight* )a;
+    const BenchmarkSortedLight* lb = ( const BenchmarkSortedLight* )b;
+
+    if ( la->depth < lb->depth ) return -1;
+    else if ( la->depth > lb->depth ) return 1;
+    return 0;
+}
+
+static f32 benchmark_random( u32& state ) {
+    state = state * 1664525u + 1013904223u;
+    return ( state >> 8 ) * ( 1.0f / 16777216.0f );
+}
+
+// The previous upload_gpu_data algorithm on the same bins and tile layout: every bin scans every light,
+// then every light sets its tiles one by one.
+static void light_clustering_nested_loops( const LightClustering& clustering, const BenchmarkLight* lights, const u32* order,
+                                           u32* z_bins, u32* tile_bits ) {
+    const u32 light_count = clustering.light_count;
+
+    for ( u32 bin = 0; bin < clustering.z_bin_count; ++bin ) {
+        u32 min_light_id = 0xffff;
+        u32 max_light_id = 0;
+
+        for ( u32 i = 0; i < light_count; ++i ) {
+            const BenchmarkLight& light = lights[ order[ i ] ];
+            if ( light.depth + light.radius < clustering.z_near ) {
+                continue;
+            }
+
+            const u32 min_bin = clustering.get_z_bin( light.depth - light.radius );
+            const u32 max_bin = clustering.get_z_bin( light.depth + light.radius );
+
+            if ( bin >= min_bin && bin <= max_bin ) {
+                min_light_id = raptor::min( min_light_id, i );
+                max_light_id = raptor::max( max_light_id, i );
+            }
+        }
+
+        z_bins[ bin ] = min_light_id | ( max_light_id << 16 );
+    }
+
+    memset( tile_bits, 0, clustering.get_tiles_size() );
+
+    const f32 tile_size_inv = 1.0f / clustering.tile_size;
+    const u32 tile_stride = clustering.tile_x_count * clustering.word_count;
+
+    for ( u32 i = 0; i < light_count; ++i ) {
+        const BenchmarkLight& light = lights[ order[ i ] ];
+
+        f32 min_x = light.rect[ 0 ], min_y = light.rect[ 1 ], max_x = light.rect[ 2 ], max_y = light.rect[ 3 ];
+        if ( max_x < min_x || max_y < min_y || max_x < 0.0f || max_y < 0.0f || min_x > clustering.width || min_y > clustering.height ) {
+            continue;
+        }
+
+        min_x = raptor::max( min_x, 0.0f );
+        min_y = raptor::max( min_y, 0.0f );
+        max_x = raptor::min( max_x, ( f32 )clustering.width );
+        max_y = raptor::min( max_y, ( f32 )clustering.height );
+
+        const u32 first_tile_x = ( u32 )( min_x * tile_size_inv );
+        const u32 last_tile_x = raptor::min( clustering.tile_x_count - 1, ( u32 )( max_x * tile_size_inv ) );
+        const u32 first_tile_y = ( u32 )( min_y * tile_size_inv );
+        const u32 last_tile_y = raptor::min( clustering.tile_y_count - 1, ( u32 )( max_y * tile_size_inv ) );
+
+        for ( u32 y = first_tile_y; y <= last_tile_y; ++y ) {
+            for ( u32 x = first_tile_x; x <= last_tile_x; ++x ) {
+                tile_bits[ y * tile_stride + x * clustering.word_count + i / 32 ] |= ( 1u << ( i % 32 ) );
+            }
+        }
+    }
+}
+
+static void light_clustering_build( LightClustering& clustering, const BenchmarkLight* lights, const f32* depths, const f32* radii, u32 light_count,
+                                    f32 z_near, f32 z_far, enki::TaskScheduler* task_scheduler ) {
+    clustering.build_z_bins( depths, radii, light_count, z_near, z_far );
+
+    for ( u32 s = 0; s < light_count; ++s ) {
+        const f32* rect = lights[ clustering.sorted_lights[ s ] ].rect;
+        clustering.set_light_rect( s, rect[ 0 ], rect[ 1 ], rect[ 2 ], rect[ 3 ] );
+    }
+
+    clustering.build_tiles( task_scheduler );
+}
+
+void light_clustering_benchmark( Allocator* allocator, enki::TaskScheduler* task_scheduler ) {
+    const u32 light_counts[] = { 256, 1024, 4096, 16384, 65536 };
+    const u32 resolutions[][ 2 ] = { { 1280, 720 }, { 1920, 1080 } };
+    const u32 num_builds = 4;
+    const u32 z_bin_count = 16;
+    const u32 tile_size = 8;
+    const f32 z_near = 0.1f;
+    const f32 z_far = 100.0f;
+    const f32 tan_half_fov = tanf( 0.5f * 1.0471975f );
+
+    rprint( "Light clustering benchmark: %u bins, %u pixels tiles, average of %u builds, %u threads.\n", z_bin_count, tile_size, num_builds,
+            task_scheduler ? task_scheduler->GetNumTaskThreads() : 1 );
+
+    const u32 max_lights = light_counts[ ArraySize( light_counts ) - 1 ];
+
+    Array<BenchmarkLight> lights;
+    lights.init( allocator, max_lights, max_lights );
+    Array<f32> depths;
+    depths.init( allocator, max_lights, max_lights );
+    Array<f32> radii;
+    radii.init( allocator, max_lights, max_lights );
+    Array<BenchmarkSortedLight> qsorted_lights;
+    qsorted_lights.init( allocator, max_lights, max_lights );
+    Array<u32> order;
+    order.init( allocator, max_lights, max_lights );
+    Array<u32> reference_z_bins;
+    reference_z_bins.init( allocator, z_bin_count, z_bin_count );
+    Array<u32> reference_tile_bits;
+    reference_tile_bits.init( allocator, 0 );
+
+    for ( u32 r = 0; r < ArraySize( resolutions ); ++r ) {
+        const u32 width = resolutions[ r ][ 0 ];
+        const u32 height = resolutions[ r ][ 1 ];
+        const f32 focal_pixels = 0.5f * height / tan_half_fov;
+
+        for ( u32 c = 0; c < ArraySize( light_counts ); ++c ) {
+            const u32 light_count = light_counts[ c ];
+
+            // Lights spread in log depth between 1 and past the far plane, one in 64 behind the camera without a rectangle.
+            u32 random_state = 1234567u + light_count;
+            for ( u32 i = 0; i < light_count; ++i ) {
+                BenchmarkLight& light = lights[ i ];
+                light.depth = powf( z_far * 1.2f, benchmark_random( random_state ) );
+                light.radius = 0.05f + benchmark_random( random_state ) * 0.45f;
+
+                const f32 center_x = benchmark_random( random_state ) * width;
+                const f32 center_y = benchmark_random( random_state ) * height;
+
+                if ( ( i % 64 ) == 63 ) {
+                    light.depth = -2.0f;
+                    light.rect[ 0 ] = light.rect[ 1 ] = 1.0f;
+                    light.rect[ 2 ] = light.rect[ 3 ] = 0.0f;
+                } else {
+                    const f32 radius_pixels = light.radius * focal_pixels / light.depth;
+                    light.rect[ 0 ] = center_x - radius_pixels;
+                    light.rect[ 1 ] = center_y - radius_pixels;
+                    light.rect[ 2 ] = center_x + radius_pixels;
+                    light.rect[ 3 ] = center_y + radius_pixels;
+                }
+
+                depths[ i ] = light.depth;
+                radii[ i ] = light.radius;
+            }
+
+            LightClustering clustering;
+            clustering.init( allocator, light_count, z_bin_count, tile_size );
+            clustering.resize( width, height );
+
+            // NOTE: the first build sets the bins scale used by the nested loops.
+            light_clustering_build( clustering, lights.data, depths.data, radii.data, light_count, z_near, z_far, nullptr );
+            reference_tile_bits.set_size( clustering.tile_bits.size );
+
+            i64 start = time_now();
+            for ( u32 b = 0; b < num_builds; ++b ) {
+                for ( u32 i = 0; i < light_count; ++i ) {
+                    qsorted_lights[ i ] = { i, lights[ i ].depth };
+                }
+                qsort( qsorted_lights.data, light_count, sizeof( BenchmarkSortedLight ), benchmark_sorting_light_fn );
+
+                for ( u32 i = 0; i < light_count; ++i ) {
+                    order[ i ] = qsorted_lights[ i ].light_index;
+                }
+                light_clustering_nested_loops( clustering, lights.data, order.data, reference_z_bins.data, reference_tile_bits.data );
+            }
+            const f64 reference_ms = time_from_milliseconds( start ) / num_builds;
+
+            start = time_now();
+            for ( u32 b = 0; b < num_builds; ++b ) {
+                light_clustering_build( clustering, lights.data, depths.data, radii.data, light_count, z_near, z_far, nullptr );
+            }
+            const f64 serial_ms = time_from_milliseconds( start ) / num_builds;
+
+            start = time_now();
+            for ( u32 b = 0; b < num_builds; ++b ) {
+                light_clustering_build( clustering, lights.data, depths.data, radii.data, light_count, z_near, z_far, task_scheduler );
+            }
+            const f64 parallel_ms = time_from_milliseconds( start ) / num_builds;
+
+            // Same algorithm as the nested loops on the clustering order, outputs have to match exactly.
+            light_clustering_nested_loops( clustering, lights.data, clustering.sorted_lights.data, reference_z_bins.data, reference_tile_bits.data );
+
+            u32 differences = 0;
+            for ( u32 b = 0; b < z_bin_count; ++b ) {
+                const u32 bin = clustering.z_bins[ b ];
+                const u32 reference_bin = reference_z_bins[ b ];
+                const bool empty = ( bin & 0xffff ) > ( bin >> 16 );
+                const bool reference_empty = ( reference_bin & 0xffff ) > ( reference_bin >> 16 );
+
+                differences += ( empty != reference_empty || ( !empty && bin != reference_bin ) ) ? 1 : 0;
+            }
+            for ( u32 w = 0; w < clustering.tile_bits.size; ++w ) {
+                differences += clustering.tile_bits[ w ] != reference_tile_bits[ w ] ? 1 : 0;
+            }
+
+            rprint( "%6u lights %4ux%4u | nested loops %9.3f ms | serial %8.3f ms | parallel %8.3f ms | tiles %7.1f MB, difference %u\n",
+                    light_count, width, height, reference_ms, serial_ms, parallel_ms, clustering.get_tiles_size() / ( 1024.0 * 1024.0 ), differences );
+
+            clustering.shutdown();
+        }
+    }
+
+    lights.shutdown();
+    depths.shutdown();
+    radii.shutdown();
+    qsorted_lights.shutdown();
+    order.shutdown();
+    reference_z_bins.shutdown();
+    reference_tile_bits.shutdown();
+}
+
+} // namespace raptor
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "foundation/array.hpp"
+
+#include "external/enkiTS/TaskScheduler.h"
+
+namespace raptor {
+
+    struct Allocator;
+
+    // Z bins store the first and last sorted light in 16 bits each, an empty bin has min > max.
+    static const u32                    k_light_z_bin_empty         = 0x0000ffff;
+    static const u32                    k_light_clustering_max_lights = 0x10000;
+
+    struct LightClustering;
+
+    //
+    // Fills the tile bits of a range of tile rows.
+    struct LightClusteringTask : public enki::ITaskSet {
+
+        void                            ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) override;
+
+        LightClustering*                clustering      = nullptr;
+
+    }; // struct LightClusteringTask
+
+    //
+    // CPU side of the clustered lighting: lights sorted by depth, a z bin LUT with the range of sorted lights
+    // touching each logarithmic depth slice, and a bit per sorted light for each screen tile.
+    // Tile bits are laid out as ( tile_y * tile_x_count + tile_x ) * word_count + light / 32.
+    // All sizes come from init and resize, the light count is bound by the 16 bits light ids of the LUT.
+    // The shaders read NUM_WORDS words per tile, the engine passes them max_lights as NUM_LIGHTS.
+    struct LightClustering {
+
+        // Depth slices of the sort, for each z bin.
+        static const u32                k_sort_slices_per_bin = 64;
+
+        void                            init( Allocator* allocator, u32 max_lights, u32 z_bin_count, u32 tile_size );
+        void                            shutdown();
+
+        // Reallocates the tiles when the resolution changes.
+        void                            resize( u32 width, u32 height );
+
+        // Counting sort of the lights on log depth slices, then a single pass over the sorted lights for the LUT.
+        // Depths are view space distances along the camera axis. Every sorted light starts without tiles.
+        void                            build_z_bins( const f32* light_depths, const f32* light_radii, u32 light_count, f32 z_near, f32 z_far );
+
+        // Pixel rectangle of a sorted light, clamped to the screen.
+        void                            set_light_rect( u32 sorted_light, f32 min_x, f32 min_y, f32 max_x, f32 max_y );
+
+        // Tile rows over the task scheduler when not null, each row tests 4 light rectangles at a time.
+        void                            build_tiles( enki::TaskScheduler* task_scheduler );
+        void                            build_tile_rows( u32 row_begin, u32 row_end );
+
+        u32                             get_z_bin( f32 depth ) const;
+        sizet                           get_tiles_size() const      { return tile_bits.size * sizeof( u32 ); }
+
+        Array<u32>                      sorted_lights;      // Light index of each sorted light, as uploaded to the GPU.
+        Array<u32>                      z_bins;
+        Array<u32>                      tile_bits;
+
+        // Sort and bins scratch, for each light.
+        Array<u32>                      light_bin_ranges;   // First bin in the low 16 bits, last one in the high ones, u32_max if behind the camera.
+        Array<u32>                      light_slices;
+        Array<u32>                      slice_offsets;
+
+        // Tile rectangles of the sorted lights, inclusive and padded to a multiple of 4 with empty ones.
+        Array<i32>                      rect_min_x;
+        Array<i32>                      rect_min_y;
+        Array<i32>                      rect_max_x;
+        Array<i32>                      rect_max_y;
+
+        LightClusteringTask             tiles_task;
+
+        Allocator*                      allocator       = nullptr;
+
+        u32                             max_lights      = 0;
+        u32                             light_count     = 0;
+        u32                             word_count      = 0;
+        u32                             z_bin_count     = 0;
+
+        u32                             tile_size       = 0;
+        u32                             width           = 0;
+        u32                             height          = 0;
+        u32                             tile_x_count    = 0;
+        u32                             tile_y_count    = 0;
+
+        f32                             z_near          = 0.f;
+        f32                             log_z_near      = 0.f;
+        f32                             rcp_log_z_ratio = 0.f;
+
+    }; // struct LightClustering
+
+    // Random lights at growing counts and resolutions: nested loops and serial tiles against the clustering, serial and parallel.
+    void                                light_clustering_benchmark( Allocator* allocator, enki::TaskScheduler* task_scheduler );
+
+} // namespace raptor
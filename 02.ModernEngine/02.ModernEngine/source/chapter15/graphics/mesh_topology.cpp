@@ -0,0 +1,114 @@
+#include "graphics/mesh_topology.hpp"
+
+#include "foundation/assert.hpp"
+#include "foundation/hash_map.hpp"
+#include "foundation/numerics.hpp"
+
+#include <string.h>
+
+namespace raptor {
+
+// Turns counts into start offsets through the items, so that the offsets are the list ends after scattering.
+// Shifting them back gives the starts again.
+static void offsets_from_counts( Array<u32>& offsets ) {
+    u32 offset = 0;
+    for ( u32 i = 0; i < offsets.size - 1; ++i ) {
+        const u32 count = offsets[ i ];
+        offsets[ i ] = offset;
+        offset += count;
+    }
+    offsets[ offsets.size - 1 ] = offset;
+}
+
+static void offsets_shift_back( Array<u32>& offsets ) {
+    for ( u32 i = offsets.size - 1; i > 0; --i ) {
+        offsets[ i ] = offsets[ i - 1 ];
+    }
+    offsets[ 0 ] = 0;
+}
+
+void MeshTopology::init( Allocator* allocator, const u32* indices_, u32 index_count, u32 vertex_count ) {
+    indices = indices_;
+    face_count = index_count / 3;
+    edge_count = 0;
+
+    const u32 half_edge_count = face_count * 3;
+
+    // Undirected edges are keyed by their sorted vertex pair.
+    FlatHashMap<u64, u32> edge_map;
+    edge_map.init( allocator, half_edge_count );
+
+    half_edge_edges.init( allocator, half_edge_count, half_edge_count );
+    for ( u32 e = 0; e < half_edge_count; ++e ) {
+        const u32 v0 = indices[ e ];
+        const u32 v1 = indices[ ( e % 3 ) == 2 ? e - 2 : e + 1 ];
+        RASSERTM( v0 < vertex_count && v1 < vertex_count, "Index out of the vertex range" );
+        const u64 key = ( ( u64 )raptor::min( v0, v1 ) << 32 ) | raptor::max( v0, v1 );
+
+        FlatHashMapIterator it = edge_map.find( key );
+        if ( it.is_valid() ) {
+            half_edge_edges[ e ] = edge_map.get( it );
+        } else {
+            edge_map.insert( key, edge_count );
+            half_edge_edges[ e ] = edge_count++;
+        }
+    }
+
+    edge_map.shutdown();
+
+    // Half edges grouped by edge.
+    edge_offsets.init( allocator, edge_count + 1, edge_count + 1 );
+    memset( edge_offsets.data, 0, edge_offsets.size * sizeof( u32 ) );
+    for ( u32 e = 0; e < half_edge_count; ++e ) {
+        ++edge_offsets[ half_edge_edges[ e ] ];
+    }
+    offsets_from_counts( edge_offsets );
+
+    edge_half_edges.init( allocator, half_edge_count, half_edge_count );
+    for ( u32 e = 0; e < half_edge_count; ++e ) {
+        edge_half_edges[ edge_offsets[ half_edge_edges[ e ] ]++ ] = e;
+    }
+    offsets_shift_back( edge_offsets );
+}
+
+void MeshTopology::shutdown() {
+    half_edge_edges.shutdown();
+    edge_offsets.shutdown();
+    edge_half_edges.shutdown();
+}
+
+void MeshTopology::get_face_neighbours( u32 face, Array<u32>& neighbours ) const {
+    neighbours.clear();
+
+    for ( u32 e = face * 3; e < face * 3 + 3; ++e ) {
+        const u32 edge = half_edge_edges[ e ];
+
+        for ( u32 i = edge_offsets[ edge ]; i < edge_offsets[ edge + 1 ]; ++i ) {
+            const u32 other_face = edge_half_edges[ i ] / 3;
+            if ( other_face == face ) {
+                continue;
+            }
+
+            // Faces sharing more than one edge are only listed once.
+            bool found = false;
+            for ( u32 n = 0; n < neighbours.size && !found; ++n ) {
+                found = neighbours[ n ] == other_face;
+            }
+            if ( !found ) {
+                neighbours.push( other_face );
+            }
+        }
+    }
+
+    // Few neighbours, insertion sort.
+    for ( u32 i = 1; i < neighbours.size; ++i ) {
+        const u32 value = neighbours[ i ];
+        u32 j = i;
+        for ( ; j > 0 && neighbours[ j - 1 ] > value; --j ) {
+            neighbours[ j ] = neighbours[ j - 1 ];
+        }
+        neighbours[ j ] = value;
+    }
+}
+
+} // namespace raptor
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "foundation/array.hpp"
+
+namespace raptor {
+
+    struct Allocator;
+
+    static const u32                    k_invalid_mesh_element = 0xffffffff;
+
+    //
+    // Edge adjacency of an indexed triangle list, built in linear time.
+    // Half edge e goes from corner e % 3 to the next corner of face e / 3.
+    // Adjacency lists are in face order, so that users iterate faces as a full scan would.
+    struct MeshTopology {
+
+        void                            init( Allocator* allocator, const u32* indices, u32 index_count, u32 vertex_count );
+        void                            shutdown();
+
+        // Faces sharing an edge with the face, in ascending order and without the face itself.
+        void                            get_face_neighbours( u32 face, Array<u32>& neighbours ) const;
+
+        const u32*                      indices         = nullptr;
+
+        Array<u32>                      half_edge_edges;        // Undirected edge of each half edge.
+        Array<u32>                      edge_offsets;           // First half edge of each edge in edge_half_edges, plus the end.
+        Array<u32>                      edge_half_edges;
+
+        u32                             face_count      = 0;
+        u32                             edge_count      = 0;
+
+    }; // struct MeshTopology
+
+} // namespace raptor
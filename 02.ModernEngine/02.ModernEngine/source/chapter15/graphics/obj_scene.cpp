@@ -3,6 +3,8 @@
 #include "graphics/raptor_imgui.hpp"
 #include "graphics/scene_graph.hpp"
 #include "graphics/asynchronous_loader.hpp"
+#include "graphics/mesh_topology.hpp"
+#include "graphics/texture_cooker.hpp"
 
 #include "foundation/file.hpp"
 #include "foundation/time.hpp"
@@ -49,131 +51,60 @@ static bool is_shared_vertex( PhysicsVertex* vertices, PhysicsVertex& src, u32 d
     return ( distance <= max_distance );
 }
 
-static void compute_joints( aiMesh* mesh, PhysicsMesh* physics_mesh ) {
+//
+// Adds the vertex of the other face across the edge x, y, when the other face has that edge.
+// Checks are in the order of the previous all faces scan, as is_shared_vertex depends on the joints already added.
+static void add_diagonal_joint( PhysicsVertex* vertices, PhysicsVertex& vertex, const u32* other_indices, u32 x, u32 y ) {
+    const u32 other_index_a = other_indices[ 0 ];
+    const u32 other_index_b = other_indices[ 1 ];
+    const u32 other_index_c = other_indices[ 2 ];
+
+    if ( ( other_index_a == x && other_index_b == y ) || ( other_index_a == y && other_index_b == x ) ) {
+        if ( is_shared_vertex( vertices, vertex, other_index_c ) ) {
+            vertex.add_joint( other_index_c );
+        }
+    }
+    if ( ( other_index_a == x && other_index_c == y ) || ( other_index_a == y && other_index_c == x ) ) {
+        if ( is_shared_vertex( vertices, vertex, other_index_b ) ) {
+            vertex.add_joint( other_index_b );
+        }
+    }
+    if ( ( other_index_c == x && other_index_b == y ) || ( other_index_c == y && other_index_b == x ) ) {
+        if ( is_shared_vertex( vertices, vertex, other_index_a ) ) {
+            vertex.add_joint( other_index_a );
+        }
+    }
+}
+
+static void compute_joints( const MeshTopology& topology, PhysicsMesh* physics_mesh, Array<u32>& neighbours ) {
     // NOTE(marco): compute cloth joints
-    for ( u32 face_index = 0; face_index < mesh->mNumFaces; ++face_index ) {
-        u32 index_a = mesh->mFaces[ face_index ].mIndices[ 0 ];
-        u32 index_b = mesh->mFaces[ face_index ].mIndices[ 1 ];
-        u32 index_c = mesh->mFaces[ face_index ].mIndices[ 2 ];
+    PhysicsVertex* vertices = physics_mesh->vertices.data;
 
-        PhysicsVertex& vertex_a = physics_mesh->vertices[ index_a ];
+    for ( u32 face_index = 0; face_index < topology.face_count; ++face_index ) {
+        u32 index_a = topology.indices[ face_index * 3 + 0 ];
+        u32 index_b = topology.indices[ face_index * 3 + 1 ];
+        u32 index_c = topology.indices[ face_index * 3 + 2 ];
+
+        PhysicsVertex& vertex_a = vertices[ index_a ];
         vertex_a.add_joint( index_b );
         vertex_a.add_joint( index_c );
 
-        PhysicsVertex& vertex_b = physics_mesh->vertices[ index_b ];
+        PhysicsVertex& vertex_b = vertices[ index_b ];
         vertex_b.add_joint( index_a );
         vertex_b.add_joint( index_c );
 
-        PhysicsVertex& vertex_c = physics_mesh->vertices[ index_c ];
+        PhysicsVertex& vertex_c = vertices[ index_c ];
         vertex_c.add_joint( index_a );
         vertex_c.add_joint( index_b );
 
-        // NOTE(marco): check for adjacent triangles to get diagonal joints
-        for ( u32 other_face_index = 0; other_face_index < mesh->mNumFaces; ++other_face_index ) {
-            if ( other_face_index == face_index ) {
-                continue;
-            }
-
-            u32 other_index_a = mesh->mFaces[ other_face_index ].mIndices[ 0 ];
-            u32 other_index_b = mesh->mFaces[ other_face_index ].mIndices[ 1 ];
-            u32 other_index_c = mesh->mFaces[ other_face_index ].mIndices[ 2 ];
-
-            // check for vertex_a
-            if ( other_index_a == index_b && other_index_b == index_c ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_a, other_index_c ) ) {
-                    vertex_a.add_joint( other_index_c );
-                }
-            }
-            if ( other_index_a == index_c && other_index_b == index_b ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_a, other_index_c ) ) {
-                    vertex_a.add_joint( other_index_c );
-                }
-            }
-            if ( other_index_a == index_b && other_index_c == index_c ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_a, other_index_b ) ) {
-                    vertex_a.add_joint( other_index_b );
-                }
-            }
-            if ( other_index_a == index_c && other_index_c == index_b ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_a, other_index_b ) ) {
-                    vertex_a.add_joint( other_index_b );
-                }
-            }
-            if ( other_index_c == index_b && other_index_b == index_c ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_a, other_index_a ) ) {
-                    vertex_a.add_joint( other_index_a );
-                }
-            }
-            if ( other_index_c == index_c && other_index_b == index_b ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_a, other_index_a ) ) {
-                    vertex_a.add_joint( other_index_a );
-                }
-            }
-
-            // check for vertex_b
-            if ( other_index_a == index_a && other_index_b == index_c ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_b, other_index_c ) ) {
-                    vertex_b.add_joint( other_index_c );
-                }
-            }
-            if ( other_index_a == index_c && other_index_b == index_a ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_b, other_index_c ) ) {
-                    vertex_b.add_joint( other_index_c );
-                }
-            }
-            if ( other_index_a == index_a && other_index_c == index_c ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_b, other_index_b ) ) {
-                    vertex_b.add_joint( other_index_b );
-                }
-            }
-            if ( other_index_a == index_c && other_index_c == index_a ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_b, other_index_b ) ) {
-                    vertex_b.add_joint( other_index_b );
-                }
-            }
-            if ( other_index_c == index_a && other_index_b == index_c ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_b, other_index_a ) ) {
-                    vertex_b.add_joint( other_index_a );
-                }
-            }
-            if ( other_index_c == index_c && other_index_b == index_a ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_b, other_index_a) ) {
-                    vertex_b.add_joint( other_index_a );
-                }
-            }
-
-            // check for vertex_c
-            if ( other_index_a == index_a && other_index_b == index_b ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_c, other_index_c ) ) {
-                    vertex_c.add_joint( other_index_c );
-                }
-            }
-            if ( other_index_a == index_b && other_index_b == index_a ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_c, other_index_c ) ) {
-                    vertex_c.add_joint( other_index_c );
-                }
-            }
-            if ( other_index_a == index_a && other_index_c == index_b ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_c, other_index_b ) ) {
-                    vertex_c.add_joint( other_index_b );
-                }
-            }
-            if ( other_index_a == index_b && other_index_c == index_a ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_c, other_index_b ) ) {
-                    vertex_c.add_joint( other_index_b );
-                }
-            }
+        // Diagonal joints come from the faces across each edge, found through the edge adjacency.
+        topology.get_face_neighbours( face_index, neighbours );
+        for ( u32 n = 0; n < neighbours.size; ++n ) {
+            const u32* other_indices = topology.indices + neighbours[ n ] * 3;
 
-            if ( other_index_c == index_a && other_index_b == index_b ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_c, other_index_a ) ) {
-                    vertex_c.add_joint( other_index_a );
-                }
-            }
-            if ( other_index_c == index_b && other_index_b == index_a ) {
-                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_c, other_index_a ) ) {
-                    vertex_c.add_joint( other_index_a );
-                }
-            }
+            add_diagonal_joint( vertices, vertex_a, other_indices, index_b, index_c );
+            add_diagonal_joint( vertices, vertex_b, other_indices, index_a, index_c );
+            add_diagonal_joint( vertices, vertex_c, other_indices, index_a, index_b );
         }
     }
 }
@@ -366,7 +297,20 @@ void ObjScene::add_mesh( cstring filename, cstring path, StackAllocator* temp_al
         }
 
         if ( k_enable_physics ) {
-            compute_joints( mesh, physics_mesh );
+            const u32 mesh_index_count = mesh->mNumFaces * 3;
+
+            MeshTopology topology;
+            topology.init( resident_allocator, indices.data + indices.size - mesh_index_count, mesh_index_count, mesh->mNumVertices );
+
+            Array<u32> neighbours;
+            neighbours.init( resident_allocator, 16 );
+
+            compute_joints( topology, physics_mesh, neighbours );
+
+            neighbours.shutdown();
+            topology.shutdown();
+
+            physics_mesh->cpu_solver.init( resident_allocator, physics_mesh->vertices.data, physics_mesh->vertices.size, indices.data + indices.size - mesh_index_count, mesh_index_count );
         }
 
         render_mesh.position_offset = positions_offset;
@@ -474,6 +418,12 @@ void ObjScene::add_mesh( cstring filename, cstring path, StackAllocator* temp_al
             async_loader->request_buffer_copy( cpu_buffer, gpu_buffer->handle );
 
             indirect_commands.shutdown();
+
+            // Staging for the CPU cloth solver output, positions and normals for each frame in flight.
+            buffer_size = sizeof( vec3s ) * physics_mesh->vertices.size * 2 * k_max_frames;
+            creation.reset().set( VK_BUFFER_USAGE_TRANSFER_SRC_BIT, ResourceUsageType::Stream, buffer_size ).set_data( nullptr ).set_name( "cloth_attributes_cpu" ).set_persistent( true );
+
+            physics_mesh->cpu_attributes_buffer = renderer->gpu->create_buffer( creation );
         }
 
         meshes.push( render_mesh );
@@ -586,10 +536,27 @@ u32 ObjScene::load_texture( cstring texture_path, cstring path, AsynchronousLoad
 
     int comp, width, height;
 
-    stbi_info( texture_path, &width, &height, &comp );
+    StringBuffer name_buffer;
+    name_buffer.init( 4096, temp_allocator );
 
+    // Reconstruct file path
+    char* full_filename = name_buffer.append_use_f( "%s%s", path, texture_path );
+
+    // Cooked textures carry their own format and mips.
+    VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
     u32 mip_levels = 1;
-    if ( true ) {
+    char cooked_path[ 512 ];
+    Ktx2Info cooked_info;
+    if ( renderer->gpu->texture_compression_bc_present && texture_find_cooked( full_filename, cooked_path, ArraySize( cooked_path ), cooked_info ) ) {
+        width = cooked_info.width;
+        height = cooked_info.height;
+        format = cooked_info.format;
+        mip_levels = cooked_info.level_count;
+        full_filename = cooked_path;
+    }
+    else {
+        stbi_info( texture_path, &width, &height, &comp );
+
         u32 w = width;
         u32 h = height;
 
@@ -602,7 +569,7 @@ u32 ObjScene::load_texture( cstring texture_path, cstring path, AsynchronousLoad
     }
 
     TextureCreation tc;
-    tc.set_data( nullptr ).set_format_type( VK_FORMAT_R8G8B8A8_UNORM, TextureType::Texture2D ).set_mips(  mip_levels ).set_size( ( u16 )width, ( u16 )height, 1 ).set_name( nullptr );
+    tc.set_data( nullptr ).set_format_type( format, TextureType::Texture2D ).set_mips(  mip_levels ).set_size( ( u16 )width, ( u16 )height, 1 ).set_name( nullptr );
     TextureResource* tr = renderer->create_texture( tc );
     RASSERT( tr != nullptr );
 
@@ -610,11 +577,6 @@ u32 ObjScene::load_texture( cstring texture_path, cstring path, AsynchronousLoad
 
     renderer->gpu->link_texture_sampler( tr->handle, sampler->handle );
 
-    StringBuffer name_buffer;
-    name_buffer.init( 4096, temp_allocator );
-
-    // Reconstruct file path
-    char* full_filename = name_buffer.append_use_f( "%s%s", path, texture_path );
     async_loader->request_texture_data( full_filename, tr->handle );
     // Reset name buffer
     name_buffer.clear();
@@ -637,6 +599,9 @@ void ObjScene::shutdown( Renderer* renderer ) {
             gpu.destroy_descriptor_set( physics_mesh->descriptor_set );
             gpu.destroy_descriptor_set( physics_mesh->debug_mesh_descriptor_set );
 
+            gpu.destroy_buffer( physics_mesh->cpu_attributes_buffer );
+
+            physics_mesh->cpu_solver.shutdown();
             physics_mesh->vertices.shutdown();
 
             resident_allocator->deallocate( physics_mesh );
@@ -684,7 +649,7 @@ void ObjScene::prepare_draws( Renderer* renderer, StackAllocator* scratch_alloca
     path_buffer.init( 1024, scratch_allocator );
 
     // Create material
-    const u64 main_hashed_name = hash_calculate( "main" );
+    const u64 main_hashed_name = rhash( "main" );
     GpuTechnique* main_technique = renderer->resource_cache.techniques.get( main_hashed_name );
 
     MaterialCreation material_creation;
@@ -692,10 +657,10 @@ void ObjScene::prepare_draws( Renderer* renderer, StackAllocator* scratch_alloca
 
     Material* pbr_material = renderer->create_material( material_creation );
 
-    const u64 cloth_hashed_name = hash_calculate( "cloth" );
+    const u64 cloth_hashed_name = rhash( "cloth" );
     GpuTechnique* cloth_technique = renderer->resource_cache.techniques.get( cloth_hashed_name );
 
-    const u64 debug_hashed_name = hash_calculate( "debug" );
+    const u64 debug_hashed_name = rhash( "debug" );
     GpuTechnique* debug_technique = renderer->resource_cache.techniques.get( debug_hashed_name );
 
     // Constant buffer
@@ -762,4 +727,227 @@ void ObjScene::prepare_draws( Renderer* renderer, StackAllocator* scratch_alloca
     assimp_scenes.shutdown();
 }
 
+// Benchmark //////////////////////////////////////////////////////////////
+
+//
+// Previous joints construction, comparing every face with every other face.
+static void compute_joints_face_scan( const u32* indices, u32 face_count, PhysicsMesh* physics_mesh ) {
+    for ( u32 face_index = 0; face_index < face_count; ++face_index ) {
+        u32 index_a = indices[ face_index * 3 + 0 ];
+        u32 index_b = indices[ face_index * 3 + 1 ];
+        u32 index_c = indices[ face_index * 3 + 2 ];
+
+        PhysicsVertex& vertex_a = physics_mesh->vertices[ index_a ];
+        vertex_a.add_joint( index_b );
+        vertex_a.add_joint( index_c );
+
+        PhysicsVertex& vertex_b = physics_mesh->vertices[ index_b ];
+        vertex_b.add_joint( index_a );
+        vertex_b.add_joint( index_c );
+
+        PhysicsVertex& vertex_c = physics_mesh->vertices[ index_c ];
+        vertex_c.add_joint( index_a );
+        vertex_c.add_joint( index_b );
+
+        // NOTE(marco): check for adjacent triangles to get diagonal joints
+        for ( u32 other_face_index = 0; other_face_index < face_count; ++other_face_index ) {
+            if ( other_face_index == face_index ) {
+                continue;
+            }
+
+            u32 other_index_a = indices[ other_face_index * 3 + 0 ];
+            u32 other_index_b = indices[ other_face_index * 3 + 1 ];
+            u32 other_index_c = indices[ other_face_index * 3 + 2 ];
+
+            // check for vertex_a
+            if ( other_index_a == index_b && other_index_b == index_c ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_a, other_index_c ) ) {
+                    vertex_a.add_joint( other_index_c );
+                }
+            }
+            if ( other_index_a == index_c && other_index_b == index_b ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_a, other_index_c ) ) {
+                    vertex_a.add_joint( other_index_c );
+                }
+            }
+            if ( other_index_a == index_b && other_index_c == index_c ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_a, other_index_b ) ) {
+                    vertex_a.add_joint( other_index_b );
+                }
+            }
+            if ( other_index_a == index_c && other_index_c == index_b ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_a, other_index_b ) ) {
+                    vertex_a.add_joint( other_index_b );
+                }
+            }
+            if ( other_index_c == index_b && other_index_b == index_c ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_a, other_index_a ) ) {
+                    vertex_a.add_joint( other_index_a );
+                }
+            }
+            if ( other_index_c == index_c && other_index_b == index_b ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_a, other_index_a ) ) {
+                    vertex_a.add_joint( other_index_a );
+                }
+            }
+
+            // check for vertex_b
+            if ( other_index_a == index_a && other_index_b == index_c ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_b, other_index_c ) ) {
+                    vertex_b.add_joint( other_index_c );
+                }
+            }
+            if ( other_index_a == index_c && other_index_b == index_a ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_b, other_index_c ) ) {
+                    vertex_b.add_joint( other_index_c );
+                }
+            }
+            if ( other_index_a == index_a && other_index_c == index_c ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_b, other_index_b ) ) {
+                    vertex_b.add_joint( other_index_b );
+                }
+            }
+            if ( other_index_a == index_c && other_index_c == index_a ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_b, other_index_b ) ) {
+                    vertex_b.add_joint( other_index_b );
+                }
+            }
+            if ( other_index_c == index_a && other_index_b == index_c ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_b, other_index_a ) ) {
+                    vertex_b.add_joint( other_index_a );
+                }
+            }
+            if ( other_index_c == index_c && other_index_b == index_a ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_b, other_index_a) ) {
+                    vertex_b.add_joint( other_index_a );
+                }
+            }
+
+            // check for vertex_c
+            if ( other_index_a == index_a && other_index_b == index_b ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_c, other_index_c ) ) {
+                    vertex_c.add_joint( other_index_c );
+                }
+            }
+            if ( other_index_a == index_b && other_index_b == index_a ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_c, other_index_c ) ) {
+                    vertex_c.add_joint( other_index_c );
+                }
+            }
+            if ( other_index_a == index_a && other_index_c == index_b ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_c, other_index_b ) ) {
+                    vertex_c.add_joint( other_index_b );
+                }
+            }
+            if ( other_index_a == index_b && other_index_c == index_a ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_c, other_index_b ) ) {
+                    vertex_c.add_joint( other_index_b );
+                }
+            }
+
+            if ( other_index_c == index_a && other_index_b == index_b ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_c, other_index_a ) ) {
+                    vertex_c.add_joint( other_index_a );
+                }
+            }
+            if ( other_index_c == index_b && other_index_b == index_a ) {
+                if ( is_shared_vertex( physics_mesh->vertices.data, vertex_c, other_index_a ) ) {
+                    vertex_c.add_joint( other_index_a );
+                }
+            }
+        }
+    }
+}
+
+static void cloth_joints_benchmark_init_mesh( PhysicsMesh& physics_mesh, Allocator* allocator, u32 vertex_side ) {
+    const u32 vertex_count = vertex_side * vertex_side;
+    physics_mesh.vertices.init( allocator, vertex_count );
+
+    for ( u32 v = 0; v < vertex_count; ++v ) {
+        PhysicsVertex physics_vertex{ };
+        physics_vertex.start_position = vec3s{ ( v % vertex_side ) * 0.1f, 0.f, ( v / vertex_side ) * 0.1f };
+        physics_mesh.vertices.push( physics_vertex );
+    }
+}
+
+void cloth_joints_benchmark( Allocator* allocator, u32 max_grid_size ) {
+    static const u32 k_grid_sizes[] = { 16, 32, 64, 128, 181 };
+    // The face scan of 64K triangles takes minutes.
+    static const u32 k_max_face_scan_count = 32768;
+
+    rprint( "Cloth joints benchmark: square grids, two triangles per quad.\n" );
+
+    for ( u32 g = 0; g < ArraySize( k_grid_sizes ) && k_grid_sizes[ g ] <= max_grid_size; ++g ) {
+        const u32 grid_size = k_grid_sizes[ g ];
+        const u32 vertex_side = grid_size + 1;
+        const u32 face_count = grid_size * grid_size * 2;
+
+        u32* indices = ( u32* )ralloca( sizeof( u32 ) * face_count * 3, allocator );
+        u32* index = indices;
+        for ( u32 z = 0; z < grid_size; ++z ) {
+            for ( u32 x = 0; x < grid_size; ++x ) {
+                const u32 i0 = z * vertex_side + x;
+                const u32 i1 = i0 + 1;
+                const u32 i2 = i0 + vertex_side;
+                const u32 i3 = i2 + 1;
+
+                *index++ = i0; *index++ = i2; *index++ = i1;
+                *index++ = i1; *index++ = i2; *index++ = i3;
+            }
+        }
+
+        PhysicsMesh scan_mesh{ };
+        cloth_joints_benchmark_init_mesh( scan_mesh, allocator, vertex_side );
+        PhysicsMesh topology_mesh{ };
+        cloth_joints_benchmark_init_mesh( topology_mesh, allocator, vertex_side );
+
+        const bool face_scan = face_count <= k_max_face_scan_count;
+
+        i64 start = time_now();
+        if ( face_scan ) {
+            compute_joints_face_scan( indices, face_count, &scan_mesh );
+        }
+        const f64 scan_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        MeshTopology topology;
+        topology.init( allocator, indices, face_count * 3, vertex_side * vertex_side );
+        const f64 topology_ms = time_from_milliseconds( start );
+
+        Array<u32> neighbours;
+        neighbours.init( allocator, 16 );
+        compute_joints( topology, &topology_mesh, neighbours );
+        const f64 joints_ms = time_from_milliseconds( start );
+
+        // Joints must be the same, in the same order.
+        u32 different_vertices = 0;
+        u32 joint_count = 0;
+        for ( u32 v = 0; v < topology_mesh.vertices.size; ++v ) {
+            const PhysicsVertex& a = scan_mesh.vertices[ v ];
+            const PhysicsVertex& b = topology_mesh.vertices[ v ];
+
+            bool same = a.joint_count == b.joint_count;
+            for ( u32 j = 0; same && j < a.joint_count; ++j ) {
+                same = a.joints[ j ].vertex_index == b.joints[ j ].vertex_index;
+            }
+            different_vertices += same ? 0 : 1;
+            joint_count += b.joint_count;
+        }
+
+        if ( face_scan ) {
+            rprint( "%6u triangles | face scan %10.2f ms | edge adjacency %7.2f ms (topology %6.2f ms) | %7u joints, %u vertices differ\n",
+                    face_count, scan_ms, joints_ms, topology_ms, joint_count, different_vertices );
+        } else {
+            rprint( "%6u triangles | face scan    skipped    | edge adjacency %7.2f ms (topology %6.2f ms) | %7u joints\n",
+                    face_count, joints_ms, topology_ms, joint_count );
+        }
+
+        neighbours.shutdown();
+        topology.shutdown();
+        topology_mesh.vertices.shutdown();
+        scan_mesh.vertices.shutdown();
+        rfree( indices, allocator );
+    }
+}
+
 } // namespace raptor
@@ -30,4 +30,7 @@ namespace raptor
 
     }; // struct ObjScene
 
+    // Cloth joints of generated grids up to 64K triangles, edge adjacency against comparing all faces pairs.
+    void                                        cloth_joints_benchmark( Allocator* allocator, u32 max_grid_size );
+
 } // namespace raptor
@@ -23,6 +23,7 @@ static raptor::DescriptorSetLayoutHandle g_descriptor_set_layout;
 static raptor::DescriptorSetHandle g_ui_descriptor_set;  // Font descriptor set
 
 static uint32_t g_vb_size = 665536, g_ib_size = 665536;
+static bool g_sdl_backend = true;
 
 raptor::FlatHashMap<raptor::ResourceHandle, raptor::ResourceHandle> g_texture_to_descriptor_set;
 
@@ -106,7 +107,10 @@ void ImGuiService::init( void* configuration ) {
     ImGui::StyleColorsDark();
 
     // Setup Platform/Renderer bindings
-    ImGui_ImplSDL2_InitForVulkan( (SDL_Window*)imgui_config->window_handle );
+    g_sdl_backend = imgui_config->window_handle != nullptr;
+    if ( g_sdl_backend ) {
+        ImGui_ImplSDL2_InitForVulkan( (SDL_Window*)imgui_config->window_handle );
+    }
 
     ImGuiIO& io = ImGui::GetIO();
     io.BackendRendererName = "Raptor_ImGui";
@@ -218,12 +222,21 @@ void ImGuiService::shutdown() {
     gpu->destroy_texture( g_font_texture );
 
 
-    ImGui_ImplSDL2_Shutdown();
+    if ( g_sdl_backend ) {
+        ImGui_ImplSDL2_Shutdown();
+    }
     ImGui::DestroyContext();
 }
 
 void ImGuiService::new_frame() {
-    ImGui_ImplSDL2_NewFrame();
+    if ( g_sdl_backend ) {
+        ImGui_ImplSDL2_NewFrame();
+    } else {
+        // Headless: no platform backend, the display is the offscreen swapchain.
+        ImGuiIO& io = ImGui::GetIO();
+        io.DisplaySize = ImVec2( ( f32 )gpu->swapchain_width, ( f32 )gpu->swapchain_height );
+        io.DeltaTime = 1.f / 60.f;
+    }
     ImGui::NewFrame();
 }
 
@@ -26,7 +26,7 @@ enum ImGuiStyles {
 struct ImGuiServiceConfiguration {
 
     GpuDevice*                      gpu;
-    void*                           window_handle;
+    void*                           window_handle;  // Null for headless runs, without the SDL backend.
 
 }; // struct ImGuiServiceConfiguration
 
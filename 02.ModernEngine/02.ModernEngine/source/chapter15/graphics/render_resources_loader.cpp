@@ -1,5 +1,6 @@
 #include "graphics/render_resources_loader.hpp"
 #include "graphics/frame_graph.hpp"
+#include "graphics/texture_cooker.hpp"
 
 #include "foundation/file.hpp"
 #include "foundation/time.hpp"
@@ -15,20 +16,24 @@ namespace raptor {
 static u64              shader_concatenate( cstring filename, raptor::StringBuffer& path_buffer, raptor::StringBuffer& shader_buffer, raptor::Allocator* temp_allocator );
 static VkBlendFactor    get_blend_factor( const std::string factor );
 static VkBlendOp        get_blend_op( const std::string op );
+static bool             get_shader_stage( const std::string& name, VkShaderStageFlagBits& stage );
 static bool             parse_gpu_pipeline( nlohmann::json& pipeline, raptor::PipelineCreation& pc, raptor::StringBuffer& path_buffer,
                                             raptor::StringBuffer& shader_buffer, raptor::Allocator* temp_allocator, raptor::Renderer* renderer,
                                             raptor::FrameGraph* frame_graph, raptor::StringBuffer& pass_name_buffer,
                                             const Array<VertexInputCreation>& vertex_input_creations, FlatHashMap<u64, u16>& name_to_vertex_inputs,
-                                            cstring technique_name, bool use_cache, bool parent_technique, bool& is_shader_changed );
+                                            FlatHashMap<u64, u64>& shader_keys, cstring technique_name, bool use_cache, bool parent_technique, bool& is_shader_changed );
 
 // RenderResourcesLoader //////////////////////////////////////////////////
 void RenderResourcesLoader::init( raptor::Renderer* renderer_, raptor::StackAllocator* temp_allocator_, raptor::FrameGraph* frame_graph_ ) {
     renderer = renderer_;
     temp_allocator = temp_allocator_;
     frame_graph = frame_graph_;
+
+    shader_keys.init( renderer->gpu->allocator, 64 );
 }
 
 void RenderResourcesLoader::shutdown() {
+    shader_keys.shutdown();
 }
 
 void RenderResourcesLoader::parse_gpu_technique( GpuTechniqueCreation& technique_creation, cstring json_path, bool use_shader_cache, bool& is_techinque_changed ) {
@@ -181,14 +186,14 @@ void RenderResourcesLoader::parse_gpu_technique( GpuTechniqueCreation& technique
                     pipeline_i[ "name" ].get_to( name );
 
                     if ( name == inherited_name ) {
-                        add_pass = parse_gpu_pipeline( pipeline_i, pc, path_buffer, shader_code_buffer, temp_allocator, renderer, frame_graph, pass_name_buffer, vertex_input_creations, name_to_vertex_inputs, technique_creation.name, false, true, parent_shader_changed );
+                        add_pass = parse_gpu_pipeline( pipeline_i, pc, path_buffer, shader_code_buffer, temp_allocator, renderer, frame_graph, pass_name_buffer, vertex_input_creations, name_to_vertex_inputs, shader_keys, technique_creation.name, use_shader_cache, true, parent_shader_changed );
                         break;
                     }
                 }
             }
 
             bool current_shader_changed = false;
-            add_pass = add_pass && parse_gpu_pipeline( pipeline, pc, path_buffer, shader_code_buffer, temp_allocator, renderer, frame_graph, pass_name_buffer, vertex_input_creations, name_to_vertex_inputs, technique_creation.name, use_shader_cache, false, current_shader_changed );
+            add_pass = add_pass && parse_gpu_pipeline( pipeline, pc, path_buffer, shader_code_buffer, temp_allocator, renderer, frame_graph, pass_name_buffer, vertex_input_creations, name_to_vertex_inputs, shader_keys, technique_creation.name, use_shader_cache, false, current_shader_changed );
 
             if ( add_pass ) {
                 technique_creation.creations[ technique_creation.num_creations++ ] = pc;
@@ -241,16 +246,77 @@ void RenderResourcesLoader::reload_gpu_technique( cstring json_path, bool use_sh
 }
 
 
+void RenderResourcesLoader::compile_gpu_techniques( cstring* json_paths, u32 count, enki::TaskScheduler* task_scheduler, Allocator* allocator ) {
+
+    i64 begin_time = time_now();
+
+    // Same code budget per technique as parse_gpu_technique.
+    StringBuffer shader_code_buffer;
+    shader_code_buffer.init( rmega( 2 ) * count, allocator );
+
+    StringBuffer name_buffer;
+    name_buffer.init( rkilo( 2 ) * count, allocator );
+
+    Array<ShaderCompileJob> jobs;
+    jobs.init( allocator, 64 );
+
+    for ( u32 t = 0; t < count; ++t ) {
+        gather_technique_shader_jobs( json_paths[ t ], jobs, shader_code_buffer, name_buffer, temp_allocator );
+    }
+
+    // Skip stages the device cannot create, parse_gpu_pipeline will skip their passes.
+    GpuDevice& gpu = *renderer->gpu;
+    u32 supported_jobs = 0;
+    for ( u32 j = 0; j < jobs.size; ++j ) {
+        const VkShaderStageFlagBits stage = jobs[ j ].stage;
+        const bool mesh_stage = stage == VK_SHADER_STAGE_MESH_BIT_NV || stage == VK_SHADER_STAGE_TASK_BIT_NV;
+        const bool ray_tracing_stage = stage == VK_SHADER_STAGE_RAYGEN_BIT_KHR || stage == VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR ||
+                                       stage == VK_SHADER_STAGE_ANY_HIT_BIT_KHR || stage == VK_SHADER_STAGE_MISS_BIT_KHR;
+        if ( ( mesh_stage && !gpu.mesh_shaders_extension_present ) || ( ray_tracing_stage && !gpu.ray_tracing_present ) ) {
+            continue;
+        }
+        jobs[ supported_jobs++ ] = jobs[ j ];
+    }
+    jobs.set_size( supported_jobs );
+
+    const u32 compiled_jobs = gpu.shader_compiler.compile_jobs( jobs.data, jobs.size, task_scheduler, allocator, true );
+
+    rprint( "Shader cache: compiled %u of %u stages in %f seconds%s\n", compiled_jobs, jobs.size, time_from_seconds( begin_time ),
+            gpu.shader_compiler.is_thread_safe() ? "" : " (glslangValidator, serial)" );
+
+    jobs.shutdown();
+    name_buffer.shutdown();
+    shader_code_buffer.shutdown();
+}
+
 TextureResource* RenderResourcesLoader::load_texture( cstring path, bool generate_mipmaps ) {
     int comp, width, height;
-    uint8_t* image_data = stbi_load( path, &width, &height, &comp, 4 );
+    uint8_t* image_data = nullptr;
+    VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+    u32 mip_levels = 1;
+
+    // Prefer the cooked texture, its mips are already compressed.
+    char cooked_path[ 512 ];
+    Ktx2Info cooked_info;
+    if ( renderer->gpu->texture_compression_bc_present && texture_find_cooked( path, cooked_path, ArraySize( cooked_path ), cooked_info ) ) {
+        image_data = texture_read_cooked( cooked_path, cooked_info, nullptr );
+        if ( image_data ) {
+            width = cooked_info.width;
+            height = cooked_info.height;
+            format = cooked_info.format;
+            mip_levels = generate_mipmaps ? cooked_info.level_count : 1;
+        }
+    }
+
     if ( !image_data ) {
-        rprint( "Error loading texture %s", path );
-        return nullptr;
+        image_data = stbi_load( path, &width, &height, &comp, 4 );
+        if ( !image_data ) {
+            rprint( "Error loading texture %s", path );
+            return nullptr;
+        }
     }
 
-    u32 mip_levels = 1;
-    if ( generate_mipmaps ) {
+    if ( generate_mipmaps && format == VK_FORMAT_R8G8B8A8_UNORM ) {
         u32 w = width;
         u32 h = height;
 
@@ -269,7 +335,7 @@ TextureResource* RenderResourcesLoader::load_texture( cstring path, bool generat
     file_name_from_path( copied_path );
 
     TextureCreation creation;
-    creation.set_data( image_data ).set_format_type( VK_FORMAT_R8G8B8A8_UNORM, TextureType::Texture2D ).set_mips( mip_levels ).set_size( ( u16 )width, ( u16 )height, 1 ).set_name( copied_path );
+    creation.set_data( image_data ).set_format_type( format, TextureType::Texture2D ).set_mips( mip_levels ).set_size( ( u16 )width, ( u16 )height, 1 ).set_name( copied_path );
 
     TextureResource* texture = renderer->create_texture( creation );
 
@@ -373,6 +439,149 @@ VkPipelineCreateFlags get_pipeline_flags( const std::string& flags ) {
     return 0;
 }
 
+void gather_technique_shader_jobs( cstring json_path, Array<ShaderCompileJob>& jobs, StringBuffer& shader_buffer,
+                                   StringBuffer& name_buffer, StackAllocator* temp_allocator ) {
+    using json = nlohmann::json;
+
+    // Source files are copied in shader_buffer, everything else is temporary.
+    sizet allocated_marker = temp_allocator->get_marker();
+
+    FileReadResult read_result = file_read_text( json_path, temp_allocator );
+    if ( !read_result.data ) {
+        rprint( "Cannot read technique %s\n", json_path );
+        temp_allocator->free_marker( allocated_marker );
+        return;
+    }
+
+    StringBuffer path_buffer;
+    path_buffer.init( rkilo( 1 ), temp_allocator );
+
+    json json_data = json::parse( read_result.data );
+
+    json pipelines = json_data[ "pipelines" ];
+    for ( sizet i = 0; pipelines.is_array() && i < pipelines.size(); ++i ) {
+        json pipeline = pipelines[ i ];
+        json shaders = pipeline[ "shaders" ];
+        if ( shaders.is_null() ) {
+            continue;
+        }
+
+        std::string name;
+        pipeline[ "name" ].get_to( name );
+        cstring pass_name = name_buffer.append_use_f( "%s", name.c_str() );
+
+        for ( sizet s = 0; s < shaders.size(); ++s ) {
+            json parsed_shader_stage = shaders[ s ];
+
+            ShaderCompileJob job;
+            job.name = pass_name;
+
+            parsed_shader_stage[ "stage" ].get_to( name );
+            if ( !get_shader_stage( name, job.stage ) ) {
+                continue;
+            }
+
+            // Same concatenation as parse_gpu_pipeline, so keys match the ones used at load time.
+            cstring code = shader_buffer.current();
+
+            json includes = parsed_shader_stage[ "includes" ];
+            if ( includes.is_array() ) {
+                for ( sizet in = 0; in < includes.size(); ++in ) {
+                    includes[ in ].get_to( name );
+                    shader_concatenate( name.c_str(), path_buffer, shader_buffer, temp_allocator );
+                }
+            }
+
+            parsed_shader_stage[ "shader" ].get_to( name );
+            shader_concatenate( name.c_str(), path_buffer, shader_buffer, temp_allocator );
+            shader_buffer.close_current_string();
+
+            job.code = code;
+            job.code_size = u32( strlen( code ) );
+            jobs.push( job );
+        }
+    }
+
+    temp_allocator->free_marker( allocated_marker );
+}
+
+void shader_compile_benchmark( cstring* json_paths, u32 count, enki::TaskScheduler* task_scheduler, Allocator* allocator, StackAllocator* temp_allocator ) {
+
+    ShaderCompiler shader_compiler;
+    shader_compiler.init();
+
+    StringBuffer shader_code_buffer;
+    shader_code_buffer.init( rmega( 2 ) * count, allocator );
+
+    StringBuffer name_buffer;
+    name_buffer.init( rkilo( 2 ) * count, allocator );
+
+    Array<ShaderCompileJob> jobs;
+    jobs.init( allocator, 64 );
+
+    i64 start = time_now();
+    for ( u32 t = 0; t < count; ++t ) {
+        gather_technique_shader_jobs( json_paths[ t ], jobs, shader_code_buffer, name_buffer, temp_allocator );
+    }
+    const f64 preprocess_ms = time_from_milliseconds( start );
+
+    start = time_now();
+    u64 key_checksum = 0;
+    for ( u32 j = 0; j < jobs.size; ++j ) {
+        key_checksum ^= shader_compiler.compute_key( jobs[ j ].code, jobs[ j ].code_size, jobs[ j ].stage, jobs[ j ].name );
+    }
+    const f64 hash_ms = time_from_milliseconds( start );
+
+    rprint( "Shader compile benchmark, %u techniques, %u stages, %u KB of glsl.\n", count, jobs.size, shader_code_buffer.current_size / 1024 );
+    rprint( "Preprocess %8.2f ms | cache keys %6.2f ms (%016llx)\n", preprocess_ms, hash_ms, key_checksum );
+
+    // No cache folder is set: every stage is compiled.
+    start = time_now();
+    const u32 serial_compiled = shader_compiler.compile_jobs( jobs.data, jobs.size, nullptr, allocator, false );
+    const f64 serial_ms = time_from_milliseconds( start );
+    rprint( "Serial   %8.2f ms | %u stages compiled\n", serial_ms, serial_compiled );
+
+    if ( shader_compiler.is_thread_safe() ) {
+        start = time_now();
+        const u32 parallel_compiled = shader_compiler.compile_jobs( jobs.data, jobs.size, task_scheduler, allocator, false );
+        const f64 parallel_ms = time_from_milliseconds( start );
+        rprint( "Parallel %8.2f ms | %u stages compiled on %u threads, %.2fx\n", parallel_ms, parallel_compiled,
+                task_scheduler->GetNumTaskThreads(), serial_ms / parallel_ms );
+    }
+    else {
+        rprint( "Parallel skipped: glslangValidator is not reentrant, build with RAPTOR_GLSLANG_LIBRARY.\n" );
+    }
+
+    jobs.shutdown();
+    name_buffer.shutdown();
+    shader_code_buffer.shutdown();
+
+    shader_compiler.shutdown();
+}
+
+bool get_shader_stage( const std::string& name, VkShaderStageFlagBits& stage ) {
+    if ( name == "vertex" ) {
+        stage = VK_SHADER_STAGE_VERTEX_BIT;
+    } else if ( name == "fragment" ) {
+        stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    } else if ( name == "compute" ) {
+        stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    } else if ( name == "mesh" ) {
+        stage = VK_SHADER_STAGE_MESH_BIT_NV;
+    } else if ( name == "task" ) {
+        stage = VK_SHADER_STAGE_TASK_BIT_NV;
+    } else if ( name == "raygen" ) {
+        stage = VK_SHADER_STAGE_RAYGEN_BIT_KHR;
+    } else if ( name == "closest_hit" ) {
+        stage = VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
+    } else if ( name == "miss" ) {
+        stage = VK_SHADER_STAGE_MISS_BIT_KHR;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 u64 shader_concatenate( cstring filename, raptor::StringBuffer& path_buffer, raptor::StringBuffer& shader_buffer, raptor::Allocator* temp_allocator ) {
     using namespace raptor;
 
@@ -397,7 +606,7 @@ bool parse_gpu_pipeline( nlohmann::json& pipeline, raptor::PipelineCreation& pc,
                          raptor::StringBuffer& shader_buffer, raptor::Allocator* temp_allocator, raptor::Renderer* renderer,
                          raptor::FrameGraph* frame_graph, raptor::StringBuffer& pass_name_buffer,
                          const Array<VertexInputCreation>& vertex_input_creations, FlatHashMap<u64, u16>& name_to_vertex_inputs,
-                         cstring technique_name, bool use_cache, bool parent_technique, bool& shader_changed ) {
+                         FlatHashMap<u64, u64>& shader_keys, cstring technique_name, bool use_cache, bool parent_technique, bool& shader_changed ) {
     using json = nlohmann::json;
     using namespace raptor;
 
@@ -425,10 +634,7 @@ bool parse_gpu_pipeline( nlohmann::json& pipeline, raptor::PipelineCreation& pc,
             std::string name;
 
             path_buffer.clear();
-            
-            // Cache file hashes
-            u64 shader_file_hashes[16];
-            u32 shader_file_hashes_count = 0;
+
             // Read file and concatenate it
             // Cache current shader code beginning
             cstring code = shader_buffer.current();
@@ -436,21 +642,15 @@ bool parse_gpu_pipeline( nlohmann::json& pipeline, raptor::PipelineCreation& pc,
             json includes = parsed_shader_stage[ "includes" ];
             if ( includes.is_array() ) {
 
-                //rprint( "Shader hash " );
                 for ( sizet in = 0; in < includes.size(); ++in ) {
                     includes[ in ].get_to( name );
-                    u64 shader_file_hash = shader_concatenate( name.c_str(), path_buffer, shader_buffer, temp_allocator );
-                    shader_file_hashes[ shader_file_hashes_count++] = shader_file_hash;
-                    //rprint( " %016llx", shader_file_hash );
+                    shader_concatenate( name.c_str(), path_buffer, shader_buffer, temp_allocator );
                 }
             }
 
             parsed_shader_stage[ "shader" ].get_to( name );
             // Concatenate main shader code
-            u64 shader_file_hash = shader_concatenate( name.c_str(), path_buffer, shader_buffer, temp_allocator );
-            // Cache main shader code hash
-            shader_file_hashes[ shader_file_hashes_count++ ] = shader_file_hash;
-            //rprint( " %016llx", shader_file_hash );
+            shader_concatenate( name.c_str(), path_buffer, shader_buffer, temp_allocator );
             // Add terminator for final string.
             shader_buffer.close_current_string();
 
@@ -511,83 +711,27 @@ bool parse_gpu_pipeline( nlohmann::json& pipeline, raptor::PipelineCreation& pc,
                 shader_stage.type = VK_SHADER_STAGE_MISS_BIT_KHR;
             }
 
-            // Do not compile shaders when parsing the parent technique
-            bool compile_shader = true;
-            cstring shader_spirv_path = nullptr;
-            cstring shader_hash_path = nullptr;
-
-            if ( use_cache ) {
-                // Check shader cache and eventually compile the code.
-                path_buffer.clear();
-                shader_spirv_path = path_buffer.append_use_f( "%s/%s_%s_%s.spv",
-                                                              renderer->resource_cache.binary_data_folder, technique_name, pc.shaders.name,
-                                                              to_compiler_extension( shader_stage.type ) );
-                shader_hash_path = path_buffer.append_use_f( "%s/%s_%s_%s.hash.cache",
-                                                             renderer->resource_cache.binary_data_folder, technique_name, pc.shaders.name,
-                                                             to_compiler_extension( shader_stage.type ) );
-                //FileReadResult shader_read_result = file_read_text( shader_path, temp_allocator );
-                bool cache_exists = file_exists( shader_hash_path );
-
-                //rprint( "\nfile %s\n", shader_hash_path );
-                // TODO: still not working
-                if ( cache_exists ) {
-
-                    FileReadResult frr = file_read_binary( shader_hash_path, temp_allocator );
-                    if ( frr.data ) {
-
-                        u32 file_entries = frr.size / sizeof( u64 );
-                        if ( file_entries == shader_file_hashes_count ) {
-                            u64* cached_file_hashes = ( u64* )frr.data;
-                            u32 i = 0;
-                            for ( ; i < shader_file_hashes_count; ++i ) {
-                                const u64 a = shader_file_hashes[ i ];
-                                const u64 b = cached_file_hashes[ i ];
-                                if ( a != b ) {
-                                    break;
-                                }
-                            }
+            // The SpirV cache is addressed by the hash of the final code, so any change in the
+            // included files invalidates it. Track the last key of each stage to know if it changed.
+            ShaderCompiler& shader_compiler = renderer->gpu->shader_compiler;
+            const u64 shader_key = shader_compiler.compute_key( code, code_size, shader_stage.type, pc.shaders.name );
+            const u64 shader_stage_id = hash_calculate( pc.shaders.name, hash_calculate( technique_name, shader_stage.type ) );
 
-                            compile_shader = i != shader_file_hashes_count;
-                        }
-                    }
-                }
+            FlatHashMapIterator shader_key_it = shader_keys.find( shader_stage_id );
+            if ( !shader_key_it.is_valid() || shader_keys.get( shader_key_it ) != shader_key ) {
+                shader_keys.insert( shader_stage_id, shader_key );
+                shader_changed = true;
             }
 
-            // Cache is not present or shader has changed, compile shaders.
-            if ( compile_shader ) {
-                VkShaderModuleCreateInfo shader_create_info = renderer->gpu->compile_shader( code, code_size, shader_stage.type, pc.shaders.name );
-                if ( shader_create_info.pCode ) {
-                    shader_stage.code = reinterpret_cast< cstring >( shader_create_info.pCode );
-                    shader_stage.code_size = ( u32 )shader_create_info.codeSize;
-
-                    if ( use_cache ) {
-                        // Write hashes
-                        file_write_binary( shader_hash_path, &shader_file_hashes[ 0 ], sizeof( u64 ) * shader_file_hashes_count );
-                        /*rprint( "Hashes\n%016llx ", shader_file_hashes[0] );
-                        for (u32 i = 1; i < shader_file_hashes_count; ++i ) {
-                            rprint( "%016llx ", shader_file_hashes[ i ] );
-                        }
-                        rprint( "\n\n" );*/
-                        // Write spirv
-                        file_write_binary( shader_spirv_path, ( void* )shader_create_info.pCode, sizeof( u32 ) * shader_create_info.codeSize );
-                    }
-
-                    // Only when compiling a shader we can say that it is changed.
-                    shader_changed = true;
-                }
-                else {
-                    rprint( "Error compiling shader %s stage %s", pc.shaders.name, to_compiler_extension( shader_stage.type ) );
-                    return false;
-                }
+            VkShaderModuleCreateInfo shader_create_info = renderer->gpu->compile_shader( code, code_size, shader_stage.type, pc.shaders.name, use_cache );
+            if ( shader_create_info.pCode == nullptr ) {
+                rprint( "Error compiling shader %s stage %s", pc.shaders.name, to_compiler_extension( shader_stage.type ) );
+                return false;
             }
-            else {
-                // Shader is the same, read cached SpirV
-                FileReadResult frr = file_read_binary( shader_spirv_path, temp_allocator );
 
-                shader_stage.code = reinterpret_cast< cstring >( frr.data );
-                shader_stage.code_size = ( u32 )frr.size / sizeof( u32 );
-            }
-            
+            shader_stage.code = reinterpret_cast< cstring >( shader_create_info.pCode );
+            shader_stage.code_size = ( u32 )shader_create_info.codeSize;
+
             // Finally add the stage
             pc.shaders.add_stage( shader_stage.code, shader_stage.code_size, shader_stage.type );
             // Output always spv compiled shaders
@@ -1,11 +1,21 @@
 #pragma once
 
 #include "graphics/renderer.hpp"
+#include "graphics/shader_compiler.hpp"
 
 namespace raptor {
 
     struct FrameGraph;
 
+    // Preprocesses all shader stages of a technique without touching the gpu. Code and pass names
+    // are appended to the buffers, that must outlive the jobs.
+    void                gather_technique_shader_jobs( cstring json_path, Array<ShaderCompileJob>& jobs, StringBuffer& shader_buffer,
+                                                      StringBuffer& name_buffer, StackAllocator* temp_allocator );
+
+    // Cold compiles every stage of the techniques, serially and on the task scheduler, and prints the timings.
+    void                shader_compile_benchmark( cstring* json_paths, u32 count, enki::TaskScheduler* task_scheduler,
+                                                  Allocator* allocator, StackAllocator* temp_allocator );
+
     //
     //
     struct RenderResourcesLoader {
@@ -19,10 +29,15 @@ namespace raptor {
         void            parse_gpu_technique( GpuTechniqueCreation& technique_creation, cstring json_path, bool use_shader_cache, bool& is_techinque_changed );
         void            reload_gpu_technique( cstring json_path, bool use_shader_cache, bool& is_techinque_changed );
 
+        // Fills the shader cache for all the techniques, compiling the missing stages in parallel.
+        void            compile_gpu_techniques( cstring* json_paths, u32 count, enki::TaskScheduler* task_scheduler, Allocator* allocator );
+
         Renderer*       renderer;
         FrameGraph*     frame_graph;
         StackAllocator* temp_allocator;
 
+        FlatHashMap<u64, u64> shader_keys;     // Last cache key of each technique, pass and stage.
+
     }; // struct RenderResourcesLoader
 
 } // namespace raptor
@@ -1,6 +1,7 @@
 #include "graphics/render_scene.hpp"
 #include "graphics/renderer.hpp"
 #include "graphics/scene_graph.hpp"
+#include "graphics/frame_pipeline.hpp"
 #include "graphics/asynchronous_loader.hpp"
 #include "graphics/raptor_imgui.hpp"
 #include "graphics/gpu_profiler.hpp"
@@ -120,6 +121,21 @@ void PhysicsVertex::add_joint( u32 vertex_index ) {
 //
 // DepthPrePass ///////////////////////////////////////////////////////
 void DepthPrePass::render( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene ) {
+    render_range( current_frame_index, gpu_commands, render_scene, 0, mesh_instance_draws.size );
+}
+
+u32 DepthPrePass::parallel_draw_count( RenderScene* render_scene ) {
+    if ( !enabled )
+        return 0;
+
+    // Meshlets are drawn with a single indirect command.
+    if ( render_scene->use_meshlets )
+        return 1;
+
+    return mesh_instance_draws.size;
+}
+
+void DepthPrePass::render_range( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene, u32 first_draw, u32 draw_count ) {
     if ( !enabled )
         return;
 
@@ -127,7 +143,7 @@ void DepthPrePass::render( u32 current_frame_index, CommandBuffer* gpu_commands,
         Renderer* renderer = render_scene->renderer;
 
         // Draw meshlets
-        const u64 meshlet_hashed_name = hash_calculate( "meshlet" );
+        const u64 meshlet_hashed_name = rhash( "meshlet" );
         GpuTechnique* meshlet_technique = renderer->resource_cache.techniques.get( meshlet_hashed_name );
 
         PipelineHandle pipeline = meshlet_technique->passes[ meshlet_technique_index ].pipeline;
@@ -140,7 +156,7 @@ void DepthPrePass::render( u32 current_frame_index, CommandBuffer* gpu_commands,
     }
     else {
         Material* last_material = nullptr;
-        for ( u32 mesh_index = 0; mesh_index < mesh_instance_draws.size; ++mesh_index ) {
+        for ( u32 mesh_index = first_draw; mesh_index < first_draw + draw_count; ++mesh_index ) {
             MeshInstanceDraw& mesh_instance_draw = mesh_instance_draws[ mesh_index ];
             Mesh& mesh = *mesh_instance_draw.mesh_instance->mesh;
 
@@ -160,7 +176,7 @@ void DepthPrePass::render( u32 current_frame_index, CommandBuffer* gpu_commands,
 void DepthPrePass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "depth_pre_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "depth_pre_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -171,7 +187,7 @@ void DepthPrePass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, A
     if ( !enabled )
         return;
 
-    const u64 hashed_name = hash_calculate( "main" );
+    const u64 hashed_name = rhash( "main" );
     GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hashed_name );
 
     mesh_instance_draws.init( resident_allocator, 16 );
@@ -196,7 +212,7 @@ void DepthPrePass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, A
 
     // Cache meshlet technique index
     if ( gpu.mesh_shaders_extension_present ) {
-        GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hash_calculate( "meshlet" ) );
+        GpuTechnique* main_technique = renderer->resource_cache.techniques.get( rhash( "meshlet" ) );
         meshlet_technique_index = main_technique->get_pass_index( "depth_pre" );
     }
 }
@@ -231,7 +247,7 @@ void DepthPyramidPass::post_render( u32 current_frame_index, CommandBuffer* gpu_
         u32 width = depth_pyramid_texture->width;
         u32 height = depth_pyramid_texture->height;
 
-        FrameGraphResource* depth_resource = ( FrameGraphResource* )frame_graph->get_resource( "depth" );
+        FrameGraphResource* depth_resource = ( FrameGraphResource* )frame_graph->get_resource( rhash( "depth" ) );
         TextureHandle depth_handle = depth_resource->resource_info.texture.handle;
         Texture* depth_texture = gpu->access_texture( depth_handle );
 
@@ -266,7 +282,7 @@ void DepthPyramidPass::on_resize( GpuDevice& gpu, FrameGraph* frame_graph, u32 n
         gpu.destroy_texture( depth_pyramid_views[ i ] );
     }
 
-    FrameGraphResource* depth_resource = ( FrameGraphResource* )frame_graph->get_resource( "depth" );
+    FrameGraphResource* depth_resource = ( FrameGraphResource* )frame_graph->get_resource( rhash( "depth" ) );
     TextureHandle depth_handle = depth_resource->resource_info.texture.handle;
     Texture* depth_texture = gpu.access_texture( depth_handle );
 
@@ -276,7 +292,7 @@ void DepthPyramidPass::on_resize( GpuDevice& gpu, FrameGraph* frame_graph, u32 n
 void DepthPyramidPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "depth_pyramid_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "depth_pyramid_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -289,7 +305,7 @@ void DepthPyramidPass::prepare_draws( RenderScene& scene, FrameGraph* frame_grap
 
     GpuDevice& gpu = *renderer->gpu;
 
-    FrameGraphResource* depth_resource = ( FrameGraphResource* )frame_graph->get_resource( "depth" );
+    FrameGraphResource* depth_resource = ( FrameGraphResource* )frame_graph->get_resource( rhash( "depth" ) );
     TextureHandle depth_handle = depth_resource->resource_info.texture.handle;
     Texture* depth_texture = gpu.access_texture( depth_handle );
 
@@ -343,7 +359,7 @@ void DepthPyramidPass::create_depth_pyramid_resource( Texture* depth_texture ) {
 
     DescriptorSetCreation descriptor_set_creation{ };
 
-    GpuTechnique* culling_technique = renderer->resource_cache.techniques.get( hash_calculate( "culling" ) );
+    GpuTechnique* culling_technique = renderer->resource_cache.techniques.get( rhash( "culling" ) );
     depth_pyramid_pipeline = culling_technique->passes[ 1 ].pipeline;
     DescriptorSetLayoutHandle depth_pyramid_layout = gpu.get_descriptor_set_layout( depth_pyramid_pipeline, k_material_descriptor_set_index );
 
@@ -413,6 +429,21 @@ void GBufferPass::pre_render( u32 current_frame_index, CommandBuffer* gpu_comman
 }
 
 void GBufferPass::render( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene ) {
+    render_range( current_frame_index, gpu_commands, render_scene, 0, mesh_instance_draws.size );
+}
+
+u32 GBufferPass::parallel_draw_count( RenderScene* render_scene ) {
+    if ( !enabled )
+        return 0;
+
+    // Meshlets are drawn with a single indirect command.
+    if ( render_scene->use_meshlets_emulation || render_scene->use_meshlets )
+        return 1;
+
+    return mesh_instance_draws.size;
+}
+
+void GBufferPass::render_range( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene, u32 first_draw, u32 draw_count ) {
     if ( !enabled )
         return;
 
@@ -436,7 +467,7 @@ void GBufferPass::render( u32 current_frame_index, CommandBuffer* gpu_commands,
     }
     else {
         Material* last_material = nullptr;
-        for ( u32 mesh_index = 0; mesh_index < mesh_instance_draws.size; ++mesh_index ) {
+        for ( u32 mesh_index = first_draw; mesh_index < first_draw + draw_count; ++mesh_index ) {
             MeshInstanceDraw& mesh_instance_draw = mesh_instance_draws[ mesh_index ];
             Mesh& mesh = *mesh_instance_draw.mesh_instance->mesh;
 
@@ -456,7 +487,7 @@ void GBufferPass::render( u32 current_frame_index, CommandBuffer* gpu_commands,
 void GBufferPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "gbuffer_pass_early" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "gbuffer_pass_early" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -467,7 +498,7 @@ void GBufferPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Al
     if ( !enabled )
         return;
 
-    const u64 hashed_name = hash_calculate( "main" );
+    const u64 hashed_name = rhash( "main" );
     GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hashed_name );
 
     mesh_instance_draws.init( resident_allocator, 16 );
@@ -489,7 +520,7 @@ void GBufferPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Al
     }
 
     // Cache meshlet technique index
-    GpuTechnique* meshlet_technique = renderer->resource_cache.techniques.get( hash_calculate( "meshlet" ) );
+    GpuTechnique* meshlet_technique = renderer->resource_cache.techniques.get( rhash( "meshlet" ) );
 
     u32 technique_index = meshlet_technique->get_pass_index( "gbuffer_culling" );
     if ( technique_index != u16_max ) {
@@ -576,7 +607,7 @@ void GBufferPass::free_gpu_resources( GpuDevice& gpu ) {
 void LateGBufferPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "gbuffer_pass_late" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "gbuffer_pass_late" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -587,7 +618,7 @@ void LateGBufferPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph
     if ( !enabled )
         return;
 
-    const u64 hashed_name = hash_calculate( "main" );
+    const u64 hashed_name = rhash( "main" );
     GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hashed_name );
 
     mesh_instance_draws.init( resident_allocator, 16 );
@@ -610,7 +641,7 @@ void LateGBufferPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph
 
     // Cache meshlet technique index
     if ( renderer->gpu->mesh_shaders_extension_present ) {
-        GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hash_calculate( "meshlet" ) );
+        GpuTechnique* main_technique = renderer->resource_cache.techniques.get( rhash( "meshlet" ) );
         meshlet_technique_index = main_technique->get_pass_index( "gbuffer_culling" );
     }
 }
@@ -622,6 +653,10 @@ void LateGBufferPass::free_gpu_resources( GpuDevice& gpu ) {
     mesh_instance_draws.shutdown();
 }
 
+u32 LateGBufferPass::parallel_draw_count( RenderScene* render_scene ) {
+    return ( enabled && render_scene->use_meshlets ) ? 1 : 0;
+}
+
 void LateGBufferPass::render( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene ) {
 
     if ( !enabled )
@@ -629,7 +664,7 @@ void LateGBufferPass::render( u32 current_frame_index, CommandBuffer* gpu_comman
 
     if ( render_scene->use_meshlets ) {
 
-        const u64 meshlet_hashed_name = hash_calculate( "meshlet" );
+        const u64 meshlet_hashed_name = rhash( "meshlet" );
         GpuTechnique* meshlet_technique = renderer->resource_cache.techniques.get( meshlet_hashed_name );
 
         PipelineHandle pipeline = meshlet_technique->passes[ meshlet_technique_index ].pipeline;
@@ -683,7 +718,7 @@ void LightPass::on_resize( GpuDevice& gpu, FrameGraph* frame_graph, u32 new_widt
     if ( !enabled )
         return;
 
-    FrameGraphResource* resource = frame_graph->get_resource( "shading_rate_image" );
+    FrameGraphResource* resource = frame_graph->get_resource( rhash( "shading_rate_image" ) );
     if ( resource ) {
         u32 adjusted_width = ( new_width + gpu.min_fragment_shading_rate_texel_size.width - 1 ) / gpu.min_fragment_shading_rate_texel_size.width;
         u32 adjusted_height = ( new_height + gpu.min_fragment_shading_rate_texel_size.height - 1 ) / gpu.min_fragment_shading_rate_texel_size.height;
@@ -724,7 +759,7 @@ void LightPass::post_render( u32 current_frame_index, CommandBuffer* gpu_command
 void LightPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "lighting_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "lighting_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -737,7 +772,7 @@ void LightPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allo
 
     use_compute = node->compute;
 
-    const u64 hashed_name = hash_calculate( "pbr_lighting" );
+    const u64 hashed_name = rhash( "pbr_lighting" );
     GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hashed_name );
 
     MaterialCreation material_creation;
@@ -886,7 +921,7 @@ void LightPass::update_dependent_resources( GpuDevice& gpu, FrameGraph* frame_gr
     if ( !enabled )
         return;
 
-    const u64 hashed_name = hash_calculate( "pbr_lighting" );
+    const u64 hashed_name = rhash( "pbr_lighting" );
     GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hashed_name );
 
     {
@@ -915,6 +950,21 @@ void LightPass::update_dependent_resources( GpuDevice& gpu, FrameGraph* frame_gr
 //
 // TransparentPass ////////////////////////////////////////////////////////
 void TransparentPass::render( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene ) {
+    render_range( current_frame_index, gpu_commands, render_scene, 0, mesh_instance_draws.size );
+}
+
+u32 TransparentPass::parallel_draw_count( RenderScene* render_scene ) {
+    if ( !enabled )
+        return 0;
+
+    // Meshlets are drawn with a single indirect command.
+    if ( render_scene->use_meshlets_emulation || render_scene->use_meshlets )
+        return 1;
+
+    return mesh_instance_draws.size;
+}
+
+void TransparentPass::render_range( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene, u32 first_draw, u32 draw_count ) {
     if ( !enabled )
         return;
 
@@ -925,7 +975,7 @@ void TransparentPass::render( u32 current_frame_index, CommandBuffer* gpu_comman
     }
     else if ( render_scene->use_meshlets ) {
 
-        const u64 meshlet_hashed_name = hash_calculate( "meshlet" );
+        const u64 meshlet_hashed_name = rhash( "meshlet" );
         GpuTechnique* meshlet_technique = renderer->resource_cache.techniques.get( meshlet_hashed_name );
 
         PipelineHandle pipeline = meshlet_technique->passes[ meshlet_technique_index ].pipeline;
@@ -944,7 +994,7 @@ void TransparentPass::render( u32 current_frame_index, CommandBuffer* gpu_comman
     }
     else {
         Material* last_material = nullptr;
-        for ( u32 mesh_index = 0; mesh_index < mesh_instance_draws.size; ++mesh_index ) {
+        for ( u32 mesh_index = first_draw; mesh_index < first_draw + draw_count; ++mesh_index ) {
             MeshInstanceDraw& mesh_instance_draw = mesh_instance_draws[ mesh_index ];
             Mesh& mesh = *mesh_instance_draw.mesh_instance->mesh;
 
@@ -964,7 +1014,7 @@ void TransparentPass::render( u32 current_frame_index, CommandBuffer* gpu_comman
 void TransparentPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "transparent_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "transparent_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -975,7 +1025,7 @@ void TransparentPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph
     if ( !enabled )
         return;
 
-    const u64 hashed_name = hash_calculate( "main" );
+    const u64 hashed_name = rhash( "main" );
     GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hashed_name );
 
     mesh_instance_draws.init( resident_allocator, 16 );
@@ -997,7 +1047,7 @@ void TransparentPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph
 
     // Cache meshlet technique index
     if ( renderer->gpu->mesh_shaders_extension_present ) {
-        GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hash_calculate( "meshlet" ) );
+        GpuTechnique* main_technique = renderer->resource_cache.techniques.get( rhash( "meshlet" ) );
         meshlet_technique_index = main_technique->get_pass_index( "transparent_no_cull" );
     }
 }
@@ -1172,7 +1222,7 @@ void DebugPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allo
     renderer = scene.renderer;
     scene_graph = scene.scene_graph;
 
-    FrameGraphNode* node = frame_graph->get_node( "debug_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "debug_pass" ) );
     if ( node == nullptr ) {
        enabled = false;
 
@@ -1183,7 +1233,7 @@ void DebugPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allo
     if ( !enabled )
        return;
 
-    const u64 hashed_name = hash_calculate( "debug" );
+    const u64 hashed_name = rhash( "debug" );
     GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hashed_name );
 
     MaterialCreation material_creation;
@@ -1453,7 +1503,7 @@ void DebugPass::free_gpu_resources( GpuDevice& gpu ) {
 
 void DebugPass::update_dependent_resources( GpuDevice& gpu, FrameGraph* frame_graph, RenderScene* render_scene ) {
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "ddgi" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "ddgi" ) );
     if ( technique ) {
         gpu.destroy_descriptor_set( gi_debug_probes_descriptor_set );
 
@@ -1485,7 +1535,7 @@ void DoFPass::add_ui() {
 
 void DoFPass::pre_render( u32 current_frame_index, CommandBuffer* gpu_commands, FrameGraph* frame_graph, RenderScene* render_scene ) {
 
-    FrameGraphResource* texture = ( FrameGraphResource* )frame_graph->get_resource( "lighting" );
+    FrameGraphResource* texture = ( FrameGraphResource* )frame_graph->get_resource( rhash( "lighting" ) );
     RASSERT( texture != nullptr );
 
     gpu_commands->copy_texture( texture->resource_info.texture.handle, scene_mips->handle, RESOURCE_STATE_PIXEL_SHADER_RESOURCE );
@@ -1533,7 +1583,7 @@ void DoFPass::on_resize( GpuDevice& gpu, FrameGraph* frame_graph, u32 new_width,
 void DoFPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "depth_of_field_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "depth_of_field_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -1544,7 +1594,7 @@ void DoFPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Alloca
     if ( !enabled )
         return;
 
-    const u64 hashed_name = hash_calculate( "depth_of_field" );
+    const u64 hashed_name = rhash( "depth_of_field" );
     GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hashed_name );
 
     MaterialCreation material_creation;
@@ -1695,7 +1745,7 @@ void CullingEarlyPass::render( u32 current_frame_index, CommandBuffer* gpu_comma
 
 void CullingEarlyPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
 
-    FrameGraphNode* node = frame_graph->get_node( "mesh_occlusion_early_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "mesh_occlusion_early_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -1708,7 +1758,7 @@ void CullingEarlyPass::prepare_draws( RenderScene& scene, FrameGraph* frame_grap
     GpuDevice& gpu = *renderer->gpu;
 
     // Cache frustum cull shader
-    GpuTechnique* culling_technique = renderer->resource_cache.techniques.get( hash_calculate( "culling" ) );
+    GpuTechnique* culling_technique = renderer->resource_cache.techniques.get( rhash( "culling" ) );
     {
         u32 pipeline_index = culling_technique->get_pass_index( "gpu_mesh_culling" );
         GpuTechniquePass& pass = culling_technique->passes[ pipeline_index ];
@@ -1788,7 +1838,7 @@ void CullingLatePass::render( u32 current_frame_index, CommandBuffer* gpu_comman
 
 void CullingLatePass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
 
-    FrameGraphNode* node = frame_graph->get_node( "mesh_occlusion_late_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "mesh_occlusion_late_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -1801,7 +1851,7 @@ void CullingLatePass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph
     GpuDevice& gpu = *renderer->gpu;
 
     // Cache frustum cull shader
-    GpuTechnique* culling_technique = renderer->resource_cache.techniques.get( hash_calculate( "culling" ) );
+    GpuTechnique* culling_technique = renderer->resource_cache.techniques.get( rhash( "culling" ) );
     {
         GpuTechniquePass& pass = culling_technique->passes[ 0 ];
         frustum_cull_pipeline = pass.pipeline;
@@ -1858,7 +1908,7 @@ void RayTracingTestPass::on_resize( GpuDevice& gpu, FrameGraph* frame_graph, u32
 }
 
 void RayTracingTestPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
-    FrameGraphNode* node = frame_graph->get_node( "ray_tracing_test" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "ray_tracing_test" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -1873,7 +1923,7 @@ void RayTracingTestPass::prepare_draws( RenderScene& scene, FrameGraph* frame_gr
         return;
     }
 
-    GpuTechnique* ray_tracing_technique = renderer->resource_cache.techniques.get( hash_calculate( "ray_tracing" ) );
+    GpuTechnique* ray_tracing_technique = renderer->resource_cache.techniques.get( rhash( "ray_tracing" ) );
     pipeline = ray_tracing_technique->passes[ 0 ].pipeline;
 
     GpuDevice& gpu = *renderer->gpu;
@@ -1956,14 +2006,14 @@ void ShadowVisibilityPass::render( u32 current_frame_index, CommandBuffer* gpu_c
         return;
     }
 
-    if ( render_scene->active_lights != last_active_lights_count ) {
+    if ( render_scene->get_shadow_light_count() != last_active_lights_count ) {
         GpuDevice& gpu = *renderer->gpu;
-        recreate_textures( gpu, render_scene->active_lights );
+        recreate_textures( gpu, render_scene->get_shadow_light_count() );
 
         FrameGraphResourceInfo resource_info{ };
         const u32 adjusted_width = ceilu32( gpu.swapchain_width * texture_scale );
         const u32 adjusted_height = ceilu32( gpu.swapchain_height * texture_scale );
-        resource_info.set_external_texture_3d( adjusted_width, adjusted_height, render_scene->active_lights, VK_FORMAT_R16_SFLOAT, 0, filtered_visibility_texture );
+        resource_info.set_external_texture_3d( adjusted_width, adjusted_height, render_scene->get_shadow_light_count(), VK_FORMAT_R16_SFLOAT, 0, filtered_visibility_texture );
 
         shadow_visibility_resource->resource_info = resource_info;
     }
@@ -2081,7 +2131,7 @@ void ShadowVisibilityPass::recreate_textures( GpuDevice& gpu, u32 lights_count )
 }
 
 void ShadowVisibilityPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
-    FrameGraphNode* node = frame_graph->get_node( "shadow_visibility_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "shadow_visibility_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -2097,14 +2147,14 @@ void ShadowVisibilityPass::prepare_draws( RenderScene& scene, FrameGraph* frame_
     // Use half resolution textures
     texture_scale = 0.5f;
 
-    recreate_textures( gpu, scene.active_lights );
+    recreate_textures( gpu, scene.get_shadow_light_count() );
 
     cstring shadow_visibility_resource_name = "shadow_visibility";
     FrameGraphResourceInfo resource_info{ };
 
     const u32 adjusted_width = ceilu32( gpu.swapchain_width * texture_scale );
     const u32 adjusted_height = ceilu32( gpu.swapchain_height * texture_scale );
-    resource_info.set_external_texture_3d( adjusted_width, adjusted_height, scene.active_lights, VK_FORMAT_R16_SFLOAT, 0, filtered_visibility_texture );
+    resource_info.set_external_texture_3d( adjusted_width, adjusted_height, scene.get_shadow_light_count(), VK_FORMAT_R16_SFLOAT, 0, filtered_visibility_texture );
 
     shadow_visibility_resource = frame_graph->get_resource( shadow_visibility_resource_name );
     RASSERT( shadow_visibility_resource != nullptr );
@@ -2115,7 +2165,7 @@ void ShadowVisibilityPass::prepare_draws( RenderScene& scene, FrameGraph* frame_
 
     gpu_pass_constants = gpu.create_buffer( buffer_creation );
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "pbr_lighting" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "pbr_lighting" ) );
 
     u32 pass_index = technique->get_pass_index( "shadow_visibility_variance" );
     GpuTechniquePass& variance_pass = technique->passes[ pass_index ];
@@ -2141,7 +2191,7 @@ void ShadowVisibilityPass::prepare_draws( RenderScene& scene, FrameGraph* frame_
         descriptor_set[ i ] = renderer->gpu->create_descriptor_set( ds_creation );
     }
 
-    FrameGraphResource* resource = frame_graph->get_resource( "gbuffer_normals" );
+    FrameGraphResource* resource = frame_graph->get_resource( rhash( "gbuffer_normals" ) );
     RASSERT( resource != nullptr );
     normals_texture = resource->resource_info.texture.handle;
 }
@@ -2191,7 +2241,7 @@ void ShadowVisibilityPass::free_gpu_resources( GpuDevice& gpu ) {
 
 void ShadowVisibilityPass::update_dependent_resources( GpuDevice& gpu, FrameGraph* frame_graph, RenderScene* render_scene ) {
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "pbr_lighting" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "pbr_lighting" ) );
 
     u32 pass_index = technique->get_pass_index( "shadow_visibility_variance" );
     GpuTechniquePass& variance_pass = technique->passes[ pass_index ];
@@ -2222,7 +2272,7 @@ void PointlightShadowPass::pre_render( u32 current_frame_index, CommandBuffer* g
     gpu_commands->bind_pipeline( meshlet_culling_pipeline );
     gpu_commands->bind_descriptor_set( &meshlet_culling_descriptor_set[ current_frame_index ], 1, nullptr, 0 );
 
-    u32 group_x = raptor::ceilu32( render_scene->mesh_instances.size * render_scene->active_lights / 32.0f );
+    u32 group_x = raptor::ceilu32( render_scene->mesh_instances.size * render_scene->get_shadow_light_count() / 32.0f );
     gpu_commands->dispatch( group_x, 1, 1 );
 
     gpu_commands->global_debug_barrier();
@@ -2231,7 +2281,7 @@ void PointlightShadowPass::pre_render( u32 current_frame_index, CommandBuffer* g
     gpu_commands->bind_pipeline( meshlet_write_commands_pipeline );
     gpu_commands->bind_descriptor_set( &meshlet_write_commands_descriptor_set[ current_frame_index ], 1, nullptr, 0 );
 
-    group_x = raptor::ceilu32( render_scene->active_lights / 32.0f );
+    group_x = raptor::ceilu32( render_scene->get_shadow_light_count() / 32.0f );
     gpu_commands->dispatch( group_x, 1, 1 );
 
     gpu_commands->global_debug_barrier();
@@ -2242,7 +2292,7 @@ void PointlightShadowPass::pre_render( u32 current_frame_index, CommandBuffer* g
     vec4s* gpu_light_aabbs = ( vec4s* )gpu->map_buffer( {light_aabbs, 0, 0} );
     if ( gpu_light_aabbs ) {
 
-        for ( u32 l = 0; l < render_scene->active_lights; ++l ) {
+        for ( u32 l = 0; l < render_scene->get_shadow_light_count(); ++l ) {
             const Light& light = render_scene->lights[ l ];
 
             gpu_light_aabbs[ l * 2 ] = light.aabb_min;
@@ -2259,7 +2309,7 @@ void PointlightShadowPass::pre_render( u32 current_frame_index, CommandBuffer* g
 
     gpu_commands->issue_buffer_barrier( shadow_resolutions[ current_frame_index ], ResourceState::RESOURCE_STATE_COPY_SOURCE, ResourceState::RESOURCE_STATE_UNORDERED_ACCESS, QueueType::Graphics, QueueType::Graphics );
 
-    gpu_commands->fill_buffer( shadow_resolutions[ current_frame_index ], 0, sizeof( u32 ) * render_scene->active_lights, 0 );
+    gpu_commands->fill_buffer( shadow_resolutions[ current_frame_index ], 0, sizeof( u32 ) * render_scene->get_shadow_light_count(), 0 );
     // 8 is the group size on both x and y for this shader.
     const f32 tile_size = 64.0f * 8.0f;
     const u32 tile_x_count = raptor::ceilu32( render_scene->scene_data.resolution_x / tile_size  );
@@ -2268,7 +2318,7 @@ void PointlightShadowPass::pre_render( u32 current_frame_index, CommandBuffer* g
 
     gpu_commands->issue_buffer_barrier( shadow_resolutions[ current_frame_index ], ResourceState::RESOURCE_STATE_UNORDERED_ACCESS, ResourceState::RESOURCE_STATE_COPY_SOURCE, QueueType::Graphics, QueueType::Graphics );
 
-    gpu_commands->copy_buffer( shadow_resolutions[ current_frame_index ], 0, shadow_resolutions_readback[ current_frame_index ], 0, sizeof( u32 ) * k_num_lights );
+    gpu_commands->copy_buffer( shadow_resolutions[ current_frame_index ], 0, shadow_resolutions_readback[ current_frame_index ], 0, sizeof( u32 ) * k_num_shadow_lights );
 }
 
 static void calculate_cubemap_view_projection( vec3s light_world_position, f32 light_radius, u32 face_index, mat4s& out_view_projection ) {
@@ -2484,7 +2534,7 @@ void PointlightShadowPass::render( u32 current_frame_index, CommandBuffer* gpu_c
                 shadow_texture_matrices[ 3 ].col[ 2 ] = { 0.f, 0.f, 0.f, 1.f };
                 shadow_texture_matrices[ 3 ].col[ 3 ] = { tile_position_x - (tile_size * .5f), tile_position_y, 0.f, 1.f };
 
-                for ( u32 l = 0; l < render_scene->active_lights; ++l ) {
+                for ( u32 l = 0; l < render_scene->get_shadow_light_count(); ++l ) {
                     const Light& light = render_scene->lights[ l ];
 
                     // Update camera spheres
@@ -2542,7 +2592,7 @@ void PointlightShadowPass::render( u32 current_frame_index, CommandBuffer* gpu_c
             DescriptorSetHandle handles[] = { render_scene->mesh_shader_early_descriptor_set[ current_frame_index ], cubemap_meshlet_draw_descriptor_set[ current_frame_index ] };
             gpu_commands->bind_descriptor_set( handles, 2, nullptr, 0 );
 
-            gpu_commands->draw_mesh_task_indirect_count( meshlet_shadow_indirect_cb[ current_frame_index ], 0, per_light_meshlet_instances[ current_frame_index ], sizeof( u32 ) * k_num_lights, layer_count, sizeof( vec4s ) );
+            gpu_commands->draw_mesh_task_indirect_count( meshlet_shadow_indirect_cb[ current_frame_index ], 0, per_light_meshlet_instances[ current_frame_index ], sizeof( u32 ) * k_num_shadow_lights, layer_count, sizeof( vec4s ) );
         } else {
             // Support for non-meshlet pointlights needed ?
         }
@@ -2557,7 +2607,7 @@ void PointlightShadowPass::render( u32 current_frame_index, CommandBuffer* gpu_c
         recreate_lightcount_dependent_resources( *render_scene );
 
         Texture* depth_texture_array = gpu->access_texture( cubemap_shadow_array_texture );
-        const u32 layer_count = 6 * render_scene->active_lights;
+        const u32 layer_count = 6 * render_scene->get_shadow_light_count();
 
         u32 width = depth_texture_array->width;
         u32 height = depth_texture_array->height;
@@ -2618,7 +2668,7 @@ void PointlightShadowPass::render( u32 current_frame_index, CommandBuffer* gpu_c
 
             if ( gpu_view_projections && gpu_light_spheres ) {
 
-                for ( u32 l = 0; l < render_scene->active_lights; ++l ) {
+                for ( u32 l = 0; l < render_scene->get_shadow_light_count(); ++l ) {
                     const Light& light = render_scene->lights[ l ];
 
                     // Update camera spheres
@@ -2688,7 +2738,7 @@ void PointlightShadowPass::render( u32 current_frame_index, CommandBuffer* gpu_c
             gpu_commands->bind_descriptor_set( handles, 2, nullptr, 0 );
 
             // Draw each light individually
-            for ( u32 l = 0; l < render_scene->active_lights; ++l ) {
+            for ( u32 l = 0; l < render_scene->get_shadow_light_count(); ++l ) {
                 const Light& light = render_scene->lights[ l ];
 
                 //rprint( "Shadow resolution %u, light %u\n", shadow_resolution_read[ l ], l );
@@ -2721,7 +2771,7 @@ void PointlightShadowPass::prepare_draws( RenderScene& scene, FrameGraph* frame_
                                           Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "point_shadows_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "point_shadows_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -2743,20 +2793,20 @@ void PointlightShadowPass::prepare_draws( RenderScene& scene, FrameGraph* frame_
 
     cubemap_render_pass = gpu.create_render_pass( render_pass_creation );
 
-    RASSERTM( 6 * k_num_lights <= gpu.max_framebuffer_layers, "Creating framebuffer with more layers than possible (max :%u, trying to create count %u). Refactor to have more layers", gpu.max_framebuffer_layers, 6 * k_num_lights );
+    RASSERTM( 6 * k_num_shadow_lights <= gpu.max_framebuffer_layers, "Creating framebuffer with more layers than possible (max :%u, trying to create count %u). Refactor to have more layers", gpu.max_framebuffer_layers, 6 * k_num_shadow_lights );
 
     // Create view constant buffer
     raptor::BufferCreation buffer_creation;
 
     for ( u32 i = 0; i < k_max_frames; ++i ) {
-        buffer_creation.set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( mat4s ) * 6 * k_num_lights ).set_name( "pointlight_pass_view_projections" );
+        buffer_creation.set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( mat4s ) * 6 * k_num_shadow_lights ).set_name( "pointlight_pass_view_projections" );
         pointlight_view_projections_cb[ i ] = gpu.create_buffer( buffer_creation );
 
-        buffer_creation.set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( vec4s ) * 6 * k_num_lights ).set_name( "pointlight_pass_spheres" );
+        buffer_creation.set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( vec4s ) * 6 * k_num_shadow_lights ).set_name( "pointlight_pass_spheres" );
         pointlight_spheres_cb[ i ] = gpu.create_buffer( buffer_creation );
     }
 
-    const u64 hashed_name = hash_calculate( "main" );
+    const u64 hashed_name = rhash( "main" );
     GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hashed_name );
 
     const u32 depth_cubemap_pass_index = main_technique->get_pass_index( "depth_cubemap" );
@@ -2781,7 +2831,7 @@ void PointlightShadowPass::prepare_draws( RenderScene& scene, FrameGraph* frame_
 
     DescriptorSetCreation ds_creation;
 
-    GpuTechnique* meshlet_technique = renderer->resource_cache.techniques.get( hash_calculate( "meshlet" ) );
+    GpuTechnique* meshlet_technique = renderer->resource_cache.techniques.get( rhash( "meshlet" ) );
 
     // Meshlet culling
     {
@@ -2791,12 +2841,12 @@ void PointlightShadowPass::prepare_draws( RenderScene& scene, FrameGraph* frame_
         meshlet_culling_pipeline = pass.pipeline;
 
         u32 max_per_light_meshlets = 45000;
-        u32 total_light_meshlets = k_num_lights * max_per_light_meshlets * 2;
+        u32 total_light_meshlets = k_num_shadow_lights * max_per_light_meshlets * 2;
 
         for ( u32 i = 0; i < k_max_frames; ++i ) {
 
             meshlet_visible_instances[ i ] = renderer->gpu->create_buffer( buffer_creation.set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Immutable, sizeof( u32 ) * total_light_meshlets ).set_name( "meshlet_visible_instances" ) );
-            per_light_meshlet_instances[ i ] = renderer->gpu->create_buffer( buffer_creation.set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, ResourceUsageType::Immutable, sizeof( u32 ) * ( k_num_lights + 1 ) * 2 ).set_name( "per_light_meshlet_instances" ) );
+            per_light_meshlet_instances[ i ] = renderer->gpu->create_buffer( buffer_creation.set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, ResourceUsageType::Immutable, sizeof( u32 ) * ( k_num_shadow_lights + 1 ) * 2 ).set_name( "per_light_meshlet_instances" ) );
 
             ds_creation.reset();
 
@@ -2820,7 +2870,7 @@ void PointlightShadowPass::prepare_draws( RenderScene& scene, FrameGraph* frame_
 
         for ( u32 i = 0; i < k_max_frames; ++i ) {
 
-            meshlet_shadow_indirect_cb[ i ] = renderer->gpu->create_buffer( buffer_creation.set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, ResourceUsageType::Immutable, sizeof( vec4s ) * k_num_lights * 6 ).set_name( "per_light_meshlet_shadow_indirect" ) );
+            meshlet_shadow_indirect_cb[ i ] = renderer->gpu->create_buffer( buffer_creation.set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, ResourceUsageType::Immutable, sizeof( vec4s ) * k_num_shadow_lights * 6 ).set_name( "per_light_meshlet_shadow_indirect" ) );
 
             ds_creation.reset();
             ds_creation.buffer( meshlet_visible_instances[ i ], 30 ).buffer( per_light_meshlet_instances[ i ], 31 ).buffer( meshlet_shadow_indirect_cb[ i ], 32 )
@@ -2861,12 +2911,12 @@ void PointlightShadowPass::prepare_draws( RenderScene& scene, FrameGraph* frame_
         GpuTechniquePass& pass = meshlet_technique->passes[ pass_index ];
         shadow_resolution_pipeline = pass.pipeline;
         // AABB is defined as 2 vec4, min and max vectors.
-        light_aabbs = renderer->gpu->create_buffer( buffer_creation.set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Immutable, sizeof( vec4s ) * k_num_lights * 2 ).set_name( "light_aabbs" ) );
+        light_aabbs = renderer->gpu->create_buffer( buffer_creation.set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Immutable, sizeof( vec4s ) * k_num_shadow_lights * 2 ).set_name( "light_aabbs" ) );
 
         for ( u32 i = 0; i < k_max_frames; ++i ) {
 
-            shadow_resolutions[ i ] = renderer->gpu->create_buffer( buffer_creation.set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Immutable, sizeof( u32 ) * k_num_lights ).set_name( "shadow_resolutions" ) );
-            shadow_resolutions_readback[ i ] = renderer->gpu->create_buffer( buffer_creation.set( VK_BUFFER_USAGE_TRANSFER_DST_BIT, ResourceUsageType::Readback, sizeof( u32 ) * k_num_lights ).set_name( "shadow_resolutions_readback" ) );
+            shadow_resolutions[ i ] = renderer->gpu->create_buffer( buffer_creation.set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Immutable, sizeof( u32 ) * k_num_shadow_lights ).set_name( "shadow_resolutions" ) );
+            shadow_resolutions_readback[ i ] = renderer->gpu->create_buffer( buffer_creation.set( VK_BUFFER_USAGE_TRANSFER_DST_BIT, ResourceUsageType::Readback, sizeof( u32 ) * k_num_shadow_lights ).set_name( "shadow_resolutions_readback" ) );
 
             DescriptorSetCreation ds_creation{ };
             ds_creation.reset();
@@ -2924,7 +2974,7 @@ void PointlightShadowPass::recreate_lightcount_dependent_resources( RenderScene&
 
     GpuDevice& gpu = *renderer->gpu;
 
-    const u32 active_lights = scene.active_lights;
+    const u32 active_lights = scene.get_shadow_light_count();
 
     if ( active_lights == last_active_lights ) {
         return;
@@ -3113,7 +3163,7 @@ void VolumetricFogPass::prepare_draws( RenderScene& scene, FrameGraph* frame_gra
 
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "volumetric_fog_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "volumetric_fog_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -3159,7 +3209,7 @@ void VolumetricFogPass::prepare_draws( RenderScene& scene, FrameGraph* frame_gra
     fog_constants = gpu.create_buffer( buffer_creation );
 
     // Cache frustum cull shader
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "volumetric_fog" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "volumetric_fog" ) );
     if ( technique ) {
         // Inject Data
         u32 pass_index = technique->get_pass_index( "inject_data" );
@@ -3298,7 +3348,7 @@ void VolumetricFogPass::update_dependent_resources( GpuDevice& gpu, FrameGraph*
     if ( !enabled )
         return;
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "volumetric_fog" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "volumetric_fog" ) );
     if ( technique ) {
         // Light scattering
         u32 pass_index = technique->get_pass_index( "light_scattering" );
@@ -3333,7 +3383,7 @@ void TemporalAntiAliasingPass::pre_render( u32 current_frame_index, CommandBuffe
     // TODO: fix.
     temp_taa_output = history_textures[ current_history_texture_index ];
 
-    FrameGraphResource* resource = frame_graph->get_resource( "final" );
+    FrameGraphResource* resource = frame_graph->get_resource( rhash( "final" ) );
     if ( resource ) {
         current_color_texture = resource->resource_info.texture.handle;
     }
@@ -3360,7 +3410,7 @@ void TemporalAntiAliasingPass::prepare_draws( RenderScene& scene, FrameGraph* fr
 
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "temporal_anti_aliasing_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "temporal_anti_aliasing_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -3383,7 +3433,7 @@ void TemporalAntiAliasingPass::prepare_draws( RenderScene& scene, FrameGraph* fr
     buffer_creation.reset().set( VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( GpuTaaConstants ) ).set_name("taa_constants");
     taa_constants = gpu.create_buffer( buffer_creation );
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "fullscreen" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "fullscreen" ) );
     if ( technique ) {
         u32 pass_index = technique->get_pass_index( "temporal_aa" );
         GpuTechniquePass& pass = technique->passes[ pass_index ];
@@ -3464,6 +3514,10 @@ void MotionVectorPass::render( u32 current_frame_index, CommandBuffer* gpu_comma
         return;
 }
 
+bool MotionVectorPass::supports_async_compute() {
+    return true;
+}
+
 void MotionVectorPass::on_resize( GpuDevice& gpu, FrameGraph* frame_graph, u32 new_width, u32 new_height ) {
     if ( !enabled )
         return;
@@ -3472,7 +3526,7 @@ void MotionVectorPass::on_resize( GpuDevice& gpu, FrameGraph* frame_graph, u32 n
 void MotionVectorPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "motion_vector_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "motion_vector_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -3483,9 +3537,9 @@ void MotionVectorPass::prepare_draws( RenderScene& scene, FrameGraph* frame_grap
 
     GpuDevice& gpu = *renderer->gpu;
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "fullscreen" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "fullscreen" ) );
     if ( technique ) {
-        FrameGraphResource* gubffer_normals_resource = frame_graph->get_resource( "gbuffer_normals" );
+        FrameGraphResource* gubffer_normals_resource = frame_graph->get_resource( rhash( "gbuffer_normals" ) );
         RASSERT( gubffer_normals_resource != nullptr );
 
         u32 pass_index = technique->get_pass_index( "composite_camera_motion" );
@@ -3523,9 +3577,9 @@ void MotionVectorPass::update_dependent_resources( GpuDevice& gpu, FrameGraph* f
 
     gpu.destroy_descriptor_set( camera_composite_descriptor_set );
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "fullscreen" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "fullscreen" ) );
     if ( technique ) {
-        FrameGraphResource* gubffer_normals_resource = frame_graph->get_resource( "gbuffer_normals" );
+        FrameGraphResource* gubffer_normals_resource = frame_graph->get_resource( rhash( "gbuffer_normals" ) );
         RASSERT( gubffer_normals_resource != nullptr );
 
         u32 pass_index = technique->get_pass_index( "composite_camera_motion" );
@@ -3693,7 +3747,7 @@ void IndirectPass::on_resize( GpuDevice& gpu, FrameGraph* frame_graph, u32 new_w
 void IndirectPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "indirect_lighting_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "indirect_lighting_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -3735,7 +3789,7 @@ void IndirectPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, A
 
     indirect_texture = gpu.create_texture( texture_creation );
 
-    FrameGraphResource* resource = frame_graph->get_resource( "indirect_lighting" );
+    FrameGraphResource* resource = frame_graph->get_resource( rhash( "indirect_lighting" ) );
     resource->resource_info.set_external_texture_2d( adjusted_width, adjusted_height, VK_FORMAT_R16G16B16A16_SFLOAT, 0, indirect_texture );
 
     // Radiance texture
@@ -3763,18 +3817,18 @@ void IndirectPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, A
     probe_offsets_texture = gpu.create_texture( texture_creation );
 
     // Cache normals texture
-    resource = frame_graph->get_resource( "gbuffer_normals" );
+    resource = frame_graph->get_resource( rhash( "gbuffer_normals" ) );
     normals_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "depth" );
+    resource = frame_graph->get_resource( rhash( "depth" ) );
     depth_fullscreen_texture = resource->resource_info.texture.handle;
 
     // TODO: at this point this resource is not created still.
     // Use manual assignment in FrameRenderer::upload_gpu_data as occlusion passes.
-    //resource = frame_graph->get_resource( "depth_pyramid" );
+    //resource = frame_graph->get_resource( rhash( "depth_pyramid" ) );
     //depth_pyramid_texture = resource->resource_info.texture.handle;
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "ddgi" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "ddgi" ) );
     if ( technique ) {
         // Probe raytracing
         u32 pass_index = technique->get_pass_index( "probe_rt" );
@@ -3967,7 +4021,7 @@ void ReflectionsPass::on_resize( GpuDevice& gpu, FrameGraph* frame_graph, u32 ne
 void ReflectionsPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "reflections_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "reflections_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -3986,13 +4040,13 @@ void ReflectionsPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph
     reflections_constants_buffer = gpu.create_buffer( buffer_creation );
 
     // Cache normals texture
-    FrameGraphResource* resource = frame_graph->get_resource( "gbuffer_normals" );
+    FrameGraphResource* resource = frame_graph->get_resource( rhash( "gbuffer_normals" ) );
     normals_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "gbuffer_occlusion_roughness_metalness" );
+    resource = frame_graph->get_resource( rhash( "gbuffer_occlusion_roughness_metalness" ) );
     roughness_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "indirect_lighting" );
+    resource = frame_graph->get_resource( rhash( "indirect_lighting" ) );
     indirect_texture = resource->resource_info.texture.handle;
 
     texture_scale = scene.rt_reflections_scale;
@@ -4004,7 +4058,7 @@ void ReflectionsPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph
 
     reflections_texture = gpu.create_texture( texture_creation );
 
-    resource = frame_graph->get_resource( "reflections" );
+    resource = frame_graph->get_resource( rhash( "reflections" ) );
     resource->resource_info.set_external_texture_2d( adjusted_width, adjusted_height, VK_FORMAT_B10G11R11_UFLOAT_PACK32, 0, reflections_texture );
 
     // Create BRDF Lut texture
@@ -4014,7 +4068,7 @@ void ReflectionsPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph
 
     scene.brdf_lut_texture = brdf_lut_texture;
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "reflections" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "reflections" ) );
     if ( technique ) {
         // Probe raytracing
         u32 pass_index = technique->get_pass_index( "reflections_rt" );
@@ -4091,7 +4145,7 @@ void ReflectionsPass::update_dependent_resources( GpuDevice& gpu, FrameGraph* fr
         return;
 
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "reflections" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "reflections" ) );
     if ( technique ) {
         gpu.destroy_descriptor_set( reflections_descriptor_set );
 
@@ -4189,7 +4243,7 @@ void SVGFAccumulationPass::on_resize( GpuDevice& gpu, FrameGraph* frame_graph, u
 void SVGFAccumulationPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "svgf_accumulation_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "svgf_accumulation_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -4210,31 +4264,31 @@ void SVGFAccumulationPass::prepare_draws( RenderScene& scene, FrameGraph* frame_
     gpu_constants = gpu.create_buffer( buffer_creation );
 
     // NOTE(marco): cache textures from previous passes
-    FrameGraphResource* resource = frame_graph->get_resource( "gbuffer_normals" );
+    FrameGraphResource* resource = frame_graph->get_resource( rhash( "gbuffer_normals" ) );
     normals_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "depth" );
+    resource = frame_graph->get_resource( rhash( "depth" ) );
     depth_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "mesh_id" );
+    resource = frame_graph->get_resource( rhash( "mesh_id" ) );
     mesh_id_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "motion_vectors" );
+    resource = frame_graph->get_resource( rhash( "motion_vectors" ) );
     motion_vectors_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "reflections" );
+    resource = frame_graph->get_resource( rhash( "reflections" ) );
     reflections_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "depth_normal_fwidth" );
+    resource = frame_graph->get_resource( rhash( "depth_normal_fwidth" ) );
     depth_normal_fwidth_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "linear_z_dd" );
+    resource = frame_graph->get_resource( rhash( "linear_z_dd" ) );
     linear_z_dd_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "integrated_reflection_color" );
+    resource = frame_graph->get_resource( rhash( "integrated_reflection_color" ) );
     integrated_color_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "integrated_moments" );
+    resource = frame_graph->get_resource( rhash( "integrated_moments" ) );
     integrated_moments_texture = resource->resource_info.texture.handle;
 
     TextureCreation texture_creation{ };
@@ -4244,30 +4298,30 @@ void SVGFAccumulationPass::prepare_draws( RenderScene& scene, FrameGraph* frame_
 
     reflections_history_texture = gpu.create_texture( texture_creation );
 
-    resource = frame_graph->get_resource( "reflections_history" );
+    resource = frame_graph->get_resource( rhash( "reflections_history" ) );
     resource->resource_info.set_external_texture_2d( adjusted_width, adjusted_height, VK_FORMAT_B10G11R11_UFLOAT_PACK32, 0, reflections_history_texture );
 
     texture_creation.set_format_type( VK_FORMAT_R16G16_SFLOAT, TextureType::Texture2D ).set_name( "moments_history" );
     moments_history_texture = gpu.create_texture( texture_creation );
-    resource = frame_graph->get_resource( "moments_history" );
+    resource = frame_graph->get_resource( rhash( "moments_history" ) );
     resource->resource_info.set_external_texture_2d( adjusted_width, adjusted_height, VK_FORMAT_R16G16_SFLOAT, 0, moments_history_texture );
 
     texture_creation.set_name( "normals_history" );
     last_frame_normals_texture = gpu.create_texture( texture_creation );
-    resource = frame_graph->get_resource( "normals_history" );
+    resource = frame_graph->get_resource( rhash( "normals_history" ) );
     resource->resource_info.set_external_texture_2d( adjusted_width, adjusted_height, VK_FORMAT_R16G16_SFLOAT, 0, last_frame_normals_texture );
 
     texture_creation.set_name( "linear_depth_history" );
     last_frame_linear_depth_texture = gpu.create_texture( texture_creation );
-    resource = frame_graph->get_resource( "depth_history" );
+    resource = frame_graph->get_resource( rhash( "depth_history" ) );
     resource->resource_info.set_external_texture_2d( adjusted_width, adjusted_height, VK_FORMAT_R16G16_SFLOAT, 0, last_frame_linear_depth_texture );
 
     texture_creation.set_format_type( VK_FORMAT_R32_UINT, TextureType::Texture2D ).set_name( "mesh_id_history" );
     last_frame_mesh_id_texture = gpu.create_texture( texture_creation );
-    resource = frame_graph->get_resource( "mesh_id_history" );
+    resource = frame_graph->get_resource( rhash( "mesh_id_history" ) );
     resource->resource_info.set_external_texture_2d( adjusted_width, adjusted_height, VK_FORMAT_R32_UINT, 0, last_frame_mesh_id_texture );
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "reflections" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "reflections" ) );
     if ( technique ) {
         // Probe raytracing
         u32 pass_index = technique->get_pass_index( "svgf_accumulation" );
@@ -4339,7 +4393,7 @@ void SVGFAccumulationPass::free_gpu_resources( GpuDevice& gpu ) {
 void SVGFAccumulationPass::reload_shaders( RenderScene& scene, FrameGraph* frame_graph,
                                            Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "reflections" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "reflections" ) );
     if ( technique ) {
         GpuDevice& gpu = *renderer->gpu;
         gpu.destroy_descriptor_set( descriptor_set );
@@ -4415,7 +4469,7 @@ void SVGFVariancePass::on_resize( GpuDevice& gpu, FrameGraph* frame_graph, u32 n
 void SVGFVariancePass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "svgf_variance_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "svgf_variance_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -4436,52 +4490,52 @@ void SVGFVariancePass::prepare_draws( RenderScene& scene, FrameGraph* frame_grap
     gpu_constants = gpu.create_buffer( buffer_creation );
 
     // NOTE(marco): cache textures from previous passes
-    FrameGraphResource* resource = frame_graph->get_resource( "gbuffer_normals" );
+    FrameGraphResource* resource = frame_graph->get_resource( rhash( "gbuffer_normals" ) );
     normals_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "depth" );
+    resource = frame_graph->get_resource( rhash( "depth" ) );
     depth_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "mesh_id" );
+    resource = frame_graph->get_resource( rhash( "mesh_id" ) );
     mesh_id_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "motion_vectors" );
+    resource = frame_graph->get_resource( rhash( "motion_vectors" ) );
     motion_vectors_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "reflections" );
+    resource = frame_graph->get_resource( rhash( "reflections" ) );
     reflections_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "depth_normal_fwidth" );
+    resource = frame_graph->get_resource( rhash( "depth_normal_fwidth" ) );
     depth_normal_fwidth_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "linear_z_dd" );
+    resource = frame_graph->get_resource( rhash( "linear_z_dd" ) );
     linear_z_dd_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "integrated_reflection_color" );
+    resource = frame_graph->get_resource( rhash( "integrated_reflection_color" ) );
     integrated_color_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "integrated_moments" );
+    resource = frame_graph->get_resource( rhash( "integrated_moments" ) );
     integrated_moments_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "svgf_variance" );
+    resource = frame_graph->get_resource( rhash( "svgf_variance" ) );
     variance_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "reflections_history" );
+    resource = frame_graph->get_resource( rhash( "reflections_history" ) );
     reflections_history_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "moments_history" );
+    resource = frame_graph->get_resource( rhash( "moments_history" ) );
     moments_history_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "normals_history" );
+    resource = frame_graph->get_resource( rhash( "normals_history" ) );
     last_frame_normals_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "mesh_id_history" );
+    resource = frame_graph->get_resource( rhash( "mesh_id_history" ) );
     last_frame_mesh_id_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "depth_history" );
+    resource = frame_graph->get_resource( rhash( "depth_history" ) );
     last_frame_linear_depth_texture = resource->resource_info.texture.handle;
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "reflections" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "reflections" ) );
     if ( technique ) {
         
         u32 pass_index = technique->get_pass_index( "svgf_variance" );
@@ -4559,7 +4613,7 @@ void SVGFVariancePass::free_gpu_resources( GpuDevice& gpu ) {
 
 void SVGFVariancePass::reload_shaders( RenderScene& scene, FrameGraph* frame_graph,
                                        Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "reflections" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "reflections" ) );
     if ( technique ) {
         GpuDevice& gpu = *renderer->gpu;
         gpu.destroy_descriptor_set( descriptor_set );
@@ -4661,7 +4715,7 @@ void SVGFWaveletPass::on_resize( GpuDevice& gpu, FrameGraph* frame_graph, u32 ne
 void SVGFWaveletPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
     renderer = scene.renderer;
 
-    FrameGraphNode* node = frame_graph->get_node( "svgf_wavelet_pass" );
+    FrameGraphNode* node = frame_graph->get_node( rhash( "svgf_wavelet_pass" ) );
     if ( node == nullptr ) {
         enabled = false;
 
@@ -4694,55 +4748,55 @@ void SVGFWaveletPass::prepare_draws( RenderScene& scene, FrameGraph* frame_graph
     ping_pong_variance_texture = gpu.create_texture( texture_creation );
 
     // NOTE(marco): cache textures from previous passes
-    FrameGraphResource* resource = frame_graph->get_resource( "gbuffer_normals" );
+    FrameGraphResource* resource = frame_graph->get_resource( rhash( "gbuffer_normals" ) );
     normals_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "depth" );
+    resource = frame_graph->get_resource( rhash( "depth" ) );
     depth_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "mesh_id" );
+    resource = frame_graph->get_resource( rhash( "mesh_id" ) );
     mesh_id_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "motion_vectors" );
+    resource = frame_graph->get_resource( rhash( "motion_vectors" ) );
     motion_vectors_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "reflections" );
+    resource = frame_graph->get_resource( rhash( "reflections" ) );
     reflections_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "depth_normal_fwidth" );
+    resource = frame_graph->get_resource( rhash( "depth_normal_fwidth" ) );
     depth_normal_fwidth_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "linear_z_dd" );
+    resource = frame_graph->get_resource( rhash( "linear_z_dd" ) );
     linear_z_dd_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "integrated_reflection_color" );
+    resource = frame_graph->get_resource( rhash( "integrated_reflection_color" ) );
     integrated_color_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "integrated_moments" );
+    resource = frame_graph->get_resource( rhash( "integrated_moments" ) );
     integrated_moments_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "svgf_variance" );
+    resource = frame_graph->get_resource( rhash( "svgf_variance" ) );
     variance_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "reflections_history" );
+    resource = frame_graph->get_resource( rhash( "reflections_history" ) );
     reflections_history_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "moments_history" );
+    resource = frame_graph->get_resource( rhash( "moments_history" ) );
     moments_history_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "normals_history" );
+    resource = frame_graph->get_resource( rhash( "normals_history" ) );
     last_frame_normals_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "mesh_id_history" );
+    resource = frame_graph->get_resource( rhash( "mesh_id_history" ) );
     last_frame_mesh_id_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "depth_history" );
+    resource = frame_graph->get_resource( rhash( "depth_history" ) );
     last_frame_linear_depth_texture = resource->resource_info.texture.handle;
 
-    resource = frame_graph->get_resource( "svgf_output" );
+    resource = frame_graph->get_resource( rhash( "svgf_output" ) );
     resource->resource_info.set_external_texture_2d( adjusted_width, adjusted_height, VK_FORMAT_B10G11R11_UFLOAT_PACK32, 0, ping_pong_color_texture );
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "reflections" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "reflections" ) );
     if ( technique ) {
         
         u32 pass_index = technique->get_pass_index( "svgf_wavelet" );
@@ -4819,7 +4873,7 @@ void SVGFWaveletPass::free_gpu_resources( GpuDevice& gpu ) {
 void SVGFWaveletPass::reload_shaders( RenderScene& scene, FrameGraph* frame_graph,
                                       Allocator* resident_allocator, StackAllocator* scratch_allocator ) {
 
-    GpuTechnique* technique = renderer->resource_cache.techniques.get( hash_calculate( "reflections" ) );
+    GpuTechnique* technique = renderer->resource_cache.techniques.get( rhash( "reflections" ) );
     if ( technique ) {
         GpuDevice& gpu = *renderer->gpu;
         
@@ -4849,152 +4903,30 @@ void SVGFWaveletPass::update_dependent_resources( GpuDevice& gpu, FrameGraph* fr
 }
 
 // RenderScene ////////////////////////////////////////////////////////////
-CommandBuffer* RenderScene::update_physics( f32 delta_time, f32 air_density, f32 spring_stiffness, f32 spring_damping, vec3s wind_direction, bool reset_simulation ) {
+CommandBuffer* RenderScene::update_physics( f32 delta_time, f32 air_density, f32 spring_stiffness, f32 spring_damping, vec3s wind_direction, bool reset_simulation, enki::TaskScheduler* task_scheduler ) {
     // Based on http://graphics.stanford.edu/courses/cs468-02-winter/Papers/Rigidcloth.pdf
-
-#if 0
-    // NOTE(marco): left for reference
-    const u32 sim_steps = 10;
-    const f32 dt_multiplier = 1.0f / sim_steps;
-    delta_time *= dt_multiplier;
-
-    const vec3s g{ 0.0f, -9.8f, 0.0f };
-
-    for ( u32 m = 0; m < meshes.size; ++m ) {
-        Mesh& mesh = meshes[ m ];
-
-        PhysicsMesh* physics_mesh = mesh.physics_mesh;
-
-        if ( physics_mesh != nullptr ) {
-            const vec3s fixed_vertex_1{ 0.0f,  1.0f, -1.0f };
-            const vec3s fixed_vertex_2{ 0.0f,  1.0f,  1.0f };
-            const vec3s fixed_vertex_3{ 0.0f, -1.0f,  1.0f };
-            const vec3s fixed_vertex_4{ 0.0f, -1.0f, -1.0f };
-
-            if ( reset_simulation ) {
-                for ( u32 v = 0; v < physics_mesh->vertices.size; ++v ) {
-                    PhysicsVertex& vertex = physics_mesh->vertices[ v ];
-                    vertex.position = vertex.start_position;
-                    vertex.previous_position = vertex.start_position;
-                    vertex.velocity = vec3s{ };
-                    vertex.force = vec3s{ };
-                }
-            }
-
-            for ( u32 s = 0; s < sim_steps; ++s ) {
-                // First calculate the force to apply to each vertex
-                for ( u32 v = 0; v < physics_mesh->vertices.size; ++v ) {
-                    PhysicsVertex& vertex = physics_mesh->vertices[ v ];
-
-                    if ( glms_vec3_eqv( vertex.start_position, fixed_vertex_1 ) || glms_vec3_eqv( vertex.start_position, fixed_vertex_2 ) ||
-                        glms_vec3_eqv( vertex.start_position, fixed_vertex_3 ) || glms_vec3_eqv( vertex.start_position, fixed_vertex_4 )) {
-                        continue;
-                    }
-
-                    f32 m = vertex.mass;
-
-                    vec3s spring_force{ };
-
-                    for ( u32 j = 0; j < vertex.joint_count; ++j ) {
-                        PhysicsVertex& other_vertex = physics_mesh->vertices[ vertex.joints[ j ].vertex_index ];
-
-                        f32 spring_rest_length =  glms_vec3_distance( vertex.start_position, other_vertex.start_position );
-
-                        vec3s pull_direction = glms_vec3_sub( vertex.position, other_vertex.position );
-                        vec3s relative_pull_direction = glms_vec3_sub( pull_direction, glms_vec3_scale( glms_vec3_normalize( pull_direction ), spring_rest_length ) );
-                        pull_direction = glms_vec3_scale( relative_pull_direction, spring_stiffness );
-                        spring_force = glms_vec3_add( spring_force, pull_direction );
-                    }
-
-                    vec3s viscous_damping = glms_vec3_scale( vertex.velocity, -spring_damping );
-
-                    vec3s viscous_velocity = glms_vec3_sub( wind_direction, vertex.velocity );
-                    viscous_velocity = glms_vec3_scale( vertex.normal, glms_vec3_dot( vertex.normal, viscous_velocity ) );
-                    viscous_velocity = glms_vec3_scale( viscous_velocity, air_density );
-
-                    vertex.force = glms_vec3_scale( g, m );
-                    vertex.force = glms_vec3_sub( vertex.force, spring_force );
-                    vertex.force = glms_vec3_add( vertex.force, viscous_damping );
-                    vertex.force = glms_vec3_add( vertex.force, viscous_velocity );
-                }
-
-                // Then update their position
-                for ( u32 v = 0; v < physics_mesh->vertices.size; ++v ) {
-                    PhysicsVertex& vertex = physics_mesh->vertices[ v ];
-
-                    vec3s previous_position = vertex.previous_position;
-                    vec3s current_position = vertex.position;
-
-                    // Verlet integration
-                    vertex.position = glms_vec3_scale( current_position, 2.0f );
-                    vertex.position = glms_vec3_sub( vertex.position, previous_position );
-                    vertex.position = glms_vec3_add( vertex.position, glms_vec3_scale( vertex.force, delta_time * delta_time ) );
-
-                    vertex.previous_position = current_position;
-
-                    vertex.velocity = glms_vec3_sub( vertex.position, current_position );
-                }
-            }
-
-            Buffer* position_buffer = renderer->gpu->access_buffer( mesh.position_buffer );
-            vec3s* positions = ( vec3s* )( position_buffer->mapped_data + mesh.position_offset );
-
-            Buffer* normal_buffer = renderer->gpu->access_buffer( mesh.normal_buffer );
-            vec3s* normals = ( vec3s* )( normal_buffer->mapped_data + mesh.normal_offset );
-
-            Buffer* tangent_buffer = renderer->gpu->access_buffer( mesh.tangent_buffer );
-            vec3s* tangents = ( vec3s* )( tangent_buffer->mapped_data + mesh.tangent_offset );
-
-            Buffer* index_buffer = renderer->gpu->access_buffer( mesh.index_buffer );
-            u32* indices = ( u32* )( index_buffer->mapped_data + mesh.index_offset );
-
-            for ( u32 v = 0; v < physics_mesh->vertices.size; ++v ) {
-                positions[ v ] = physics_mesh->vertices[ v ].position;
-            }
-
-            for ( u32 i = 0; i < mesh.primitive_count; i += 3 ) {
-                u32 i0 = indices[ i + 0 ];
-                u32 i1 = indices[ i + 1 ];
-                u32 i2 = indices[ i + 2 ];
-
-                vec3s p0 = physics_mesh->vertices[ i0 ].position;
-                vec3s p1 = physics_mesh->vertices[ i1 ].position;
-                vec3s p2 = physics_mesh->vertices[ i2 ].position;
-
-                // TODO(marco): better normal compuation, also update tangents
-                vec3s edge1 = glms_vec3_sub( p1, p0 );
-                vec3s edge2 = glms_vec3_sub( p2, p0 );
-
-                vec3s n = glms_cross( edge1, edge2 );
-
-                physics_mesh->vertices[ i0 ].normal = glms_normalize( glms_vec3_add( normals[ i0 ], n ) );
-                physics_mesh->vertices[ i1 ].normal = glms_normalize( glms_vec3_add( normals[ i1 ], n ) );
-                physics_mesh->vertices[ i2 ].normal = glms_normalize( glms_vec3_add( normals[ i2 ], n ) );
-
-                normals[ i0 ] = physics_mesh->vertices[ i0 ].normal;
-                normals[ i1 ] = physics_mesh->vertices[ i1 ].normal;
-                normals[ i2 ] = physics_mesh->vertices[ i2 ].normal;
-            }
-        }
-    }
-#else
+    // The CPU path uses the fixed time step of the shader, delta_time is ignored by both.
     if ( physics_cb.index == k_invalid_buffer.index )
         return nullptr;
 
     GpuDevice& gpu = *renderer->gpu;
 
-    MapBufferParameters physics_cb_map = { physics_cb, 0, 0 };
-    PhysicsSceneData* gpu_physics_data = ( PhysicsSceneData* )gpu.map_buffer( physics_cb_map );
-    if ( gpu_physics_data ) {
-        gpu_physics_data->wind_direction = wind_direction;
-        gpu_physics_data->reset_simulation = reset_simulation ? 1 : 0;
-        gpu_physics_data->air_density = air_density;
-        gpu_physics_data->spring_stiffness = spring_stiffness;
-        gpu_physics_data->spring_damping = spring_damping;
-
-        gpu.unmap_buffer( physics_cb_map );
+    if ( !physics_on_cpu ) {
+        MapBufferParameters physics_cb_map = { physics_cb, 0, 0 };
+        PhysicsSceneData* gpu_physics_data = ( PhysicsSceneData* )gpu.map_buffer( physics_cb_map );
+        if ( gpu_physics_data ) {
+            gpu_physics_data->wind_direction = wind_direction;
+            gpu_physics_data->reset_simulation = reset_simulation ? 1 : 0;
+            gpu_physics_data->air_density = air_density;
+            gpu_physics_data->spring_stiffness = spring_stiffness;
+            gpu_physics_data->spring_damping = spring_damping;
+
+            gpu.unmap_buffer( physics_cb_map );
+        }
     }
 
+    const ClothParameters cloth_parameters{ wind_direction, air_density, spring_stiffness, spring_damping };
+
     CommandBuffer* cb = nullptr;
 
     for ( u32 m = 0; m < meshes.size; ++m ) {
@@ -5018,10 +4950,34 @@ CommandBuffer* RenderScene::update_physics( f32 delta_time, f32 air_density, f32
                 cb->push_marker( "Frame" );
                 cb->push_marker( "async" );
 
-                const u64 cloth_hashed_name = hash_calculate( "cloth" );
-                GpuTechnique* cloth_technique = renderer->resource_cache.techniques.get( cloth_hashed_name );
+                if ( !physics_on_cpu ) {
+                    const u64 cloth_hashed_name = rhash( "cloth" );
+                    GpuTechnique* cloth_technique = renderer->resource_cache.techniques.get( cloth_hashed_name );
+
+                    cb->bind_pipeline( cloth_technique->passes[ 0 ].pipeline );
+                }
+            }
+
+            if ( physics_on_cpu ) {
+                ClothSolver& solver = physics_mesh->cpu_solver;
+                if ( reset_simulation ) {
+                    solver.reset();
+                }
+
+                solver.update( cloth_parameters, task_scheduler );
+
+                // Each frame in flight has its own staging region, copied into the vertex attributes.
+                const sizet attribute_size = sizeof( vec3s ) * solver.vertex_count;
+                const sizet staging_offset = attribute_size * 2 * gpu.current_frame;
 
-                cb->bind_pipeline( cloth_technique->passes[ 0 ].pipeline );
+                Buffer* staging_buffer = gpu.access_buffer( physics_mesh->cpu_attributes_buffer );
+                vec3s* positions = ( vec3s* )( staging_buffer->mapped_data + staging_offset );
+                solver.write_attributes( positions, positions + solver.vertex_count );
+
+                cb->copy_buffer( physics_mesh->cpu_attributes_buffer, staging_offset, mesh.position_buffer, mesh.position_offset, attribute_size );
+                cb->copy_buffer( physics_mesh->cpu_attributes_buffer, staging_offset + attribute_size, mesh.normal_buffer, mesh.normal_offset, attribute_size );
+
+                continue;
             }
 
             cb->bind_descriptor_set( &physics_mesh->descriptor_set, 1, nullptr, 0 );
@@ -5044,223 +5000,290 @@ CommandBuffer* RenderScene::update_physics( f32 delta_time, f32 air_density, f32
     }
 
     return cb;
-#endif
 }
 
-// TODO: refactor
-Transform animated_transforms[ 256 ];
-
-void RenderScene::update_animations( f32 delta_time ) {
+void RenderScene::update_animations( FramePipeline* frame_pipeline, f32 delta_time, enki::TaskScheduler* task_scheduler ) {
 
     if ( animations.size == 0 ) {
         return;
     }
 
-    // TODO: update the first animation as test
-    Animation& animation = animations[ 0 ];
-    static f32 current_time = 0.f;
+    frame_pipeline->apply_simulation( &animation_system, animations.data, scene_graph, delta_time, task_scheduler );
+}
+
+void RenderScene::kick_animations( FramePipeline* frame_pipeline, f32 delta_time, enki::TaskScheduler* task_scheduler ) {
 
-    current_time += delta_time;
-    if ( current_time > animation.time_end ) {
-        current_time -= animation.time_end;
+    if ( animations.size == 0 ) {
+        return;
     }
 
-    // TODO: fix skeleton/scene graph relationship
-    for ( u32 i = 0; i < 256; ++i ) {
+    frame_pipeline->kick_simulation( &animation_system, animations.data, delta_time, task_scheduler );
+}
 
-        Transform& transform = animated_transforms[ i ];
-        transform.reset();
-    }
-    // Accumulate transformations
+void SkinningTask::ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) {
+    ZoneScoped;
 
-    u8 changed[ 256 ];
-    memset( changed, 0, 256 );
+    GpuDevice& gpu = *render_scene->renderer->gpu;
+    SceneGraph* scene_graph = render_scene->scene_graph;
 
-    // For each animation channel
-    for ( u32 ac = 0; ac < animation.channels.size; ++ac ) {
-        AnimationChannel& channel = animation.channels[ ac ];
-        AnimationSampler& sampler = animation.samplers[ channel.sampler ];
+    for ( u32 i = range_.start; i < range_.end; ++i ) {
+        Skin& skin = render_scene->skins[ i ];
+        const AnimationPose& pose = render_scene->animation_system.poses[ skin.animation_pose ];
 
-        if ( sampler.interpolation_type != AnimationSampler::Linear ) {
-            rprint( "Interpolation %s still not supported.\n", sampler.interpolation_type );
+        // Safe to write: the frame that last read this palette was waited on by new_frame.
+        mat4s* palette = ( mat4s* )gpu.access_buffer( skin.joint_transforms[ gpu.current_frame ] )->mapped_data;
+        if ( palette == nullptr ) {
             continue;
         }
 
-        // Scroll through all key frames
-        for ( u32 ki = 0; ki < sampler.key_frames.size - 1; ++ki ) {
-            const f32 keyframe = sampler.key_frames[ ki ];
-            const f32 next_keyframe = sampler.key_frames[ ki + 1 ];
-            if ( current_time >= keyframe && current_time <= next_keyframe ) {
-
-                const f32 interpolation = ( current_time - keyframe ) / ( next_keyframe - keyframe );
-
-                RASSERT( channel.target_node < 256 );
-                changed[ channel.target_node ] = 1;
-                Transform& transform = animated_transforms[ channel.target_node ];
-                switch ( channel.target_type ) {
-                    case AnimationChannel::TargetType::Translation:
-                    {
-                        const vec3s current_data{ sampler.data[ ki ].x, sampler.data[ ki ].y, sampler.data[ ki ].z };
-                        const vec3s next_data{ sampler.data[ ki + 1 ].x, sampler.data[ ki + 1 ].y, sampler.data[ ki + 1 ].z };
-                        transform.translation = glms_vec3_lerp( current_data, next_data, interpolation );
-
-                        break;
-                    }
-                    case AnimationChannel::TargetType::Rotation:
-                    {
-                        const vec4s current_data = sampler.data[ ki ];
-                        const versors current_rotation = glms_quat_init( current_data.x, current_data.y, current_data.z, current_data.w );
-
-                        const vec4s next_data = sampler.data[ ki + 1 ];
-                        const versors next_rotation = glms_quat_init( next_data.x, next_data.y, next_data.z, next_data.w );
-
-                        transform.rotation = glms_quat_normalize( glms_quat_slerp( current_rotation, next_rotation, interpolation ) );
-
-                        break;
-                    }
-                    case AnimationChannel::TargetType::Scale:
-                    {
-                        const vec3s current_data{ sampler.data[ ki ].x, sampler.data[ ki ].y, sampler.data[ ki ].z };
-                        const vec3s next_data{ sampler.data[ ki + 1 ].x, sampler.data[ ki + 1 ].y, sampler.data[ ki + 1 ].z };
-                        transform.scale = glms_vec3_lerp( current_data, next_data, interpolation );
-
-                        break;
-                    }
-                    default:
-                        break;
-                }
-
-                break;
-            }
-        }
+        const mat4s inverse_mesh_world = skin.mesh_node != -1 ? glms_mat4_inv( scene_graph->world_matrices[ skin.mesh_node ] ) : glms_mat4_identity();
+        skinning_compute_palette( scene_graph->world_matrices.data, skin.joints.data, skin.joints.size, pose.node_offset,
+                                  skin.inverse_bind_matrices, inverse_mesh_world, palette );
     }
 }
 
-// TODO: remove, improve
-mat4s get_local_matrix( SceneGraph* scene_graph, u32 node_index ) {
-    const mat4s& a = animated_transforms[ node_index ].calculate_matrix();
-    // NOTE(marco): according to the spec (3.7.3.2)
-    // Only the joint transforms are applied to the skinned mesh; the transform of the skinned mesh node MUST be ignored
-    return a;
+void RenderScene::update_joints( enki::TaskScheduler* task_scheduler ) {
+    ZoneScoped;
+
+    if ( skins.size == 0 ) {
+        return;
+    }
+
+    skinning_task.render_scene = this;
+
+    if ( task_scheduler && skins.size > 1 ) {
+        skinning_task.m_SetSize = skins.size;
+
+        task_scheduler->AddTaskSetToPipe( &skinning_task );
+        task_scheduler->WaitforTask( &skinning_task );
+    } else {
+        skinning_task.ExecuteRange( { 0, skins.size }, 0 );
+    }
 }
 
-mat4s get_node_transform( SceneGraph* scene_graph, u32 node_index ) {
-    mat4s node_transform = get_local_matrix( scene_graph, node_index );
+bool RenderScene::get_world_bounding_sphere( vec3s& center, f32& radius ) const {
+    vec3s aabb_min{ FLT_MAX, FLT_MAX, FLT_MAX }, aabb_max{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    bool found = false;
+
+    const mat4s scale_matrix = glms_scale_make( { global_scale, global_scale, -global_scale } );
+    for ( u32 i = 0; i < mesh_instances.size; ++i ) {
+        const MeshInstance& mesh_instance = mesh_instances[ i ];
+        const vec4s bounding_sphere = mesh_instance.mesh->bounding_sphere;
+        if ( bounding_sphere.w <= 0.f ) {
+            continue;
+        }
+
+        const mat4s world = glms_mat4_mul( scale_matrix, scene_graph->world_matrices[ mesh_instance.scene_graph_node_index ] );
+        const vec4s world_center = glms_mat4_mulv( world, vec4s{ bounding_sphere.x, bounding_sphere.y, bounding_sphere.z, 1.f } );
 
-    i32 parent = scene_graph->nodes_hierarchy[ node_index ].parent;
-    while ( parent >= 0 ) {
-        node_transform = glms_mat4_mul( get_local_matrix( scene_graph, parent ), node_transform );
+        // Largest axis scale, so that the sphere stays conservative under non uniform scales.
+        const f32 axis_scale = raptor::max( glms_vec3_norm( glms_vec3( world.col[ 0 ] ) ), raptor::max( glms_vec3_norm( glms_vec3( world.col[ 1 ] ) ), glms_vec3_norm( glms_vec3( world.col[ 2 ] ) ) ) );
+        const vec3s extent = glms_vec3_fill( bounding_sphere.w * axis_scale );
 
-        parent = scene_graph->nodes_hierarchy[ parent ].parent;
+        aabb_min = glms_vec3_minv( aabb_min, glms_vec3_sub( glms_vec3( world_center ), extent ) );
+        aabb_max = glms_vec3_maxv( aabb_max, glms_vec3_add( glms_vec3( world_center ), extent ) );
+        found = true;
     }
 
-    return node_transform;
+    if ( !found ) {
+        return false;
+    }
+
+    center = glms_vec3_scale( glms_vec3_add( aabb_min, aabb_max ), 0.5f );
+    radius = glms_vec3_distance( aabb_min, aabb_max ) * 0.5f;
+    return true;
 }
 
-void RenderScene::update_joints() {
+//
+// Scene buffer uploads ///////////////////////////////////////////////////
 
-    for ( u32 i = 0; i < skins.size; i++ ) {
-        Skin& skin = skins[ i ];
+// Dirty elements separated by up to this many clean ones share a copy region, the clean ones are copied again.
+static const u32 k_upload_max_gap = 4;
 
-        // Calculate joint transforms and upload to GPU
-        MapBufferParameters cb_map { skin.joint_transforms, 0, 0 };
-        mat4s* joint_transforms = (mat4s*)renderer->gpu->map_buffer( cb_map );
+struct SceneUploadRange {
+    u32                 first;
+    u32                 count;
+}; // struct SceneUploadRange
 
-        if ( joint_transforms ) {
-            for ( u32 ji = 0; ji < skin.joints.size; ji++ ) {
-                u32 joint = skin.joints[ ji ];
+//
+// Clears the dirty bits while merging them into ranges.
+static void gather_dirty_ranges( BitSet& dirty, u32 element_count, Array<SceneUploadRange>& ranges, u32& dirty_count ) {
+    for ( u32 byte = 0; byte < dirty.size; ++byte ) {
+        u32 bits = dirty.bits[ byte ];
+        if ( bits == 0 ) {
+            continue;
+        }
+        dirty.bits[ byte ] = 0;
 
-                mat4s& joint_transform = joint_transforms[ ji ];
+        while ( bits ) {
+            const u32 index = byte * 8 + trailing_zeros_u32( bits );
+            bits &= bits - 1;
 
-                joint_transform = glms_mat4_mul( get_node_transform( scene_graph, joint ), skin.inverse_bind_matrices[ ji ] );
+            if ( index >= element_count ) {
+                break;
             }
+            ++dirty_count;
 
-            renderer->gpu->unmap_buffer( cb_map );
+            if ( ranges.size && index - ( ranges.back().first + ranges.back().count ) <= k_upload_max_gap ) {
+                ranges.back().count = index + 1 - ranges.back().first;
+            } else {
+                ranges.push( { index, 1 } );
+            }
         }
     }
 }
 
-struct SortedLight {
+static void add_upload_region( Array<VkBufferCopy>& regions, u32 staging_offset, const SceneUploadRange& range, u32 element_size ) {
+    VkBufferCopy region{ };
+    region.srcOffset = staging_offset;
+    region.dstOffset = ( VkDeviceSize )range.first * element_size;
+    region.size = ( VkDeviceSize )range.count * element_size;
+    regions.push( region );
+}
 
-    u32             light_index;
-    f32             projected_z;
-    f32             projected_z_min;
-    f32             projected_z_max;
-}; // struct SortedLight
+static void copy_upload_regions( GpuDevice& gpu, CommandBuffer* cb, BufferHandle staging_buffer, BufferHandle buffer_handle, const Array<VkBufferCopy>& regions ) {
+    if ( regions.size == 0 ) {
+        return;
+    }
 
-static int sorting_light_fn( const void* a, const void* b ) {
-    const SortedLight* la = (const SortedLight*)a;
-    const SortedLight* lb = (const SortedLight*)b;
+    Buffer* buffer = gpu.access_buffer( buffer_handle );
 
-    if ( la->projected_z < lb->projected_z ) return -1;
-    else if ( la->projected_z > lb->projected_z ) return 1;
-    return 0;
+    // Scene buffers are read by the task and mesh shaders of the meshlet passes and by the ray tracing passes,
+    // both covered by the stages of the shader resource state.
+    util_add_buffer_barrier( &gpu, cb->vk_command_buffer, buffer->vk_buffer, RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_COPY_DEST, buffer->size );
+    cb->copy_buffer( staging_buffer, buffer_handle, regions.data, regions.size );
+    util_add_buffer_barrier( &gpu, cb->vk_command_buffer, buffer->vk_buffer, RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_SHADER_RESOURCE, buffer->size );
+}
+
+void SceneUploadStats::debug_ui() {
+    ImGui::Text( "Dirty meshes %u, dirty instances %u", dirty_meshes, dirty_instances );
+    ImGui::Text( "Uploaded %u of %u bytes in %u copy regions", bytes_uploaded, bytes_total, copy_regions );
+}
+
+void RenderScene::mark_mesh_dirty( u32 mesh_index ) {
+    dirty_meshes.set_bit( mesh_index );
+}
+
+void RenderScene::mark_all_dirty() {
+    memset( dirty_meshes.bits, 0xff, dirty_meshes.size );
+    memset( dirty_mesh_instances.bits, 0xff, dirty_mesh_instances.size );
 }
 
 void RenderScene::upload_gpu_data( UploadGpuDataContext& context ) {
 
     GpuDevice& gpu = *renderer->gpu;
 
-    // Update per mesh material buffer
-    // TODO: update only changed stuff, this is now dynamic so it can't be done.
-    MapBufferParameters cb_map = { meshes_sb, 0, 0 };
-    GpuMaterialData* gpu_mesh_data = ( GpuMaterialData* )gpu.map_buffer( cb_map );
-    if ( gpu_mesh_data ) {
-        for ( u32 mesh_index = 0; mesh_index < meshes.size; ++mesh_index ) {
-            copy_gpu_material_data( gpu, gpu_mesh_data[ mesh_index ], meshes[ mesh_index ] );
-        }
-        gpu.unmap_buffer( cb_map );
-    }
+    sizet current_marker = context.scratch_allocator->get_marker();
 
-    // Copy mesh bounding spheres
-    cb_map.buffer = mesh_bounds_sb;
-    vec4s* gpu_bounds_data = (vec4s*)gpu.map_buffer( cb_map );
-    if ( gpu_bounds_data ) {
-        for ( u32 mesh_index = 0; mesh_index < meshes.size; ++mesh_index ) {
-            gpu_bounds_data[ mesh_index ] = meshes[ mesh_index ].bounding_sphere;
-        }
-        gpu.unmap_buffer( cb_map );
-    }
+    // Scenes without the mesh buffers have nothing to upload.
+    if ( scene_staging_buffer.index != k_invalid_buffer.index ) {
+        ZoneScopedN( "SceneBuffersUpload" );
 
-    // Copy mesh instances data
-    cb_map.buffer = mesh_instances_sb;
-    GpuMeshInstanceData* gpu_mesh_instance_data = ( GpuMeshInstanceData* )gpu.map_buffer( cb_map );
-    if ( gpu_mesh_instance_data ) {
-        for ( u32 mi = 0; mi < mesh_instances.size; ++mi ) {
-            copy_gpu_mesh_transform( gpu_mesh_instance_data[ mi ], mesh_instances[ mi ], global_scale, scene_graph );
+        // Instances of the nodes moved by the scene graph, or all of them when the global scale changes.
+        if ( uploaded_global_scale != global_scale ) {
+            memset( dirty_mesh_instances.bits, 0xff, dirty_mesh_instances.size );
+            uploaded_global_scale = global_scale;
+        }
+        if ( scene_graph ) {
+            BitSet& changed_nodes = scene_graph->changed_nodes;
+            for ( u32 mi = 0; mi < mesh_instances.size; ++mi ) {
+                if ( changed_nodes.get_bit( mesh_instances[ mi ].scene_graph_node_index ) ) {
+                    dirty_mesh_instances.set_bit( mi );
+                }
+            }
+            memset( changed_nodes.bits, 0, changed_nodes.size );
         }
-        gpu.unmap_buffer( cb_map );
-    }
 
-    sizet current_marker = context.scratch_allocator->get_marker();
+        upload_stats = SceneUploadStats{ };
+        upload_stats.bytes_total = scene_staging_section_size;
+
+        Array<SceneUploadRange> mesh_ranges;
+        mesh_ranges.init( context.scratch_allocator, ( meshes.size + 1 ) / 2 );
+        gather_dirty_ranges( dirty_meshes, meshes.size, mesh_ranges, upload_stats.dirty_meshes );
+
+        Array<SceneUploadRange> instance_ranges;
+        instance_ranges.init( context.scratch_allocator, ( mesh_instances.size + 1 ) / 2 );
+        gather_dirty_ranges( dirty_mesh_instances, mesh_instances.size, instance_ranges, upload_stats.dirty_instances );
+
+        if ( mesh_ranges.size || instance_ranges.size ) {
+            Array<VkBufferCopy> material_regions;
+            material_regions.init( context.scratch_allocator, mesh_ranges.size );
+            Array<VkBufferCopy> bounds_regions;
+            bounds_regions.init( context.scratch_allocator, mesh_ranges.size );
+            Array<VkBufferCopy> instance_regions;
+            instance_regions.init( context.scratch_allocator, instance_ranges.size );
+
+            // Ranges never overlap, so all of them fit in the section of this frame.
+            Buffer* staging_buffer = gpu.access_buffer( scene_staging_buffer );
+            const u32 section_offset = gpu.current_frame * scene_staging_section_size;
+            u32 staging_offset = section_offset;
+
+            for ( u32 r = 0; r < mesh_ranges.size; ++r ) {
+                const SceneUploadRange& range = mesh_ranges[ r ];
+                add_upload_region( material_regions, staging_offset, range, sizeof( GpuMaterialData ) );
+
+                GpuMaterialData* gpu_mesh_data = ( GpuMaterialData* )( staging_buffer->mapped_data + staging_offset );
+                for ( u32 i = 0; i < range.count; ++i ) {
+                    copy_gpu_material_data( gpu, gpu_mesh_data[ i ], meshes[ range.first + i ] );
+                }
+                staging_offset += range.count * sizeof( GpuMaterialData );
+            }
+
+            for ( u32 r = 0; r < mesh_ranges.size; ++r ) {
+                const SceneUploadRange& range = mesh_ranges[ r ];
+                add_upload_region( bounds_regions, staging_offset, range, sizeof( vec4s ) );
 
-    Array<SortedLight> sorted_lights;
-    sorted_lights.init( context.scratch_allocator, active_lights, active_lights );
+                vec4s* gpu_bounds_data = ( vec4s* )( staging_buffer->mapped_data + staging_offset );
+                for ( u32 i = 0; i < range.count; ++i ) {
+                    gpu_bounds_data[ i ] = meshes[ range.first + i ].bounding_sphere;
+                }
+                staging_offset += range.count * sizeof( vec4s );
+            }
+
+            for ( u32 r = 0; r < instance_ranges.size; ++r ) {
+                const SceneUploadRange& range = instance_ranges[ r ];
+                add_upload_region( instance_regions, staging_offset, range, sizeof( GpuMeshInstanceData ) );
+
+                GpuMeshInstanceData* gpu_mesh_instance_data = ( GpuMeshInstanceData* )( staging_buffer->mapped_data + staging_offset );
+                for ( u32 i = 0; i < range.count; ++i ) {
+                    copy_gpu_mesh_transform( gpu_mesh_instance_data[ i ], mesh_instances[ range.first + i ], global_scale, scene_graph );
+                }
+                staging_offset += range.count * sizeof( GpuMeshInstanceData );
+            }
+            RASSERT( staging_offset - section_offset <= scene_staging_section_size );
+
+            upload_stats.copy_regions = material_regions.size + bounds_regions.size + instance_regions.size;
+            upload_stats.bytes_uploaded = staging_offset - section_offset;
+
+            // Queued before the draw task adds its command buffer, so the copies land before any pass reads the buffers.
+            CommandBuffer* cb = gpu.get_command_buffer( 0, gpu.current_frame, true );
+            cb->push_marker( "Scene buffers upload" );
+
+            copy_upload_regions( gpu, cb, scene_staging_buffer, meshes_sb, material_regions );
+            copy_upload_regions( gpu, cb, scene_staging_buffer, mesh_bounds_sb, bounds_regions );
+            copy_upload_regions( gpu, cb, scene_staging_buffer, mesh_instances_sb, instance_regions );
+
+            cb->pop_marker();
+            gpu.queue_command_buffer( cb );
+        }
+    }
 
     // Sort lights based on Z
+    Array<f32> light_depths;
+    light_depths.init( context.scratch_allocator, active_lights, active_lights );
+    Array<f32> light_radii;
+    light_radii.init( context.scratch_allocator, active_lights, active_lights );
+
     mat4s& world_to_camera = scene_data.world_to_camera;
-    float z_far = scene_data.z_far;
     for ( u32 i = 0; i < active_lights; ++i ) {
         Light& light = lights[ i ];
 
         vec4s p{ light.world_position.x, light.world_position.y, light.world_position.z, 1.0f };
-
-        vec4s projected_p = glms_mat4_mulv( world_to_camera, p );
-        vec4s projected_p_min = glms_vec4_add( projected_p, { 0,0,-light.radius, 0 } );
-        vec4s projected_p_max = glms_vec4_add( projected_p, { 0,0,light.radius, 0 } );
-
-        // NOTE(marco): linearize depth
-        SortedLight& sorted_light = sorted_lights[ i ];
-        sorted_light.light_index = i;
-        // Remove negative numbers as they cause false negatives for bin 0.
-        sorted_light.projected_z = (  ( projected_p.z - scene_data.z_near ) / ( z_far - scene_data.z_near ) );
-        sorted_light.projected_z_min = (  ( projected_p_min.z - scene_data.z_near ) / ( z_far - scene_data.z_near ) );
-        sorted_light.projected_z_max = (  ( projected_p_max.z - scene_data.z_near ) / ( z_far - scene_data.z_near ) );
-
-        //rprint( "Light Z %f, Zmin %f, Zmax %f\n", sorted_light.projected_z, sorted_light.projected_z_min, sorted_light.projected_z_max );
+        light_depths[ i ] = glms_mat4_mulv( world_to_camera, p ).z;
+        light_radii[ i ] = light.radius;
     }
 
-    qsort( sorted_lights.data, active_lights, sizeof( SortedLight ), sorting_light_fn );
+    light_clustering.build_z_bins( light_depths.data, light_radii.data, active_lights, scene_data.z_near, scene_data.z_far );
 
     // Upload light list
     cb_map.buffer = lights_list_sb;
@@ -5284,91 +5307,12 @@ void RenderScene::upload_gpu_data( UploadGpuDataContext& context ) {
         gpu.unmap_buffer( cb_map );
     }
 
-    // Calculate lights LUT
-    // NOTE(marco): it might be better to use logarithmic slices to have better resolution
-    // closer to the camera. We could also use a different far plane and discard any lights
-    // that are too far
-    const f32 bin_size = 1.0f / k_light_z_bins;
-
-    Array<u32> bin_range_per_light;
-    bin_range_per_light.init( context.scratch_allocator, active_lights, active_lights );
-
-    for ( u32 i = 0; i < active_lights; ++i ) {
-        const SortedLight& light = sorted_lights[ i ];
-
-        if ( light.projected_z_min < 0.0f && light.projected_z_max < 0.0f ) {
-            // NOTE(marco): this light is behind the camera
-            bin_range_per_light[ i ] = u32_max;
-
-            continue;
-        }
-
-        const u32 min_bin = raptor::max( 0, raptor::floori32( light.projected_z_min * k_light_z_bins ) );
-        const u32 max_bin = raptor::max( 0, raptor::ceili32( light.projected_z_max * k_light_z_bins ) );
-
-        bin_range_per_light[ i ] = ( min_bin & 0xffff ) | ( ( max_bin & 0xffff ) << 16 );
-        // rprint( "Light %u min %u, max %u, linear z min %f max %f\n", i, min_bin, max_bin, light.projected_z_min * z_far, light.projected_z_max * z_far );
-    }
-
-    for ( u32 bin = 0; bin < k_light_z_bins; ++bin ) {
-        u32 min_light_id = k_num_lights + 1;
-        u32 max_light_id = 0;
-
-        f32 bin_min = bin_size * bin;
-        f32 bin_max = bin_min + bin_size;
-
-        for ( u32 i = 0; i < active_lights; ++i ) {
-            const SortedLight& light = sorted_lights[ i ];
-            const u32 light_bins = bin_range_per_light[ i ];
-
-            if ( light_bins == u32_max ) {
-                continue;
-            }
-
-            const u32 min_bin = light_bins & 0xffff;
-            const u32 max_bin = light_bins >> 16;
-
-            if ( bin >= min_bin && bin <= max_bin ) {
-                if ( i < min_light_id ) {
-                    min_light_id = i;
-                }
-
-                if ( i > max_light_id ) {
-                    max_light_id = i;
-                }
-            }
-            // OLD: left as a reference if new implementation breaks too much.
-            //if ( ( light.projected_z >= bin_min && light.projected_z <= bin_max ) ||
-            //     ( light.projected_z_min >= bin_min && light.projected_z_min <= bin_max ) ||
-            //     ( light.projected_z_max >= bin_min && light.projected_z_max <= bin_max ) ) {
-            //    if ( i < min_light_id ) {
-            //        min_light_id = i;
-
-            //        //rprint( "Light in bin %u\n", bin );
-            //    }
-
-            //    if ( i > max_light_id ) {
-            //        max_light_id = i;
-            //    }
-            //}
-        }
-
-        //if (min_light_id != k_num_lights + 1)
-            //rprint( "Bin %u, light ids min %u, max %u\n", bin, min_light_id, max_light_id );
-
-        lights_lut[ bin ] = min_light_id | ( max_light_id << 16 );
-    }
-
     // Upload light indices
     cb_map.buffer = lights_indices_sb[ gpu.current_frame ];
 
     u32* gpu_light_indices = ( u32* )gpu.map_buffer( cb_map );
     if ( gpu_light_indices ) {
-        // TODO: improve
-        //memcpy( gpu_light_indices, lights_lut.data, lights_lut.size * sizeof( u32 ) );
-        for ( u32 i = 0; i < active_lights; ++i ) {
-            gpu_light_indices[ i ] = sorted_lights[ i ].light_index;
-        }
+        memcpy( gpu_light_indices, light_clustering.sorted_lights.data, active_lights * sizeof( u32 ) );
 
         gpu.unmap_buffer( cb_map );
     }
@@ -5377,30 +5321,18 @@ void RenderScene::upload_gpu_data( UploadGpuDataContext& context ) {
     cb_map.buffer = lights_lut_sb[ gpu.current_frame ];
     u32* gpu_lut_data = ( u32* )gpu.map_buffer( cb_map );
     if ( gpu_lut_data ) {
-        memcpy( gpu_lut_data, lights_lut.data, lights_lut.size * sizeof( u32 ) );
+        memcpy( gpu_lut_data, light_clustering.z_bins.data, light_clustering.z_bins.size * sizeof( u32 ) );
 
         gpu.unmap_buffer( cb_map );
     }
 
-    const u32 tile_x_count = scene_data.resolution_x / k_tile_size;
-    const u32 tile_y_count = scene_data.resolution_y / k_tile_size;
-    const u32 tiles_entry_count = tile_x_count * tile_y_count * k_num_words;
-    const u32 buffer_size = tiles_entry_count * sizeof( u32 );
-
     // Assign light
-    Array<u32> light_tiles_bits;
-    light_tiles_bits.init( context.scratch_allocator, tiles_entry_count, tiles_entry_count );
-    memset( light_tiles_bits.data, 0, buffer_size );
-
-    float near_z = scene_data.z_near;
-    float tile_size_inv = 1.0f / k_tile_size;
-
-    u32 tile_stride = tile_x_count * k_num_words;
+    light_clustering.resize( ( u32 )scene_data.resolution_x, ( u32 )scene_data.resolution_y );
 
     GameCamera& game_camera = context.game_camera;
 
     for ( u32 i = 0; i < active_lights; ++i ) {
-        const u32 light_index = sorted_lights[ i ].light_index;
+        const u32 light_index = light_clustering.sorted_lights[ i ];
         Light& light = lights[ light_index ];
 
         vec4s pos{ light.world_position.x, light.world_position.y, light.world_position.z, 1.0f };
@@ -5524,48 +5456,16 @@ void RenderScene::upload_gpu_data( UploadGpuDataContext& context ) {
             continue;
         }
 
-        float min_x = aabb_screen.x;
-        float min_y = aabb_screen.y;
-
-        float max_x = min_x + width;
-        float max_y = min_y + height;
-
-        if ( min_x > gpu.swapchain_width || min_y > gpu.swapchain_height ) {
-            continue;
-        }
-
-        if ( max_x < 0.0f || max_y < 0.0f ) {
-            continue;
-        }
-
-        min_x = max( min_x, 0.0f );
-        min_y = max( min_y, 0.0f );
-
-        max_x = min( max_x, ( float )gpu.swapchain_width );
-        max_y = min( max_y, ( float )gpu.swapchain_height );
-
-        u32 first_tile_x = ( u32 )( min_x * tile_size_inv );
-        u32 last_tile_x = min( tile_x_count - 1, ( u32 )( max_x * tile_size_inv ) );
-
-        u32 first_tile_y = ( u32 )( min_y * tile_size_inv );
-        u32 last_tile_y = min( tile_y_count - 1, ( u32 )( max_y * tile_size_inv ) );
-
-        for ( u32 y = first_tile_y; y <= last_tile_y; ++y ) {
-            for ( u32 x = first_tile_x; x <= last_tile_x; ++x ) {
-                u32 array_index = y * tile_stride + x;
-
-                u32 word_index = i / 32;
-                u32 bit_index = i % 32;
-
-                light_tiles_bits[ array_index + word_index ] |= ( 1 << bit_index );
-            }
-        }
+        light_clustering.set_light_rect( i, aabb_screen.x, aabb_screen.y, aabb_screen.z, aabb_screen.w );
     }
 
+    light_clustering.build_tiles( context.task_scheduler );
+
     MapBufferParameters light_tiles_cb_map = { lights_tiles_sb[ gpu.current_frame ], 0, 0 };
     u32* light_tiles_data = ( u32* )gpu.map_buffer( light_tiles_cb_map );
     if ( light_tiles_data ) {
-        memcpy( light_tiles_data, light_tiles_bits.data, light_tiles_bits.size * sizeof( u32 ) );
+        const sizet tiles_size = raptor::min( light_clustering.get_tiles_size(), ( sizet )gpu.access_buffer( lights_tiles_sb[ gpu.current_frame ] )->size );
+        memcpy( light_tiles_data, light_clustering.tile_bits.data, tiles_size );
 
         gpu.unmap_buffer( light_tiles_cb_map );
     }
@@ -5603,8 +5503,8 @@ void RenderScene::upload_gpu_data( UploadGpuDataContext& context ) {
             for ( u32 z = 0; z < k_light_z_bins; ++z ) {
 
                 // Skip empty z bins
-                u32 z_bin = lights_lut[ z ];
-                if ( ( z_bin & 0xffff ) == k_num_lights + 1 ) {
+                u32 z_bin = light_clustering.z_bins[ z ];
+                if ( ( z_bin & 0xffff ) > ( z_bin >> 16 ) ) {
                     continue;
                 }
 
@@ -5652,23 +5552,23 @@ void RenderScene::upload_gpu_data( UploadGpuDataContext& context ) {
 
 void RenderScene::on_resize( GpuDevice& gpu, FrameGraph* frame_graph, u32 new_width, u32 new_height ) {
 
-    for ( u32 i = 0; i < k_max_frames; ++i ) {
+    // Scenes without lights have no clustering.
+    if ( light_clustering.max_lights > 0 ) {
+        light_clustering.resize( new_width, new_height );
 
-        gpu.destroy_buffer( lights_tiles_sb[ i ] );
+        for ( u32 i = 0; i < k_max_frames; ++i ) {
 
-        const u32 tile_x_count = ceilu32( renderer->width * 1.0f / k_tile_size );
-        const u32 tile_y_count = ceilu32( renderer->height * 1.0f / k_tile_size );
-        const u32 tiles_entry_count = tile_x_count * tile_y_count * k_num_words;
-        const u32 buffer_size = tiles_entry_count * sizeof( u32 );
+            gpu.destroy_buffer( lights_tiles_sb[ i ] );
 
-        BufferCreation buffer_creation;
-        buffer_creation.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, buffer_size ).set_name( "light_tiles" );
+            BufferCreation buffer_creation;
+            buffer_creation.reset().set( VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, ResourceUsageType::Dynamic, ( u32 )light_clustering.get_tiles_size() ).set_name( "light_tiles" );
 
-        lights_tiles_sb[ i ] = renderer->gpu->create_buffer( buffer_creation );
+            lights_tiles_sb[ i ] = renderer->gpu->create_buffer( buffer_creation );
+        }
     }
 
     if ( use_meshlets ) {
-        GpuTechnique* transparent_technique = renderer->resource_cache.techniques.get( hash_calculate( "meshlet" ) );
+        GpuTechnique* transparent_technique = renderer->resource_cache.techniques.get( rhash( "meshlet" ) );
         u32 meshlet_technique_index = transparent_technique->get_pass_index( "transparent_no_cull" );
         GpuTechniquePass& transparent_pass = transparent_technique->passes[ meshlet_technique_index ];
 
@@ -5709,7 +5609,11 @@ void RenderScene::draw_mesh_instance( CommandBuffer* gpu_commands, MeshInstance&
 
         gpu_commands->bind_local_descriptor_set( &descriptor_set, 1, nullptr, 0 );
     } else {
-        gpu_commands->bind_descriptor_set( transparent ? &mesh.pbr_material.descriptor_set_transparent : &mesh.pbr_material.descriptor_set_main, 1, nullptr, 0 );
+        DescriptorSetHandle* descriptor_set = &mesh.pbr_material.descriptor_set_main;
+        if ( transparent ) {
+            descriptor_set = mesh.has_skinning() ? &mesh.pbr_material.descriptor_set_transparent_skinning[ renderer->gpu->current_frame ] : &mesh.pbr_material.descriptor_set_transparent;
+        }
+        gpu_commands->bind_descriptor_set( descriptor_set, 1, nullptr, 0 );
     }
 
     // Gpu mesh index used to retrieve mesh data
@@ -5832,7 +5736,7 @@ void DrawTask::ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_
     CommandBuffer* gpu_commands = gpu->get_command_buffer( threadnum_, current_frame_index, true );
     gpu_commands->push_marker( "Frame" );
 
-    frame_graph->render( current_frame_index, gpu_commands, scene );
+    gpu_commands = frame_graph->render( current_frame_index, gpu_commands, scene );
 
     gpu_commands->push_marker( "Fullscreen" );
     gpu_commands->clear( 0.3f, 0.3f, 0.3f, 1.f, 0 );
@@ -5842,7 +5746,7 @@ void DrawTask::ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_
     gpu_commands->set_viewport( nullptr );
 
     // Apply fullscreen material
-    FrameGraphResource* texture = frame_graph->get_resource( "final" );
+    FrameGraphResource* texture = frame_graph->get_resource( rhash( "final" ) );
     RASSERT( texture != nullptr );
     // TODO: proper handling.
     TextureHandle output_texture = texture->resource_info.texture.handle;
@@ -5915,6 +5819,8 @@ void FrameRenderer::init( Allocator* resident_allocator_, Renderer* renderer_,
     add_render_pass( "svgf_accumulation_pass", &svgf_accumulation_pass );
     add_render_pass( "svgf_variance_pass", &svgf_variance_pass );
     add_render_pass( "svgf_wavelet_pass", &svgf_wavelet_pass );
+
+    frame_graph->build_queue_schedule();
 }
 
 void FrameRenderer::shutdown() {
@@ -5977,7 +5883,7 @@ void FrameRenderer::prepare_draws( StackAllocator* scratch_allocator ) {
     }
 
     // Handle fullscreen pass.
-    fullscreen_tech = renderer->resource_cache.techniques.get( hash_calculate( "fullscreen" ) );
+    fullscreen_tech = renderer->resource_cache.techniques.get( rhash( "fullscreen" ) );
 
     u32 pass_index = fullscreen_tech->get_pass_index( "main_triangle" );
     GpuTechniquePass& pass = fullscreen_tech->passes[ pass_index ];
@@ -6287,7 +6193,7 @@ void DebugRenderer::init( RenderScene& scene, Allocator* resident_allocator, Sta
     buffer_creation.reset().set( VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, ResourceUsageType::Dynamic, sizeof( LineVertex2D ) * k_max_lines ).set_name( "lines_vb_2d" );
     lines_vb_2d = renderer->gpu->create_buffer( buffer_creation );
 
-    const u64 hashed_name = hash_calculate( "debug" );
+    const u64 hashed_name = rhash( "debug" );
     GpuTechnique* main_technique = renderer->resource_cache.techniques.get( hashed_name );
 
     // Prepare CPU debug line resources
@@ -1,10 +1,14 @@
 #pragma once
 
 #include "foundation/array.hpp"
+#include "foundation/bit.hpp"
 #include "foundation/platform.hpp"
 #include "foundation/color.hpp"
 
+#include "graphics/animation.hpp"
+#include "graphics/cloth_solver.hpp"
 #include "graphics/command_buffer.hpp"
+#include "graphics/light_clustering.hpp"
 #include "graphics/renderer.hpp"
 #include "graphics/gpu_resources.hpp"
 #include "graphics/frame_graph.hpp"
@@ -22,12 +26,14 @@ namespace raptor {
     struct Allocator;
     struct AsynchronousLoader;
     struct FrameGraph;
+    struct FramePipeline;
     struct GpuVisualProfiler;
     struct ImGuiService;
     struct Renderer;
     struct RenderScene;
     struct SceneGraph;
     struct StackAllocator;
+    struct VirtualArenaAllocator;
     struct GameCamera;
 
     static const u16    k_invalid_scene_texture_index      = u16_max;
@@ -35,13 +41,12 @@ namespace raptor {
     static const u32    k_max_joint_count                  = 12;
     static const u32    k_max_depth_pyramid_levels         = 16;
 
-    static const u32    k_num_lights                       = 256;
+    static const u32    k_num_lights                       = 256;  // Default of RenderScene::max_lights.
+    static const u32    k_num_shadow_lights                = 256;  // NUM_SHADOW_LIGHTS in the shaders.
     static const u32    k_light_z_bins                     = 16;
     static const u32    k_tile_size                        = 8;
-    static const u32    k_num_words                        = ( k_num_lights + 31 ) / 32;
 
     static bool         recreate_per_thread_descriptors = false;
-    static bool         use_secondary_command_buffers   = false;
 
     //
     //
@@ -76,7 +81,7 @@ namespace raptor {
         vec3s                   camera_direction;
         i32                     current_frame;
 
-        u32                     active_lights;
+        u32                     active_lights;      // Lights with point shadows.
         u32                     use_tetrahedron_shadows;
         u32                     dither_texture_index;
         f32                     z_near;
@@ -177,6 +182,8 @@ namespace raptor {
         BufferHandle            material_buffer = k_invalid_buffer;
         DescriptorSetHandle     descriptor_set_transparent  = k_invalid_set;
         DescriptorSetHandle     descriptor_set_main = k_invalid_set;
+        // Skinned meshes only: replaces descriptor_set_transparent, one per joint palette in flight.
+        DescriptorSetHandle     descriptor_set_transparent_skinning[ k_max_frames ];
 
         // Indices used for bindless textures.
         u16                     diffuse_texture_index   = u16_max;
@@ -283,6 +290,9 @@ namespace raptor {
         BufferHandle            draw_indirect_buffer;
         DescriptorSetHandle     descriptor_set;
         DescriptorSetHandle     debug_mesh_descriptor_set;
+
+        ClothSolver             cpu_solver;
+        BufferHandle            cpu_attributes_buffer;  // Positions then normals, for each frame in flight.
     };
 
     //
@@ -458,65 +468,31 @@ namespace raptor {
 
     }; // struct GpuMeshDrawCounts
 
-    // Animation structs //////////////////////////////////////////////////
-    //
-    //
-    struct AnimationChannel {
-
-        enum TargetType {
-            Translation, Rotation, Scale, Weights, Count
-        };
-
-        i32                     sampler;
-        i32                     target_node;
-        TargetType              target_type;
-
-    }; // struct AnimationChannel
-
-    struct AnimationSampler {
-
-        enum Interpolation {
-            Linear, Step, CubicSpline, Count
-        };
-
-        Array<f32>              key_frames;
-        vec4s*                  data;       // Aligned-allocated data. Count is the same as key_frames.
-        Interpolation           interpolation_type;
-
-    }; // struct AnimationSampler
-
-    //
-    //
-    struct Animation {
-
-        f32                     time_start;
-        f32                     time_end;
-
-        Array<AnimationChannel> channels;
-        Array<AnimationSampler> samplers;
-
-    }; // struct Animation
-
-    //
-    //
-    struct AnimationInstance {
-        Animation*              animation;
-        f32                     current_time;
-    }; // struct AnimationInstance
-
     // Skinning ///////////////////////////////////////////////////////////
     //
     //
     struct Skin {
 
         u32                     skeleton_root_index;
+        u32                     animation_pose; // Joints are relative to the pose node offset.
+        i32                     mesh_node;      // Scene graph node drawn with the skin, -1 if none.
         Array<i32>              joints;
         mat4s*                  inverse_bind_matrices;  // Align-allocated data. Count is same as joints.
 
-        BufferHandle            joint_transforms;
+        BufferHandle            joint_transforms[ k_max_frames ];   // Persistently mapped, one palette per frame in flight.
 
     }; // struct Skin
 
+    //
+    // Computes the joint palettes of a range of skins from the scene graph world matrices.
+    struct SkinningTask : public enki::ITaskSet {
+
+        void                    ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) override;
+
+        RenderScene*            render_scene    = nullptr;
+
+    }; // struct SkinningTask
+
     // Transform //////////////////////////////////////////////////////////
 
     //
@@ -570,7 +546,8 @@ namespace raptor {
 
     struct UploadGpuDataContext {
         GameCamera&             game_camera;
-        StackAllocator*         scratch_allocator;
+        VirtualArenaAllocator*  scratch_allocator;      // Per frame arena, cleared when the frame index comes back.
+        enki::TaskScheduler*    task_scheduler  = nullptr;  // Light tiles run serially without it.
 
         vec2s                   last_clicked_position_left_button;
 
@@ -583,6 +560,20 @@ namespace raptor {
 
     }; // struct UploadGpuDataContext
 
+    //
+    // Delta uploads of the material, bounds and instance buffers, written by the last upload_gpu_data.
+    struct SceneUploadStats {
+
+        void                    debug_ui();
+
+        u32                     dirty_meshes    = 0;
+        u32                     dirty_instances = 0;
+        u32                     copy_regions    = 0;
+        u32                     bytes_uploaded  = 0;    // Clean elements merged between dirty ones included.
+        u32                     bytes_total     = 0;    // Size of the three buffers, uploaded each frame before.
+
+    }; // struct SceneUploadStats
+
     // Volumetric Fog /////////////////////////////////////////////////////
     struct alignas( 16 ) GpuVolumetricFogConstants {
 
@@ -657,6 +648,8 @@ namespace raptor {
     //
     struct DepthPrePass : public FrameGraphRenderPass {
         void                    render( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene ) override;
+        u32                     parallel_draw_count( RenderScene* render_scene ) override;
+        void                    render_range( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene, u32 first_draw, u32 draw_count ) override;
 
         void                    prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) override;
         void                    free_gpu_resources( GpuDevice& gpu ) override;
@@ -696,6 +689,8 @@ namespace raptor {
     struct GBufferPass : public FrameGraphRenderPass {
         void                    pre_render( u32 current_frame_index, CommandBuffer* gpu_commands, FrameGraph* frame_graph, RenderScene* render_scene ) override;
         void                    render( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene ) override;
+        u32                     parallel_draw_count( RenderScene* render_scene ) override;
+        void                    render_range( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene, u32 first_draw, u32 draw_count ) override;
 
         void                    prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) override;
         void                    free_gpu_resources( GpuDevice& gpu ) override;
@@ -722,6 +717,7 @@ namespace raptor {
     //
     struct LateGBufferPass : public FrameGraphRenderPass {
         void                    render( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene ) override;
+        u32                     parallel_draw_count( RenderScene* render_scene ) override;
 
         void                    prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) override;
         void                    free_gpu_resources( GpuDevice& gpu ) override;
@@ -766,6 +762,8 @@ namespace raptor {
     //
     struct TransparentPass : public FrameGraphRenderPass {
         void                    render( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene ) override;
+        u32                     parallel_draw_count( RenderScene* render_scene ) override;
+        void                    render_range( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene, u32 first_draw, u32 draw_count ) override;
 
         void                    prepare_draws( RenderScene& scene, FrameGraph* frame_graph, Allocator* resident_allocator, StackAllocator* scratch_allocator ) override;
         void                    free_gpu_resources( GpuDevice& gpu ) override;
@@ -911,6 +909,7 @@ namespace raptor {
 
         void                    pre_render( u32 current_frame_index, CommandBuffer* gpu_commands, FrameGraph* frame_graph, RenderScene* render_scene ) override;
         void                    render( u32 current_frame_index, CommandBuffer* gpu_commands, RenderScene* render_scene ) override;
+        bool                    supports_async_compute() override;
 
         void                    on_resize( GpuDevice& gpu, FrameGraph* frame_graph, u32 new_width, u32 new_height ) override;
 
@@ -1423,11 +1422,25 @@ namespace raptor {
 
         virtual void            prepare_draws( Renderer* renderer, StackAllocator* scratch_allocator, SceneGraph* scene_graph ) { };
 
-        CommandBuffer*          update_physics( f32 delta_time, f32 air_density, f32 spring_stiffness, f32 spring_damping, vec3s wind_direction, bool reset_simulation );
-        void                    update_animations( f32 delta_time );
-        void                    update_joints();
-
+        // Dispatches the cloth shader, or runs the cloth solver on the task scheduler and copies its output when physics_on_cpu is set.
+        CommandBuffer*          update_physics( f32 delta_time, f32 air_density, f32 spring_stiffness, f32 spring_damping, vec3s wind_direction, bool reset_simulation, enki::TaskScheduler* task_scheduler );
+        // Applies the animations the frame pipeline simulated ahead, or simulates them now when none are ready.
+        void                    update_animations( FramePipeline* frame_pipeline, f32 delta_time, enki::TaskScheduler* task_scheduler );
+        // Simulates the animations of the next frames while this one is recorded, call after the draw task is added.
+        void                    kick_animations( FramePipeline* frame_pipeline, f32 delta_time, enki::TaskScheduler* task_scheduler );
+        // Needs the scene graph matrices updated after the animations.
+        void                    update_joints( enki::TaskScheduler* task_scheduler );
+        // Sphere around the mesh instances as drawn, global scale included. Needs the scene graph matrices updated.
+        // Returns false when no mesh has bounds.
+        bool                    get_world_bounding_sphere( vec3s& center, f32& radius ) const;
+        // Point shadows keep resources for each light, only the first active lights cast them.
+        u32                     get_shadow_light_count() const { return raptor::min( active_lights, k_num_shadow_lights ); }
+
+        // Copies only the dirty materials, bounds and instances, through the staging section of the current frame.
         void                    upload_gpu_data( UploadGpuDataContext& context );
+        // Material and bounding sphere edits need to mark their mesh, scene graph changes mark instances on their own.
+        void                    mark_mesh_dirty( u32 mesh_index );
+        void                    mark_all_dirty();
         void                    draw_mesh_instance( CommandBuffer* gpu_commands, MeshInstance& mesh_instance, bool transparent );
 
         // Helpers based on shaders. Ideally this would be coming from generated cpp files.
@@ -1454,12 +1467,19 @@ namespace raptor {
         // Animation and skinning data
         Array<Animation>        animations;
         Array<Skin>             skins;
+        AnimationSystem         animation_system;   // One pose for each glTF file.
+        SkinningTask            skinning_task;
+
+        // Physics
+        bool                    physics_on_cpu  = false;    // Cloth solver instead of the cloth shader.
 
         // Lights
         Array<Light>            lights;
-        Array<u32>              lights_lut;
+        LightClustering         light_clustering;
         vec3s                   mesh_aabb[2]; // 0 min, 1 max
         u32                     active_lights   = 1;
+        // Lights created and clustered, set before init. Shaders get it as NUM_LIGHTS.
+        u32                     max_lights      = k_num_lights;
         bool                    shadow_constants_cpu_update = true;
 
         StringBuffer            names_buffer;   // Buffer containing all names of nodes, resources, etc.
@@ -1482,6 +1502,14 @@ namespace raptor {
         BufferHandle            meshlets_index_buffer_sb[ k_max_frames ];
         BufferHandle            meshlets_visible_instances_sb[ k_max_frames ];
 
+        // Scene buffers uploads, the staging buffer has one section per frame in flight, each fitting all three buffers.
+        BufferHandle            scene_staging_buffer = k_invalid_buffer;
+        u32                     scene_staging_section_size = 0;
+        BitSet                  dirty_meshes;       // Material and bounding sphere.
+        BitSet                  dirty_mesh_instances;
+        f32                     uploaded_global_scale = 0.f;
+        SceneUploadStats        upload_stats;
+
         // Light buffers
         BufferHandle            lights_list_sb  = k_invalid_buffer;
         BufferHandle            lights_lut_sb[ k_max_frames ];
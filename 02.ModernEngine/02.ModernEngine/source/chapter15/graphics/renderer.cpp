@@ -244,21 +244,12 @@ GpuTechnique* Renderer::create_technique( const GpuTechniqueCreation& creation )
         technique->name_hash_to_index.set_default_value( u16_max );
         technique->name = creation.name;
 
-        temporary_allocator.clear();
-
-        StringBuffer pipeline_cache_path;
-        pipeline_cache_path.init( 2048, &temporary_allocator );
-
         for ( u32 i = 0; i < creation.num_creations; ++i ) {
             GpuTechniquePass& pass = technique->passes[ i ];
             const PipelineCreation& pass_creation = creation.creations[ i ];
-            if ( pass_creation.name != nullptr ) {
-                char* cache_path = pipeline_cache_path.append_use_f( "%s/%s.cache", resource_cache.binary_data_folder, pass_creation.name );
-
-                pass.pipeline = gpu->create_pipeline( pass_creation, cache_path );
-            } else {
-                pass.pipeline = gpu->create_pipeline( pass_creation );
-            }
+            // Inside a pipeline batch only the Vulkan pipeline object is deferred,
+            // layouts are already available for the descriptor names below.
+            pass.pipeline = gpu->create_pipeline( pass_creation );
 
             pass.name_hash_to_descriptor_index.init( resident_allocator, 16 );
             pass.name_hash_to_descriptor_index.set_default_value( u16_max );
@@ -284,8 +275,6 @@ GpuTechnique* Renderer::create_technique( const GpuTechniqueCreation& creation )
             technique->name_hash_to_index.insert( hash_calculate( pass_creation.name ), ( u32 )i );
         }
 
-        temporary_allocator.clear();
-
         if ( creation.name != nullptr ) {
             resource_cache.techniques.insert( hash_calculate( creation.name ), technique );
         }
@@ -442,9 +431,16 @@ void Renderer::unmap_buffer( BufferResource* buffer ) {
 void Renderer::add_texture_to_update( raptor::TextureHandle texture ) {
     std::lock_guard<std::mutex> guard( texture_update_mutex );
 
+    RASSERT( num_textures_to_update < ArraySize( textures_to_update ) );
     textures_to_update[ num_textures_to_update++ ] = texture;
 }
 
+u32 Renderer::get_free_texture_update_slots() {
+    std::lock_guard<std::mutex> guard( texture_update_mutex );
+
+    return ArraySize( textures_to_update ) - num_textures_to_update;
+}
+
 //TODO:
 static void generate_mipmaps( raptor::Texture* texture, raptor::CommandBuffer* cb, bool from_transfer_queue ) {
     using namespace raptor;
@@ -509,6 +505,13 @@ void Renderer::add_texture_update_commands( u32 thread_id ) {
 
         Texture* texture = gpu->access_texture( textures_to_update[i] );
 
+        // Cooked textures are uploaded with all their mips, they only need the ownership acquire.
+        if ( TextureFormat::is_block_compressed( texture->vk_format ) ) {
+            util_add_image_barrier_ext( cb->gpu_device, cb->vk_command_buffer, texture->vk_image, RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_SHADER_RESOURCE,
+                                        0, texture->mip_level_count, 0, 1, false, gpu->vulkan_transfer_queue_family, gpu->vulkan_main_queue_family, QueueType::CopyTransfer, QueueType::Graphics );
+            continue;
+        }
+
         util_add_image_barrier_ext( cb->gpu_device, cb->vk_command_buffer, texture->vk_image, RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_COPY_SOURCE,
                                     0, 1, 0, 1, false, gpu->vulkan_transfer_queue_family, gpu->vulkan_main_queue_family, QueueType::CopyTransfer, QueueType::Graphics );
 
@@ -231,6 +231,7 @@ struct Renderer : public Service {
 
     // Multithread friendly update to textures
     void                        add_texture_to_update( raptor::TextureHandle texture );
+    u32                         get_free_texture_update_slots();
     void                        add_texture_update_commands( u32 thread_id );
 
     ResourcePoolTyped<TextureResource>  textures;
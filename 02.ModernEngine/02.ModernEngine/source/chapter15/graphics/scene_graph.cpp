@@ -1,14 +1,99 @@
 #include "graphics/scene_graph.hpp"
 
+#include "foundation/assert.hpp"
+#include "foundation/log.hpp"
+#include "foundation/memory.hpp"
 #include "foundation/numerics.hpp"
 #include "foundation/time.hpp"
 
 #include "external/cglm/struct/affine.h"
 
+#include <math.h>
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+    #define RAPTOR_SCENE_GRAPH_SSE2
+    #include <emmintrin.h>
+#endif
+
 namespace raptor {
 
+// Levels below this number of dirty words are updated on the calling thread.
+static const u32 k_min_task_words = 16;
+
+//
+// Column major parent * local, one column of the result per SIMD multiply-add chain.
+static inline void scene_graph_mat4_mul( const mat4s& parent, const mat4s& local, mat4s& world ) {
+#if defined RAPTOR_SCENE_GRAPH_SSE2
+    const __m128 c0 = _mm_loadu_ps( parent.raw[ 0 ] );
+    const __m128 c1 = _mm_loadu_ps( parent.raw[ 1 ] );
+    const __m128 c2 = _mm_loadu_ps( parent.raw[ 2 ] );
+    const __m128 c3 = _mm_loadu_ps( parent.raw[ 3 ] );
+
+    for ( u32 c = 0; c < 4; ++c ) {
+        const __m128 l = _mm_loadu_ps( local.raw[ c ] );
+        __m128 r = _mm_mul_ps( c0, _mm_shuffle_ps( l, l, _MM_SHUFFLE( 0, 0, 0, 0 ) ) );
+        r = _mm_add_ps( r, _mm_mul_ps( c1, _mm_shuffle_ps( l, l, _MM_SHUFFLE( 1, 1, 1, 1 ) ) ) );
+        r = _mm_add_ps( r, _mm_mul_ps( c2, _mm_shuffle_ps( l, l, _MM_SHUFFLE( 2, 2, 2, 2 ) ) ) );
+        r = _mm_add_ps( r, _mm_mul_ps( c3, _mm_shuffle_ps( l, l, _MM_SHUFFLE( 3, 3, 3, 3 ) ) ) );
+        _mm_storeu_ps( world.raw[ c ], r );
+    }
+#else
+    world = glms_mat4_mul( parent, local );
+#endif // RAPTOR_SCENE_GRAPH_SSE2
+}
+
+//
+// Marks the children of dirty parents, then updates the set bits of each word.
+static void update_level_words( SceneGraph* scene_graph, u32 word_begin, u32 word_end, bool propagate ) {
+    u64* dirty_words = scene_graph->dirty_words.data;
+    const u32* sorted_nodes = scene_graph->sorted_nodes.data;
+    const u32* sorted_parents = scene_graph->sorted_parents.data;
+    const mat4s* local_matrices = scene_graph->local_matrices.data;
+    mat4s* world_matrices = scene_graph->world_matrices.data;
+
+    for ( u32 w = word_begin; w < word_end; ++w ) {
+        u64 dirty = dirty_words[ w ];
+
+        if ( propagate ) {
+            const u32* parents = sorted_parents + w * 64;
+            for ( u32 b = 0; b < 64; ++b ) {
+                const u32 parent = parents[ b ];
+                if ( parent != k_invalid_scene_graph_node ) {
+                    dirty |= ( ( dirty_words[ parent >> 6 ] >> ( parent & 63 ) ) & 1 ) << b;
+                }
+            }
+            dirty_words[ w ] = dirty;
+        }
+
+        while ( dirty ) {
+            const u32 position = w * 64 + ( u32 )trailing_zeros_u64( dirty );
+            dirty &= dirty - 1;
+
+            const u32 node = sorted_nodes[ position ];
+            const u32 parent = sorted_parents[ position ];
+            if ( parent == k_invalid_scene_graph_node ) {
+                world_matrices[ node ] = local_matrices[ node ];
+            } else {
+                scene_graph_mat4_mul( world_matrices[ sorted_nodes[ parent ] ], local_matrices[ node ], world_matrices[ node ] );
+            }
+        }
+    }
+}
+
+static bool any_dirty_word( const u64* dirty_words, u32 word_begin, u32 word_end ) {
+    for ( u32 w = word_begin; w < word_end; ++w ) {
+        if ( dirty_words[ w ] ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SceneGraphLevelTask::ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) {
+    update_level_words( scene_graph, first_word + range_.start, first_word + range_.end, propagate );
+}
+
 void SceneGraph::init( Allocator* resident_allocator, u32 num_nodes ) {
     nodes_hierarchy.init( resident_allocator, num_nodes );
     local_matrices.init( resident_allocator, num_nodes );
@@ -16,23 +101,48 @@ void SceneGraph::init( Allocator* resident_allocator, u32 num_nodes ) {
     nodes_debug_data.init( resident_allocator, num_nodes );
 
     updated_nodes.init( resident_allocator, num_nodes );
+    changed_nodes.init( resident_allocator, num_nodes );
+
+    sorted_nodes.init( resident_allocator, num_nodes );
+    sorted_parents.init( resident_allocator, num_nodes );
+    sorted_positions.init( resident_allocator, num_nodes );
+    level_offsets.init( resident_allocator, 16 );
+    dirty_words.init( resident_allocator, ( num_nodes + 63 ) / 64 );
+
+    sort_update_order = true;
 }
 
 void SceneGraph::shutdown() {
     nodes_debug_data.shutdown();
     nodes_hierarchy.shutdown();
     updated_nodes.shutdown();
+    changed_nodes.shutdown();
     local_matrices.shutdown();
     world_matrices.shutdown();
+
+    sorted_nodes.shutdown();
+    sorted_parents.shutdown();
+    sorted_positions.shutdown();
+    level_offsets.shutdown();
+    dirty_words.shutdown();
 }
 
 void SceneGraph::resize( u32 num_nodes ) {
+    const u32 previous_count = nodes_hierarchy.size;
+
     nodes_hierarchy.set_size( num_nodes );
     local_matrices.set_size( num_nodes );
     world_matrices.set_size( num_nodes );
     nodes_debug_data.set_size( num_nodes );
 
     updated_nodes.resize( num_nodes );
+    changed_nodes.resize( num_nodes );
+
+    // New nodes are roots until their hierarchy is set, so that the sort never reads garbage levels.
+    if ( num_nodes > previous_count ) {
+        init_new_nodes( previous_count, num_nodes - previous_count );
+    }
+    sort_update_order = true;
 }
 
 void SceneGraph::init_new_nodes( u32 offset, u32 num_nodes ) {
@@ -43,61 +153,133 @@ void SceneGraph::init_new_nodes( u32 offset, u32 num_nodes ) {
     }
 }
 
-void SceneGraph::update_matrices() {
+void SceneGraph::sort_nodes_by_level() {
+    const u32 num_nodes = nodes_hierarchy.size;
 
-    // TODO: per level update
-    u32 max_level = 0;
-    for ( u32 i = 0; i < nodes_hierarchy.size; ++i ) {
-        max_level = raptor::max(max_level, (u32)nodes_hierarchy[ i ].level );
+    // Hierarchy levels are 8 bits signed.
+    u32 level_cursors[ 128 ];
+    memset( level_cursors, 0, sizeof( level_cursors ) );
+
+    u32 num_levels = 1;
+    for ( u32 i = 0; i < num_nodes; ++i ) {
+        const i32 level = nodes_hierarchy[ i ].level;
+        RASSERT( level >= 0 );
+        ++level_cursors[ level ];
+        num_levels = raptor::max( num_levels, ( u32 )level + 1 );
     }
-    u32 current_level = 0;
-    u32 nodes_visited = 0;
 
-    //i64 time = time_now();
-    while ( current_level <= max_level ) {
+    // Counts to offsets, each level starting on a new dirty word.
+    level_offsets.set_size( num_levels + 1 );
+    u32 offset = 0;
+    for ( u32 l = 0; l < num_levels; ++l ) {
+        const u32 count = level_cursors[ l ];
+        level_offsets[ l ] = offset;
+        level_cursors[ l ] = offset;
+        offset += ( count + 63 ) & ~63u;
+    }
+    level_offsets[ num_levels ] = offset;
 
-        for ( u32 i = 0; i < nodes_hierarchy.size; ++i ) {
+    sorted_nodes.set_size( offset );
+    sorted_parents.set_size( offset );
+    sorted_positions.set_size( num_nodes );
+    dirty_words.set_size( offset / 64 );
 
-            if ( nodes_hierarchy[ i ].level != current_level ) {
-                continue;
-            }
+    memset( sorted_nodes.data, 0xff, offset * sizeof( u32 ) );
+    memset( sorted_parents.data, 0xff, offset * sizeof( u32 ) );
+    memset( dirty_words.data, 0, dirty_words.size * sizeof( u64 ) );
 
-            if ( updated_nodes.get_bit( i ) == 0 ) {
-                continue;
-            }
+    // Nodes keep their relative order inside a level.
+    for ( u32 i = 0; i < num_nodes; ++i ) {
+        const u32 position = level_cursors[ nodes_hierarchy[ i ].level ]++;
+        sorted_nodes[ position ] = i;
+        sorted_positions[ i ] = position;
+    }
 
-            updated_nodes.clear_bit( i );
+    for ( u32 i = 0; i < num_nodes; ++i ) {
+        const Hierarchy& hierarchy = nodes_hierarchy[ i ];
+        if ( hierarchy.parent < 0 ) {
+            continue;
+        }
 
-            if ( nodes_hierarchy[ i ].parent == -1 ) {
-                world_matrices[ i ] = local_matrices[ i ];
-            } else {
-                const mat4s& parent_matrix = world_matrices[ nodes_hierarchy[ i ].parent ];
-                world_matrices[ i ] = glms_mat4_mul( parent_matrix, local_matrices[ i ] );
+        RASSERTM( nodes_hierarchy[ hierarchy.parent ].level < hierarchy.level, "Scene graph node %u has a parent at the same or a deeper level", i );
+        sorted_parents[ sorted_positions[ i ] ] = sorted_positions[ hierarchy.parent ];
+    }
+
+    sort_update_order = false;
+}
+
+void SceneGraph::update_matrices( enki::TaskScheduler* task_scheduler ) {
+
+    if ( sort_update_order ) {
+        sort_nodes_by_level();
+    }
+
+    // Updated nodes to dirty bits in sorted order, 64 nodes at a time.
+    const u32 num_nodes = nodes_hierarchy.size;
+    bool any_dirty = false;
+    for ( u32 byte = 0; byte < updated_nodes.size; byte += 8 ) {
+        u64 word = 0;
+        memcpy( &word, updated_nodes.bits + byte, raptor::min( 8u, updated_nodes.size - byte ) );
+
+        while ( word ) {
+            const u32 node = byte * 8 + ( u32 )trailing_zeros_u64( word );
+            word &= word - 1;
+
+            if ( node >= num_nodes ) {
+                break;
             }
 
-            ++nodes_visited;
+            const u32 position = sorted_positions[ node ];
+            dirty_words[ position >> 6 ] |= 1ull << ( position & 63 );
+            any_dirty = true;
         }
+    }
 
-        ++current_level;
+    if ( !any_dirty ) {
+        return;
     }
+    memset( updated_nodes.bits, 0, updated_nodes.size );
 
-    //rprint( "Updated scene graph in %fms\n", time_from_milliseconds( time ) );
+    // Clean levels are skipped, unless a shallower level had dirty nodes: parents can be
+    // more than one level up, so the flag stays set once any level was dirty.
+    bool shallower_level_dirty = false;
+    for ( u32 l = 0; l < level_offsets.size - 1; ++l ) {
+        const u32 first_word = level_offsets[ l ] / 64;
+        const u32 last_word = level_offsets[ l + 1 ] / 64;
 
-    /*for ( u32 i = 0; i < nodes_hierarchy.size; ++i ) {
-        if ( updated_nodes.get_bit( i ) == 0 ) {
+        if ( !shallower_level_dirty && !any_dirty_word( dirty_words.data, first_word, last_word ) ) {
             continue;
         }
 
-        updated_nodes.clear_bit( i );
+        const u32 num_words = last_word - first_word;
+        if ( task_scheduler && num_words >= k_min_task_words * 2 ) {
+            level_task.scene_graph = this;
+            level_task.first_word = first_word;
+            level_task.propagate = shallower_level_dirty;
+            level_task.m_SetSize = num_words;
+            level_task.m_MinRange = k_min_task_words;
 
-        if ( nodes_hierarchy[ i ].parent == -1 ) {
-            world_matrices[ i ] = local_matrices[ i ];
+            task_scheduler->AddTaskSetToPipe( &level_task );
+            task_scheduler->WaitforTask( &level_task );
+        } else {
+            update_level_words( this, first_word, last_word, shallower_level_dirty );
         }
-        else {
-            const mat4s& parent_matrix = world_matrices[ nodes_hierarchy[ i ].parent ];
-            world_matrices[ i ] = glms_mat4_mul( parent_matrix, local_matrices[ i ] );
+
+        shallower_level_dirty = shallower_level_dirty || any_dirty_word( dirty_words.data, first_word, last_word );
+    }
+
+    // Dirty bits now include the propagated children.
+    for ( u32 w = 0; w < dirty_words.size; ++w ) {
+        u64 dirty = dirty_words[ w ];
+        while ( dirty ) {
+            const u32 position = w * 64 + ( u32 )trailing_zeros_u64( dirty );
+            dirty &= dirty - 1;
+
+            changed_nodes.set_bit( sorted_nodes[ position ] );
         }
-    }*/
+    }
+
+    memset( dirty_words.data, 0, dirty_words.size * sizeof( u64 ) );
 }
 
 void SceneGraph::set_hierarchy( u32 node_index, u32 parent_index, u32 level ) {
@@ -123,4 +305,147 @@ u32 SceneGraph::node_count() {
     return nodes_hierarchy.size;
 }
 
+// Benchmark //////////////////////////////////////////////////////////////
+
+//
+// Previous update: all nodes scanned once per level, only nodes with their own bit set are updated.
+static void scene_graph_update_level_scan( SceneGraph& scene_graph ) {
+    u32 max_level = 0;
+    for ( u32 i = 0; i < scene_graph.nodes_hierarchy.size; ++i ) {
+        max_level = raptor::max( max_level, ( u32 )scene_graph.nodes_hierarchy[ i ].level );
+    }
+
+    for ( u32 current_level = 0; current_level <= max_level; ++current_level ) {
+        for ( u32 i = 0; i < scene_graph.nodes_hierarchy.size; ++i ) {
+            const Hierarchy& hierarchy = scene_graph.nodes_hierarchy[ i ];
+            if ( ( u32 )hierarchy.level != current_level || scene_graph.updated_nodes.get_bit( i ) == 0 ) {
+                continue;
+            }
+
+            scene_graph.updated_nodes.clear_bit( i );
+
+            if ( hierarchy.parent == -1 ) {
+                scene_graph.world_matrices[ i ] = scene_graph.local_matrices[ i ];
+            } else {
+                scene_graph.world_matrices[ i ] = glms_mat4_mul( scene_graph.world_matrices[ hierarchy.parent ], scene_graph.local_matrices[ i ] );
+            }
+        }
+    }
+}
+
+static u32 scene_graph_benchmark_random( u32& state ) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+// Parents always precede their children, so a single pass in node order is the reference.
+static f32 scene_graph_benchmark_max_difference( const SceneGraph& scene_graph, mat4s* reference ) {
+    f32 max_difference = 0.f;
+    for ( u32 i = 0; i < scene_graph.nodes_hierarchy.size; ++i ) {
+        const i32 parent = scene_graph.nodes_hierarchy[ i ].parent;
+        reference[ i ] = parent < 0 ? scene_graph.local_matrices[ i ] : glms_mat4_mul( reference[ parent ], scene_graph.local_matrices[ i ] );
+
+        for ( u32 e = 0; e < 16; ++e ) {
+            max_difference = glm_max( max_difference, fabsf( reference[ i ].raw[ e / 4 ][ e % 4 ] - scene_graph.world_matrices[ i ].raw[ e / 4 ][ e % 4 ] ) );
+        }
+    }
+    return max_difference;
+}
+
+void scene_graph_benchmark( Allocator* allocator, enki::TaskScheduler* task_scheduler, u32 num_nodes ) {
+    const u32 num_frames = 20;
+    const u32 max_depth = 24;
+    const u32 roots_every = 1000;
+    const u32 partial_every = 100;
+
+    SceneGraph scene_graph;
+    scene_graph.init( allocator, num_nodes );
+    scene_graph.resize( num_nodes );
+
+    // Random parents among the previous nodes, so that levels are interleaved in memory.
+    u32 random_state = 1234;
+    for ( u32 i = 0; i < num_nodes; ++i ) {
+        if ( i % roots_every != 0 ) {
+            i32 parent = scene_graph_benchmark_random( random_state ) % i;
+            while ( ( u32 )scene_graph.nodes_hierarchy[ parent ].level + 1 >= max_depth ) {
+                parent = scene_graph.nodes_hierarchy[ parent ].parent;
+            }
+            scene_graph.set_hierarchy( i, parent, scene_graph.nodes_hierarchy[ parent ].level + 1 );
+        }
+
+        const f32 angle = 0.001f * ( scene_graph_benchmark_random( random_state ) % 1000 );
+        scene_graph.set_local_matrix( i, glms_rotate( glms_translate_make( vec3s{ 0.f, 0.01f, 0.f } ), angle, vec3s{ 0.f, 0.f, 1.f } ) );
+    }
+
+    mat4s* reference = ( mat4s* )rallocaa( sizeof( mat4s ) * num_nodes, allocator, 16 );
+
+    // Sorts the update order once, outside of the timings.
+    i64 start = time_now();
+    scene_graph.update_matrices();
+    const f64 sort_ms = time_from_milliseconds( start );
+
+    rprint( "Scene graph benchmark: %u nodes, %u levels, first update with sort %.3f ms, %u frames.\n",
+            num_nodes, scene_graph.level_offsets.size - 1, sort_ms, num_frames );
+
+    cstring k_method_names[] = { "level scan", "serial", "parallel" };
+
+    // Full updates: all local matrices are set every frame.
+    for ( u32 method = 0; method < ArraySize( k_method_names ); ++method ) {
+        memset( scene_graph.world_matrices.data, 0, sizeof( mat4s ) * num_nodes );
+
+        f64 update_ms = 0.0;
+        for ( u32 f = 0; f < num_frames; ++f ) {
+            for ( u32 i = 0; i < num_nodes; ++i ) {
+                scene_graph.set_local_matrix( i, scene_graph.local_matrices[ i ] );
+            }
+
+            start = time_now();
+            if ( method == 0 ) {
+                scene_graph_update_level_scan( scene_graph );
+            } else {
+                scene_graph.update_matrices( method == 2 ? task_scheduler : nullptr );
+            }
+            update_ms += time_from_milliseconds( start );
+        }
+
+        rprint( "Full update    | %-10s %9.3f ms | max difference %f\n", k_method_names[ method ], update_ms / num_frames,
+                scene_graph_benchmark_max_difference( scene_graph, reference ) );
+    }
+
+    // Partial updates: one node every hundred changes, the level scan misses their children.
+    for ( u32 method = 0; method < ArraySize( k_method_names ); ++method ) {
+        f64 update_ms = 0.0;
+        for ( u32 f = 0; f < num_frames; ++f ) {
+            const mat4s rotation = glms_rotate_make( 0.01f * ( f + 1 ), vec3s{ 1.f, 0.f, 0.f } );
+            for ( u32 i = ( f * 7 ) % partial_every; i < num_nodes; i += partial_every ) {
+                scene_graph.set_local_matrix( i, glms_mat4_mul( scene_graph.local_matrices[ i ], rotation ) );
+            }
+
+            start = time_now();
+            if ( method == 0 ) {
+                scene_graph_update_level_scan( scene_graph );
+            } else {
+                scene_graph.update_matrices( method == 2 ? task_scheduler : nullptr );
+            }
+            update_ms += time_from_milliseconds( start );
+        }
+
+        rprint( "Partial update | %-10s %9.3f ms | max difference %f\n", k_method_names[ method ], update_ms / num_frames,
+                scene_graph_benchmark_max_difference( scene_graph, reference ) );
+
+        // Next method starts from correct world matrices.
+        memcpy( scene_graph.world_matrices.data, reference, sizeof( mat4s ) * num_nodes );
+    }
+
+    // No changes, only the updated node bits are scanned.
+    start = time_now();
+    for ( u32 f = 0; f < num_frames; ++f ) {
+        scene_graph.update_matrices( task_scheduler );
+    }
+    rprint( "Clean update   | %-10s %9.3f ms\n", "parallel", time_from_milliseconds( start ) / num_frames );
+
+    rfree( reference, allocator );
+    scene_graph.shutdown();
+}
+
 } // namespace raptor
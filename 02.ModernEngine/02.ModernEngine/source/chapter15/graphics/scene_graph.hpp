@@ -5,8 +5,12 @@
 
 #include "external/cglm/struct/mat4.h"
 
+#include "external/enkiTS/TaskScheduler.h"
+
 namespace raptor {
 
+static const u32        k_invalid_scene_graph_node = 0xffffffff;
+
 //
 struct Hierarchy {
     i32                 parent : 24;
@@ -19,8 +23,24 @@ struct SceneGraphNodeDebugData {
 }; // struct SceneGraphNodeDebugData
 
 
+struct SceneGraph;
+
 //
+// Updates the dirty nodes of one level, partitioned in words of dirty bits.
+// Levels start on a word, so that partitions never share a word.
+struct SceneGraphLevelTask : public enki::ITaskSet {
+
+    void                ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) override;
+
+    SceneGraph*         scene_graph     = nullptr;
+    u32                 first_word      = 0;
+    bool                propagate       = false;    // False when no shallower level has a dirty node.
+
+}; // struct SceneGraphLevelTask
+
 //
+// Nodes are updated level by level, in an order sorted by level and rebuilt when the hierarchy changes.
+// Dirty nodes mark their children dirty, so that a local matrix change updates the whole subtree.
 struct SceneGraph {
 
     void                init( Allocator* resident_allocator, u32 num_nodes );
@@ -28,7 +48,9 @@ struct SceneGraph {
 
     void                init_new_nodes( u32 offset, u32 num_nodes );
     void                resize( u32 num_nodes );
-    void                update_matrices();
+    // Levels are split across the task scheduler when not null.
+    void                update_matrices( enki::TaskScheduler* task_scheduler = nullptr );
+    void                sort_nodes_by_level();
 
     void                set_hierarchy( u32 node_index, u32 parent_index, u32 level );
     void                set_local_matrix( u32 node_index, const mat4s& local_matrix );
@@ -42,9 +64,22 @@ struct SceneGraph {
     Array< SceneGraphNodeDebugData> nodes_debug_data;
 
     BitSet              updated_nodes;
+    BitSet              changed_nodes;      // World matrices written by update_matrices, cleared by their consumer.
+
+    // Update order, indexed by sorted position. Each level starts at a multiple of 64, unused positions are padding.
+    Array<u32>          sorted_nodes;       // Node index, k_invalid_scene_graph_node for padding.
+    Array<u32>          sorted_parents;     // Sorted position of the parent, k_invalid_scene_graph_node for roots.
+    Array<u32>          sorted_positions;   // Sorted position of each node.
+    Array<u32>          level_offsets;      // First sorted position of each level, plus the end.
+    Array<u64>          dirty_words;        // One dirty bit per sorted position.
+
+    SceneGraphLevelTask level_task;
 
     bool                sort_update_order = true;
 
 }; // struct SceneGraph
 
+// Generated hierarchies of 100K to 1M nodes: full and partial updates, against the previous level scans.
+void                    scene_graph_benchmark( Allocator* allocator, enki::TaskScheduler* task_scheduler, u32 num_nodes );
+
 } // namespace raptor
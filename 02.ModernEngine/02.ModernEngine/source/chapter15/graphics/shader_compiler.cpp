@@ -0,0 +1,397 @@
+#include "graphics/shader_compiler.hpp"
+
+#include "foundation/memory.hpp"
+#include "foundation/hash_map.hpp"
+#include "foundation/array.hpp"
+#include "foundation/process.hpp"
+#include "foundation/file.hpp"
+#include "foundation/time.hpp"
+
+#include "external/tracy/tracy/Tracy.hpp"
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+#if defined(RAPTOR_GLSLANG_LIBRARY)
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+namespace raptor {
+
+// Part of every key: changing compiler target or options invalidates old binaries.
+static cstring          k_shader_cache_tag      = "glsl460-vulkan1.2-spirv1.5-v1";
+static const u32        k_spirv_magic           = 0x07230203;
+
+// Fills <STAGE>_<NAME> in uppercase, as expected by the shaders.
+static void build_stage_name_define( char* define, u32 define_size, VkShaderStageFlagBits stage, cstring name ) {
+    snprintf( define, define_size, "%s_%s", to_stage_defines( stage ), name );
+    for ( char* c = define; *c; ++c ) {
+        *c = ( char )toupper( *c );
+    }
+}
+
+static u32* copy_spirv( const void* code, sizet code_size, Allocator* allocator ) {
+    u32* result = ( u32* )ralloca( code_size, allocator );
+    memory_copy( result, ( void* )code, code_size );
+    return result;
+}
+
+#if defined(RAPTOR_GLSLANG_LIBRARY)
+
+static EShLanguage to_glslang_stage( VkShaderStageFlagBits stage ) {
+    switch ( stage ) {
+        case VK_SHADER_STAGE_VERTEX_BIT:
+            return EShLangVertex;
+        case VK_SHADER_STAGE_FRAGMENT_BIT:
+            return EShLangFragment;
+        case VK_SHADER_STAGE_COMPUTE_BIT:
+            return EShLangCompute;
+        case VK_SHADER_STAGE_MESH_BIT_NV:
+            return EShLangMeshNV;
+        case VK_SHADER_STAGE_TASK_BIT_NV:
+            return EShLangTaskNV;
+        case VK_SHADER_STAGE_RAYGEN_BIT_KHR:
+            return EShLangRayGen;
+        case VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR:
+            return EShLangClosestHit;
+        case VK_SHADER_STAGE_ANY_HIT_BIT_KHR:
+            return EShLangAnyHit;
+        case VK_SHADER_STAGE_MISS_BIT_KHR:
+            return EShLangMiss;
+        default:
+            RASSERT( false );
+            return EShLangVertex;
+    }
+}
+
+// Same options as the glslangValidator command line: -V --target-env vulkan1.2 --D <defines>.
+static bool compile_glslang( cstring code, u32 code_size, VkShaderStageFlagBits stage, cstring stage_name_define, cstring defines, Allocator* allocator, ShaderCompileResult& result ) {
+    const EShLanguage language = to_glslang_stage( stage );
+
+    char preamble[ 768 ];
+    snprintf( preamble, 768, "#define %s\n#define %s\n%s", stage_name_define, to_stage_defines( stage ), defines );
+
+    const char* sources[] = { code };
+    const int source_lengths[] = { ( int )code_size };
+
+    glslang::TShader shader( language );
+    shader.setStringsWithLengths( sources, source_lengths, 1 );
+    shader.setPreamble( preamble );
+    shader.setEnvInput( glslang::EShSourceGlsl, language, glslang::EShClientVulkan, 100 );
+    shader.setEnvClient( glslang::EShClientVulkan, glslang::EShTargetVulkan_1_2 );
+    shader.setEnvTarget( glslang::EShTargetSpv, glslang::EShTargetSpv_1_5 );
+
+    const EShMessages messages = ( EShMessages )( EShMsgSpvRules | EShMsgVulkanRules );
+    if ( !shader.parse( GetDefaultResources(), 100, false, messages ) ) {
+        rprint( "%s\n", shader.getInfoLog() );
+        return false;
+    }
+
+    glslang::TProgram program;
+    program.addShader( &shader );
+    if ( !program.link( messages ) ) {
+        rprint( "%s\n", program.getInfoLog() );
+        return false;
+    }
+
+    std::vector<unsigned int> spirv;
+    glslang::GlslangToSpv( *program.getIntermediate( language ), spirv );
+
+    result.code_size = spirv.size() * sizeof( u32 );
+    result.code = copy_spirv( spirv.data(), result.code_size, allocator );
+    return true;
+}
+
+#else
+
+// glslangValidator fallback. Temporary files are named after the key, but process_execute
+// is not reentrant so this path must not be called from multiple threads.
+static bool compile_process( cstring code, u32 code_size, VkShaderStageFlagBits stage, cstring stage_name_define, cstring defines_arguments, u64 key,
+                             cstring binaries_path, Allocator* allocator, ShaderCompileResult& result ) {
+    char temp_filename[ 64 ];
+    snprintf( temp_filename, 64, "shader_%016llx.glsl", key );
+    char final_spirv_filename[ 64 ];
+    snprintf( final_spirv_filename, 64, "shader_%016llx.spv", key );
+
+    // Write current shader to file.
+    FILE* temp_shader_file = fopen( temp_filename, "w" );
+    if ( !temp_shader_file ) {
+        rprint( "Cannot write temporary shader file %s\n", temp_filename );
+        return false;
+    }
+    fwrite( code, code_size, 1, temp_shader_file );
+    fclose( temp_shader_file );
+
+    char glsl_compiler_path[ 640 ];
+    char arguments[ 1024 ];
+#if defined(_MSC_VER)
+    snprintf( glsl_compiler_path, 640, "%sglslangValidator.exe", binaries_path );
+    // TODO: add optional debug information in shaders (option -g).
+    snprintf( arguments, 1024, "glslangValidator.exe %s -V --target-env vulkan1.2 -o %s -S %s --D %s --D %s%s", temp_filename, final_spirv_filename, to_compiler_extension( stage ), stage_name_define, to_stage_defines( stage ), defines_arguments );
+#else
+    snprintf( glsl_compiler_path, 640, "%sglslangValidator", binaries_path );
+    snprintf( arguments, 1024, "%s -V --target-env vulkan1.2 -o %s -S %s --D %s --D %s%s", temp_filename, final_spirv_filename, to_compiler_extension( stage ), stage_name_define, to_stage_defines( stage ), defines_arguments );
+#endif
+    process_execute( ".", glsl_compiler_path, arguments, "" );
+
+    // Read back SPV file.
+    result.code = reinterpret_cast< u32* >( file_read_binary( final_spirv_filename, allocator, &result.code_size ) );
+
+    // Temporary files cleanup
+    file_delete( temp_filename );
+    file_delete( final_spirv_filename );
+
+    return result.code != nullptr;
+}
+
+#endif // RAPTOR_GLSLANG_LIBRARY
+
+// ShaderCompileTask //////////////////////////////////////////////////////
+
+void ShaderCompileTask::ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) {
+    ZoneScoped;
+
+    // The engine allocators are not shared between workers.
+    MallocAllocator malloc_allocator;
+
+    for ( u32 i = range_.start; i < range_.end; ++i ) {
+        ShaderCompileJob& job = jobs[ job_indices[ i ] ];
+
+        ShaderCompileResult result;
+        if ( use_cache ) {
+            job.compiled = compiler->compile( job.code, job.code_size, job.stage, job.name, &malloc_allocator, result );
+        }
+        else {
+            job.compiled = compiler->compile_uncached( job.code, job.code_size, job.stage, job.name, &malloc_allocator, result );
+        }
+
+        if ( !job.compiled ) {
+            rprint( "Error compiling shader %s stage %s\n", job.name, to_compiler_extension( job.stage ) );
+        }
+
+        if ( result.code ) {
+            rfree( result.code, &malloc_allocator );
+        }
+    }
+}
+
+// ShaderCompiler /////////////////////////////////////////////////////////
+
+void ShaderCompiler::init() {
+
+    // Get binaries path
+#if defined(_MSC_VER)
+    char vulkan_env[ 512 ];
+    ExpandEnvironmentStringsA( "%VULKAN_SDK%", vulkan_env, 512 );
+    snprintf( binaries_path, 512, "%s\\Bin\\", vulkan_env );
+#else
+    char* vulkan_env = getenv( "VULKAN_SDK" );
+    snprintf( binaries_path, 512, "%s/bin/", vulkan_env ? vulkan_env : "" );
+#endif
+
+    cache_folder[ 0 ] = 0;
+    defines[ 0 ] = 0;
+    defines_arguments[ 0 ] = 0;
+
+#if defined(RAPTOR_GLSLANG_LIBRARY)
+    glslang::InitializeProcess();
+#endif
+}
+
+void ShaderCompiler::shutdown() {
+#if defined(RAPTOR_GLSLANG_LIBRARY)
+    glslang::FinalizeProcess();
+#endif
+}
+
+void ShaderCompiler::set_cache_folder( cstring folder ) {
+    snprintf( cache_folder, 512, "%s", folder ? folder : "" );
+}
+
+void ShaderCompiler::add_define( cstring name, u32 value ) {
+    const sizet defines_length = strlen( defines );
+    snprintf( defines + defines_length, sizeof( defines ) - defines_length, "#define %s %u\n", name, value );
+
+    const sizet arguments_length = strlen( defines_arguments );
+    snprintf( defines_arguments + arguments_length, sizeof( defines_arguments ) - arguments_length, " --D %s=%u", name, value );
+}
+
+u64 ShaderCompiler::compute_key( cstring code, u32 code_size, VkShaderStageFlagBits stage, cstring name ) const {
+    char stage_name_define[ 256 ];
+    build_stage_name_define( stage_name_define, 256, stage, name );
+
+    u64 key = hash_bytes( ( void* )k_shader_cache_tag, strlen( k_shader_cache_tag ) );
+    key = hash_bytes( &stage, sizeof( VkShaderStageFlagBits ), key );
+    key = hash_bytes( stage_name_define, strlen( stage_name_define ), key );
+    key = hash_bytes( ( void* )defines, strlen( defines ), key );
+    return hash_bytes( ( void* )code, code_size, key );
+}
+
+bool ShaderCompiler::is_cached( u64 key ) const {
+    if ( cache_folder[ 0 ] == 0 ) {
+        return false;
+    }
+
+    char path[ 640 ];
+    snprintf( path, 640, "%s/%016llx.spv", cache_folder, key );
+    return file_exists( path );
+}
+
+bool ShaderCompiler::compile( cstring code, u32 code_size, VkShaderStageFlagBits stage, cstring name, Allocator* allocator, ShaderCompileResult& result ) {
+    if ( cache_folder[ 0 ] == 0 ) {
+        return compile_uncached( code, code_size, stage, name, allocator, result );
+    }
+
+    const u64 key = compute_key( code, code_size, stage, name );
+    if ( read_cache( key, allocator, result ) ) {
+        return true;
+    }
+
+    if ( !compile_uncached( code, code_size, stage, name, allocator, result ) ) {
+        return false;
+    }
+
+    write_cache( key, result );
+    return true;
+}
+
+bool ShaderCompiler::compile_uncached( cstring code, u32 code_size, VkShaderStageFlagBits stage, cstring name, Allocator* allocator, ShaderCompileResult& result ) {
+    ZoneScoped;
+
+    result.cache_hit = false;
+
+    // Add uppercase define as STAGE_NAME
+    char stage_name_define[ 256 ];
+    build_stage_name_define( stage_name_define, 256, stage, name );
+
+#if defined(RAPTOR_GLSLANG_LIBRARY)
+    return compile_glslang( code, code_size, stage, stage_name_define, defines, allocator, result );
+#else
+    return compile_process( code, code_size, stage, stage_name_define, defines_arguments, compute_key( code, code_size, stage, name ), binaries_path, allocator, result );
+#endif
+}
+
+u32 ShaderCompiler::compile_jobs( ShaderCompileJob* jobs, u32 count, enki::TaskScheduler* task_scheduler, Allocator* allocator, bool use_cache ) {
+    ZoneScoped;
+
+    // Stages shared between techniques are compiled once.
+    FlatHashMap<u64, u32> unique_keys;
+    unique_keys.init( allocator, 64 );
+
+    Array<u32> job_indices;
+    job_indices.init( allocator, count );
+
+    for ( u32 i = 0; i < count; ++i ) {
+        ShaderCompileJob& job = jobs[ i ];
+        job.key = compute_key( job.code, job.code_size, job.stage, job.name );
+        job.compiled = false;
+
+        if ( unique_keys.find( job.key ).is_valid() ) {
+            continue;
+        }
+        unique_keys.insert( job.key, i );
+
+        if ( use_cache && is_cached( job.key ) ) {
+            continue;
+        }
+        job_indices.push( i );
+    }
+
+    if ( job_indices.size ) {
+        ShaderCompileTask compile_task;
+        compile_task.compiler = this;
+        compile_task.jobs = jobs;
+        compile_task.job_indices = job_indices.data;
+        compile_task.use_cache = use_cache;
+        compile_task.m_SetSize = job_indices.size;
+
+        if ( task_scheduler && is_thread_safe() ) {
+            task_scheduler->AddTaskSetToPipe( &compile_task );
+            task_scheduler->WaitforTask( &compile_task );
+        }
+        else {
+            compile_task.ExecuteRange( { 0, job_indices.size }, 0 );
+        }
+    }
+
+    u32 compiled_jobs = 0;
+    for ( u32 i = 0; i < job_indices.size; ++i ) {
+        compiled_jobs += jobs[ job_indices[ i ] ].compiled ? 1 : 0;
+    }
+
+    job_indices.shutdown();
+    unique_keys.shutdown();
+
+    return compiled_jobs;
+}
+
+bool ShaderCompiler::read_cache( u64 key, Allocator* allocator, ShaderCompileResult& result ) const {
+    if ( cache_folder[ 0 ] == 0 ) {
+        return false;
+    }
+
+    char path[ 640 ];
+    snprintf( path, 640, "%s/%016llx.spv", cache_folder, key );
+    if ( !file_exists( path ) ) {
+        return false;
+    }
+
+    sizet size = 0;
+    u32* code = reinterpret_cast< u32* >( file_read_binary( path, allocator, &size ) );
+    if ( code == nullptr ) {
+        return false;
+    }
+
+    // Discard truncated or foreign files, they will be overwritten by the next compile.
+    if ( size < sizeof( u32 ) || ( size % sizeof( u32 ) ) != 0 || code[ 0 ] != k_spirv_magic ) {
+        rfree( code, allocator );
+        return false;
+    }
+
+    result.code = code;
+    result.code_size = size;
+    result.cache_hit = true;
+    return true;
+}
+
+void ShaderCompiler::write_cache( u64 key, const ShaderCompileResult& result ) const {
+    if ( cache_folder[ 0 ] == 0 || result.code == nullptr ) {
+        return;
+    }
+
+    // Write to a temporary file and rename it, so a concurrent reader never sees a partial binary.
+    char path[ 640 ];
+    snprintf( path, 640, "%s/%016llx.spv", cache_folder, key );
+    char temp_path[ 640 ];
+    snprintf( temp_path, 640, "%s/%016llx.spv.tmp", cache_folder, key );
+
+    FILE* file = fopen( temp_path, "wb" );
+    if ( !file ) {
+        rprint( "Cannot write shader cache file %s\n", temp_path );
+        return;
+    }
+    fwrite( result.code, result.code_size, 1, file );
+    fclose( file );
+
+    file_delete( path );
+    if ( rename( temp_path, path ) != 0 ) {
+        file_delete( temp_path );
+    }
+}
+
+bool ShaderCompiler::is_thread_safe() const {
+#if defined(RAPTOR_GLSLANG_LIBRARY)
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace raptor
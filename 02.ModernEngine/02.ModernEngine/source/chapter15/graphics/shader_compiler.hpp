@@ -0,0 +1,85 @@
+#pragma once
+
+#include "graphics/gpu_resources.hpp"
+
+#include "external/enkiTS/TaskScheduler.h"
+
+namespace raptor {
+
+    struct Allocator;
+    struct ShaderCompiler;
+
+    //
+    // SpirV output of a compilation or of a cache read. code_size is in bytes.
+    struct ShaderCompileResult {
+
+        u32*                            code            = nullptr;
+        sizet                           code_size       = 0;
+        bool                            cache_hit       = false;
+    }; // struct ShaderCompileResult
+
+    //
+    // Preprocessed glsl of a single stage, name is used for the <STAGE>_<NAME> define.
+    struct ShaderCompileJob {
+
+        cstring                         code            = nullptr;
+        u32                             code_size       = 0;
+        VkShaderStageFlagBits           stage           = VK_SHADER_STAGE_VERTEX_BIT;
+        cstring                         name            = nullptr;
+
+        u64                             key             = 0;
+        bool                            compiled        = false;
+    }; // struct ShaderCompileJob
+
+    //
+    // Compiles a range of jobs on the worker threads, writing results in the cache.
+    struct ShaderCompileTask : public enki::ITaskSet {
+
+        void                            ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) override;
+
+        ShaderCompiler*                 compiler        = nullptr;
+        ShaderCompileJob*               jobs            = nullptr;
+        const u32*                      job_indices     = nullptr;  // Unique jobs to compile.
+        bool                            use_cache       = true;
+    }; // struct ShaderCompileTask
+
+    //
+    // Glsl to SpirV compiler with an on disk cache. Cached binaries are named after the hash
+    // of the preprocessed source, the stage, the stage define and the compiler target, so
+    // any technique sharing the same code reuses the same binary.
+    // When built with RAPTOR_GLSLANG_LIBRARY compilation runs in process and is thread safe,
+    // otherwise glslangValidator is spawned and jobs are compiled serially.
+    struct ShaderCompiler {
+
+        void                            init();
+        void                            shutdown();
+
+        // Cache is disabled until a folder is set.
+        void                            set_cache_folder( cstring folder );
+        // Engine wide define added to every stage and to the cache keys, as NUM_LIGHTS. Set before compiling.
+        void                            add_define( cstring name, u32 value );
+
+        u64                             compute_key( cstring code, u32 code_size, VkShaderStageFlagBits stage, cstring name ) const;
+        bool                            is_cached( u64 key ) const;
+
+        // Reads the cache and compiles on a miss. Result memory comes from allocator.
+        bool                            compile( cstring code, u32 code_size, VkShaderStageFlagBits stage, cstring name, Allocator* allocator, ShaderCompileResult& result );
+        bool                            compile_uncached( cstring code, u32 code_size, VkShaderStageFlagBits stage, cstring name, Allocator* allocator, ShaderCompileResult& result );
+
+        // Compiles all jobs missing from the cache, or all jobs when use_cache is false.
+        // Returns the number of compiled jobs.
+        u32                             compile_jobs( ShaderCompileJob* jobs, u32 count, enki::TaskScheduler* task_scheduler, Allocator* allocator, bool use_cache );
+
+        bool                            read_cache( u64 key, Allocator* allocator, ShaderCompileResult& result ) const;
+        void                            write_cache( u64 key, const ShaderCompileResult& result ) const;
+
+        bool                            is_thread_safe() const;
+
+        char                            binaries_path[ 512 ];
+        char                            cache_folder[ 512 ];
+        char                            defines[ 256 ];         // As a preamble, #define NAME VALUE lines.
+        char                            defines_arguments[ 256 ]; // As glslangValidator --D NAME=VALUE arguments.
+
+    }; // struct ShaderCompiler
+
+} // namespace raptor
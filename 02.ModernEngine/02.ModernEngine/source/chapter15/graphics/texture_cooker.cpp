@@ -0,0 +1,629 @@
+#include "graphics/texture_cooker.hpp"
+#include "graphics/gpu_resources.hpp"
+
+#include "foundation/memory.hpp"
+#include "foundation/file.hpp"
+#include "foundation/numerics.hpp"
+#include "foundation/log.hpp"
+#include "foundation/assert.hpp"
+
+#include "external/tracy/tracy/Tracy.hpp"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace raptor {
+
+VkFormat texture_usage_format( TextureUsage::Enum usage ) {
+    switch ( usage ) {
+        case TextureUsage::Normal:
+            return VK_FORMAT_BC5_UNORM_BLOCK;
+        case TextureUsage::Mask:
+            return VK_FORMAT_BC4_UNORM_BLOCK;
+        default:
+            return VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+}
+
+// KTX2 ///////////////////////////////////////////////////////////////////
+
+static const u8     k_ktx2_identifier[ 12 ] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+static const u32    k_ktx2_header_size      = 80;   // Identifier, header and index.
+static const u32    k_ktx2_level_entry_size = 24;   // Offset, length and uncompressed length.
+
+// Data format descriptor models and transfer function, see the Khronos data format specification.
+static const u8     k_dfd_model_bc4         = 131;
+static const u8     k_dfd_model_bc5         = 132;
+static const u8     k_dfd_model_bc7         = 134;
+static const u8     k_dfd_primaries_bt709   = 1;
+static const u8     k_dfd_transfer_linear   = 1;
+
+static bool ktx2_parse_header( const u8* data, sizet size, Ktx2Info& out_info ) {
+    if ( size < k_ktx2_header_size || memcmp( data, k_ktx2_identifier, sizeof( k_ktx2_identifier ) ) != 0 ) {
+        return false;
+    }
+
+    u32 header[ 9 ];
+    memcpy( header, data + 12, sizeof( header ) );
+
+    const VkFormat format = ( VkFormat )header[ 0 ];
+    const u32 pixel_depth = header[ 4 ], layer_count = header[ 5 ], face_count = header[ 6 ], level_count = header[ 7 ], supercompression = header[ 8 ];
+
+    if ( format < VK_FORMAT_BC1_RGB_UNORM_BLOCK || format > VK_FORMAT_BC7_SRGB_BLOCK || pixel_depth > 1 || layer_count > 1 || face_count != 1 ||
+         level_count == 0 || level_count > k_ktx2_max_levels || supercompression != 0 ) {
+        return false;
+    }
+
+    if ( size < k_ktx2_header_size + level_count * k_ktx2_level_entry_size ) {
+        return false;
+    }
+
+    out_info.format = format;
+    out_info.width = header[ 2 ];
+    out_info.height = header[ 3 ] ? header[ 3 ] : 1;
+    out_info.level_count = level_count;
+
+    for ( u32 level = 0; level < level_count; ++level ) {
+        const u8* entry = data + k_ktx2_header_size + level * k_ktx2_level_entry_size;
+        memcpy( &out_info.level_offsets[ level ], entry, sizeof( u64 ) );
+        memcpy( &out_info.level_sizes[ level ], entry + 8, sizeof( u64 ) );
+
+        const u32 w = max( out_info.width >> level, 1u );
+        const u32 h = max( out_info.height >> level, 1u );
+        if ( out_info.level_sizes[ level ] != TextureFormat::block_compressed_size( format, w, h ) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ktx2_read_info( cstring path, Ktx2Info& out_info ) {
+    FILE* file = fopen( path, "rb" );
+    if ( !file ) {
+        return false;
+    }
+
+    u8 header[ k_ktx2_header_size + k_ktx2_max_levels * k_ktx2_level_entry_size ];
+    const sizet read_size = fread( header, 1, sizeof( header ), file );
+    fclose( file );
+
+    return ktx2_parse_header( header, read_size, out_info );
+}
+
+bool texture_find_cooked( cstring image_path, char* out_cooked_path, u32 max_size, Ktx2Info& out_info ) {
+    snprintf( out_cooked_path, max_size, "%s.ktx2", image_path );
+
+    u64 cooked_size = 0, cooked_time = 0;
+    if ( !file_stat( out_cooked_path, &cooked_size, &cooked_time ) ) {
+        return false;
+    }
+
+    u64 image_size = 0, image_time = 0;
+    if ( file_stat( image_path, &image_size, &image_time ) && image_time > cooked_time ) {
+        rprint( "Cooked texture %s is older than its image, cook it again\n", out_cooked_path );
+        return false;
+    }
+
+    if ( !ktx2_read_info( out_cooked_path, out_info ) ) {
+        rprint( "Cooked texture %s is not a supported KTX2 file\n", out_cooked_path );
+        return false;
+    }
+
+    return true;
+}
+
+// Levels are read in place, from the base, so the data can be copied to the staging buffer as is.
+static bool ktx2_read_levels( FILE* file, const Ktx2Info& info, u8* out_data ) {
+    sizet offset = 0;
+    for ( u32 level = 0; level < info.level_count; ++level ) {
+        if ( fseek( file, ( long )info.level_offsets[ level ], SEEK_SET ) != 0 ||
+             fread( out_data + offset, 1, info.level_sizes[ level ], file ) != info.level_sizes[ level ] ) {
+            return false;
+        }
+        offset += info.level_sizes[ level ];
+    }
+    return true;
+}
+
+u8* texture_read_cooked( cstring path, Ktx2Info& out_info, sizet* out_size ) {
+    ZoneScoped;
+
+    FILE* file = fopen( path, "rb" );
+    if ( !file ) {
+        return nullptr;
+    }
+
+    u8 header[ k_ktx2_header_size + k_ktx2_max_levels * k_ktx2_level_entry_size ];
+    const sizet header_size = fread( header, 1, sizeof( header ), file );
+    if ( !ktx2_parse_header( header, header_size, out_info ) ) {
+        fclose( file );
+        return nullptr;
+    }
+
+    sizet total_size = 0;
+    for ( u32 level = 0; level < out_info.level_count; ++level ) {
+        total_size += out_info.level_sizes[ level ];
+    }
+
+    u8* data = ( u8* )malloc( total_size );
+    const bool levels_read = ktx2_read_levels( file, out_info, data );
+    fclose( file );
+
+    if ( !levels_read ) {
+        free( data );
+        return nullptr;
+    }
+
+    if ( out_size ) {
+        *out_size = total_size;
+    }
+    return data;
+}
+
+bool texture_read_cooked_levels( cstring path, const Ktx2Info& info, u8* out_data ) {
+    ZoneScoped;
+
+    FILE* file = fopen( path, "rb" );
+    if ( !file ) {
+        return false;
+    }
+
+    const bool levels_read = ktx2_read_levels( file, info, out_data );
+    fclose( file );
+    return levels_read;
+}
+
+static void ktx2_write_dfd( u8* dfd, VkFormat format ) {
+    u8 model = k_dfd_model_bc7;
+    u32 sample_count = 1;
+    if ( format == VK_FORMAT_BC4_UNORM_BLOCK ) {
+        model = k_dfd_model_bc4;
+    } else if ( format == VK_FORMAT_BC5_UNORM_BLOCK ) {
+        model = k_dfd_model_bc5;
+        sample_count = 2;
+    }
+
+    const u32 bytes = TextureFormat::block_size( format );
+    const u32 descriptor_size = 24 + 16 * sample_count;
+
+    u32 words[ 1 + 6 + 4 * 2 ]{ };
+    words[ 0 ] = 4 + descriptor_size;
+    words[ 1 ] = 0;                                     // Khronos vendor, basic descriptor.
+    words[ 2 ] = 2 | ( descriptor_size << 16 );         // Version 1.3.
+    words[ 3 ] = model | ( k_dfd_primaries_bt709 << 8 ) | ( k_dfd_transfer_linear << 16 );
+    words[ 4 ] = 3 | ( 3 << 8 );                        // 4x4 texel blocks, dimensions minus one.
+    words[ 5 ] = bytes;
+    words[ 6 ] = 0;
+
+    // Each sample covers one channel of the block: BC5 has red then green, the others a single one.
+    const u32 sample_bits = sample_count == 2 ? 64 : bytes * 8;
+    for ( u32 s = 0; s < sample_count; ++s ) {
+        u32* sample = &words[ 7 + s * 4 ];
+        sample[ 0 ] = ( s * sample_bits ) | ( ( sample_bits - 1 ) << 16 ) | ( s << 24 );
+        sample[ 1 ] = 0;
+        sample[ 2 ] = 0;
+        sample[ 3 ] = 0xffffffff;
+    }
+
+    memcpy( dfd, words, 4 + descriptor_size );
+}
+
+// Block compression //////////////////////////////////////////////////////
+
+static void bc4_encode_channel( const u8* texels, u32 channel, u8* out_block ) {
+    u8 values[ 16 ];
+    u8 minimum = 255, maximum = 0;
+    for ( u32 i = 0; i < 16; ++i ) {
+        values[ i ] = texels[ i * 4 + channel ];
+        minimum = values[ i ] < minimum ? values[ i ] : minimum;
+        maximum = values[ i ] > maximum ? values[ i ] : maximum;
+    }
+
+    // Endpoint 0 greater than endpoint 1 selects the 8 values palette.
+    f32 palette[ 8 ];
+    palette[ 0 ] = maximum;
+    palette[ 1 ] = minimum;
+    for ( u32 i = 1; i < 7; ++i ) {
+        palette[ i + 1 ] = ( ( 7 - i ) * maximum + i * minimum ) / 7.f;
+    }
+
+    u64 indices = 0;
+    if ( maximum != minimum ) {
+        for ( u32 i = 0; i < 16; ++i ) {
+            u32 best_index = 0;
+            f32 best_error = FLT_MAX;
+            for ( u32 p = 0; p < 8; ++p ) {
+                const f32 error = fabsf( palette[ p ] - values[ i ] );
+                if ( error < best_error ) {
+                    best_error = error;
+                    best_index = p;
+                }
+            }
+            indices |= ( u64 )best_index << ( i * 3 );
+        }
+    }
+
+    out_block[ 0 ] = maximum;
+    out_block[ 1 ] = minimum;
+    for ( u32 i = 0; i < 6; ++i ) {
+        out_block[ 2 + i ] = ( u8 )( indices >> ( i * 8 ) );
+    }
+}
+
+void bc4_encode_block( const u8* texels, u32 channel, u8* out_block ) {
+    bc4_encode_channel( texels, channel, out_block );
+}
+
+void bc5_encode_block( const u8* texels, u8* out_block ) {
+    bc4_encode_channel( texels, 0, out_block );
+    bc4_encode_channel( texels, 1, out_block + 8 );
+}
+
+static const u32 k_bc7_weights[ 16 ] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+//
+// Quantized mode 6 endpoints: 7 bits per channel plus a shared bit per endpoint.
+struct Bc7Endpoints {
+    u32                 colors[ 2 ][ 4 ];
+    u32                 p_bits[ 2 ];
+}; // struct Bc7Endpoints
+
+static u32 bc7_quantize( f32 value, u32 p_bit ) {
+    const i32 quantized = ( i32 )floorf( ( value - p_bit ) * 0.5f + 0.5f );
+    return quantized < 0 ? 0 : ( quantized > 127 ? 127 : quantized );
+}
+
+// Assigns the closest palette entry to each texel, returns the squared error.
+static u32 bc7_assign_indices( const u8* texels, const Bc7Endpoints& endpoints, u8* out_indices ) {
+    i32 palette[ 16 ][ 4 ];
+    for ( u32 c = 0; c < 4; ++c ) {
+        const i32 e0 = ( endpoints.colors[ 0 ][ c ] << 1 ) | endpoints.p_bits[ 0 ];
+        const i32 e1 = ( endpoints.colors[ 1 ][ c ] << 1 ) | endpoints.p_bits[ 1 ];
+        for ( u32 i = 0; i < 16; ++i ) {
+            palette[ i ][ c ] = ( ( 64 - k_bc7_weights[ i ] ) * e0 + k_bc7_weights[ i ] * e1 + 32 ) >> 6;
+        }
+    }
+
+    u32 total_error = 0;
+    for ( u32 t = 0; t < 16; ++t ) {
+        const u8* texel = &texels[ t * 4 ];
+        u32 best_error = UINT32_MAX;
+        for ( u32 i = 0; i < 16; ++i ) {
+            u32 error = 0;
+            for ( u32 c = 0; c < 4; ++c ) {
+                const i32 d = palette[ i ][ c ] - texel[ c ];
+                error += d * d;
+            }
+            if ( error < best_error ) {
+                best_error = error;
+                out_indices[ t ] = ( u8 )i;
+            }
+        }
+        total_error += best_error;
+    }
+    return total_error;
+}
+
+// Tries the four shared bits combinations of the endpoints, keeping the best one.
+static u32 bc7_fit_endpoints( const u8* texels, const f32 e0[ 4 ], const f32 e1[ 4 ], Bc7Endpoints& best, u8* best_indices, u32 best_error ) {
+    for ( u32 p = 0; p < 4; ++p ) {
+        Bc7Endpoints endpoints;
+        endpoints.p_bits[ 0 ] = p & 1;
+        endpoints.p_bits[ 1 ] = p >> 1;
+        for ( u32 c = 0; c < 4; ++c ) {
+            endpoints.colors[ 0 ][ c ] = bc7_quantize( e0[ c ], endpoints.p_bits[ 0 ] );
+            endpoints.colors[ 1 ][ c ] = bc7_quantize( e1[ c ], endpoints.p_bits[ 1 ] );
+        }
+
+        u8 indices[ 16 ];
+        const u32 error = bc7_assign_indices( texels, endpoints, indices );
+        if ( error < best_error ) {
+            best_error = error;
+            best = endpoints;
+            memcpy( best_indices, indices, 16 );
+        }
+    }
+    return best_error;
+}
+
+static void bc7_write_bits( u64 bits[ 2 ], u32& position, u32 value, u32 count ) {
+    for ( u32 i = 0; i < count; ++i, ++position ) {
+        bits[ position / 64 ] |= ( u64 )( ( value >> i ) & 1 ) << ( position % 64 );
+    }
+}
+
+void bc7_encode_block( const u8* texels, u8* out_block ) {
+    // Principal axis of the texels, from the power iteration of the covariance.
+    f32 mean[ 4 ]{ };
+    for ( u32 t = 0; t < 16; ++t ) {
+        for ( u32 c = 0; c < 4; ++c ) {
+            mean[ c ] += texels[ t * 4 + c ] / 16.f;
+        }
+    }
+
+    f32 covariance[ 4 ][ 4 ]{ };
+    for ( u32 t = 0; t < 16; ++t ) {
+        f32 d[ 4 ];
+        for ( u32 c = 0; c < 4; ++c ) {
+            d[ c ] = texels[ t * 4 + c ] - mean[ c ];
+        }
+        for ( u32 i = 0; i < 4; ++i ) {
+            for ( u32 j = 0; j < 4; ++j ) {
+                covariance[ i ][ j ] += d[ i ] * d[ j ];
+            }
+        }
+    }
+
+    f32 axis[ 4 ] = { 1.f, 1.f, 1.f, 1.f };
+    for ( u32 iteration = 0; iteration < 8; ++iteration ) {
+        f32 next[ 4 ]{ };
+        f32 length = 0.f;
+        for ( u32 i = 0; i < 4; ++i ) {
+            for ( u32 j = 0; j < 4; ++j ) {
+                next[ i ] += covariance[ i ][ j ] * axis[ j ];
+            }
+            length += next[ i ] * next[ i ];
+        }
+        if ( length < 1e-12f ) {
+            break;
+        }
+        length = 1.f / sqrtf( length );
+        for ( u32 i = 0; i < 4; ++i ) {
+            axis[ i ] = next[ i ] * length;
+        }
+    }
+
+    f32 t_min = FLT_MAX, t_max = -FLT_MAX;
+    for ( u32 t = 0; t < 16; ++t ) {
+        f32 projection = 0.f;
+        for ( u32 c = 0; c < 4; ++c ) {
+            projection += ( texels[ t * 4 + c ] - mean[ c ] ) * axis[ c ];
+        }
+        t_min = projection < t_min ? projection : t_min;
+        t_max = projection > t_max ? projection : t_max;
+    }
+
+    f32 e0[ 4 ], e1[ 4 ];
+    for ( u32 c = 0; c < 4; ++c ) {
+        e0[ c ] = mean[ c ] + axis[ c ] * t_min;
+        e1[ c ] = mean[ c ] + axis[ c ] * t_max;
+    }
+
+    Bc7Endpoints endpoints;
+    u8 indices[ 16 ];
+    u32 error = bc7_fit_endpoints( texels, e0, e1, endpoints, indices, UINT32_MAX );
+
+    // One least squares refinement of the endpoints, given the chosen weights.
+    if ( error > 0 ) {
+        f32 aa = 0.f, ab = 0.f, bb = 0.f;
+        f32 ax[ 4 ]{ }, bx[ 4 ]{ };
+        for ( u32 t = 0; t < 16; ++t ) {
+            const f32 b = k_bc7_weights[ indices[ t ] ] / 64.f;
+            const f32 a = 1.f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for ( u32 c = 0; c < 4; ++c ) {
+                ax[ c ] += a * texels[ t * 4 + c ];
+                bx[ c ] += b * texels[ t * 4 + c ];
+            }
+        }
+
+        const f32 determinant = aa * bb - ab * ab;
+        if ( fabsf( determinant ) > 1e-6f ) {
+            for ( u32 c = 0; c < 4; ++c ) {
+                e0[ c ] = ( ax[ c ] * bb - bx[ c ] * ab ) / determinant;
+                e1[ c ] = ( bx[ c ] * aa - ax[ c ] * ab ) / determinant;
+                e0[ c ] = e0[ c ] < 0.f ? 0.f : ( e0[ c ] > 255.f ? 255.f : e0[ c ] );
+                e1[ c ] = e1[ c ] < 0.f ? 0.f : ( e1[ c ] > 255.f ? 255.f : e1[ c ] );
+            }
+            error = bc7_fit_endpoints( texels, e0, e1, endpoints, indices, error );
+        }
+    }
+
+    // The most significant bit of the first index is implicit zero: swap the endpoints if needed.
+    if ( indices[ 0 ] & 8 ) {
+        for ( u32 c = 0; c < 4; ++c ) {
+            const u32 color = endpoints.colors[ 0 ][ c ];
+            endpoints.colors[ 0 ][ c ] = endpoints.colors[ 1 ][ c ];
+            endpoints.colors[ 1 ][ c ] = color;
+        }
+        const u32 p_bit = endpoints.p_bits[ 0 ];
+        endpoints.p_bits[ 0 ] = endpoints.p_bits[ 1 ];
+        endpoints.p_bits[ 1 ] = p_bit;
+
+        for ( u32 t = 0; t < 16; ++t ) {
+            indices[ t ] = 15 - indices[ t ];
+        }
+    }
+
+    u64 bits[ 2 ]{ };
+    u32 position = 0;
+    bc7_write_bits( bits, position, 1 << 6, 7 );
+    for ( u32 c = 0; c < 4; ++c ) {
+        bc7_write_bits( bits, position, endpoints.colors[ 0 ][ c ], 7 );
+        bc7_write_bits( bits, position, endpoints.colors[ 1 ][ c ], 7 );
+    }
+    bc7_write_bits( bits, position, endpoints.p_bits[ 0 ], 1 );
+    bc7_write_bits( bits, position, endpoints.p_bits[ 1 ], 1 );
+    bc7_write_bits( bits, position, indices[ 0 ], 3 );
+    for ( u32 t = 1; t < 16; ++t ) {
+        bc7_write_bits( bits, position, indices[ t ], 4 );
+    }
+    RASSERT( position == 128 );
+
+    memcpy( out_block, bits, 16 );
+}
+
+// TextureCompressTask ////////////////////////////////////////////////////
+
+void TextureCompressTask::ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) {
+    ZoneScoped;
+
+    const VkFormat format = texture_usage_format( usage );
+    const u32 bytes = TextureFormat::block_size( format );
+    const u32 blocks_x = ( width + 3 ) / 4;
+
+    for ( u32 block_y = range_.start; block_y < range_.end; ++block_y ) {
+        for ( u32 block_x = 0; block_x < blocks_x; ++block_x ) {
+            // Texels past the border repeat the last row and column.
+            u8 block_texels[ 16 * 4 ];
+            for ( u32 y = 0; y < 4; ++y ) {
+                const u32 texel_y = min( block_y * 4 + y, height - 1 );
+                for ( u32 x = 0; x < 4; ++x ) {
+                    const u32 texel_x = min( block_x * 4 + x, width - 1 );
+                    memcpy( &block_texels[ ( y * 4 + x ) * 4 ], &texels[ ( texel_y * width + texel_x ) * 4 ], 4 );
+                }
+            }
+
+            u8* block = blocks + ( ( u64 )block_y * blocks_x + block_x ) * bytes;
+            switch ( usage ) {
+                case TextureUsage::Normal:
+                    bc5_encode_block( block_texels, block );
+                    break;
+                case TextureUsage::Mask:
+                    bc4_encode_block( block_texels, 0, block );
+                    break;
+                default:
+                    bc7_encode_block( block_texels, block );
+                    break;
+            }
+        }
+    }
+}
+
+// Texture cooking ////////////////////////////////////////////////////////
+
+static void downsample( const u8* source, u32 width, u32 height, u8* destination, u32 destination_width, u32 destination_height, bool normals ) {
+    for ( u32 y = 0; y < destination_height; ++y ) {
+        const u32 y0 = min( y * 2, height - 1 ), y1 = min( y * 2 + 1, height - 1 );
+        for ( u32 x = 0; x < destination_width; ++x ) {
+            const u32 x0 = min( x * 2, width - 1 ), x1 = min( x * 2 + 1, width - 1 );
+            const u8* samples[ 4 ] = { &source[ ( y0 * width + x0 ) * 4 ], &source[ ( y0 * width + x1 ) * 4 ],
+                                       &source[ ( y1 * width + x0 ) * 4 ], &source[ ( y1 * width + x1 ) * 4 ] };
+
+            f32 sum[ 4 ]{ };
+            for ( u32 s = 0; s < 4; ++s ) {
+                for ( u32 c = 0; c < 4; ++c ) {
+                    sum[ c ] += samples[ s ][ c ];
+                }
+            }
+
+            u8* texel = &destination[ ( y * destination_width + x ) * 4 ];
+            if ( normals ) {
+                // Average the vectors, then bring them back to unit length.
+                f32 n[ 3 ], length = 0.f;
+                for ( u32 c = 0; c < 3; ++c ) {
+                    n[ c ] = sum[ c ] / ( 4.f * 127.5f ) - 1.f;
+                    length += n[ c ] * n[ c ];
+                }
+                length = length > 1e-8f ? 1.f / sqrtf( length ) : 0.f;
+                for ( u32 c = 0; c < 3; ++c ) {
+                    texel[ c ] = ( u8 )( ( n[ c ] * length + 1.f ) * 127.5f + 0.5f );
+                }
+                texel[ 3 ] = ( u8 )( sum[ 3 ] * 0.25f + 0.5f );
+            } else {
+                for ( u32 c = 0; c < 4; ++c ) {
+                    texel[ c ] = ( u8 )( sum[ c ] * 0.25f + 0.5f );
+                }
+            }
+        }
+    }
+}
+
+bool texture_cook( const u8* texels, u32 width, u32 height, TextureUsage::Enum usage, cstring out_path, Allocator* allocator, enki::TaskScheduler* task_scheduler ) {
+    ZoneScoped;
+
+    const VkFormat format = texture_usage_format( usage );
+
+    u32 level_count = 1;
+    while ( level_count < k_ktx2_max_levels && ( ( width >> level_count ) || ( height >> level_count ) ) ) {
+        ++level_count;
+    }
+
+    const u32 sample_count = usage == TextureUsage::Normal ? 2 : 1;
+    const u32 dfd_offset = k_ktx2_header_size + level_count * k_ktx2_level_entry_size;
+    const u32 dfd_size = 4 + 24 + 16 * sample_count;
+
+    // Smallest levels first, each aligned to the block size.
+    u64 level_offsets[ k_ktx2_max_levels ], level_sizes[ k_ktx2_max_levels ];
+    u64 file_size = memory_align( dfd_offset + dfd_size, 16 );
+    for ( i32 level = level_count - 1; level >= 0; --level ) {
+        level_sizes[ level ] = TextureFormat::block_compressed_size( format, max( width >> level, 1u ), max( height >> level, 1u ) );
+        level_offsets[ level ] = file_size;
+        file_size = memory_align( file_size + level_sizes[ level ], 16 );
+    }
+
+    u8* file_data = ( u8* )ralloca( file_size, allocator );
+    memset( file_data, 0, file_size );
+
+    memcpy( file_data, k_ktx2_identifier, sizeof( k_ktx2_identifier ) );
+    const u32 header[ 9 ] = { ( u32 )format, 1, width, height, 0, 0, 1, level_count, 0 };
+    memcpy( file_data + 12, header, sizeof( header ) );
+    // Index: data format descriptor, no key values nor supercompression data.
+    const u32 index[ 4 ] = { dfd_offset, dfd_size, 0, 0 };
+    memcpy( file_data + 48, index, sizeof( index ) );
+
+    for ( u32 level = 0; level < level_count; ++level ) {
+        const u64 entry[ 3 ] = { level_offsets[ level ], level_sizes[ level ], level_sizes[ level ] };
+        memcpy( file_data + k_ktx2_header_size + level * k_ktx2_level_entry_size, entry, sizeof( entry ) );
+    }
+    ktx2_write_dfd( file_data + dfd_offset, format );
+
+    const u8* level_texels = texels;
+    u8* mip_texels = nullptr;
+    u32 level_width = width, level_height = height;
+
+    for ( u32 level = 0; level < level_count; ++level ) {
+        if ( level > 0 ) {
+            const u32 mip_width = max( level_width / 2, 1u ), mip_height = max( level_height / 2, 1u );
+            u8* next_texels = ( u8* )ralloca( ( sizet )mip_width * mip_height * 4, allocator );
+            downsample( level_texels, level_width, level_height, next_texels, mip_width, mip_height, usage == TextureUsage::Normal );
+
+            if ( mip_texels ) {
+                rfree( mip_texels, allocator );
+            }
+            level_texels = mip_texels = next_texels;
+            level_width = mip_width;
+            level_height = mip_height;
+        }
+
+        TextureCompressTask compress_task;
+        compress_task.texels = level_texels;
+        compress_task.blocks = file_data + level_offsets[ level ];
+        compress_task.width = level_width;
+        compress_task.height = level_height;
+        compress_task.usage = usage;
+        compress_task.m_SetSize = ( level_height + 3 ) / 4;
+
+        if ( task_scheduler ) {
+            task_scheduler->AddTaskSetToPipe( &compress_task );
+            task_scheduler->WaitforTask( &compress_task );
+        } else {
+            compress_task.ExecuteRange( { 0, compress_task.m_SetSize }, 0 );
+        }
+    }
+
+    if ( mip_texels ) {
+        rfree( mip_texels, allocator );
+    }
+
+    bool written = false;
+    FILE* file = fopen( out_path, "wb" );
+    if ( file ) {
+        written = fwrite( file_data, file_size, 1, file ) == 1;
+        fclose( file );
+    }
+    if ( !written ) {
+        rprint( "Cannot write cooked texture %s\n", out_path );
+    }
+
+    rfree( file_data, allocator );
+    return written;
+}
+
+} // namespace raptor
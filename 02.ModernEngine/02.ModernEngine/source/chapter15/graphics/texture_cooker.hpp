@@ -0,0 +1,85 @@
+#pragma once
+
+#include "foundation/platform.hpp"
+
+#include "external/enkiTS/TaskScheduler.h"
+
+#include <vulkan/vulkan_core.h>
+
+namespace raptor {
+
+    struct Allocator;
+
+    // Cooked textures live next to their source image, as <image>.ktx2, with all the mips block compressed.
+    namespace TextureUsage {
+
+        enum Enum {
+            Color, Normal, Mask, Count
+        }; // enum Enum
+
+        static const char* s_value_names[] = {
+            "Color", "Normal", "Mask", "Count"
+        };
+
+    } // namespace TextureUsage
+
+    // Color: BC7, for albedo, emissive and packed metallic roughness.
+    // Normal: BC5 of the x and y, z is reconstructed when sampling.
+    // Mask: BC4 of the red channel, for occlusion.
+    VkFormat                        texture_usage_format( TextureUsage::Enum usage );
+
+    // KTX2 ///////////////////////////////////////////////////////////////
+
+    static const u32                k_ktx2_max_levels   = 16;
+
+    //
+    // Levels are stored from the smallest in the file, the level index is ordered from the base.
+    struct Ktx2Info {
+
+        VkFormat                    format          = VK_FORMAT_UNDEFINED;
+        u32                         width           = 0;
+        u32                         height          = 0;
+        u32                         level_count     = 0;
+
+        u64                         level_offsets[ k_ktx2_max_levels ];
+        u64                         level_sizes[ k_ktx2_max_levels ];
+
+    }; // struct Ktx2Info
+
+    // Reads only the header and level index. Only 2D, non supercompressed, block compressed textures are accepted.
+    bool                            ktx2_read_info( cstring path, Ktx2Info& out_info );
+    // Cooked path of an image, if it exists and is not older than the image.
+    bool                            texture_find_cooked( cstring image_path, char* out_cooked_path, u32 max_size, Ktx2Info& out_info );
+    // All the levels packed from the base, ready to be copied to a staging buffer. Released with free, as stb_image data.
+    u8*                             texture_read_cooked( cstring path, Ktx2Info& out_info, sizet* out_size );
+    // Same packing, read straight into out_data, usually mapped staging memory, sized for all the levels of info.
+    bool                            texture_read_cooked_levels( cstring path, const Ktx2Info& info, u8* out_data );
+
+    // Block compression //////////////////////////////////////////////////
+
+    // Encoders of one block of 4x4 RGBA8 texels, in rows.
+    void                            bc4_encode_block( const u8* texels, u32 channel, u8* out_block );
+    void                            bc5_encode_block( const u8* texels, u8* out_block );
+    // Mode 6 only: one subset, RGBA endpoints and 4 bits indices.
+    void                            bc7_encode_block( const u8* texels, u8* out_block );
+
+    //
+    // Compresses the rows of blocks of one mip level.
+    struct TextureCompressTask : public enki::ITaskSet {
+
+        void                        ExecuteRange( enki::TaskSetPartition range_, uint32_t threadnum_ ) override;
+
+        const u8*                   texels          = nullptr;  // RGBA8.
+        u8*                         blocks          = nullptr;
+        u32                         width           = 0;
+        u32                         height          = 0;
+        TextureUsage::Enum          usage           = TextureUsage::Color;
+
+    }; // struct TextureCompressTask
+
+    // Box filtered mips of an RGBA8 image, block compressed on the task scheduler and written as KTX2.
+    // Normal maps are renormalized at each mip.
+    bool                            texture_cook( const u8* texels, u32 width, u32 height, TextureUsage::Enum usage, cstring out_path,
+                                                  Allocator* allocator, enki::TaskScheduler* task_scheduler );
+
+} // namespace raptor
@@ -16,6 +16,8 @@
 #include "graphics/frame_graph.hpp"
 #include "graphics/asynchronous_loader.hpp"
 #include "graphics/scene_graph.hpp"
+#include "graphics/frame_pipeline.hpp"
+#include "graphics/headless_benchmark.hpp"
 #include "graphics/render_resources_loader.hpp"
 
 #include "external/cglm/struct/vec2.h"
@@ -563,22 +565,210 @@ namespace JitterType {
     cstring names[] = { "Halton", "Martin Robert R2", "Hammersley", "Interleaved Gradients"};
 } // namespace JitterType
 
+static cstring techniques[] = { "reflections.json", "ddgi.json", "ray_tracing.json",
+                                "meshlet.json", "fullscreen.json", "main.json",
+                                "pbr_lighting.json", "dof.json", "cloth.json", "debug.json",
+                                "culling.json", "volumetric_fog.json" };
+
+// Benchmark modes ////////////////////////////////////////////////////////
+
+//
+//
+struct BenchmarkModeContext {
+    raptor::Allocator*          allocator;
+    raptor::StackAllocator*     scratch_allocator;
+    enki::TaskScheduler*        task_scheduler;
+    int                         argc;
+    char**                      argv;
+
+    // Optional argument after the mode flag.
+    u32                         argument_u32( u32 default_value ) const { return argc > 2 ? ( u32 )atoi( argv[ 2 ] ) : default_value; }
+    cstring                     argument( cstring default_value ) const { return argc > 2 ? argv[ 2 ] : default_value; }
+}; // struct BenchmarkModeContext
+
+// Single pool, concurrent and malloc heaps under growing thread counts.
+static void run_heap_allocator_benchmark( const BenchmarkModeContext& context ) {
+    raptor::MemoryService::instance()->test();
+}
+
+// FlatHashMap against std::unordered_map, from 1K entries up to 1M by default.
+static void run_hash_map_benchmark( const BenchmarkModeContext& context ) {
+    raptor::hash_map_benchmark( context.argument_u32( 1000000 ) );
+}
+
+// Transient memory and barriers of the frame graphs.
+static void run_frame_graph_report( const BenchmarkModeContext& context ) {
+    cstring graph_names[] = { "graph.json", "graph_ray_tracing.json" };
+    for ( u32 i = 0; i < ArraySize( graph_names ); ++i ) {
+        char graph_path[ 512 ]{ };
+        snprintf( graph_path, 512, "%s/%s", RAPTOR_WORKING_FOLDER, graph_names[ i ] );
+
+        raptor::frame_graph_print_report( graph_path, 1920, 1080, context.scratch_allocator );
+    }
+}
+
+static void run_gltf_parse_benchmark( const BenchmarkModeContext& context ) {
+    raptor::gltf_parse_benchmark( context.argument_u32( 100000 ) );
+}
+
+static void run_cloth_joints_benchmark( const BenchmarkModeContext& context ) {
+    raptor::cloth_joints_benchmark( context.allocator, context.argument_u32( 181 ) );
+}
+
+static void run_shader_compile_benchmark( const BenchmarkModeContext& context ) {
+    char technique_paths[ ArraySize( techniques ) ][ 512 ];
+    cstring technique_path_pointers[ ArraySize( techniques ) ];
+    for ( u32 t = 0; t < ArraySize( techniques ); ++t ) {
+        snprintf( technique_paths[ t ], 512, "%s/%s", RAPTOR_SHADER_FOLDER, techniques[ t ] );
+        technique_path_pointers[ t ] = technique_paths[ t ];
+    }
+
+    raptor::shader_compile_benchmark( technique_path_pointers, ArraySize( techniques ), context.task_scheduler, context.allocator, context.scratch_allocator );
+}
+
+static void run_animation_benchmark( const BenchmarkModeContext& context ) {
+    raptor::animation_benchmark( context.allocator, context.task_scheduler, context.argument_u32( 4000 ) );
+}
+
+static void run_skinning_benchmark( const BenchmarkModeContext& context ) {
+    raptor::skinning_benchmark( context.allocator );
+}
+
+static void run_scene_graph_benchmark( const BenchmarkModeContext& context ) {
+    if ( context.argc > 2 ) {
+        raptor::scene_graph_benchmark( context.allocator, context.task_scheduler, context.argument_u32( 0 ) );
+    } else {
+        raptor::scene_graph_benchmark( context.allocator, context.task_scheduler, 100000 );
+        raptor::scene_graph_benchmark( context.allocator, context.task_scheduler, 1000000 );
+    }
+}
+
+static void run_cloth_benchmark( const BenchmarkModeContext& context ) {
+    raptor::cloth_solver_benchmark( context.allocator, context.task_scheduler );
+}
+
+static void run_light_clustering_benchmark( const BenchmarkModeContext& context ) {
+    raptor::light_clustering_benchmark( context.allocator, context.task_scheduler );
+}
+
+static void run_frame_pipeline_benchmark( const BenchmarkModeContext& context ) {
+    raptor::frame_pipeline_benchmark( context.allocator, context.task_scheduler, context.argument_u32( 1000 ) );
+}
+
+// The scene images are relative to the scene folder.
+static void run_gltf_load_benchmark( const BenchmarkModeContext& context ) {
+    using namespace raptor;
+
+    cstring scene_path = context.argument( kDefault3DModel );
+    sizet scene_path_len = strlen( scene_path );
+
+    char file_base_path[ 512 ]{ };
+    memcpy( file_base_path, scene_path, scene_path_len );
+    file_directory_from_path( file_base_path );
+
+    char file_name[ 512 ]{ };
+    memcpy( file_name, scene_path, scene_path_len );
+    file_name_from_path( file_name );
+
+    Directory cwd{ };
+    directory_current( &cwd );
+    directory_change( file_base_path );
+
+    gltf_scene_load_benchmark( file_name, context.allocator, context.task_scheduler );
+
+    directory_change( cwd.path );
+}
+
+//
+// Command line modes that print their results and exit, without creating a window or a device.
+struct BenchmarkMode {
+    cstring                     flag;
+    cstring                     usage;
+    void                        ( *run )( const BenchmarkModeContext& context );
+}; // struct BenchmarkMode
+
+static const BenchmarkMode k_benchmark_modes[] = {
+    { "--heap-allocator-benchmark",     "",                 run_heap_allocator_benchmark },
+    { "--hash-map-benchmark",           "[max entries]",    run_hash_map_benchmark },
+    { "--frame-graph-report",           "",                 run_frame_graph_report },
+    { "--shader-compile-benchmark",     "",                 run_shader_compile_benchmark },
+    { "--gltf-parse-benchmark",         "[max nodes]",      run_gltf_parse_benchmark },
+    { "--gltf-load-benchmark",          "[glTF model]",     run_gltf_load_benchmark },
+    { "--animation-benchmark",          "[characters]",     run_animation_benchmark },
+    { "--skinning-benchmark",           "",                 run_skinning_benchmark },
+    { "--scene-graph-benchmark",        "[nodes]",          run_scene_graph_benchmark },
+    { "--cloth-joints-benchmark",       "[max grid size]",  run_cloth_joints_benchmark },
+    { "--cloth-benchmark",              "",                 run_cloth_benchmark },
+    { "--light-clustering-benchmark",   "",                 run_light_clustering_benchmark },
+    { "--frame-pipeline-benchmark",     "[characters]",     run_frame_pipeline_benchmark },
+};
+
+static const BenchmarkMode* find_benchmark_mode( cstring flag ) {
+    for ( u32 i = 0; i < ArraySize( k_benchmark_modes ); ++i ) {
+        if ( strcmp( flag, k_benchmark_modes[ i ].flag ) == 0 ) {
+            return &k_benchmark_modes[ i ];
+        }
+    }
+    return nullptr;
+}
+
+// Parses the value of a command line option in 1..max_value, invalid values are reported and value is kept.
+static void parse_u32_option( cstring option, cstring value_string, u32 max_value, u32& value ) {
+    char* value_end = nullptr;
+    const long parsed = strtol( value_string, &value_end, 10 );
+    if ( value_end == value_string || *value_end != 0 || parsed < 1 || parsed > ( long )max_value ) {
+        printf( "Invalid %s '%s', expected 1 to %u, using %u.\n", option, value_string, max_value, value );
+        return;
+    }
+    value = ( u32 )parsed;
+}
+
 //
 //
 int main( int argc, char** argv ) {
 
     if ( argc < 2 ) {
-        printf( "Usage: chapter15 [path to glTF model]\n");
+        printf( "Usage: chapter15 [path to glTF model] [--frames-in-flight frame pipeline depth] [--max-lights clustered light count]\n");
+        printf( "       chapter15 --headless [path to glTF model] [frames] [camera path json] [results json]\n");
+        for ( u32 i = 0; i < ArraySize( k_benchmark_modes ); ++i ) {
+            printf( "       chapter15 %s %s\n", k_benchmark_modes[ i ].flag, k_benchmark_modes[ i ].usage );
+        }
         InjectDefault3DModel();
     }
 
     using namespace raptor;
 
+    // Offscreen rendering of a camera path with fixed time steps, timings and memory are written as json.
+    const bool headless = strcmp( argv[ 1 ], "--headless" ) == 0;
+    if ( headless && argc < 3 ) {
+        printf( "Error: --headless needs the path of the glTF model to render.\n" );
+        return -1;
+    }
+    const u32 headless_frames = headless && argc > 3 ? ( u32 )atoi( argv[ 3 ] ) : 600;
+    cstring headless_camera_path = headless && argc > 4 ? argv[ 4 ] : nullptr;
+    cstring headless_results_path = headless && argc > 5 ? argv[ 5 ] : "headless_benchmark.json";
+
+    // Frames simulated ahead by the frame pipeline, values out of range are reported and the default is kept.
+    u32 frames_in_flight = 2;
+    // Capacity of the clustered lights, compiled in the shaders as NUM_LIGHTS.
+    u32 max_lights = k_num_lights;
+    for ( i32 arg_i = 1; !headless && arg_i < argc; ++arg_i ) {
+        if ( strcmp( argv[ arg_i ], "--frames-in-flight" ) == 0 ) {
+            parse_u32_option( argv[ arg_i ], arg_i + 1 < argc ? argv[ arg_i + 1 ] : "", FramePipeline::k_max_depth, frames_in_flight );
+        } else if ( strcmp( argv[ arg_i ], "--max-lights" ) == 0 ) {
+            parse_u32_option( argv[ arg_i ], arg_i + 1 < argc ? argv[ arg_i + 1 ] : "", LightClustering::k_light_clustering_max_lights, max_lights );
+        }
+    }
+
     time_service_init();
+    // Startup time is measured up to the first presented frame.
+    const i64 startup_begin_time = time_now();
 
     // Init services
     MemoryServiceConfiguration memory_configuration;
     memory_configuration.maximum_dynamic_size = rgiga( 2ull );
+    // Shared by the draw, asynchronous loading and pinned IO tasks.
+    memory_configuration.concurrent_system_allocator = true;
 
     MemoryService::instance()->init( &memory_configuration );
     Allocator* allocator = &MemoryService::instance()->system_allocator;
@@ -595,8 +785,24 @@ int main( int argc, char** argv ) {
 
     task_scheduler.Initialize( config );
 
+    const BenchmarkMode* benchmark_mode = argc > 1 ? find_benchmark_mode( argv[ 1 ] ) : nullptr;
+    if ( benchmark_mode ) {
+        BenchmarkModeContext context{ allocator, &scratch_allocator, &task_scheduler, argc, argv };
+        benchmark_mode->run( context );
+
+        task_scheduler.WaitforAllAndShutdown();
+        scratch_allocator.shutdown();
+        MemoryService::instance()->shutdown();
+
+        return 0;
+    }
+
+    // Per frame transient memory, one arena for each frame in flight.
+    FrameArenaRing frame_arenas;
+    frame_arenas.init( k_max_frames, rmega( 256 ) );
+
     // window
-    WindowConfiguration wconf{ 1280, 800, "Raptor Chapter 15: RT Reflections", &MemoryService::instance()->system_allocator};
+    WindowConfiguration wconf{ 1280, 800, "Raptor Chapter 15: RT Reflections", &MemoryService::instance()->system_allocator, headless };
     raptor::Window window;
     window.init( &wconf );
 
@@ -607,9 +813,17 @@ int main( int argc, char** argv ) {
     window.register_os_messages_callback( input_os_messages_callback, &input );
 
     // graphics
+    char pipeline_cache_path[ 512 ];
+    snprintf( pipeline_cache_path, 512, "%s/shaders/pipeline_cache.bin", RAPTOR_DATA_FOLDER );
+
     GpuDeviceCreation dc;
-    dc.set_window( window.width, window.height, window.platform_handle ).set_allocator( &MemoryService::instance()->system_allocator )
-      .set_num_threads( task_scheduler.GetNumTaskThreads() ).set_linear_allocator( &scratch_allocator );
+    dc.set_allocator( &MemoryService::instance()->system_allocator ).set_num_threads( task_scheduler.GetNumTaskThreads() )
+      .set_linear_allocator( &scratch_allocator ).set_pipeline_cache_path( pipeline_cache_path );
+    if ( headless ) {
+        dc.set_headless( window.width, window.height );
+    } else {
+        dc.set_window( window.width, window.height, window.platform_handle );
+    }
     // Allocate specific resource pool sizes
     dc.resource_pool_creation.buffers = 512;
     dc.resource_pool_creation.descriptor_set_layouts = 256;
@@ -662,6 +876,8 @@ int main( int argc, char** argv ) {
         }
     }
     strcpy( renderer.resource_cache.binary_data_folder, shader_binaries_folder );
+    gpu.shader_compiler.set_cache_folder( shader_binaries_folder );
+    gpu.shader_compiler.add_define( "NUM_LIGHTS", max_lights );
     temporary_name_buffer.clear();
 
     SceneGraph scene_graph;
@@ -675,7 +891,14 @@ int main( int argc, char** argv ) {
     directory_current(&cwd);
 
     RenderScene* scene = nullptr;
-    for ( i32 arg_i = 1; arg_i < argc; ++arg_i ) {
+    const i32 last_scene_arg = headless ? 3 : argc;
+    for ( i32 arg_i = headless ? 2 : 1; arg_i < last_scene_arg; ++arg_i ) {
+        // Options and their values are not scenes.
+        if ( strcmp( argv[ arg_i ], "--frames-in-flight" ) == 0 || strcmp( argv[ arg_i ], "--max-lights" ) == 0 ) {
+            ++arg_i;
+            continue;
+        }
+
         cstring scene_path = argv[ arg_i ];
         sizet scene_path_len = strlen( argv[ arg_i ] );
 
@@ -693,11 +916,12 @@ int main( int argc, char** argv ) {
 
         if ( scene == nullptr ) {
             // TODO(marco): further refactor to allow different formats
-            if ( strcmp( file_extension, "gltf" ) == 0 ) {
+            if ( strcmp( file_extension, "gltf" ) == 0 || strcmp( file_extension, "glb" ) == 0 ) {
                 scene = new glTFScene;
             } else if ( strcmp( file_extension, "obj" ) == 0 ) {
                 scene = new ObjScene;
             }
+            scene->max_lights = max_lights;
             scene->init( &scene_graph, allocator, &renderer );
             scene->use_meshlets = gpu.mesh_shaders_extension_present;
             scene->use_meshlets_emulation = !scene->use_meshlets;
@@ -714,6 +938,7 @@ int main( int argc, char** argv ) {
 
     FrameGraph frame_graph;
     frame_graph.init( &frame_graph_builder );
+    frame_graph.recording_plan.task_scheduler = &task_scheduler;
 
     if ( gpu.fragment_shading_rate_present )
     {
@@ -730,12 +955,23 @@ int main( int argc, char** argv ) {
     }
 
     static bool use_shader_cache = true;
-    static cstring techniques[] = { "reflections.json", "ddgi.json", "ray_tracing.json",
-                                    "meshlet.json", "fullscreen.json", "main.json",
-                                    "pbr_lighting.json", "dof.json", "cloth.json", "debug.json",
-                                    "culling.json", "volumetric_fog.json" };
-
     static bool changed_techniques[ ArraySize( techniques ) ];
+
+    // Preprocesses every technique and compiles the stages missing from the cache in parallel,
+    // so that the serial technique creation below only reads cached SpirV.
+    auto compile_all_techniques = [ & ]() {
+        if ( !use_shader_cache ) {
+            return;
+        }
+
+        char technique_paths[ ArraySize( techniques ) ][ 512 ];
+        cstring technique_path_pointers[ ArraySize( techniques ) ];
+        for ( u32 t = 0; t < ArraySize( techniques ); ++t ) {
+            snprintf( technique_paths[ t ], 512, "%s/%s", RAPTOR_SHADER_FOLDER, techniques[ t ] );
+            technique_path_pointers[ t ] = technique_paths[ t ];
+        }
+        render_resources_loader.compile_gpu_techniques( technique_path_pointers, ArraySize( techniques ), &task_scheduler, allocator );
+    };
     // Single Gpu Technique parsing.
     auto load_technique = [ & ]( cstring technique_name, bool& shader_changed ) {
         temporary_name_buffer.clear();
@@ -750,18 +986,27 @@ int main( int argc, char** argv ) {
     };
 
     // Gpu Technique collection parsing
+    // Pipelines of all techniques are created together on the task scheduler.
     auto load_all_techniques = [ & ]() {
+        compile_all_techniques();
+
+        gpu.begin_pipeline_batch();
         const sizet num_techniques = ArraySize( techniques );
         for ( sizet t = 0; t < num_techniques; ++t ) {
             load_technique( techniques[ t ], changed_techniques[ t ] );
         }
+        gpu.end_pipeline_batch( &task_scheduler );
     };
 
     auto reload_all_techniques = [ & ]() {
+        compile_all_techniques();
+
+        gpu.begin_pipeline_batch();
         const sizet num_techniques = ArraySize( techniques );
         for ( sizet t = 0; t < num_techniques; ++t ) {
             reload_technique( techniques[ t ], changed_techniques[ t ] );
         }
+        gpu.end_pipeline_batch( &task_scheduler );
     };
 
     TextureResource* dither_texture = nullptr;
@@ -776,7 +1021,7 @@ int main( int argc, char** argv ) {
 
         // TODO: improve
         // Manually add point shadows texture format.
-        FrameGraphNode* point_shadows_pass_node = frame_graph.get_node( "point_shadows_pass" );
+        FrameGraphNode* point_shadows_pass_node = frame_graph.get_node( rhash( "point_shadows_pass" ) );
         if ( point_shadows_pass_node ) {
             RenderPass* render_pass = gpu.access_render_pass( point_shadows_pass_node->render_pass );
             if ( render_pass ) {
@@ -785,12 +1030,12 @@ int main( int argc, char** argv ) {
         }
 
         // Cache frame graph resources in scene
-        FrameGraphResource* resource = frame_graph.get_resource( "motion_vectors" );
+        FrameGraphResource* resource = frame_graph.get_resource( rhash( "motion_vectors" ) );
         if ( resource ) {
             scene->motion_vector_texture = resource->resource_info.texture.handle;
         }
 
-        resource = frame_graph.get_resource( "visibility_motion_vectors" );
+        resource = frame_graph.get_resource( rhash( "visibility_motion_vectors" ) );
         if ( resource ) {
             scene->visibility_motion_vector_texture = resource->resource_info.texture.handle;
         }
@@ -1006,6 +1251,35 @@ int main( int argc, char** argv ) {
     StringBuffer texture_names_pool;
     texture_names_pool.init( rkilo( 8 ), allocator );
 
+    // Animations of the next frames are simulated while the current one is recorded.
+    FramePipeline frame_pipeline;
+    frame_pipeline.init( allocator, frames_in_flight );
+
+    // Recorded in the Camera Path window, replayed by headless runs.
+    char camera_path_save_path[ 512 ];
+    snprintf( camera_path_save_path, 512, "%s/camera_path.json", RAPTOR_DATA_FOLDER );
+
+    CameraPath camera_path;
+    camera_path.init( allocator );
+
+    HeadlessBenchmark headless_benchmark;
+    f32 headless_time = 0.f;
+    if ( headless ) {
+        headless_benchmark.init( allocator, headless_frames );
+
+        if ( headless_camera_path == nullptr || !camera_path.load( headless_camera_path, &scratch_allocator ) ) {
+            // The orbit frames the scene bounds, so that runs on different scenes are comparable.
+            scene_graph.update_matrices( &task_scheduler );
+
+            vec3s orbit_center{ 0.f, 1.f, 0.f };
+            f32 scene_radius = 3.f;
+            scene->get_world_bounding_sphere( orbit_center, scene_radius );
+
+            // Twice the radius keeps the whole sphere in a 60 degrees field of view.
+            camera_path.generate_orbit( orbit_center, scene_radius * 2.f, scene_radius * 0.5f, headless_frames / 60.f, 17 );
+        }
+    }
+
     while ( !window.requested_exit ) {
         ZoneScopedN("RenderLoop");
 
@@ -1014,12 +1288,18 @@ int main( int argc, char** argv ) {
             gpu.new_frame();
 
             static bool one_time_check = true;
-            if ( async_loader.file_load_requests.size == 0 && one_time_check ) {
+            if ( async_loader.is_idle() && one_time_check ) {
                 one_time_check = false;
                 rprint( "Finished uploading textures in %f seconds\n", time_from_seconds( absolute_begin_frame_tick ) );
             }
         }
 
+        // Safe to reuse: the frame that last used this arena has been waited on by new_frame.
+        VirtualArenaAllocator* frame_allocator = frame_arenas.begin_frame( gpu.current_frame );
+
+        // Animation state can be read and edited from here, the simulation kicked last frame is done.
+        frame_pipeline.begin_frame();
+
         window.handle_os_messages();
         input.new_frame();
 
@@ -1038,11 +1318,29 @@ int main( int argc, char** argv ) {
         const i64 current_tick = time_now();
         f32 delta_time = ( f32 )time_delta_seconds( begin_frame_tick, current_tick );
         begin_frame_tick = current_tick;
+        frame_pipeline.add_time( FramePipelineStage::Frame, delta_time * 1000.0 );
+
+        // Headless frames are measured once loading is done, and step the same for every run.
+        const bool benchmark_frame = headless && async_loader.is_idle();
+        if ( headless ) {
+            delta_time = 1.f / 60.f;
+        }
+
+        i64 update_start = time_now();
 
         input.update( delta_time );
         game_camera.update( &input, window.width, window.height, delta_time );
         window.center_mouse( game_camera.mouse_dragging );
 
+        if ( benchmark_frame ) {
+            headless_benchmark.begin_frame();
+
+            camera_path.apply( game_camera, headless_time );
+            headless_time += delta_time;
+
+            headless_benchmark.add_cpu_time( BenchmarkCpuStage::Update, time_from_milliseconds( update_start ) );
+        }
+
         static f32 animation_speed_multiplier = 0.05f;
         static bool enable_frustum_cull_meshes = true;
         static bool enable_frustum_cull_meshlets = true;
@@ -1138,6 +1436,7 @@ int main( int argc, char** argv ) {
                     ImGui::InputFloat( "Spring stiffness", &spring_stiffness );
                     ImGui::InputFloat( "Spring damping", &spring_damping );
                     ImGui::Checkbox( "Reset simulation", &reset_simulation );
+                    ImGui::Checkbox( "Simulate on CPU", &scene->physics_on_cpu );
                 }
 
                 if ( ImGui::CollapsingHeader( "Math tests" ) ) {
@@ -1149,7 +1448,7 @@ int main( int argc, char** argv ) {
 
                 // Light editing
                 if ( ImGui::CollapsingHeader( "Lights" ) ) {
-                    ImGui::SliderUint( "Active Lights", &scene->active_lights, 1, k_num_lights - 1 );
+                    ImGui::SliderUint( "Active Lights", &scene->active_lights, 1, scene->max_lights - 1 );
                     ImGui::SliderUint( "Light Index", &light_to_debug, 0, scene->active_lights - 1 );
 
                     Light& selected_light = scene->lights[ light_to_debug ];
@@ -1352,9 +1651,21 @@ int main( int argc, char** argv ) {
 
                 ImGui::Checkbox( "Show Debug GPU Draws", &scene->show_debug_gpu_draws );
                 ImGui::Checkbox( "Dynamically recreate descriptor sets", &recreate_per_thread_descriptors );
-                ImGui::Checkbox( "Use secondary command buffers", &use_secondary_command_buffers );
+                ImGui::Checkbox( "Use secondary command buffers", &frame_graph.parallel_recording );
                 ImGui::Separator();
                 ImGui::SliderFloat( "Animation Speed Multiplier", &animation_speed_multiplier, 0.0f, 10.0f );
+                for ( u32 p = 0; p < scene->animation_system.poses.size; ++p ) {
+                    AnimationPose& pose = scene->animation_system.poses[ p ];
+                    for ( u32 i = 0; i < pose.instances.size; ++i ) {
+                        AnimationInstance& instance = pose.instances[ i ];
+
+                        ImGui::PushID( &instance );
+                        ImGui::Text( "Pose %u, animation %u", p, instance.animation );
+                        ImGui::SliderFloat( "Weight", &instance.weight, 0.0f, 1.0f );
+                        ImGui::SliderFloat( "Speed", &instance.speed, 0.0f, 4.0f );
+                        ImGui::PopID();
+                    }
+                }
                 ImGui::Separator();
 
                 static bool fullscreen = false;
@@ -1373,6 +1684,9 @@ int main( int argc, char** argv ) {
 
             if ( ImGui::Begin( "Scene" ) ) {
 
+                scene->upload_stats.debug_ui();
+                ImGui::Separator();
+
                 static u32 selected_node = u32_max;
 
                 ImGui::Text( "Selected node %u", selected_node );
@@ -1405,6 +1719,16 @@ int main( int argc, char** argv ) {
             }
             ImGui::End();
 
+            if ( ImGui::Begin( "Memory" ) ) {
+                frame_arenas.debug_ui();
+            }
+            ImGui::End();
+
+            if ( ImGui::Begin( "Asynchronous Loader" ) ) {
+                async_loader.debug_ui();
+            }
+            ImGui::End();
+
             if ( ImGui::Begin( "GPU Profiler" ) ) {
                 ImGui::Text( "Cpu Time %fms", delta_time * 1000.f );
                 gpu_profiler.imgui_draw();
@@ -1412,6 +1736,16 @@ int main( int argc, char** argv ) {
             }
             ImGui::End();
 
+            if ( ImGui::Begin( "Frame Pipeline" ) ) {
+                frame_pipeline.debug_ui();
+            }
+            ImGui::End();
+
+            if ( ImGui::Begin( "Camera Path" ) ) {
+                camera_path.debug_ui( game_camera, camera_path_save_path );
+            }
+            ImGui::End();
+
             if ( ImGui::Begin( "Frame Graph Debug" ) ) {
 
                 frame_graph.debug_ui();
@@ -1477,17 +1811,24 @@ int main( int argc, char** argv ) {
             }
             ImGui::End();
         }
+        // UI recording is not part of the update timing.
+        update_start = time_now();
         {
             ZoneScopedN( "AnimationsUpdate" );
-            scene->update_animations( delta_time * animation_speed_multiplier );
+            scene->update_animations( &frame_pipeline, delta_time * animation_speed_multiplier, &task_scheduler );
         }
         {
             ZoneScopedN( "SceneGraphUpdate" );
-            scene_graph.update_matrices();
+            scene_graph.update_matrices( &task_scheduler );
         }
         {
             ZoneScopedN( "JointsUpdate" );
-            scene->update_joints();
+            scene->update_joints( &task_scheduler );
+        }
+
+        const i64 upload_start = time_now();
+        if ( benchmark_frame ) {
+            headless_benchmark.add_cpu_time( BenchmarkCpuStage::Update, time_from_milliseconds( update_start ) );
         }
 
         {
@@ -1524,14 +1865,14 @@ int main( int argc, char** argv ) {
             scene_data.forced_metalness = scene->forced_metalness;
             scene_data.forced_roughness = scene->forced_roughness;
 
-            FrameGraphResource* depth_resource = ( FrameGraphResource* )frame_graph.get_resource( "depth" );
+            FrameGraphResource* depth_resource = ( FrameGraphResource* )frame_graph.get_resource( rhash( "depth" ) );
             if ( depth_resource ) {
                 scene_data.depth_texture_index = depth_resource->resource_info.texture.handle.index;
             }
 
             scene_data.blue_noise_128_rg_texture_index = blue_noise_128_rg_texture->handle.index;
             scene_data.use_tetrahedron_shadows = scene->use_tetrahedron_shadows;
-            scene_data.active_lights = scene->active_lights;
+            scene_data.active_lights = scene->get_shadow_light_count();
             scene_data.z_near = game_camera.camera.near_plane;
             scene_data.z_far = game_camera.camera.far_plane;
             scene_data.projection_00 = game_camera.camera.projection.m00;
@@ -1593,22 +1934,22 @@ int main( int argc, char** argv ) {
                 gpu_lighting_data->gi_intensity = scene->gi_intensity;
                 gpu_lighting_data->brdf_lut_texture_index = scene->brdf_lut_texture.index;
 
-                FrameGraphResource* resource = frame_graph.get_resource( "shadow_visibility" );
+                FrameGraphResource* resource = frame_graph.get_resource( rhash( "shadow_visibility" ) );
                 if ( resource ) {
                     gpu_lighting_data->shadow_visibility_texture_index = resource->resource_info.texture.handle.index;
                 }
 
-                resource = ( FrameGraphResource* )frame_graph.get_resource( "indirect_lighting" );
+                resource = ( FrameGraphResource* )frame_graph.get_resource( rhash( "indirect_lighting" ) );
                 if ( resource ) {
                     gpu_lighting_data->indirect_lighting_texture_index = resource->resource_info.texture.handle.index;
                 }
 
-                resource = ( FrameGraphResource* )frame_graph.get_resource( "bilateral_weights" );
+                resource = ( FrameGraphResource* )frame_graph.get_resource( rhash( "bilateral_weights" ) );
                 if ( resource ) {
                     gpu_lighting_data->bilateral_weights_texture_index = resource->resource_info.texture.handle.index;
                 }
 
-                resource = ( FrameGraphResource* )frame_graph.get_resource( "svgf_output" );
+                resource = ( FrameGraphResource* )frame_graph.get_resource( rhash( "svgf_output" ) );
                 if ( resource ) {
                     gpu_lighting_data->reflections_texture_index = resource->resource_info.texture.handle.index;
                 }
@@ -1646,13 +1987,14 @@ int main( int argc, char** argv ) {
                 last_clicked_position = vec2s{ input.mouse_position.x, input.mouse_position.y };
             }
 
-            UploadGpuDataContext upload_context{ game_camera, &scratch_allocator};
+            UploadGpuDataContext upload_context{ game_camera, frame_allocator };
             upload_context.enable_camera_inside = enable_camera_inside;
             upload_context.force_fullscreen_light_aabb = force_fullscreen_light_aabb;
             upload_context.skip_invisible_lights = skip_invisible_lights;
             upload_context.use_mcguire_method = use_mcguire_method;
             upload_context.use_view_aabb = use_view_aabb;
             upload_context.last_clicked_position_left_button = last_clicked_position;
+            upload_context.task_scheduler = &task_scheduler;
             frame_renderer.upload_gpu_data( upload_context );
 
             // Place light AABB with a smaller aabb to indicate the center.
@@ -1664,23 +2006,51 @@ int main( int argc, char** argv ) {
             }
         }
 
+        if ( benchmark_frame ) {
+            headless_benchmark.add_cpu_time( BenchmarkCpuStage::Upload, time_from_milliseconds( upload_start ) );
+        }
+
         if ( !window.minimized ) {
+            const i64 record_start = time_now();
+
             DrawTask draw_task;
             draw_task.init( renderer.gpu, &frame_graph, &renderer, imgui, &gpu_profiler, scene, &frame_renderer );
             task_scheduler.AddTaskSetToPipe( &draw_task );
 
+            scene->kick_animations( &frame_pipeline, delta_time * animation_speed_multiplier, &task_scheduler );
+
             CommandBuffer* async_compute_command_buffer = nullptr;
             {
                 ZoneScopedN( "PhysicsUpdate" );
-                async_compute_command_buffer = scene->update_physics( delta_time, air_density, spring_stiffness, spring_damping, wind_direction, reset_simulation );
+                async_compute_command_buffer = scene->update_physics( delta_time, air_density, spring_stiffness, spring_damping, wind_direction, reset_simulation, &task_scheduler );
                 reset_simulation = false;
             }
 
+            const i64 recording_wait_start = time_now();
             task_scheduler.WaitforTaskSet( &draw_task );
+            frame_pipeline.add_time( FramePipelineStage::RecordingWait, time_from_milliseconds( recording_wait_start ) );
+
+            const i64 submit_start = time_now();
 
             // Avoid using the same command buffer
             renderer.add_texture_update_commands( ( draw_task.thread_id + 1 ) % task_scheduler.GetNumTaskThreads() );
             gpu.present( async_compute_command_buffer );
+
+            if ( benchmark_frame ) {
+                // Recording overlaps the physics update and the simulation kick, timed together.
+                headless_benchmark.add_cpu_time( BenchmarkCpuStage::Record, time_delta_milliseconds( record_start, submit_start ) );
+                headless_benchmark.add_cpu_time( BenchmarkCpuStage::Submit, time_from_milliseconds( submit_start ) );
+                headless_benchmark.add_gpu_passes( gpu_profiler );
+                headless_benchmark.add_memory( gpu, frame_arenas );
+
+                if ( headless_benchmark.frames.size >= headless_frames ) {
+                    window.requested_exit = true;
+                }
+            }
+
+            if ( gpu.absolute_frame == 1 ) {
+                rprint( "Startup to first frame: %f seconds\n", time_from_seconds( startup_begin_time ) );
+            }
         } else {
             ImGui::Render();
         }
@@ -1688,6 +2058,16 @@ int main( int argc, char** argv ) {
         FrameMark;
     }
 
+    // Waits for the simulation still in flight.
+    frame_pipeline.begin_frame();
+    frame_pipeline.shutdown();
+
+    if ( headless ) {
+        headless_benchmark.write_json( headless_results_path, argv[ 2 ], gpu );
+        headless_benchmark.shutdown();
+    }
+    camera_path.shutdown();
+
     texture_indices.shutdown();
     texture_names.shutdown();
     texture_names_pool.shutdown();
@@ -1718,6 +2098,8 @@ int main( int argc, char** argv ) {
     frame_graph.shutdown();
     frame_graph_builder.shutdown();
 
+    render_resources_loader.shutdown();
+
     scene->shutdown( &renderer );
     frame_renderer.shutdown();
 
@@ -1730,6 +2112,7 @@ int main( int argc, char** argv ) {
     window.unregister_os_messages_callback( input_os_messages_callback );
     window.shutdown();
 
+    frame_arenas.shutdown();
     scratch_allocator.shutdown();
     MemoryService::instance()->shutdown();
 
@@ -488,7 +488,8 @@ vec3 calculate_point_light_contribution(vec4 albedo, float roughness, vec3 norma
 #endif
 
     // TODO
-    if (disable_shadows > 0) {
+    // Only the first active_lights have a shadow cubemap layer.
+    if (disable_shadows > 0 || shadow_light_index >= active_lights) {
         shadow = 1;
     }
 
@@ -591,9 +592,7 @@ vec4 calculate_lighting(vec4 base_colour, vec3 orm, vec3 normal, vec3 emissive,
 
     vec4 pos_camera_space = world_to_camera * vec4( world_position, 1.0 );
 
-    float z_light_far = z_far;
-    float linear_d = ( pos_camera_space.z - z_near ) / ( z_light_far - z_near );
-    int bin_index = int( linear_d / BIN_WIDTH );
+    int bin_index = get_light_z_bin( pos_camera_space.z, z_near, z_far );
     uint bin_value = bins[ bin_index ];
 
     uint min_light_id = bin_value & 0xFFFF;
@@ -601,8 +600,7 @@ vec4 calculate_lighting(vec4 base_colour, vec3 orm, vec3 normal, vec3 emissive,
 
     uvec2 tile = position / uint( TILE_SIZE );
 
-    uint stride = uint( NUM_WORDS ) * ( uint( resolution.x ) / uint( TILE_SIZE ) );
-    uint address = tile.y * stride + tile.x;
+    uint address = get_light_tile_address( tile, resolution );
 
 #if ENABLE_OPTIMIZATION
     // NOTE(marco): this version has been implemented following:
@@ -646,7 +644,7 @@ vec4 calculate_lighting(vec4 base_colour, vec3 orm, vec3 normal, vec3 emissive,
         }
     }
 #else
-    if ( min_light_id != NUM_LIGHTS + 1 ) {
+    if ( min_light_id <= max_light_id ) {
         for ( uint light_id = min_light_id; light_id <= max_light_id; ++light_id ) {
             uint word_id = light_id / 32;
             uint bit_id = light_id % 32;
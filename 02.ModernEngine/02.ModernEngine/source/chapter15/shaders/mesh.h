@@ -119,7 +119,10 @@ vec3 apply_pixel_normal( uint normal_texture, vec2 uv, vec3 normal, vec3 tangent
 
     if (normal_texture != INVALID_TEXTURE_INDEX) {
         // NOTE(marco): normal textures are encoded to [0, 1] but need to be mapped to [-1, 1] value
-        const vec3 bump_normal = normalize( texture(global_textures[nonuniformEXT(normal_texture)], uv).rgb * 2.0 - 1.0 );
+        // Z is reconstructed from x and y, cooked normal textures are BC5 and only store those.
+        vec3 bump_normal;
+        bump_normal.xy = texture(global_textures[nonuniformEXT(normal_texture)], uv).rg * 2.0 - 1.0;
+        bump_normal.z = sqrt( max( 1.0 - dot( bump_normal.xy, bump_normal.xy ), 0.0 ) );
         const mat3 TBN = mat3(
             tangent,
             bitangent,
@@ -1352,7 +1352,7 @@ layout (local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
 void main() {
 
     if (gl_GlobalInvocationID.x == 0 ) {
-        for ( uint i = 0; i < NUM_LIGHTS; ++i ) {
+        for ( uint i = 0; i < NUM_SHADOW_LIGHTS; ++i ) {
             per_light_meshlet_instances[i * 2] = 0;
             per_light_meshlet_instances[i * 2 + 1] = 0;
         }
@@ -1491,7 +1491,7 @@ void main() {
     if (gl_GlobalInvocationID.x == 0 ) {
 
         // Use this as atomic int
-        per_light_meshlet_instances[NUM_LIGHTS] = 0;
+        per_light_meshlet_instances[NUM_SHADOW_LIGHTS] = 0;
     }
 
     global_shader_barrier();
@@ -1509,7 +1509,7 @@ void main() {
     const uint visible_meshlets = per_light_meshlet_instances[light_index];
 
     if (visible_meshlets > 0) {
-        const uint command_offset = atomicAdd(per_light_meshlet_instances[NUM_LIGHTS], 6);
+        const uint command_offset = atomicAdd(per_light_meshlet_instances[NUM_SHADOW_LIGHTS], 6);
         uint packed_light_index = (light_index & 0xffff) << 16;
         meshlet_draw_commands[command_offset] = uvec4( ((visible_meshlets + 31) / 32), 1, 1, packed_light_index | 0 );
         meshlet_draw_commands[command_offset + 1] = uvec4( ((visible_meshlets + 31) / 32), 1, 1, packed_light_index | 1 );
@@ -16,8 +16,25 @@
 #define NUM_BINS 16.0
 #define BIN_WIDTH ( 1.0 / NUM_BINS )
 #define TILE_SIZE 8
+// Injected by the engine from RenderScene::max_lights, sizes the light arrays and the tile words.
+#if !defined( NUM_LIGHTS )
 #define NUM_LIGHTS 256
+#endif
 #define NUM_WORDS ( ( NUM_LIGHTS + 31 ) / 32 )
+// Lights with point shadows, as k_num_shadow_lights: the shadow passes keep resources for each of them.
+#define NUM_SHADOW_LIGHTS 256
+
+// Logarithmic depth slices between near and far, as LightClustering::get_z_bin.
+int get_light_z_bin( float view_z, float near, float far ) {
+    const float slice = log( max( view_z, near ) / near ) / log( far / near );
+    return clamp( int( slice * NUM_BINS ), 0, int( NUM_BINS ) - 1 );
+}
+
+// Light bits of a tile start at ( tile.y * tile_x_count + tile.x ) * NUM_WORDS.
+uint get_light_tile_address( uvec2 tile, vec2 resolution ) {
+    const uint tile_x_count = ( uint( resolution.x ) + TILE_SIZE - 1 ) / TILE_SIZE;
+    return ( tile.y * tile_x_count + tile.x ) * NUM_WORDS;
+}
 
 
 // Cubemap defines ///////////////////////////////////////////////////////
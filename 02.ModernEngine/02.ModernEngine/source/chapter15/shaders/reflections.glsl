@@ -232,7 +232,7 @@ void main() {
                 debug_draw_line( p_world, p_world + ( triangle_normal * 2 ), white, red );
             }
 
-            float lights_importance[ NUM_LIGHTS ];
+            float lights_importance[ NUM_SHADOW_LIGHTS ];
             float total_importance = 0.0;
 
             for ( uint l = 0; l < active_lights; ++l ) {
@@ -18,7 +18,7 @@ layout ( std140, set = MATERIAL_SET, binding = 0 ) uniform SceneConstants {
     vec3        camera_direction;
     int         current_frame;
 
-    uint        active_lights;
+    uint        active_lights;      // Lights with point shadows, up to NUM_SHADOW_LIGHTS.
     uint        use_tetrahedron_shadows;
     uint        dither_texture_index;
     float       z_near;
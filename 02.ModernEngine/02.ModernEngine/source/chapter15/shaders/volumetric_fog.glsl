@@ -228,9 +228,9 @@ void main() {
         // Read clustered lighting data
         // Calculate linear depth.
         float linear_d = froxel_coord.z * rcp_froxel_dim.z;
-        linear_d = raw_depth_to_linear_depth(linear_d, froxel_near, froxel_far) / froxel_far;
+        linear_d = raw_depth_to_linear_depth(linear_d, froxel_near, froxel_far);
         // Select bin
-        int bin_index = int( linear_d / BIN_WIDTH );
+        int bin_index = get_light_z_bin( linear_d, z_near, z_far );
         uint bin_value = bins[ bin_index ];
 
         uint min_light_id = bin_value & 0xFFFF;
@@ -240,11 +240,10 @@ void main() {
                                uint(froxel_coord.y * 1.0f / froxel_dimensions.y * resolution.y));
         uvec2 tile = position / uint( TILE_SIZE );
 
-        uint stride = uint( NUM_WORDS ) * ( uint( resolution.x ) / uint( TILE_SIZE ) );
         // Select base address
-        uint address = tile.y * stride + tile.x;
+        uint address = get_light_tile_address( tile, resolution );
 
-        if ( min_light_id != NUM_LIGHTS + 1 ) {
+        if ( min_light_id <= max_light_id ) {
             for ( uint light_id = min_light_id; light_id <= max_light_id; ++light_id ) {
                 uint word_id = light_id / 32;
                 uint bit_id = light_id % 32;
@@ -0,0 +1,197 @@
+// Offline cooking of the images of glTF scenes to KTX2, with all their mips block compressed.
+// Cooked files are written next to the images, as <image>.ktx2, where the scene loaders look for them.
+
+#include "graphics/texture_cooker.hpp"
+
+#include "foundation/file.hpp"
+#include "foundation/gltf.hpp"
+#include "foundation/log.hpp"
+#include "foundation/memory.hpp"
+#include "foundation/time.hpp"
+
+#include "external/enkiTS/TaskScheduler.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "external/stb_image.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace raptor;
+
+namespace TextureSlot {
+
+    enum Mask {
+        Color_mask = 1 << 0, Normal_mask = 1 << 1, Occlusion_mask = 1 << 2
+    }; // enum Mask
+
+} // namespace TextureSlot
+
+static void mark_texture_slot( const glTF::glTF& scene, u8* image_slots, i32 texture_index, u8 slot ) {
+    if ( texture_index < 0 || ( u32 )texture_index >= scene.textures_count ) {
+        return;
+    }
+
+    const i32 image_index = scene.textures[ texture_index ].source;
+    if ( image_index >= 0 && ( u32 )image_index < scene.images_count ) {
+        image_slots[ image_index ] |= slot;
+    }
+}
+
+// Images only used as normal maps are BC5, images only used as occlusion are BC4, the others BC7.
+// Occlusion packed with metallic roughness, as ORM textures, stays BC7 as the shaders read all the channels.
+static TextureUsage::Enum usage_from_slots( u8 slots ) {
+    if ( slots == TextureSlot::Normal_mask ) {
+        return TextureUsage::Normal;
+    }
+    if ( slots == TextureSlot::Occlusion_mask ) {
+        return TextureUsage::Mask;
+    }
+    return TextureUsage::Color;
+}
+
+static bool cook_image( cstring image_path, TextureUsage::Enum usage, bool force, Allocator* allocator, enki::TaskScheduler* task_scheduler ) {
+    char cooked_path[ 512 ];
+    Ktx2Info cooked_info;
+    if ( !force && texture_find_cooked( image_path, cooked_path, ArraySize( cooked_path ), cooked_info ) &&
+         cooked_info.format == texture_usage_format( usage ) ) {
+        rprint( "%s is up to date\n", cooked_path );
+        return true;
+    }
+    snprintf( cooked_path, ArraySize( cooked_path ), "%s.ktx2", image_path );
+
+    const i64 start_time = time_now();
+
+    int width, height, comp;
+    u8* texels = stbi_load( image_path, &width, &height, &comp, 4 );
+    if ( !texels ) {
+        rprint( "Error loading image %s\n", image_path );
+        return false;
+    }
+
+    const bool cooked = texture_cook( texels, width, height, usage, cooked_path, allocator, task_scheduler );
+    stbi_image_free( texels );
+
+    if ( cooked ) {
+        rprint( "Cooked %s, %dx%d %s, in %f ms\n", cooked_path, width, height, TextureUsage::s_value_names[ usage ], time_from_milliseconds( start_time ) );
+    }
+    return cooked;
+}
+
+static u32 cook_scene( cstring scene_path, bool force, Allocator* allocator, enki::TaskScheduler* task_scheduler ) {
+    const sizet scene_path_len = strlen( scene_path );
+
+    char file_base_path[ 512 ]{ };
+    memcpy( file_base_path, scene_path, scene_path_len );
+    file_directory_from_path( file_base_path );
+
+    char file_name[ 512 ]{ };
+    memcpy( file_name, scene_path, scene_path_len );
+    file_name_from_path( file_name );
+
+    // Image uris are relative to the scene.
+    Directory cwd{ };
+    directory_current( &cwd );
+    directory_change( file_base_path );
+
+    glTF::glTF scene = gltf_load_file( file_name );
+
+    u8* image_slots = ( u8* )ralloca( scene.images_count + 1, allocator );
+    memset( image_slots, 0, scene.images_count + 1 );
+
+    for ( u32 i = 0; i < scene.materials_count; ++i ) {
+        const glTF::Material& material = scene.materials[ i ];
+
+        if ( material.pbr_metallic_roughness ) {
+            const glTF::MaterialPBRMetallicRoughness& pbr = *material.pbr_metallic_roughness;
+            if ( pbr.base_color_texture ) {
+                mark_texture_slot( scene, image_slots, pbr.base_color_texture->index, TextureSlot::Color_mask );
+            }
+            if ( pbr.metallic_roughness_texture ) {
+                mark_texture_slot( scene, image_slots, pbr.metallic_roughness_texture->index, TextureSlot::Color_mask );
+            }
+        }
+        if ( material.emissive_texture ) {
+            mark_texture_slot( scene, image_slots, material.emissive_texture->index, TextureSlot::Color_mask );
+        }
+        if ( material.normal_texture ) {
+            mark_texture_slot( scene, image_slots, material.normal_texture->index, TextureSlot::Normal_mask );
+        }
+        if ( material.occlusion_texture ) {
+            mark_texture_slot( scene, image_slots, material.occlusion_texture->index, TextureSlot::Occlusion_mask );
+        }
+    }
+
+    u32 failed = 0;
+    for ( u32 i = 0; i < scene.images_count; ++i ) {
+        const glTF::Image& image = scene.images[ i ];
+        // Images embedded in buffers are not streamed by the loaders.
+        if ( image.uri.data == nullptr ) {
+            continue;
+        }
+
+        if ( !cook_image( image.uri.data, usage_from_slots( image_slots[ i ] ), force, allocator, task_scheduler ) ) {
+            ++failed;
+        }
+    }
+
+    rfree( image_slots, allocator );
+    gltf_free( scene );
+
+    directory_change( cwd.path );
+
+    return failed;
+}
+
+int main( int argc, char** argv ) {
+
+    if ( argc < 2 ) {
+        printf( "Usage: texture_cooker [path to glTF model] [--force]\n" );
+        printf( "       texture_cooker --image [path to image] [color|normal|mask] [--force]\n" );
+        return 1;
+    }
+
+    const bool single_image = strcmp( argv[ 1 ], "--image" ) == 0;
+    const bool force = strcmp( argv[ argc - 1 ], "--force" ) == 0;
+
+    TextureUsage::Enum image_usage = TextureUsage::Color;
+    if ( single_image ) {
+        if ( argc < 3 ) {
+            printf( "Missing image path\n" );
+            return 1;
+        }
+        if ( argc > 3 && strcmp( argv[ 3 ], "normal" ) == 0 ) {
+            image_usage = TextureUsage::Normal;
+        } else if ( argc > 3 && strcmp( argv[ 3 ], "mask" ) == 0 ) {
+            image_usage = TextureUsage::Mask;
+        }
+    }
+
+    time_service_init();
+
+    MemoryServiceConfiguration memory_configuration;
+    memory_configuration.maximum_dynamic_size = rgiga( 2ull );
+
+    MemoryService::instance()->init( &memory_configuration );
+    Allocator* allocator = &MemoryService::instance()->system_allocator;
+
+    enki::TaskScheduler task_scheduler;
+    task_scheduler.Initialize();
+
+    const i64 start_time = time_now();
+
+    u32 failed = 0;
+    if ( single_image ) {
+        failed = cook_image( argv[ 2 ], image_usage, force, allocator, &task_scheduler ) ? 0 : 1;
+    } else {
+        failed = cook_scene( argv[ 1 ], force, allocator, &task_scheduler );
+    }
+
+    rprint( "Texture cooking done in %f seconds, %u failed\n", time_from_seconds( start_time ), failed );
+
+    task_scheduler.WaitforAllAndShutdown();
+    MemoryService::instance()->shutdown();
+    time_service_shutdown();
+
+    return failed ? 1 : 0;
+}
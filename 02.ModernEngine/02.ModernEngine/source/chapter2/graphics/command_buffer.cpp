@@ -15,7 +15,7 @@ void CommandBuffer::reset() {
 
     vkResetDescriptorPool( gpu_device->vulkan_device, vk_descriptor_pool, 0 );
 
-    u32 resource_count = descriptor_sets.free_indices_head;
+    u32 resource_count = descriptor_sets.used_indices;
     for ( u32 i = 0; i < resource_count; ++i) {
         DesciptorSet* v_descriptor_set = ( DesciptorSet* )descriptor_sets.access_resource( i );
 
@@ -23,8 +23,8 @@ void CommandBuffer::reset() {
             // Contains the allocation for all the resources, binding and samplers arrays.
             rfree( v_descriptor_set->resources, gpu_device->allocator );
         }
-        descriptor_sets.release_resource( i );
     }
+    descriptor_sets.free_all_resources();
 }
 
 
@@ -18,7 +18,7 @@ void CommandBuffer::reset() {
 
     vkResetDescriptorPool( device->vulkan_device, vk_descriptor_pool, 0 );
 
-    u32 resource_count = descriptor_sets.free_indices_head;
+    u32 resource_count = descriptor_sets.used_indices;
     for ( u32 i = 0; i < resource_count; ++i) {
         DescriptorSet* v_descriptor_set = ( DescriptorSet* )descriptor_sets.access_resource( i );
 
@@ -26,8 +26,8 @@ void CommandBuffer::reset() {
             // Contains the allocation for all the resources, binding and samplers arrays.
             rfree( v_descriptor_set->resources, device->allocator );
         }
-        descriptor_sets.release_resource( i );
     }
+    descriptor_sets.free_all_resources();
 }
 
 
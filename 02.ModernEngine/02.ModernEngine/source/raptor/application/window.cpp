@@ -23,16 +23,28 @@ static f32 sdl_get_monitor_refresh() {
 void Window::init( void* configuration_ ) {
     rprint( "WindowService init\n" );
 
-    if ( SDL_Init( SDL_INIT_EVERYTHING ) != 0 ) {
+    WindowConfiguration& configuration = *( WindowConfiguration* )configuration_;
+
+    if ( SDL_Init( configuration.headless ? SDL_INIT_EVENTS : SDL_INIT_EVERYTHING ) != 0 ) {
         rprint( "SDL Init error: %s\n", SDL_GetError() );
         return;
     }
 
+    // Callbacks
+    os_messages_callbacks.init( configuration.allocator, 4 );
+    os_messages_callbacks_data.init( configuration.allocator, 4 );
+
+    if ( configuration.headless ) {
+        width = configuration.width;
+        height = configuration.height;
+
+        rprint( "Headless window %ux%u\n", width, height );
+        return;
+    }
+
     SDL_DisplayMode current;
     SDL_GetCurrentDisplayMode( 0, &current );
 
-    WindowConfiguration& configuration = *( WindowConfiguration* )configuration_;
-
     SDL_WindowFlags window_flags = ( SDL_WindowFlags )( SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI );
 
     window = SDL_CreateWindow( configuration.name, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, configuration.width, configuration.height, window_flags );
@@ -48,10 +60,6 @@ void Window::init( void* configuration_ ) {
     // Assing this so it can be accessed from outside.
     platform_handle = window;
 
-    // Callbacks
-    os_messages_callbacks.init( configuration.allocator, 4 );
-    os_messages_callbacks_data.init( configuration.allocator, 4 );
-
     display_refresh = sdl_get_monitor_refresh();
 }
 
@@ -60,7 +68,10 @@ void Window::shutdown() {
     os_messages_callbacks_data.shutdown();
     os_messages_callbacks.shutdown();
 
-    SDL_DestroyWindow( window );
+    if ( window ) {
+        SDL_DestroyWindow( window );
+        window = nullptr;
+    }
     SDL_Quit();
 
     rprint( "WindowService shutdown\n" );
@@ -184,6 +195,9 @@ void Window::handle_os_messages() {
 }
 
 void Window::set_fullscreen( bool value ) {
+    if ( !window )
+        return;
+
     if ( value )
         SDL_SetWindowFullscreen( window, SDL_WINDOW_FULLSCREEN_DESKTOP );
     else {
@@ -209,6 +223,10 @@ void Window::unregister_os_messages_callback( OsMessagesCallback callback ) {
 }
 
 void Window::center_mouse( bool dragging ) {
+    if ( !window ) {
+        return;
+    }
+
     if ( dragging ) {
         SDL_WarpMouseInWindow( window, raptor::roundu32(width / 2.f), raptor::roundu32(height / 2.f) );
         SDL_SetWindowGrab( window, SDL_TRUE );
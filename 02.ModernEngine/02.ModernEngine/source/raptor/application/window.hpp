@@ -14,6 +14,8 @@ struct WindowConfiguration {
 
     Allocator*      allocator;
 
+    bool            headless;       // No SDL window, only events: width and height are kept as given.
+
 }; // struct WindowConfiguration
 
 typedef void        ( *OsMessagesCallback )( void* os_event, void* user_data );
@@ -33,6 +33,14 @@ u32 leading_zeroes_u32( u32 x ) {
 #endif
 }
 
+u64 leading_zeroes_u64( u64 x ) {
+#if defined(_MSC_VER)
+    return __lzcnt64( x );
+#else
+    return __builtin_clzll( x );
+#endif
+}
+
 #if defined(_MSC_VER)
 u32 leading_zeroes_u32_msvc( u32 x ) {
     unsigned long result = 0;  // NOLINT(runtime/int)
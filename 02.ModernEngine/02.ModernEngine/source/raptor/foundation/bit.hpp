@@ -15,6 +15,13 @@ namespace raptor {
 	/// <param name="x">u32 number</param>
 	/// <returns>Number of non-significant zeroes</returns>
 	u32             leading_zeroes_u32(u32 x);
+
+	/// <summary>
+	/// Count non-significant zeroes in a u64.
+	/// </summary>
+	/// <param name="x">u64 number</param>
+	/// <returns>Number of non-significant zeroes</returns>
+	u64             leading_zeroes_u64(u64 x);
 #if defined(_MSC_VER)
 
 	/// <summary>
@@ -93,7 +100,7 @@ namespace raptor {
 			return LowestBitSet();
 		}
 		uint32_t LowestBitSet() const {
-			return trailing_zeros_u32(mask_) >> Shift;
+			return count_trailing_zeros(mask_) >> Shift;
 		}
 		uint32_t HighestBitSet() const {
 			return static_cast<uint32_t>((bit_width(mask_) - 1) >> Shift);
@@ -107,14 +114,22 @@ namespace raptor {
 		}
 
 		uint32_t TrailingZeros() const {
-			return trailing_zeros_u32(mask_);// >> Shift;
+			return count_trailing_zeros(mask_) >> Shift;
 		}
 
+		// Only the significant bits are counted, so a 16 slots mask stored in a u32 gives at most 16.
 		uint32_t LeadingZeros() const {
-			return leading_zeroes_u32(mask_);// >> Shift;
+			constexpr int k_extra_bits = sizeof(T) * 8 - (SignificantBits << Shift);
+			return count_leading_zeros(static_cast<T>(mask_ << k_extra_bits)) >> Shift;
 		}
 
 	private:
+		// Zero safe bit counts, u64 masks are used by the 8 wide groups.
+		static uint32_t count_trailing_zeros(uint32_t x) { return x ? trailing_zeros_u32(x) : 32; }
+		static uint32_t count_trailing_zeros(uint64_t x) { return x ? (uint32_t)trailing_zeros_u64(x) : 64; }
+		static uint32_t count_leading_zeros(uint32_t x) { return x ? leading_zeroes_u32(x) : 32; }
+		static uint32_t count_leading_zeros(uint64_t x) { return x ? (uint32_t)leading_zeroes_u64(x) : 64; }
+
 		friend bool operator==(const BitMask& a, const BitMask& b) {
 			return a.mask_ == b.mask_;
 		}
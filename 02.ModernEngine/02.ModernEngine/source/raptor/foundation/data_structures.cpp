@@ -14,29 +14,37 @@ void ResourcePool::init( Allocator* allocator_, u32 pool_size_, u32 resource_siz
     pool_size = pool_size_;
     resource_size = resource_size_;
 
-    // Group allocate ( resource size + u32 )
+    // Group allocate ( resource size + u32 free list link [+ u32 generation] )
+#if defined(RAPTOR_HANDLE_VALIDATION)
+    sizet allocation_size = pool_size * (resource_size + sizeof(u32) * 2);
+#else
     sizet allocation_size = pool_size * (resource_size + sizeof(u32));
+#endif // RAPTOR_HANDLE_VALIDATION
     memory = (u8*)allocator->allocate( allocation_size, 1 );
     memset( memory, 0, allocation_size );
 
-    // Allocate and add free indices
-    free_indices = ( u32* )( memory + pool_size * resource_size );
-    free_indices_head = 0;
+    // Free list links are written lazily: slots past first_unused are implicitly free.
+    next_free = ( u32* )( memory + pool_size * resource_size );
 
+#if defined(RAPTOR_HANDLE_VALIDATION)
+    generations = next_free + pool_size;
     for ( u32 i = 0; i < pool_size; ++i ) {
-        free_indices[i] = i;
+        generations[ i ] = 1;
     }
+#endif // RAPTOR_HANDLE_VALIDATION
 
-    used_indices = 0;
+    free_all_resources();
 }
 
 void ResourcePool::shutdown() {
 
-    if ( free_indices_head != 0 ) {
+    if ( used_indices != 0 ) {
         rprint( "Resource pool has unfreed resources.\n" );
 
-        for ( u32 i = 0; i < free_indices_head; ++i ) {
-            rprint( "\tResource %u\n", free_indices[ i ] );
+        for ( u32 i = 0; i < first_unused; ++i ) {
+            if ( next_free[ i ] == k_slot_in_use ) {
+                rprint( "\tResource %u\n", i );
+            }
         }
     }
 
@@ -46,29 +54,49 @@ void ResourcePool::shutdown() {
 }
 
 void ResourcePool::free_all_resources() {
-    free_indices_head = 0;
-    used_indices = 0;
-
-    for ( uint32_t i = 0; i < pool_size; ++i ) {
-        free_indices[i] = i;
+#if defined(RAPTOR_HANDLE_VALIDATION)
+    // Invalidate all outstanding handles.
+    for ( u32 i = 0; i < first_unused; ++i ) {
+        if ( next_free[ i ] == k_slot_in_use ) {
+            generations[ i ] = generations[ i ] + 1 == 0 ? 1 : generations[ i ] + 1;
+        }
     }
+#endif // RAPTOR_HANDLE_VALIDATION
+
+    free_list_head = k_end_of_list;
+    first_unused = 0;
+    used_indices = 0;
 }
 
 u32 ResourcePool::obtain_resource() {
-    // TODO: add bits for checking if resource is alive and use bitmasks.
-    if ( free_indices_head < pool_size ) {
-        const u32 free_index = free_indices[free_indices_head++];
-        ++used_indices;
-        return free_index;
+    u32 free_index = k_invalid_index;
+
+    if ( free_list_head != k_end_of_list ) {
+        free_index = free_list_head;
+        free_list_head = next_free[ free_index ];
+    } else if ( first_unused < pool_size ) {
+        free_index = first_unused++;
+    } else {
+        // Error: no more resources left!
+        RASSERTM( false, "Resource pool exhausted, size %u", pool_size );
+        return k_invalid_index;
     }
-    // Error: no more resources left!
-    RASSERT( false );
-    return k_invalid_index;
+
+    next_free[ free_index ] = k_slot_in_use;
+    ++used_indices;
+    return free_index;
 }
 
 void ResourcePool::release_resource( u32 handle ) {
-    // TODO: add bits for checking if resource is alive and use bitmasks.
-    free_indices[--free_indices_head] = handle;
+    RASSERTM( handle < first_unused && next_free[ handle ] == k_slot_in_use, "Releasing resource %u that is not in use", handle );
+
+#if defined(RAPTOR_HANDLE_VALIDATION)
+    // Skip 0, it is reserved for unchecked handles.
+    generations[ handle ] = generations[ handle ] + 1 == 0 ? 1 : generations[ handle ] + 1;
+#endif // RAPTOR_HANDLE_VALIDATION
+
+    next_free[ handle ] = free_list_head;
+    free_list_head = handle;
     --used_indices;
 }
 
@@ -86,5 +114,22 @@ const void* ResourcePool::access_resource( u32 handle ) const {
     return nullptr;
 }
 
+u32 ResourcePool::get_generation( u32 handle ) const {
+#if defined(RAPTOR_HANDLE_VALIDATION)
+    if ( handle < pool_size ) {
+        return generations[ handle ];
+    }
+#endif // RAPTOR_HANDLE_VALIDATION
+    return 0;
+}
+
+bool ResourcePool::is_valid( u32 handle, u32 generation ) const {
+#if defined(RAPTOR_HANDLE_VALIDATION)
+    if ( handle < pool_size && generation != 0 ) {
+        return generations[ handle ] == generation;
+    }
+#endif // RAPTOR_HANDLE_VALIDATION
+    return true;
+}
 
 } // namespace raptor
@@ -3,10 +3,16 @@
 #include "foundation/memory.hpp"
 #include "foundation/assert.hpp"
 
+// Handle generations are tracked only in debug builds, release handles are bare indices.
+#if !defined(NDEBUG) && !defined(RAPTOR_HANDLE_VALIDATION)
+#define RAPTOR_HANDLE_VALIDATION
+#endif // NDEBUG
+
 namespace raptor {
 
     //
-    //
+    // Slots are recycled through an intrusive free list stored in the pool itself:
+    // obtain and release are O(1), as is free_all_resources.
     struct ResourcePool {
 
         void                            init( Allocator* allocator, u32 pool_size, u32 resource_size );
@@ -19,11 +25,23 @@ namespace raptor {
         void*                           access_resource( u32 index );
         const void*                     access_resource( u32 index ) const;
 
+        // Generation of the slot, bumped at each release. 0 is never a valid generation,
+        // so handles created without one are not checked.
+        u32                             get_generation( u32 index ) const;
+        bool                            is_valid( u32 index, u32 generation ) const;
+
+        static const u32                k_end_of_list   = 0xffffffff;
+        static const u32                k_slot_in_use   = 0xfffffffe;
+
         u8*                             memory          = nullptr;
-        u32*                            free_indices    = nullptr;
+        u32*                            next_free       = nullptr;
+#if defined(RAPTOR_HANDLE_VALIDATION)
+        u32*                            generations     = nullptr;
+#endif // RAPTOR_HANDLE_VALIDATION
         Allocator*                      allocator       = nullptr;
 
-        u32                             free_indices_head   = 0;
+        u32                             free_list_head      = k_end_of_list;
+        u32                             first_unused        = 0;    // Slots past this were never obtained since the last free all.
         u32                             pool_size           = 16;
         u32                             resource_size       = 4;
         u32                             used_indices        = 0;
@@ -53,11 +71,13 @@ namespace raptor {
 
     template<typename T>
     inline void ResourcePoolTyped<T>::shutdown() {
-        if ( free_indices_head != 0 ) {
+        if ( used_indices != 0 ) {
             rprint( "Resource pool has unfreed resources.\n" );
 
-            for ( u32 i = 0; i < free_indices_head; ++i ) {
-                rprint( "\tResource %u, %s\n", free_indices[ i ], get( free_indices[ i ] )->name );
+            for ( u32 i = 0; i < first_unused; ++i ) {
+                if ( next_free[ i ] == k_slot_in_use ) {
+                    rprint( "\tResource %u, %s\n", i, get( i )->name );
+                }
             }
         }
         ResourcePool::shutdown();
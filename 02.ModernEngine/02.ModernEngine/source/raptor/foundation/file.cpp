@@ -10,6 +10,8 @@
 #define MAX_PATH 65536
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 #endif
 
@@ -59,6 +61,101 @@ FileTime file_last_write_time( cstring filename ) {
 }
 #endif // _WIN64
 
+bool file_stat( cstring filename, u64* out_size, u64* out_write_time ) {
+#if defined(_WIN64)
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if ( !GetFileAttributesExA( filename, GetFileExInfoStandard, &data ) ) {
+        return false;
+    }
+
+    *out_size = ( ( u64 )data.nFileSizeHigh << 32 ) | data.nFileSizeLow;
+    *out_write_time = ( ( u64 )data.ftLastWriteTime.dwHighDateTime << 32 ) | data.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat file_stat_data;
+    if ( stat( filename, &file_stat_data ) != 0 ) {
+        return false;
+    }
+
+    *out_size = ( u64 )file_stat_data.st_size;
+    *out_write_time = ( u64 )file_stat_data.st_mtime;
+#endif // _WIN64
+    return true;
+}
+
+bool file_map_read( cstring filename, FileMapping* out_mapping ) {
+    *out_mapping = { };
+
+#if defined(_WIN64)
+    HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if ( file == INVALID_HANDLE_VALUE ) {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if ( !GetFileSizeEx( file, &file_size ) || file_size.QuadPart == 0 ) {
+        CloseHandle( file );
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if ( mapping == nullptr ) {
+        CloseHandle( file );
+        return false;
+    }
+
+    void* data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    if ( data == nullptr ) {
+        CloseHandle( mapping );
+        CloseHandle( file );
+        return false;
+    }
+
+    out_mapping->data = data;
+    out_mapping->size = ( sizet )file_size.QuadPart;
+    out_mapping->file_handle = file;
+    out_mapping->mapping_handle = mapping;
+#else
+    int file = open( filename, O_RDONLY );
+    if ( file < 0 ) {
+        return false;
+    }
+
+    struct stat file_stat_data;
+    if ( fstat( file, &file_stat_data ) != 0 || file_stat_data.st_size == 0 ) {
+        close( file );
+        return false;
+    }
+
+    void* data = mmap( nullptr, ( sizet )file_stat_data.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+    // The mapping keeps its own reference to the file.
+    close( file );
+
+    if ( data == MAP_FAILED ) {
+        return false;
+    }
+
+    out_mapping->data = data;
+    out_mapping->size = ( sizet )file_stat_data.st_size;
+#endif // _WIN64
+    return true;
+}
+
+void file_unmap( FileMapping* mapping ) {
+    if ( mapping->data == nullptr ) {
+        return;
+    }
+
+#if defined(_WIN64)
+    UnmapViewOfFile( mapping->data );
+    CloseHandle( mapping->mapping_handle );
+    CloseHandle( mapping->file_handle );
+#else
+    munmap( mapping->data, mapping->size );
+#endif // _WIN64
+
+    *mapping = { };
+}
+
 u32 file_resolve_to_full_path( cstring path, char* out_full_path, u32 max_size ) {
 #if defined(_WIN64)
     return GetFullPathNameA( path, max_size, out_full_path, nullptr );
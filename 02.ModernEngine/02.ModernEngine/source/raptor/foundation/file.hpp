@@ -38,6 +38,18 @@ namespace raptor {
         sizet                       size;
     };
 
+    //
+    // Read only memory mapping of a whole file.
+    struct FileMapping {
+        void*                       data            = nullptr;
+        sizet                       size            = 0;
+
+#if defined (_WIN64)
+        void*                       file_handle     = nullptr;
+        void*                       mapping_handle  = nullptr;
+#endif
+    }; // struct FileMapping
+
     // Read file and allocate memory from allocator.
     // User is responsible for freeing the memory.
     char*                           file_read_binary( cstring filename, Allocator* allocator, sizet* size );
@@ -54,6 +66,13 @@ namespace raptor {
     sizet                           file_write( uint8_t* memory, u32 element_size, u32 count, FileHandle file );
     bool                            file_delete( cstring path );
 
+    // Size and last write time, returns false if the file does not exist.
+    bool                            file_stat( cstring filename, u64* out_size, u64* out_write_time );
+
+    // Pages are loaded on first access, data stays valid until file_unmap.
+    bool                            file_map_read( cstring filename, FileMapping* out_mapping );
+    void                            file_unmap( FileMapping* mapping );
+
 #if defined(_WIN64)
     FileTime                        file_last_write_time( cstring filename );
 #endif
@@ -2,8 +2,19 @@
 
 #include "external/json.hpp"
 
+#include "array.hpp"
 #include "assert.hpp"
+#include "bit.hpp"
 #include "file.hpp"
+#include "time.hpp"
+
+#include <stdarg.h>
+#include <stdlib.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+    #define RAPTOR_JSON_SSE2
+    #include <emmintrin.h>
+#endif
 
 using json = nlohmann::json;
 
@@ -425,7 +436,7 @@ static void load_images( json& json_data, glTF::glTF& gltf_data, Allocator* allo
     }
 }
 
-static void load_sampler( json& json_data, glTF::Sampler& sampler, Allocator* allocator ) {
+static void load_sampler( json& json_data, glTF::Sampler& sampler ) {
     try_load_int( json_data, "magFilter", sampler.mag_filter );
     try_load_int( json_data, "minFilter", sampler.min_filter );
     try_load_int( json_data, "wrapS", sampler.wrap_s );
@@ -440,7 +451,7 @@ static void load_samplers( json& json_data, glTF::glTF& gltf_data, Allocator* al
     gltf_data.samplers_count = array_count;
 
     for ( sizet i = 0; i < array_count; ++i ) {
-        load_sampler( array[ i ], gltf_data.samplers[ i ], allocator );
+        load_sampler( array[ i ], gltf_data.samplers[ i ] );
     }
 }
 
@@ -546,7 +557,7 @@ static void load_animations( json& json_data, glTF::glTF& gltf_data, Allocator*
     }
 }
 
-glTF::glTF gltf_load_file( cstring file_path ) {
+glTF::glTF gltf_load_file_dom( cstring file_path ) {
     glTF::glTF result{ };
 
     if ( !file_exists( file_path ) ) {
@@ -560,7 +571,8 @@ glTF::glTF gltf_load_file( cstring file_path ) {
 
     json gltf_data = json::parse( read_result.data );
 
-    result.allocator.init( rmega(2) );
+    // Sized on the file, a fixed size overflows on scenes with many nodes.
+    result.allocator.init( rmega(2) + read_result.size * 32 );
     Allocator* allocator = &result.allocator;
 
     for ( auto properties : gltf_data.items() ) {
@@ -600,8 +612,1319 @@ glTF::glTF gltf_load_file( cstring file_path ) {
     return result;
 }
 
+// Streaming parser ///////////////////////////////////////////////////////
+//
+// The json text is read once in memory and walked in two passes, without a DOM:
+// 1. containers are indexed in document order with their element count, so each array is
+//    allocated once with its final size and unknown values are skipped without parsing them.
+// 2. a cursor walks the text and fills the glTF structures. Strings are unescaped and null
+//    terminated in place: StringBuffers point into the text, that lives until gltf_free.
+
+static const u32 k_json_padding = 64;   // Zeroed bytes after the text, SIMD loads never need a tail loop.
+
+static const u32 k_glb_magic = 0x46546C67;          // "glTF"
+static const u32 k_glb_chunk_json = 0x4E4F534A;     // "JSON"
+static const u32 k_glb_chunk_bin = 0x004E4942;      // "BIN\0"
+
+//
+//
+struct GlbHeader {
+    u32                             magic;
+    u32                             version;
+    u32                             length;
+}; // struct GlbHeader
+
+//
+//
+struct GlbChunk {
+    u32                             length;
+    u32                             type;
+}; // struct GlbChunk
+
+//
+// Object or array found in the first pass.
+struct JsonContainer {
+    u32                             count;      // Elements of an array, keys of an object.
+    u32                             end;        // Offset after the closing bracket.
+    u32                             next;       // First container after this one is closed, used to skip it.
+    u32                             scalars;    // Array of numbers, strings or literals.
+}; // struct JsonContainer
+
+//
+//
+struct JsonParser {
+    char*                           text;
+    char*                           cursor;
+    char*                           end;
+
+    JsonContainer*                  containers;
+    u32                             containers_count;
+    u32                             next_container;
+
+    Allocator*                      allocator;
+    bool                            error;
+}; // struct JsonParser
+
+static constexpr sizet json_max_size( sizet a, sizet b ) {
+    return a > b ? a : b;
+}
+
+// Biggest structure filled from a single json object, used to bound the output size.
+static constexpr sizet k_json_max_element_size = json_max_size( json_max_size( json_max_size( sizeof( glTF::Node ), sizeof( glTF::Material ) ),
+                                                                               json_max_size( sizeof( glTF::Accessor ), sizeof( glTF::Mesh ) ) ),
+                                                                json_max_size( json_max_size( sizeof( glTF::MeshPrimitive ), sizeof( glTF::BufferView ) ),
+                                                                               json_max_size( sizeof( glTF::MaterialPBRMetallicRoughness ), sizeof( glTF::Buffer ) ) ) );
+static_assert( sizeof( glTF::Image ) <= k_json_max_element_size && sizeof( glTF::Texture ) <= k_json_max_element_size &&
+               sizeof( glTF::Animation ) <= k_json_max_element_size && sizeof( glTF::MeshPrimitive::Attribute ) <= k_json_max_element_size,
+               "Update k_json_max_element_size" );
+
+static const f64 k_json_powers_of_10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                           1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+// Scanning ///////////////////////////////////////////////////////////////
+
+static inline bool json_is_whitespace( char c ) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline const char* json_skip_whitespace( const char* text, const char* end ) {
+    // Minified files have no whitespace at all, check before going wide.
+    if ( text >= end || !json_is_whitespace( *text ) ) {
+        return text;
+    }
+
+#if defined(RAPTOR_JSON_SSE2)
+    const __m128i space = _mm_set1_epi8( ' ' );
+    const __m128i new_line = _mm_set1_epi8( '\n' );
+    const __m128i carriage_return = _mm_set1_epi8( '\r' );
+    const __m128i tab = _mm_set1_epi8( '\t' );
+
+    for ( ; text < end; text += 16 ) {
+        const __m128i chunk = _mm_loadu_si128( ( const __m128i* )text );
+        const __m128i whitespace = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( chunk, space ), _mm_cmpeq_epi8( chunk, new_line ) ),
+                                                 _mm_or_si128( _mm_cmpeq_epi8( chunk, carriage_return ), _mm_cmpeq_epi8( chunk, tab ) ) );
+        const u32 mask = ~( u32 )_mm_movemask_epi8( whitespace ) & 0xFFFF;
+        if ( mask ) {
+            text += trailing_zeros_u32( mask );
+            break;
+        }
+    }
+#else
+    while ( text < end && json_is_whitespace( *text ) ) {
+        ++text;
+    }
+#endif // RAPTOR_JSON_SSE2
+
+    return text < end ? text : end;
+}
+
+// First quote or backslash, end if not found.
+static inline const char* json_find_string_delimiter( const char* text, const char* end ) {
+#if defined(RAPTOR_JSON_SSE2)
+    const __m128i quote = _mm_set1_epi8( '"' );
+    const __m128i backslash = _mm_set1_epi8( '\\' );
+
+    for ( ; text < end; text += 16 ) {
+        const __m128i chunk = _mm_loadu_si128( ( const __m128i* )text );
+        const u32 mask = ( u32 )_mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( chunk, quote ), _mm_cmpeq_epi8( chunk, backslash ) ) );
+        if ( mask ) {
+            text += trailing_zeros_u32( mask );
+            break;
+        }
+    }
+#else
+    while ( text < end && *text != '"' && *text != '\\' ) {
+        ++text;
+    }
+#endif // RAPTOR_JSON_SSE2
+
+    return text < end ? text : end;
+}
+
+// Quote, backslash and bracket/comma bits of a 64 bytes block.
+static inline void json_classify_block( const char* block, u64& quotes, u64& backslashes, u64& structurals ) {
+#if defined(RAPTOR_JSON_SSE2)
+    const __m128i quote = _mm_set1_epi8( '"' );
+    const __m128i backslash = _mm_set1_epi8( '\\' );
+    const __m128i comma = _mm_set1_epi8( ',' );
+    const __m128i lower_case_bit = _mm_set1_epi8( 0x20 );
+    const __m128i open_brace = _mm_set1_epi8( '{' );
+    const __m128i close_brace = _mm_set1_epi8( '}' );
+
+    quotes = backslashes = structurals = 0;
+    for ( u32 i = 0; i < 4; ++i ) {
+        const __m128i chunk = _mm_loadu_si128( ( const __m128i* )( block + i * 16 ) );
+        // Square brackets differ from braces only by 0x20.
+        const __m128i folded = _mm_or_si128( chunk, lower_case_bit );
+        const __m128i structural = _mm_or_si128( _mm_cmpeq_epi8( chunk, comma ),
+                                                 _mm_or_si128( _mm_cmpeq_epi8( folded, open_brace ), _mm_cmpeq_epi8( folded, close_brace ) ) );
+
+        quotes |= ( u64 )( u32 )_mm_movemask_epi8( _mm_cmpeq_epi8( chunk, quote ) ) << ( i * 16 );
+        backslashes |= ( u64 )( u32 )_mm_movemask_epi8( _mm_cmpeq_epi8( chunk, backslash ) ) << ( i * 16 );
+        structurals |= ( u64 )( u32 )_mm_movemask_epi8( structural ) << ( i * 16 );
+    }
+#else
+    quotes = backslashes = structurals = 0;
+    for ( u32 i = 0; i < 64; ++i ) {
+        const char c = block[ i ];
+        quotes |= ( u64 )( c == '"' ) << i;
+        backslashes |= ( u64 )( c == '\\' ) << i;
+        structurals |= ( u64 )( c == ',' || c == '{' || c == '}' || c == '[' || c == ']' ) << i;
+    }
+#endif // RAPTOR_JSON_SSE2
+}
+
+// Returns the closing quote of the string starting after text.
+static const char* json_skip_string( const char* text, const char* end ) {
+    for ( ;; ) {
+        text = json_find_string_delimiter( text, end );
+        if ( text >= end || *text == '"' ) {
+            return text;
+        }
+        // Skip backslash and escaped character.
+        text += 2;
+    }
+}
+
+// First pass /////////////////////////////////////////////////////////////
+
+// Blocks of 64 bytes are classified at once, then the interesting bits are walked in order.
+static bool json_index_containers( const char* text, u32 length, Array<JsonContainer>& containers, Array<u32>& stack ) {
+    const char* end = text + length;
+
+    bool in_string = false;
+    bool skip_first = false;    // Escaped character at the start of the block.
+
+    for ( const char* block = text; block < end; block += 64 ) {
+        u64 quotes, backslashes, structurals;
+        json_classify_block( block, quotes, backslashes, structurals );
+
+        u64 bits = quotes | backslashes | structurals;
+        if ( skip_first ) {
+            bits &= ~1ull;
+            skip_first = false;
+        }
+
+        while ( bits ) {
+            const u32 index = ( u32 )trailing_zeros_u64( bits );
+            bits &= bits - 1;
+
+            const char* cursor = block + index;
+            if ( cursor >= end ) {
+                break;
+            }
+
+            const char c = *cursor;
+            if ( in_string ) {
+                if ( c == '\\' ) {
+                    // Skip the escaped character, it could be a quote or another backslash.
+                    if ( index == 63 ) {
+                        skip_first = true;
+                    } else {
+                        bits &= ~( 1ull << ( index + 1 ) );
+                    }
+                } else if ( c == '"' ) {
+                    in_string = false;
+                }
+            } else if ( c == '"' ) {
+                in_string = true;
+            } else if ( c == '{' || c == '[' ) {
+                const char* first = json_skip_whitespace( cursor + 1, end );
+                if ( first >= end ) {
+                    return false;
+                }
+
+                JsonContainer& container = containers.push_use();
+                container.count = ( *first == '}' || *first == ']' ) ? 0 : 1;
+                container.scalars = ( c == '[' && *first != '{' && *first != '[' ) ? 1 : 0;
+                container.end = container.next = 0;
+                stack.push( containers.size - 1 );
+            } else if ( c == ',' ) {
+                if ( stack.size == 0 ) {
+                    return false;
+                }
+                ++containers[ stack.back() ].count;
+            } else if ( c == '}' || c == ']' ) {
+                if ( stack.size == 0 ) {
+                    return false;
+                }
+
+                JsonContainer& container = containers[ stack.back() ];
+                container.end = ( u32 )( cursor + 1 - text );
+                container.next = containers.size;
+                stack.pop();
+            }
+        }
+    }
+
+    return !in_string && stack.size == 0 && containers.size > 0;
+}
+
+// Second pass ////////////////////////////////////////////////////////////
+
+static inline char json_peek( JsonParser& parser ) {
+    parser.cursor = ( char* )json_skip_whitespace( parser.cursor, parser.end );
+    return parser.cursor < parser.end ? *parser.cursor : 0;
+}
+
+template <sizet N>
+static inline bool json_key_equals( const StringView& key, const char ( &literal )[ N ] ) {
+    return key.length == N - 1 && memcmp( key.text, literal, N - 1 ) == 0;
+}
+
+static void json_skip_value( JsonParser& parser ) {
+    const char c = json_peek( parser );
+
+    if ( c == '{' || c == '[' ) {
+        if ( parser.next_container >= parser.containers_count ) {
+            parser.error = true;
+            return;
+        }
+        const JsonContainer& container = parser.containers[ parser.next_container ];
+        parser.cursor = parser.text + container.end;
+        parser.next_container = container.next;
+    } else if ( c == '"' ) {
+        parser.cursor = ( char* )json_skip_string( parser.cursor + 1, parser.end ) + 1;
+    } else {
+        while ( parser.cursor < parser.end ) {
+            const char v = *parser.cursor;
+            if ( v == ',' || v == '}' || v == ']' || json_is_whitespace( v ) ) {
+                break;
+            }
+            ++parser.cursor;
+        }
+    }
+}
+
+static u32 json_parse_hex4( const char* text ) {
+    u32 value = 0;
+    for ( u32 i = 0; i < 4; ++i ) {
+        const char c = text[ i ];
+        value <<= 4;
+        if ( c >= '0' && c <= '9' ) {
+            value |= c - '0';
+        } else if ( c >= 'a' && c <= 'f' ) {
+            value |= c - 'a' + 10;
+        } else if ( c >= 'A' && c <= 'F' ) {
+            value |= c - 'A' + 10;
+        } else {
+            return u32_max;
+        }
+    }
+    return value;
+}
+
+// Unescapes in place starting from the first backslash, returns the closing quote.
+static char* json_unescape_string( JsonParser& parser, char* read, char*& write ) {
+    for ( ;; ) {
+        if ( read + 1 >= parser.end ) {
+            return parser.end;
+        }
+
+        const char escaped = read[ 1 ];
+        read += 2;
+
+        switch ( escaped ) {
+            case '"': *write++ = '"'; break;
+            case '\\': *write++ = '\\'; break;
+            case '/': *write++ = '/'; break;
+            case 'b': *write++ = '\b'; break;
+            case 'f': *write++ = '\f'; break;
+            case 'n': *write++ = '\n'; break;
+            case 'r': *write++ = '\r'; break;
+            case 't': *write++ = '\t'; break;
+            case 'u':
+            {
+                if ( read + 4 > parser.end ) {
+                    return parser.end;
+                }
+                u32 code_point = json_parse_hex4( read );
+                read += 4;
+
+                // Surrogate pair.
+                if ( code_point >= 0xD800 && code_point <= 0xDBFF && read + 6 <= parser.end && read[ 0 ] == '\\' && read[ 1 ] == 'u' ) {
+                    const u32 low = json_parse_hex4( read + 2 );
+                    if ( low >= 0xDC00 && low <= 0xDFFF ) {
+                        code_point = 0x10000 + ( ( code_point - 0xD800 ) << 10 ) + ( low - 0xDC00 );
+                        read += 6;
+                    }
+                }
+
+                // UTF-8 is never longer than the escape sequence, writing in place is safe.
+                if ( code_point == u32_max ) {
+                    return parser.end;
+                } else if ( code_point < 0x80 ) {
+                    *write++ = ( char )code_point;
+                } else if ( code_point < 0x800 ) {
+                    *write++ = ( char )( 0xC0 | ( code_point >> 6 ) );
+                    *write++ = ( char )( 0x80 | ( code_point & 0x3F ) );
+                } else if ( code_point < 0x10000 ) {
+                    *write++ = ( char )( 0xE0 | ( code_point >> 12 ) );
+                    *write++ = ( char )( 0x80 | ( ( code_point >> 6 ) & 0x3F ) );
+                    *write++ = ( char )( 0x80 | ( code_point & 0x3F ) );
+                } else {
+                    *write++ = ( char )( 0xF0 | ( code_point >> 18 ) );
+                    *write++ = ( char )( 0x80 | ( ( code_point >> 12 ) & 0x3F ) );
+                    *write++ = ( char )( 0x80 | ( ( code_point >> 6 ) & 0x3F ) );
+                    *write++ = ( char )( 0x80 | ( code_point & 0x3F ) );
+                }
+                break;
+            }
+            default:
+                return parser.end;
+        }
+
+        // Copy up to the next delimiter.
+        char* delimiter = ( char* )json_find_string_delimiter( read, parser.end );
+        if ( delimiter >= parser.end ) {
+            return parser.end;
+        }
+        const sizet run_length = delimiter - read;
+        memmove( write, read, run_length );
+        write += run_length;
+        read = delimiter;
+
+        if ( *read == '"' ) {
+            return read;
+        }
+    }
+}
+
+static bool json_parse_string( JsonParser& parser, StringView& string ) {
+    if ( json_peek( parser ) != '"' ) {
+        parser.error = true;
+        return false;
+    }
+
+    char* start = parser.cursor + 1;
+    char* delimiter = ( char* )json_find_string_delimiter( start, parser.end );
+    char* string_end = delimiter;
+
+    if ( delimiter < parser.end && *delimiter == '\\' ) {
+        delimiter = json_unescape_string( parser, delimiter, string_end );
+    }
+
+    if ( delimiter >= parser.end ) {
+        parser.error = true;
+        return false;
+    }
+
+    *string_end = 0;
+    string.text = start;
+    string.length = string_end - start;
+
+    parser.cursor = delimiter + 1;
+    return true;
+}
+
+static f64 json_parse_number( JsonParser& parser ) {
+    json_peek( parser );
+
+    char* start = parser.cursor;
+    char* cursor = start;
+
+    const bool negative = *cursor == '-';
+    cursor += negative ? 1 : 0;
+
+    u64 mantissa = 0;
+    i32 digits = 0;
+    i32 exponent = 0;
+
+    while ( *cursor >= '0' && *cursor <= '9' ) {
+        mantissa = mantissa * 10 + ( *cursor - '0' );
+        ++digits;
+        ++cursor;
+    }
+
+    if ( *cursor == '.' ) {
+        ++cursor;
+        while ( *cursor >= '0' && *cursor <= '9' ) {
+            mantissa = mantissa * 10 + ( *cursor - '0' );
+            ++digits;
+            --exponent;
+            ++cursor;
+        }
+    }
+
+    if ( *cursor == 'e' || *cursor == 'E' ) {
+        ++cursor;
+        const bool negative_exponent = *cursor == '-';
+        cursor += ( *cursor == '-' || *cursor == '+' ) ? 1 : 0;
+
+        i32 exponent_value = 0;
+        while ( *cursor >= '0' && *cursor <= '9' ) {
+            exponent_value = exponent_value < 10000 ? exponent_value * 10 + ( *cursor - '0' ) : exponent_value;
+            ++cursor;
+        }
+        exponent += negative_exponent ? -exponent_value : exponent_value;
+    }
+
+    if ( digits == 0 ) {
+        parser.error = true;
+        return 0.0;
+    }
+
+    parser.cursor = cursor;
+
+    // Exact when both mantissa and power of 10 are representable as doubles, the rest goes to strtod.
+    if ( digits <= 15 && exponent >= -22 && exponent <= 22 ) {
+        f64 value = ( f64 )mantissa;
+        value = exponent < 0 ? value / k_json_powers_of_10[ -exponent ] : value * k_json_powers_of_10[ exponent ];
+        return negative ? -value : value;
+    }
+
+    return strtod( start, nullptr );
+}
+
+static void json_read_int( JsonParser& parser, i32& value ) {
+    value = ( i32 )json_parse_number( parser );
+}
+
+static void json_read_float( JsonParser& parser, f32& value ) {
+    value = ( f32 )json_parse_number( parser );
+}
+
+static void json_read_bool( JsonParser& parser, bool& value ) {
+    const char c = json_peek( parser );
+    if ( c == 't' && parser.cursor + 4 <= parser.end && memcmp( parser.cursor, "true", 4 ) == 0 ) {
+        value = true;
+        parser.cursor += 4;
+    } else if ( c == 'f' && parser.cursor + 5 <= parser.end && memcmp( parser.cursor, "false", 5 ) == 0 ) {
+        value = false;
+        parser.cursor += 5;
+    } else {
+        parser.error = true;
+        json_skip_value( parser );
+    }
+}
+
+// Not owned: the StringBuffer points into the json text.
+static void json_read_string( JsonParser& parser, StringBuffer& string_buffer ) {
+    StringView string;
+    if ( !json_parse_string( parser, string ) ) {
+        return;
+    }
+
+    string_buffer.data = string.text;
+    string_buffer.current_size = ( u32 )string.length;
+    string_buffer.buffer_size = ( u32 )string.length + 1;
+    string_buffer.allocator = nullptr;
+}
+
+static const JsonContainer* json_begin_container( JsonParser& parser, char open ) {
+    if ( json_peek( parser ) != open || parser.next_container >= parser.containers_count ) {
+        parser.error = true;
+        json_skip_value( parser );
+        return nullptr;
+    }
+
+    ++parser.cursor;
+    return &parser.containers[ parser.next_container++ ];
+}
+
+static bool json_next( JsonParser& parser, char close ) {
+    if ( parser.error ) {
+        return false;
+    }
+
+    char c = json_peek( parser );
+    if ( c == ',' ) {
+        ++parser.cursor;
+        c = json_peek( parser );
+    }
+
+    if ( c == close ) {
+        ++parser.cursor;
+        return false;
+    }
+
+    if ( c == 0 ) {
+        parser.error = true;
+        return false;
+    }
+
+    return true;
+}
+
+static bool json_next_key( JsonParser& parser, StringView& key ) {
+    if ( !json_next( parser, '}' ) || !json_parse_string( parser, key ) ) {
+        return false;
+    }
+
+    if ( json_peek( parser ) != ':' ) {
+        parser.error = true;
+        return false;
+    }
+    ++parser.cursor;
+
+    return true;
+}
+
+static bool json_next_element( JsonParser& parser ) {
+    return json_next( parser, ']' );
+}
+
+// Small arrays are common (children, translation...), a 16 bytes alignment wastes less than 64.
+static void* json_allocate( JsonParser& parser, sizet size ) {
+    if ( size == 0 ) {
+        return nullptr;
+    }
+
+    void* result = parser.allocator->allocate( size, 16 );
+    memset( result, 0, size );
+    return result;
+}
+
+static void json_read_int_array( JsonParser& parser, u32& count, i32** array ) {
+    count = 0;
+    *array = nullptr;
+
+    const JsonContainer* container = json_begin_container( parser, '[' );
+    if ( !container ) {
+        return;
+    }
+
+    i32* values = ( i32* )json_allocate( parser, sizeof( i32 ) * container->count );
+    while ( json_next_element( parser ) ) {
+        json_read_int( parser, values[ count++ ] );
+    }
+
+    *array = values;
+}
+
+static void json_read_float_array( JsonParser& parser, u32& count, f32** array ) {
+    count = 0;
+    *array = nullptr;
+
+    const JsonContainer* container = json_begin_container( parser, '[' );
+    if ( !container ) {
+        return;
+    }
+
+    f32* values = ( f32* )json_allocate( parser, sizeof( f32 ) * container->count );
+    while ( json_next_element( parser ) ) {
+        json_read_float( parser, values[ count++ ] );
+    }
+
+    *array = values;
+}
+
+template <typename T>
+static void json_read_object_array( JsonParser& parser, u32& count, T*& values, void ( *parse_element )( JsonParser&, T& ) ) {
+    count = 0;
+    values = nullptr;
+
+    const JsonContainer* container = json_begin_container( parser, '[' );
+    if ( !container ) {
+        return;
+    }
+
+    values = ( T* )json_allocate( parser, sizeof( T ) * container->count );
+    while ( json_next_element( parser ) ) {
+        parse_element( parser, values[ count++ ] );
+    }
+}
+
+// glTF objects ///////////////////////////////////////////////////////////
+
+static void parse_asset( JsonParser& parser, glTF::Asset& asset ) {
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "copyright" ) ) {
+            json_read_string( parser, asset.copyright );
+        } else if ( json_key_equals( key, "generator" ) ) {
+            json_read_string( parser, asset.generator );
+        } else if ( json_key_equals( key, "minVersion" ) ) {
+            json_read_string( parser, asset.minVersion );
+        } else if ( json_key_equals( key, "version" ) ) {
+            json_read_string( parser, asset.version );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_scene( JsonParser& parser, glTF::Scene& scene ) {
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "nodes" ) ) {
+            json_read_int_array( parser, scene.nodes_count, &scene.nodes );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_buffer( JsonParser& parser, glTF::Buffer& buffer ) {
+    buffer.byte_length = glTF::INVALID_INT_VALUE;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "uri" ) ) {
+            json_read_string( parser, buffer.uri );
+        } else if ( json_key_equals( key, "byteLength" ) ) {
+            json_read_int( parser, buffer.byte_length );
+        } else if ( json_key_equals( key, "name" ) ) {
+            json_read_string( parser, buffer.name );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_buffer_view( JsonParser& parser, glTF::BufferView& buffer_view ) {
+    buffer_view.buffer = buffer_view.byte_length = buffer_view.byte_offset = glTF::INVALID_INT_VALUE;
+    buffer_view.byte_stride = buffer_view.target = glTF::INVALID_INT_VALUE;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "buffer" ) ) {
+            json_read_int( parser, buffer_view.buffer );
+        } else if ( json_key_equals( key, "byteLength" ) ) {
+            json_read_int( parser, buffer_view.byte_length );
+        } else if ( json_key_equals( key, "byteOffset" ) ) {
+            json_read_int( parser, buffer_view.byte_offset );
+        } else if ( json_key_equals( key, "byteStride" ) ) {
+            json_read_int( parser, buffer_view.byte_stride );
+        } else if ( json_key_equals( key, "target" ) ) {
+            json_read_int( parser, buffer_view.target );
+        } else if ( json_key_equals( key, "name" ) ) {
+            json_read_string( parser, buffer_view.name );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_node( JsonParser& parser, glTF::Node& node ) {
+    node.camera = node.mesh = node.skin = glTF::INVALID_INT_VALUE;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "camera" ) ) {
+            json_read_int( parser, node.camera );
+        } else if ( json_key_equals( key, "mesh" ) ) {
+            json_read_int( parser, node.mesh );
+        } else if ( json_key_equals( key, "skin" ) ) {
+            json_read_int( parser, node.skin );
+        } else if ( json_key_equals( key, "children" ) ) {
+            json_read_int_array( parser, node.children_count, &node.children );
+        } else if ( json_key_equals( key, "matrix" ) ) {
+            json_read_float_array( parser, node.matrix_count, &node.matrix );
+        } else if ( json_key_equals( key, "rotation" ) ) {
+            json_read_float_array( parser, node.rotation_count, &node.rotation );
+        } else if ( json_key_equals( key, "scale" ) ) {
+            json_read_float_array( parser, node.scale_count, &node.scale );
+        } else if ( json_key_equals( key, "translation" ) ) {
+            json_read_float_array( parser, node.translation_count, &node.translation );
+        } else if ( json_key_equals( key, "weights" ) ) {
+            json_read_float_array( parser, node.weights_count, &node.weights );
+        } else if ( json_key_equals( key, "name" ) ) {
+            json_read_string( parser, node.name );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_mesh_primitive( JsonParser& parser, glTF::MeshPrimitive& mesh_primitive ) {
+    mesh_primitive.indices = mesh_primitive.material = mesh_primitive.mode = glTF::INVALID_INT_VALUE;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "indices" ) ) {
+            json_read_int( parser, mesh_primitive.indices );
+        } else if ( json_key_equals( key, "material" ) ) {
+            json_read_int( parser, mesh_primitive.material );
+        } else if ( json_key_equals( key, "mode" ) ) {
+            json_read_int( parser, mesh_primitive.mode );
+        } else if ( json_key_equals( key, "attributes" ) ) {
+            const JsonContainer* attributes = json_begin_container( parser, '{' );
+            if ( !attributes ) {
+                continue;
+            }
+
+            mesh_primitive.attributes = ( glTF::MeshPrimitive::Attribute* )json_allocate( parser, sizeof( glTF::MeshPrimitive::Attribute ) * attributes->count );
+            mesh_primitive.attribute_count = 0;
+
+            StringView attribute_key;
+            while ( json_next_key( parser, attribute_key ) ) {
+                glTF::MeshPrimitive::Attribute& attribute = mesh_primitive.attributes[ mesh_primitive.attribute_count++ ];
+
+                // Keys are null terminated in place too.
+                attribute.key.data = attribute_key.text;
+                attribute.key.current_size = ( u32 )attribute_key.length;
+                attribute.key.buffer_size = ( u32 )attribute_key.length + 1;
+                attribute.key.allocator = nullptr;
+
+                json_read_int( parser, attribute.accessor_index );
+            }
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_mesh( JsonParser& parser, glTF::Mesh& mesh ) {
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "primitives" ) ) {
+            json_read_object_array( parser, mesh.primitives_count, mesh.primitives, parse_mesh_primitive );
+        } else if ( json_key_equals( key, "weights" ) ) {
+            json_read_float_array( parser, mesh.weights_count, &mesh.weights );
+        } else if ( json_key_equals( key, "name" ) ) {
+            json_read_string( parser, mesh.name );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_accessor_type( JsonParser& parser, glTF::Accessor::Type& type ) {
+    StringView value;
+    if ( !json_parse_string( parser, value ) ) {
+        return;
+    }
+
+    if ( json_key_equals( value, "SCALAR" ) ) {
+        type = glTF::Accessor::Type::Scalar;
+    } else if ( json_key_equals( value, "VEC2" ) ) {
+        type = glTF::Accessor::Type::Vec2;
+    } else if ( json_key_equals( value, "VEC3" ) ) {
+        type = glTF::Accessor::Type::Vec3;
+    } else if ( json_key_equals( value, "VEC4" ) ) {
+        type = glTF::Accessor::Type::Vec4;
+    } else if ( json_key_equals( value, "MAT2" ) ) {
+        type = glTF::Accessor::Type::Mat2;
+    } else if ( json_key_equals( value, "MAT3" ) ) {
+        type = glTF::Accessor::Type::Mat3;
+    } else if ( json_key_equals( value, "MAT4" ) ) {
+        type = glTF::Accessor::Type::Mat4;
+    } else {
+        RASSERTM( false, "Unknown accessor type %s", value.text );
+    }
+}
+
+static void parse_accessor( JsonParser& parser, glTF::Accessor& accessor ) {
+    accessor.buffer_view = accessor.byte_offset = accessor.component_type = glTF::INVALID_INT_VALUE;
+    accessor.count = accessor.sparse = glTF::INVALID_INT_VALUE;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "bufferView" ) ) {
+            json_read_int( parser, accessor.buffer_view );
+        } else if ( json_key_equals( key, "byteOffset" ) ) {
+            json_read_int( parser, accessor.byte_offset );
+        } else if ( json_key_equals( key, "componentType" ) ) {
+            json_read_int( parser, accessor.component_type );
+        } else if ( json_key_equals( key, "count" ) ) {
+            json_read_int( parser, accessor.count );
+        } else if ( json_key_equals( key, "max" ) ) {
+            json_read_float_array( parser, accessor.max_count, &accessor.max );
+        } else if ( json_key_equals( key, "min" ) ) {
+            json_read_float_array( parser, accessor.min_count, &accessor.min );
+        } else if ( json_key_equals( key, "normalized" ) ) {
+            json_read_bool( parser, accessor.normalized );
+        } else if ( json_key_equals( key, "type" ) ) {
+            parse_accessor_type( parser, accessor.type );
+        } else {
+            // Sparse accessors are objects, not supported.
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_texture_info( JsonParser& parser, glTF::TextureInfo** texture_info ) {
+    glTF::TextureInfo* ti = ( glTF::TextureInfo* )json_allocate( parser, sizeof( glTF::TextureInfo ) );
+    ti->index = ti->texCoord = glTF::INVALID_INT_VALUE;
+    *texture_info = ti;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "index" ) ) {
+            json_read_int( parser, ti->index );
+        } else if ( json_key_equals( key, "texCoord" ) ) {
+            json_read_int( parser, ti->texCoord );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_normal_texture_info( JsonParser& parser, glTF::MaterialNormalTextureInfo** texture_info ) {
+    glTF::MaterialNormalTextureInfo* ti = ( glTF::MaterialNormalTextureInfo* )json_allocate( parser, sizeof( glTF::MaterialNormalTextureInfo ) );
+    ti->index = ti->tex_coord = glTF::INVALID_INT_VALUE;
+    ti->scale = glTF::INVALID_FLOAT_VALUE;
+    *texture_info = ti;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "index" ) ) {
+            json_read_int( parser, ti->index );
+        } else if ( json_key_equals( key, "texCoord" ) ) {
+            json_read_int( parser, ti->tex_coord );
+        } else if ( json_key_equals( key, "scale" ) ) {
+            json_read_float( parser, ti->scale );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_occlusion_texture_info( JsonParser& parser, glTF::MaterialOcclusionTextureInfo** texture_info ) {
+    glTF::MaterialOcclusionTextureInfo* ti = ( glTF::MaterialOcclusionTextureInfo* )json_allocate( parser, sizeof( glTF::MaterialOcclusionTextureInfo ) );
+    ti->index = ti->texCoord = glTF::INVALID_INT_VALUE;
+    ti->strength = glTF::INVALID_FLOAT_VALUE;
+    *texture_info = ti;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "index" ) ) {
+            json_read_int( parser, ti->index );
+        } else if ( json_key_equals( key, "texCoord" ) ) {
+            json_read_int( parser, ti->texCoord );
+        } else if ( json_key_equals( key, "strength" ) ) {
+            json_read_float( parser, ti->strength );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_pbr_metallic_roughness( JsonParser& parser, glTF::MaterialPBRMetallicRoughness** pbr ) {
+    glTF::MaterialPBRMetallicRoughness* values = ( glTF::MaterialPBRMetallicRoughness* )json_allocate( parser, sizeof( glTF::MaterialPBRMetallicRoughness ) );
+    values->metallic_factor = values->roughness_factor = glTF::INVALID_FLOAT_VALUE;
+    *pbr = values;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "baseColorFactor" ) ) {
+            json_read_float_array( parser, values->base_color_factor_count, &values->base_color_factor );
+        } else if ( json_key_equals( key, "baseColorTexture" ) ) {
+            parse_texture_info( parser, &values->base_color_texture );
+        } else if ( json_key_equals( key, "metallicFactor" ) ) {
+            json_read_float( parser, values->metallic_factor );
+        } else if ( json_key_equals( key, "metallicRoughnessTexture" ) ) {
+            parse_texture_info( parser, &values->metallic_roughness_texture );
+        } else if ( json_key_equals( key, "roughnessFactor" ) ) {
+            json_read_float( parser, values->roughness_factor );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_material( JsonParser& parser, glTF::Material& material ) {
+    material.alpha_cutoff = glTF::INVALID_FLOAT_VALUE;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "emissiveFactor" ) ) {
+            json_read_float_array( parser, material.emissive_factor_count, &material.emissive_factor );
+        } else if ( json_key_equals( key, "alphaCutoff" ) ) {
+            json_read_float( parser, material.alpha_cutoff );
+        } else if ( json_key_equals( key, "alphaMode" ) ) {
+            json_read_string( parser, material.alpha_mode );
+        } else if ( json_key_equals( key, "doubleSided" ) ) {
+            json_read_bool( parser, material.double_sided );
+        } else if ( json_key_equals( key, "emissiveTexture" ) ) {
+            parse_texture_info( parser, &material.emissive_texture );
+        } else if ( json_key_equals( key, "normalTexture" ) ) {
+            parse_normal_texture_info( parser, &material.normal_texture );
+        } else if ( json_key_equals( key, "occlusionTexture" ) ) {
+            parse_occlusion_texture_info( parser, &material.occlusion_texture );
+        } else if ( json_key_equals( key, "pbrMetallicRoughness" ) ) {
+            parse_pbr_metallic_roughness( parser, &material.pbr_metallic_roughness );
+        } else if ( json_key_equals( key, "name" ) ) {
+            json_read_string( parser, material.name );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_texture( JsonParser& parser, glTF::Texture& texture ) {
+    texture.sampler = texture.source = glTF::INVALID_INT_VALUE;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "sampler" ) ) {
+            json_read_int( parser, texture.sampler );
+        } else if ( json_key_equals( key, "source" ) ) {
+            json_read_int( parser, texture.source );
+        } else if ( json_key_equals( key, "name" ) ) {
+            json_read_string( parser, texture.name );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_image( JsonParser& parser, glTF::Image& image ) {
+    image.buffer_view = glTF::INVALID_INT_VALUE;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "bufferView" ) ) {
+            json_read_int( parser, image.buffer_view );
+        } else if ( json_key_equals( key, "mimeType" ) ) {
+            json_read_string( parser, image.mime_type );
+        } else if ( json_key_equals( key, "uri" ) ) {
+            json_read_string( parser, image.uri );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_sampler( JsonParser& parser, glTF::Sampler& sampler ) {
+    sampler.mag_filter = sampler.min_filter = sampler.wrap_s = sampler.wrap_t = glTF::INVALID_INT_VALUE;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "magFilter" ) ) {
+            json_read_int( parser, sampler.mag_filter );
+        } else if ( json_key_equals( key, "minFilter" ) ) {
+            json_read_int( parser, sampler.min_filter );
+        } else if ( json_key_equals( key, "wrapS" ) ) {
+            json_read_int( parser, sampler.wrap_s );
+        } else if ( json_key_equals( key, "wrapT" ) ) {
+            json_read_int( parser, sampler.wrap_t );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_skin( JsonParser& parser, glTF::Skin& skin ) {
+    skin.skeleton_root_node_index = skin.inverse_bind_matrices_buffer_index = glTF::INVALID_INT_VALUE;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "skeleton" ) ) {
+            json_read_int( parser, skin.skeleton_root_node_index );
+        } else if ( json_key_equals( key, "inverseBindMatrices" ) ) {
+            json_read_int( parser, skin.inverse_bind_matrices_buffer_index );
+        } else if ( json_key_equals( key, "joints" ) ) {
+            json_read_int_array( parser, skin.joints_count, &skin.joints );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_animation_sampler( JsonParser& parser, glTF::AnimationSampler& sampler ) {
+    sampler.input_keyframe_buffer_index = sampler.output_keyframe_buffer_index = glTF::INVALID_INT_VALUE;
+    sampler.interpolation = glTF::AnimationSampler::Linear;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "input" ) ) {
+            json_read_int( parser, sampler.input_keyframe_buffer_index );
+        } else if ( json_key_equals( key, "output" ) ) {
+            json_read_int( parser, sampler.output_keyframe_buffer_index );
+        } else if ( json_key_equals( key, "interpolation" ) ) {
+            StringView value;
+            if ( !json_parse_string( parser, value ) ) {
+                continue;
+            }
+
+            if ( json_key_equals( value, "STEP" ) ) {
+                sampler.interpolation = glTF::AnimationSampler::Step;
+            } else if ( json_key_equals( value, "CUBICSPLINE" ) ) {
+                sampler.interpolation = glTF::AnimationSampler::CubicSpline;
+            } else {
+                sampler.interpolation = glTF::AnimationSampler::Linear;
+            }
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_animation_channel( JsonParser& parser, glTF::AnimationChannel& channel ) {
+    channel.sampler = channel.target_node = glTF::INVALID_INT_VALUE;
+    channel.target_type = glTF::AnimationChannel::Count;
+
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "sampler" ) ) {
+            json_read_int( parser, channel.sampler );
+        } else if ( json_key_equals( key, "target" ) ) {
+            if ( !json_begin_container( parser, '{' ) ) {
+                continue;
+            }
+
+            StringView target_key;
+            while ( json_next_key( parser, target_key ) ) {
+                if ( json_key_equals( target_key, "node" ) ) {
+                    json_read_int( parser, channel.target_node );
+                } else if ( json_key_equals( target_key, "path" ) ) {
+                    StringView target_path;
+                    if ( !json_parse_string( parser, target_path ) ) {
+                        continue;
+                    }
+
+                    if ( json_key_equals( target_path, "scale" ) ) {
+                        channel.target_type = glTF::AnimationChannel::Scale;
+                    } else if ( json_key_equals( target_path, "rotation" ) ) {
+                        channel.target_type = glTF::AnimationChannel::Rotation;
+                    } else if ( json_key_equals( target_path, "translation" ) ) {
+                        channel.target_type = glTF::AnimationChannel::Translation;
+                    } else if ( json_key_equals( target_path, "weights" ) ) {
+                        channel.target_type = glTF::AnimationChannel::Weights;
+                    } else {
+                        RASSERTM( false, "Error parsing target path %s\n", target_path.text );
+                    }
+                } else {
+                    json_skip_value( parser );
+                }
+            }
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static void parse_animation( JsonParser& parser, glTF::Animation& animation ) {
+    if ( !json_begin_container( parser, '{' ) ) {
+        return;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "samplers" ) ) {
+            json_read_object_array( parser, animation.samplers_count, animation.samplers, parse_animation_sampler );
+        } else if ( json_key_equals( key, "channels" ) ) {
+            json_read_object_array( parser, animation.channels_count, animation.channels, parse_animation_channel );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+}
+
+static bool parse_gltf( JsonParser& parser, glTF::glTF& result ) {
+    if ( !json_begin_container( parser, '{' ) ) {
+        return false;
+    }
+
+    StringView key;
+    while ( json_next_key( parser, key ) ) {
+        if ( json_key_equals( key, "asset" ) ) {
+            parse_asset( parser, result.asset );
+        } else if ( json_key_equals( key, "scene" ) ) {
+            json_read_int( parser, result.scene );
+        } else if ( json_key_equals( key, "scenes" ) ) {
+            json_read_object_array( parser, result.scenes_count, result.scenes, parse_scene );
+        } else if ( json_key_equals( key, "buffers" ) ) {
+            json_read_object_array( parser, result.buffers_count, result.buffers, parse_buffer );
+        } else if ( json_key_equals( key, "bufferViews" ) ) {
+            json_read_object_array( parser, result.buffer_views_count, result.buffer_views, parse_buffer_view );
+        } else if ( json_key_equals( key, "nodes" ) ) {
+            json_read_object_array( parser, result.nodes_count, result.nodes, parse_node );
+        } else if ( json_key_equals( key, "meshes" ) ) {
+            json_read_object_array( parser, result.meshes_count, result.meshes, parse_mesh );
+        } else if ( json_key_equals( key, "accessors" ) ) {
+            json_read_object_array( parser, result.accessors_count, result.accessors, parse_accessor );
+        } else if ( json_key_equals( key, "materials" ) ) {
+            json_read_object_array( parser, result.materials_count, result.materials, parse_material );
+        } else if ( json_key_equals( key, "textures" ) ) {
+            json_read_object_array( parser, result.textures_count, result.textures, parse_texture );
+        } else if ( json_key_equals( key, "images" ) ) {
+            json_read_object_array( parser, result.images_count, result.images, parse_image );
+        } else if ( json_key_equals( key, "samplers" ) ) {
+            json_read_object_array( parser, result.samplers_count, result.samplers, parse_sampler );
+        } else if ( json_key_equals( key, "skins" ) ) {
+            json_read_object_array( parser, result.skins_count, result.skins, parse_skin );
+        } else if ( json_key_equals( key, "animations" ) ) {
+            json_read_object_array( parser, result.animations_count, result.animations, parse_animation );
+        } else {
+            json_skip_value( parser );
+        }
+    }
+
+    return !parser.error;
+}
+
+glTF::glTF gltf_load_file( cstring file_path ) {
+    glTF::glTF result{ };
+
+    Allocator* heap_allocator = &MemoryService::instance()->system_allocator;
+
+    FILE* file = fopen( file_path, "rb" );
+    if ( !file ) {
+        rprint( "Error: file %s does not exists.\n", file_path );
+        return result;
+    }
+
+    fseek( file, 0, SEEK_END );
+    const sizet file_size = ( sizet )ftell( file );
+    fseek( file, 0, SEEK_SET );
+
+    char* file_data = ( char* )rallocaa( file_size + k_json_padding, heap_allocator, 64 );
+    const sizet read_size = fread( file_data, 1, file_size, file );
+    memset( file_data + read_size, 0, k_json_padding );
+    fclose( file );
+
+    char* json_text = file_data;
+    u32 json_length = ( u32 )read_size;
+
+    // Binary container: json chunk followed by an optional binary chunk.
+    const GlbHeader* glb_header = ( const GlbHeader* )file_data;
+    if ( read_size >= sizeof( GlbHeader ) + sizeof( GlbChunk ) && glb_header->magic == k_glb_magic ) {
+        const GlbChunk* json_chunk = ( const GlbChunk* )( file_data + sizeof( GlbHeader ) );
+        const sizet json_offset = sizeof( GlbHeader ) + sizeof( GlbChunk );
+
+        if ( glb_header->version != 2 || json_chunk->type != k_glb_chunk_json || json_offset + json_chunk->length > read_size ) {
+            rprint( "Error: %s is not a valid glb version 2 file.\n", file_path );
+            rfree( file_data, heap_allocator );
+            return result;
+        }
+
+        json_text = file_data + json_offset;
+        json_length = json_chunk->length;
+
+        const sizet bin_offset = json_offset + json_chunk->length;
+        if ( bin_offset + sizeof( GlbChunk ) <= read_size ) {
+            const GlbChunk* bin_chunk = ( const GlbChunk* )( file_data + bin_offset );
+            if ( bin_chunk->type == k_glb_chunk_bin && bin_offset + sizeof( GlbChunk ) + bin_chunk->length <= read_size ) {
+                result.binary_chunk = ( u8* )file_data + bin_offset + sizeof( GlbChunk );
+                result.binary_chunk_size = bin_chunk->length;
+            }
+        }
+    }
+
+    // First pass
+    Array<JsonContainer> containers;
+    containers.init( heap_allocator, json_length / 32 + 16 );
+    Array<u32> stack;
+    stack.init( heap_allocator, 64 );
+
+    const bool indexed = json_index_containers( json_text, json_length, containers, stack );
+    stack.shutdown();
+
+    if ( !indexed ) {
+        rprint( "Error: malformed json in %s.\n", file_path );
+        containers.shutdown();
+        rfree( file_data, heap_allocator );
+        return glTF::glTF{ };
+    }
+
+    // Every allocation comes from a container, so this bounds the output.
+    sizet allocator_size = rkilo( 4 );
+    for ( u32 i = 0; i < containers.size; ++i ) {
+        const JsonContainer& container = containers[ i ];
+        allocator_size += 16 + k_json_max_element_size + container.count * ( container.scalars ? sizeof( f32 ) : k_json_max_element_size );
+    }
+
+    result.allocator.init( allocator_size );
+    result.source_data = file_data;
+    result.source_allocator = heap_allocator;
+
+    // Second pass
+    JsonParser parser{ };
+    parser.text = json_text;
+    parser.cursor = json_text;
+    parser.end = json_text + json_length;
+    parser.containers = containers.data;
+    parser.containers_count = containers.size;
+    parser.next_container = 0;
+    parser.allocator = &result.allocator;
+    parser.error = false;
+
+    const bool parsed = parse_gltf( parser, result );
+    containers.shutdown();
+
+    if ( !parsed ) {
+        rprint( "Error: cannot parse %s, stopped at offset %llu.\n", file_path, ( u64 )( parser.cursor - json_text ) );
+    }
+
+    return result;
+}
+
 void gltf_free( glTF::glTF& scene ) {
     scene.allocator.shutdown();
+
+    if ( scene.source_data ) {
+        rfree( scene.source_data, scene.source_allocator );
+        scene.source_data = nullptr;
+    }
 }
 
 i32 gltf_get_attribute_accessor_index( glTF::MeshPrimitive::Attribute* attributes, u32 attribute_count, cstring attribute_name ) {
@@ -615,6 +1938,280 @@ i32 gltf_get_attribute_accessor_index( glTF::MeshPrimitive::Attribute* attribute
     return -1;
 }
 
+// Benchmark //////////////////////////////////////////////////////////////
+
+//
+// Growable text used to generate the synthetic scenes.
+struct GltfBenchmarkWriter {
+
+    void                            append_f( cstring format, ... ) {
+        for ( ;; ) {
+            va_list args;
+            va_start( args, format );
+            const i32 written = vsnprintf( data + size, capacity - size, format, args );
+            va_end( args );
+
+            if ( written >= 0 && size + written < capacity ) {
+                size += written;
+                return;
+            }
+
+            capacity = capacity * 2 + written;
+            data = ( char* )realloc( data, capacity );
+        }
+    }
+
+    char*                           data        = nullptr;
+    sizet                           size        = 0;
+    sizet                           capacity    = 0;
+}; // struct GltfBenchmarkWriter
+
+// Pretty printed like most exporters, with escaped names and unknown extras to skip.
+static void gltf_benchmark_generate( GltfBenchmarkWriter& writer, u32 node_count ) {
+    const u32 mesh_count = node_count / 4 + 1;
+    const u32 material_count = 16;
+
+    writer.append_f( "{\n  \"asset\" : {\n    \"generator\" : \"Raptor gltf benchmark\",\n    \"version\" : \"2.0\"\n  },\n" );
+    writer.append_f( "  \"scene\" : 0,\n  \"scenes\" : [\n    {\n      \"name\" : \"Scene\",\n      \"nodes\" : [ 0 ]\n    }\n  ],\n" );
+
+    writer.append_f( "  \"nodes\" : [\n" );
+    for ( u32 n = 0; n < node_count; ++n ) {
+        writer.append_f( "    {\n" );
+        if ( ( n % 16 ) == 0 ) {
+            writer.append_f( "      \"name\" : \"node \\\"%u\\\" \\u00e8\\ud83d\\ude00\\n\",\n", n );
+        } else {
+            writer.append_f( "      \"name\" : \"node_%u\",\n", n );
+        }
+        if ( ( n % 8 ) == 0 ) {
+            writer.append_f( "      \"extras\" : { \"tags\" : [ \"a\", { \"b\" : [ 1, 2, [ 3 ] ] } ], \"note\" : \"}]\" },\n" );
+        }
+        writer.append_f( "      \"mesh\" : %u,\n", n % mesh_count );
+        writer.append_f( "      \"translation\" : [ %.6g, %.6g, %.6g ],\n", n * 0.25f, -( f32 )n, n * 1.0e-3f );
+        writer.append_f( "      \"rotation\" : [ 0, 0.7071068, 0, 0.7071068 ],\n" );
+        writer.append_f( "      \"scale\" : [ 1, 1, 1.5e0 ]" );
+
+        // Four children per node, breadth first.
+        const u32 first_child = n * 4 + 1;
+        if ( first_child < node_count ) {
+            writer.append_f( ",\n      \"children\" : [" );
+            for ( u32 c = first_child; c < first_child + 4 && c < node_count; ++c ) {
+                writer.append_f( c == first_child ? " %u" : ", %u", c );
+            }
+            writer.append_f( " ]" );
+        }
+        writer.append_f( n + 1 < node_count ? "\n    },\n" : "\n    }\n" );
+    }
+    writer.append_f( "  ],\n" );
+
+    writer.append_f( "  \"meshes\" : [\n" );
+    for ( u32 m = 0; m < mesh_count; ++m ) {
+        writer.append_f( "    {\n      \"name\" : \"mesh_%u\",\n      \"primitives\" : [\n        {\n", m );
+        writer.append_f( "          \"attributes\" : { \"POSITION\" : %u, \"NORMAL\" : %u, \"TEXCOORD_0\" : %u },\n", m * 4, m * 4 + 1, m * 4 + 2 );
+        writer.append_f( "          \"indices\" : %u,\n          \"material\" : %u\n        }\n      ]\n", m * 4 + 3, m % material_count );
+        writer.append_f( m + 1 < mesh_count ? "    },\n" : "    }\n" );
+    }
+    writer.append_f( "  ],\n" );
+
+    cstring types[] = { "VEC3", "VEC3", "VEC2", "SCALAR" };
+    const u32 component_types[] = { 5126, 5126, 5126, 5123 };
+    writer.append_f( "  \"accessors\" : [\n" );
+    for ( u32 a = 0; a < mesh_count * 4; ++a ) {
+        writer.append_f( "    {\n      \"bufferView\" : %u,\n      \"componentType\" : %u,\n      \"count\" : %u,\n      \"type\" : \"%s\"", a, component_types[ a % 4 ], 24 + a % 100, types[ a % 4 ] );
+        if ( ( a % 4 ) == 0 ) {
+            writer.append_f( ",\n      \"max\" : [ 1.0, %.9g, 3.4028234663852886e+38 ],\n      \"min\" : [ -1.0, -0.5, -1e-7 ]", 0.1f * a );
+        }
+        writer.append_f( a + 1 < mesh_count * 4 ? "\n    },\n" : "\n    }\n" );
+    }
+    writer.append_f( "  ],\n" );
+
+    writer.append_f( "  \"bufferViews\" : [\n" );
+    for ( u32 b = 0; b < mesh_count * 4; ++b ) {
+        writer.append_f( "    { \"buffer\" : 0, \"byteLength\" : %u, \"byteOffset\" : %u, \"target\" : %u }%s\n", 288, b * 288, ( b % 4 ) == 3 ? 34963 : 34962, b + 1 < mesh_count * 4 ? "," : "" );
+    }
+    writer.append_f( "  ],\n" );
+
+    writer.append_f( "  \"materials\" : [\n" );
+    for ( u32 m = 0; m < material_count; ++m ) {
+        writer.append_f( "    {\n      \"name\" : \"material_%u\",\n      \"doubleSided\" : %s,\n      \"alphaMode\" : \"%s\",\n", m, ( m % 2 ) ? "true" : "false", ( m % 3 ) ? "OPAQUE" : "MASK" );
+        writer.append_f( "      \"normalTexture\" : { \"index\" : %u, \"scale\" : 0.5 },\n", m );
+        writer.append_f( "      \"pbrMetallicRoughness\" : {\n        \"baseColorFactor\" : [ 1, 0.5, 0.25, 1 ],\n        \"baseColorTexture\" : { \"index\" : %u },\n        \"metallicFactor\" : 0.%u\n      }\n", m, m );
+        writer.append_f( m + 1 < material_count ? "    },\n" : "    }\n" );
+    }
+    writer.append_f( "  ],\n" );
+
+    writer.append_f( "  \"textures\" : [\n" );
+    for ( u32 t = 0; t < material_count; ++t ) {
+        writer.append_f( "    { \"sampler\" : 0, \"source\" : %u }%s\n", t, t + 1 < material_count ? "," : "" );
+    }
+    writer.append_f( "  ],\n" );
+
+    writer.append_f( "  \"images\" : [\n" );
+    for ( u32 i = 0; i < material_count; ++i ) {
+        writer.append_f( "    { \"uri\" : \"textures/texture_%u.png\" }%s\n", i, i + 1 < material_count ? "," : "" );
+    }
+    writer.append_f( "  ],\n" );
+
+    writer.append_f( "  \"samplers\" : [ { \"magFilter\" : 9729, \"minFilter\" : 9987, \"wrapS\" : 10497, \"wrapT\" : 10497 } ],\n" );
+    writer.append_f( "  \"skins\" : [ { \"inverseBindMatrices\" : 0, \"joints\" : [ 1, 2, 3, 4 ] } ],\n" );
+    writer.append_f( "  \"animations\" : [\n    {\n      \"channels\" : [ { \"sampler\" : 0, \"target\" : { \"node\" : 1, \"path\" : \"rotation\" } } ],\n" );
+    writer.append_f( "      \"samplers\" : [ { \"input\" : 0, \"interpolation\" : \"STEP\", \"output\" : 1 } ]\n    }\n  ],\n" );
+    writer.append_f( "  \"buffers\" : [ { \"byteLength\" : %u, \"uri\" : \"benchmark.bin\" } ]\n}\n", mesh_count * 4 * 288 );
+}
+
+static bool gltf_benchmark_strings_equal( const StringBuffer& a, const StringBuffer& b ) {
+    if ( a.data == nullptr || b.data == nullptr ) {
+        return a.data == b.data;
+    }
+    return strcmp( a.data, b.data ) == 0;
+}
+
+// Values are compared, not bits: the DOM reads -0 as the integer 0.
+template <typename T>
+static bool gltf_benchmark_arrays_equal( u32 count_a, const T* a, u32 count_b, const T* b ) {
+    if ( count_a != count_b ) {
+        return false;
+    }
+    for ( u32 i = 0; i < count_a; ++i ) {
+        if ( a[ i ] != b[ i ] ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Checks the fields used by the engine.
+static bool gltf_benchmark_compare( const glTF::glTF& a, const glTF::glTF& b ) {
+    if ( a.nodes_count != b.nodes_count || a.meshes_count != b.meshes_count || a.accessors_count != b.accessors_count ||
+         a.buffer_views_count != b.buffer_views_count || a.materials_count != b.materials_count || a.scene != b.scene ||
+         a.animations_count != b.animations_count || a.skins_count != b.skins_count || a.buffers_count != b.buffers_count ) {
+        return false;
+    }
+
+    for ( u32 i = 0; i < a.nodes_count; ++i ) {
+        const glTF::Node& na = a.nodes[ i ];
+        const glTF::Node& nb = b.nodes[ i ];
+        if ( na.mesh != nb.mesh || na.skin != nb.skin || !gltf_benchmark_strings_equal( na.name, nb.name ) ||
+             !gltf_benchmark_arrays_equal( na.children_count, na.children, nb.children_count, nb.children ) ||
+             !gltf_benchmark_arrays_equal( na.translation_count, na.translation, nb.translation_count, nb.translation ) ||
+             !gltf_benchmark_arrays_equal( na.rotation_count, na.rotation, nb.rotation_count, nb.rotation ) ||
+             !gltf_benchmark_arrays_equal( na.scale_count, na.scale, nb.scale_count, nb.scale ) ) {
+            return false;
+        }
+    }
+
+    for ( u32 i = 0; i < a.meshes_count; ++i ) {
+        const glTF::MeshPrimitive& pa = a.meshes[ i ].primitives[ 0 ];
+        const glTF::MeshPrimitive& pb = b.meshes[ i ].primitives[ 0 ];
+        if ( pa.indices != pb.indices || pa.material != pb.material || pa.attribute_count != pb.attribute_count ) {
+            return false;
+        }
+        for ( u32 k = 0; k < pa.attribute_count; ++k ) {
+            if ( gltf_get_attribute_accessor_index( pb.attributes, pb.attribute_count, pa.attributes[ k ].key.data ) != pa.attributes[ k ].accessor_index ) {
+                return false;
+            }
+        }
+    }
+
+    for ( u32 i = 0; i < a.accessors_count; ++i ) {
+        const glTF::Accessor& aa = a.accessors[ i ];
+        const glTF::Accessor& ab = b.accessors[ i ];
+        if ( aa.buffer_view != ab.buffer_view || aa.component_type != ab.component_type || aa.count != ab.count || aa.type != ab.type ||
+             aa.byte_offset != ab.byte_offset || !gltf_benchmark_arrays_equal( aa.max_count, aa.max, ab.max_count, ab.max ) ||
+             !gltf_benchmark_arrays_equal( aa.min_count, aa.min, ab.min_count, ab.min ) ) {
+            return false;
+        }
+    }
+
+    for ( u32 i = 0; i < a.materials_count; ++i ) {
+        const glTF::Material& ma = a.materials[ i ];
+        const glTF::Material& mb = b.materials[ i ];
+        if ( ma.double_sided != mb.double_sided || ma.alpha_cutoff != mb.alpha_cutoff || !gltf_benchmark_strings_equal( ma.alpha_mode, mb.alpha_mode ) ||
+             ma.normal_texture->scale != mb.normal_texture->scale || ma.pbr_metallic_roughness->metallic_factor != mb.pbr_metallic_roughness->metallic_factor ||
+             ma.pbr_metallic_roughness->roughness_factor != mb.pbr_metallic_roughness->roughness_factor ||
+             ma.pbr_metallic_roughness->base_color_texture->index != mb.pbr_metallic_roughness->base_color_texture->index ) {
+            return false;
+        }
+    }
+
+    const glTF::AnimationSampler& sa = a.animations[ 0 ].samplers[ 0 ];
+    const glTF::AnimationSampler& sb = b.animations[ 0 ].samplers[ 0 ];
+    const glTF::AnimationChannel& ca = a.animations[ 0 ].channels[ 0 ];
+    const glTF::AnimationChannel& cb = b.animations[ 0 ].channels[ 0 ];
+
+    return sa.interpolation == sb.interpolation && sa.input_keyframe_buffer_index == sb.input_keyframe_buffer_index &&
+           ca.target_node == cb.target_node && ca.target_type == cb.target_type &&
+           gltf_benchmark_arrays_equal( a.skins[ 0 ].joints_count, a.skins[ 0 ].joints, b.skins[ 0 ].joints_count, b.skins[ 0 ].joints ) &&
+           gltf_benchmark_strings_equal( a.buffers[ 0 ].uri, b.buffers[ 0 ].uri ) && a.buffers[ 0 ].byte_length == b.buffers[ 0 ].byte_length;
+}
+
+void gltf_parse_benchmark( u32 max_nodes ) {
+    cstring gltf_path = "gltf_parse_benchmark.gltf";
+    cstring glb_path = "gltf_parse_benchmark.glb";
+
+    rprint( "glTF parse benchmark, json DOM / streaming parser, %s scanning.\n",
+#if defined(RAPTOR_JSON_SSE2)
+            "SSE2"
+#else
+            "scalar"
+#endif // RAPTOR_JSON_SSE2
+    );
+
+    for ( u32 node_count = 10000; node_count <= max_nodes; node_count *= 10 ) {
+        GltfBenchmarkWriter writer;
+        gltf_benchmark_generate( writer, node_count );
+        file_write_binary( gltf_path, writer.data, writer.size );
+
+        i64 start = time_now();
+        glTF::glTF dom_scene = gltf_load_file_dom( gltf_path );
+        const f64 dom_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        glTF::glTF streaming_scene = gltf_load_file( gltf_path );
+        const f64 streaming_ms = time_from_milliseconds( start );
+
+        const bool text_equal = gltf_benchmark_compare( dom_scene, streaming_scene );
+
+        // Same json in a binary container, the json chunk is padded with spaces.
+        const u32 json_length = ( u32 )memory_align( writer.size, 4 );
+        const u32 bin_length = 256;
+        GlbHeader header{ k_glb_magic, 2, ( u32 )( sizeof( GlbHeader ) + sizeof( GlbChunk ) * 2 + json_length + bin_length ) };
+        GlbChunk json_chunk{ json_length, k_glb_chunk_json };
+        GlbChunk bin_chunk{ bin_length, k_glb_chunk_bin };
+
+        GltfBenchmarkWriter glb;
+        glb.capacity = header.length;
+        glb.data = ( char* )malloc( glb.capacity );
+        memset( glb.data, ' ', glb.capacity );
+        memcpy( glb.data, &header, sizeof( GlbHeader ) );
+        memcpy( glb.data + sizeof( GlbHeader ), &json_chunk, sizeof( GlbChunk ) );
+        memcpy( glb.data + sizeof( GlbHeader ) + sizeof( GlbChunk ), writer.data, writer.size );
+        memcpy( glb.data + sizeof( GlbHeader ) + sizeof( GlbChunk ) + json_length, &bin_chunk, sizeof( GlbChunk ) );
+        file_write_binary( glb_path, glb.data, header.length );
+
+        start = time_now();
+        glTF::glTF glb_scene = gltf_load_file( glb_path );
+        const f64 glb_ms = time_from_milliseconds( start );
+
+        const bool glb_equal = gltf_benchmark_compare( dom_scene, glb_scene ) && glb_scene.binary_chunk_size == bin_length;
+
+        rprint( "%7u nodes, %6.1f MB | parse %8.2f ms / %7.2f ms (%4.1fx) | output %6.1f MB / %6.1f MB | glb %7.2f ms | %s\n",
+                node_count, writer.size / ( 1024.0 * 1024.0 ), dom_ms, streaming_ms, dom_ms / streaming_ms,
+                dom_scene.allocator.allocated_size / ( 1024.0 * 1024.0 ), streaming_scene.allocator.allocated_size / ( 1024.0 * 1024.0 ),
+                glb_ms, text_equal && glb_equal ? "match" : "MISMATCH" );
+        RASSERTM( text_equal && glb_equal, "glTF streaming parser differs from the DOM loader" );
+
+        gltf_free( glb_scene );
+        gltf_free( streaming_scene );
+        gltf_free( dom_scene );
+
+        free( glb.data );
+        free( writer.data );
+
+        file_delete( glb_path );
+        file_delete( gltf_path );
+    }
+}
+
 } // namespace raptor
 
 i32 raptor::glTF::get_data_offset( i32 accessor_offset, i32 buffer_view_offset ) {
@@ -311,16 +311,29 @@ namespace glTF {
         Texture*                    textures;
 
         LinearAllocator             allocator;
+
+        // Json text kept alive by the streaming loader: strings point into it.
+        char*                       source_data;
+        Allocator*                  source_allocator;
+        // .glb binary chunk, used by the buffer without uri.
+        u8*                         binary_chunk;
+        u32                         binary_chunk_size;
     };
 
     i32                             get_data_offset( i32 accessor_offset, i32 buffer_view_offset );
 
 } // namespace glTF
 
+    // Streaming parser for .gltf and .glb files, without a json DOM. Strings are not copied.
     glTF::glTF                      gltf_load_file( cstring file_path );
+    // Previous nlohmann::json based loader, kept for comparison.
+    glTF::glTF                      gltf_load_file_dom( cstring file_path );
 
     void                            gltf_free( glTF::glTF& scene );
 
     i32                             gltf_get_attribute_accessor_index( glTF::MeshPrimitive::Attribute* attributes, u32 attribute_count, cstring attribute_name );
 
+    // Times both loaders on generated scenes, from 10K nodes up to max_nodes, and checks they match.
+    void                            gltf_parse_benchmark( u32 max_nodes );
+
 } // namespace raptor
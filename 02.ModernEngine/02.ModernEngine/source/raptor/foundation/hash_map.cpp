@@ -0,0 +1,226 @@
+#include "foundation/hash_map.hpp"
+#include "foundation/time.hpp"
+#include "foundation/log.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unordered_map>
+
+namespace raptor {
+
+// Benchmark //////////////////////////////////////////////////////////////
+
+static const u32            k_benchmark_name_length = 24;
+
+static u64 benchmark_random( u64& state ) {
+    // splitmix64
+    u64 z = ( state += 0x9E3779B97F4A7C15ull );
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+    return z ^ ( z >> 31 );
+}
+
+//
+//
+struct HashMapBenchmarkTimings {
+    f64                     insert_ms;
+    f64                     find_ms;
+    f64                     find_missing_ms;
+    f64                     iterate_ms;
+    f64                     erase_ms;
+    u64                     checksum;       // Keeps the optimizer from removing the lookups.
+}; // struct HashMapBenchmarkTimings
+
+static void print_timings( cstring name, u64 count, const HashMapBenchmarkTimings& raptor_timings, const HashMapBenchmarkTimings& std_timings ) {
+    const f64 to_ns = 1000000.0 / count;
+    rprint( "%-8s %9llu | insert %7.1f / %7.1f | find %7.1f / %7.1f | miss %7.1f / %7.1f | iterate %5.1f / %5.1f | erase %7.1f / %7.1f\n", name, count,
+            raptor_timings.insert_ms * to_ns, std_timings.insert_ms * to_ns, raptor_timings.find_ms * to_ns, std_timings.find_ms * to_ns,
+            raptor_timings.find_missing_ms * to_ns, std_timings.find_missing_ms * to_ns, raptor_timings.iterate_ms * to_ns, std_timings.iterate_ms * to_ns,
+            raptor_timings.erase_ms * to_ns, std_timings.erase_ms * to_ns );
+}
+
+static void benchmark_u64_keys( Allocator* allocator, const u64* keys, u64 count ) {
+    HashMapBenchmarkTimings raptor_timings{}, std_timings{};
+
+    {
+        FlatHashMap<u64, u64> map;
+        map.init( allocator, 16 );
+
+        i64 start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            map.insert( keys[ i ], i );
+        }
+        raptor_timings.insert_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            raptor_timings.checksum += map.get( keys[ i ] );
+        }
+        raptor_timings.find_ms = time_from_milliseconds( start );
+
+        // Upper half of the keys array was never inserted.
+        start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            raptor_timings.checksum += map.find( keys[ count + i ] ).is_valid();
+        }
+        raptor_timings.find_missing_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( FlatHashMapIterator it = map.iterator_begin(); it.is_valid(); map.iterator_advance( it ) ) {
+            raptor_timings.checksum += map.get( it );
+        }
+        raptor_timings.iterate_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            map.remove( keys[ i ] );
+        }
+        raptor_timings.erase_ms = time_from_milliseconds( start );
+
+        map.shutdown();
+    }
+
+    {
+        std::unordered_map<u64, u64> map;
+
+        i64 start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            map[ keys[ i ] ] = i;
+        }
+        std_timings.insert_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            std_timings.checksum += map.find( keys[ i ] )->second;
+        }
+        std_timings.find_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            std_timings.checksum += map.find( keys[ count + i ] ) != map.end();
+        }
+        std_timings.find_missing_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( const auto& it : map ) {
+            std_timings.checksum += it.second;
+        }
+        std_timings.iterate_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            map.erase( keys[ i ] );
+        }
+        std_timings.erase_ms = time_from_milliseconds( start );
+    }
+
+    RASSERTM( raptor_timings.checksum == std_timings.checksum, "Hash map benchmark mismatch" );
+    print_timings( "u64", count, raptor_timings, std_timings );
+}
+
+// String keys are stored the way the engine does it: the map is keyed by the hash
+// of the name, so each operation pays for hashing the string.
+static void benchmark_string_keys( Allocator* allocator, const char* names, u64 count ) {
+    HashMapBenchmarkTimings raptor_timings{}, std_timings{};
+
+    {
+        FlatHashMap<u64, u64> map;
+        map.init( allocator, 16 );
+
+        i64 start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            map.insert( hash_calculate( names + i * k_benchmark_name_length ), i );
+        }
+        raptor_timings.insert_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            raptor_timings.checksum += map.get( hash_calculate( names + i * k_benchmark_name_length ) );
+        }
+        raptor_timings.find_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            raptor_timings.checksum += map.find( hash_calculate( names + ( count + i ) * k_benchmark_name_length ) ).is_valid();
+        }
+        raptor_timings.find_missing_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( FlatHashMapIterator it = map.iterator_begin(); it.is_valid(); map.iterator_advance( it ) ) {
+            raptor_timings.checksum += map.get( it );
+        }
+        raptor_timings.iterate_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            map.remove( hash_calculate( names + i * k_benchmark_name_length ) );
+        }
+        raptor_timings.erase_ms = time_from_milliseconds( start );
+
+        map.shutdown();
+    }
+
+    {
+        std::unordered_map<std::string, u64> map;
+
+        i64 start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            map[ names + i * k_benchmark_name_length ] = i;
+        }
+        std_timings.insert_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            std_timings.checksum += map.find( names + i * k_benchmark_name_length )->second;
+        }
+        std_timings.find_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            std_timings.checksum += map.find( names + ( count + i ) * k_benchmark_name_length ) != map.end();
+        }
+        std_timings.find_missing_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( const auto& it : map ) {
+            std_timings.checksum += it.second;
+        }
+        std_timings.iterate_ms = time_from_milliseconds( start );
+
+        start = time_now();
+        for ( u64 i = 0; i < count; ++i ) {
+            map.erase( names + i * k_benchmark_name_length );
+        }
+        std_timings.erase_ms = time_from_milliseconds( start );
+    }
+
+    RASSERTM( raptor_timings.checksum == std_timings.checksum, "Hash map benchmark mismatch" );
+    print_timings( "string", count, raptor_timings, std_timings );
+}
+
+void hash_map_benchmark( u64 max_entries ) {
+    MallocAllocator malloc_allocator;
+
+    // Twice the entries: the second half is used for missing lookups.
+    u64* keys = ( u64* )malloc( sizeof( u64 ) * max_entries * 2 );
+    char* names = ( char* )malloc( k_benchmark_name_length * max_entries * 2 );
+
+    u64 random_state = 0x31d3a36013e;
+    for ( u64 i = 0; i < max_entries * 2; ++i ) {
+        keys[ i ] = benchmark_random( random_state );
+        snprintf( names + i * k_benchmark_name_length, k_benchmark_name_length, "resource_%llu", ( unsigned long long )keys[ i ] % 100000000000000ull );
+    }
+
+    rprint( "FlatHashMap benchmark, %u slots groups. ns per operation, FlatHashMap / std::unordered_map.\n", ( u32 )ProbeSequence::k_width );
+
+    for ( u64 count = 1000; count <= max_entries; count *= 10 ) {
+        benchmark_u64_keys( &malloc_allocator, keys, count );
+        benchmark_string_keys( &malloc_allocator, names, count );
+    }
+
+    free( names );
+    free( keys );
+}
+
+} // namespace raptor
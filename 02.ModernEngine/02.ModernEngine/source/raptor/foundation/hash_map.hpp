@@ -3,9 +3,41 @@
 #include "foundation/memory.hpp"
 #include "foundation/assert.hpp"
 #include "foundation/bit.hpp"
+#include "foundation/string.hpp"
 
 #include "external/wyhash.h"
 
+// Group selection ////////////////////////////////////////////////////////
+// Control bytes are matched a group at a time. Define one of RAPTOR_HASH_MAP_GROUP_AVX2,
+// RAPTOR_HASH_MAP_GROUP_SSE2, RAPTOR_HASH_MAP_GROUP_NEON or RAPTOR_HASH_MAP_GROUP_PORTABLE
+// to force an implementation, otherwise the best one for the target is picked.
+// AVX2 uses 32 slots groups and needs to be opted in.
+#if !defined(RAPTOR_HASH_MAP_GROUP_AVX2) && !defined(RAPTOR_HASH_MAP_GROUP_SSE2) && !defined(RAPTOR_HASH_MAP_GROUP_NEON) && !defined(RAPTOR_HASH_MAP_GROUP_PORTABLE)
+    #if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+        #define RAPTOR_HASH_MAP_GROUP_SSE2
+    #elif defined(__ARM_NEON) && defined(__aarch64__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        #define RAPTOR_HASH_MAP_GROUP_NEON
+    #else
+        #define RAPTOR_HASH_MAP_GROUP_PORTABLE
+    #endif
+#endif
+
+#if defined(RAPTOR_HASH_MAP_GROUP_AVX2)
+    #include <immintrin.h>
+    #define RAPTOR_HASH_MAP_GROUP_WIDTH     32
+#elif defined(RAPTOR_HASH_MAP_GROUP_SSE2)
+    #include <emmintrin.h>
+    #if defined(__SSSE3__)
+        #include <tmmintrin.h>
+    #endif
+    #define RAPTOR_HASH_MAP_GROUP_WIDTH     16
+#elif defined(RAPTOR_HASH_MAP_GROUP_NEON)
+    #include <arm_neon.h>
+    #define RAPTOR_HASH_MAP_GROUP_WIDTH     8
+#else
+    #define RAPTOR_HASH_MAP_GROUP_WIDTH     8
+#endif
+
 namespace raptor {
 
 
@@ -44,7 +76,7 @@ namespace raptor {
     // Probing ////////////////////////////////////////////////////////////
     struct ProbeSequence {
 
-        static const u64            k_width = 16;   // TODO: this should be selectable.
+        static const u64            k_width = RAPTOR_HASH_MAP_GROUP_WIDTH;
         static const sizet          k_engine_hash = 0x31d3a36013e;
 
         ProbeSequence( u64 hash, u64 mask );
@@ -83,6 +115,14 @@ namespace raptor {
         V&                          get( const K& key );
         V&                          get( const FlatHashMapIterator& it );
 
+        // Lookups with a precomputed hash_calculate( key ), to hoist hashing out of hot loops.
+        FlatHashMapIterator         find_hashed( u64 hash, const K& key );
+        V&                          get_hashed( u64 hash, const K& key );
+
+        // For maps keyed by the hash of a name: hashes the view without needing a null terminated string.
+        FlatHashMapIterator         find( const StringView& name );
+        V&                          get( const StringView& name );
+
         KeyValue&                   get_structure( const K& key );
         KeyValue&                   get_structure( const FlatHashMapIterator& it );
 
@@ -98,7 +138,7 @@ namespace raptor {
         // Internal methods
         void                        erase_meta( const FlatHashMapIterator& iterator );
 
-        FindResult                  find_or_prepare_insert( const K& key );
+        FindResult                  find_or_prepare_insert( const K& key, u64 hash );
         FindInfo                    find_first_non_full( u64 hash );
 
         u64                         prepare_insert( u64 hash );
@@ -156,6 +196,78 @@ namespace raptor {
         return wyhash( data, length, seed, _wyp );
     }
 
+    // Compile time hashing ///////////////////////////////////////////////
+    // constexpr version of wyhash, giving the same value as hash_calculate( cstring )
+    // and hash_bytes on little endian targets.
+    constexpr u64 hash_wyhash_secret[ 4 ] = { 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull };
+
+    constexpr u64 hash_wymix_constexpr( u64 a, u64 b ) {
+        // 64x64 -> 128 multiply, then xor of the halves.
+        const u64 ha = a >> 32, hb = b >> 32, la = ( u32 )a, lb = ( u32 )b;
+        const u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+        const u64 t = rl + ( rm0 << 32 );
+        u64 c = t < rl;
+        const u64 lo = t + ( rm1 << 32 );
+        c += lo < t;
+        const u64 hi = rh + ( rm0 >> 32 ) + ( rm1 >> 32 ) + c;
+        return lo ^ hi;
+    }
+
+    constexpr u64 hash_read_constexpr( cstring p, u32 bytes ) {
+        u64 value = 0;
+        for ( u32 i = 0; i < bytes; ++i ) {
+            value |= ( u64 )( u8 )p[ i ] << ( i * 8 );
+        }
+        return value;
+    }
+
+    constexpr u64 hash_bytes_constexpr( cstring p, sizet length, u64 seed = 0 ) {
+        const u64* secret = hash_wyhash_secret;
+        seed ^= secret[ 0 ];
+        u64 a = 0, b = 0;
+        if ( length <= 16 ) {
+            if ( length >= 4 ) {
+                a = ( hash_read_constexpr( p, 4 ) << 32 ) | hash_read_constexpr( p + ( ( length >> 3 ) << 2 ), 4 );
+                b = ( hash_read_constexpr( p + length - 4, 4 ) << 32 ) | hash_read_constexpr( p + length - 4 - ( ( length >> 3 ) << 2 ), 4 );
+            } else if ( length > 0 ) {
+                a = ( ( u64 )( u8 )p[ 0 ] << 16 ) | ( ( u64 )( u8 )p[ length >> 1 ] << 8 ) | ( u8 )p[ length - 1 ];
+            }
+        } else {
+            sizet i = length;
+            if ( i > 48 ) {
+                u64 see1 = seed, see2 = seed;
+                do {
+                    seed = hash_wymix_constexpr( hash_read_constexpr( p, 8 ) ^ secret[ 1 ], hash_read_constexpr( p + 8, 8 ) ^ seed );
+                    see1 = hash_wymix_constexpr( hash_read_constexpr( p + 16, 8 ) ^ secret[ 2 ], hash_read_constexpr( p + 24, 8 ) ^ see1 );
+                    see2 = hash_wymix_constexpr( hash_read_constexpr( p + 32, 8 ) ^ secret[ 3 ], hash_read_constexpr( p + 40, 8 ) ^ see2 );
+                    p += 48;
+                    i -= 48;
+                } while ( i > 48 );
+                seed ^= see1 ^ see2;
+            }
+            while ( i > 16 ) {
+                seed = hash_wymix_constexpr( hash_read_constexpr( p, 8 ) ^ secret[ 1 ], hash_read_constexpr( p + 8, 8 ) ^ seed );
+                i -= 16;
+                p += 16;
+            }
+            a = hash_read_constexpr( p + i - 16, 8 );
+            b = hash_read_constexpr( p + i - 8, 8 );
+        }
+        return hash_wymix_constexpr( secret[ 1 ] ^ length, hash_wymix_constexpr( a ^ secret[ 1 ], b ^ seed ) );
+    }
+
+    template <u64 value>
+    struct HashConstant {
+        static constexpr u64        k_value = value;
+    }; // struct HashConstant
+
+// Hash of a string literal, always computed at compile time.
+#define rhash( string_literal )     ( raptor::HashConstant<raptor::hash_bytes_constexpr( string_literal, sizeof( string_literal ) - 1 )>::k_value )
+
+    // Prints per operation timings against std::unordered_map, for u64 and string keys,
+    // from 1K entries up to max_entries.
+    void                            hash_map_benchmark( u64 max_entries );
+
     // https://gankra.github.io/blah/hashbrown-tldr/
     // https://blog.waffles.space/2018/12/07/deep-dive-into-hashbrown/
     // https://abseil.io/blog/20180927-swisstables
@@ -187,6 +299,59 @@ namespace raptor {
     static i8               hash_2( u64 hash )                  { return hash & 0x7F; }
 
 
+    // Groups ///////////////////////////////////////////////////////////////
+    static const u64        k_group_msbs = 0x8080808080808080ull;
+    static const u64        k_group_lsbs = 0x0101010101010101ull;
+
+#if defined(RAPTOR_HASH_MAP_GROUP_AVX2)
+    struct GroupAvx2Impl {
+        static constexpr size_t kWidth = 32;  // the number of slots per group
+
+        explicit GroupAvx2Impl( const i8* pos ) {
+            ctrl = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( pos ) );
+        }
+
+        // Returns a bitmask representing the positions of slots that match hash.
+        BitMask<uint32_t, kWidth> Match( i8 hash ) const {
+            auto match = _mm256_set1_epi8( hash );
+            return BitMask<uint32_t, kWidth>(
+                static_cast< uint32_t >( _mm256_movemask_epi8( _mm256_cmpeq_epi8( match, ctrl ) ) ) );
+        }
+
+        // Returns a bitmask representing the positions of empty slots.
+        BitMask<uint32_t, kWidth> MatchEmpty() const {
+            return BitMask<uint32_t, kWidth>(
+                static_cast< uint32_t >( _mm256_movemask_epi8( _mm256_sign_epi8( ctrl, ctrl ) ) ) );
+        }
+
+        // Returns a bitmask representing the positions of empty or deleted slots.
+        BitMask<uint32_t, kWidth> MatchEmptyOrDeleted() const {
+            auto special = _mm256_set1_epi8( k_control_bitmask_sentinel );
+            return BitMask<uint32_t, kWidth>(
+                static_cast< uint32_t >( _mm256_movemask_epi8( _mm256_cmpgt_epi8( special, ctrl ) ) ) );
+        }
+
+        // Returns the number of trailing empty or deleted elements in the group.
+        uint32_t CountLeadingEmptyOrDeleted() const {
+            auto special = _mm256_set1_epi8( k_control_bitmask_sentinel );
+            // Widen before adding one, a group made only of empty or deleted slots would overflow.
+            const u64 mask = static_cast< uint32_t >( _mm256_movemask_epi8( _mm256_cmpgt_epi8( special, ctrl ) ) );
+            return static_cast< uint32_t >( trailing_zeros_u64( mask + 1 ) );
+        }
+
+        void ConvertSpecialToEmptyAndFullToDeleted( i8* dst ) const {
+            auto msbs = _mm256_set1_epi8( static_cast< char >( -128 ) );
+            auto x126 = _mm256_set1_epi8( 126 );
+            auto res = _mm256_or_si256( _mm256_shuffle_epi8( x126, ctrl ), msbs );
+            _mm256_storeu_si256( reinterpret_cast< __m256i* >( dst ), res );
+        }
+
+        __m256i ctrl;
+    }; // struct GroupAvx2Impl
+
+    typedef GroupAvx2Impl   Group;
+
+#elif defined(RAPTOR_HASH_MAP_GROUP_SSE2)
     struct GroupSse2Impl {
         static constexpr size_t kWidth = 16;  // the number of slots per group
 
@@ -203,7 +368,7 @@ namespace raptor {
 
         // Returns a bitmask representing the positions of empty slots.
         BitMask<uint32_t, kWidth> MatchEmpty() const {
-#if ABSL_INTERNAL_RAW_HASH_SET_HAVE_SSSE3
+#if defined(__SSSE3__)
     // This only works because kEmpty is -128.
             return BitMask<uint32_t, kWidth>(
                 _mm_movemask_epi8( _mm_sign_epi8( ctrl, ctrl ) ) );
@@ -229,7 +394,7 @@ namespace raptor {
         void ConvertSpecialToEmptyAndFullToDeleted( i8* dst ) const {
             auto msbs = _mm_set1_epi8( static_cast< char >( -128 ) );
             auto x126 = _mm_set1_epi8( 126 );
-#if ABSL_INTERNAL_RAW_HASH_SET_HAVE_SSSE3
+#if defined(__SSSE3__)
             auto res = _mm_or_si128( _mm_shuffle_epi8( x126, ctrl ), msbs );
 #else
             auto zero = _mm_setzero_si128();
@@ -240,7 +405,105 @@ namespace raptor {
         }
 
         __m128i ctrl;
-    };
+    }; // struct GroupSse2Impl
+
+    typedef GroupSse2Impl   Group;
+
+#elif defined(RAPTOR_HASH_MAP_GROUP_NEON)
+    struct GroupNeonImpl {
+        static constexpr size_t kWidth = 8;  // the number of slots per group
+
+        explicit GroupNeonImpl( const i8* pos ) {
+            ctrl = vld1_s8( pos );
+        }
+
+        // Returns a bitmask representing the positions of slots that match hash.
+        BitMask<uint64_t, kWidth, 3> Match( i8 hash ) const {
+            uint8x8_t mask = vceq_s8( ctrl, vdup_n_s8( hash ) );
+            return BitMask<uint64_t, kWidth, 3>( vget_lane_u64( vreinterpret_u64_u8( mask ), 0 ) & k_group_msbs );
+        }
+
+        // Returns a bitmask representing the positions of empty slots.
+        BitMask<uint64_t, kWidth, 3> MatchEmpty() const {
+            uint8x8_t mask = vceq_s8( ctrl, vdup_n_s8( k_control_bitmask_empty ) );
+            return BitMask<uint64_t, kWidth, 3>( vget_lane_u64( vreinterpret_u64_u8( mask ), 0 ) & k_group_msbs );
+        }
+
+        // Returns a bitmask representing the positions of empty or deleted slots.
+        BitMask<uint64_t, kWidth, 3> MatchEmptyOrDeleted() const {
+            uint8x8_t mask = vcgt_s8( vdup_n_s8( k_control_bitmask_sentinel ), ctrl );
+            return BitMask<uint64_t, kWidth, 3>( vget_lane_u64( vreinterpret_u64_u8( mask ), 0 ) & k_group_msbs );
+        }
+
+        // Returns the number of trailing empty or deleted elements in the group.
+        uint32_t CountLeadingEmptyOrDeleted() const {
+            uint8x8_t mask = vcle_s8( vdup_n_s8( k_control_bitmask_sentinel ), ctrl );
+            const u64 full_or_sentinel = vget_lane_u64( vreinterpret_u64_u8( mask ), 0 );
+            return full_or_sentinel ? static_cast< uint32_t >( trailing_zeros_u64( full_or_sentinel ) >> 3 ) : kWidth;
+        }
+
+        void ConvertSpecialToEmptyAndFullToDeleted( i8* dst ) const {
+            const u64 bytes = vget_lane_u64( vreinterpret_u64_s8( ctrl ), 0 );
+            const u64 x = bytes & k_group_msbs;
+            const u64 res = ( ~x + ( x >> 7 ) ) & ~k_group_lsbs;
+            memcpy( dst, &res, sizeof( res ) );
+        }
+
+        int8x8_t ctrl;
+    }; // struct GroupNeonImpl
+
+    typedef GroupNeonImpl   Group;
+
+#else
+    // Plain 64 bit arithmetic on 8 control bytes, assumes a little endian target.
+    // Match can report false positives for bytes next to a real match, they are
+    // filtered by the key comparison.
+    struct GroupPortableImpl {
+        static constexpr size_t kWidth = 8;  // the number of slots per group
+
+        explicit GroupPortableImpl( const i8* pos ) {
+            memcpy( &ctrl, pos, sizeof( ctrl ) );
+        }
+
+        // Returns a bitmask representing the positions of slots that match hash.
+        BitMask<uint64_t, kWidth, 3> Match( i8 hash ) const {
+            const u64 x = ctrl ^ ( k_group_lsbs * static_cast< u8 >( hash ) );
+            return BitMask<uint64_t, kWidth, 3>( ( x - k_group_lsbs ) & ~x & k_group_msbs );
+        }
+
+        // Returns a bitmask representing the positions of empty slots.
+        BitMask<uint64_t, kWidth, 3> MatchEmpty() const {
+            // Only empty has the high bit set and bit 1 cleared.
+            return BitMask<uint64_t, kWidth, 3>( ( ctrl & ~( ctrl << 6 ) ) & k_group_msbs );
+        }
+
+        // Returns a bitmask representing the positions of empty or deleted slots.
+        BitMask<uint64_t, kWidth, 3> MatchEmptyOrDeleted() const {
+            // Sentinel is the only special byte with bit 0 set.
+            return BitMask<uint64_t, kWidth, 3>( ( ctrl & ~( ctrl << 7 ) ) & k_group_msbs );
+        }
+
+        // Returns the number of trailing empty or deleted elements in the group.
+        uint32_t CountLeadingEmptyOrDeleted() const {
+            const u64 gaps = 0x00FEFEFEFEFEFEFEull;
+            const u64 x = ( ( ~ctrl & ( ctrl >> 7 ) ) | gaps ) + 1;
+            return x ? static_cast< uint32_t >( ( trailing_zeros_u64( x ) + 7 ) >> 3 ) : kWidth;
+        }
+
+        void ConvertSpecialToEmptyAndFullToDeleted( i8* dst ) const {
+            const u64 x = ctrl & k_group_msbs;
+            const u64 res = ( ~x + ( x >> 7 ) ) & ~k_group_lsbs;
+            memcpy( dst, &res, sizeof( res ) );
+        }
+
+        u64 ctrl;
+    }; // struct GroupPortableImpl
+
+    typedef GroupPortableImpl Group;
+
+#endif // RAPTOR_HASH_MAP_GROUP_AVX2
+
+    static_assert( Group::kWidth == ProbeSequence::k_width, "Probe sequence and group width must match" );
 
     // Capacity ///////////////////////////////////////////////////////////
 
@@ -269,11 +532,11 @@ namespace raptor {
     static void ConvertDeletedToEmptyAndFullToDeleted( i8* ctrl, size_t capacity ) {
         //assert( ctrl[ capacity ] == k_control_bitmask_sentinel );
         //assert( IsValidCapacity( capacity ) );
-        for ( i8* pos = ctrl; pos != ctrl + capacity + 1; pos += GroupSse2Impl::kWidth ) {
-            GroupSse2Impl{ pos }.ConvertSpecialToEmptyAndFullToDeleted( pos );
+        for ( i8* pos = ctrl; pos != ctrl + capacity + 1; pos += Group::kWidth ) {
+            Group{ pos }.ConvertSpecialToEmptyAndFullToDeleted( pos );
         }
         // Copy the cloned ctrl bytes.
-        raptor::memory_copy( ctrl + capacity + 1, ctrl, GroupSse2Impl::kWidth );
+        raptor::memory_copy( ctrl + capacity + 1, ctrl, Group::kWidth );
         ctrl[ capacity ] = k_control_bitmask_sentinel;
     }
 
@@ -281,7 +544,7 @@ namespace raptor {
     // FlatHashMap ////////////////////////////////////////////////////////
     template <typename K, typename V>
     void FlatHashMap<K,V>::reset_ctrl() {
-        memset( control_bytes, k_control_bitmask_empty, capacity + GroupSse2Impl::kWidth );
+        memset( control_bytes, k_control_bitmask_empty, capacity + Group::kWidth );
         control_bytes[ capacity ] = k_control_bitmask_sentinel;
         //SanitizerPoisonMemoryRegion( slots_, sizeof( slot_type ) * capacity_ );
     }
@@ -314,12 +577,16 @@ namespace raptor {
 
     template <typename K, typename V>
     FlatHashMapIterator FlatHashMap<K, V>::find( const K& key ) {
+        return find_hashed( hash_calculate( key ), key );
+    }
+
+    template <typename K, typename V>
+    FlatHashMapIterator FlatHashMap<K, V>::find_hashed( u64 hash, const K& key ) {
 
-        const u64 hash = hash_calculate( key );
         ProbeSequence sequence = probe( hash );
 
         while ( true ) {
-            const GroupSse2Impl group{ control_bytes + sequence.get_offset() };
+            const Group group{ control_bytes + sequence.get_offset() };
             const i8 hash2 = hash_2( hash );
             for ( int i : group.Match( hash2 ) ) {
                 const KeyValue& key_value = *( slots_ + sequence.get_offset( i ) );
@@ -339,7 +606,7 @@ namespace raptor {
 
     template <typename K, typename V>
     void FlatHashMap<K, V>::insert( const K& key, const V& value ) {
-        const FindResult find_result = find_or_prepare_insert( key );
+        const FindResult find_result = find_or_prepare_insert( key, hash_calculate( key ) );
         if ( find_result.free_index ) {
             // Emplace
             slots_[ find_result.index ].key = key;
@@ -355,9 +622,9 @@ namespace raptor {
         --size;
 
         const u64 index = iterator.index;
-        const u64 index_before = ( index - GroupSse2Impl::kWidth ) & capacity;
-        const auto empty_after = GroupSse2Impl( control_bytes + index ).MatchEmpty();
-        const auto empty_before = GroupSse2Impl( control_bytes + index_before ).MatchEmpty();
+        const u64 index_before = ( index - Group::kWidth ) & capacity;
+        const auto empty_after = Group( control_bytes + index ).MatchEmpty();
+        const auto empty_before = Group( control_bytes + index_before ).MatchEmpty();
 
         // We count how many consecutive non empties we have to the right and to the
         // left of `it`. If the sum is >= kWidth then there is at least one probe
@@ -367,7 +634,7 @@ namespace raptor {
         const u64 zeros = trailing_zeros + leading_zeros;
         //printf( "%x, %x", empty_after.TrailingZeros(), empty_before.LeadingZeros() );
         bool was_never_full = empty_before && empty_after;
-        was_never_full = was_never_full && (zeros < GroupSse2Impl::kWidth);
+        was_never_full = was_never_full && (zeros < Group::kWidth);
 
         set_ctrl( index, was_never_full ? k_control_bitmask_empty : k_control_bitmask_deleted );
         growth_left += was_never_full;
@@ -393,12 +660,11 @@ namespace raptor {
     }
 
     template <typename K, typename V>
-    FindResult FlatHashMap<K, V>::find_or_prepare_insert( const K& key ) {
-        u64 hash = hash_calculate( key );
+    FindResult FlatHashMap<K, V>::find_or_prepare_insert( const K& key, u64 hash ) {
         ProbeSequence sequence = probe( hash );
 
         while ( true ) {
-            const GroupSse2Impl group{ control_bytes + sequence.get_offset() };
+            const Group group{ control_bytes + sequence.get_offset() };
             for ( int i : group.Match( hash_2( hash ) ) ) {
                 const KeyValue& key_value = *( slots_ + sequence.get_offset( i ) );
                 if ( key_value.key == key )
@@ -419,7 +685,7 @@ namespace raptor {
         ProbeSequence sequence = probe( hash );
 
         while ( true ) {
-            const GroupSse2Impl group{ control_bytes + sequence.get_offset() };
+            const Group group{ control_bytes + sequence.get_offset() };
             auto mask = group.MatchEmptyOrDeleted();
 
             if ( mask ) {
@@ -499,7 +765,7 @@ namespace raptor {
             // If they do, we don't need to move the object as it falls already in the
             // best probe we can.
             const auto probe_index = [&]( size_t pos ) {
-                return ( ( pos - probe( hash ).get_offset() ) & capacity ) / GroupSse2Impl::kWidth;
+                return ( ( pos - probe( hash ).get_offset() ) & capacity ) / Group::kWidth;
             };
 
             // Element doesn't move.
@@ -531,7 +797,7 @@ namespace raptor {
 
     template <typename K, typename V>
     u64 FlatHashMap<K, V>::calculate_size( u64 new_capacity ) {
-        return ( new_capacity + GroupSse2Impl::kWidth + new_capacity * ( sizeof( KeyValue ) ) );
+        return ( new_capacity + Group::kWidth + new_capacity * ( sizeof( KeyValue ) ) );
     }
 
     template <typename K, typename V>
@@ -540,7 +806,7 @@ namespace raptor {
         char* new_memory = ( char* )ralloca( calculate_size( capacity ), allocator );
 
         control_bytes = reinterpret_cast< i8* >( new_memory );
-        slots_ = reinterpret_cast< KeyValue* >( new_memory + capacity + GroupSse2Impl::kWidth );
+        slots_ = reinterpret_cast< KeyValue* >( new_memory + capacity + Group::kWidth );
 
         reset_ctrl();
         reset_growth_left();
@@ -592,7 +858,7 @@ namespace raptor {
         }*/
 
         control_bytes[ i ] = h;
-        constexpr size_t kClonedBytes = GroupSse2Impl::kWidth - 1;
+        constexpr size_t kClonedBytes = Group::kWidth - 1;
         control_bytes[ ( ( i - kClonedBytes ) & capacity ) + ( kClonedBytes & capacity ) ] = h;
     }
 
@@ -611,6 +877,21 @@ namespace raptor {
         return default_key_value.value;
     }
 
+    template <typename K, typename V>
+    V& FlatHashMap<K, V>::get_hashed( u64 hash, const K& key ) {
+        return get( find_hashed( hash, key ) );
+    }
+
+    template <typename K, typename V>
+    FlatHashMapIterator FlatHashMap<K, V>::find( const StringView& name ) {
+        return find( ( K )hash_bytes( name.text, name.length ) );
+    }
+
+    template <typename K, typename V>
+    V& FlatHashMap<K, V>::get( const StringView& name ) {
+        return get( find( name ) );
+    }
+
     template <typename K, typename V>
     typename FlatHashMap<K, V>::KeyValue& FlatHashMap<K, V>::get_structure( const K& key ) {
         FlatHashMapIterator iterator = find( key );
@@ -651,7 +932,7 @@ namespace raptor {
         i8* ctrl = control_bytes + it.index;
 
         while ( control_is_empty_or_deleted( *ctrl ) ) {
-            u32 shift = GroupSse2Impl{ ctrl }.CountLeadingEmptyOrDeleted();
+            u32 shift = Group{ ctrl }.CountLeadingEmptyOrDeleted();
             ctrl += shift;
             it.index += shift;
         }
@@ -693,16 +974,30 @@ namespace raptor {
     u64 capacity_normalize( u64 n )         { return n ? ~u64{} >> lzcnt_soft( n ) : 1; }
 
     //
-    u64 capacity_to_growth( u64 capacity )  { return capacity - capacity / 8; }
+    u64 capacity_to_growth( u64 capacity ) {
+        // With 8 slots groups a full 7 slots table would have no empty slot to stop probing.
+        if ( Group::kWidth == 8 && capacity == 7 ) {
+            return 6;
+        }
+        return capacity - capacity / 8;
+    }
 
     //
-    u64 capacity_growth_to_lower_bound( u64 growth ) { return growth + static_cast< u64 >( ( static_cast< i64 >( growth ) - 1 ) / 7 ); }
+    u64 capacity_growth_to_lower_bound( u64 growth ) {
+        if ( Group::kWidth == 8 && growth == 7 ) {
+            return 8;
+        }
+        return growth + static_cast< u64 >( ( static_cast< i64 >( growth ) - 1 ) / 7 );
+    }
 
 
     // Grouping: implementation ///////////////////////////////////////////
     inline i8* group_init_empty() {
-        alignas( 16 ) static constexpr i8 empty_group[] = {
+        // Sized for the widest group, a find on an empty map reads a whole group.
+        alignas( 32 ) static constexpr i8 empty_group[ 32 ] = {
             k_control_bitmask_sentinel, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty,
+            k_control_bitmask_empty,    k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty,
+            k_control_bitmask_empty,    k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty,
             k_control_bitmask_empty,    k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty, k_control_bitmask_empty };
         return const_cast< i8* >( empty_group );
     }
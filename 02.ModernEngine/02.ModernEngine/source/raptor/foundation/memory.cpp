@@ -1,12 +1,26 @@
 #include "memory.hpp"
 #include "memory_utils.hpp"
 #include "assert.hpp"
+#include "time.hpp"
 
 #include "external/tlsf.h"
 
 #include <stdlib.h>
 #include <memory.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(_MSC_VER)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #if defined RAPTOR_IMGUI
 #include "external/imgui/imgui.h"
 #endif // RAPTOR_IMGUI
@@ -51,7 +65,8 @@ void MemoryService::init( void* configuration ) {
 
     rprint( "Memory Service Init\n" );
     MemoryServiceConfiguration* memory_configuration = static_cast< MemoryServiceConfiguration* >( configuration );
-    system_allocator.init( memory_configuration ? memory_configuration->maximum_dynamic_size : s_size );
+    system_allocator.init( memory_configuration ? memory_configuration->maximum_dynamic_size : s_size,
+                           memory_configuration ? memory_configuration->concurrent_system_allocator : false );
 }
 
 void MemoryService::shutdown() {
@@ -82,7 +97,7 @@ void imgui_walker( void* ptr, size_t size, int used, void* user ) {
         memory_size /= 1024;
         memory_unit = "kb";
     }
-    ImGui::Text( "\t%p %s size: %4llu %s\n", ptr, used ? "used" : "free", memory_size, memory_unit );
+    ImGui::Text( "\t%p %s size: %4u %s\n", ptr, used ? "used" : "free", memory_size, memory_unit );
 
     MemoryStatistics* stats = ( MemoryStatistics* )user;
     stats->add( used ? size : 0 );
@@ -99,28 +114,215 @@ void MemoryService::imgui_draw() {
 }
 #endif // RAPTOR_IMGUI
 
+// Allocator benchmark ////////////////////////////////////////////////////
+
+//
+// Serializes a non thread-safe allocator, as the single pool heap would have to be
+// used when shared between threads.
+struct LockedAllocator : public Allocator {
+
+    void* allocate( sizet size, sizet alignment ) override {
+        std::lock_guard<std::mutex> guard( mutex );
+        return allocator->allocate( size, alignment );
+    }
+
+    void* allocate( sizet size, sizet alignment, cstring file, i32 line ) override {
+        return allocate( size, alignment );
+    }
+
+    void deallocate( void* pointer ) override {
+        std::lock_guard<std::mutex> guard( mutex );
+        allocator->deallocate( pointer );
+    }
+
+    Allocator*          allocator;
+    std::mutex          mutex;
+}; // struct LockedAllocator
+
+static constexpr u32    k_benchmark_live_allocations    = 512;
+static constexpr u32    k_benchmark_iterations          = 200000;
+
+// Xorshift, enough to have sizes that are not predictable.
+static u32 benchmark_random( u32& state ) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static sizet benchmark_size( u32& state ) {
+    const u32 value = benchmark_random( state );
+    // 1 allocation out of 16 is bigger than the small size classes.
+    return ( value & 15 ) == 0 ? 4096 + ( value >> 20 ) : 16 + ( ( value >> 8 ) & 1023 );
+}
+
+//
+// Benchmark threads, created once so that all runs reuse the same heap thread slots.
+struct BenchmarkThreads {
+
+    typedef void            ( *Job )( void* context, u32 thread_index );
+
+    void init( u32 num_threads_ ) {
+        num_threads = num_threads_ > 64 ? 64 : num_threads_;
+        for ( u32 t = 0; t < num_threads; ++t ) {
+            threads[ t ] = std::thread( [this, t]() { worker( t ); } );
+        }
+    }
+
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> guard( mutex );
+            quit = true;
+        }
+        start_condition.notify_all();
+
+        for ( u32 t = 0; t < num_threads; ++t ) {
+            threads[ t ].join();
+        }
+    }
+
+    // Runs the job on the first active_count threads and waits for all of them.
+    void run( u32 active_count, Job job_, void* context_ ) {
+        std::unique_lock<std::mutex> lock( mutex );
+        job = job_;
+        context = context_;
+        active_threads = active_count;
+        pending_threads = active_count;
+        ++generation;
+        start_condition.notify_all();
+
+        done_condition.wait( lock, [this]() { return pending_threads == 0; } );
+    }
+
+    void worker( u32 thread_index ) {
+        u64 seen_generation = 0;
+        std::unique_lock<std::mutex> lock( mutex );
+        for ( ;; ) {
+            start_condition.wait( lock, [&]() { return quit || generation != seen_generation; } );
+            if ( quit ) {
+                return;
+            }
+
+            seen_generation = generation;
+            if ( thread_index >= active_threads ) {
+                continue;
+            }
+
+            Job current_job = job;
+            void* current_context = context;
+            lock.unlock();
+            current_job( current_context, thread_index );
+            lock.lock();
+
+            if ( --pending_threads == 0 ) {
+                done_condition.notify_one();
+            }
+        }
+    }
+
+    std::thread             threads[ 64 ];
+    u32                     num_threads     = 0;
+
+    std::mutex              mutex;
+    std::condition_variable start_condition;
+    std::condition_variable done_condition;
+    Job                     job             = nullptr;
+    void*                   context         = nullptr;
+    u32                     active_threads  = 0;
+    u32                     pending_threads = 0;
+    u64                     generation      = 0;
+    bool                    quit            = false;
+}; // struct BenchmarkThreads
+
+struct BenchmarkContext {
+    Allocator*              allocator;
+    void**                  pointers;
+    u32                     num_threads;
+}; // struct BenchmarkContext
+
+// Each thread churns through its own set of live allocations.
+static void benchmark_churn( void* context_, u32 t ) {
+    BenchmarkContext* context = ( BenchmarkContext* )context_;
+    Allocator* allocator = context->allocator;
+    void** thread_pointers = context->pointers + t * k_benchmark_live_allocations;
+    u32 random_state = 0x9E3779B9u ^ ( t * 7919u + 1 );
+
+    for ( u32 i = 0; i < k_benchmark_live_allocations; ++i ) {
+        thread_pointers[ i ] = allocator->allocate( benchmark_size( random_state ), 1 );
+    }
+
+    for ( u32 i = 0; i < k_benchmark_iterations; ++i ) {
+        const u32 slot = benchmark_random( random_state ) % k_benchmark_live_allocations;
+        allocator->deallocate( thread_pointers[ slot ] );
+        thread_pointers[ slot ] = allocator->allocate( benchmark_size( random_state ), 1 );
+        // Touch memory to have a realistic usage.
+        *( u8* )thread_pointers[ slot ] = ( u8 )i;
+    }
+}
+
+// Remote frees: each thread releases the allocations of the next one.
+static void benchmark_remote_frees( void* context_, u32 t ) {
+    BenchmarkContext* context = ( BenchmarkContext* )context_;
+    void** other_pointers = context->pointers + ( ( t + 1 ) % context->num_threads ) * k_benchmark_live_allocations;
+    for ( u32 i = 0; i < k_benchmark_live_allocations; ++i ) {
+        context->allocator->deallocate( other_pointers[ i ] );
+    }
+}
+
+//
+// Each thread churns through its own set of live allocations, then frees
+// the allocations of its neighbour thread to exercise cross-thread frees.
+static f64 benchmark_allocator( BenchmarkThreads& threads, Allocator* allocator, u32 num_threads ) {
+
+    num_threads = num_threads > threads.num_threads ? threads.num_threads : num_threads;
+    BenchmarkContext context{ allocator, ( void** )malloc( sizeof( void* ) * k_benchmark_live_allocations * num_threads ), num_threads };
+
+    const i64 start_time = time_now();
+
+    threads.run( num_threads, benchmark_churn, &context );
+    threads.run( num_threads, benchmark_remote_frees, &context );
+
+    const f64 elapsed_ms = time_from_milliseconds( start_time );
+
+    free( context.pointers );
+
+    return elapsed_ms;
+}
+
 void MemoryService::test() {
 
-    //static u8 mem[ 1024 ];
-    //LinearAllocator la;
-    //la.init( mem, 1024 );
+    const u32 hardware_threads = std::thread::hardware_concurrency();
+    const u32 max_threads = hardware_threads > 1 ? hardware_threads : 2;
+
+    HeapAllocator single_pool_heap;
+    single_pool_heap.init( rmega( 256 ) );
+    LockedAllocator locked_heap;
+    locked_heap.allocator = &single_pool_heap;
+
+    HeapAllocator concurrent_heap;
+    concurrent_heap.init( rmega( 256 ), true );
+
+    MallocAllocator malloc_allocator;
+
+    BenchmarkThreads threads;
+    threads.init( max_threads );
+
+    rprint( "Heap allocators benchmark: %u allocations per thread, %u live.\n", k_benchmark_iterations, k_benchmark_live_allocations );
+    rprint( "Threads | Single pool (locked) ms | Concurrent heap ms | Malloc ms\n" );
+
+    for ( u32 num_threads = 1; num_threads <= max_threads; num_threads *= 2 ) {
+        const f64 locked_ms = benchmark_allocator( threads, &locked_heap, num_threads );
+        const f64 concurrent_ms = benchmark_allocator( threads, &concurrent_heap, num_threads );
+        const f64 malloc_ms = benchmark_allocator( threads, &malloc_allocator, num_threads );
+
+        rprint( "%7u | %23.2f | %18.2f | %9.2f\n", num_threads, locked_ms, concurrent_ms, malloc_ms );
+    }
 
-    //// Allocate 3 times
-    //void* a1 = ralloca( 16, &la );
-    //void* a2 = ralloca( 20, &la );
-    //void* a4 = ralloca( 10, &la );
-    //// Free based on size
-    //la.free( 10 );
-    //void* a3 = ralloca( 10, &la );
-    //RASSERT( a3 == a4 );
+    // Exiting threads give their cached blocks back to the concurrent heap.
+    threads.shutdown();
 
-    //// Free based on pointer
-    //rfree( a2, &la );
-    //void* a32 = ralloca( 10, &la );
-    //RASSERT( a32 == a2 );
-    //// Test out of bounds 
-    //u8* out_bounds = ( u8* )a1 + 10000;
-    //rfree( out_bounds, &la );
+    concurrent_heap.shutdown();
+    single_pool_heap.shutdown();
 }
 
 // Memory Structs /////////////////////////////////////////////////////////
@@ -129,7 +331,264 @@ void MemoryService::test() {
 HeapAllocator::~HeapAllocator() {
 }
 
-void HeapAllocator::init( sizet size ) {
+// Concurrent heap ////////////////////////////////////////////////////////
+
+static constexpr u32    k_heap_size_classes         = 8;        // 16 bytes to 2 kb.
+static constexpr u32    k_heap_min_class_shift      = 4;
+static constexpr sizet  k_heap_max_class_size       = sizet( 1 ) << ( k_heap_min_class_shift + k_heap_size_classes - 1 );
+static constexpr u32    k_heap_large_class          = u32_max;
+static constexpr sizet  k_heap_header_size          = 16;
+static constexpr u32    k_heap_max_threads          = 64;
+static constexpr u32    k_heap_cache_batch          = 32;       // Blocks moved between a thread cache and the pool at once.
+static constexpr u32    k_heap_cache_max_blocks     = k_heap_cache_batch * 2;
+
+struct HeapThreadCache;
+
+//
+// Stored right before each pointer returned by a concurrent heap.
+struct HeapBlockHeader {
+    HeapThreadCache*                cache;          // Owner cache, nullptr for blocks directly allocated from the pool.
+    u32                             size_class;
+    u32                             offset;         // Distance from the tlsf block start to the user pointer.
+}; // struct HeapBlockHeader
+
+static_assert( sizeof( HeapBlockHeader ) <= k_heap_header_size, "Heap block header must fit in its reserved space." );
+
+//
+// Free blocks are linked using their own memory.
+struct HeapFreeBlock {
+    HeapFreeBlock*                  next;
+}; // struct HeapFreeBlock
+
+//
+// Per thread magazines, one free list for each size class.
+// Aligned to a cache line to avoid false sharing between threads.
+struct alignas( 64 ) HeapThreadCache {
+    HeapFreeBlock*                  free_lists[ k_heap_size_classes ];
+    u32                             free_counts[ k_heap_size_classes ];
+
+    std::atomic<HeapFreeBlock*>     remote_frees;   // Lock-free stack filled by other threads.
+}; // struct HeapThreadCache
+
+struct HeapAllocatorConcurrency {
+    std::mutex                      pool_mutex;     // Guards the tlsf pool.
+    HeapThreadCache                 caches[ k_heap_max_threads ];
+
+    HeapAllocator*                  heap            = nullptr;
+    HeapAllocatorConcurrency*       next            = nullptr;  // Live concurrent heaps, to flush caches of exiting threads.
+}; // struct HeapAllocatorConcurrency
+
+//
+// Cache index of a thread, shared between all concurrent heaps. Slots are given back when the
+// thread exits, so that only threads alive at the same time are limited to k_heap_max_threads.
+struct HeapThreadSlot {
+    ~HeapThreadSlot();
+
+    u32                             index           = u32_max;
+    bool                            exited          = false;
+}; // struct HeapThreadSlot
+
+// Guards the free slots and the list of live concurrent heaps.
+static std::mutex                   s_heap_threads_mutex;
+static u32                          s_heap_free_slots[ k_heap_max_threads ];
+static u32                          s_heap_free_slot_count = 0;
+static u32                          s_heap_used_slot_count = 0;    // Slots handed out at least once.
+static HeapAllocatorConcurrency*    s_heap_concurrencies = nullptr;
+static thread_local HeapThreadSlot  t_heap_thread_slot;
+
+static void heap_cache_flush( HeapAllocator* heap, HeapThreadCache* cache );
+
+// Returns k_heap_max_threads when all slots are taken, those threads use the locked pool.
+static u32 heap_thread_index() {
+    HeapThreadSlot& slot = t_heap_thread_slot;
+    if ( slot.index == u32_max ) {
+        // Allocations from thread_local destructors running after the slot one.
+        if ( slot.exited ) {
+            return k_heap_max_threads;
+        }
+
+        std::lock_guard<std::mutex> guard( s_heap_threads_mutex );
+        if ( s_heap_free_slot_count ) {
+            slot.index = s_heap_free_slots[ --s_heap_free_slot_count ];
+        } else if ( s_heap_used_slot_count < k_heap_max_threads ) {
+            slot.index = s_heap_used_slot_count++;
+        } else {
+            slot.index = k_heap_max_threads;
+        }
+    }
+    return slot.index;
+}
+
+HeapThreadSlot::~HeapThreadSlot() {
+    if ( index < k_heap_max_threads ) {
+        // Cached blocks go back to every pool, blocks freed remotely later are collected by the next owner.
+        std::lock_guard<std::mutex> guard( s_heap_threads_mutex );
+        for ( HeapAllocatorConcurrency* concurrency = s_heap_concurrencies; concurrency; concurrency = concurrency->next ) {
+            heap_cache_flush( concurrency->heap, &concurrency->caches[ index ] );
+        }
+
+        s_heap_free_slots[ s_heap_free_slot_count++ ] = index;
+    }
+
+    index = u32_max;
+    exited = true;
+}
+
+static u32 heap_size_class( sizet size ) {
+    if ( size <= ( sizet( 1 ) << k_heap_min_class_shift ) ) {
+        return 0;
+    }
+    // Index of the highest bit of (size - 1), relative to the minimum class.
+    u32 shift = 0;
+    sizet value = ( size - 1 ) >> k_heap_min_class_shift;
+    while ( value ) {
+        ++shift;
+        value >>= 1;
+    }
+    return shift;
+}
+
+static HeapBlockHeader* heap_block_header( void* pointer ) {
+    return ( HeapBlockHeader* )( ( u8* )pointer - k_heap_header_size );
+}
+
+// Needs the pool lock.
+static void* heap_pool_allocate( HeapAllocator* heap, sizet size, sizet alignment, HeapThreadCache* cache, u32 size_class ) {
+    const sizet header_size = alignment > k_heap_header_size ? alignment : k_heap_header_size;
+    void* block = tlsf_memalign( heap->tlsf_handle, header_size, size + header_size );
+    if ( !block ) {
+        return nullptr;
+    }
+    heap->allocated_size += tlsf_block_size( block );
+
+    u8* pointer = ( u8* )block + header_size;
+    HeapBlockHeader* header = heap_block_header( pointer );
+    header->cache = cache;
+    header->size_class = size_class;
+    header->offset = ( u32 )header_size;
+    return pointer;
+}
+
+// Needs the pool lock.
+static void heap_pool_free( HeapAllocator* heap, void* pointer ) {
+    void* block = ( u8* )pointer - heap_block_header( pointer )->offset;
+    heap->allocated_size -= tlsf_block_size( block );
+    tlsf_free( heap->tlsf_handle, block );
+}
+
+// Moves all blocks freed by other threads into the local free lists.
+static void heap_cache_collect_remote_frees( HeapThreadCache* cache ) {
+    HeapFreeBlock* block = cache->remote_frees.exchange( nullptr, std::memory_order_acquire );
+    while ( block ) {
+        HeapFreeBlock* next = block->next;
+        const u32 size_class = heap_block_header( block )->size_class;
+        block->next = cache->free_lists[ size_class ];
+        cache->free_lists[ size_class ] = block;
+        ++cache->free_counts[ size_class ];
+        block = next;
+    }
+}
+
+// Returns up to count blocks of the given class back to the pool. Needs the pool lock.
+static void heap_cache_release( HeapAllocator* heap, HeapThreadCache* cache, u32 size_class, u32 count ) {
+    HeapFreeBlock* block = cache->free_lists[ size_class ];
+    while ( block && count ) {
+        HeapFreeBlock* next = block->next;
+        heap_pool_free( heap, block );
+        --cache->free_counts[ size_class ];
+        --count;
+        block = next;
+    }
+    cache->free_lists[ size_class ] = block;
+}
+
+// Gives back all the blocks of a cache, including the ones freed by other threads.
+static void heap_cache_flush( HeapAllocator* heap, HeapThreadCache* cache ) {
+    std::lock_guard<std::mutex> guard( heap->concurrency->pool_mutex );
+    heap_cache_collect_remote_frees( cache );
+    for ( u32 c = 0; c < k_heap_size_classes; ++c ) {
+        heap_cache_release( heap, cache, c, u32_max );
+    }
+}
+
+void* HeapAllocator::concurrent_allocate( sizet size, sizet alignment ) {
+    const u32 thread_index = heap_thread_index();
+
+    if ( size > k_heap_max_class_size || alignment > k_heap_header_size || thread_index >= k_heap_max_threads ) {
+        std::lock_guard<std::mutex> guard( concurrency->pool_mutex );
+        return heap_pool_allocate( this, size, alignment, nullptr, k_heap_large_class );
+    }
+
+    const u32 size_class = heap_size_class( size );
+    HeapThreadCache* cache = &concurrency->caches[ thread_index ];
+
+    if ( !cache->free_lists[ size_class ] ) {
+        heap_cache_collect_remote_frees( cache );
+    }
+
+    if ( !cache->free_lists[ size_class ] ) {
+        // Refill a batch of blocks with a single lock.
+        const sizet class_size = sizet( 1 ) << ( size_class + k_heap_min_class_shift );
+
+        std::lock_guard<std::mutex> guard( concurrency->pool_mutex );
+        for ( u32 i = 0; i < k_heap_cache_batch; ++i ) {
+            HeapFreeBlock* block = ( HeapFreeBlock* )heap_pool_allocate( this, class_size, k_heap_header_size, cache, size_class );
+            if ( !block ) {
+                break;
+            }
+            block->next = cache->free_lists[ size_class ];
+            cache->free_lists[ size_class ] = block;
+            ++cache->free_counts[ size_class ];
+        }
+
+        if ( !cache->free_lists[ size_class ] ) {
+            return nullptr;
+        }
+    }
+
+    HeapFreeBlock* block = cache->free_lists[ size_class ];
+    cache->free_lists[ size_class ] = block->next;
+    --cache->free_counts[ size_class ];
+    return block;
+}
+
+void HeapAllocator::concurrent_deallocate( void* pointer ) {
+    if ( !pointer ) {
+        return;
+    }
+
+    HeapBlockHeader* header = heap_block_header( pointer );
+    HeapThreadCache* owner_cache = header->cache;
+
+    if ( owner_cache == nullptr ) {
+        std::lock_guard<std::mutex> guard( concurrency->pool_mutex );
+        heap_pool_free( this, pointer );
+        return;
+    }
+
+    HeapFreeBlock* block = ( HeapFreeBlock* )pointer;
+    const u32 thread_index = heap_thread_index();
+
+    if ( thread_index < k_heap_max_threads && owner_cache == &concurrency->caches[ thread_index ] ) {
+        const u32 size_class = header->size_class;
+        block->next = owner_cache->free_lists[ size_class ];
+        owner_cache->free_lists[ size_class ] = block;
+
+        if ( ++owner_cache->free_counts[ size_class ] > k_heap_cache_max_blocks ) {
+            std::lock_guard<std::mutex> guard( concurrency->pool_mutex );
+            heap_cache_release( this, owner_cache, size_class, k_heap_cache_batch );
+        }
+        return;
+    }
+
+    // Remote free: push onto the owner lock-free stack.
+    HeapFreeBlock* head = owner_cache->remote_frees.load( std::memory_order_relaxed );
+    do {
+        block->next = head;
+    } while ( !owner_cache->remote_frees.compare_exchange_weak( head, block, std::memory_order_release, std::memory_order_relaxed ) );
+}
+
+void HeapAllocator::init( sizet size, bool concurrent ) {
     // Allocate
     memory = malloc( size );
     max_size = size;
@@ -137,11 +596,42 @@ void HeapAllocator::init( sizet size ) {
 
     tlsf_handle = tlsf_create_with_pool( memory, size );
 
-    rprint( "HeapAllocator of size %llu created\n", size );
+    if ( concurrent ) {
+        concurrency = new HeapAllocatorConcurrency();
+        for ( u32 i = 0; i < k_heap_max_threads; ++i ) {
+            HeapThreadCache& cache = concurrency->caches[ i ];
+            memset( cache.free_lists, 0, sizeof( cache.free_lists ) );
+            memset( cache.free_counts, 0, sizeof( cache.free_counts ) );
+            cache.remote_frees.store( nullptr );
+        }
+
+        concurrency->heap = this;
+        std::lock_guard<std::mutex> guard( s_heap_threads_mutex );
+        concurrency->next = s_heap_concurrencies;
+        s_heap_concurrencies = concurrency;
+    }
+
+    rprint( "HeapAllocator of size %llu created%s\n", size, concurrent ? " (concurrent)" : "" );
 }
 
 void HeapAllocator::shutdown() {
 
+    if ( concurrency ) {
+        {
+            std::lock_guard<std::mutex> guard( s_heap_threads_mutex );
+            HeapAllocatorConcurrency** link = &s_heap_concurrencies;
+            while ( *link != concurrency ) {
+                link = &( *link )->next;
+            }
+            *link = concurrency->next;
+        }
+
+        // Give back all the cached blocks, so that only real leaks are reported.
+        for ( u32 i = 0; i < k_heap_max_threads; ++i ) {
+            heap_cache_flush( this, &concurrency->caches[ i ] );
+        }
+    }
+
     // Check memory at the application exit.
     MemoryStatistics stats{ 0, max_size };
     pool_t pool = tlsf_get_pool( tlsf_handle );
@@ -158,6 +648,9 @@ void HeapAllocator::shutdown() {
     tlsf_destroy( tlsf_handle );
 
     free( memory );
+
+    delete concurrency;
+    concurrency = nullptr;
 }
 
 #if defined RAPTOR_IMGUI
@@ -168,11 +661,25 @@ void HeapAllocator::debug_ui() {
     ImGui::Separator();
     MemoryStatistics stats{ 0, max_size };
     pool_t pool = tlsf_get_pool( tlsf_handle );
-    tlsf_walk_pool( pool, imgui_walker, ( void* )&stats );
+    if ( concurrency ) {
+        std::lock_guard<std::mutex> guard( concurrency->pool_mutex );
+        tlsf_walk_pool( pool, imgui_walker, ( void* )&stats );
+    } else {
+        tlsf_walk_pool( pool, imgui_walker, ( void* )&stats );
+    }
 
     ImGui::Separator();
+    if ( concurrency ) {
+        u32 cached_blocks = 0;
+        for ( u32 i = 0; i < k_heap_max_threads; ++i ) {
+            for ( u32 c = 0; c < k_heap_size_classes; ++c ) {
+                cached_blocks += concurrency->caches[ i ].free_counts[ c ];
+            }
+        }
+        ImGui::Text( "\tConcurrent, thread cached blocks %u", cached_blocks );
+    }
     ImGui::Text( "\tAllocation count %d", stats.allocation_count );
-    ImGui::Text( "\tAllocated %llu K, free %llu Mb, total %llu Mb", stats.allocated_bytes / (1024 * 1024), ( max_size - stats.allocated_bytes ) / ( 1024 * 1024 ), max_size / ( 1024 * 1024 ) );
+    ImGui::Text( "\tAllocated %zu K, free %zu Mb, total %zu Mb", stats.allocated_bytes / (1024 * 1024), ( max_size - stats.allocated_bytes ) / ( 1024 * 1024 ), max_size / ( 1024 * 1024 ) );
 }
 #endif // RAPTOR_IMGUI
 
@@ -196,13 +703,16 @@ void* HeapAllocator::allocate( sizet size, sizet alignment ) {
         sw.ShowCallstack();
     }*/
 
-    void* mem = tlsf_malloc( tlsf_handle, size );
+    void* mem = concurrency ? concurrent_allocate( size, alignment ) : tlsf_malloc( tlsf_handle, size );
     rprint( "Mem: %p, size %llu \n", mem, size );
     return mem;
 }
 #else
 
 void* HeapAllocator::allocate( sizet size, sizet alignment ) {
+    if ( concurrency ) {
+        return concurrent_allocate( size, alignment );
+    }
 #if defined (HEAP_ALLOCATOR_STATS)
     void* allocated_memory = alignment == 1 ? tlsf_malloc( tlsf_handle, size ) : tlsf_memalign( tlsf_handle, alignment, size );
     sizet actual_size = tlsf_block_size( allocated_memory );
@@ -223,6 +733,10 @@ void* HeapAllocator::allocate( sizet size, sizet alignment, cstring file, i32 li
 }
 
 void HeapAllocator::deallocate( void* pointer ) {
+    if ( concurrency ) {
+        concurrent_deallocate( pointer );
+        return;
+    }
 #if defined (HEAP_ALLOCATOR_STATS)
     sizet actual_size = tlsf_block_size( pointer );
     allocated_size -= actual_size;
@@ -287,6 +801,205 @@ sizet memory_align( sizet size, sizet alignment ) {
     return ( size + alignment_mask ) & ~alignment_mask;
 }
 
+// Virtual memory /////////////////////////////////////////////////////////
+sizet virtual_memory_page_size() {
+#if defined(_MSC_VER)
+    SYSTEM_INFO system_info;
+    GetSystemInfo( &system_info );
+    return system_info.dwPageSize;
+#else
+    return ( sizet )sysconf( _SC_PAGESIZE );
+#endif
+}
+
+void* virtual_memory_reserve( sizet size ) {
+#if defined(_MSC_VER)
+    return VirtualAlloc( nullptr, size, MEM_RESERVE, PAGE_NOACCESS );
+#else
+    void* address = mmap( nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+    return address == MAP_FAILED ? nullptr : address;
+#endif
+}
+
+bool virtual_memory_commit( void* address, sizet size ) {
+#if defined(_MSC_VER)
+    return VirtualAlloc( address, size, MEM_COMMIT, PAGE_READWRITE ) != nullptr;
+#else
+    return mprotect( address, size, PROT_READ | PROT_WRITE ) == 0;
+#endif
+}
+
+void virtual_memory_decommit( void* address, sizet size ) {
+#if defined(_MSC_VER)
+    VirtualFree( address, size, MEM_DECOMMIT );
+#else
+    // Drop the physical pages and make the range inaccessible again.
+    madvise( address, size, MADV_DONTNEED );
+    mprotect( address, size, PROT_NONE );
+#endif
+}
+
+void virtual_memory_release( void* address, sizet size ) {
+#if defined(_MSC_VER)
+    VirtualFree( address, 0, MEM_RELEASE );
+#else
+    munmap( address, size );
+#endif
+}
+
+// VirtualArenaAllocator //////////////////////////////////////////////////
+void VirtualArenaAllocator::init( sizet reserve_size, sizet commit_chunk_size_ ) {
+    const sizet page_size = virtual_memory_page_size();
+
+    reserved_size = memory_align( reserve_size, page_size );
+    commit_chunk_size = memory_align( commit_chunk_size_, page_size );
+    committed_size = 0;
+    allocated_size = 0;
+    high_water_mark = 0;
+
+    memory = ( u8* )virtual_memory_reserve( reserved_size );
+    RASSERTM( memory, "Cannot reserve %llu bytes of virtual memory", reserved_size );
+}
+
+void VirtualArenaAllocator::shutdown() {
+    if ( memory ) {
+        virtual_memory_release( memory, reserved_size );
+    }
+    memory = nullptr;
+    reserved_size = committed_size = allocated_size = 0;
+}
+
+void* VirtualArenaAllocator::allocate( sizet size, sizet alignment ) {
+    RASSERT( size > 0 );
+
+    const sizet new_start = memory_align( allocated_size, alignment );
+    const sizet new_allocated_size = new_start + size;
+    if ( new_allocated_size > reserved_size ) {
+        RASSERTM( false, "VirtualArenaAllocator overflow: requested %llu, reserved %llu. Reserve a bigger range.", new_allocated_size, reserved_size );
+        return nullptr;
+    }
+
+    if ( new_allocated_size > committed_size ) {
+        sizet new_committed_size = memory_align( new_allocated_size, commit_chunk_size );
+        new_committed_size = new_committed_size > reserved_size ? reserved_size : new_committed_size;
+
+        if ( !virtual_memory_commit( memory + committed_size, new_committed_size - committed_size ) ) {
+            RASSERTM( false, "VirtualArenaAllocator cannot commit memory up to %llu", new_committed_size );
+            return nullptr;
+        }
+        committed_size = new_committed_size;
+    }
+
+    allocated_size = new_allocated_size;
+    high_water_mark = allocated_size > high_water_mark ? allocated_size : high_water_mark;
+
+    return memory + new_start;
+}
+
+void* VirtualArenaAllocator::allocate( sizet size, sizet alignment, cstring file, i32 line ) {
+    return allocate( size, alignment );
+}
+
+void VirtualArenaAllocator::deallocate( void* ) {
+    // This allocator does not allocate on a per-pointer base!
+}
+
+sizet VirtualArenaAllocator::get_marker() {
+    return allocated_size;
+}
+
+void VirtualArenaAllocator::free_marker( sizet marker ) {
+    if ( marker < allocated_size ) {
+        allocated_size = marker;
+    }
+}
+
+void VirtualArenaAllocator::clear() {
+    allocated_size = 0;
+    high_water_mark = 0;
+}
+
+void VirtualArenaAllocator::trim( sizet keep_size ) {
+    sizet new_committed_size = memory_align( keep_size > allocated_size ? keep_size : allocated_size, commit_chunk_size );
+    if ( new_committed_size < committed_size ) {
+        virtual_memory_decommit( memory + new_committed_size, committed_size - new_committed_size );
+        committed_size = new_committed_size;
+    }
+}
+
+// FrameArenaRing /////////////////////////////////////////////////////////
+void FrameArenaRing::init( u32 num_arenas_, sizet reserve_size_per_arena ) {
+    RASSERT( num_arenas_ > 0 && num_arenas_ <= k_max_arenas );
+
+    num_arenas = num_arenas_;
+    current_arena = 0;
+
+    for ( u32 i = 0; i < num_arenas; ++i ) {
+        arenas[ i ].init( reserve_size_per_arena );
+    }
+
+    history_head = 0;
+    history_count = 0;
+    max_high_water_mark = 0;
+}
+
+void FrameArenaRing::shutdown() {
+    for ( u32 i = 0; i < num_arenas; ++i ) {
+        arenas[ i ].shutdown();
+    }
+    num_arenas = 0;
+}
+
+VirtualArenaAllocator* FrameArenaRing::begin_frame( u32 frame_index ) {
+    current_arena = frame_index % num_arenas;
+    VirtualArenaAllocator& arena = arenas[ current_arena ];
+
+    // Record the peak usage of the frame that used this arena last time.
+    const sizet high_water_mark = arena.high_water_mark;
+    if ( high_water_mark ) {
+        frame_high_water_marks[ history_head ] = high_water_mark;
+        history_head = ( history_head + 1 ) % k_history_size;
+        history_count = history_count < k_history_size ? history_count + 1 : k_history_size;
+
+        max_high_water_mark = high_water_mark > max_high_water_mark ? high_water_mark : max_high_water_mark;
+    }
+
+    arena.clear();
+    return &arena;
+}
+
+VirtualArenaAllocator* FrameArenaRing::get_current() {
+    return &arenas[ current_arena ];
+}
+
+#if defined RAPTOR_IMGUI
+void FrameArenaRing::debug_ui() {
+
+    ImGui::Separator();
+    ImGui::Text( "Frame Arenas" );
+    ImGui::Separator();
+
+    for ( u32 i = 0; i < num_arenas; ++i ) {
+        const VirtualArenaAllocator& arena = arenas[ i ];
+        ImGui::Text( "\t%u: allocated %zu K, high water %zu K, committed %zu K, reserved %zu Mb", i,
+                     arena.allocated_size / 1024, arena.high_water_mark / 1024, arena.committed_size / 1024, arena.reserved_size / ( 1024 * 1024 ) );
+    }
+
+    if ( history_count ) {
+        f32 values[ k_history_size ];
+        sizet sum = 0;
+        for ( u32 i = 0; i < history_count; ++i ) {
+            const u32 index = ( history_head + k_history_size - history_count + i ) % k_history_size;
+            values[ i ] = frame_high_water_marks[ index ] / 1024.f;
+            sum += frame_high_water_marks[ index ];
+        }
+
+        ImGui::Text( "\tHigh water mark: max %zu K, average %zu K", max_high_water_mark / 1024, ( sum / history_count ) / 1024 );
+        ImGui::PlotLines( "Frame K", values, history_count, 0, nullptr, 0.f, max_high_water_mark / 1024.f, ImVec2( 0, 60 ) );
+    }
+}
+#endif // RAPTOR_IMGUI
+
 // MallocAllocator ///////////////////////////////////////////////////////
 void* MallocAllocator::allocate( sizet size, sizet alignment ) {
     return malloc( size );
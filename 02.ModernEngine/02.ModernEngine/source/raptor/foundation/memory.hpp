@@ -14,6 +14,14 @@ namespace raptor {
     //  Calculate aligned memory size.
     sizet           memory_align( sizet size, sizet alignment );
 
+    //
+    //  Virtual memory: reserve address space, then commit pages when needed.
+    sizet           virtual_memory_page_size();
+    void*           virtual_memory_reserve( sizet size );
+    bool            virtual_memory_commit( void* address, sizet size );
+    void            virtual_memory_decommit( void* address, sizet size );
+    void            virtual_memory_release( void* address, sizet size );
+
     // Memory Structs /////////////////////////////////////////////////////
     //
     //
@@ -42,13 +50,18 @@ namespace raptor {
     }; // struct Allocator
 
 
+    struct HeapAllocatorConcurrency;
+
     //
-    //
+    // TLSF based allocator. When initialized as concurrent, small allocations are served
+    // from per-thread size class caches and only refills/large allocations lock the pool.
+    // Memory freed from a thread different from the one that cached it is pushed lock-free
+    // to the owner cache and reclaimed on its next refill.
     struct HeapAllocator : public Allocator {
 
         ~HeapAllocator() override;
 
-        void                        init( sizet size );
+        void                        init( sizet size, bool concurrent = false );
         void                        shutdown();
 
 #if defined RAPTOR_IMGUI
@@ -60,11 +73,16 @@ namespace raptor {
 
         void                        deallocate( void* pointer ) override;
 
+        void*                       concurrent_allocate( sizet size, sizet alignment );
+        void                        concurrent_deallocate( void* pointer );
+
         void*                       tlsf_handle;
         void*                       memory;
         sizet                       allocated_size = 0;
         sizet                       max_size = 0;
-        
+
+        HeapAllocatorConcurrency*   concurrency = nullptr;
+
     }; // struct HeapAllocator
 
     //
@@ -145,6 +163,71 @@ namespace raptor {
         sizet                       allocated_size  = 0;
     }; // struct LinearAllocator
 
+    //
+    // Linear allocator backed by virtual memory: a big address range is reserved and
+    // pages are committed in chunks while allocating, so it grows without moving and
+    // without the need of a conservative fixed size.
+    // Running out of the reserved range is an error, not a silent nullptr.
+    struct VirtualArenaAllocator : public Allocator {
+
+        void                        init( sizet reserve_size, sizet commit_chunk_size = 64 * 1024 );
+        void                        shutdown();
+
+        void*                       allocate( sizet size, sizet alignment ) override;
+        void*                       allocate( sizet size, sizet alignment, cstring file, i32 line ) override;
+
+        void                        deallocate( void* pointer ) override;
+
+        sizet                       get_marker();
+        void                        free_marker( sizet marker );
+
+        // O(1), committed memory is kept for the next uses.
+        void                        clear();
+        // Give back to the OS the committed memory above the given size.
+        void                        trim( sizet keep_size );
+
+        u8*                         memory          = nullptr;
+        sizet                       reserved_size   = 0;
+        sizet                       committed_size  = 0;
+        sizet                       allocated_size  = 0;
+        sizet                       commit_chunk_size = 0;
+
+        sizet                       high_water_mark = 0;    // Max allocated size since last clear.
+
+    }; // struct VirtualArenaAllocator
+
+    //
+    // Ring of arenas for per frame transient data. The arena used by a frame is cleared
+    // only when the same frame index comes back, so that data is valid while the frame
+    // is in flight.
+    struct FrameArenaRing {
+
+        static constexpr u32        k_max_arenas        = 4;
+        static constexpr u32        k_history_size      = 128;
+
+        void                        init( u32 num_arenas, sizet reserve_size_per_arena );
+        void                        shutdown();
+
+        // Clears and returns the arena for the frame index, recording its statistics.
+        VirtualArenaAllocator*      begin_frame( u32 frame_index );
+        VirtualArenaAllocator*      get_current();
+
+#if defined RAPTOR_IMGUI
+        void                        debug_ui();
+#endif // RAPTOR_IMGUI
+
+        VirtualArenaAllocator       arenas[ k_max_arenas ];
+        u32                         num_arenas          = 0;
+        u32                         current_arena       = 0;
+
+        // High water mark statistics, used to size arenas.
+        sizet                       frame_high_water_marks[ k_history_size ];
+        u32                         history_head        = 0;
+        u32                         history_count       = 0;
+        sizet                       max_high_water_mark = 0;
+
+    }; // struct FrameArenaRing
+
     //
     // DANGER: this should be used for NON runtime processes, like compilation of resources.
     struct MallocAllocator : public Allocator {
@@ -160,6 +243,7 @@ namespace raptor {
     struct MemoryServiceConfiguration {
 
         sizet                       maximum_dynamic_size = 32 * 1024 * 1024;    // Defaults to max 32MB of dynamic memory.
+        bool                        concurrent_system_allocator = false;        // System allocator can be used from multiple threads.
 
     }; // struct MemoryServiceConfiguration
     //
@@ -180,7 +264,8 @@ namespace raptor {
         HeapAllocator               system_allocator;
 
         //
-        // Test allocators.
+        // Test allocators. Runs a multi-threaded allocation benchmark comparing the
+        // single pool heap, the concurrent heap and the system malloc.
         void                        test();
 
         static constexpr cstring    k_name = "raptor_memory_service";